@@ -0,0 +1,387 @@
+/**
+ * @file determa_bench.c
+ * @brief Benchmark driver (bin/determa_bench): times every pipeline phase.
+ *
+ * Each workload is run through the same pipeline as `determa --no-cache`,
+ * on a fresh VM, compiler and typechecker per run, timing each phase on
+ * its own:
+ *
+ *   lex        a full token scan (the parser drives its own lexer, so
+ *              parse_ms includes lexing as well)
+ *   parse      source -> AST
+ *   typecheck  typecheck_ast()
+ *   optimize   optimize_ast() (only with -O)
+ *   compile    AST -> bytecode
+ *   run        interpret(), with the script's output discarded (with -r,
+ *              on the register VM, translation included)
+ *
+ * The best time of each phase over the runs is reported as JSON, together
+ * with the collector counters of the last run, so two releases can be
+ * compared with a plain diff. Two synthetic workloads are always
+ * included: "large_source" (many small functions) tracks front-end and
+ * compile time, "token_dense" (short keyword-heavy lines) tracks the
+ * lexer.
+ *
+ * Usage: determa_bench [-n runs] [-O] [-r] [-j] [-o out.json] [file.det ...]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <io.h>
+#define dup _dup
+#define dup2 _dup2
+#define close _close
+#define fileno _fileno
+#define NULL_DEVICE "NUL"
+#else
+#include <unistd.h>
+#define NULL_DEVICE "/dev/null"
+#endif
+
+#include "lexer.h"
+#include "parser.h"
+#include "ast.h"
+#include "typechecker.h"
+#include "optimizer.h"
+#include "vm/vm.h"
+#include "vm/compiler.h"
+#include "vm/memory.h"
+#include "vm/natives.h"
+#include "vm/jit.h"
+#include "version.h"
+
+#define LARGE_SOURCE_FUNCTIONS 2000
+#define TOKEN_DENSE_FUNCTIONS 2000
+
+typedef enum {
+    PHASE_LEX,
+    PHASE_PARSE,
+    PHASE_TYPECHECK,
+    PHASE_OPTIMIZE,
+    PHASE_COMPILE,
+    PHASE_RUN,
+    PHASE_COUNT
+} Phase;
+
+static const char* phaseNames[PHASE_COUNT] = {
+    "lex", "parse", "typecheck", "optimize", "compile", "run"
+};
+
+typedef struct {
+    const char* status;         // "ok", "compile_error" or "runtime_error"
+    uint64_t phaseNs[PHASE_COUNT];
+    uint64_t totalNs;
+    GcStats gc;
+} BenchResult;
+
+static int optLevel = OPT_LEVEL_NONE;
+
+// --- Workloads ---
+
+static char* read_file(const char* path) {
+    FILE* file = fopen(path, "rb");
+    if (file == NULL) return NULL;
+
+    fseek(file, 0L, SEEK_END);
+    long size = ftell(file);
+    rewind(file);
+
+    char* buffer = (char*)malloc((size_t)size + 1);
+    if (buffer == NULL) {
+        fclose(file);
+        return NULL;
+    }
+    size_t read = fread(buffer, 1, (size_t)size, file);
+    buffer[read] = '\0';
+    fclose(file);
+    return buffer;
+}
+
+/**
+ * @brief Many small functions and a call to each: mostly front-end and
+ * compile work, little run time.
+ */
+static char* large_source(void) {
+    size_t capacity = (size_t)LARGE_SOURCE_FUNCTIONS * 192 + 64;
+    char* source = (char*)malloc(capacity);
+    if (source == NULL) return NULL;
+
+    size_t length = 0;
+    for (int i = 0; i < LARGE_SOURCE_FUNCTIONS; i++) {
+        length += (size_t)snprintf(source + length, capacity - length,
+            "func f%d(a, b): int {\n"
+            "    var x = a + b * %d;\n"
+            "    if x > %d { return x - 1; }\n"
+            "    return x + 1;\n"
+            "}\n", i, i % 7 + 1, i % 100);
+    }
+    length += (size_t)snprintf(source + length, capacity - length, "var total = 0;\n");
+    for (int i = 0; i < LARGE_SOURCE_FUNCTIONS; i++) {
+        length += (size_t)snprintf(source + length, capacity - length,
+                                   "total = total + f%d(%d, 2);\n", i, i % 13);
+    }
+    snprintf(source + length, capacity - length, "print total;\n");
+    return source;
+}
+
+/**
+ * @brief Keyword- and identifier-dense code with short tokens: mostly
+ * lexing and keyword lookup.
+ */
+static char* token_dense_source(void) {
+    size_t capacity = (size_t)TOKEN_DENSE_FUNCTIONS * 320 + 64;
+    char* source = (char*)malloc(capacity);
+    if (source == NULL) return NULL;
+
+    size_t length = 0;
+    for (int i = 0; i < TOKEN_DENSE_FUNCTIONS; i++) {
+        length += (size_t)snprintf(source + length, capacity - length,
+            "func k%d(a, b): bool {\n"
+            "    var c = a; var d = b; var e = true; var f = false;\n"
+            "    if c > d { return e; } elif c == d { return f; } else { c = c + 1; }\n"
+            "    while f { print c; c = c - 1; }\n"
+            "    return c < d;\n"
+            "}\n"
+            "func s%d(): str { return \"s\"; }\n"
+            "func v%d(): void { var x = 1; if x > 0 { x = 0; } }\n", i, i, i);
+    }
+    snprintf(source + length, capacity - length, "print k0(1, 2);\n");
+    return source;
+}
+
+typedef struct {
+    const char* name;
+    char* (*generate)(void);
+} SyntheticWorkload;
+
+static const SyntheticWorkload syntheticWorkloads[] = {
+    { "large_source", large_source },
+    { "token_dense",  token_dense_source },
+};
+
+#define SYNTHETIC_COUNT ((int)(sizeof(syntheticWorkloads) / sizeof(syntheticWorkloads[0])))
+
+// --- Timing ---
+
+static void lex_all(const char* source) {
+    Lexer lexer = init_lexer(source);
+    for (;;) {
+        Token token = get_next_token(&lexer);
+        if (token.type == TOKEN_EOF || token.type == TOKEN_ERROR) break;
+    }
+}
+
+static int silence_stdout(void) {
+    fflush(stdout);
+    int saved = dup(fileno(stdout));
+    FILE* sink = freopen(NULL_DEVICE, "w", stdout);
+    (void)sink;
+    return saved;
+}
+
+static void restore_stdout(int saved) {
+    fflush(stdout);
+    if (saved < 0) return;
+    dup2(saved, fileno(stdout));
+    close(saved);
+}
+
+/**
+ * @brief One pass of the whole pipeline on a fresh VM.
+ */
+static void run_once(const char* source, BenchResult* result) {
+    memset(result, 0, sizeof(*result));
+    result->status = "compile_error";
+
+    init_vm();
+    init_typechecker();
+    init_compiler();
+    vm_define_core_natives(&vm);
+
+    uint64_t start = vm_monotonic_ns();
+    lex_all(source);
+    uint64_t lexed = vm_monotonic_ns();
+    result->phaseNs[PHASE_LEX] = lexed - start;
+
+    int saved = silence_stdout(); // Diagnostics and program output
+    AstNode* ast = parse(source, 0);
+    uint64_t parsed = vm_monotonic_ns();
+    result->phaseNs[PHASE_PARSE] = parsed - lexed;
+
+    ObjFunction* function = NULL;
+    if (ast != NULL) {
+        int valid = typecheck_ast(ast);
+        uint64_t checked = vm_monotonic_ns();
+        result->phaseNs[PHASE_TYPECHECK] = checked - parsed;
+
+        if (valid) {
+            optimize_ast(ast, optLevel);
+            uint64_t optimized = vm_monotonic_ns();
+            result->phaseNs[PHASE_OPTIMIZE] = optimized - checked;
+
+            function = compile_ast(ast);
+            result->phaseNs[PHASE_COMPILE] = vm_monotonic_ns() - optimized;
+        }
+    }
+
+    if (function != NULL) {
+        uint64_t running = vm_monotonic_ns();
+        InterpretResult status = interpret(function);
+        result->phaseNs[PHASE_RUN] = vm_monotonic_ns() - running;
+        result->status = status == INTERPRET_OK ? "ok" : "runtime_error";
+    }
+    vm_flush_output(&vm); // Into the sink, not the report
+    restore_stdout(saved);
+
+    for (int phase = 0; phase < PHASE_COUNT; phase++) result->totalNs += result->phaseNs[phase];
+    result->gc = vm.gcStats;
+
+    if (ast != NULL) free_ast(ast);
+    free_typechecker();
+    free_global_symbols();
+    free_vm();
+}
+
+/**
+ * @brief Best time of each phase (and of the total) over `runs` passes.
+ */
+static void bench(const char* source, int runs, BenchResult* best) {
+    memset(best, 0, sizeof(*best));
+    for (int i = 0; i < runs; i++) {
+        BenchResult result;
+        run_once(source, &result);
+        if (i == 0) {
+            *best = result;
+            continue;
+        }
+        for (int phase = 0; phase < PHASE_COUNT; phase++) {
+            if (result.phaseNs[phase] < best->phaseNs[phase]) best->phaseNs[phase] = result.phaseNs[phase];
+        }
+        if (result.totalNs < best->totalNs) best->totalNs = result.totalNs;
+        best->gc = result.gc;
+        best->status = result.status;
+    }
+}
+
+// --- JSON ---
+
+static void write_json_string(FILE* out, const char* text) {
+    fputc('"', out);
+    for (const char* c = text; *c != '\0'; c++) {
+        if (*c == '"' || *c == '\\') fprintf(out, "\\%c", *c);
+        else if ((unsigned char)*c < 0x20) fprintf(out, "\\u%04x", (unsigned char)*c);
+        else fputc(*c, out);
+    }
+    fputc('"', out);
+}
+
+static void write_workload(FILE* out, const char* name, const char* file, size_t bytes,
+                           const BenchResult* result, int last) {
+    fprintf(out, "    {\"name\": ");
+    write_json_string(out, name);
+    fprintf(out, ", \"file\": ");
+    write_json_string(out, file);
+    fprintf(out, ", \"bytes\": %zu, \"status\": \"%s\",\n     ", bytes, result->status);
+    for (int phase = 0; phase < PHASE_COUNT; phase++) {
+        fprintf(out, "\"%s_ms\": %.3f, ", phaseNames[phase], result->phaseNs[phase] / 1e6);
+    }
+    fprintf(out, "\"total_ms\": %.3f,\n", result->totalNs / 1e6);
+
+    const GcStats* gc = &result->gc;
+    fprintf(out, "     \"gc\": {\"collections\": %llu, \"minor\": %llu, \"slices\": %llu, "
+                 "\"pause_ms\": %.3f, \"max_pause_ms\": %.3f, \"freed_bytes\": %llu, "
+                 "\"promoted_bytes\": %llu, \"peak_bytes\": %zu}}%s\n",
+            (unsigned long long)gc->collections, (unsigned long long)gc->minorCollections,
+            (unsigned long long)gc->slices, gc->totalPauseNs / 1e6, gc->maxPauseNs / 1e6,
+            (unsigned long long)gc->bytesFreed, (unsigned long long)gc->bytesPromoted,
+            gc->peakBytesAllocated, last ? "" : ",");
+}
+
+static const char* workload_name(const char* path, char* buffer, size_t size) {
+    const char* base = path;
+    for (const char* c = path; *c != '\0'; c++) {
+        if (*c == '/' || *c == '\\') base = c + 1;
+    }
+    snprintf(buffer, size, "%s", base);
+    char* ext = strrchr(buffer, '.');
+    if (ext != NULL && strcmp(ext, ".det") == 0) *ext = '\0';
+    return buffer;
+}
+
+static void usage(void) {
+    fprintf(stderr, "Usage: determa_bench [-n runs] [-O] [-r] [-j] [-o out.json] [file.det ...]\n");
+    exit(64);
+}
+
+int main(int argc, char* argv[]) {
+    int runs = 5;
+    int registerVM = 0;
+    int jit = 0;
+    const char* outPath = NULL;
+    int fileCount = 0;
+    const char** files = (const char**)malloc(sizeof(char*) * (argc > 1 ? argc : 1));
+    if (files == NULL) return 1;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-n") == 0) {
+            if (i + 1 >= argc || (runs = atoi(argv[++i])) <= 0) usage();
+        } else if (strcmp(argv[i], "-o") == 0) {
+            if (i + 1 >= argc) usage();
+            outPath = argv[++i];
+        } else if (strcmp(argv[i], "-O") == 0 || strcmp(argv[i], "-O1") == 0) {
+            optLevel = OPT_LEVEL_FOLD;
+        } else if (strcmp(argv[i], "-r") == 0) {
+            registerVM = 1;
+        } else if (strcmp(argv[i], "-j") == 0) {
+            jit = 1;
+        } else if (argv[i][0] == '-') {
+            usage();
+        } else {
+            files[fileCount++] = argv[i];
+        }
+    }
+
+    set_vm_register_backend(registerVM);
+    set_vm_jit(jit);
+
+    FILE* out = stdout;
+    if (outPath != NULL && (out = fopen(outPath, "w")) == NULL) {
+        fprintf(stderr, "Could not open '%s' for writing.\n", outPath);
+        return 1;
+    }
+
+    fprintf(out, "{\n  \"version\": ");
+    write_json_string(out, VERSION_FULL);
+    fprintf(out, ",\n  \"runs\": %d,\n  \"opt_level\": %d,\n  \"register_vm\": %d,\n  \"jit\": %d,\n  \"workloads\": [\n",
+            runs, optLevel, registerVM, jit && jit_available());
+
+    int failed = 0;
+    int workloadCount = fileCount + SYNTHETIC_COUNT;
+    for (int i = 0; i < workloadCount; i++) {
+        const SyntheticWorkload* synthetic = i >= fileCount ? &syntheticWorkloads[i - fileCount] : NULL;
+        char* source = synthetic ? synthetic->generate() : read_file(files[i]);
+        const char* file = synthetic ? "<generated>" : files[i];
+        if (source == NULL) {
+            fprintf(stderr, "Could not read '%s'.\n", file);
+            failed = 1;
+            continue;
+        }
+
+        char name[256];
+        BenchResult result;
+        fprintf(stderr, "bench: %s\n", file);
+        bench(source, runs, &result);
+        if (strcmp(result.status, "ok") != 0) failed = 1;
+        write_workload(out, synthetic ? synthetic->name : workload_name(file, name, sizeof(name)),
+                       file, strlen(source), &result, i == workloadCount - 1);
+        free(source);
+    }
+
+    fprintf(out, "  ]\n}\n");
+    if (out != stdout) fclose(out);
+    free(files);
+    return failed;
+}
@@ -0,0 +1,66 @@
+#!/bin/bash
+# Determa VM benchmark harness.
+#
+# Builds optimized (-O2) variants of the interpreter and reports the best
+# wall-clock time of each workload in bench/*.det for every variant.
+#
+# Usage: bash bench/run_bench.sh [runs]
+#
+# Variants (override with VARIANTS="..."):
+#   switch    portable switch dispatch (-DDETERMA_NO_COMPUTED_GOTO)
+#   threaded  computed-goto dispatch (default on GCC/Clang)
+#   compact   threaded + 8-byte pointer-tagged Values (-DDETERMA_COMPACT_VALUES)
+
+set -e
+cd "$(dirname "$0")/.."
+
+CC="${CC:-gcc}"
+CFLAGS="-O2 -DNDEBUG"
+RUNS="${1:-5}"
+OUT_DIR="bin/bench"
+
+# Keep the source list in sync with build.sh
+LIB_SOURCES=$(grep '^LIB_SOURCES=' build.sh | cut -d'"' -f2)
+
+VARIANTS="${VARIANTS:-switch threaded compact}"
+
+variant_flags() {
+    case "$1" in
+        switch)   echo "-DDETERMA_NO_COMPUTED_GOTO" ;;
+        threaded) echo "" ;;
+        compact)  echo "-DDETERMA_COMPACT_VALUES" ;;
+    esac
+}
+
+mkdir -p "$OUT_DIR"
+
+for v in $VARIANTS; do
+    echo "Building $v..."
+    $CC $CFLAGS $(variant_flags "$v") src/main.c $LIB_SOURCES -Iinclude -o "$OUT_DIR/determa_$v"
+done
+
+# Best-of-N wall time in milliseconds
+best_ms() {
+    local exe="$1" file="$2" best="" start end ms
+    for _ in $(seq "$RUNS"); do
+        start=$(date +%s%N)
+        "$exe" "$file" > /dev/null
+        end=$(date +%s%N)
+        ms=$(( (end - start) / 1000000 ))
+        if [ -z "$best" ] || [ "$ms" -lt "$best" ]; then best=$ms; fi
+    done
+    echo "$best"
+}
+
+echo ""
+printf "%-16s" "workload"
+for v in $VARIANTS; do printf "%14s" "$v (ms)"; done
+echo ""
+
+for f in bench/*.det; do
+    printf "%-16s" "$(basename "$f" .det)"
+    for v in $VARIANTS; do
+        printf "%14s" "$(best_ms "$OUT_DIR/determa_$v" "$f")"
+    done
+    echo ""
+done
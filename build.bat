@@ -14,6 +14,7 @@ SET INCLUDES=^
 REM --- Target Executables ---
 SET COMPILER_EXE=bin\determa.exe
 SET TEST_RUNNER_EXE=bin\determa_test.exe
+SET BENCH_EXE=bin\determa_bench.exe
 
 REM --- Ensure bin directory exists ---
 if not exist bin mkdir bin
@@ -25,8 +26,13 @@ SET FRONTEND_SOURCES= ^
     src\token.c ^
     src\parser.c ^
     src\ast.c ^
+    src\arena.c ^
+    src\file_map.c ^
     src\symbol.c ^
+    src\name_table.c ^
     src\typechecker.c ^
+    src\optimizer.c ^
+    src\thread_pool.c ^
     src\cli.c
 
 REM 2. Backend (VM, Bytecode, Compiler) - In src/vm/
@@ -37,7 +43,20 @@ SET BACKEND_SOURCES= ^
     src\vm\compiler.c ^
     src\vm\value.c ^
     src\vm\object.c ^
-    src\vm\memory.c
+    src\vm\memory.c ^
+    src\vm\natives.c ^
+    src\vm\peephole.c ^
+    src\vm\profiler.c ^
+    src\vm\serialize.c ^
+    src\vm\regcode.c ^
+    src\vm\jit.c ^
+    src\vm\verify.c ^
+    src\vm\output.c ^
+    src\vm\table.c ^
+    src\vm\disassembler.c ^
+    src\vm\trace.c ^
+    src\vm\alloc_profiler.c ^
+    src\vm\memo.c
 
 REM Combine Lib Sources
 SET LIB_SOURCES=%FRONTEND_SOURCES% %BACKEND_SOURCES%
@@ -55,12 +74,28 @@ SET TEST_SOURCES=^
     tests\parser\test_parser.c ^
     tests\parser\test_compound.c^
     tests\typechecker\test_typechecker.c ^
+    tests\optimizer\test_optimizer.c ^
     tests\vm\test_vm.c ^
     tests\vm\test_gc.c^
     tests\vm\test_locals.c^
+    tests\vm\test_peephole.c ^
+    tests\vm\test_serialize.c ^
+    tests\vm\test_regcode.c ^
+    tests\vm\test_jit.c ^
+    tests\vm\test_verify.c ^
+    tests\vm\test_threads.c ^
+    tests\vm\test_disassembler.c ^
+    tests\vm\test_trace.c ^
+    tests\vm\test_memo.c ^
+    tests\vm\test_perf.c ^
     tests\functions\test_functions.c^
     %LIB_SOURCES%
 
+REM Source for the benchmark driver (built optimized)
+SET BENCH_SOURCES=^
+    bench\determa_bench.c ^
+    %LIB_SOURCES%
+
 REM --- Compilation Step ---
 echo Compiling Determa Compiler (%COMPILER_EXE%)...
 %CC% %CFLAGS% ^
@@ -93,6 +128,22 @@ if %errorlevel% neq 0 (
 )
 echo Compilation successful
 echo.
+
+echo Compiling Determa Benchmark Driver (%BENCH_EXE%)...
+%CC% -Wall -Wextra -O2 ^
+    %BENCH_SOURCES% ^
+    -o %BENCH_EXE% ^
+    -Iinclude
+
+if %errorlevel% neq 0 (
+    echo.
+    echo ===============================
+    echo  BENCHMARK DRIVER BUILD FAILED!
+    echo ===============================
+    goto :eof
+)
+echo Compilation successful
+echo.
 echo =======================
 echo  ALL BUILDS SUCCESSFUL
 echo =======================
@@ -3,7 +3,7 @@ set -e # Exit immediately if a command exits with a non-zero status.
 
 # --- Config ---
 CC="gcc"
-CFLAGS="-Wall -Wextra -g"
+CFLAGS="-Wall -Wextra -g -pthread"
 INCLUDES="-Iinclude -Itests/include"
 
 # Ensure bin directory exists
@@ -11,17 +11,22 @@ mkdir -p bin
 
 COMPILER_EXE="bin/determa"
 TEST_RUNNER_EXE="bin/determa_test"
+BENCH_EXE="bin/determa_bench"
 
 # --- Source Files ---
 
 # 1. Core Library
-LIB_SOURCES="src/lexer.c src/token.c src/parser.c src/ast.c src/cli.c src/symbol.c src/typechecker.c src/vm/chunk.c src/vm/vm.c src/vm/compiler.c src/vm/value.c src/vm/object.c src/vm/memory.c"
+LIB_SOURCES="src/lexer.c src/token.c src/parser.c src/ast.c src/arena.c src/file_map.c src/cli.c src/thread_pool.c src/symbol.c src/name_table.c src/typechecker.c src/optimizer.c src/vm/chunk.c src/vm/vm.c src/vm/compiler.c src/vm/value.c src/vm/object.c src/vm/memory.c src/vm/natives.c src/vm/peephole.c src/vm/profiler.c src/vm/serialize.c src/vm/regcode.c src/vm/jit.c src/vm/verify.c src/vm/output.c src/vm/table.c src/vm/disassembler.c src/vm/trace.c src/vm/alloc_profiler.c src/vm/memo.c"
 
 # 2. Compiler Source
 COMPILER_SOURCES="src/main.c $LIB_SOURCES"
 
 # 3. Test Source
-TEST_SOURCES="tests/test_runner.c tests/test.c tests/lexer/test_lexer.c tests/parser/test_parser.c tests/parser/test_compound.c tests/typechecker/test_typechecker.c tests/vm/test_vm.c tests/vm/test_locals.c tests/vm/test_gc.c tests/functions/test_functions.c $LIB_SOURCES"
+TEST_SOURCES="tests/test_runner.c tests/test.c tests/lexer/test_lexer.c tests/parser/test_parser.c tests/parser/test_compound.c tests/typechecker/test_typechecker.c tests/optimizer/test_optimizer.c tests/vm/test_vm.c tests/vm/test_locals.c tests/vm/test_gc.c tests/vm/test_peephole.c tests/vm/test_serialize.c tests/vm/test_regcode.c tests/vm/test_jit.c tests/vm/test_verify.c tests/vm/test_threads.c tests/vm/test_disassembler.c tests/vm/test_trace.c tests/vm/test_memo.c tests/vm/test_perf.c tests/functions/test_functions.c $LIB_SOURCES"
+
+# 4. Benchmark Driver (built optimized: its timings are what we compare)
+BENCH_SOURCES="bench/determa_bench.c $LIB_SOURCES"
+BENCH_CFLAGS="-Wall -Wextra -O2 -pthread"
 
 # --- Compilation Step ---
 
@@ -31,6 +36,9 @@ $CC $CFLAGS $COMPILER_SOURCES -o $COMPILER_EXE -Iinclude
 echo "Compiling Determa Test Runner ($TEST_RUNNER_EXE)..."
 $CC $CFLAGS $TEST_SOURCES -o $TEST_RUNNER_EXE $INCLUDES
 
+echo "Compiling Determa Benchmark Driver ($BENCH_EXE)..."
+$CC $BENCH_CFLAGS $BENCH_SOURCES -o $BENCH_EXE -Iinclude
+
 echo "======================="
 echo " ALL BUILDS SUCCESSFUL"
 echo "======================="
@@ -0,0 +1,73 @@
+/**
+ * @file arena.h
+ * @brief Bump-pointer arena allocator.
+ *
+ * An arena hands out memory from large blocks and releases everything in
+ * one call. The parser builds each AST into its own arena, so freeing a
+ * tree is a single arena_free() instead of a recursive walk, and nodes
+ * created together sit next to each other in memory.
+ *
+ * @version 0.1
+ * @date 2026-10-14
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+/**
+ * @struct ArenaBlock
+ * @brief One chunk of arena memory; blocks form a singly linked list (newest first).
+ */
+typedef struct ArenaBlock {
+    struct ArenaBlock* next;
+    size_t used;        // Bytes handed out from data[]
+    size_t capacity;    // Size of data[]
+    unsigned char data[];
+} ArenaBlock;
+
+/**
+ * @struct Arena
+ * @brief The allocator state.
+ */
+typedef struct {
+    ArenaBlock* head;   // Block currently being bumped
+    size_t bytesUsed;   // Total bytes handed out (for diagnostics)
+} Arena;
+
+/**
+ * @brief Initializes an empty arena (no memory is reserved until the first allocation).
+ */
+void arena_init(Arena* arena);
+
+/**
+ * @brief Allocates `size` bytes, suitably aligned for any node type.
+ * @return Pointer to the memory, or NULL if the system is out of memory.
+ */
+void* arena_alloc(Arena* arena, size_t size);
+
+/**
+ * @brief Grows an allocation made from this arena.
+ *
+ * If `pointer` is the most recent allocation and the block has room it is
+ * extended in place; otherwise a new region is allocated and the old
+ * contents copied (the old region is reclaimed with the arena).
+ */
+void* arena_grow(Arena* arena, void* pointer, size_t oldSize, size_t newSize);
+
+/**
+ * @brief Forgets every allocation but keeps the newest block, so a scratch
+ * arena reused for one job after another stops calling malloc.
+ */
+void arena_reset(Arena* arena);
+
+/**
+ * @brief Releases every block owned by the arena and resets it.
+ */
+void arena_free(Arena* arena);
+
+#endif // ARENA_H
@@ -17,6 +17,7 @@
 
 #include "token.h"
 #include "types.h"
+#include "arena.h"
 
 /**
  * @enum AstNodeType
@@ -59,7 +60,9 @@ typedef enum {
  */
 typedef struct AstNode {
     AstNodeType type;
-    int line;           // Line number for debugging information
+    int line;               // Line number for debugging information
+    DataType resolvedType;  // Type proven by the typechecker (TYPE_ERROR = unproven)
+    int inArena;            // 1 if allocated from an Arena (released with it, never freed alone)
 } AstNode;
 
 
@@ -75,6 +78,8 @@ typedef struct {
     AstNode** statements;   // Dynamic array of statement nodes
     int statement_count;    // Number of statements in the program
     int capacity;           // Required for dynamic array growth
+    Arena* arena;           // Arena holding every node of the tree (NULL if malloc'd)
+    int ownsArena;          // 1 if free_ast() releases `arena` (0: the parser's caller reuses it)
 } AstNodeProgram;
 
 
@@ -103,10 +108,16 @@ typedef struct {
 /**
  * @brief Represents a string literal (e.g., "hello")
  * @struct AstNodeStringLiteral
+ *
+ * `chars` is a slice of the source text (quotes stripped, not
+ * NUL-terminated), so the source must outlive the tree. Only strings the
+ * optimizer builds by folding own their bytes.
  */
 typedef struct {
     AstNode node;
-    char* value; // Null-terminated string content (quotes stripped)
+    const char* chars;  // String content (length bytes, no terminator)
+    int length;
+    int ownsChars;      // 1 if `chars` was malloc'd for this node (freed with it)
 } AstNodeStringLiteral;
 
 
@@ -249,6 +260,29 @@ typedef struct {
 } AstNodeCall;
 
 
+// ========================
+// --- Allocation ---
+// ========================
+
+/**
+ * @brief Route every following node (and node-owned array/string) allocation
+ * into `arena`. Pass NULL to go back to one malloc per node.
+ *
+ * Nodes of one tree must all come from the same arena, so anything that
+ * adds nodes to a parsed tree (the optimizer) activates its program's arena.
+ *
+ * @return Arena* The previously active arena, to restore afterwards.
+ */
+Arena* ast_use_arena(Arena* arena);
+
+/**
+ * @brief malloc()/realloc() replacements for memory owned by AST nodes
+ * (statement arrays, call arguments, parameters, string literal values).
+ */
+void* ast_alloc(size_t size);
+void* ast_realloc(void* pointer, size_t oldSize, size_t newSize);
+
+
 // ========================
 // --- Helper Functions ---
 // ========================
@@ -322,7 +356,7 @@ AstNode* new_int_literal_node(int value, int line);
 /**
  * @brief Creates a new String literal AST node
  */
-AstNode* new_string_literal_node(char* value, int line);
+AstNode* new_string_literal_node(const char* chars, int length, int line);
 
 /**
  * @brief Creates a new boolean literal ast node
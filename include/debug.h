@@ -18,11 +18,13 @@
 
 #include <stdio.h>
 
+#include "tls.h"
+
 // --- PDA Debug Tracing ---
 
-// This global will be set by the parser
-extern int pda_debug_enabled;
-extern int pda_debug_indent;
+// This global will be set by the parser (per thread, like the parser itself)
+extern DETERMA_THREAD_LOCAL int pda_debug_enabled;
+extern DETERMA_THREAD_LOCAL int pda_debug_indent;
 
 /**
  * @brief Prints an indented trace message
@@ -0,0 +1,51 @@
+/**
+ * @file file_map.h
+ * @brief Read-only view of a whole file, memory-mapped where possible.
+ *
+ * Scripts are lexed straight out of the view: tokens and AST nodes point
+ * into it, so nothing is copied and a large script costs its page-cache
+ * pages rather than a second heap buffer. The bytecode cache loader uses
+ * the same view.
+ *
+ * The view is always followed by a NUL byte (the lexer's end marker). A
+ * mapping gets it for free from the zero-filled tail of its last page;
+ * when the file fills its last page exactly, the page after it is
+ * reserved as well (POSIX) or the file is read into the heap instead.
+ *
+ * The file must not be truncated while it is mapped.
+ *
+ * @version 0.1
+ * @date 2026-10-14
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+
+#ifndef FILE_MAP_H
+#define FILE_MAP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * @struct FileMap
+ * @brief An open view (close it with file_map_close()).
+ */
+typedef struct {
+    const char* data;       // `length` bytes of the file, then a NUL
+    size_t length;
+    size_t mappedLength;    // Bytes to unmap (0 = heap buffer)
+} FileMap;
+
+/**
+ * @brief Map (or read) the file at `path`.
+ * @return false if it could not be opened or read.
+ */
+bool file_map_open(FileMap* map, const char* path);
+
+/**
+ * @brief Release the view; pointers into it become invalid.
+ */
+void file_map_close(FileMap* map);
+
+#endif // FILE_MAP_H
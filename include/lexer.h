@@ -27,6 +27,7 @@ typedef struct {
     int start;           // Index of the start of the current lexeme
     int current;         // Index of the current character being processed
     int line;            // The current line number for error reporting
+    int length;          // strlen(source): block scans never read past it
 } Lexer;
 
 
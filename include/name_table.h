@@ -0,0 +1,68 @@
+/**
+ * @file name_table.h
+ * @brief Open-addressing hash table from identifier text to an integer.
+ *
+ * Shared by the typechecker's SymbolTable and the compiler's global/local
+ * resolution, replacing their linear scans. The table only maps a name to
+ * its *newest* binding (an index into the owner's own array); owners keep
+ * shadowing by storing, in each binding, the index of the binding it hides,
+ * and restore that entry when a scope is popped.
+ *
+ * Keys are not copied: the caller guarantees the name memory outlives the
+ * entry (name_table_set() may be called again to repoint the key).
+ *
+ * @version 0.1
+ * @date 2026-10-14
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+
+#ifndef NAME_TABLE_H
+#define NAME_TABLE_H
+
+#include <stdint.h>
+
+/**
+ * @struct NameEntry
+ * @brief One slot. name == NULL marks an empty slot (value -1) or a
+ * tombstone (value -2).
+ */
+typedef struct {
+    const char* name;
+    int length;
+    uint32_t hash;
+    int value;
+} NameEntry;
+
+/**
+ * @struct NameTable
+ * @brief The table (capacity is zero or a power of two).
+ */
+typedef struct {
+    int count;          // Live entries + tombstones
+    int capacity;
+    NameEntry* entries;
+} NameTable;
+
+void name_table_init(NameTable* table);
+void name_table_free(NameTable* table);
+
+/**
+ * @brief Look a name up.
+ * @return The stored value, or -1 if the name is not bound.
+ */
+int name_table_get(const NameTable* table, const char* name, int length);
+
+/**
+ * @brief Bind `name` to `value` (value must be >= 0), replacing any
+ * previous binding and repointing the key at `name`.
+ */
+void name_table_set(NameTable* table, const char* name, int length, int value);
+
+/**
+ * @brief Remove the binding for `name`, if any.
+ */
+void name_table_delete(NameTable* table, const char* name, int length);
+
+#endif // NAME_TABLE_H
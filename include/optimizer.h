@@ -0,0 +1,41 @@
+/**
+ * @file optimizer.h
+ * @brief Public API for the AST optimization pass.
+ *
+ * Runs between typecheck_ast() and compile_ast(). Folds constant
+ * expressions over literals and prunes if/while branches whose condition
+ * is a constant boolean.
+ *
+ * @version 0.1
+ * @date 2026-10-14
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+
+#ifndef OPTIMIZER_H
+#define OPTIMIZER_H
+
+#include "ast.h"
+
+/**
+ * @brief Optimization levels accepted by optimize_ast() (CLI: -O0 / -O1).
+ */
+typedef enum {
+    OPT_LEVEL_NONE = 0,     // -O0: compile the AST as written (default)
+    OPT_LEVEL_FOLD = 1      // -O1 / -O: constant folding + dead-branch elimination
+} OptLevel;
+
+/**
+ * @brief Optimizes a type-checked AST in place.
+ *
+ * Folding never changes observable behaviour: operations that would fail
+ * at runtime (division by zero, int overflow, mismatched operand types in
+ * unchecked function bodies) are left for the VM to report.
+ *
+ * @param root  The root of the AST (typically NODE_PROGRAM).
+ * @param level The optimization level; OPT_LEVEL_NONE leaves the tree untouched.
+ */
+void optimize_ast(AstNode* root, int level);
+
+#endif // OPTIMIZER_H
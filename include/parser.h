@@ -24,4 +24,13 @@
  */
 AstNode* parse(const char* source, int pda_debug_mode);
 
+/**
+ * @brief Like parse(), but builds the tree in the caller's `arena`.
+ *
+ * free_ast() then leaves the tree's memory alone: the caller releases it
+ * with the arena (arena_reset() to reuse it for the next parse). The tree
+ * must be gone before then.
+ */
+AstNode* parse_in_arena(const char* source, int pda_debug_mode, Arena* arena);
+
 #endif // PARSER_H
\ No newline at end of file
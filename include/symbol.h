@@ -15,16 +15,19 @@
 #define SYMBOL_H
 
 #include "types.h"
+#include "name_table.h"
+#include "arena.h"
 
 /**
  * @struct Symbol
  * @brief Represents a single variable in the table
  */
 typedef struct {
-    const char* name;  // Variable name
+    const char* name;  // Variable name (borrowed from the source, or adopted; not owned)
     int name_len;      // Length of name
     DataType type;     // The type of the variable
     int depth;         // Scope depth (0 = global, 1 = function/block, etc.)
+    int shadowed;      // Index of the same-named symbol this one hides (-1 if none)
 } Symbol;
 
 /**
@@ -36,6 +39,7 @@ typedef struct {
     int count;         // Current number of symbols
     int capacity;      // Allocated capacity
     int current_depth; // Current scope depth
+    NameTable index;   // Name -> index of its newest (innermost) symbol
 } SymbolTable;
 
 // ================
@@ -63,6 +67,17 @@ void symbol_table_enter_scope(SymbolTable* table);
  */
 void symbol_table_exit_scope(SymbolTable* table);
 
+/**
+ * @brief Removes every symbol after the first `count` (newest first)
+ */
+void symbol_table_truncate(SymbolTable* table, int count);
+
+/**
+ * @brief Copies the names of the symbols from index `first` on into
+ * `arena`, so they outlive the source they were borrowed from
+ */
+void symbol_table_adopt_names(SymbolTable* table, int first, Arena* arena);
+
 /**
  * @brief Defines a new variable in the current scope
  * @return 1 on success, 0 if variable already exists in *current* scope
@@ -0,0 +1,73 @@
+/**
+ * @file thread_pool.h
+ * @brief Fixed-size worker thread pool with work stealing.
+ *
+ * thread_pool_run() hands out the indices 0..count-1 of a parallel loop.
+ * Each worker starts with an even, contiguous share of them and runs its
+ * share front to back; a worker that runs out steals the back half of
+ * the largest remaining share. Long tasks therefore only hold up the
+ * worker running them, and the others drain the rest of the loop.
+ *
+ * The calling thread takes part as worker 0: a pool of n workers starts
+ * n - 1 threads, and a pool of one runs everything on the caller. The
+ * threads sleep between runs and live until thread_pool_free().
+ *
+ * Tasks must not call thread_pool_run() on the pool that runs them.
+ *
+ * @version 0.1
+ * @date 2026-10-14
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+/**
+ * @brief One iteration of a parallel loop.
+ *
+ * @param context The pointer given to thread_pool_run().
+ * @param index   The iteration, 0..count-1 (each is run exactly once).
+ * @param worker  The worker running it, 0..thread_pool_size()-1; no two
+ *                tasks run on the same worker at the same time.
+ */
+typedef void (*PoolTask)(void* context, int index, int worker);
+
+typedef struct ThreadPool ThreadPool;
+
+/**
+ * @brief Number of processors online (at least 1).
+ */
+int thread_pool_cpu_count(void);
+
+/**
+ * @brief Start a pool of `workers` workers (<= 0: one per processor).
+ *
+ * @return The pool, or NULL when out of memory. If not every thread
+ *         starts, the pool keeps the ones that did.
+ */
+ThreadPool* thread_pool_new(int workers);
+
+/**
+ * @brief Number of workers, the calling thread included.
+ */
+int thread_pool_size(const ThreadPool* pool);
+
+/**
+ * @brief Run `task` for every index in 0..count-1 and return once all of
+ * them are done.
+ */
+void thread_pool_run(ThreadPool* pool, int count, PoolTask task, void* context);
+
+/**
+ * @brief Stop and join the worker threads, then free the pool.
+ */
+void thread_pool_free(ThreadPool* pool);
+
+/**
+ * @brief Give up the processor (for tasks spinning on one another).
+ */
+void thread_pool_yield(void);
+
+#endif // THREAD_POOL_H
@@ -0,0 +1,28 @@
+/**
+ * @file tls.h
+ * @brief Thread-local storage qualifier.
+ *
+ * Interpreter state that is not owned by a VM instance (the current VM,
+ * the compiler's and typechecker's tables, the active AST arena) is kept
+ * per thread, so independent scripts can be compiled and run on several
+ * threads at once.
+ *
+ * @version 0.1
+ * @date 2026-10-14
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+
+#ifndef TLS_H
+#define TLS_H
+
+#if defined(_MSC_VER)
+    #define DETERMA_THREAD_LOCAL __declspec(thread)
+#elif defined(__GNUC__)
+    #define DETERMA_THREAD_LOCAL __thread
+#else
+    #define DETERMA_THREAD_LOCAL _Thread_local
+#endif
+
+#endif // TLS_H
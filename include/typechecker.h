@@ -28,11 +28,97 @@ void init_typechecker();
  */
 void free_typechecker();
 
+/**
+ * @brief Records the return type of a function or native named `name`.
+ *
+ * Calls to it then infer that type (TYPE_VOID is treated as unknown). The
+ * name is copied; redeclaring replaces the previous signature.
+ */
+void typechecker_declare_function(const char* name, int length, DataType returnType);
+
+/**
+ * @brief What earlier units told the checker about global `name`: its
+ * variable type and its function's declared return type, each TYPE_ERROR
+ * when there is none (heap snapshots, see serialize.h).
+ */
+void typechecker_global_types(const char* name, int length, DataType* varType, DataType* returnType);
+
+/**
+ * @brief Declare a global restored from a heap snapshot, with the types
+ * typechecker_global_types() gave. Like every global of an earlier unit
+ * it is unproven. The name is copied.
+ */
+void typechecker_restore_global(const char* name, int length, DataType varType, DataType returnType);
+
 /**
  * @brief Runs the semantic analysis on the AST.
+ *
+ * Expressions whose static type also holds at runtime get their
+ * AstNode::resolvedType set; everything else is left as TYPE_ERROR.
+ *
  * @param root The root of the AST.
  * @return 1 if the program is semantically valid, 0 if there are errors.
  */
 int typecheck_ast(AstNode* root);
 
+// ========================
+// --- Fused Checking ---
+// ========================
+
+/*
+ * The same checks, driven by another walk (the compiler's, see
+ * compile_checked_ast()) instead of typecheck_ast()'s own: the caller visits
+ * the tree, passes each node's operand types in, and gets the node's type
+ * and resolvedType annotation back, so one traversal both checks and emits.
+ * Diagnostics are the ones typecheck_ast() prints.
+ */
+
+typedef struct TypeChecker TypeChecker;
+
+/**
+ * @brief Start checking the unit `root` (runs the unproven-name pre-pass).
+ */
+TypeChecker* typecheck_begin(AstNode* root);
+
+/**
+ * @brief Finish the unit and commit its globals.
+ * @return 1 if no type error was reported, 0 otherwise.
+ */
+int typecheck_end(TypeChecker* tc);
+
+/**
+ * @brief Type `expr` once its operands are checked, annotating resolvedType.
+ *
+ * @param operands The operands' types: unary {operand}, binary {left, right},
+ *                 assignment {value}; ignored for other nodes.
+ */
+DataType typecheck_resolve(TypeChecker* tc, AstNode* expr, const DataType* operands);
+
+/**
+ * @brief Check an assignment's target before its value.
+ * @return 0 (after reporting it) if the variable is undefined; the value is
+ * then not checked.
+ */
+int typecheck_assign_target(TypeChecker* tc, AstNodeVarAssign* assign);
+
+/**
+ * @brief Statement rules: declare a variable with its initializer's type,
+ * print a value, test an if/while condition.
+ */
+void typecheck_declare(TypeChecker* tc, AstNodeVarDecl* decl, DataType initType);
+void typecheck_print(TypeChecker* tc, DataType type);
+void typecheck_condition(TypeChecker* tc, AstNode* stmt, DataType conditionType);
+
+/**
+ * @brief Check top-level statements with the checker's own walk: a fused
+ * compile stopped by a compile error still reports the rest's type errors.
+ */
+void typecheck_statements(TypeChecker* tc, AstNode** statements, int count);
+
+/**
+ * @brief Block scopes.
+ */
+void typecheck_enter_scope(TypeChecker* tc);
+void typecheck_exit_scope(TypeChecker* tc);
+
 #endif // TYPECHECKER_H
\ No newline at end of file
@@ -0,0 +1,68 @@
+/**
+ * @file alloc_profiler.h
+ * @brief Allocation profiler (CLI: --profile-alloc).
+ *
+ * A VM created with allocation profiling on attaches this profiler as its
+ * tracer (trace.h). Every heap object and every other block the VM grows
+ * through vm_reallocate() (long string characters, tables, stacks) is
+ * charged to an allocation site: the instruction the top frame is running,
+ * read from its saved ip. The handlers that allocate save the ip first, so
+ * the site is exact. Allocations outside any frame (compiling, loading the
+ * cache) go to one site of their own. Each site also counts the collector
+ * pauses it started, so the report shows which lines drive GC pressure:
+ *
+ *   - per object type: objects and bytes
+ *   - per opcode:      objects, bytes and pauses
+ *   - per line:        the same, heaviest first (via the chunk's line table)
+ *
+ * Functions with sites stay alive (they are GC roots) so a freed
+ * function's address is never mistaken for a new one. Sites are looked up
+ * in an open-addressing table keyed by (function, offset), so a recorded
+ * allocation costs one hash probe.
+ */
+
+#ifndef VM_ALLOC_PROFILER_H
+#define VM_ALLOC_PROFILER_H
+
+#include <stdio.h>
+
+#include "vm/common.h"
+#include "vm/object.h"
+#include "vm/trace.h"
+
+// Object types, then one kind for the other blocks grown by vm_reallocate()
+#define ALLOC_KIND_BLOCK (OBJ_NATIVE + 1)
+#define ALLOC_KINDS (ALLOC_KIND_BLOCK + 1)
+
+/**
+ * @brief What one instruction allocated. Site 0 is "outside any frame".
+ */
+typedef struct {
+    ObjFunction* function;  // NULL for site 0
+    int offset;             // Saved ip - 1 (in the instruction; -1 on entry)
+    uint64_t objects;
+    uint64_t bytes;
+    uint64_t pauses;        // Collector pauses begun here
+} AllocSite;
+
+typedef struct AllocProfiler {
+    VmTracer tracer;            // Attached to the VM; `user` is the profiler
+    uint64_t kindObjects[ALLOC_KINDS];
+    uint64_t kindBytes[ALLOC_KINDS];
+
+    AllocSite* sites;
+    int siteCount;
+    int siteCapacity;
+    int* siteIndex;             // Open addressing: (function, offset) -> sites index (-1 empty)
+    int indexCapacity;
+} AllocProfiler;
+
+AllocProfiler* new_alloc_profiler(void);
+void free_alloc_profiler(AllocProfiler* profiler);
+
+/**
+ * @brief Print the type, opcode and line tables, heaviest first.
+ */
+void alloc_profiler_report(const AllocProfiler* profiler, FILE* out);
+
+#endif // VM_ALLOC_PROFILER_H
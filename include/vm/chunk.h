@@ -11,6 +11,16 @@
 #include "common.h"
 #include "value.h"
 
+/**
+ * @struct LineStart
+ * @brief One run of the line table: the bytes from `offset` up to the next
+ * run's offset all come from source line `line`.
+ */
+typedef struct {
+    int offset;
+    int line;
+} LineStart;
+
 /**
  * @struct Chunk
  * @brief A dynamic array of bytecode instructions.
@@ -19,8 +29,12 @@ typedef struct {
     int count;              // Number of bytes currently in use
     int capacity;           // Allocated capacity
     uint8_t* code;          // Pointer to the bytecode stream
-    int* lines;             // Array storing line numbers matching the bytecode (for debugging)
+    LineStart* lines;       // Run-length encoded line numbers (for errors), by ascending offset
+    int lineCount;
+    int lineCapacity;
     ValueArray constants;   // Pool of constants (numbers, strings) used in this chunk
+    int* constantIndex;     // Open addressing: constant -> pool index (-1 empty), NULL while the pool is small
+    int constantIndexCapacity;
 } Chunk;
 
 /**
@@ -42,9 +56,45 @@ void free_chunk(Chunk* chunk);
 void write_chunk(Chunk* chunk, uint8_t byte, int line);
 
 /**
- * @brief Adds a constant to the chunk's constant pool.
+ * @brief Record that the code from `offset` on comes from `line`. Offsets
+ * must not decrease; a run is only added when the line changes.
+ * write_chunk() does this itself, passes that rewrite the code rebuild the
+ * table with it (after setting lineCount to 0).
+ */
+void add_line(Chunk* chunk, int offset, int line);
+
+/**
+ * @brief The source line of the byte at `offset` (binary search over the
+ * runs), or 0 if the chunk has no line information.
+ */
+int get_line(const Chunk* chunk, int offset);
+
+/**
+ * @brief The most values the chunk's code holds on its frame at once,
+ * counted from the frame's base: `entryDepth` values on entry (the callee
+ * and its arguments), plus locals and temporaries, plus the callee slot a
+ * direct call opens under its arguments.
+ *
+ * One forward pass: the code is structured, so every instruction after an
+ * unconditional transfer is reached by a forward jump seen earlier (or is
+ * dead). Expects well-formed code (see verify.h).
+ */
+int chunk_stack_depth(const Chunk* chunk, int entryDepth);
+
+/**
+ * @brief Adds a constant to the chunk's constant pool, unless the pool
+ * already holds it: an int of the same value or the same object (strings
+ * are interned, so equal literals share one slot). Small pools are
+ * scanned, larger ones looked up through a hash index.
  * @return The index of the constant in the pool (to be used with OP_CONSTANT).
  */
 int add_constant(Chunk* chunk, Value value);
 
+/**
+ * @brief Adds a constant at the end of the pool even if it is already
+ * there (the cache loader restores pools index for index).
+ * @return The index of the new constant: the old count.
+ */
+int append_constant(Chunk* chunk, Value value);
+
 #endif // VM_CHUNK_H
\ No newline at end of file
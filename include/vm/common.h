@@ -10,7 +10,30 @@
 #include <stddef.h>
 #include <stdint.h>
 
-// Use this to toggle debug logging for the VM
-// #define DEBUG_TRACE_EXECUTION
+#include "tls.h" // DETERMA_THREAD_LOCAL
+
+// Number of distinct values a 1-byte / 2-byte operand can encode
+#define UINT8_COUNT (UINT8_MAX + 1)
+#define UINT16_COUNT (UINT16_MAX + 1)
+
+// Use computed-goto (direct-threaded) dispatch in the interpreter loop when
+// the compiler supports labels-as-values (GCC/Clang). Build with
+// -DDETERMA_NO_COMPUTED_GOTO to force the portable switch dispatch.
+#if defined(__GNUC__) && !defined(DETERMA_NO_COMPUTED_GOTO)
+    #define VM_COMPUTED_GOTO
+#endif
+
+// Compile hot functions to machine code (jit.h, CLI: --jit) where the code
+// templates apply: x86-64 with the System V calling convention and mmap().
+// Build with -DDETERMA_NO_JIT to leave the JIT out.
+#if defined(__x86_64__) && (defined(__linux__) || defined(__APPLE__)) && !defined(DETERMA_NO_JIT)
+    #define VM_JIT
+#endif
+
+// Use the compact single-word Value layout (see value.h) instead of the
+// tagged struct. Build with -DDETERMA_COMPACT_VALUES to enable.
+#ifdef DETERMA_COMPACT_VALUES
+    #define COMPACT_VALUES
+#endif
 
 #endif // VM_COMMON_H
\ No newline at end of file
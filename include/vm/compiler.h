@@ -33,6 +33,18 @@ void init_compiler();
  */
 ObjFunction* compile_ast(struct AstNode* ast);
 
+/**
+ * @brief Typecheck and compile an AST in one walk.
+ *
+ * Equivalent to typecheck_ast() followed by compile_ast() (same bytecode,
+ * same type errors), but each node is checked as it is compiled, halving
+ * the front end's tree traversals. Errors may be reported in a different
+ * order when a unit also has compile errors.
+ *
+ * @return The function, or NULL on a type or compile error.
+ */
+ObjFunction* compile_checked_ast(struct AstNode* ast);
+
 /**
  * @brief Compiles source code into a Function Object.
  * Handles parsing internally.
@@ -52,4 +64,17 @@ void mark_compiler_roots();
  */
 void free_global_symbols();
 
+/**
+ * @brief Global slot table accessors, used by the bytecode cache to save the
+ * name -> slot mapping and to restore it when cached code is loaded.
+ */
+int compiler_global_count(void);
+const char* compiler_global_name(int index, int* length);
+
+/**
+ * @brief Define (or look up) a global by name.
+ * @return The slot index, or -1 if the table is full.
+ */
+int compiler_define_global(const char* name, int length);
+
 #endif // VM_COMPILER_H
\ No newline at end of file
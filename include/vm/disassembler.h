@@ -0,0 +1,66 @@
+/**
+ * @file disassembler.h
+ * @brief Bytecode listings and size statistics (CLI: --dump-bytecode).
+ *
+ * disassemble_unit() prints every function of a compiled unit: the script
+ * and, recursively, each function found among the constants. Every
+ * instruction is listed with its offset, source line, decoded operands,
+ * jump targets and the constants it refers to. Each function ends with a
+ * summary line and an opcode histogram, and the unit ends with the totals,
+ * so two builds of the same script can be compared for the effect of the
+ * optimizer, the peephole pass or new superinstructions.
+ *
+ * This lists stack code as the compiler produced it (or the .detc cache
+ * restored it), before --unsafe-fast or --register-vm rewrite it.
+ */
+
+#ifndef VM_DISASSEMBLER_H
+#define VM_DISASSEMBLER_H
+
+#include <stdio.h>
+
+#include "vm/common.h"
+#include "vm/object.h"
+
+/**
+ * @brief Size of a chunk's code, as counted by bytecode_stats().
+ */
+typedef struct {
+    int instructions;
+    int bytes;                      // Code bytes (opcodes and operands)
+    int constants;                  // Constant pool entries
+    int lineRuns;                   // Entries in the run-length line table
+    int opcodes[UINT8_COUNT];       // Instructions per opcode
+} BytecodeStats;
+
+/**
+ * @brief Count the instructions, bytes and opcodes of `chunk`, adding to
+ * `stats` (zero it first to count one chunk).
+ */
+void bytecode_stats(const Chunk* chunk, BytecodeStats* stats);
+
+/**
+ * @brief Print `value` as listings show constants (strings quoted and cut
+ * short, functions by name).
+ */
+void disassemble_value(FILE* out, Value value);
+
+/**
+ * @brief Print the instruction at `offset` of `chunk` as one line.
+ *
+ * @return The offset of the next instruction.
+ */
+int disassemble_instruction(FILE* out, const Chunk* chunk, int offset);
+
+/**
+ * @brief List one function: a header, its instructions and its summary.
+ */
+void disassemble_function(FILE* out, const ObjFunction* function);
+
+/**
+ * @brief List `script` and every function reachable through constants,
+ * each once, then the totals of the unit.
+ */
+void disassemble_unit(FILE* out, const ObjFunction* script);
+
+#endif // VM_DISASSEMBLER_H
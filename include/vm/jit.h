@@ -0,0 +1,88 @@
+/**
+ * @file jit.h
+ * @brief Baseline template JIT for hot functions (CLI: --jit).
+ *
+ * Every call and every loop back-edge adds to the function's hotness. When
+ * it reaches JIT_HOT_THRESHOLD, jit_compile() translates the function's
+ * chunk into x86-64 machine code by stitching together a fixed template
+ * per opcode.
+ *
+ * The machine code works on the interpreter's own state: the frame's
+ * slots, the operand stack and the globals, in the same layout. So control
+ * can pass between the two at any instruction boundary. The native code
+ * runs until it reaches something it leaves to the interpreter, then
+ * returns the bytecode offset to resume at, together with the new stack
+ * top. The interpreter then runs that instruction itself:
+ *   - calls, returns, printing and string concatenation
+ *   - any operand whose type the template does not handle (e.g. `+` on
+ *     strings, storing an object into a global: the write barriers)
+ *   - every runtime error (division by zero, type errors), which is then
+ *     reported by the interpreter as usual
+ *
+ * So the native code never allocates and never raises, and the collector
+ * never runs while it does.
+ *
+ * The interpreter enters the code when it starts a compiled frame, again
+ * after a call returns into one, and at every loop back-edge (OP_LOOP):
+ * on-stack replacement. A frame that is already running, like the
+ * top-level script which is never called again, switches to the machine
+ * code at the loop header as soon as its function gets hot, and a loop
+ * whose body stops for an instruction the templates leave alone (a call,
+ * a print) goes back to native code on its next iteration.
+ */
+
+#ifndef VM_JIT_H
+#define VM_JIT_H
+
+#include <stdint.h>
+
+#include "vm/common.h"
+#include "vm/value.h"
+#include "vm/object.h"
+
+// Calls + loop back-edges after which a function is compiled
+#define JIT_HOT_THRESHOLD 1000
+
+/**
+ * @brief Where native code stopped: the interpreter resumes at `offset`
+ * (the instruction there has not run) with the operand stack top `sp`.
+ */
+typedef struct {
+    intptr_t offset;
+    Value* sp;
+} JitExit;
+
+// Enter native code at `target` (an entry from JitCode.entries)
+typedef JitExit (*JitEntryFn)(Value* slots, Value* sp, Value* globals, const void* target);
+
+/**
+ * @struct JitCode
+ * @brief The machine code of one function.
+ */
+typedef struct JitCode {
+    uint8_t* memory;    // Executable mapping
+    size_t size;
+    JitEntryFn enter;   // Prologue: loads the registers, jumps to the target
+    const void** entries; // Per bytecode offset: native address, NULL to interpret
+    int count;          // chunk.count at compile time
+} JitCode;
+
+/**
+ * @brief Whether this build can compile to machine code (VM_JIT).
+ */
+bool jit_available(void);
+
+/**
+ * @brief Compile `function`'s chunk (stack code) into function->jit.
+ *
+ * @return false if it was not compiled (no JIT in this build, or out of
+ *         memory); the function then stays interpreted.
+ */
+bool jit_compile(ObjFunction* function);
+
+/**
+ * @brief Release the machine code of a function (NULL is ignored).
+ */
+void jit_free(JitCode* code);
+
+#endif // VM_JIT_H
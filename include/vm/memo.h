@@ -0,0 +1,102 @@
+/**
+ * @file memo.h
+ * @brief Result cache for pure functions (CLI: --memoize).
+ *
+ * Before a unit runs, memoize_unit() looks at the stack code of every
+ * function the unit declares and finds the pure ones. A function is pure
+ * when its result depends on its arguments only:
+ *   - it reads and writes no global, prints nothing and creates no function
+ *   - it never assigns to a parameter (they still hold the arguments when
+ *     it returns)
+ *   - it calls only itself and other pure functions, through direct calls
+ *     (an OP_CALL or OP_TAIL_CALL could reach anything)
+ *   - it has at most MEMO_ARGS_MAX parameters
+ * Mutual recursion is left alone (each function of the cycle is taken as
+ * impure): only self-calls are followed.
+ *
+ * A pure function gets OP_MEMO in front of its code and OP_MEMO_RETURN in
+ * place of each OP_RETURN. Jumps are relative, so nothing else moves.
+ * OP_MEMO looks the arguments up in the function's table and, on a hit,
+ * returns the cached result without running the body; OP_MEMO_RETURN
+ * stores the result before returning. Only ints and bools are cached, as
+ * arguments and as results: other calls run as before. The table then
+ * holds no heap references and the collector has nothing to trace; it is
+ * freed with its function.
+ *
+ * A direct call goes to whatever its callee's global holds when it runs,
+ * so each table records the functions its results depend on (the
+ * transitive callees). A lookup that finds one of them rebound (a later
+ * unit redeclared it) drops the table and makes the function impure for
+ * good.
+ *
+ * Each table holds up to MEMO_ENTRIES_MAX results and is emptied when it
+ * fills up. Instrumenting happens after verify_unit() and is never written
+ * to the .detc cache (the cache is written before the unit runs). Memoized
+ * units run on the stack VM.
+ */
+
+#ifndef VM_MEMO_H
+#define VM_MEMO_H
+
+#include "vm/common.h"
+#include "vm/object.h"
+#include "vm/vm.h"
+
+#define MEMO_ARGS_MAX 4         // Pure functions with more parameters are not memoized
+#define MEMO_ENTRIES_MAX 4096   // Results held per function before the table is emptied
+
+// ObjFunction.memoState
+typedef enum {
+    MEMO_UNKNOWN,   // Not looked at yet
+    MEMO_VISITING,  // Being classified (a call back to it is mutual recursion)
+    MEMO_PURE,      // Instrumented; `memo` is its table
+    MEMO_IMPURE,    // Runs as compiled
+} MemoState;
+
+/**
+ * @brief One cached call: the arguments and what the function returned.
+ */
+typedef struct {
+    Value args[MEMO_ARGS_MAX];
+    Value result;
+    bool used;
+} MemoEntry;
+
+typedef struct MemoTable {
+    MemoEntry* entries;     // Open addressing by hash of the arguments, NULL until the first store
+    int count;
+    int capacity;
+    ObjFunction** callees;  // The pure functions its results depend on (not itself)
+    int calleeCount;
+    uint64_t hits;
+    uint64_t misses;
+} MemoTable;
+
+/**
+ * @brief Find and instrument the pure functions among `script`'s (directly
+ * or nested). Functions looked at by an earlier unit are skipped. The
+ * caller keeps `script` reachable while the chunks grow.
+ */
+void memoize_unit(VM* vm, ObjFunction* script);
+
+/**
+ * @brief OP_MEMO's part: the cached result of calling `function` with
+ * `args` (its parameters), if there is one.
+ *
+ * Drops the table first if a callee was rebound; the function is then
+ * impure and `function->memo` NULL.
+ */
+bool memo_lookup(VM* vm, ObjFunction* function, const Value* args, Value* result);
+
+/**
+ * @brief OP_MEMO_RETURN's part: remember that `function` returned `result`
+ * for `args`. Values other than ints and bools are not stored.
+ */
+void memo_store(VM* vm, ObjFunction* function, const Value* args, Value result);
+
+/**
+ * @brief Free a table (NULL is fine).
+ */
+void free_memo(MemoTable* memo);
+
+#endif // VM_MEMO_H
@@ -15,6 +15,154 @@
 #include "common.h"
 #include "object.h"
 
+typedef struct VM VM;
+
+/**
+ * @brief Where the incremental collector is in its cycle.
+ *
+ * With a step budget (see set_gc_step_budget()) a cycle is spread over
+ * many allocations: GC_MARK traces gray objects a few at a time while the
+ * program keeps running, GC_SWEEP frees the dead ones a few at a time.
+ * A whole collection started by an allocation marks in one go and then
+ * sweeps lazily: GC_SWEEP again, a batch of objects per allocation.
+ */
+typedef enum {
+    GC_IDLE,
+    GC_MARK,    // Tri-color marking in progress: stores need the write barrier
+    GC_SWEEP    // Marking done: the old heap is being swept
+} GcPhase;
+
+#define GC_HEAP_GROW_FACTOR_DEFAULT 2.0         // nextGC = live bytes * factor, CLI: --gc-grow
+#define GC_INITIAL_THRESHOLD_DEFAULT (1024 * 1024)  // First collection at 1MB, CLI: --gc-initial
+
+/**
+ * @brief Collector counters, always kept (CLI: --gc-stats). Pauses are
+ * wall-clock time spent inside the collector, measured per entry: a whole
+ * collection, an incremental slice or a minor collection.
+ */
+typedef struct {
+    uint64_t collections;       // Full collections and completed incremental cycles
+    uint64_t minorCollections;  // Nursery collections
+    uint64_t slices;            // Incremental slices run
+    uint64_t totalPauseNs;
+    uint64_t maxPauseNs;
+    uint64_t bytesFreed;        // Old-heap bytes swept
+    uint64_t objectsFreed;      // Old-heap objects swept
+    uint64_t bytesPromoted;     // Nursery bytes copied to the old heap
+    size_t peakBytesAllocated;  // High-water mark of bytesAllocated
+    uint64_t parallelMarks;     // Full collections traced on several threads
+    uint64_t lazySweeps;        // Sweep batches run by allocations after a whole collection
+} GcStats;
+
+#if !defined(__GNUC__) && !defined(DETERMA_NO_PARALLEL_GC)
+#define DETERMA_NO_PARALLEL_GC // Parallel marking needs the GCC/Clang __atomic builtins
+#endif
+
+#define POOL_GRANULE 16                 // Size classes are multiples of this
+#define POOL_CLASSES 16                 // Pooled blocks go up to 256 bytes
+#define POOL_SLAB_SIZE (64 * 1024)      // Pools carve blocks out of slabs this big (and aligned to it)
+
+/**
+ * @brief The head of a slab: the list link and the mark bitmap, one bit
+ * per granule, set for a marked block starting there. Marking a pooled
+ * object writes here instead of its header, and clearing the marks after
+ * a sweep is a memset per slab. Blocks follow, from POOL_SLAB_FIRST_BLOCK.
+ */
+typedef struct PoolSlab {
+    struct PoolSlab* next;
+    uint8_t marks[POOL_SLAB_SIZE / POOL_GRANULE / 8];
+} PoolSlab;
+
+#define POOL_SLAB_FIRST_BLOCK ((sizeof(PoolSlab) + POOL_GRANULE - 1) / POOL_GRANULE * POOL_GRANULE)
+
+/**
+ * @brief Whether vm_allocate_object() serves `size` bytes from a slab.
+ */
+static inline bool pool_serves(size_t size) {
+#ifndef DETERMA_NO_POOLS
+    return (size - 1) / POOL_GRANULE < POOL_CLASSES;
+#else
+    (void)size;
+    return false;
+#endif
+}
+
+/**
+ * @brief The bitmap byte holding a pooled object's mark bit; `*bit` gets
+ * its mask.
+ */
+static inline uint8_t* object_mark_byte(const Obj* object, uint8_t* bit) {
+    uintptr_t address = (uintptr_t)object;
+    PoolSlab* slab = (PoolSlab*)(address & ~(uintptr_t)(POOL_SLAB_SIZE - 1));
+    size_t granule = (address & (POOL_SLAB_SIZE - 1)) / POOL_GRANULE;
+    *bit = (uint8_t)(1u << (granule & 7));
+    return &slab->marks[granule >> 3];
+}
+
+static inline bool object_is_marked(const Obj* object) {
+    if (!object->isPooled) return object->isMarked;
+    uint8_t bit;
+    return (*object_mark_byte(object, &bit) & bit) != 0;
+}
+
+static inline void object_set_marked(Obj* object, bool marked) {
+    if (!object->isPooled) {
+        object->isMarked = marked;
+        return;
+    }
+    uint8_t bit;
+    uint8_t* byte = object_mark_byte(object, &bit);
+    *byte = marked ? (uint8_t)(*byte | bit) : (uint8_t)(*byte & ~bit);
+}
+
+/**
+ * @brief Size-class free lists for old-heap object blocks (headers, and
+ * strings with their characters inline).
+ *
+ * Small blocks are carved out of shared slabs and recycled through the
+ * free list of their class, so allocating one is usually a pointer pop and
+ * objects made together sit together. Larger blocks go to malloc. Build
+ * with -DDETERMA_NO_POOLS to send everything to malloc (e.g. for ASan).
+ */
+typedef struct {
+    void* freeLists[POOL_CLASSES];  // Free blocks of class i are (i + 1) * POOL_GRANULE bytes
+    uint8_t* slabTop;               // Uncarved part of the newest slab
+    uint8_t* slabEnd;
+    PoolSlab* slabs;                // Every slab
+} ObjectPools;
+
+#define NURSERY_SIZE (256 * 1024)     // Bytes in the young generation
+#define NURSERY_REMEMBERED_MAX 1024   // Remembered global slots before scanning them all
+
+/**
+ * @brief The young generation: a bump-allocated region for short-lived
+ * runtime strings (concatenation results).
+ *
+ * Young objects are not on vm->objects. A minor collection copies the ones
+ * still referenced from the stack or from globals into the old heap and
+ * resets the region, so dead temporaries are never swept one by one. Only
+ * strings are young, and they reference nothing, so those are the only
+ * roots: globals are found through a write barrier (`remembered`).
+ */
+typedef struct {
+    uint8_t* start;     // NULL until the first young allocation
+    uint8_t* top;       // Next free byte
+    uint8_t* end;
+    bool full;          // An allocation did not fit: collect at the next safepoint
+    int* remembered;    // Global slots given a young value since the last minor collection
+    int rememberedCount;
+    bool rememberAll;   // Too many slots to list: scan every global
+} Nursery;
+
+/**
+ * @brief Bytes a young string of `length` characters occupies (header and
+ * inline characters, rounded up so the next header stays aligned).
+ */
+static inline size_t young_string_size(int length) {
+    size_t size = string_object_size(length);
+    return (size + sizeof(void*) - 1) & ~(sizeof(void*) - 1);
+}
+
 /**
  * @brief Reallocates memory using the GC's tracking.
  * @param pointer Existing pointer (or NULL for new allocation)
@@ -23,6 +171,83 @@
  */
 void* reallocate(void* pointer, size_t oldSize, size_t newSize);
 
+/**
+ * @brief reallocate() against an explicit VM's heap and GC.
+ */
+void* vm_reallocate(VM* vm, void* pointer, size_t oldSize, size_t newSize);
+
+/**
+ * @brief vm_reallocate(vm, NULL, 0, size) that never collects: the bytes
+ * count towards the threshold, and the next allocation that may collect
+ * does. For code that holds unrooted objects (e.g. flattening a rope that
+ * was just popped). Free with vm_reallocate().
+ */
+void* vm_allocate_deferred(VM* vm, size_t size);
+
+/**
+ * @brief Allocate an object block of `size` bytes from `vm`'s pools. Counts
+ * towards the GC threshold and may collect first, like vm_reallocate().
+ */
+void* vm_allocate_object(VM* vm, size_t size);
+
+/**
+ * @brief Return a block from vm_allocate_object() (same `size`).
+ */
+void vm_free_object_memory(VM* vm, void* block, size_t size);
+
+/**
+ * @brief Bump-allocate `size` bytes in `vm`'s nursery. Never collects.
+ *
+ * @return void* The block, or NULL if it does not fit (the caller allocates
+ * in the old heap instead, and the next safepoint runs a minor collection).
+ */
+void* vm_allocate_young(VM* vm, size_t size);
+
+/**
+ * @brief Give back the block most recently returned by vm_allocate_young().
+ */
+void vm_unallocate_young(VM* vm, void* block);
+
+/**
+ * @brief Write barrier: global `slot` now holds a young object.
+ */
+void vm_remember_global(VM* vm, int slot);
+
+/**
+ * @brief Minor collection: promote live young objects into the old heap and
+ * empty the nursery (may then run a full collection).
+ *
+ * Moves objects, so it may only run where every young reference is in a
+ * slot it rewrites: the stack, the globals or the intern table. The
+ * interpreter calls it at its safepoints once the nursery is full.
+ */
+void vm_collect_nursery(VM* vm);
+
+/**
+ * @brief Run one slice of incremental collection on `vm`, starting a new
+ * cycle if none is in progress. Allocation calls this on its own once the
+ * heap passes its threshold; an embedder may also call it when idle.
+ */
+void vm_collect_step(VM* vm);
+
+/**
+ * @brief Write barrier for incremental marking: `value` is being stored
+ * where the collector may already have looked (a global, a constant table)
+ * or handed out by the weak intern table. Shades it gray if needed.
+ */
+void vm_write_barrier(VM* vm, Value value);
+
+/**
+ * @brief Monotonic wall clock in nanoseconds (GC pauses, the clock() native).
+ */
+uint64_t vm_monotonic_ns(void);
+
+/**
+ * @brief Free every old-heap object of `vm`, whatever the collector's
+ * phase, and release its pools.
+ */
+void vm_free_objects(VM* vm);
+
 /**
  * @brief Marks an object as reachable (Black/Gray).
  */
@@ -43,10 +268,17 @@ void mark_array(ValueArray* array);
 
 
 /**
- * @brief Runs a full garbage collection cycle.
+ * @brief Runs a full garbage collection cycle on the current VM.
  */
 void collect_garbage();
 
+/**
+ * @brief Runs a full garbage collection cycle on `vm`. Unlike the ones
+ * allocations start, it sweeps before returning: unreachable objects are
+ * freed once it returns.
+ */
+void vm_collect_garbage(VM* vm);
+
 /**
  * @brief Frees a single object (internal use).
  */
@@ -0,0 +1,44 @@
+/**
+ * @file natives.h
+ * @brief Native (C) functions callable from Determa code.
+ *
+ * A native is bound to a global like a script function and called with
+ * the same OP_CALL instructions, but it runs in place: no CallFrame, the
+ * arguments are read straight off the operand stack and the result
+ * replaces them. The typechecker learns its return type at registration,
+ * so `var t = clock();` checks.
+ */
+
+#ifndef VM_NATIVES_H
+#define VM_NATIVES_H
+
+#include "types.h"
+#include "vm/vm.h"
+
+/**
+ * @brief Bind native `fn` to the global `name` of `vm`.
+ *
+ * Uses the calling thread's compiler and typechecker state, so register
+ * after init_compiler() / init_typechecker() and before compiling code
+ * that calls it.
+ *
+ * @param arity      Exact argument count (checked at every call).
+ * @param returnType What the typechecker infers for a call.
+ * @return false if the global table is full.
+ */
+bool vm_define_native(VM* vm, const char* name, int arity, DataType returnType, NativeFn fn);
+
+/**
+ * @brief Register the built-in natives:
+ *
+ *   clock()        int   Microseconds since the VM was initialized. Wraps
+ *                        to 0 after 2^31 us (about 35 minutes).
+ *   gc_stat(name)  int   A collector counter (see --gc-stats), clamped to
+ *                        INT32_MAX: "collections", "minor", "slices",
+ *                        "pause_us", "max_pause_us", "freed_bytes",
+ *                        "freed_objects", "promoted_bytes", "peak_bytes"
+ *                        or "heap_bytes".
+ */
+void vm_define_core_natives(VM* vm);
+
+#endif // VM_NATIVES_H
@@ -19,7 +19,10 @@
 // Forward declarations to avoid circular dependencies
 typedef struct Obj Obj;
 typedef struct ObjString ObjString;
+typedef struct ObjRope ObjRope;
 typedef struct ObjFunction ObjFunction;
+typedef struct ObjNative ObjNative;
+typedef struct VM VM;
 
 /**
  * @brief Identifies the specific type of an object.
@@ -27,7 +30,9 @@ typedef struct ObjFunction ObjFunction;
  */
 typedef enum {
     OBJ_STRING,
+    OBJ_ROPE,       // An ObjString whose characters are built lazily
     OBJ_FUNCTION,
+    OBJ_NATIVE,
 } ObjType;
 
 /**
@@ -38,8 +43,10 @@ typedef enum {
  */
 struct Obj {
     ObjType type;
-    bool isMarked;
-    struct Obj* next; // Linked list for tracking/GC
+    bool isMarked;    // Mark bit of blocks outside the pools (see object_is_marked())
+    bool isYoung;     // Lives in the nursery (see memory.h)
+    bool isPooled;    // Block from a pool slab: the mark bit is in the slab's bitmap
+    struct Obj* next; // Linked list for tracking/GC (young: forwarding pointer once promoted)
 };
 
 /**
@@ -49,35 +56,95 @@ struct Obj {
 struct ObjString {
     Obj obj;      // Base class state
     int length;
-    char* chars;  // Null-terminated C string
+    uint32_t hash; // FNV-1a of chars, computed once when the string is interned
+    char* chars;  // Null-terminated C string, stored inline right after the header
+                  // (ropes: a separate buffer, NULL until flattened)
+};
+
+/**
+ * @brief Bytes of one string block: the header plus its inline characters.
+ */
+static inline size_t string_object_size(int length) {
+    return sizeof(ObjString) + (size_t)length + 1;
+}
+
+// Concatenations at least this long build a rope instead of copying
+#define ROPE_MIN_LENGTH 512
+
+/**
+ * @struct ObjRope
+ * @brief The result of a long concatenation: `left` followed by `right`,
+ * not copied yet. Inherits from ObjString.
+ *
+ * `s = s + x` in a loop then costs one small node per iteration instead of
+ * a copy of all of `s`. The characters are only put together (flattened,
+ * once) when something needs them: printing, comparing, AS_CSTRING. Ropes
+ * are not interned, so equality compares their contents (strings_equal()).
+ * They live in the old heap, and so do their children.
+ */
+struct ObjRope {
+    ObjString string;   // length is the total; chars NULL until flattened
+    ObjString* left;    // Both NULL once flattened
+    ObjString* right;
 };
 
 struct ObjFunction {
     Obj obj;        // Base class state
     int arity;      // Number of parameters
+    int global;     // Global slot its declaration assigns (-1 for the script)
+    int registers;  // Frame size once its code is register code (0: stack code, see regcode.h)
+    int maxStackDepth;      // Most values its frame holds at once (chunk_stack_depth()); 0 = not computed
+    uint32_t hotness;       // Calls + loop back-edges so far (tiering, see jit.h)
+    struct JitCode* jit;    // Machine code for the chunk, NULL until hot
+    bool verified;  // Passed verify_unit() with trust (verify.h)
+    bool trusted;   // ... and every guarded instruction's operands were proven
+    uint8_t memoState;      // MemoState: whether --memoize found it pure (memo.h)
+    struct MemoTable* memo; // Its result cache while pure, else NULL
     Chunk chunk;    // the bytecode for This function
     ObjString* name;// Function name (for debugging)
 };
 
+/**
+ * @brief A C function callable from scripts (see natives.h).
+ *
+ * It reads `argCount` arguments from `args` (the arity is already checked)
+ * and stores its return value in `*result`. To abort the script it reports
+ * the problem with vm_runtime_error() and returns false.
+ */
+typedef bool (*NativeFn)(VM* vm, int argCount, Value* args, Value* result);
+
+struct ObjNative {
+    Obj obj;            // Base class state
+    int arity;          // Number of parameters
+    NativeFn function;
+    ObjString* name;    // Name it was registered under (for errors)
+};
+
 
 // --- Macros for casting ---
 #define OBJ_TYPE(value)   (AS_OBJ(value)->type)
-#define IS_STRING(value)  (isObjType(value, OBJ_STRING))
+#define IS_STRING(value)  (isObjType(value, OBJ_STRING) || isObjType(value, OBJ_ROPE))
 #define IS_FUNCTION(value)  (isObjType(value, OBJ_FUNCTION))
+#define IS_NATIVE(value)  (isObjType(value, OBJ_NATIVE))
 
 #define AS_STRING(value)  ((ObjString*)AS_OBJ(value))
 #define AS_FUNCTION(value)  ((ObjFunction*)AS_OBJ(value))
-#define AS_CSTRING(value) (((ObjString*)AS_OBJ(value))->chars)
+#define AS_NATIVE(value)  ((ObjNative*)AS_OBJ(value))
+#define AS_CSTRING(value) (string_chars(AS_STRING(value)))
 
 // --- Functions ---
 
 /**
  * @brief Creates a new string object by copying the given C-string.
+ *
+ * Strings are interned: if an equal string already exists it is returned
+ * instead, so two strings are equal exactly when their pointers are.
  */
 ObjString* copy_string(const char* chars, int length);
 
 /**
- * @brief Takes ownership of a string constant (for future optimization).
+ * @brief Takes ownership of a heap buffer allocated with reallocate().
+ * The buffer is freed if an equal string is already interned.
  */
 ObjString* take_string(char* chars, int length);
 
@@ -88,6 +155,25 @@ ObjString* take_string(char* chars, int length);
  */
 ObjString* concatenate(ObjString* a, ObjString* b);
 
+/**
+ * @brief Put a rope's characters together into one buffer, which it keeps
+ * (and lets go of its children). Never collects.
+ */
+char* flatten_rope(ObjRope* rope);
+
+/**
+ * @brief The characters of any string, flattening a rope first.
+ */
+static inline char* string_chars(ObjString* string) {
+    return string->chars != NULL ? string->chars : flatten_rope((ObjRope*)string);
+}
+
+/**
+ * @brief Whether two strings have the same contents: pointer equality,
+ * unless one of them is a rope.
+ */
+bool strings_equal(ObjString* a, ObjString* b);
+
 
 /**
  * @brief Creates a new Function object by parsing the bytecode chunk
@@ -96,6 +182,13 @@ ObjString* concatenate(ObjString* a, ObjString* b);
  */
 ObjFunction* new_function();
 
+/**
+ * @brief Wraps a C function so scripts can call it.
+ *
+ * @param name Name it is registered under (kept alive by the object).
+ */
+ObjNative* new_native(NativeFn function, int arity, ObjString* name);
+
 /**
  * @brief Helper for macros to check object type safely.
  */
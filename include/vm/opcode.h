@@ -6,6 +6,7 @@
 #ifndef VM_OPCODE_H
 #define VM_OPCODE_H
 
+#include <stdbool.h>
 #include <stdint.h>
 
 /**
@@ -15,6 +16,7 @@
 typedef enum {
     // --- Loading Values ---
     OP_CONSTANT,     // Load a constant from the pool. [OP_CONSTANT] [INDEX]
+    OP_CONSTANT_LONG,// Same with a 2-byte index, for pools of more than 256 constants
     OP_TRUE,         // Push True
     OP_FALSE,        // Push False
     OP_NIL,          // Push nil (for returns with no values)
@@ -33,6 +35,17 @@ typedef enum {
     OP_GREATER,      // >
     OP_LESS,         // <
 
+    // --- Type-Specialized (operands proven by the typechecker, no tag checks) ---
+    OP_ADD_INT,       // int + int
+    OP_SUBTRACT_INT,  // int - int
+    OP_MULTIPLY_INT,  // int * int
+    OP_DIVIDE_INT,    // int / int (still checks for zero)
+    OP_MODULO_INT,    // int % int (still checks for zero)
+    OP_CONCAT,        // string + string
+    OP_EQUAL_INT,     // int == int
+    OP_GREATER_INT,   // int > int
+    OP_LESS_INT,      // int < int
+
     // --- Variables ---
     OP_GET_GLOBAL,      // Operand: [1 byte index] Action: Push globals[index] onto stack
     OP_SET_GLOBAL,      // Operand: [1 byte index] Action: Pop stack, store in globals[index]
@@ -40,18 +53,200 @@ typedef enum {
     OP_GET_LOCAL,       // Operand: [1 byte index] Action: Push value from stack[index]
     OP_SET_LOCAL,       // Operand: [1 byte index] Action: Store top of stack into stack[index] (Peek, don't pop)
 
+    // Wide forms: operand is a 2-byte big-endian index (only emitted when it doesn't fit in 1 byte)
+    OP_GET_GLOBAL_LONG,
+    OP_SET_GLOBAL_LONG,
+    OP_GET_LOCAL_LONG,
+    OP_SET_LOCAL_LONG,
+
     // --- Control Flow (NEW) ---
     OP_POP,           // Pop top value (cleanup)
+    OP_POPN,          // Operand: [n]  pop n values (a run of OP_POPs, see peephole.h)
     OP_JUMP,          // Unconditional Jump (Forward)
     OP_JUMP_IF_FALSE, // Conditional Jump (Forward)
     OP_LOOP,          // Unconditional Jump (Backward)
 
     OP_CALL,          // Function call opcode
+    OP_CALL_DIRECT,   // Operands: [fn const][argc]  call a known function (no callee or arity check)
+    OP_TAIL_CALL,        // Operand: [argc]  `return f(...)`: the callee reuses the current frame
+    OP_TAIL_CALL_DIRECT, // Operands: [fn const][argc]  tail-call form of OP_CALL_DIRECT
+    OP_CALL_DIRECT_0,    // Operand: [fn const]  OP_CALL_DIRECT of 0 arguments
+    OP_CALL_DIRECT_1,    // ... 1 argument
+    OP_CALL_DIRECT_2,    // ... 2 arguments
+    OP_CALL_DIRECT_3,    // ... 3 arguments
     OP_CLOSURE,       // Create new ObjFunction and push it onto the stack
 
+    // --- Superinstructions (emitted by the peephole pass, see peephole.h) ---
+    OP_NOT_EQUAL,         // OP_EQUAL + OP_NOT
+    OP_GREATER_EQUAL,     // OP_LESS + OP_NOT
+    OP_LESS_EQUAL,        // OP_GREATER + OP_NOT
+    OP_NOT_EQUAL_INT,     // OP_EQUAL_INT + OP_NOT
+    OP_GREATER_EQUAL_INT, // OP_LESS_INT + OP_NOT
+    OP_LESS_EQUAL_INT,    // OP_GREATER_INT + OP_NOT
+    OP_ADD_CONST,         // Operand: [int const]  OP_CONSTANT k + OP_ADD
+    OP_SUBTRACT_CONST,    // Operand: [int const]  OP_CONSTANT k + OP_SUBTRACT
+    OP_ADD_LOCALS,        // Operands: [slot a][slot b]  OP_GET_LOCAL a + OP_GET_LOCAL b + OP_ADD
+    OP_ADD_LOCAL_CONST,   // Operands: [slot][int const]  OP_GET_LOCAL + OP_CONSTANT k + OP_ADD
+    OP_JUMP_IF_FALSE_POP, // OP_JUMP_IF_FALSE + OP_POP on both paths (always pops the condition)
+
+    // Loop counters: `while i < n { ...; i = i + k; }`
+    OP_JUMP_IF_NOT_LESS,          // OP_LESS(_INT) + OP_JUMP_IF_FALSE_POP (pops both ints, jumps unless a < b)
+    OP_JUMP_IF_NOT_LESS_EQUAL,    // OP_LESS_EQUAL(_INT) + OP_JUMP_IF_FALSE_POP
+    OP_JUMP_IF_NOT_GREATER,       // OP_GREATER(_INT) + OP_JUMP_IF_FALSE_POP
+    OP_JUMP_IF_NOT_GREATER_EQUAL, // OP_GREATER_EQUAL(_INT) + OP_JUMP_IF_FALSE_POP
+    OP_INC_LOCAL,         // Operands: [slot][int const]  local += k in place (GET, CONSTANT, ADD, SET, POP)
+    OP_INC_GLOBAL,        // Operands: [index][int const]  global += k in place
+
     // --- Statements ---
     OP_PRINT,        // Pop 1, Print it
     OP_RETURN,       // Return from script (stop execution)
+
+    // --- Memoization (put in by memoize_unit() before a run, never compiled or cached, see memo.h) ---
+    OP_MEMO,         // Function entry: return the cached result for these arguments, if any
+    OP_MEMO_RETURN,  // OP_RETURN that caches the result first
 } OpCode;
 
+/**
+ * @brief Total encoded length of an instruction (opcode + operands) in bytes.
+ *
+ * @param op The opcode byte.
+ * @return int 1, 2 or 3.
+ */
+static inline int opcode_length(uint8_t op) {
+    switch (op) {
+        case OP_CONSTANT:
+        case OP_GET_GLOBAL:
+        case OP_SET_GLOBAL:
+        case OP_GET_LOCAL:
+        case OP_SET_LOCAL:
+        case OP_CALL:
+        case OP_TAIL_CALL:
+        case OP_ADD_CONST:
+        case OP_SUBTRACT_CONST:
+        case OP_CALL_DIRECT_0:
+        case OP_CALL_DIRECT_1:
+        case OP_CALL_DIRECT_2:
+        case OP_CALL_DIRECT_3:
+        case OP_POPN:
+            return 2;
+
+        case OP_CONSTANT_LONG:
+        case OP_GET_GLOBAL_LONG:
+        case OP_SET_GLOBAL_LONG:
+        case OP_GET_LOCAL_LONG:
+        case OP_SET_LOCAL_LONG:
+        case OP_JUMP:
+        case OP_JUMP_IF_FALSE:
+        case OP_LOOP:
+        case OP_ADD_LOCALS:
+        case OP_ADD_LOCAL_CONST:
+        case OP_JUMP_IF_FALSE_POP:
+        case OP_JUMP_IF_NOT_LESS:
+        case OP_JUMP_IF_NOT_LESS_EQUAL:
+        case OP_JUMP_IF_NOT_GREATER:
+        case OP_JUMP_IF_NOT_GREATER_EQUAL:
+        case OP_INC_LOCAL:
+        case OP_INC_GLOBAL:
+        case OP_CALL_DIRECT:
+        case OP_TAIL_CALL_DIRECT:
+            return 3;
+
+        default:
+            return 1;
+    }
+}
+
+/**
+ * @brief Whether `op` calls the function in its constant operand
+ * (OP_CALL_DIRECT and its tail and fixed-arity forms).
+ */
+static inline bool is_direct_call(uint8_t op) {
+    return op == OP_CALL_DIRECT || op == OP_TAIL_CALL_DIRECT ||
+           (op >= OP_CALL_DIRECT_0 && op <= OP_CALL_DIRECT_3);
+}
+
+/**
+ * @brief The argument count of the direct call at `code`: in the opcode
+ * for the fixed-arity forms, else the second operand.
+ */
+static inline int direct_call_args(const uint8_t* code) {
+    return code[0] >= OP_CALL_DIRECT_0 && code[0] <= OP_CALL_DIRECT_3 ? code[0] - OP_CALL_DIRECT_0 : code[2];
+}
+
+/**
+ * @brief Printable name of an opcode ("OP_ADD"), for profiles and dumps.
+ */
+static inline const char* opcode_name(uint8_t op) {
+    switch (op) {
+        case OP_CONSTANT: return "OP_CONSTANT";
+        case OP_CONSTANT_LONG: return "OP_CONSTANT_LONG";
+        case OP_TRUE: return "OP_TRUE";
+        case OP_FALSE: return "OP_FALSE";
+        case OP_NIL: return "OP_NIL";
+        case OP_ADD: return "OP_ADD";
+        case OP_SUBTRACT: return "OP_SUBTRACT";
+        case OP_MULTIPLY: return "OP_MULTIPLY";
+        case OP_DIVIDE: return "OP_DIVIDE";
+        case OP_MODULO: return "OP_MODULO";
+        case OP_NEGATE: return "OP_NEGATE";
+        case OP_NOT: return "OP_NOT";
+        case OP_EQUAL: return "OP_EQUAL";
+        case OP_GREATER: return "OP_GREATER";
+        case OP_LESS: return "OP_LESS";
+        case OP_ADD_INT: return "OP_ADD_INT";
+        case OP_SUBTRACT_INT: return "OP_SUBTRACT_INT";
+        case OP_MULTIPLY_INT: return "OP_MULTIPLY_INT";
+        case OP_DIVIDE_INT: return "OP_DIVIDE_INT";
+        case OP_MODULO_INT: return "OP_MODULO_INT";
+        case OP_CONCAT: return "OP_CONCAT";
+        case OP_EQUAL_INT: return "OP_EQUAL_INT";
+        case OP_GREATER_INT: return "OP_GREATER_INT";
+        case OP_LESS_INT: return "OP_LESS_INT";
+        case OP_GET_GLOBAL: return "OP_GET_GLOBAL";
+        case OP_SET_GLOBAL: return "OP_SET_GLOBAL";
+        case OP_GET_LOCAL: return "OP_GET_LOCAL";
+        case OP_SET_LOCAL: return "OP_SET_LOCAL";
+        case OP_GET_GLOBAL_LONG: return "OP_GET_GLOBAL_LONG";
+        case OP_SET_GLOBAL_LONG: return "OP_SET_GLOBAL_LONG";
+        case OP_GET_LOCAL_LONG: return "OP_GET_LOCAL_LONG";
+        case OP_SET_LOCAL_LONG: return "OP_SET_LOCAL_LONG";
+        case OP_POP: return "OP_POP";
+        case OP_POPN: return "OP_POPN";
+        case OP_JUMP: return "OP_JUMP";
+        case OP_JUMP_IF_FALSE: return "OP_JUMP_IF_FALSE";
+        case OP_LOOP: return "OP_LOOP";
+        case OP_CALL: return "OP_CALL";
+        case OP_CALL_DIRECT: return "OP_CALL_DIRECT";
+        case OP_CALL_DIRECT_0: return "OP_CALL_DIRECT_0";
+        case OP_CALL_DIRECT_1: return "OP_CALL_DIRECT_1";
+        case OP_CALL_DIRECT_2: return "OP_CALL_DIRECT_2";
+        case OP_CALL_DIRECT_3: return "OP_CALL_DIRECT_3";
+        case OP_TAIL_CALL: return "OP_TAIL_CALL";
+        case OP_TAIL_CALL_DIRECT: return "OP_TAIL_CALL_DIRECT";
+        case OP_CLOSURE: return "OP_CLOSURE";
+        case OP_NOT_EQUAL: return "OP_NOT_EQUAL";
+        case OP_GREATER_EQUAL: return "OP_GREATER_EQUAL";
+        case OP_LESS_EQUAL: return "OP_LESS_EQUAL";
+        case OP_NOT_EQUAL_INT: return "OP_NOT_EQUAL_INT";
+        case OP_GREATER_EQUAL_INT: return "OP_GREATER_EQUAL_INT";
+        case OP_LESS_EQUAL_INT: return "OP_LESS_EQUAL_INT";
+        case OP_ADD_CONST: return "OP_ADD_CONST";
+        case OP_SUBTRACT_CONST: return "OP_SUBTRACT_CONST";
+        case OP_ADD_LOCALS: return "OP_ADD_LOCALS";
+        case OP_ADD_LOCAL_CONST: return "OP_ADD_LOCAL_CONST";
+        case OP_JUMP_IF_FALSE_POP: return "OP_JUMP_IF_FALSE_POP";
+        case OP_JUMP_IF_NOT_LESS: return "OP_JUMP_IF_NOT_LESS";
+        case OP_JUMP_IF_NOT_LESS_EQUAL: return "OP_JUMP_IF_NOT_LESS_EQUAL";
+        case OP_JUMP_IF_NOT_GREATER: return "OP_JUMP_IF_NOT_GREATER";
+        case OP_JUMP_IF_NOT_GREATER_EQUAL: return "OP_JUMP_IF_NOT_GREATER_EQUAL";
+        case OP_INC_LOCAL: return "OP_INC_LOCAL";
+        case OP_INC_GLOBAL: return "OP_INC_GLOBAL";
+        case OP_PRINT: return "OP_PRINT";
+        case OP_RETURN: return "OP_RETURN";
+        case OP_MEMO: return "OP_MEMO";
+        case OP_MEMO_RETURN: return "OP_MEMO_RETURN";
+        default: return "OP_UNKNOWN";
+    }
+}
+
 #endif // VM_OPCODE_H
\ No newline at end of file
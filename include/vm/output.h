@@ -0,0 +1,80 @@
+/**
+ * @file output.h
+ * @brief The VM's buffer for what scripts print (CLI: --output-buffer).
+ *
+ * `print` statements append to a per-VM buffer instead of going through
+ * stdio one value at a time, so a script that prints a lot makes one
+ * write per buffer full rather than one per line (or per character, when
+ * stdout is unbuffered). The buffer is written out when it fills up, and
+ * before anything else may need the output on screen first: a runtime
+ * error, the REPL prompt, the reports printed on exit, free_vm().
+ *
+ * A buffer without a sink captures instead: it grows to hold everything
+ * printed, and output_take() hands the text over (batch mode collects
+ * each script's output this way).
+ */
+
+#ifndef VM_OUTPUT_H
+#define VM_OUTPUT_H
+
+#include <stdio.h>
+
+#include "vm/common.h"
+#include "vm/value.h"
+
+#define OUTPUT_BUFFER_DEFAULT (64 * 1024) // Bytes buffered before a write
+
+/**
+ * @struct OutputBuffer
+ * @brief Pending output, written to `sink` by output_flush().
+ */
+typedef struct {
+    char* data;         // NULL until the first write
+    size_t count;
+    size_t capacity;
+    FILE* sink;         // stdout unless redirected; NULL captures
+} OutputBuffer;
+
+/**
+ * @brief Set up an empty buffer of `capacity` bytes (at least 1) that
+ * flushes to stdout. Allocates nothing yet.
+ */
+void output_init(OutputBuffer* out, size_t capacity);
+
+/**
+ * @brief Flush, then release the buffer's memory.
+ */
+void output_free(OutputBuffer* out);
+
+/**
+ * @brief Write everything buffered to the sink and flush it (nothing to
+ * do when capturing).
+ */
+void output_flush(OutputBuffer* out);
+
+/**
+ * @brief Hand over what a capturing buffer holds, leaving it empty.
+ *
+ * @param length Set to the number of bytes (the text is not NUL-terminated).
+ * @return The text, to be freed by the caller, or NULL if nothing was printed.
+ */
+char* output_take(OutputBuffer* out, size_t* length);
+
+/**
+ * @brief Append `length` bytes, flushing first if they do not fit.
+ * Writes longer than the whole buffer go straight to the sink. A
+ * capturing buffer grows instead.
+ */
+void output_write(OutputBuffer* out, const char* chars, size_t length);
+
+/**
+ * @brief Append `value` formatted as print_value() does.
+ */
+void output_value(OutputBuffer* out, Value value);
+
+/**
+ * @brief One print statement: `value` and a newline.
+ */
+void output_line(OutputBuffer* out, Value value);
+
+#endif // VM_OUTPUT_H
@@ -0,0 +1,26 @@
+/**
+ * @file peephole.h
+ * @brief Peephole pass that rewrites common bytecode sequences into superinstructions.
+ *
+ * Runs over a finished chunk (after the compiler emitted its final OP_RETURN)
+ * and fuses predictable sequences such as `OP_GREATER; OP_NOT` or
+ * `OP_GET_LOCAL; OP_CONSTANT; OP_ADD` into a single instruction, so tight
+ * loops pay for fewer dispatches. Jump offsets are re-patched afterwards.
+ */
+
+#ifndef VM_PEEPHOLE_H
+#define VM_PEEPHOLE_H
+
+#include "vm/chunk.h"
+
+/**
+ * @brief Fuse instruction sequences in-place.
+ *
+ * Never fuses across a jump target. The rewritten code is never longer than
+ * the original, so the chunk's arrays are reused (no allocation, no GC).
+ *
+ * @param chunk A complete chunk (all jumps already patched).
+ */
+void optimize_chunk(Chunk* chunk);
+
+#endif // VM_PEEPHOLE_H
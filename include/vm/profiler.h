@@ -0,0 +1,120 @@
+/**
+ * @file profiler.h
+ * @brief Instrumenting profiler for the interpreter loop (CLI: --profile).
+ *
+ * When a VM is created with profiling enabled, run() routes every
+ * instruction through profiler_instruction() before executing it. The
+ * profiler reads a tick counter (the TSC on x86, a monotonic nanosecond
+ * clock elsewhere) and charges the time since the previous instruction to
+ * that instruction's opcode, bytecode offset and call path. From this it
+ * reports:
+ *
+ *   - per opcode:   execution count and ticks
+ *   - per function: calls, exclusive and inclusive ticks
+ *   - per line:     hits and ticks (via the chunk's line table)
+ *
+ * and can write the call tree as folded stacks ("script;f;g 1234" per
+ * line), the input format of flamegraph.pl and speedscope.
+ *
+ * Call paths are tracked in a call tree updated by comparing the frame
+ * stack between instructions, so calls, returns, tail calls and error
+ * unwinding need no hooks of their own. Natives run inside the calling
+ * instruction and are charged to it.
+ *
+ * With profiling off the computed-goto dispatch path is unchanged (the
+ * hook sits behind a second label table); the portable switch dispatch
+ * pays one predictable branch per instruction.
+ *
+ * Profiled functions are kept alive (they are GC roots) so a freed
+ * function's address can never be mistaken for a new one.
+ */
+
+#ifndef VM_PROFILER_H
+#define VM_PROFILER_H
+
+#include <stdio.h>
+
+#include "vm/common.h"
+#include "vm/object.h"
+
+/**
+ * @brief Counters for one profiled function, indexed by bytecode offset.
+ */
+typedef struct {
+    ObjFunction* function;
+    int codeCount;
+    uint64_t* hits;         // Executions of the instruction at each offset
+    uint64_t* ticks;        // Ticks charged to it
+} ProfileFunction;
+
+/**
+ * @brief One call path: `function` called from the path `parent`.
+ * Node 0 is the root (no function); children are a sibling list.
+ */
+typedef struct {
+    int function;           // Index into Profiler::functions (-1 for the root)
+    int parent;
+    int firstChild;
+    int nextSibling;
+    uint64_t calls;
+    uint64_t selfTicks;     // Ticks spent in this path's own instructions
+} ProfileNode;
+
+typedef struct Profiler {
+    uint64_t opCounts[UINT8_COUNT];
+    uint64_t opTicks[UINT8_COUNT];
+
+    ProfileFunction* functions;
+    int functionCount;
+    int functionCapacity;
+    int* functionIndex;         // Open addressing: ObjFunction* -> functions index (-1 empty)
+    int indexCapacity;
+
+    ProfileNode* nodes;
+    int nodeCount;
+    int nodeCapacity;
+
+    // Where the previous instruction ran (charged on the next one)
+    int node;                   // Current call path
+    int depth;                  // Frame count `node` corresponds to
+    bool pending;               // An instruction is waiting for its ticks
+    uint8_t lastOp;
+    int lastOffset;
+    uint64_t lastTick;
+} Profiler;
+
+Profiler* new_profiler(void);
+void free_profiler(Profiler* profiler);
+
+/**
+ * @brief Start / finish one run() (the call tree restarts at the root;
+ * the last instruction's ticks are charged at the end).
+ */
+void profiler_begin_run(Profiler* profiler);
+void profiler_end_run(Profiler* profiler);
+
+/**
+ * @brief Record the instruction at `ip` in the VM's top frame, which is
+ * about to execute.
+ */
+void profiler_instruction(Profiler* profiler, VM* vm, const uint8_t* ip);
+
+/**
+ * @brief Print the opcode, function and line tables, hottest first.
+ */
+void profiler_report(const Profiler* profiler, FILE* out);
+
+/**
+ * @brief Write the call tree as folded stacks (one "a;b;c ticks" line per
+ * path with self time).
+ *
+ * @return false if the file could not be written.
+ */
+bool profiler_write_folded(const Profiler* profiler, const char* path);
+
+/**
+ * @brief Unit of the tick counter: "cycles" or "ns".
+ */
+const char* profiler_tick_unit(void);
+
+#endif // VM_PROFILER_H
@@ -0,0 +1,168 @@
+/**
+ * @file regcode.h
+ * @brief Register bytecode: the instruction set of the register VM (CLI: --register-vm).
+ *
+ * The stack VM spends most of its dispatches moving values between the
+ * locals and the operand stack: `i = i + 1` is GET_LOCAL, CONSTANT, ADD,
+ * SET_LOCAL, POP. The register VM runs three-address code over the frame's
+ * slots instead (`REG_ADDK i i k`: one dispatch).
+ *
+ * Register code is not compiled from the AST directly. Just before a unit
+ * runs, translate_to_registers() rewrites the stack code of the script and
+ * of every function it declares, in place: each stack position becomes a
+ * register (register n is frame slot n, so locals, parameters and the
+ * callee keep their slots and the calling convention is unchanged).
+ * Functions keep their constants, globals and line tables, so the compiler,
+ * the bytecode cache, the heap and stack traces are shared with the stack
+ * VM. While translating, loads of locals and constants are not emitted but
+ * forwarded to the instructions that use them, and comparisons feeding a
+ * branch become compare-and-branch instructions.
+ *
+ * Operand notation below: A = destination register, B/C = source
+ * registers, K = constant index (1 byte), KK = constant index (2 bytes),
+ * G = global slot (2 bytes), J = jump distance (2 bytes, from the end of
+ * the instruction), N = argument count. All multi-byte operands are
+ * big-endian.
+ */
+
+#ifndef VM_REGCODE_H
+#define VM_REGCODE_H
+
+#include <stdint.h>
+
+#include "vm/object.h"
+
+// Registers are addressed with a 1-byte operand
+#define REGISTERS_MAX UINT8_COUNT
+
+typedef enum {
+    // --- Moves & loads ---
+    REG_MOVE,           // A B      A = B
+    REG_LOADK,          // A K      A = constants[K]
+    REG_LOADK_LONG,     // A KK
+    REG_TRUE,           // A
+    REG_FALSE,          // A
+    REG_GET_GLOBAL,     // A G      A = globals[G]
+    REG_SET_GLOBAL,     // G B      globals[G] = B
+
+    // --- Arithmetic (checked: same errors as the stack opcodes) ---
+    REG_ADD,            // A B C    int + int or string + string
+    REG_SUBTRACT,       // A B C
+    REG_MULTIPLY,       // A B C
+    REG_DIVIDE,         // A B C
+    REG_MODULO,         // A B C
+    REG_CONCAT,         // A B C    strings proven by the typechecker
+    REG_ADD_INT,        // A B C    ints proven by the typechecker (no tag checks)
+    REG_SUBTRACT_INT,   // A B C
+    REG_MULTIPLY_INT,   // A B C
+    REG_DIVIDE_INT,     // A B C    still checks for zero
+    REG_MODULO_INT,     // A B C
+    REG_ADDK,           // A B K    A = B + K (int constant)
+    REG_SUBTRACTK,      // A B K    A = B - K (int constant)
+    REG_NEGATE,         // A B
+    REG_NOT,            // A B
+
+    // --- Comparisons (result is a bool) ---
+    REG_EQUAL,          // A B C
+    REG_NOT_EQUAL,      // A B C
+    REG_LESS,           // A B C
+    REG_LESS_EQUAL,     // A B C
+    REG_GREATER,        // A B C
+    REG_GREATER_EQUAL,  // A B C
+
+    // --- Control flow ---
+    REG_JUMP,           // J
+    REG_LOOP,           // J        backward
+    REG_JUMP_IF_FALSE,  // B J      jump when B is false
+    REG_JUMP_IF_NOT_EQUAL,          // B C J   jump unless B == C
+    REG_JUMP_IF_NOT_NOT_EQUAL,      // B C J   jump unless B != C
+    REG_JUMP_IF_NOT_LESS,           // B C J   jump unless B < C
+    REG_JUMP_IF_NOT_LESS_EQUAL,     // B C J
+    REG_JUMP_IF_NOT_GREATER,        // B C J
+    REG_JUMP_IF_NOT_GREATER_EQUAL,  // B C J
+    REG_JUMP_IF_NOT_LESSK,          // B K J   int constant forms
+    REG_JUMP_IF_NOT_LESS_EQUALK,    // B K J
+    REG_JUMP_IF_NOT_GREATERK,       // B K J
+    REG_JUMP_IF_NOT_GREATER_EQUALK, // B K J
+
+    // --- Calls (callee in A, arguments in A+1 .. A+N, result in A) ---
+    REG_CALL,             // A N
+    REG_CALL_DIRECT,      // A K N  arguments in A .. A+N-1 (shifted up over the callee slot)
+    REG_TAIL_CALL,        // A N
+    REG_TAIL_CALL_DIRECT, // A K N
+
+    // --- Statements ---
+    REG_PRINT,          // B
+    REG_RETURN,         // B
+} RegOpCode;
+
+/**
+ * @brief Encoded length of a register instruction (opcode + operands) in bytes.
+ */
+static inline int reg_opcode_length(uint8_t op) {
+    switch (op) {
+        case REG_TRUE:
+        case REG_FALSE:
+        case REG_PRINT:
+        case REG_RETURN:
+            return 2;
+
+        case REG_MOVE:
+        case REG_LOADK:
+        case REG_NEGATE:
+        case REG_NOT:
+        case REG_JUMP:
+        case REG_LOOP:
+        case REG_CALL:
+        case REG_TAIL_CALL:
+            return 3;
+
+        case REG_LOADK_LONG:
+        case REG_GET_GLOBAL:
+        case REG_SET_GLOBAL:
+        case REG_ADD:
+        case REG_SUBTRACT:
+        case REG_MULTIPLY:
+        case REG_DIVIDE:
+        case REG_MODULO:
+        case REG_CONCAT:
+        case REG_ADD_INT:
+        case REG_SUBTRACT_INT:
+        case REG_MULTIPLY_INT:
+        case REG_DIVIDE_INT:
+        case REG_MODULO_INT:
+        case REG_ADDK:
+        case REG_SUBTRACTK:
+        case REG_EQUAL:
+        case REG_NOT_EQUAL:
+        case REG_LESS:
+        case REG_LESS_EQUAL:
+        case REG_GREATER:
+        case REG_GREATER_EQUAL:
+        case REG_JUMP_IF_FALSE:
+        case REG_CALL_DIRECT:
+        case REG_TAIL_CALL_DIRECT:
+            return 4;
+
+        default: // Compare-and-branch
+            return 5;
+    }
+}
+
+/**
+ * @brief Translate `script` and every function it declares (directly or
+ * nested) from stack code to register code, in place. Functions already
+ * translated are left alone.
+ *
+ * All or nothing: when a function cannot be translated (it needs more
+ * than REGISTERS_MAX registers, or a jump grows out of range) an error is
+ * printed and no function is changed.
+ *
+ * The functions must be reachable by the collector (installing the code
+ * may allocate).
+ *
+ * @return false if the unit cannot run on the register VM.
+ */
+bool translate_to_registers(ObjFunction* script);
+
+#endif // VM_REGCODE_H
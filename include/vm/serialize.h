@@ -0,0 +1,126 @@
+/**
+ * @file serialize.h
+ * @brief Bytecode cache (.detc) and heap snapshots: save and reload
+ * compiled functions.
+ *
+ * A cache file stores the top-level script function (code, line table,
+ * constants and every nested function, recursively) together with the
+ * compiler's global slot names and the types the typechecker gave them. It
+ * is keyed by a hash of the source text, the optimization level and the
+ * VM's opcode set, and by the globals that existed before the unit (the
+ * natives, a heap snapshot's): the unit was checked against those, so a
+ * session without the same names and types in the same slots compiles the
+ * source again, as it does for a stale or foreign file.
+ *
+ * Layout (all integers little-endian):
+ *   header    "DETC" u32 version  u32 opcodeCount  u32 flags
+ *             u64 sourceHash  u64 bodyHash (FNV-1a of everything after the header)
+ *   globals   u32 count, u32 priorCount (slots that existed before the unit),
+ *             then count x (u32 length, bytes, u8 variable type, u8 return type)
+ *   function  u32 arity, i32 global slot (-1 = none),
+ *             i32 nameLength (-1 = script), name bytes,
+ *             u32 codeCount, code bytes,
+ *             u32 lineCount, lineCount x (u32 offset, i32 line) runs,
+ *             u32 constantCount, constantCount x constant
+ *   constant  u8 tag (bool/int/string/function/function ref) + payload;
+ *             functions are numbered in file order, and a function ref
+ *             (u32 id) names one already written (direct-call targets)
+ *
+ * A heap snapshot (CLI: --snapshot-save / --snapshot) stores what a run
+ * left in the globals, so a prelude that every run starts with is
+ * compiled and run once. It holds each global slot's name, the types the
+ * typechecker knows for it and its value, with every function and string
+ * the value reaches, in the encoding above (one function and string
+ * numbering for the whole file):
+ *   header    "DETS" u32 version  u32 opcodeCount  u64 bodyHash
+ *   globals   u32 count, then count x (u32 length, name bytes,
+ *             u8 variable type, u8 return type (TYPE_ERROR = none),
+ *             constant, or u8 unset / u8 native)
+ * Natives are not written: the loading VM must define the same ones, in
+ * the same slots. Values are ints, bools, strings and functions only
+ * (functions are not first-class, so nothing else can be in a global).
+ */
+
+#ifndef VM_SERIALIZE_H
+#define VM_SERIALIZE_H
+
+#include <stddef.h>
+
+#include "vm/common.h"
+#include "vm/object.h"
+#include "vm/vm.h"
+
+/**
+ * @brief Bump whenever the on-disk layout changes.
+ */
+#define DETC_FORMAT_VERSION 6
+
+/**
+ * @brief 64-bit FNV-1a hash of the source text (the cache key).
+ */
+uint64_t hash_source(const char* source, size_t length);
+
+/**
+ * @brief Serialize `function` and the current global slot names to `path`.
+ *
+ * The file is written next to its final name and renamed into place, so a
+ * crashed run never leaves a truncated cache behind.
+ *
+ * @param path         Destination file (usually "<source>.detc" -> "<source>c").
+ * @param function     The compiled top-level script.
+ * @param priorGlobals compiler_global_count() before the script was compiled.
+ * @param sourceHash   hash_source() of the source it was compiled from.
+ * @param flags        Compile options that change the bytecode (the opt level).
+ * @return true if the cache was written.
+ */
+bool write_bytecode_cache(const char* path, ObjFunction* function, int priorGlobals,
+                          uint64_t sourceHash, uint32_t flags);
+
+/**
+ * @brief Load a cached script if it matches `sourceHash` and `flags`.
+ *
+ * The first priorGlobals slots of the file must already be bound here, to
+ * the same names with the same types. On success the compiler's global slot
+ * names are restored, so globals keep the indexes the cached bytecode refers
+ * to, and the typechecker learns the types of the unit's own globals. The file is memory-mapped where
+ * the platform allows it. Every read is bounds-checked and the code is
+ * validated (opcodes, constant indexes, jump targets) before it is trusted.
+ *
+ * @return ObjFunction* The script function, or NULL if there is no usable
+ * cache (missing, stale, corrupt); the caller then compiles the source.
+ */
+ObjFunction* load_bytecode_cache(const char* path, uint64_t sourceHash, uint32_t flags);
+
+/**
+ * @brief Bump whenever the snapshot layout changes.
+ */
+#define DETS_FORMAT_VERSION 1
+
+/**
+ * @brief Write the globals of `vm` (see above) to `path`, renamed into
+ * place like the cache.
+ *
+ * Code the VM has rewritten for itself cannot be written: a run with
+ * --register-vm, --unsafe-fast or --memoize makes no snapshot.
+ *
+ * @return true if the snapshot was written.
+ */
+bool write_heap_snapshot(const char* path, VM* vm);
+
+/**
+ * @brief Restore a snapshot into `vm`, which must be fresh: its natives
+ * defined and no unit compiled yet.
+ *
+ * The globals get their names, slots and values back, and the typechecker
+ * gets their types (unproven, like any global of an earlier unit). Nothing
+ * is changed unless the whole file decodes cleanly; if the slots then do
+ * not line up with the compiler's, the globals are left half bound and the
+ * VM should not be used.
+ *
+ * @return A unit to interpret() before anything else: it runs no code, but
+ * the restored functions get the passes each unit gets (verification,
+ * memoizing, register code). NULL if the file is missing, stale or corrupt.
+ */
+ObjFunction* load_heap_snapshot(const char* path, VM* vm);
+
+#endif // VM_SERIALIZE_H
@@ -0,0 +1,72 @@
+/**
+ * @file table.h
+ * @brief Open-addressing hash table keyed by interned strings.
+ *
+ * Because every ObjString is interned, keys are compared by pointer; only
+ * table_find_string() looks at characters (it is what does the interning).
+ * Deleted slots become tombstones so probe sequences stay intact.
+ */
+
+#ifndef VM_TABLE_H
+#define VM_TABLE_H
+
+#include "common.h"
+#include "value.h"
+#include "object.h"
+
+/**
+ * @struct Entry
+ * @brief One slot. An empty slot has key NULL and value false; a tombstone
+ * has key NULL and value true.
+ */
+typedef struct {
+    ObjString* key;
+    Value value;
+} Entry;
+
+/**
+ * @struct Table
+ * @brief The hash table (capacity is always a power of two).
+ */
+typedef struct {
+    int count;          // Live entries + tombstones
+    int capacity;
+    Entry* entries;
+} Table;
+
+void init_table(Table* table);
+void free_table(Table* table);
+
+/**
+ * @brief Look up `key`. @return true and stores the value in `*value` if present.
+ */
+bool table_get(Table* table, ObjString* key, Value* value);
+
+/**
+ * @brief Insert or overwrite. @return true if `key` was not in the table before.
+ */
+bool table_set(Table* table, ObjString* key, Value value);
+
+/**
+ * @brief Remove `key`. @return true if it was present.
+ */
+bool table_delete(Table* table, ObjString* key);
+
+/**
+ * @brief Swap `key` for `replacement` in place (same characters and hash),
+ * without allocating. @return true if `key` was present.
+ */
+bool table_replace_key(Table* table, ObjString* key, ObjString* replacement);
+
+/**
+ * @brief Find a key whose characters equal `chars` (the interning lookup).
+ */
+ObjString* table_find_string(Table* table, const char* chars, int length, uint32_t hash);
+
+/**
+ * @brief Drop every entry whose key is not marked. Called by the GC between
+ * tracing and sweeping, which makes the intern table a weak set.
+ */
+void table_remove_white(Table* table);
+
+#endif // VM_TABLE_H
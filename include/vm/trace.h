@@ -0,0 +1,105 @@
+/**
+ * @file trace.h
+ * @brief Runtime tracing hooks (CLI: --trace-execution).
+ *
+ * A VmTracer is a set of callbacks a debugger, profiler or test attaches
+ * to a VM with vm_set_tracer(). Any callback may be NULL.
+ *
+ *   - instruction: before each instruction of the stack VM
+ *   - call/ret:    a bytecode function's frame was entered / left
+ *   - gcBegin/End: around each collector pause (outermost entry only)
+ *   - allocate:    a heap object was created
+ *   - grow:        another block of the VM's heap grew (vm_reallocate())
+ *
+ * The code hooks (instruction, call, ret) follow the profiler: run() picks
+ * a second label table whose every entry goes through vm_trace_instruction()
+ * first, so an untraced VM runs the same dispatch as before. Calls and
+ * returns are found by comparing the frame stack between instructions;
+ * natives run inside the calling instruction and report no frames. The
+ * switch dispatch (no computed goto) pays one predictable branch per
+ * instruction, as it does for the profiler.
+ *
+ * The table is chosen when run() starts, so a tracer attached from inside
+ * a hook takes effect with the next vm_interpret(). A VM that has traced
+ * code stays on the stack VM and compiles nothing more with the JIT. The
+ * GC and allocation hooks cost one branch per pause / per allocation.
+ */
+
+#ifndef VM_TRACE_H
+#define VM_TRACE_H
+
+#include <stdio.h>
+
+#include "vm/common.h"
+#include "vm/object.h"
+#include "vm/vm.h"
+
+/**
+ * @brief Callbacks for one tracer; `user` is handed to each of them.
+ *
+ * While the code hooks run, frame->ip of the top frame and vm->stackTop
+ * are current, so hooks may inspect the stack and locals. Hooks must not
+ * change the VM's state.
+ */
+typedef struct VmTracer {
+    void* user;
+    void (*instruction)(void* user, VM* vm, ObjFunction* function, int offset);
+    void (*call)(void* user, VM* vm, ObjFunction* function);
+    void (*ret)(void* user, VM* vm, ObjFunction* function);
+    void (*gcBegin)(void* user, VM* vm);
+    void (*gcEnd)(void* user, VM* vm, uint64_t pauseNs);
+    void (*allocate)(void* user, VM* vm, ObjType type, size_t size);
+    void (*grow)(void* user, VM* vm, size_t bytes);
+} VmTracer;
+
+/**
+ * @brief Attach `tracer` to `vm` (NULL detaches). The tracer is not
+ * copied and must outlive its use.
+ */
+void vm_set_tracer(VM* vm, const VmTracer* tracer);
+
+/**
+ * @brief Make the next init_vm() attach `tracer` (NULL: none).
+ */
+void set_vm_tracer(const VmTracer* tracer);
+
+/**
+ * @brief vm_init()'s part: attach the tracer given to set_vm_tracer().
+ */
+void vm_trace_init(VM* vm);
+
+/**
+ * @brief Whether `tracer` needs run() to route instructions through it.
+ */
+static inline bool tracer_traces_code(const VmTracer* tracer) {
+    return tracer != NULL &&
+           (tracer->instruction != NULL || tracer->call != NULL || tracer->ret != NULL);
+}
+
+/**
+ * @brief run()'s hook: report the calls and returns since the previous
+ * instruction, then the instruction at `ip` of the top frame.
+ */
+void vm_trace_instruction(VM* vm, const uint8_t* ip);
+
+/**
+ * @brief Report a return for every frame still traced (the run ended, or
+ * a runtime error unwound the stack).
+ */
+void vm_trace_unwind(VM* vm);
+
+/**
+ * @brief Report an allocation of `size` bytes for an object of `type`.
+ */
+static inline void vm_trace_allocation(VM* vm, ObjType type, size_t size) {
+    const VmTracer* tracer = vm->tracer;
+    if (tracer != NULL && tracer->allocate != NULL) tracer->allocate(tracer->user, vm, type, size);
+}
+
+/**
+ * @brief A tracer that prints the operand stack and each instruction to
+ * `out`, in disassembler format (disassembler.h).
+ */
+VmTracer execution_tracer(FILE* out);
+
+#endif // VM_TRACE_H
@@ -24,6 +24,48 @@ typedef enum {
 } ValueType;
 
 
+#ifdef COMPACT_VALUES
+
+/*
+ * Compact (pointer-tagged) layout: a Value is one 64-bit word.
+ *
+ *   ...pointer bits...  000   Obj* (heap objects are at least 8-byte aligned)
+ *   int32 in bits 32-63 001   int
+ *   b in bit 3          010   bool
+ *
+ * Halves the size of every stack slot, global and constant compared to the
+ * tagged struct below. The macros keep the same interface.
+ */
+typedef uint64_t Value;
+
+#define VALUE_TAG_MASK    ((uint64_t)7)
+#define VALUE_TAG_OBJ     ((uint64_t)0)
+#define VALUE_TAG_INT     ((uint64_t)1)
+#define VALUE_TAG_BOOL    ((uint64_t)2)
+
+#define FALSE_VALUE       (VALUE_TAG_BOOL)
+#define TRUE_VALUE        (VALUE_TAG_BOOL | ((uint64_t)1 << 3))
+
+// --- Macros for Type Checking ---
+#define IS_BOOL(value)    (((value) & VALUE_TAG_MASK) == VALUE_TAG_BOOL)
+#define IS_INT(value)     (((value) & VALUE_TAG_MASK) == VALUE_TAG_INT)
+#define IS_OBJ(value)     (((value) & VALUE_TAG_MASK) == VALUE_TAG_OBJ)
+
+// --- Macros for Unwrapping Values (Unsafe - Check type first!) ---
+#define AS_BOOL(value)    ((value) == TRUE_VALUE)
+#define AS_INT(value)     ((int)(int32_t)(uint32_t)((value) >> 32))
+#define AS_OBJ(value)     ((Obj*)(uintptr_t)(value))
+
+// --- Macros for Creating Values ---
+#define BOOL_VAL(value)   ((value) ? TRUE_VALUE : FALSE_VALUE)
+#define INT_VAL(value)    ((Value)(((uint64_t)(uint32_t)(value) << 32) | VALUE_TAG_INT))
+#define OBJ_VAL(object)   ((Value)(uintptr_t)(Obj*)(object))
+
+// --- Runtime type of a Value ---
+#define VALUE_TYPE(value) (IS_INT(value) ? VAL_INT : IS_BOOL(value) ? VAL_BOOL : VAL_OBJ)
+
+#else
+
 typedef struct {
     ValueType type;
     union {
@@ -48,6 +90,11 @@ typedef struct {
 #define INT_VAL(value)    ((Value){VAL_INT, {.integer = value}})
 #define OBJ_VAL(object)   ((Value){VAL_OBJ, {.obj = (Obj*)object}})
 
+// --- Runtime type of a Value ---
+#define VALUE_TYPE(value) ((value).type)
+
+#endif // COMPACT_VALUES
+
 
 /**
  * @struct ValueArray
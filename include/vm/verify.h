@@ -0,0 +1,60 @@
+/**
+ * @file verify.h
+ * @brief Load-time bytecode verifier (CLI: --unsafe-fast).
+ *
+ * verify_unit() walks the stack code of a script and of every function it
+ * declares once, before the unit runs, and checks what the interpreter
+ * otherwise takes on trust:
+ *   - every instruction is a known opcode and fits in the chunk, and no
+ *     path runs off the end of the code
+ *   - jumps land on instruction boundaries inside the chunk
+ *   - the stack depth never goes below the frame and is the same on every
+ *     path into an instruction, and never exceeds the function's
+ *     precomputed maxStackDepth (the frame size reserve_stack() relies on)
+ *   - constant, local and global operands are in range, direct calls name a
+ *     function of the right arity, and the constants fused into
+ *     superinstructions are ints
+ *   - the type-specialized opcodes the typechecker emitted never receive an
+ *     operand of another type
+ *
+ * Along the way it tracks the type (int, bool, string or unknown) of every
+ * stack position and of every global the unit stores. Globals keep one
+ * type: a global is known to be an int only if its current value and every
+ * store into it in the unit are ints. Parameters and call results are
+ * unknown (Determa parameters are untyped).
+ *
+ * With `trust`, the proven facts are put to use:
+ *   - checked instructions whose operands were proven are rewritten into
+ *     their unchecked forms (OP_ADD -> OP_ADD_INT or OP_CONCAT, OP_LESS ->
+ *     OP_LESS_INT, ...), in place: the encodings have the same length
+ *   - a function where every remaining guarded instruction without an
+ *     unchecked form (negation, `!`, the int superinstructions) has proven
+ *     operands is marked `trusted`, and run() dispatches it through a table
+ *     whose handlers skip those type checks
+ *
+ * Division and modulo keep their zero checks either way. The global types
+ * are recorded in the VM, so a later unit (a REPL line) that would store a
+ * value of another type into a global earlier code was verified against is
+ * rejected.
+ */
+
+#ifndef VM_VERIFY_H
+#define VM_VERIFY_H
+
+#include "vm/vm.h"
+
+/**
+ * @brief Verify `script` and every function it declares (directly or
+ * nested). Functions already verified with `trust` are skipped.
+ *
+ * A problem is reported on stderr, naming the function and the bytecode
+ * offset; nothing is rewritten then.
+ *
+ * @param vm    The VM the unit will run on (its globals' current values
+ *              and recorded types are taken into account).
+ * @param trust Rewrite proven instructions and mark trusted functions.
+ * @return false if the unit's bytecode is not valid.
+ */
+bool verify_unit(VM* vm, ObjFunction* script, bool trust);
+
+#endif // VM_VERIFY_H
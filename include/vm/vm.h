@@ -8,6 +8,9 @@
  *   - Values live on a single operand stack.
  *   - Each function call has a CallFrame pointing into that stack.
  *   - Bytecode lives inside ObjFunction->chunk.
+ *
+ * Alternatively (set_vm_register_backend) it runs register code translated
+ * from that bytecode, whose operands are the frame's slots (regcode.h).
  */
 
 #ifndef VM_VM_H
@@ -16,10 +19,19 @@
 #include "chunk.h"
 #include "value.h" // Value needs to be fully defined
 #include "object.h" // VM needs to know about Objects
+#include "table.h"  // String intern table
+#include "memory.h" // Nursery
+#include "output.h" // Print buffer
 
-#define STACK_MAX 256       // Maximum number of global variables allowed in a script
-#define GLOBALS_MAX 256     // Max recursion depth
-#define FRAMES_MAX 64       // Max call depth (number of CallFrames)
+#define GLOBALS_MAX UINT16_COUNT  // Maximum number of global variables (16-bit global index)
+
+// The operand stack and the call-frame stack start small and grow on demand
+#define STACK_INITIAL 256                   // Initial operand stack size (Values)
+#define FRAMES_INITIAL 64                   // Initial number of CallFrames
+#define STACK_LIMIT_DEFAULT (4 * 1024 * 1024) // Max operand stack size (Values), CLI: --stack-size
+#define FRAMES_LIMIT_DEFAULT 4096           // Max call depth (CallFrames), CLI: --max-depth
+#define GC_STEP_BUDGET_DEFAULT 0            // Work per GC slice (0 = stop-the-world), CLI: --gc-step
+#define GC_THREADS_DEFAULT 1                // Threads marking a full collection, CLI: --gc-threads
 
 /**
  * @brief It represents a single function call in the stack
@@ -35,22 +47,57 @@ typedef struct {
  * @struct VM
  * @brief The Virtual Machine state.
  */
-typedef struct {
-    CallFrame frames[FRAMES_MAX];   // Call Stack
+typedef struct VM {
+    CallFrame* frames;              // Call Stack (grows up to frameLimit)
     int frameCount;                 // number of frames
-    
-    Value stack[STACK_MAX];         // The operand stack
+    int frameCapacity;
+    int frameLimit;
+
+    Value* stack;                   // The operand stack (grows up to stackLimit)
     Value* stackTop;                // Points to the top of the stack
+    int stackCapacity;
+    int stackLimit;
     Value globals[GLOBALS_MAX];     // Compiler resolves names ("x") to indices (0) and stores it here
+    int globalLimit;                // Slots from here on were never bound (see vm_use_global())
     Obj* objects;                   // Object Tracking: stores the Head of the linked list of all allocated objects
+    Table strings;                  // Interned strings (weak: the GC prunes dead ones before sweeping)
 
     // GC States
     int grayCount;              // Number of objects in the worklist
     int grayCapacity;           // Capacity of the worklist
     Obj** grayStack;            // The worklist (stack of gray objects)
     
-    size_t bytesAllocated;      // Total bytes currently allocated
+    size_t bytesAllocated;      // Total bytes currently allocated (old heap)
     size_t nextGC;              // Threshold to trigger the next collection
+    double gcGrowFactor;        // nextGC after a collection = bytesAllocated * gcGrowFactor
+    GcStats gcStats;
+    int gcPauseDepth;           // Nesting of collector entries (a pause is timed at depth 1)
+    Nursery nursery;            // Young generation for runtime strings
+    ObjectPools pools;          // Old-heap object blocks
+
+    // Incremental collection (memory.c)
+    GcPhase gcPhase;
+    int gcStepBudget;           // Objects traced or swept per slice; 0 = whole collections
+    int gcThreads;              // Threads tracing a full collection (1 = serial)
+    struct ThreadPool* gcPool;  // Their pool, started by the first parallel trace
+    int gcGlobalCursor;         // GC_MARK: next global slot to scan
+    Obj* sweepCursor;           // GC_SWEEP: unswept objects (detached from `objects`)
+    Obj* sweepSurvivors;        // GC_SWEEP: swept objects that stay, spliced back at the end
+    Obj* sweepSurvivorsTail;
+
+    uint64_t startTime;         // vm_monotonic_ns() at vm_init() (the clock() epoch)
+    struct Profiler* profiler;  // Instruction profiler, NULL unless profiling (profiler.h)
+    struct AllocProfiler* allocProfiler; // Allocation profiler, NULL unless on (alloc_profiler.h)
+    const struct VmTracer* tracer; // Tracing hooks, NULL unless attached (trace.h)
+    int traceDepth;             // Frames the tracer has seen entered
+    ObjFunction* traceFunction; // The function of the top one
+    uint8_t traceLastOp;        // The opcode traced last (tail calls)
+    bool registerBackend;       // Run register code (regcode.h); ignored while profiling
+    bool jit;                   // Compile hot functions to machine code (jit.h)
+    bool unsafeFast;            // Verify each unit and drop the guards it proves (verify.h)
+    bool memoize;               // Cache the results of pure functions (memo.h)
+    uint8_t* globalTypes;       // Per global: the type verified code relies on (verify.c)
+    OutputBuffer output;        // What `print` wrote and stdout has not seen yet (output.h)
 } VM;
 
 /**
@@ -63,13 +110,134 @@ typedef enum {
     INTERPRET_RUNTIME_ERROR
 } InterpretResult;
 
-// Expose the global VM instance for testing purposes (inspecting the stack)
+// The default VM instance (CLI, REPL, tests inspect its stack and globals)
 extern VM vm;
 
+// The VM the calling thread allocates into and runs; starts out as &vm.
+// The functions without a VM* parameter below all act on it.
+extern DETERMA_THREAD_LOCAL VM* currentVM;
+
+// --- Instances ---
+// A VM may only be used by one thread at a time. Compiler and typechecker
+// state is per thread, so each worker thread should own its VM: create it
+// with new_vm(), select it with use_vm() before compiling, run it with
+// vm_interpret() and release it with destroy_vm().
+VM* new_vm(void);
+void destroy_vm(VM* machine);
+VM* use_vm(VM* machine);
+
+void vm_init(VM* vm);
+void vm_free(VM* vm);
+
+/**
+ * @brief Note that global `slot` may hold a value. Roots are scanned up to
+ * vm->globalLimit only; the compiler notes every slot it binds, so only
+ * code storing into a slot it did not get from the compiler calls this.
+ */
+static inline void vm_use_global(VM* vm, int slot) {
+    if (slot >= vm->globalLimit) vm->globalLimit = slot + 1;
+}
+void vm_push(VM* vm, Value value);
+Value vm_pop(VM* vm);
+Value vm_peek(VM* vm, int distance);
+InterpretResult vm_interpret(VM* vm, ObjFunction* function);
+
+/**
+ * @brief Free a top-level script that has finished running now, instead of
+ * leaving it to the next collection. Nothing may refer to it afterwards.
+ * Kept while profiling: the profile's records index into its code.
+ */
+void vm_release_script(VM* vm, ObjFunction* script);
+
 // VM Lifecycle
 void init_vm(void);
 void free_vm(void);
 
+/**
+ * @brief Set the maximum call depth and operand stack size (in Values)
+ * used by the next init_vm(). Values <= 0 keep the current setting.
+ */
+void set_vm_limits(int maxFrames, int maxStack);
+
+/**
+ * @brief Make the next init_vm() collect incrementally, tracing or sweeping
+ * at most `budget` objects per slice (0 restores stop-the-world collection).
+ */
+void set_gc_step_budget(int budget);
+
+/**
+ * @brief Make the next init_vm() trace full collections on `threads`
+ * threads (the collecting one included; <= 1 traces serially). Incremental
+ * slices and sweeping always run on the collecting thread.
+ */
+void set_gc_threads(int threads);
+
+/**
+ * @brief Set the heap grow factor and the first collection threshold (in
+ * bytes) used by the next init_vm(). Values <= 0 keep the current setting.
+ */
+void set_gc_tuning(double growFactor, long initialThreshold);
+
+/**
+ * @brief Make the next init_vm() profile every instruction it runs (see
+ * profiler.h); the report is read from vm->profiler before free_vm().
+ */
+void set_vm_profiling(bool enabled);
+
+/**
+ * @brief Make the next init_vm() charge every allocation to the
+ * instruction and line that made it (alloc_profiler.h); the report is read
+ * from vm->allocProfiler before free_vm(). The profiler takes the VM's
+ * tracer slot, and like the instruction profiler keeps the stack VM.
+ */
+void set_vm_alloc_profiling(bool enabled);
+
+/**
+ * @brief Make the next init_vm() run scripts on the register VM: each unit
+ * is translated to register code (regcode.h) before it runs. The profiler
+ * only knows stack code, so a profiling VM keeps the stack VM.
+ */
+void set_vm_register_backend(bool enabled);
+
+/**
+ * @brief Make the next init_vm() compile hot functions to machine code
+ * (jit.h). Ignored where the build has no JIT, while profiling and on the
+ * register VM.
+ */
+void set_vm_jit(bool enabled);
+
+/**
+ * @brief Make the next init_vm() verify every unit before it runs and run
+ * the proven parts without type checks (verify.h). Ignored while profiling.
+ */
+void set_vm_unsafe_fast(bool enabled);
+
+/**
+ * @brief Make the next init_vm() cache the results of the pure functions of
+ * every unit (memo.h). Memoized code is stack code, so the VM keeps the
+ * stack VM.
+ */
+void set_vm_memoize(bool enabled);
+
+/**
+ * @brief Set how many bytes of script output the next init_vm() buffers
+ * before writing them out (output.h). Values <= 0 keep the current setting.
+ */
+void set_vm_output_buffer(long size);
+
+/**
+ * @brief Write out everything `vm` has printed so far. Also done on a
+ * runtime error and by free_vm(); call it before reading input or writing
+ * to stdout directly.
+ */
+void vm_flush_output(VM* vm);
+
+/**
+ * @brief Report a runtime error with a stack trace and unwind `vm`'s
+ * stacks. Natives call it before returning false.
+ */
+void vm_runtime_error(VM* vm, const char* format, ...);
+
 // --- Stack Operations ---
 void push(Value value);
 Value pop(void);
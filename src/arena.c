@@ -0,0 +1,104 @@
+/**
+ * @file arena.c
+ * @brief Implementation of the bump-pointer arena allocator.
+ *
+ * @version 0.1
+ * @date 2026-10-14
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+
+#include "arena.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ARENA_BLOCK_SIZE (16 * 1024)
+#define ARENA_ALIGNMENT  16
+
+static size_t align_up(size_t size) {
+    return (size + (ARENA_ALIGNMENT - 1)) & ~(size_t)(ARENA_ALIGNMENT - 1);
+}
+
+void arena_init(Arena* arena) {
+    arena->head = NULL;
+    arena->bytesUsed = 0;
+}
+
+/**
+ * @brief Pushes a fresh block big enough for `size` bytes.
+ */
+static ArenaBlock* new_block(Arena* arena, size_t size) {
+    size_t capacity = size > ARENA_BLOCK_SIZE ? size : ARENA_BLOCK_SIZE;
+
+    ArenaBlock* block = (ArenaBlock*)malloc(sizeof(ArenaBlock) + capacity);
+    if (block == NULL) return NULL;
+
+    block->next = arena->head;
+    block->used = 0;
+    block->capacity = capacity;
+    arena->head = block;
+    return block;
+}
+
+void* arena_alloc(Arena* arena, size_t size) {
+    size = align_up(size == 0 ? 1 : size);
+
+    ArenaBlock* block = arena->head;
+    if (block == NULL || block->capacity - block->used < size) {
+        block = new_block(arena, size);
+        if (block == NULL) return NULL;
+    }
+
+    void* result = block->data + block->used;
+    block->used += size;
+    arena->bytesUsed += size;
+    return result;
+}
+
+void* arena_grow(Arena* arena, void* pointer, size_t oldSize, size_t newSize) {
+    if (pointer == NULL) return arena_alloc(arena, newSize);
+    if (newSize <= oldSize) return pointer;
+
+    // The last allocation of the head block can simply be extended
+    ArenaBlock* block = arena->head;
+    size_t oldAligned = align_up(oldSize);
+    size_t newAligned = align_up(newSize);
+    if (block != NULL && (unsigned char*)pointer + oldAligned == block->data + block->used &&
+        block->capacity - block->used >= newAligned - oldAligned) {
+        block->used += newAligned - oldAligned;
+        arena->bytesUsed += newAligned - oldAligned;
+        return pointer;
+    }
+
+    void* result = arena_alloc(arena, newSize);
+    if (result != NULL) memcpy(result, pointer, oldSize);
+    return result;
+}
+
+void arena_reset(Arena* arena) {
+    ArenaBlock* keep = arena->head;
+    if (keep == NULL) return;
+
+    ArenaBlock* block = keep->next;
+    while (block != NULL) {
+        ArenaBlock* next = block->next;
+        free(block);
+        block = next;
+    }
+    keep->next = NULL;
+    keep->used = 0;
+    arena->bytesUsed = 0;
+}
+
+void arena_free(Arena* arena) {
+    ArenaBlock* block = arena->head;
+    while (block != NULL) {
+        ArenaBlock* next = block->next;
+        free(block);
+        block = next;
+    }
+    arena_init(arena);
+}
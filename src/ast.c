@@ -12,11 +12,49 @@
  */
 
 #include "ast.h"
+#include "tls.h"
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+// Arena that new nodes are carved from (NULL: malloc each node)
+static DETERMA_THREAD_LOCAL Arena* activeArena = NULL;
+
+
+// ==========================
+// --- Allocation Helpers ---
+// ==========================
+
+Arena* ast_use_arena(Arena* arena) {
+    Arena* previous = activeArena;
+    activeArena = arena;
+    return previous;
+}
+
+void* ast_alloc(size_t size) {
+    return activeArena ? arena_alloc(activeArena, size) : malloc(size);
+}
+
+void* ast_realloc(void* pointer, size_t oldSize, size_t newSize) {
+    return activeArena ? arena_grow(activeArena, pointer, oldSize, newSize)
+                       : realloc(pointer, newSize);
+}
+
+/**
+ * @brief Allocates a node and fills in the AstNode header.
+ */
+static void* allocate_node(size_t size, AstNodeType type, int line) {
+    AstNode* node = (AstNode*)ast_alloc(size);
+    if (!node) return NULL;
+
+    node->type = type;
+    node->line = line;
+    node->resolvedType = TYPE_ERROR;
+    node->inArena = (activeArena != NULL);
+    return node;
+}
+
 // --- Private Helper to print with indentation ---
 static void print_ast_recursive(AstNode* node, int indent) {
     if (node == NULL) {
@@ -54,7 +92,7 @@ static void print_ast_recursive(AstNode* node, int indent) {
 
         case NODE_STRING_LITERAL: {
             AstNodeStringLiteral* n = (AstNodeStringLiteral*)node;
-            printf("STRING_LITERAL: \"%s\"\n", n->value);
+            printf("STRING_LITERAL: \"%.*s\"\n", n->length, n->chars);
             break;
         }
 
@@ -186,12 +224,27 @@ void print_ast(AstNode* node) {
  *  - All child nodes
  *  - Dynamic arrays (in NODE_PROGRAM)
  *  - The node itself
+ *
+ * Trees built by the parser live in an arena: freeing their program node
+ * releases the whole arena at once, and freeing any other arena node is a
+ * no-op (its memory goes with the arena). A tree parsed into a caller's
+ * arena (parse_in_arena()) is released by resetting that arena instead.
  * 
  * @param AstNode* Pointer to the abstract syntax tree root node
  */
 void free_ast(AstNode* node) {
     if (node == NULL) return;
 
+    if (node->inArena) {
+        if (node->type == NODE_PROGRAM && ((AstNodeProgram*)node)->ownsArena) {
+            Arena* arena = ((AstNodeProgram*)node)->arena;
+            if (activeArena == arena) activeArena = NULL;
+            arena_free(arena);
+            free(arena);
+        }
+        return;
+    }
+
     // Use post-order traversal to free
     switch (node->type) {
         case NODE_PROGRAM: {
@@ -233,10 +286,12 @@ void free_ast(AstNode* node) {
         /* ================================
          *  STRING LITERAL
          *  (No children)
-         *  Free the string copy only
+         *  Free folded bytes only; parsed
+         *  literals point into the source
          * ================================ */
         case NODE_STRING_LITERAL: {
-            free(((AstNodeStringLiteral*)node)->value); // Free the string copy
+            AstNodeStringLiteral* n = (AstNodeStringLiteral*)node;
+            if (n->ownsChars) free((void*)n->chars);
             break;
         }
 
@@ -412,18 +467,17 @@ void free_ast(AstNode* node) {
  * @return AstNode* 
  */
 AstNode* new_program_node(AstNode** statements, int count) {
-    AstNodeProgram* node = (AstNodeProgram*)malloc(sizeof(AstNodeProgram));
+    AstNodeProgram* node = (AstNodeProgram*)allocate_node(sizeof(AstNodeProgram), NODE_PROGRAM, 0);
     if (!node) return NULL;
-
-    node->node.type = NODE_PROGRAM;
-    // node->node.line = line;
+    node->arena = NULL; // Set by the parser, with ownsArena
+    node->ownsArena = 0;
 
     // Initial dynamic array capacity
     node->capacity = (count > 0) ? count * 2 : 8;
-    node->statements = (AstNode**)malloc(sizeof(AstNode*) * node->capacity);
+    node->statements = (AstNode**)ast_alloc(sizeof(AstNode*) * node->capacity);
 
     if (!node->statements) {
-        free(node);
+        if (!node->node.inArena) free(node);
         return NULL;
     }
 
@@ -453,10 +507,10 @@ void program_add_statement(AstNode* program_node, AstNode* statement) {
 
     // Expand array if necessary
     if (p->statement_count >= p->capacity) {
-        p->capacity *= 2;
-        AstNode** new_block = (AstNode**)realloc(
+        AstNode** new_block = (AstNode**)ast_realloc(
             p->statements,
-            sizeof(AstNode*) * p->capacity
+            sizeof(AstNode*) * p->capacity,
+            sizeof(AstNode*) * p->capacity * 2
         );
 
         if (!new_block) {
@@ -464,6 +518,7 @@ void program_add_statement(AstNode* program_node, AstNode* statement) {
             return;
         }
         p->statements = new_block;
+        p->capacity *= 2;
     }
 
     p->statements[p->statement_count++] = statement;
@@ -480,13 +535,11 @@ void program_add_statement(AstNode* program_node, AstNode* statement) {
  * @return AstNode* 
  */
 AstNode* new_block_node(int line) {
-    AstNodeBlock* node = (AstNodeBlock*)malloc(sizeof(AstNodeBlock));
+    AstNodeBlock* node = (AstNodeBlock*)allocate_node(sizeof(AstNodeBlock), NODE_BLOCK, line);
     if (!node) return NULL;
-    node->node.type = NODE_BLOCK;
-    node->node.line = line;
     node->statement_count = 0;
     node->capacity = 4;
-    node->statements = (AstNode**)malloc(sizeof(AstNode*) * node->capacity);
+    node->statements = (AstNode**)ast_alloc(sizeof(AstNode*) * node->capacity);
     return (AstNode*)node;
 }
 
@@ -499,8 +552,10 @@ AstNode* new_block_node(int line) {
 void block_add_statement(AstNode* block_node, AstNode* statement) {
     AstNodeBlock* b = (AstNodeBlock*)block_node;
     if (b->statement_count >= b->capacity) {
+        b->statements = (AstNode**)ast_realloc(b->statements,
+                                               sizeof(AstNode*) * b->capacity,
+                                               sizeof(AstNode*) * b->capacity * 2);
         b->capacity *= 2;
-        b->statements = (AstNode**)realloc(b->statements, sizeof(AstNode*) * b->capacity);
     }
     b->statements[b->statement_count++] = statement;
 }
@@ -513,11 +568,8 @@ void block_add_statement(AstNode* block_node, AstNode* statement) {
  * @return AstNode* 
  */
 AstNode* new_var_decl_node(Token name, AstNode* initializer, int line) {
-    AstNodeVarDecl* node = (AstNodeVarDecl*)malloc(sizeof(AstNodeVarDecl));
+    AstNodeVarDecl* node = (AstNodeVarDecl*)allocate_node(sizeof(AstNodeVarDecl), NODE_VAR_DECL, line);
     if (!node) return NULL;
-
-    node->node.type = NODE_VAR_DECL;
-    node->node.line = line;
     node->name = name;
     node->init = initializer;
 
@@ -531,11 +583,8 @@ AstNode* new_var_decl_node(Token name, AstNode* initializer, int line) {
  * @return AstNode* 
  */
 AstNode* new_var_access_node(Token name, int line) {
-    AstNodeVarAccess* node = (AstNodeVarAccess*)malloc(sizeof(AstNodeVarAccess));
+    AstNodeVarAccess* node = (AstNodeVarAccess*)allocate_node(sizeof(AstNodeVarAccess), NODE_VAR_ACCESS, line);
     if (!node) return NULL;
-
-    node->node.type = NODE_VAR_ACCESS;
-    node->node.line = line;
     node->name = name;
 
     return (AstNode*)node;
@@ -548,11 +597,8 @@ AstNode* new_var_access_node(Token name, int line) {
  * @return AstNode* pointer to the newly allocated AstNode, or NULL on allocation failure
  */
 AstNode* new_print_stmt_node(AstNode* expression, int line) {
-    AstNodePrintStmt* node = (AstNodePrintStmt*)malloc(sizeof(AstNodePrintStmt));
+    AstNodePrintStmt* node = (AstNodePrintStmt*)allocate_node(sizeof(AstNodePrintStmt), NODE_PRINT_STMT, line);
     if (!node) return NULL;
-
-    node->node.type = NODE_PRINT_STMT;
-    node->node.line = line;
     node->expression = expression;
 
     return (AstNode*)node;
@@ -562,11 +608,8 @@ AstNode* new_print_stmt_node(AstNode* expression, int line) {
  * @brief Creates a new Integer Literal AST node
  */
 AstNode* new_int_literal_node(int value, int line) {
-    AstNodeIntLiteral* node = (AstNodeIntLiteral*)malloc(sizeof(AstNodeIntLiteral));
-    if (node == NULL) return NULL;
-    
-    node->node.type = NODE_INT_LITERAL;
-    node->node.line = line;
+    AstNodeIntLiteral* node = (AstNodeIntLiteral*)allocate_node(sizeof(AstNodeIntLiteral), NODE_INT_LITERAL, line);
+    if (!node) return NULL;
     node->value = value;
 
     return (AstNode*)node;
@@ -575,36 +618,32 @@ AstNode* new_int_literal_node(int value, int line) {
 /**
  * @brief Creates a new string literal node
  * 
- * @param value 
+ * @param chars  String content, borrowed (usually a slice of the source)
+ * @param length Number of bytes in `chars`
  * @param line 
  * @return AstNode* 
  */
-AstNode* new_string_literal_node(char* value, int line) {
-    AstNodeStringLiteral* node = (AstNodeStringLiteral*)malloc(sizeof(AstNodeStringLiteral));
+AstNode* new_string_literal_node(const char* chars, int length, int line) {
+    AstNodeStringLiteral* node = (AstNodeStringLiteral*)allocate_node(sizeof(AstNodeStringLiteral), NODE_STRING_LITERAL, line);
     if (!node) return NULL;
-    node->node.type = NODE_STRING_LITERAL;
-    node->node.line = line;
-    node->value = value;
+    node->chars = chars;
+    node->length = length;
+    node->ownsChars = 0;
     return (AstNode*)node;
 }
 
 
 AstNode* new_bool_literal_node(int value, int line) {
-    AstNodeBoolLiteral* node = (AstNodeBoolLiteral*)malloc(sizeof(AstNodeBoolLiteral));
+    AstNodeBoolLiteral* node = (AstNodeBoolLiteral*)allocate_node(sizeof(AstNodeBoolLiteral), NODE_BOOL_LITERAL, line);
     if (!node) return NULL;
-    node->node.type = NODE_BOOL_LITERAL;
-    node->node.line = line;
     node->value = value;
     return (AstNode*)node;
 }
 
 
 AstNode* new_expr_stmt_node(AstNode* expression, int line) {
-    AstNodeExprStmt* node = (AstNodeExprStmt*)malloc(sizeof(AstNodeExprStmt));
+    AstNodeExprStmt* node = (AstNodeExprStmt*)allocate_node(sizeof(AstNodeExprStmt), NODE_EXPR_STMT, line);
     if (!node) return NULL;
-
-    node->node.type = NODE_EXPR_STMT;
-    node->node.line = line;
     node->expression = expression;
 
     return (AstNode*)node;
@@ -614,10 +653,8 @@ AstNode* new_expr_stmt_node(AstNode* expression, int line) {
  * @brief Creates a new unary operator AST node
  */
 AstNode* new_unary_op_node(Token op, AstNode* operand, int line) {
-    AstNodeUnaryOp* node = (AstNodeUnaryOp*)malloc(sizeof(AstNodeUnaryOp));
+    AstNodeUnaryOp* node = (AstNodeUnaryOp*)allocate_node(sizeof(AstNodeUnaryOp), NODE_UNARY_OP, line);
     if (!node) return NULL;
-    node->node.type = NODE_UNARY_OP;
-    node->node.line = line;
     node->op = op;
     node->operand = operand;
     return (AstNode*)node;
@@ -627,11 +664,8 @@ AstNode* new_unary_op_node(Token op, AstNode* operand, int line) {
  * @brief Creates a new Binary Operator AST node
  */
 AstNode* new_binary_op_node(Token op, AstNode* left, AstNode* right, int line) {
-    AstNodeBinaryOp* node = (AstNodeBinaryOp*)malloc(sizeof(AstNodeBinaryOp));
-    if (node == NULL) return NULL;
-
-    node->node.type = NODE_BINARY_OP;
-    node->node.line = line;
+    AstNodeBinaryOp* node = (AstNodeBinaryOp*)allocate_node(sizeof(AstNodeBinaryOp), NODE_BINARY_OP, line);
+    if (!node) return NULL;
     node->op = op;
     node->left = left;
     node->right = right;
@@ -643,11 +677,8 @@ AstNode* new_binary_op_node(Token op, AstNode* left, AstNode* right, int line) {
  * @brief Creates a new Variable Assignment AST node
  */
 AstNode* new_var_assign_node(Token name, AstNode* expression, int line) {
-    AstNodeVarAssign* node = (AstNodeVarAssign*)malloc(sizeof(AstNodeVarAssign));
+    AstNodeVarAssign* node = (AstNodeVarAssign*)allocate_node(sizeof(AstNodeVarAssign), NODE_VAR_ASSIGN, line);
     if (!node) return NULL;
-
-    node->node.type = NODE_VAR_ASSIGN;
-    node->node.line = line;
     node->name = name;
     node->expression = expression;
 
@@ -664,10 +695,8 @@ AstNode* new_var_assign_node(Token name, AstNode* expression, int line) {
  * @return AstNode* 
  */
 AstNode* new_if_node(AstNode* condition, AstNode* thenBranch, AstNode* elseBranch, int line) {
-    AstNodeIf* node = (AstNodeIf*)malloc(sizeof(AstNodeIf));
+    AstNodeIf* node = (AstNodeIf*)allocate_node(sizeof(AstNodeIf), NODE_IF, line);
     if (!node) return NULL;
-    node->node.type = NODE_IF;
-    node->node.line = line;
     node->condition = condition;
     node->thenBranch = thenBranch;
     node->elseBranch = elseBranch;
@@ -683,10 +712,8 @@ AstNode* new_if_node(AstNode* condition, AstNode* thenBranch, AstNode* elseBranc
  * @return AstNode* 
  */
 AstNode* new_while_node(AstNode* condition, AstNode* body, int line) {
-    AstNodeWhile* node = (AstNodeWhile*)malloc(sizeof(AstNodeWhile));
+    AstNodeWhile* node = (AstNodeWhile*)allocate_node(sizeof(AstNodeWhile), NODE_WHILE, line);
     if (!node) return NULL;
-    node->node.type = NODE_WHILE;
-    node->node.line = line;
     node->condition = condition;
     node->body = body;
     return (AstNode*)node;
@@ -707,10 +734,8 @@ AstNode* new_while_node(AstNode* condition, AstNode* body, int line) {
  * @return AstNode* 
  */
 AstNode* new_func_decl_node(Token name, Token* params, int param_count, DataType returnType, AstNode* body, int line) {
-    AstNodeFuncDecl* node = (AstNodeFuncDecl*)malloc(sizeof(AstNodeFuncDecl));
+    AstNodeFuncDecl* node = (AstNodeFuncDecl*)allocate_node(sizeof(AstNodeFuncDecl), NODE_FUNC_DECL, line);
     if (!node) return NULL;
-    node->node.type = NODE_FUNC_DECL;
-    node->node.line = line;
     node->name = name;
     node->params = params; // Assumes caller allocated array
     node->param_count = param_count;
@@ -727,10 +752,8 @@ AstNode* new_func_decl_node(Token name, Token* params, int param_count, DataType
  * @return AstNode* 
  */
 AstNode* new_return_node(AstNode* value, int line) {
-    AstNodeReturn* node = (AstNodeReturn*)malloc(sizeof(AstNodeReturn));
+    AstNodeReturn* node = (AstNodeReturn*)allocate_node(sizeof(AstNodeReturn), NODE_RETURN, line);
     if (!node) return NULL;
-    node->node.type = NODE_RETURN;
-    node->node.line = line;
     node->value = value;
     return (AstNode*)node;
 }
@@ -745,10 +768,8 @@ AstNode* new_return_node(AstNode* value, int line) {
  * @return AstNode* 
  */
 AstNode* new_call_node(Token callee, AstNode** args, int arg_count, int line) {
-    AstNodeCall* node = (AstNodeCall*)malloc(sizeof(AstNodeCall));
+    AstNodeCall* node = (AstNodeCall*)allocate_node(sizeof(AstNodeCall), NODE_CALL, line);
     if (!node) return NULL;
-    node->node.type = NODE_CALL;
-    node->node.line = line;
     node->callee = callee;
     node->args = args; // Assumes caller allocated array
     node->arg_count = arg_count;
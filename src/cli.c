@@ -71,16 +71,45 @@ void print_help() {
     print_version();
     printf("\n");
     printf(BOLD "USAGE:\n" RESET);
-    printf("  determa [options] [file]\n");
+    printf("  determa [options] [file ...]\n");
     printf("\n");
     printf(BOLD "OPTIONS:\n" RESET);
     printf("  " GREEN "-h, --help" RESET "        Show this help message.\n");
     printf("  " GREEN "-v, --version" RESET "     Show version information.\n");
     printf("  " GREEN "-d, --pda-debug" RESET "   Enable Parser/PDA stack trace logging.\n");
+    printf("  " GREEN "-O, -O1" RESET "           Fold constants and prune constant branches.\n");
+    printf("  " GREEN "-O0" RESET "               Disable AST optimizations (default).\n");
+    printf("  " GREEN "--no-cache" RESET "        Always recompile; don't read or write <file>.detc.\n");
+    printf("  " GREEN "--no-fuse" RESET "         Typecheck and compile in separate passes (at -O0).\n");
+    printf("  " GREEN "--max-depth <n>" RESET "   Maximum call depth (default 4096).\n");
+    printf("  " GREEN "--stack-size <n>" RESET "  Maximum operand stack size in values (default 4194304).\n");
+    printf("  " GREEN "--gc-step <n>" RESET "     Collect incrementally, <n> objects per slice (default: all at once).\n");
+    printf("  " GREEN "--gc-grow <f>" RESET "     Next collection at live heap x <f> (default 2).\n");
+    printf("  " GREEN "--gc-initial <n>" RESET "  First collection after <n> bytes (default 1048576).\n");
+    printf("  " GREEN "--gc-threads <n>" RESET "  Trace full collections on <n> threads (default 1).\n");
+    printf("  " GREEN "--gc-stats" RESET "        Print garbage collector statistics on exit.\n");
+    printf("  " GREEN "--profile" RESET "         Profile opcodes, functions and lines; report on exit.\n");
+    printf("  " GREEN "--profile-folded <f>" RESET " Profile and write folded stacks to <f> (flamegraph.pl).\n");
+    printf("  " GREEN "--profile-alloc" RESET "   Charge allocations to opcodes and source lines; report on exit.\n");
+    printf("  " GREEN "--dump-bytecode" RESET "   List the bytecode of each function, with size statistics, on stderr.\n");
+    printf("  " GREEN "--trace-execution" RESET " Print each instruction with the operand stack, calls and returns, on stderr.\n");
+    printf("  " GREEN "--register-vm" RESET "     Run on the register-based VM instead of the stack VM.\n");
+    printf("  " GREEN "--jit" RESET "             Compile hot functions to machine code (x86-64).\n");
+    printf("  " GREEN "--unsafe-fast" RESET "     Verify the bytecode, then run it without the type checks it proves.\n");
+    printf("  " GREEN "--memoize" RESET "         Cache the results of pure functions by their arguments.\n");
+    printf("  " GREEN "--snapshot-save <f>" RESET " After the run, save the globals and what they hold to <f>.\n");
+    printf("  " GREEN "--snapshot <f>" RESET "    Start from the globals saved in <f> (skips re-running a prelude).\n");
+    printf("  " GREEN "--output-buffer <n>" RESET " Buffer <n> bytes of program output (default 65536).\n");
+    printf("  " GREEN "--batch" RESET "           Run every file (or .det file in a directory) given, in parallel.\n");
+    printf("  " GREEN "-j, --jobs <n>" RESET "    Worker threads for --batch and parsing (default: one per processor).\n");
     printf("\n");
     printf(BOLD "EXAMPLES:\n" RESET);
     printf("  " cyan("determa") "                  Start Interactive REPL\n");
     printf("  " cyan("determa script.det") "       Run a script file\n");
     printf("  " cyan("determa -d script.det") "    Run with debug mode\n");
+    printf("  " cyan("determa -O script.det") "    Run with AST optimizations\n");
+    printf("  " cyan("determa --batch jobs/") "    Run every script in jobs/ on all cores\n");
+    printf("  " cyan("determa --snapshot-save p.dets prelude.det") "  Run a prelude once and save it\n");
+    printf("  " cyan("determa --snapshot p.dets main.det") "        Run main.det after that prelude\n");
     printf("\n");
 }
@@ -0,0 +1,142 @@
+/**
+ * @file file_map.c
+ * @brief mmap / MapViewOfFile file views with a heap fallback.
+ *
+ * @version 0.1
+ * @date 2026-10-14
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+
+#include "file_map.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/**
+ * @brief Fallback: read the whole file into a NUL-terminated heap buffer.
+ */
+static bool read_into_heap(FileMap* map, const char* path) {
+    FILE* file = fopen(path, "rb");
+    if (file == NULL) return false;
+
+    fseek(file, 0L, SEEK_END);
+    long fileSize = ftell(file);
+    rewind(file);
+    if (fileSize < 0) {
+        fclose(file);
+        return false;
+    }
+
+    char* buffer = (char*)malloc((size_t)fileSize + 1);
+    if (buffer == NULL || fread(buffer, 1, (size_t)fileSize, file) != (size_t)fileSize) {
+        free(buffer);
+        fclose(file);
+        return false;
+    }
+    fclose(file);
+
+    buffer[fileSize] = '\0';
+    map->data = buffer;
+    map->length = (size_t)fileSize;
+    map->mappedLength = 0;
+    return true;
+}
+
+#ifndef _WIN32
+
+static bool map_view(FileMap* map, const char* path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size <= 0) {
+        close(fd);
+        return false;
+    }
+    size_t length = (size_t)st.st_size;
+
+    // Reserve length + 1 bytes of zero pages, then map the file over the
+    // front: the NUL after it is either the file's zero-filled last page
+    // or the reserved page that follows
+    char* region = (char*)mmap(NULL, length + 1, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (region == MAP_FAILED) {
+        close(fd);
+        return false;
+    }
+    void* view = mmap(region, length, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0);
+    close(fd);
+    if (view == MAP_FAILED) {
+        munmap(region, length + 1);
+        return false;
+    }
+
+    map->data = region;
+    map->length = length;
+    map->mappedLength = length + 1;
+    return true;
+}
+
+#else
+
+static bool map_view(FileMap* map, const char* path) {
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) return false;
+
+    LARGE_INTEGER size;
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    if (!GetFileSizeEx(file, &size) || size.QuadPart <= 0 ||
+        (unsigned long long)size.QuadPart % info.dwPageSize == 0) {
+        // No zero tail to terminate the view with: read it instead
+        CloseHandle(file);
+        return false;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    CloseHandle(file);
+    if (mapping == NULL) return false;
+
+    void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping); // The view keeps the mapping alive
+    if (view == NULL) return false;
+
+    map->data = (const char*)view;
+    map->length = (size_t)size.QuadPart;
+    map->mappedLength = map->length;
+    return true;
+}
+
+#endif
+
+bool file_map_open(FileMap* map, const char* path) {
+    // Empty files, pipes and anything mmap refuses are read instead
+    return map_view(map, path) || read_into_heap(map, path);
+}
+
+void file_map_close(FileMap* map) {
+    if (map->data == NULL) return;
+    if (map->mappedLength > 0) {
+#ifdef _WIN32
+        UnmapViewOfFile((void*)map->data);
+#else
+        munmap((void*)map->data, map->mappedLength);
+#endif
+    } else {
+        free((void*)map->data);
+    }
+    map->data = NULL;
+    map->length = 0;
+    map->mappedLength = 0;
+}
@@ -6,6 +6,13 @@
  * This is a hand-written DFA. The get_next_token() function
  * acts as the main "simulator" loop, and the switch statements
  * act as the DFA's transition table.
+ *
+ * Long runs (whitespace, comment bodies, identifiers, digits and string
+ * bodies) are skipped 16 bytes at a time with SSE2 or NEON compares once
+ * they pass SHORT_RUN bytes, counting the newlines of each block with a
+ * popcount; the scalar loops then finish the run. Blocks are only loaded while all 16 bytes lie
+ * before the terminating NUL. Without SIMD support (or with
+ * -DDETERMA_NO_SIMD) only the scalar loops run.
  * 
  * @version 0.1
  * @date 2025-11-18
@@ -18,6 +25,15 @@
 
 #include <string.h> // For memcmp, strlen
 #include <ctype.h>  // For isalpha, isdigit
+#include <stdint.h>
+
+#if !defined(DETERMA_NO_SIMD) && defined(__GNUC__) && defined(__SSE2__)
+#include <emmintrin.h>
+#define LEXER_SIMD 1
+#elif !defined(DETERMA_NO_SIMD) && defined(__GNUC__) && defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define LEXER_SIMD 1
+#endif
 
 /**
  * @brief Initializes a new Lexer.
@@ -28,9 +44,147 @@ Lexer init_lexer(const char* source) {
     lexer.start = 0;
     lexer.current = 0;
     lexer.line = 1;
+    lexer.length = (int)strlen(source);
     return lexer;
 }
 
+// --- Block Scanning ---
+
+// Runs shorter than this stay on the scalar path: most identifiers and
+// gaps between tokens are a few bytes, where a block load doesn't pay off
+#define SHORT_RUN 8
+
+#ifdef LEXER_SIMD
+
+#define BLOCK_SIZE 16
+
+/*
+ * A Block holds 16 source bytes; a compare yields 0xff in every matching
+ * byte, and block_mask() packs that into an integer with MASK_BITS bits
+ * per byte (SSE2 has movemask; on NEON a narrowing shift leaves a nibble
+ * per byte).
+ */
+#ifdef __SSE2__
+typedef __m128i Block;
+#define MASK_BITS 1
+
+static inline Block load_block(const char* p) { return _mm_loadu_si128((const __m128i*)p); }
+static inline Block block_eq(Block b, char c) { return _mm_cmpeq_epi8(b, _mm_set1_epi8(c)); }
+static inline Block block_or(Block a, Block b) { return _mm_or_si128(a, b); }
+static inline Block block_range(Block b, char lo, char hi) {
+    // Signed compares: bytes >= 0x80 are negative and never in an ASCII range
+    return _mm_and_si128(_mm_cmpgt_epi8(b, _mm_set1_epi8((char)(lo - 1))),
+                         _mm_cmplt_epi8(b, _mm_set1_epi8((char)(hi + 1))));
+}
+static inline Block block_lower(Block b) { return _mm_or_si128(b, _mm_set1_epi8(0x20)); }
+static inline uint64_t block_mask(Block b) { return (uint64_t)_mm_movemask_epi8(b); }
+#else
+typedef uint8x16_t Block;
+#define MASK_BITS 4
+
+static inline Block load_block(const char* p) { return vld1q_u8((const uint8_t*)p); }
+static inline Block block_eq(Block b, char c) { return vceqq_u8(b, vdupq_n_u8((uint8_t)c)); }
+static inline Block block_or(Block a, Block b) { return vorrq_u8(a, b); }
+static inline Block block_range(Block b, char lo, char hi) {
+    return vandq_u8(vcgeq_u8(b, vdupq_n_u8((uint8_t)lo)), vcleq_u8(b, vdupq_n_u8((uint8_t)hi)));
+}
+static inline Block block_lower(Block b) { return vorrq_u8(b, vdupq_n_u8(0x20)); }
+static inline uint64_t block_mask(Block b) {
+    return vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(b), 4)), 0);
+}
+#endif
+
+#define FULL_MASK (MASK_BITS * BLOCK_SIZE == 64 ? ~(uint64_t)0 : ((uint64_t)1 << (MASK_BITS * BLOCK_SIZE)) - 1)
+
+/**
+ * @brief Number of leading bytes whose bits are set in `mask` (0..16).
+ */
+static inline int leading_run(uint64_t mask) {
+    uint64_t miss = ~mask & FULL_MASK;
+    return miss == 0 ? BLOCK_SIZE : __builtin_ctzll(miss) / MASK_BITS;
+}
+
+/**
+ * @brief Number of bytes among the first `run` that are set in `mask`.
+ */
+static inline int count_in_run(uint64_t mask, int run) {
+    int bits = run * MASK_BITS;
+    if (bits < 64) mask &= ((uint64_t)1 << bits) - 1;
+    return __builtin_popcountll(mask) / MASK_BITS;
+}
+
+static inline int block_fits(Lexer* lexer) {
+    return lexer->current + BLOCK_SIZE <= lexer->length;
+}
+
+/**
+ * @brief Skip spaces, tabs, carriage returns and newlines a block at a time.
+ */
+static void skip_blank_blocks(Lexer* lexer) {
+    while (block_fits(lexer)) {
+        Block b = load_block(lexer->source + lexer->current);
+        Block newlines = block_eq(b, '\n');
+        Block blank = block_or(block_or(block_eq(b, ' '), block_eq(b, '\t')),
+                               block_or(block_eq(b, '\r'), newlines));
+        int run = leading_run(block_mask(blank));
+        lexer->line += count_in_run(block_mask(newlines), run);
+        lexer->current += run;
+        if (run < BLOCK_SIZE) return;
+    }
+}
+
+/**
+ * @brief Skip a comment body up to (not past) its newline.
+ */
+static void skip_line_blocks(Lexer* lexer) {
+    while (block_fits(lexer)) {
+        uint64_t newline = block_mask(block_eq(load_block(lexer->source + lexer->current), '\n'));
+        if (newline != 0) {
+            lexer->current += __builtin_ctzll(newline) / MASK_BITS;
+            return;
+        }
+        lexer->current += BLOCK_SIZE;
+    }
+}
+
+/**
+ * @brief Skip [A-Za-z0-9_] (`digitsOnly`: [0-9]) a block at a time.
+ */
+static void skip_word_blocks(Lexer* lexer, int digitsOnly) {
+    while (block_fits(lexer)) {
+        Block b = load_block(lexer->source + lexer->current);
+        Block word = block_range(b, '0', '9');
+        if (!digitsOnly) {
+            word = block_or(word, block_or(block_range(block_lower(b), 'a', 'z'), block_eq(b, '_')));
+        }
+        int run = leading_run(block_mask(word));
+        lexer->current += run;
+        if (run < BLOCK_SIZE) return;
+    }
+}
+
+/**
+ * @brief Skip a string body up to (not past) its closing quote.
+ */
+static void skip_string_blocks(Lexer* lexer) {
+    while (block_fits(lexer)) {
+        Block b = load_block(lexer->source + lexer->current);
+        int run = leading_run(~block_mask(block_eq(b, '"')) & FULL_MASK);
+        lexer->line += count_in_run(block_mask(block_eq(b, '\n')), run);
+        lexer->current += run;
+        if (run < BLOCK_SIZE) return;
+    }
+}
+
+#else
+
+static inline void skip_blank_blocks(Lexer* lexer) { (void)lexer; }
+static inline void skip_line_blocks(Lexer* lexer) { (void)lexer; }
+static inline void skip_word_blocks(Lexer* lexer, int digitsOnly) { (void)lexer; (void)digitsOnly; }
+static inline void skip_string_blocks(Lexer* lexer) { (void)lexer; }
+
+#endif
+
 // --- Helper Functions ---
 
 /**
@@ -85,6 +239,7 @@ static Token error_token(Lexer* lexer, const char* message) {
  * This is part of the DFA's "start" state logic.
  */
 static void skip_whitespace(Lexer* lexer) {
+    int blanks = 0;
     for (;;) {
         char c = peek(lexer);
         switch (c) {
@@ -92,14 +247,17 @@ static void skip_whitespace(Lexer* lexer) {
             case '\r':
             case '\t':
                 advance(lexer);
+                if (++blanks == SHORT_RUN) skip_blank_blocks(lexer);
                 break;
             case '\n': // Newline
                 lexer->line++;
                 advance(lexer);
+                if (++blanks == SHORT_RUN) skip_blank_blocks(lexer);
                 break;
             case '/': // A comment?
                 if (peek_next(lexer) == '/') {
                     // A single-line comment. Consume until the end of the line.
+                    skip_line_blocks(lexer);
                     while (peek(lexer) != '\n' && !is_at_end(lexer)) {
                         advance(lexer);
                     }
@@ -114,100 +272,63 @@ static void skip_whitespace(Lexer* lexer) {
     }
 }
 
+// --- Keywords ---
+
+#define MAX_KEYWORD_LENGTH 6
+#define KEYWORD_SLOTS 32
+
 /**
- * @brief Helper to check if a lexeme is a keyword.
+ * @brief Slot of a lexeme in the keyword table.
+ *
+ * (first char + last char + length) happens to be collision-free over the
+ * keyword set modulo 32, so each slot holds at most one keyword. A new
+ * keyword must land on an empty slot (test_lexer_keywords checks every
+ * entry); if none is left, change the hash and rebuild the table.
  */
-static TokenType check_keyword(Lexer* lexer, int start, int length, const char* rest, TokenType type) {
-    // Check if the length matches and the string matches
-    if (lexer->current - lexer->start == start + length && memcmp(lexer->source + lexer->start + start, rest, length) == 0) {
-        return type;
-    }
-    return TOKEN_ID; // Not a keyword, just a regular identifier
+static inline unsigned keyword_slot(const char* lexeme, int length) {
+    return ((unsigned char)lexeme[0] + (unsigned char)lexeme[length - 1] + (unsigned)length) & (KEYWORD_SLOTS - 1);
 }
 
+static const struct {
+    const char* name;
+    int length;
+    TokenType type;
+} keywords[KEYWORD_SLOTS] = {
+    [0]  = { "int",    3, TOKEN_TYPE_INT },
+    [1]  = { "while",  5, TOKEN_WHILE },
+    [6]  = { "return", 6, TOKEN_RETURN },
+    [8]  = { "str",    3, TOKEN_TYPE_STRING },
+    [9]  = { "print",  5, TOKEN_PRINT },
+    [11] = { "var",    3, TOKEN_VAR },
+    [13] = { "func",   4, TOKEN_FUNC },
+    [14] = { "else",   4, TOKEN_ELSE },
+    [15] = { "elif",   4, TOKEN_ELIF },
+    [16] = { "false",  5, TOKEN_FALSE },
+    [17] = { "if",     2, TOKEN_IF },
+    [18] = { "bool",   4, TOKEN_TYPE_BOOL },
+    [29] = { "true",   4, TOKEN_TRUE },
+    [30] = { "void",   4, TOKEN_TYPE_VOID },
+};
+
 /**
- * @brief Reads the rest of an identifier. 
- * 
- * This is a simple state machine (a "Trie") for checking keywords.
+ * @brief Keyword type of the current lexeme, or TOKEN_ID.
+ *
+ * One hash step and one compare, however many keywords there are.
  */
 static TokenType identifier_type(Lexer* lexer) {
-    switch (lexer->source[lexer->start]) {
-        // print
-        case 'p':
-            return check_keyword(lexer, 1, 4, "rint", TOKEN_PRINT);
-        
-        // var or void
-        case 'v': {
-            int length = lexer->current - lexer->start;
-            if (length == 3) {
-                return check_keyword(lexer, 1, 2, "ar", TOKEN_VAR);
-            }
-
-            if (length == 4) {
-                return check_keyword(lexer, 1, 3, "oid", TOKEN_TYPE_VOID);
-            }
-            return TOKEN_ID;
-        }
-
-        // true
-        case 't':
-            return check_keyword(lexer, 1, 3, "rue", TOKEN_TRUE);
-        
-        // false or func
-        case 'f': {
-            int length = lexer->current - lexer->start;
-            if (length == 4) {
-                return check_keyword(lexer, 1, 3, "unc", TOKEN_FUNC);
-            }
-            if (length == 5) {
-                return check_keyword(lexer, 1, 4, "alse", TOKEN_FALSE);
-            }
-            return TOKEN_ID;
-        }
+    const char* lexeme = lexer->source + lexer->start;
+    int length = lexer->current - lexer->start;
+    if (length > MAX_KEYWORD_LENGTH) return TOKEN_ID;
 
-        // if or int
-        case 'i': {
-            int length = lexer->current - lexer->start;
-            if (length == 2) {
-                return check_keyword(lexer, 1, 1, "f", TOKEN_IF);
-            }
-
-            if (length == 3) {
-                return check_keyword(lexer, 1, 2,  "nt", TOKEN_TYPE_INT);
-            }
-
-            return TOKEN_ID;
-        }
-        
-        // else or elif
-        case 'e': {
-            int length = lexer->current - lexer->start;
-            if (length == 4) {
-                if (memcmp(lexer->source + lexer->start, "elif", 4) == 0) {
-                    return TOKEN_ELIF;
-                }
-                if (memcmp(lexer->source + lexer->start, "else", 4) == 0) {
-                    return TOKEN_ELSE;
-                }
-            }
-            return TOKEN_ID;
-        }
+    unsigned slot = keyword_slot(lexeme, length);
+    if (keywords[slot].length != length) return TOKEN_ID;
 
-        // while
-        case 'w':
-            return check_keyword(lexer, 1, 4, "hile", TOKEN_WHILE);
-        // return
-        case 'r':
-            return check_keyword(lexer, 1, 5, "eturn", TOKEN_RETURN);
-
-        // bool
-        case 'b':
-            return check_keyword(lexer, 1, 3, "ool", TOKEN_TYPE_BOOL);
-        // str
-        case 's':
-            return check_keyword(lexer, 1, 2, "tr",TOKEN_TYPE_STRING);
+    // Keywords are at most 6 bytes: a loop beats a memcmp() call
+    const char* name = keywords[slot].name;
+    for (int i = 0; i < length; i++) {
+        if (lexeme[i] != name[i]) return TOKEN_ID; // Not a keyword, just a regular identifier
     }
-    return TOKEN_ID; // Default to identifier
+    return keywords[slot].type;
 }
 
 /**
@@ -217,6 +338,7 @@ static Token read_identifier(Lexer* lexer) {
     // Consume all alphanumeric characters (and _)
     while (isalnum(peek(lexer)) || peek(lexer) == '_') {
         advance(lexer);
+        if (lexer->current - lexer->start == SHORT_RUN) skip_word_blocks(lexer, 0);
     }
     // Check if the identifier is actually a keyword
     return make_token(lexer, identifier_type(lexer));
@@ -228,6 +350,7 @@ static Token read_identifier(Lexer* lexer) {
 static Token read_number(Lexer* lexer) {
     while (isdigit(peek(lexer))) {
         advance(lexer);
+        if (lexer->current - lexer->start == SHORT_RUN) skip_word_blocks(lexer, 1);
     }
     return make_token(lexer, TOKEN_INT);
 }
@@ -243,6 +366,7 @@ static Token string(Lexer* lexer) {
     while (peek(lexer) != '"' && !is_at_end(lexer)) {
         if (peek(lexer) == '\n') lexer->line++;
         advance(lexer);
+        if (lexer->current - lexer->start == SHORT_RUN) skip_string_blocks(lexer);
     }
 
     if (is_at_end(lexer)) {
@@ -13,15 +13,33 @@
 #include <stdlib.h>
 #include <string.h> 
 #include <stdarg.h>
+#include <limits.h>
 
 #include "parser.h" 
 #include "ast.h"   
 #include "typechecker.h"
+#include "optimizer.h"
 #include "vm/common.h"
 #include "vm/vm.h"
 #include "vm/compiler.h"
+#include "vm/natives.h"
+#include "vm/profiler.h"
+#include "vm/alloc_profiler.h"
+#include "vm/serialize.h"
+#include "vm/jit.h"
+#include "vm/disassembler.h"
+#include "vm/trace.h"
 #include "colours.h"
 #include "cli.h"
+#include "file_map.h"
+#include "thread_pool.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <sys/stat.h>
+#endif
 
 #include "version.h"
 
@@ -31,92 +49,552 @@ typedef struct {
     int pda_debug;
     int show_version;
     int show_help;
+    int opt_level;          // OptLevel for the AST optimizer (-O0 / -O1)
+    int fuse_passes;        // Typecheck while compiling when nothing runs in between (-O0)
+    int use_cache;          // Read/write the .detc bytecode cache in file mode
+    int max_depth;          // Max call depth (0 = VM default)
+    int stack_size;         // Max operand stack size in Values (0 = VM default)
+    int gc_step;            // Incremental GC work per slice (0 = stop-the-world)
+    int gc_stats;           // Print collector counters on exit
+    double gc_grow;         // Heap grow factor (0 = VM default)
+    int gc_initial;         // First collection threshold in bytes (0 = VM default)
+    int gc_threads;         // Threads tracing full collections (0 = VM default)
+    int profile;            // Profile the VM and print the report on exit
+    const char* profile_folded; // Also write folded stacks here (flamegraphs)
+    int profile_alloc;      // Charge allocations to opcodes and lines; report on exit
+    int register_vm;        // Run on the register VM (regcode.h)
+    int jit;                // Compile hot functions to machine code (jit.h)
+    int unsafe_fast;        // Verify bytecode, then drop the type checks it proves (verify.h)
+    int memoize;            // Cache the results of pure functions (memo.h)
+    int output_buffer;      // Bytes of script output buffered (0 = VM default)
+    int batch;              // Run every file given on a worker thread pool
+    int jobs;               // Batch worker threads (0 = one per processor)
+    int dump_bytecode;      // List each unit's bytecode on stderr before it runs
+    int trace_execution;    // Print every instruction and the stack on stderr (trace.h)
+    const char* snapshot;       // Restore the globals from this heap snapshot first (serialize.h)
+    const char* snapshot_save;  // Write a heap snapshot here after the run
     const char* file_path;
 } CliConfig;
 
-static CliConfig config = {0, 0, 0, NULL};
+static CliConfig config = {0, 0, 0, OPT_LEVEL_NONE, 1, 1, 0, 0, 0, 0, 0.0, 0, 0, 0, NULL, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, NULL, NULL, NULL};
 
 // --- Core Pipeline ---
 
-static void run_source(const char* source) {
+/**
+ * @brief Free a unit's AST (see run_source()).
+ */
+static void release_ast(AstNode* ast, Arena* scratch) {
+    free_ast(ast);
+    if (scratch != NULL) arena_reset(scratch);
+}
+
+/**
+ * @brief Check, compile and run the parsed unit `ast`, then free it.
+ *
+ * @param source    The unit's source text.
+ * @param cachePath Where to save the compiled bytecode, or NULL (REPL, --no-cache).
+ * @param scratch   The arena the tree was built in (reset once the unit is
+ *                  done), or NULL if it has an arena of its own.
+ * @return INTERPRET_COMPILE_ERROR if it did not get to run, else how the run ended.
+ */
+static InterpretResult run_ast(AstNode* ast, const char* source, const char* cachePath, Arena* scratch) {
+    ObjFunction* function;
+    int priorGlobals = compiler_global_count(); // What the unit is checked against (see serialize.h)
+
+    if (config.fuse_passes && config.opt_level == OPT_LEVEL_NONE) {
+        // 2-4. Nothing runs between checking and compiling: do both in one walk
+        function = compile_checked_ast(ast);
+    } else {
+        // 2. Type Check
+        if (!typecheck_ast(ast)) {
+            // Typechecker prints its own errors
+            release_ast(ast, scratch);
+            return INTERPRET_COMPILE_ERROR;
+        }
+
+        // 3. Optimize (constant folding, dead branches) if enabled
+        optimize_ast(ast, config.opt_level);
+
+        // 4. Compile AST into a function object
+        function = compile_ast(ast);  // <-- new API
+    }
+
+    if (function == NULL) {
+        // Typechecker / compiler printed their own errors
+        release_ast(ast, scratch);
+        return INTERPRET_COMPILE_ERROR;
+    }
+
+    // 5. Save the bytecode so the next run can skip steps 1-4
+    if (cachePath != NULL) {
+        write_bytecode_cache(cachePath, function, priorGlobals,
+                             hash_source(source, strlen(source)), (uint32_t)config.opt_level);
+    }
+
+    if (config.dump_bytecode) disassemble_unit(stderr, function);
+
+    // 6. Run on the VM, then drop the script's code right away (a REPL
+    // session would otherwise pile one up per line until the next GC)
+    InterpretResult result = interpret(function);
+    vm_release_script(currentVM, function);
+
+    // 7. Cleanup AST (the function is now owned by the VM/GC)
+    release_ast(ast, scratch);
+    return result;
+}
+
+/**
+ * @brief Parse, check, compile and run one unit of source.
+ *
+ * @param scratch Arena to build the AST in (reset once the unit is done),
+ *                or NULL to give the tree an arena of its own.
+ * @see run_ast()
+ */
+static InterpretResult run_source(const char* source, const char* cachePath, Arena* scratch) {
  // 1. Parse
-    AstNode* ast = parse(source, config.pda_debug);
+    AstNode* ast = scratch != NULL ? parse_in_arena(source, config.pda_debug, scratch)
+                                   : parse(source, config.pda_debug);
 
     if (ast == NULL) {
         // Parser already printed errors
-        return;
+        if (scratch != NULL) arena_reset(scratch);
+        return INTERPRET_COMPILE_ERROR;
     }
 
-    // 2. Type Check
-    if (!typecheck_ast(ast)) {
-        // Typechecker prints its own errors
-        free_ast(ast);
-        return;
-    }
+    return run_ast(ast, source, cachePath, scratch);
+}
 
-    // 3. Compile AST into a function object
-    ObjFunction* function = compile_ast(ast);  // <-- new API
+/**
+ * @brief Print the VM's collector counters (--gc-stats) to stderr.
+ */
+static void report_gc_stats(void) {
+    const GcStats* stats = &vm.gcStats;
+    fprintf(stderr, "\n" BOLD "GC stats:" RESET "\n");
+    fprintf(stderr, "  collections      %llu (%llu minor, %llu incremental slices)\n",
+            (unsigned long long)stats->collections, (unsigned long long)stats->minorCollections,
+            (unsigned long long)stats->slices);
+    fprintf(stderr, "  pause total      %.3f ms (max %.3f ms)\n",
+            stats->totalPauseNs / 1e6, stats->maxPauseNs / 1e6);
+    fprintf(stderr, "  lazy sweeps      %llu batches\n", (unsigned long long)stats->lazySweeps);
+    fprintf(stderr, "  freed            %llu bytes in %llu objects\n",
+            (unsigned long long)stats->bytesFreed, (unsigned long long)stats->objectsFreed);
+    fprintf(stderr, "  promoted         %llu bytes\n", (unsigned long long)stats->bytesPromoted);
+    fprintf(stderr, "  peak heap        %zu bytes (now %zu, next GC at %zu)\n",
+            stats->peakBytesAllocated, vm.bytesAllocated, vm.nextGC);
+    if (vm.gcThreads > 1) {
+        fprintf(stderr, "  parallel marks   %llu (%d threads)\n",
+                (unsigned long long)stats->parallelMarks, vm.gcThreads);
+    }
+}
 
-    if (function == NULL) {
-        // Compiler printed its own errors
-        free_ast(ast);
-        return;
+/**
+ * @brief Print the profile (--profile) to stderr and write the folded
+ * stacks (--profile-folded).
+ */
+static void report_profile(void) {
+    if (vm.profiler == NULL) return;
+    profiler_report(vm.profiler, stderr);
+    if (config.profile_folded != NULL && !profiler_write_folded(vm.profiler, config.profile_folded)) {
+        cli_warn("Could not write profile to '%s'.", config.profile_folded);
     }
+}
 
-    // 4. Run on the VM
-    interpret(function);
+static void report_alloc_profile(void) {
+    if (vm.allocProfiler == NULL) return;
+    alloc_profiler_report(vm.allocProfiler, stderr);
+}
 
-    // 5. Cleanup AST (the function is now owned by the VM/GC)
-    free_ast(ast);
+/**
+ * @brief Cache file for a script: "main.det" -> "main.detc", anything else gets ".detc" appended.
+ */
+static char* cache_path_for(const char* path) {
+    size_t length = strlen(path);
+    const char* ext = strrchr(path, '.');
+    const char* suffix = (ext && strcmp(ext, ".det") == 0) ? "c" : ".detc";
+
+    char* cachePath = (char*)malloc(length + strlen(suffix) + 1);
+    if (cachePath == NULL) return NULL;
+    memcpy(cachePath, path, length);
+    strcpy(cachePath + length, suffix);
+    return cachePath;
 }
 
-static char* read_file_contents(const char* path) {
-    FILE* file = fopen(path, "rb");
-    if (file == NULL) {
-        cli_error("Could not open file \"%s\". Check permissions or path.", path);
+/**
+ * @brief Warn about a script path that does not end in ".det".
+ */
+static void check_extension(const char* path) {
+    const char* ext = strrchr(path, '.');
+    if (!ext || strcmp(ext, ".det") != 0) {
+        cli_warn("File '%s' does not end with .det extension.", path);
+    }
+}
+
+/**
+ * @brief Run the script in `sourceFile` on the current VM, straight from
+ * the .detc cache of `path` when the source has not changed since.
+ *
+ * @param useCache Read and write the cache.
+ */
+static InterpretResult run_script(const char* path, const FileMap* sourceFile, bool useCache) {
+    const char* source = sourceFile->data;
+    char* cachePath = useCache ? cache_path_for(path) : NULL;
+    ObjFunction* cached = NULL;
+
+    if (cachePath != NULL) {
+        cached = load_bytecode_cache(cachePath, hash_source(source, strlen(source)),
+                                     (uint32_t)config.opt_level);
+    }
+
+    InterpretResult result;
+    if (cached != NULL) {
+        // Source unchanged since the cache was written: run it directly
+        if (config.dump_bytecode) disassemble_unit(stderr, cached);
+        result = interpret(cached);
+    } else {
+        result = run_source(source, cachePath, NULL);
     }
 
-    fseek(file, 0L, SEEK_END);
-    size_t fileSize = ftell(file);
-    rewind(file);
+    free(cachePath);
+    return result;
+}
 
-    char* buffer = (char*)malloc(fileSize + 1);
-    if (buffer == NULL) {
-        cli_error("Not enough memory to read \"%s\".", path);
+/**
+ * @brief Restore the heap snapshot given with --snapshot into the fresh VM.
+ */
+static void load_snapshot(void) {
+    if (config.snapshot == NULL) return;
+
+    ObjFunction* unit = load_heap_snapshot(config.snapshot, &vm);
+    if (unit == NULL) {
+        cli_error("Could not load snapshot '%s' (missing, stale or from another build).", config.snapshot);
+    }
+    if (interpret(unit) != INTERPRET_OK) {
+        cli_error("Could not load snapshot '%s'.", config.snapshot);
     }
+    vm_release_script(&vm, unit);
+}
+
+/**
+ * @brief Write the --snapshot-save heap snapshot of a run that ended `result`.
+ */
+static void save_snapshot(InterpretResult result) {
+    if (config.snapshot_save == NULL) return;
 
-    size_t bytesRead = fread(buffer, sizeof(char), fileSize, file);
-    if (bytesRead < fileSize) {
-        cli_error("Could not read file \"%s\".", path);
+    if (result != INTERPRET_OK) {
+        cli_warn("No snapshot written: the run did not finish.");
+    } else if (!write_heap_snapshot(config.snapshot_save, &vm)) {
+        cli_warn("Could not write snapshot to '%s'.", config.snapshot_save);
     }
+}
 
-    buffer[bytesRead] = '\0';
-    fclose(file);
-    return buffer;
+/**
+ * @brief End a file run: flush the program's output, print the reports
+ * asked for and free the VM.
+ */
+static void finish_run(void) {
+    vm_flush_output(&vm); // Program output before the reports
+    if (config.gc_stats) report_gc_stats();
+    if (config.profile) report_profile();
+    if (config.profile_alloc) report_alloc_profile();
+    free_typechecker();
+    free_vm();
 }
 
 static void run_file_mode() {
     // File extension check (Polished)
-    const char* ext = strrchr(config.file_path, '.');
-    if (!ext || strcmp(ext, ".det") != 0) {
-        cli_warn("File '%s' does not end with .det extension.", config.file_path);
-    }
+    check_extension(config.file_path);
 
     // Give feedback to the user
     cli_info("Reading file: %s", config.file_path);
 
-    char* source = read_file_contents(config.file_path);
+    // The lexer reads straight out of the mapping (zero copy): it must stay
+    // open until the AST is gone
+    FileMap sourceFile;
+    if (!file_map_open(&sourceFile, config.file_path)) {
+        cli_error("Could not read file \"%s\". Check permissions or path.", config.file_path);
+    }
     
     // Initialize Persistent Systems
     init_vm();
     init_typechecker();
     init_compiler();
+    vm_define_core_natives(&vm);
+    load_snapshot();
 
-    run_source(source);
-    
-    free(source);
+    save_snapshot(run_script(config.file_path, &sourceFile, config.use_cache));
+
+    file_map_close(&sourceFile);
+    finish_run();
+}
+
+// --- Multi-file Programs ---
+
+/**
+ * @struct ProgramFile
+ * @brief One file of a multi-file program, parsed ahead of the run.
+ */
+typedef struct {
+    const char* path;
+    FileMap source;         // Open until the tree is gone (tokens point into it)
+    bool readable;
+    Arena arena;            // The tree's own arena, one per file
+    AstNode* ast;           // NULL on a parse error
+} ProgramFile;
+
+/**
+ * @brief Lex and parse one file of the program (PoolTask).
+ *
+ * The parser keeps no state outside the tree's arena and its thread's
+ * locals, so files parse in parallel; nothing here touches a VM.
+ */
+static void parse_program_file(void* context, int index, int worker) {
+    (void)worker;
+    ProgramFile* file = &((ProgramFile*)context)[index];
+    file->readable = file_map_open(&file->source, file->path);
+    if (file->readable) file->ast = parse_in_arena(file->source.data, config.pda_debug, &file->arena);
+}
+
+/**
+ * @brief Several files: one program, run file after file on one VM (each
+ * file is a unit, so later files see the globals of earlier ones).
+ *
+ * All the files are lexed and parsed up front, in parallel, on a thread
+ * pool (-j). Checking, compiling and running stay on this thread, in file
+ * order: a file's types depend on the globals the files before it declare.
+ * Nothing runs if a file does not parse, and the run stops at the first
+ * file that fails. The .detc cache is per file and is not used here.
+ */
+static void run_program_mode(char** paths, int pathCount) {
+    ProgramFile* files = (ProgramFile*)calloc((size_t)pathCount, sizeof(ProgramFile));
+    if (files == NULL) cli_error("Out of memory.");
+    for (int i = 0; i < pathCount; i++) {
+        files[i].path = paths[i];
+        arena_init(&files[i].arena);
+        check_extension(paths[i]);
+        cli_info("Reading file: %s", paths[i]);
+    }
+
+    // The PDA trace is one stream: keep it in order
+    int workers = config.pda_debug ? 1 : config.jobs;
+    if (workers <= 0) workers = thread_pool_cpu_count();
+    ThreadPool* pool = thread_pool_new(workers < pathCount ? workers : pathCount);
+    if (pool == NULL) cli_error("Could not start the parser workers.");
+    thread_pool_run(pool, pathCount, parse_program_file, files);
+    thread_pool_free(pool);
+
+    bool parsed = true;
+    for (int i = 0; i < pathCount; i++) {
+        if (!files[i].readable) {
+            cli_error("Could not read file \"%s\". Check permissions or path.", files[i].path);
+        }
+        parsed = parsed && files[i].ast != NULL; // The parser printed the errors
+    }
+
+    init_vm();
+    init_typechecker();
+    init_compiler();
+    vm_define_core_natives(&vm);
+    if (parsed) load_snapshot();
+
+    InterpretResult result = parsed ? INTERPRET_OK : INTERPRET_COMPILE_ERROR;
+    for (int i = 0; i < pathCount; i++) {
+        if (result == INTERPRET_OK) {
+            result = run_ast(files[i].ast, files[i].source.data, NULL, &files[i].arena);
+        } else if (files[i].ast != NULL) {
+            free_ast(files[i].ast);
+        }
+        arena_free(&files[i].arena);
+        file_map_close(&files[i].source);
+    }
+    free(files);
+    save_snapshot(result);
+    finish_run();
+}
+
+// --- Batch Mode ---
+
+/**
+ * @struct BatchScript
+ * @brief One script of a --batch run and what became of it.
+ */
+typedef struct {
+    char* path;
+    bool useCache;          // Off for repeats of a path: one writer per .detc
+    bool readable;
+    InterpretResult result;
+    char* output;           // What it printed (output_take()), or NULL
+    size_t outputLength;
+} BatchScript;
+
+typedef struct {
+    BatchScript* scripts;
+    int count;
+    int capacity;
+} BatchList;
+
+static void batch_add(BatchList* list, char* path) {
+    if (list->count == list->capacity) {
+        int capacity = list->capacity < 16 ? 16 : list->capacity * 2;
+        BatchScript* scripts = (BatchScript*)realloc(list->scripts, sizeof(BatchScript) * (size_t)capacity);
+        if (scripts == NULL) cli_error("Out of memory.");
+        list->scripts = scripts;
+        list->capacity = capacity;
+    }
+    BatchScript* script = &list->scripts[list->count++];
+    memset(script, 0, sizeof(*script));
+    script->path = path;
+    script->useCache = config.use_cache;
+}
+
+static char* copy_path(const char* directory, const char* name) {
+    size_t length = strlen(directory);
+    bool separator = length > 0 && (directory[length - 1] == '/' || directory[length - 1] == '\\');
+    char* path = (char*)malloc(length + strlen(name) + 2);
+    if (path == NULL) cli_error("Out of memory.");
+    sprintf(path, separator || length == 0 ? "%s%s" : "%s/%s", directory, name);
+    return path;
+}
+
+static int compare_paths(const void* a, const void* b) {
+    return strcmp(((const BatchScript*)a)->path, ((const BatchScript*)b)->path);
+}
+
+static int compare_path_refs(const void* a, const void* b) {
+    return strcmp((*(BatchScript* const*)a)->path, (*(BatchScript* const*)b)->path);
+}
+
+/**
+ * @brief Add `path` to the batch, or every .det file directly in it when
+ * it is a directory (in name order).
+ */
+static void batch_add_path(BatchList* list, const char* path) {
+    int first = list->count;
+
+#ifdef _WIN32
+    DWORD attributes = GetFileAttributesA(path);
+    if (attributes == INVALID_FILE_ATTRIBUTES || !(attributes & FILE_ATTRIBUTE_DIRECTORY)) {
+        check_extension(path);
+        batch_add(list, copy_path("", path));
+        return;
+    }
+
+    char* pattern = copy_path(path, "*.det");
+    WIN32_FIND_DATAA entry;
+    HANDLE find = FindFirstFileA(pattern, &entry);
+    free(pattern);
+    if (find != INVALID_HANDLE_VALUE) {
+        do {
+            if (!(entry.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)) batch_add(list, copy_path(path, entry.cFileName));
+        } while (FindNextFileA(find, &entry));
+        FindClose(find);
+    }
+#else
+    struct stat info;
+    DIR* directory = stat(path, &info) == 0 && S_ISDIR(info.st_mode) ? opendir(path) : NULL;
+    if (directory == NULL) {
+        check_extension(path);
+        batch_add(list, copy_path("", path));
+        return;
+    }
+
+    struct dirent* entry;
+    while ((entry = readdir(directory)) != NULL) {
+        const char* ext = strrchr(entry->d_name, '.');
+        if (ext == NULL || strcmp(ext, ".det") != 0) continue;
+
+        char* file = copy_path(path, entry->d_name);
+        if (stat(file, &info) == 0 && S_ISREG(info.st_mode)) {
+            batch_add(list, file);
+        } else {
+            free(file);
+        }
+    }
+    closedir(directory);
+#endif
+
+    if (list->count == first) cli_warn("No .det files in directory '%s'.", path);
+    qsort(list->scripts + first, (size_t)(list->count - first), sizeof(BatchScript), compare_paths);
+}
+
+/**
+ * @brief Only the first of several entries for the same path reads and
+ * writes its .detc (concurrent writers would share one temporary file).
+ */
+static void batch_share_caches(BatchList* list) {
+    BatchScript** sorted = (BatchScript**)malloc(sizeof(BatchScript*) * (size_t)list->count);
+    if (sorted == NULL) cli_error("Out of memory.");
+    for (int i = 0; i < list->count; i++) sorted[i] = &list->scripts[i];
+
+    // Whichever copy sorts first keeps the cache
+    qsort(sorted, (size_t)list->count, sizeof(BatchScript*), compare_path_refs);
+    for (int i = 1; i < list->count; i++) {
+        if (strcmp(sorted[i - 1]->path, sorted[i]->path) == 0) sorted[i]->useCache = false;
+    }
+    free(sorted);
+}
+
+/**
+ * @brief Run one batch script on a VM, compiler and typechecker of its
+ * own, capturing what it prints (PoolTask).
+ */
+static void run_batch_script(void* context, int index, int worker) {
+    (void)worker;
+    BatchScript* script = &((BatchScript*)context)[index];
+
+    FileMap sourceFile;
+    script->readable = file_map_open(&sourceFile, script->path);
+    if (!script->readable) return;
+
+    VM* machine = new_vm();
+    VM* previous = use_vm(machine);
+    machine->output.sink = NULL; // Printed in order once the batch is done
+    init_typechecker();
+    init_compiler();
+    vm_define_core_natives(machine);
+
+    script->result = run_script(script->path, &sourceFile, script->useCache);
+    script->output = output_take(&machine->output, &script->outputLength);
+
+    file_map_close(&sourceFile);
     free_typechecker();
-    free_vm();
+    free_global_symbols();
+    destroy_vm(machine);
+    use_vm(previous);
+}
+
+/**
+ * @brief --batch: run every script given on a pool of worker threads and
+ * print their output one script after another, in the order given.
+ *
+ * Diagnostics (compile and runtime errors) go to stderr as they happen.
+ *
+ * @return false if any script could not be read or failed.
+ */
+static bool run_batch_mode(char** paths, int pathCount) {
+    BatchList list = {NULL, 0, 0};
+    for (int i = 0; i < pathCount; i++) batch_add_path(&list, paths[i]);
+    batch_share_caches(&list);
+
+    ThreadPool* pool = thread_pool_new(config.jobs);
+    if (pool == NULL) cli_error("Could not start the batch workers.");
+    thread_pool_run(pool, list.count, run_batch_script, list.scripts);
+    thread_pool_free(pool);
+
+    int failed = 0;
+    for (int i = 0; i < list.count; i++) {
+        BatchScript* script = &list.scripts[i];
+        if (script->output != NULL) fwrite(script->output, 1, script->outputLength, stdout);
+        if (!script->readable) {
+            cli_warn("Could not read file \"%s\".", script->path);
+        }
+        if (!script->readable || script->result != INTERPRET_OK) failed++;
+        free(script->output);
+        free(script->path);
+    }
+    if (failed > 0) cli_warn("%d of %d scripts failed.", failed, list.count);
+
+    free(list.scripts);
+    return failed == 0;
 }
 
 static void print_repl_help() {
@@ -135,9 +613,17 @@ static void run_repl_mode() {
     init_vm();
     init_typechecker();
     init_compiler();
+    vm_define_core_natives(&vm);
+    load_snapshot();
+
+    // Compiler and typechecker state persists from line to line; each
+    // line's AST is built in the same scratch arena
+    Arena scratch;
+    arena_init(&scratch);
 
     char line[1024];
     for (;;) {
+        vm_flush_output(&vm); // The last line's output before the prompt
         printf(PROMPT);
 
         if (!fgets(line, sizeof(line), stdin)) {
@@ -169,15 +655,58 @@ static void run_repl_mode() {
         // Handle empty lines
         if (strlen(line) == 0) continue;
 
-        run_source(line);
+        run_source(line, NULL, &scratch);
     }
 
+    arena_free(&scratch);
+
+    vm_flush_output(&vm);
+    if (config.gc_stats) report_gc_stats();
+    if (config.profile) report_profile();
+    if (config.profile_alloc) report_alloc_profile();
     free_typechecker();
     free_vm();
 }
 
 
+/**
+ * @brief Parse the positive integer value of option `name` (argv[i + 1]).
+ */
+static int parse_count_option(int argc, char* argv[], int i, const char* name) {
+    if (i + 1 >= argc) {
+        cli_error("Option '%s' expects a number.", name);
+    }
+
+    char* end;
+    long value = strtol(argv[i + 1], &end, 10);
+    if (*argv[i + 1] == '\0' || *end != '\0' || value <= 0 || value > INT_MAX) {
+        cli_error("Invalid value '%s' for '%s'.", argv[i + 1], name);
+    }
+    return (int)value;
+}
+
+/**
+ * @brief Parse the factor value (>= 1.0) of option `name` (argv[i + 1]).
+ */
+static double parse_factor_option(int argc, char* argv[], int i, const char* name) {
+    if (i + 1 >= argc) {
+        cli_error("Option '%s' expects a number.", name);
+    }
+
+    char* end;
+    double value = strtod(argv[i + 1], &end);
+    if (*argv[i + 1] == '\0' || *end != '\0' || !(value >= 1.0 && value <= 1000.0)) {
+        cli_error("Invalid value '%s' for '%s'.", argv[i + 1], name);
+    }
+    return value;
+}
+
 int main(int argc, char* argv[]) {
+    // File arguments (several: one program, or independent scripts with --batch)
+    char** paths = (char**)malloc(sizeof(char*) * (size_t)argc);
+    int pathCount = 0;
+    if (paths == NULL) cli_error("Out of memory.");
+
     // Argument Parsing
     for (int i = 1; i < argc; i++) {
         const char* arg = argv[i];
@@ -191,16 +720,98 @@ int main(int argc, char* argv[]) {
         else if (strcmp(arg, "--pda-debug") == 0 || strcmp(arg, "-d") == 0) {
             config.pda_debug = 1;
         } 
+        else if (strcmp(arg, "-O") == 0 || strcmp(arg, "-O1") == 0) {
+            config.opt_level = OPT_LEVEL_FOLD;
+        }
+        else if (strcmp(arg, "-O0") == 0) {
+            config.opt_level = OPT_LEVEL_NONE;
+        }
+        else if (strcmp(arg, "--no-cache") == 0) {
+            config.use_cache = 0;
+        }
+        else if (strcmp(arg, "--no-fuse") == 0) {
+            config.fuse_passes = 0;
+        }
+        else if (strcmp(arg, "--max-depth") == 0) {
+            config.max_depth = parse_count_option(argc, argv, i++, arg);
+        }
+        else if (strcmp(arg, "--stack-size") == 0) {
+            config.stack_size = parse_count_option(argc, argv, i++, arg);
+        }
+        else if (strcmp(arg, "--gc-step") == 0) {
+            config.gc_step = parse_count_option(argc, argv, i++, arg);
+        }
+        else if (strcmp(arg, "--gc-stats") == 0) {
+            config.gc_stats = 1;
+        }
+        else if (strcmp(arg, "--gc-grow") == 0) {
+            config.gc_grow = parse_factor_option(argc, argv, i++, arg);
+        }
+        else if (strcmp(arg, "--gc-initial") == 0) {
+            config.gc_initial = parse_count_option(argc, argv, i++, arg);
+        }
+        else if (strcmp(arg, "--gc-threads") == 0) {
+            config.gc_threads = parse_count_option(argc, argv, i++, arg);
+        }
+        else if (strcmp(arg, "--profile") == 0) {
+            config.profile = 1;
+        }
+        else if (strcmp(arg, "--profile-folded") == 0) {
+            if (i + 1 >= argc) {
+                cli_error("Option '%s' expects a file name.", arg);
+            }
+            config.profile = 1;
+            config.profile_folded = argv[++i];
+        }
+        else if (strcmp(arg, "--profile-alloc") == 0) {
+            config.profile_alloc = 1;
+        }
+        else if (strcmp(arg, "--register-vm") == 0) {
+            config.register_vm = 1;
+        }
+        else if (strcmp(arg, "--jit") == 0) {
+            config.jit = 1;
+        }
+        else if (strcmp(arg, "--unsafe-fast") == 0) {
+            config.unsafe_fast = 1;
+        }
+        else if (strcmp(arg, "--memoize") == 0) {
+            config.memoize = 1;
+        }
+        else if (strcmp(arg, "--output-buffer") == 0) {
+            config.output_buffer = parse_count_option(argc, argv, i++, arg);
+        }
+        else if (strcmp(arg, "--dump-bytecode") == 0) {
+            config.dump_bytecode = 1;
+        }
+        else if (strcmp(arg, "--trace-execution") == 0) {
+            config.trace_execution = 1;
+        }
+        else if (strcmp(arg, "--snapshot") == 0 || strcmp(arg, "--snapshot-save") == 0) {
+            if (i + 1 >= argc) {
+                cli_error("Option '%s' expects a file name.", arg);
+            }
+            if (strcmp(arg, "--snapshot") == 0) config.snapshot = argv[++i];
+            else config.snapshot_save = argv[++i];
+        }
+        else if (strcmp(arg, "--batch") == 0) {
+            config.batch = 1;
+        }
+        else if (strcmp(arg, "--jobs") == 0 || strcmp(arg, "-j") == 0) {
+            config.jobs = parse_count_option(argc, argv, i++, arg);
+        }
         else {
             // It must be a file path
-            if (config.file_path == NULL) {
-                config.file_path = arg;
-            } else {
-                cli_error("Unexpected argument '%s'. Only one file supported.", arg);
-            }
+            paths[pathCount++] = argv[i];
         }
     }
 
+    if (config.batch && pathCount == 0) {
+        cli_error("Option '--batch' expects files or directories.");
+    } else if (pathCount == 1) {
+        config.file_path = paths[0];
+    }
+
     // Execute respective mode
     if (config.show_help) {
         print_help();
@@ -211,11 +822,82 @@ int main(int argc, char* argv[]) {
         return 0;
     }
 
-    if (config.file_path != NULL) {
+    if (config.batch && (config.profile || config.profile_alloc || config.gc_stats)) {
+        cli_warn("--profile, --profile-alloc and --gc-stats are ignored with --batch.");
+        config.profile = 0;
+        config.profile_alloc = 0;
+        config.gc_stats = 0;
+    }
+    if ((config.dump_bytecode || config.trace_execution) && config.batch) {
+        cli_warn("--dump-bytecode and --trace-execution are ignored with --batch.");
+        config.dump_bytecode = 0;
+        config.trace_execution = 0;
+    }
+    if ((config.snapshot != NULL || config.snapshot_save != NULL) && config.batch) {
+        cli_warn("--snapshot and --snapshot-save are ignored with --batch.");
+        config.snapshot = NULL;
+        config.snapshot_save = NULL;
+    }
+    if (config.snapshot_save != NULL && (config.register_vm || config.unsafe_fast || config.memoize)) {
+        cli_warn("--snapshot-save is ignored with --register-vm, --unsafe-fast and --memoize.");
+        config.snapshot_save = NULL;
+    } else if (config.snapshot_save != NULL && config.file_path == NULL && pathCount == 0) {
+        cli_warn("--snapshot-save is ignored in the REPL.");
+        config.snapshot_save = NULL;
+    }
+    if (config.gc_threads > 1 && config.batch) {
+        cli_warn("--gc-threads is ignored with --batch (the scripts already run in parallel).");
+        config.gc_threads = 0;
+    } else if (config.gc_threads > 1 && config.gc_step > 0) {
+        cli_warn("--gc-threads only applies to full collections; --gc-step slices stay serial.");
+    }
+
+    set_vm_limits(config.max_depth, config.stack_size);
+    set_gc_step_budget(config.gc_step);
+    set_gc_tuning(config.gc_grow, config.gc_initial);
+    set_gc_threads(config.gc_threads);
+    set_vm_profiling(config.profile);
+    set_vm_alloc_profiling(config.profile_alloc);
+    if (config.register_vm && (config.profile || config.profile_alloc)) {
+        cli_warn("--register-vm is ignored while profiling.");
+    } else if (config.register_vm && config.memoize) {
+        cli_warn("--register-vm is ignored with --memoize.");
+    }
+    set_vm_register_backend(config.register_vm);
+    if (config.jit && !jit_available()) {
+        cli_warn("--jit is not available in this build.");
+    } else if (config.jit && (config.profile || config.register_vm)) {
+        cli_warn("--jit is ignored while profiling and on the register VM.");
+    }
+    set_vm_jit(config.jit);
+    if (config.unsafe_fast && config.profile) {
+        cli_warn("--unsafe-fast is ignored while profiling.");
+    }
+    set_vm_unsafe_fast(config.unsafe_fast);
+    set_vm_memoize(config.memoize);
+    set_vm_output_buffer(config.output_buffer);
+    static VmTracer executionTracer;
+    if (config.trace_execution && config.profile_alloc) {
+        cli_warn("--trace-execution is ignored with --profile-alloc.");
+    } else if (config.trace_execution) {
+        if (config.register_vm || config.jit) {
+            cli_warn("--register-vm and --jit are ignored while tracing execution.");
+        }
+        executionTracer = execution_tracer(stderr);
+        set_vm_tracer(&executionTracer);
+    }
+
+    int status = 0;
+    if (config.batch) {
+        status = run_batch_mode(paths, pathCount) ? 0 : 1;
+    } else if (pathCount > 1) {
+        run_program_mode(paths, pathCount);
+    } else if (config.file_path != NULL) {
         run_file_mode();
     } else {
         run_repl_mode();
     }
 
-    return 0;
+    free(paths);
+    return status;
 }
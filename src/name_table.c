@@ -0,0 +1,125 @@
+/**
+ * @file name_table.c
+ * @brief Implementation of the identifier hash table (linear probing, FNV-1a).
+ *
+ * @version 0.1
+ * @date 2026-10-14
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+
+#include "name_table.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NAME_TABLE_MAX_LOAD 0.75
+
+#define EMPTY_VALUE     -1
+#define TOMBSTONE_VALUE -2
+
+static uint32_t hash_name(const char* name, int length) {
+    uint32_t hash = 2166136261u;
+    for (int i = 0; i < length; i++) {
+        hash ^= (uint8_t)name[i];
+        hash *= 16777619;
+    }
+    return hash;
+}
+
+void name_table_init(NameTable* table) {
+    table->count = 0;
+    table->capacity = 0;
+    table->entries = NULL;
+}
+
+void name_table_free(NameTable* table) {
+    free(table->entries);
+    name_table_init(table);
+}
+
+/**
+ * @brief Find the slot holding `name`, or the slot to insert it into (the
+ * first tombstone on the probe path, else the empty slot ending it).
+ */
+static NameEntry* find_entry(NameEntry* entries, int capacity,
+                             const char* name, int length, uint32_t hash) {
+    uint32_t index = hash & (uint32_t)(capacity - 1);
+    NameEntry* tombstone = NULL;
+
+    for (;;) {
+        NameEntry* entry = &entries[index];
+        if (entry->name == NULL) {
+            if (entry->value == EMPTY_VALUE) return tombstone != NULL ? tombstone : entry;
+            if (tombstone == NULL) tombstone = entry;
+        } else if (entry->hash == hash && entry->length == length &&
+                   memcmp(entry->name, name, length) == 0) {
+            return entry;
+        }
+
+        index = (index + 1) & (uint32_t)(capacity - 1);
+    }
+}
+
+static void adjust_capacity(NameTable* table, int capacity) {
+    NameEntry* entries = (NameEntry*)malloc(sizeof(NameEntry) * capacity);
+    if (entries == NULL) {
+        fprintf(stderr, "Fatal: failed to grow name table.\n");
+        exit(EXIT_FAILURE);
+    }
+    for (int i = 0; i < capacity; i++) {
+        entries[i].name = NULL;
+        entries[i].value = EMPTY_VALUE;
+    }
+
+    // Re-insert live entries; tombstones are dropped
+    table->count = 0;
+    for (int i = 0; i < table->capacity; i++) {
+        NameEntry* entry = &table->entries[i];
+        if (entry->name == NULL) continue;
+
+        NameEntry* dest = find_entry(entries, capacity, entry->name, entry->length, entry->hash);
+        *dest = *entry;
+        table->count++;
+    }
+
+    free(table->entries);
+    table->entries = entries;
+    table->capacity = capacity;
+}
+
+int name_table_get(const NameTable* table, const char* name, int length) {
+    if (table->count == 0) return -1;
+
+    NameEntry* entry = find_entry(table->entries, table->capacity,
+                                  name, length, hash_name(name, length));
+    return entry->name != NULL ? entry->value : -1;
+}
+
+void name_table_set(NameTable* table, const char* name, int length, int value) {
+    if (table->count + 1 > table->capacity * NAME_TABLE_MAX_LOAD) {
+        adjust_capacity(table, table->capacity < 8 ? 8 : table->capacity * 2);
+    }
+
+    uint32_t hash = hash_name(name, length);
+    NameEntry* entry = find_entry(table->entries, table->capacity, name, length, hash);
+    if (entry->name == NULL && entry->value == EMPTY_VALUE) table->count++;
+
+    entry->name = name;
+    entry->length = length;
+    entry->hash = hash;
+    entry->value = value;
+}
+
+void name_table_delete(NameTable* table, const char* name, int length) {
+    if (table->count == 0) return;
+
+    NameEntry* entry = find_entry(table->entries, table->capacity,
+                                  name, length, hash_name(name, length));
+    if (entry->name == NULL) return;
+
+    entry->name = NULL;
+    entry->value = TOMBSTONE_VALUE;
+}
@@ -0,0 +1,389 @@
+/**
+ * @file optimizer.c
+ * @brief AST-level constant folding and dead-branch elimination.
+ *
+ * The pass walks the type-checked AST and rewrites it in place:
+ *  - NODE_UNARY_OP / NODE_BINARY_OP whose operands are literals are
+ *    replaced by the resulting literal (int arithmetic, comparisons,
+ *    equality and string concatenation).
+ *  - NODE_IF with a constant boolean condition is replaced by the branch
+ *    that would run; NODE_WHILE with a constant false condition is removed.
+ *
+ * Anything that would raise a runtime error (division/modulo by zero, int
+ * overflow, ill-typed operands inside function bodies, which are not
+ * typechecked) is left untouched so the VM still reports it.
+ *
+ * @version 0.1
+ * @date 2026-10-14
+ */
+
+#include "optimizer.h"
+#include "ast.h"
+#include "token.h"
+#include "tls.h"
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Arena of the tree being optimized (NULL if its nodes were malloc'd)
+static DETERMA_THREAD_LOCAL Arena* treeArena = NULL;
+
+// Forward declarations
+static AstNode* fold_expression(AstNode* expr);
+static AstNode* optimize_statement(AstNode* stmt);
+
+
+// ========================
+// --- Helper Functions ---
+// ========================
+
+/**
+ * @brief Build a literal node that is already annotated with its type
+ * so the compiler can still pick specialized opcodes around it.
+ */
+static AstNode* make_int(int value, int line) {
+    AstNode* node = new_int_literal_node(value, line);
+    if (node) node->resolvedType = TYPE_INT;
+    return node;
+}
+
+static AstNode* make_bool(int value, int line) {
+    AstNode* node = new_bool_literal_node(value ? 1 : 0, line);
+    if (node) node->resolvedType = TYPE_BOOL;
+    return node;
+}
+
+static AstNode* make_string(const AstNodeStringLiteral* a, const AstNodeStringLiteral* b, int line) {
+    int length = a->length + b->length;
+
+    char* chars = (char*)ast_alloc((size_t)length + 1);
+    if (!chars) return NULL;
+    memcpy(chars, a->chars, a->length);
+    memcpy(chars + a->length, b->chars, b->length);
+    chars[length] = '\0';
+
+    AstNode* node = new_string_literal_node(chars, length, line);
+    if (!node) {
+        if (treeArena == NULL) free(chars); // Arena memory goes with the tree
+        return NULL;
+    }
+    ((AstNodeStringLiteral*)node)->ownsChars = treeArena == NULL;
+    node->resolvedType = TYPE_STRING;
+    return node;
+}
+
+static int same_string(const AstNodeStringLiteral* a, const AstNodeStringLiteral* b) {
+    return a->length == b->length && memcmp(a->chars, b->chars, a->length) == 0;
+}
+
+/**
+ * @brief Replace `old` with `replacement` (if one could be built).
+ *
+ * @return AstNode* The node the parent should now point to.
+ */
+static AstNode* replace_node(AstNode* old, AstNode* replacement) {
+    if (replacement == NULL) return old; // out of memory: keep the original
+    free_ast(old);
+    return replacement;
+}
+
+/**
+ * @brief Does the subtree declare a function?
+ *
+ * Function declarations bind globals at compile time, so a branch that
+ * contains one is never pruned.
+ */
+static int contains_func_decl(AstNode* node) {
+    if (node == NULL) return 0;
+
+    switch (node->type) {
+        case NODE_FUNC_DECL:
+            return 1;
+        case NODE_BLOCK: {
+            AstNodeBlock* b = (AstNodeBlock*)node;
+            for (int i = 0; i < b->statement_count; i++)
+                if (contains_func_decl(b->statements[i])) return 1;
+            return 0;
+        }
+        case NODE_IF: {
+            AstNodeIf* n = (AstNodeIf*)node;
+            return contains_func_decl(n->thenBranch) || contains_func_decl(n->elseBranch);
+        }
+        case NODE_WHILE:
+            return contains_func_decl(((AstNodeWhile*)node)->body);
+        default:
+            return 0;
+    }
+}
+
+
+// ===========================
+// --- Expression Folding ---
+// ===========================
+
+/**
+ * @brief Fold `a op b` for two int literals.
+ *
+ * @return AstNode* The folded literal, or NULL if the operation must stay
+ * at runtime (unknown operator, division by zero, overflow).
+ */
+static AstNode* fold_int_binary(TokenType op, int a, int b, int line) {
+    long long result;
+
+    switch (op) {
+        case TOKEN_PLUS:  result = (long long)a + b; break;
+        case TOKEN_MINUS: result = (long long)a - b; break;
+        case TOKEN_STAR:  result = (long long)a * b; break;
+
+        case TOKEN_SLASH:
+        case TOKEN_PERCENT:
+            // Keep "Division by zero." / INT_MIN / -1 for the VM
+            if (b == 0 || (a == INT_MIN && b == -1)) return NULL;
+            result = (op == TOKEN_SLASH) ? a / b : a % b;
+            break;
+
+        case TOKEN_LESS:          return make_bool(a < b, line);
+        case TOKEN_LESS_EQUAL:    return make_bool(a <= b, line);
+        case TOKEN_GREATER:       return make_bool(a > b, line);
+        case TOKEN_GREATER_EQUAL: return make_bool(a >= b, line);
+        case TOKEN_EQUAL_EQUAL:   return make_bool(a == b, line);
+        case TOKEN_BANG_EQUAL:    return make_bool(a != b, line);
+
+        default:
+            return NULL;
+    }
+
+    if (result < INT_MIN || result > INT_MAX) return NULL;
+    return make_int((int)result, line);
+}
+
+static AstNode* fold_unary(AstNodeUnaryOp* n) {
+    n->operand = fold_expression(n->operand);
+    AstNode* operand = n->operand;
+    int line = n->node.line;
+
+    if (n->op.type == TOKEN_MINUS && operand->type == NODE_INT_LITERAL) {
+        int value = ((AstNodeIntLiteral*)operand)->value;
+        if (value == INT_MIN) return (AstNode*)n;
+        return replace_node((AstNode*)n, make_int(-value, line));
+    }
+
+    if (n->op.type == TOKEN_BANG && operand->type == NODE_BOOL_LITERAL) {
+        int value = ((AstNodeBoolLiteral*)operand)->value;
+        return replace_node((AstNode*)n, make_bool(!value, line));
+    }
+
+    return (AstNode*)n;
+}
+
+static AstNode* fold_binary(AstNodeBinaryOp* n) {
+    n->left = fold_expression(n->left);
+    n->right = fold_expression(n->right);
+
+    AstNode* left = n->left;
+    AstNode* right = n->right;
+    TokenType op = n->op.type;
+    int line = n->node.line;
+
+    // int (op) int
+    if (left->type == NODE_INT_LITERAL && right->type == NODE_INT_LITERAL) {
+        int a = ((AstNodeIntLiteral*)left)->value;
+        int b = ((AstNodeIntLiteral*)right)->value;
+        AstNode* folded = fold_int_binary(op, a, b, line);
+        return folded ? replace_node((AstNode*)n, folded) : (AstNode*)n;
+    }
+
+    // string + string, string ==/!= string
+    if (left->type == NODE_STRING_LITERAL && right->type == NODE_STRING_LITERAL) {
+        const AstNodeStringLiteral* a = (AstNodeStringLiteral*)left;
+        const AstNodeStringLiteral* b = (AstNodeStringLiteral*)right;
+
+        if (op == TOKEN_PLUS)        return replace_node((AstNode*)n, make_string(a, b, line));
+        if (op == TOKEN_EQUAL_EQUAL) return replace_node((AstNode*)n, make_bool(same_string(a, b), line));
+        if (op == TOKEN_BANG_EQUAL)  return replace_node((AstNode*)n, make_bool(!same_string(a, b), line));
+        return (AstNode*)n;
+    }
+
+    // bool ==/!= bool
+    if (left->type == NODE_BOOL_LITERAL && right->type == NODE_BOOL_LITERAL) {
+        int a = ((AstNodeBoolLiteral*)left)->value;
+        int b = ((AstNodeBoolLiteral*)right)->value;
+
+        if (op == TOKEN_EQUAL_EQUAL) return replace_node((AstNode*)n, make_bool(a == b, line));
+        if (op == TOKEN_BANG_EQUAL)  return replace_node((AstNode*)n, make_bool(a != b, line));
+    }
+
+    return (AstNode*)n;
+}
+
+/**
+ * @brief Fold an expression tree bottom-up.
+ *
+ * @param expr Expression node (may be NULL).
+ * @return AstNode* The node the parent should now point to (the original
+ * node is freed if it was replaced).
+ */
+static AstNode* fold_expression(AstNode* expr) {
+    if (expr == NULL) return NULL;
+
+    switch (expr->type) {
+        case NODE_UNARY_OP:
+            return fold_unary((AstNodeUnaryOp*)expr);
+
+        case NODE_BINARY_OP:
+            return fold_binary((AstNodeBinaryOp*)expr);
+
+        case NODE_VAR_ASSIGN: {
+            AstNodeVarAssign* n = (AstNodeVarAssign*)expr;
+            n->expression = fold_expression(n->expression);
+            return expr;
+        }
+
+        case NODE_CALL: {
+            AstNodeCall* n = (AstNodeCall*)expr;
+            for (int i = 0; i < n->arg_count; i++) {
+                n->args[i] = fold_expression(n->args[i]);
+            }
+            return expr;
+        }
+
+        default:
+            // Literals and variable access have nothing to fold
+            return expr;
+    }
+}
+
+
+// ==================================
+// --- Dead-Branch Elimination ---
+// ==================================
+
+/**
+ * @brief Optimize every statement of a list, dropping removed ones.
+ */
+static void optimize_statement_list(AstNode** statements, int* count) {
+    int kept = 0;
+    for (int i = 0; i < *count; i++) {
+        AstNode* stmt = optimize_statement(statements[i]);
+        if (stmt != NULL) statements[kept++] = stmt;
+    }
+    *count = kept;
+}
+
+/**
+ * @brief Optimize a statement.
+ *
+ * @return AstNode* The replacement statement, or NULL if it was removed
+ * entirely (the original is freed in both cases when it changed).
+ */
+static AstNode* optimize_statement(AstNode* stmt) {
+    if (stmt == NULL) return NULL;
+
+    switch (stmt->type) {
+        case NODE_PROGRAM: {
+            AstNodeProgram* n = (AstNodeProgram*)stmt;
+            optimize_statement_list(n->statements, &n->statement_count);
+            return stmt;
+        }
+
+        case NODE_BLOCK: {
+            AstNodeBlock* n = (AstNodeBlock*)stmt;
+            optimize_statement_list(n->statements, &n->statement_count);
+            return stmt;
+        }
+
+        case NODE_VAR_DECL: {
+            AstNodeVarDecl* n = (AstNodeVarDecl*)stmt;
+            n->init = fold_expression(n->init);
+            return stmt;
+        }
+
+        case NODE_PRINT_STMT: {
+            AstNodePrintStmt* n = (AstNodePrintStmt*)stmt;
+            n->expression = fold_expression(n->expression);
+            return stmt;
+        }
+
+        case NODE_EXPR_STMT: {
+            AstNodeExprStmt* n = (AstNodeExprStmt*)stmt;
+            n->expression = fold_expression(n->expression);
+            return stmt;
+        }
+
+        case NODE_RETURN: {
+            AstNodeReturn* n = (AstNodeReturn*)stmt;
+            n->value = fold_expression(n->value);
+            return stmt;
+        }
+
+        case NODE_FUNC_DECL: {
+            AstNodeFuncDecl* n = (AstNodeFuncDecl*)stmt;
+            n->body = optimize_statement(n->body);
+            return stmt;
+        }
+
+        case NODE_IF: {
+            AstNodeIf* n = (AstNodeIf*)stmt;
+            n->condition = fold_expression(n->condition);
+            n->thenBranch = optimize_statement(n->thenBranch);
+            n->elseBranch = optimize_statement(n->elseBranch);
+
+            // Only a literal bool is a known condition (the VM treats any
+            // non-bool as truthy, but unchecked code may rely on that)
+            if (n->condition->type != NODE_BOOL_LITERAL) return stmt;
+            if (contains_func_decl(stmt)) return stmt;
+
+            // Detach the surviving branch, free the rest
+            AstNode* survivor;
+            if (((AstNodeBoolLiteral*)n->condition)->value) {
+                survivor = n->thenBranch;
+                n->thenBranch = NULL;
+            } else {
+                survivor = n->elseBranch;
+                n->elseBranch = NULL;
+            }
+            free_ast(stmt);
+            return survivor; // A block keeps its own scope; NULL if no else
+        }
+
+        case NODE_WHILE: {
+            AstNodeWhile* n = (AstNodeWhile*)stmt;
+            n->condition = fold_expression(n->condition);
+            n->body = optimize_statement(n->body);
+
+            // `while false { ... }` never runs
+            if (n->condition->type == NODE_BOOL_LITERAL &&
+                !((AstNodeBoolLiteral*)n->condition)->value &&
+                !contains_func_decl(n->body)) {
+                free_ast(stmt);
+                return NULL;
+            }
+            return stmt;
+        }
+
+        default:
+            return stmt;
+    }
+}
+
+
+/**
+ * @brief Entry point for the AST optimization pass.
+ *
+ * @param root  The root AST node (typically NODE_PROGRAM).
+ * @param level OPT_LEVEL_NONE disables the pass.
+ */
+void optimize_ast(AstNode* root, int level) {
+    if (root == NULL || level < OPT_LEVEL_FOLD) return;
+
+    if (root->type == NODE_PROGRAM) {
+        // Replacement nodes go into the tree's own arena
+        treeArena = ((AstNodeProgram*)root)->arena;
+        Arena* previous = ast_use_arena(treeArena);
+        optimize_statement(root);
+        ast_use_arena(previous);
+        treeArena = NULL;
+    }
+}
@@ -2,22 +2,28 @@
  * @file parser.c
  * @brief Implementation of the Determa Parser
  *
- * This is a recursive descent parser that builds the AST
+ * This is a recursive descent parser that builds the AST.
+ * Statements get one function each; expressions are parsed by a
+ * table-driven Pratt parser (parse_precedence() and the `rules` table),
+ * so an atom costs one table lookup instead of a walk down every
+ * precedence level.
  * 
  * 
- * PRECIDENCE HEIRARCHY (As of v0.2)
+ * PRECIDENCE HEIRARCHY (As of v0.2, lowest first)
  * 
+    Assignment (=, +=, -=, *=, /=, %=)   right-associative
+
     Equality (==, !=)
 
     Comparison (<, >, <=, >=)
 
     Term (+, -)
 
-    Factor (*, /)
+    Factor (*, /, %)
 
     Unary (!, -)
 
-    Primary (true, false, 123, (...))
+    Primary (true, false, 123, "str", x, f(...), (...))
  */
 
 #include "parser.h"
@@ -32,8 +38,8 @@
 
 
 // --- Globals for PDA Debugger ---
-int pda_debug_enabled = 0;
-int pda_debug_indent = 0;
+DETERMA_THREAD_LOCAL int pda_debug_enabled = 0;
+DETERMA_THREAD_LOCAL int pda_debug_indent = 0;
 
 // --- Parser Globals (State) ---
 
@@ -51,18 +57,49 @@ typedef struct {
 
     int had_error;
     int inside_func;    // 0 = outside func, 1 = inside func 
+    int depth;          // Nesting of parse_precedence() calls
+    int too_deep;       // Hit PARSER_MAX_DEPTH: later errors in the statement are fallout
     // We will add a 'panic_mode' flag later for error recovery
 } Parser;
 
+/**
+ * @brief Deepest expression nesting accepted. Deeper input is reported as
+ * an error instead of running the parser (and the passes that walk the
+ * tree recursively) out of C stack.
+ */
+#define PARSER_MAX_DEPTH 512
+
+/**
+ * @brief Binding power of an operator, lowest first.
+ */
+typedef enum {
+    PREC_NONE,
+    PREC_ASSIGNMENT,    // = += -= *= /= %=
+    PREC_EQUALITY,      // == !=
+    PREC_COMPARISON,    // < > <= >=
+    PREC_TERM,          // + -
+    PREC_FACTOR,        // * / %
+    PREC_UNARY,         // ! -
+    PREC_PRIMARY
+} Precedence;
+
+typedef AstNode* (*PrefixFn)(Parser* parser);
+typedef AstNode* (*InfixFn)(Parser* parser, AstNode* left);
+
+/**
+ * @brief How a token parses at the start of an expression (prefix) and
+ * after a complete left operand (infix, binding with `precedence`).
+ */
+typedef struct {
+    PrefixFn prefix;
+    InfixFn infix;
+    Precedence precedence;
+    const char* name;   // PDA trace label of the infix rule
+} ParseRule;
+
 // --- Forward Declarations for recursive functions ---
-static AstNode* parse_assignment(Parser* parser);
 static AstNode* parse_expression(Parser* parser);
-static AstNode* parse_equality(Parser* parser);
-static AstNode* parse_comparison(Parser* parser);
-static AstNode* parse_term(Parser* parser);
-static AstNode* parse_factor(Parser* parser);
-static AstNode* parse_unary(Parser* parser);
-static AstNode* parse_primary(Parser* parser);
+static AstNode* parse_precedence(Parser* parser, Precedence precedence);
 static AstNode* parse_declaration(Parser* parser);
 static AstNode* parse_statement(Parser* parser);
 static AstNode* parse_block(Parser* parser);
@@ -77,6 +114,7 @@ static AstNode* parse_return_statement(Parser* parser);
  */
 static void error_at_current(Parser* parser, const char* message) {
     parser->had_error = 1;
+    if (parser->too_deep) return; // Unwinding an over-deep expression
     // Don't print if we've already hit an error
     // (This prevents a cascade of errors)
     // We will implement panic_mode later
@@ -172,12 +210,12 @@ static int match(Parser* parser, TokenType types[], int count) {
 // --- Parsing Functions (The Grammar) ---
 
 /**
- * @brief Parses a "primary" expression (the lowest level)
+ * @brief Parses a literal: true, false, an integer or a string
  *
  * Grammar Rule:
- * primary -> NUMBER | "(" expression ")"
+ * primary -> "true" | "false" | NUMBER | STRING
  */
-static AstNode* parse_primary(Parser* parser) {
+static AstNode* parse_literal(Parser* parser) {
     TRACE_ENTER("Primary");
     // Check true boolean parsing
     if (check(parser, TOKEN_TRUE)) {
@@ -210,188 +248,242 @@ static AstNode* parse_primary(Parser* parser) {
     }
 
     // --- String Literal Parsing ---
-    if (check(parser, TOKEN_STRING)) {
-
-        if (parser->current.length < 2) {
-            error_at_current(parser, "Invalid string literal");
-            advance(parser);
-            return NULL;
-        }
-
-        // strip the token lexemme of the " "
-        int len = parser->current.length - 2; // -2 for quotes
-        char* strVal = (char*)malloc(len + 1);
-        // Copy starting from lexeme + 1 to skip opening quote
-        if (!strVal) { error_at_current(parser, "Out of memory"); return NULL; }
-        
-        memcpy(strVal, parser->current.lexeme + 1, len);
-        strVal[len] = '\0';
-        
+    if (parser->current.length < 2) {
+        error_at_current(parser, "Invalid string literal");
         advance(parser);
-        TRACE_EXIT("Primary (StringLiteral)");
-        return new_string_literal_node(strVal, parser->previous.line);
+        TRACE_EXIT("Primary (Error)");
+        return NULL;
     }
 
-    // Identifier: Var or Call
-    if (check(parser, TOKEN_ID)) {
-        Token name = parser->current;
-        advance(parser);
-        
-        // Call?
-        if (check(parser, TOKEN_LPAREN)) {
-            advance(parser); // Consume (
-            int line = parser->previous.line;
-            int arg_capacity = 4;
-            int arg_count = 0;
-            AstNode** args = malloc(sizeof(AstNode*) * arg_capacity);
-            
-            if (!check(parser, TOKEN_RPAREN)) {
-                do {
-                    if (arg_count >= arg_capacity) {
-                        arg_capacity *= 2;
-                        args = realloc(args, sizeof(AstNode*) * arg_capacity);
-                    }
-                    args[arg_count++] = parse_expression(parser);
-                } while (match(parser, (TokenType[]){TOKEN_COMMA}, 1));
-            }
-            consume(parser, TOKEN_RPAREN, "Expected ')' after args");
-            TRACE_EXIT("Primary (Call)");
-            return new_call_node(name, args, arg_count, line);
-        }
+    // The node borrows the lexeme without its quotes; the bytes are
+    // only copied when the compiler interns the constant
+    const char* chars = parser->current.lexeme + 1; // skip opening quote
+    int len = parser->current.length - 2;           // -2 for quotes
 
-        TRACE_EXIT("Primary (VarAccess)");
-        return new_var_access_node(name, parser->previous.line);
-    }
+    advance(parser);
+    TRACE_EXIT("Primary (StringLiteral)");
+    return new_string_literal_node(chars, len, parser->previous.line);
+}
 
-    // Consume '('
+/**
+ * @brief Parses a variable access or a call
+ *
+ * Grammar Rule:
+ * primary -> IDENTIFIER ( "(" ( expression ( "," expression )* )? ")" )?
+ */
+static AstNode* parse_identifier(Parser* parser) {
+    TRACE_ENTER("Primary");
+    Token name = parser->current;
+    advance(parser);
+    
+    // Call?
     if (check(parser, TOKEN_LPAREN)) {
-        advance(parser); 
-        AstNode* expr = parse_expression(parser); // Parse inner expression
-        consume(parser, TOKEN_RPAREN, "Expected ')' after expression");
-        TRACE_EXIT("Primary (Grouping)");
-        return expr;
+        advance(parser); // Consume (
+        int line = parser->previous.line;
+        int arg_capacity = 4;
+        int arg_count = 0;
+        AstNode** args = ast_alloc(sizeof(AstNode*) * arg_capacity);
+        
+        if (!check(parser, TOKEN_RPAREN)) {
+            do {
+                if (arg_count >= arg_capacity) {
+                    args = ast_realloc(args, sizeof(AstNode*) * arg_capacity,
+                                       sizeof(AstNode*) * arg_capacity * 2);
+                    arg_capacity *= 2;
+                }
+                args[arg_count++] = parse_expression(parser);
+            } while (match(parser, (TokenType[]){TOKEN_COMMA}, 1));
+        }
+        consume(parser, TOKEN_RPAREN, "Expected ')' after args");
+        TRACE_EXIT("Primary (Call)");
+        return new_call_node(name, args, arg_count, line);
     }
 
-    // If we get here, it's an error
-    error_at_current(parser, "Expected expression");
-    TRACE_EXIT("Primary (Error)");
-    return NULL;
+    TRACE_EXIT("Primary (VarAccess)");
+    return new_var_access_node(name, parser->previous.line);
+}
+
+/**
+ * @brief Parses a parenthesized expression
+ *
+ * Grammar Rule:
+ * primary -> "(" expression ")"
+ */
+static AstNode* parse_grouping(Parser* parser) {
+    TRACE_ENTER("Primary");
+    advance(parser); // Consume '('
+    AstNode* expr = parse_expression(parser); // Parse inner expression
+    consume(parser, TOKEN_RPAREN, "Expected ')' after expression");
+    TRACE_EXIT("Primary (Grouping)");
+    return expr;
 }
 
 /**
- * @brief Parses unary expressions (-int, -x)
- * Rule: unary -> ("-") unary | primary
+ * @brief Parses unary expressions (-int, -x, !b)
+ * Rule: unary -> ( "-" | "!" ) unary | primary
  */
 static AstNode* parse_unary(Parser* parser) {
     TRACE_ENTER("Unary");
+    Token operator = parser->current;
+    advance(parser);
 
-    // FIX: Explicitly match TOKEN_BANG (!) here
-    TokenType ops[] = {TOKEN_MINUS, TOKEN_BANG};
-
-    if (match(parser, ops, 2)) {
-        Token operator = parser->previous;
-        // recursively call unary
-        AstNode* operand = parse_unary(parser);
-        TRACE_EXIT("Unary (Op)");
-        return new_unary_op_node(operator, operand, operator.line);
-    }
-    
-    // If no unary op, fall through to primary
-    AstNode* res = parse_primary(parser);
-    TRACE_EXIT("Unary (Primary)");
-    return res;
+    // The operand binds at least as tightly as another unary op
+    AstNode* operand = parse_precedence(parser, PREC_UNARY);
+    TRACE_EXIT("Unary (Op)");
+    return new_unary_op_node(operator, operand, operator.line);
 }
 
 /**
- * @brief Parses "factor" expressions (multiplication, division)
+ * @brief Parses the right operand of a left-associative binary operator
  *
- * Grammar Rule:
- * factor -> primary ( ( "/" | "*" ) primary )*
+ * Grammar Rules:
+ * equality   -> comparison ( ( "!=" | "==" ) comparison )*
+ * comparison -> term ( ( ">" | ">=" | "<" | "<=" ) term )*
+ * term       -> factor ( ( "-" | "+" ) factor )*
+ * factor     -> unary ( ( "/" | "*" | "%" ) unary )*
+ */
+static AstNode* parse_binary(Parser* parser, AstNode* left);
+
+/**
+ * @brief Parses an assignment after its target (right-associative)
+ * 
+ * Rule: assignment -> IDENTIFIER ( "=" | "+=" | ... ) assignment | equality 
+ * 
+ * @param parser 
+ * @param left The target, already parsed as an expression
+ * @return AstNode* 
  */
-static AstNode* parse_factor(Parser* parser) {
-    TRACE_ENTER("Factor");
-    // calling parse_unary with a fallback to parse_primary
-    AstNode* node = parse_unary(parser);
-
-    TokenType op_types[] = {TOKEN_STAR, TOKEN_SLASH, TOKEN_PERCENT};
-    while (match(parser, op_types, 3)) {
-        Token op = parser->previous;
-        AstNode* right = parse_unary(parser); // right side also unary
-        node = new_binary_op_node(op, node, right, op.line);
+static AstNode* parse_assignment(Parser* parser, AstNode* left);
+
+static const ParseRule rules[TOKEN_EOF + 1] = {
+    [TOKEN_LPAREN]        = { parse_grouping,   NULL,             PREC_NONE,       NULL },
+    [TOKEN_MINUS]         = { parse_unary,      parse_binary,     PREC_TERM,       "Term" },
+    [TOKEN_PLUS]          = { NULL,             parse_binary,     PREC_TERM,       "Term" },
+    [TOKEN_STAR]          = { NULL,             parse_binary,     PREC_FACTOR,     "Factor" },
+    [TOKEN_SLASH]         = { NULL,             parse_binary,     PREC_FACTOR,     "Factor" },
+    [TOKEN_PERCENT]       = { NULL,             parse_binary,     PREC_FACTOR,     "Factor" },
+    [TOKEN_BANG]          = { parse_unary,      NULL,             PREC_NONE,       NULL },
+    [TOKEN_BANG_EQUAL]    = { NULL,             parse_binary,     PREC_EQUALITY,   "Equality" },
+    [TOKEN_EQUAL_EQUAL]   = { NULL,             parse_binary,     PREC_EQUALITY,   "Equality" },
+    [TOKEN_LESS]          = { NULL,             parse_binary,     PREC_COMPARISON, "Comparison" },
+    [TOKEN_LESS_EQUAL]    = { NULL,             parse_binary,     PREC_COMPARISON, "Comparison" },
+    [TOKEN_GREATER]       = { NULL,             parse_binary,     PREC_COMPARISON, "Comparison" },
+    [TOKEN_GREATER_EQUAL] = { NULL,             parse_binary,     PREC_COMPARISON, "Comparison" },
+    [TOKEN_EQUALS]        = { NULL,             parse_assignment, PREC_ASSIGNMENT, "Assignment" },
+    [TOKEN_PLUS_EQUAL]    = { NULL,             parse_assignment, PREC_ASSIGNMENT, "Assignment" },
+    [TOKEN_MINUS_EQUAL]   = { NULL,             parse_assignment, PREC_ASSIGNMENT, "Assignment" },
+    [TOKEN_STAR_EQUAL]    = { NULL,             parse_assignment, PREC_ASSIGNMENT, "Assignment" },
+    [TOKEN_SLASH_EQUAL]   = { NULL,             parse_assignment, PREC_ASSIGNMENT, "Assignment" },
+    [TOKEN_PERCENT_EQUAL] = { NULL,             parse_assignment, PREC_ASSIGNMENT, "Assignment" },
+    [TOKEN_INT]           = { parse_literal,    NULL,             PREC_NONE,       NULL },
+    [TOKEN_STRING]        = { parse_literal,    NULL,             PREC_NONE,       NULL },
+    [TOKEN_TRUE]          = { parse_literal,    NULL,             PREC_NONE,       NULL },
+    [TOKEN_FALSE]         = { parse_literal,    NULL,             PREC_NONE,       NULL },
+    [TOKEN_ID]            = { parse_identifier, NULL,             PREC_NONE,       NULL },
+};
+
+static AstNode* parse_binary(Parser* parser, AstNode* left) {
+    const ParseRule* rule = &rules[parser->current.type];
+    TRACE_ENTER(rule->name);
+    Token op = parser->current;
+    advance(parser);
+
+    // One level tighter on the right keeps the operator left-associative
+    AstNode* right = parse_precedence(parser, (Precedence)(rule->precedence + 1));
+    TRACE_EXIT(rule->name);
+    return new_binary_op_node(op, left, right, op.line);
+}
+
+static AstNode* parse_assignment(Parser* parser, AstNode* left) {
+    TRACE_ENTER("Assignment");
+    Token op = parser->current;
+    advance(parser);
+    AstNode* value = parse_precedence(parser, PREC_ASSIGNMENT);
+
+    if (left != NULL && left->type == NODE_VAR_ACCESS) {
+        Token name = ((AstNodeVarAccess*)left)->name;
+
+        // Handle Compound Assignment (Desugaring)
+        if (op.type != TOKEN_EQUALS) {
+            // Transform "x += 1" into "x = x + 1"
+            
+            // 1. Convert the assignment op to a binary op
+            TokenType binOpType;
+            switch (op.type) {
+                case TOKEN_PLUS_EQUAL:    binOpType = TOKEN_PLUS; break;
+                case TOKEN_MINUS_EQUAL:   binOpType = TOKEN_MINUS; break;
+                case TOKEN_STAR_EQUAL:    binOpType = TOKEN_STAR; break;
+                case TOKEN_SLASH_EQUAL:   binOpType = TOKEN_SLASH; break;
+                case TOKEN_PERCENT_EQUAL: binOpType = TOKEN_PERCENT; break;
+                default: binOpType = TOKEN_PLUS; break; // Unreachable
+            }
+            
+            // 2. Create the synthetic binary operator node (x + 1)
+            // Reuse 'left' (VarAccess x) as the left side
+            Token binToken = op;
+            binToken.type = binOpType;
+            AstNode* binOpNode = new_binary_op_node(binToken, left, value, op.line);
+            
+            // 3. Assign the result back to x
+            TRACE_EXIT("Assignment (Compound)");
+            return new_var_assign_node(name, binOpNode, op.line);
+        }
+
+        // Standard Assignment (x = 1)
+        // Discard the VarAccess node as we replace it with VarAssign
+        // (Ideally free(left) here, but for now we rely on GC/OS cleanup)
+        TRACE_EXIT("Assignment");
+        return new_var_assign_node(name, value, op.line);
     }
-    
-    TRACE_EXIT("Factor");
-    return node;
+
+    error_at_current(parser, "Invalid assignment target.");
+    TRACE_EXIT("Assignment (Error)");
+    return left;
 }
 
 /**
- * @brief Parses "term" expressions (addition, subtraction)
- *
- * Grammar Rule:
- * term -> factor ( ( "-" | "+" ) factor )*
+ * @brief Parses an expression whose operators bind at least as tightly as
+ * `precedence`: one prefix rule for the first operand, then infix rules
+ * for as long as the next operator binds tightly enough.
  */
-static AstNode* parse_term(Parser* parser) {
-    TRACE_ENTER("Term");
-    AstNode* node = parse_factor(parser);
-
-    TokenType op_types[] = {TOKEN_PLUS, TOKEN_MINUS};
-    while (match(parser, op_types, 2)) {
-        Token op = parser->previous;
-        AstNode* right = parse_factor(parser);
-        node = new_binary_op_node(op, node, right, op.line);
+static AstNode* parse_precedence(Parser* parser, Precedence precedence) {
+    PrefixFn prefix = rules[parser->current.type].prefix;
+    if (prefix == NULL) {
+        // If we get here, it's an error
+        error_at_current(parser, "Expected expression");
+        return NULL;
     }
-    
-    TRACE_EXIT("Term");
+
+    if (parser->depth >= PARSER_MAX_DEPTH) {
+        error_at_current(parser, "Expression nested too deeply");
+        parser->too_deep = 1;
+        return NULL;
+    }
+    parser->depth++;
+
+    AstNode* node = prefix(parser);
+    while (precedence <= rules[parser->current.type].precedence) {
+        node = rules[parser->current.type].infix(parser, node);
+    }
+
+    parser->depth--;
     return node;
 }
 
-
 /**
  * @brief Parses an expression (Handles precedence)
  *
  * Grammar Rule:
- * expression -> term
+ * expression -> assignment
  */
 static AstNode* parse_expression(Parser* parser) {
     TRACE_ENTER("Expression");
     // Start at the lowest precedence (Assignment)
-    AstNode* node = parse_assignment(parser);
+    AstNode* node = parse_precedence(parser, PREC_ASSIGNMENT);
     TRACE_EXIT("Expression");
     return node;
 }
 
-
-// --- Comparison Parsing ---
-static AstNode* parse_comparison(Parser* parser) {
-    TRACE_ENTER("Comparison");
-    AstNode* node = parse_term(parser);
-
-    TokenType op_types[] = {TOKEN_GREATER, TOKEN_GREATER_EQUAL, TOKEN_LESS, TOKEN_LESS_EQUAL};
-    while (match(parser, op_types, 4)) {
-        Token op = parser->previous;
-        AstNode* right = parse_term(parser);
-        node = new_binary_op_node(op, node, right, op.line);
-    }
-    
-    TRACE_EXIT("Comparison");
-    return node;
-}
-
-static AstNode* parse_equality(Parser* parser) {
-    TRACE_ENTER("Equality");
-    AstNode* node = parse_comparison(parser);
-
-    TokenType op_types[] = {TOKEN_BANG_EQUAL, TOKEN_EQUAL_EQUAL};
-    while (match(parser, op_types, 2)) {
-        Token op = parser->previous;
-        AstNode* right = parse_comparison(parser);
-        node = new_binary_op_node(op, node, right, op.line);
-    }
-    
-    TRACE_EXIT("Equality");
-    return node;
-}
-
 // --- Statement Parsing ---
 
 /**
@@ -484,71 +576,6 @@ static AstNode* parse_declaration(Parser* parser) {
 }
 
 
-/**
- * @brief Parses Assignment logic when encountered
- * 
- * Rule: assignment -> IDENTIFIER "=" assignment | equality 
- * 
- * @param parser 
- * @return AstNode* 
- */
-static AstNode* parse_assignment(Parser* parser) {
-    // 1. Parse the left side as an expression (likely a VarAccess)
-    // We call the next level down (Equality)
-    AstNode* expr = parse_equality(parser);
-
-    TokenType assignOps[] = {
-        TOKEN_EQUALS, 
-        TOKEN_PLUS_EQUAL, TOKEN_MINUS_EQUAL, 
-        TOKEN_STAR_EQUAL, TOKEN_SLASH_EQUAL,
-        TOKEN_PERCENT_EQUAL
-    };
-
-    if (match(parser, assignOps, 6)) {
-        Token op = parser->previous;
-        AstNode* value = parse_assignment(parser);
-
-        if (expr->type == NODE_VAR_ACCESS) {
-            Token name = ((AstNodeVarAccess*)expr)->name;
-
-            // Handle Compound Assignment (Desugaring)
-            if (op.type != TOKEN_EQUALS) {
-                // Transform "x += 1" into "x = x + 1"
-                
-                // 1. Convert the assignment op to a binary op
-                TokenType binOpType;
-                switch (op.type) {
-                    case TOKEN_PLUS_EQUAL:    binOpType = TOKEN_PLUS; break;
-                    case TOKEN_MINUS_EQUAL:   binOpType = TOKEN_MINUS; break;
-                    case TOKEN_STAR_EQUAL:    binOpType = TOKEN_STAR; break;
-                    case TOKEN_SLASH_EQUAL:   binOpType = TOKEN_SLASH; break;
-                    case TOKEN_PERCENT_EQUAL: binOpType = TOKEN_PERCENT; break;
-                    default: binOpType = TOKEN_PLUS; break; // Unreachable
-                }
-                
-                // 2. Create the synthetic binary operator node (x + 1)
-                // Reuse 'expr' (VarAccess x) as the left side
-                Token binToken = op;
-                binToken.type = binOpType;
-                AstNode* binOpNode = new_binary_op_node(binToken, expr, value, op.line);
-                
-                // 3. Assign the result back to x
-                return new_var_assign_node(name, binOpNode, op.line);
-            }
-
-            // Standard Assignment (x = 1)
-            // Discard the VarAccess node as we replace it with VarAssign
-            // (Ideally free(expr) here, but for now we rely on GC/OS cleanup)
-            return new_var_assign_node(name, value, op.line);
-        }
-
-        error_at_current(parser, "Invalid assignment target.");
-    }
-
-    return expr;
-}
-
-
 /**
  * @brief Parses a block of statements enclosed in curly braces.
  * Determa uses C-style braces `{ ... }` for blocks.
@@ -686,10 +713,13 @@ static AstNode* parse_function_declaration(Parser* parser) {
     int old_in_function = parser->inside_func;
     parser->inside_func = 1;
 
-    Token* params = malloc(sizeof(Token) * cap);
+    Token* params = ast_alloc(sizeof(Token) * cap);
     if (!check(parser, TOKEN_RPAREN)) {
         do {
-            if (count >= cap) { cap *= 2; params = realloc(params, sizeof(Token) * cap); }
+            if (count >= cap) {
+                params = ast_realloc(params, sizeof(Token) * cap, sizeof(Token) * cap * 2);
+                cap *= 2;
+            }
             consume(parser, TOKEN_ID, "Expected param name");
             params[count++] = parser->previous;
         } while (match(parser, (TokenType[]){TOKEN_COMMA}, 1));
@@ -770,16 +800,11 @@ static AstNode* parse_statement(Parser* parser) {
 }
 
 /**
- * @brief The main function to parse source code
+ * @brief Parse `source` into a tree whose nodes all come from `arena`.
  *
- * This function initializes a parser and begins the parsing process
- *
- * @param source The source code string to parse
- * @param pda_debug_mode 0 to run silently, 1 to enable PDA trace logging
- * 
- * @return AstNode* The root of the generated AST (or NULL on error)
+ * @return AstNode* The program node (or NULL on error)
  */
-AstNode* parse(const char* source, int pda_debug_mode) {
+static AstNode* parse_program(const char* source, int pda_debug_mode, Arena* arena) {
     /* ---- Debug Mode Setup ---- */
     pda_debug_enabled = pda_debug_mode;
     pda_debug_indent  = 0;
@@ -788,6 +813,11 @@ AstNode* parse(const char* source, int pda_debug_mode) {
     Parser parser;
     parser.lexer = init_lexer(source);
     parser.had_error = 0;
+    // The script is compiled as a function too: a top-level `return` ends
+    // it with a value (the VM leaves it in stack slot 0)
+    parser.inside_func = 1;
+    parser.depth = 0;
+    parser.too_deep = 0;
 
     // initialize tokens to safe defaults
     parser.current = (Token){ .type = TOKEN_ERROR, .lexeme = NULL, .length = 0, .line = 0 };
@@ -797,13 +827,18 @@ AstNode* parse(const char* source, int pda_debug_mode) {
     // Load first token
     advance(&parser);
 
+    // Every node of this tree is carved from one arena
+    Arena* previousArena = ast_use_arena(arena);
+
     // Create Program Node 
     AstNode* program = new_program_node(NULL, 0);
 
     if (!program) {
         fprintf(stderr, "Fatal: Failed to allocate program node.\n");
+        ast_use_arena(previousArena);
         return NULL;
     }
+    ((AstNodeProgram*)program)->arena = arena;
 
     // Parse Until EOF 
     while (!check(&parser, TOKEN_EOF)) {
@@ -812,6 +847,15 @@ AstNode* parse(const char* source, int pda_debug_mode) {
 
         if (stmt != NULL) {
             program_add_statement(program, stmt);
+            if (parser.too_deep) {
+                // The rest of the over-deep expression is still ahead: skip
+                // to the end of the statement (the error stays reported)
+                while (!check(&parser, TOKEN_EOF) && !check(&parser, TOKEN_SEMICOLON)) {
+                    advance(&parser);
+                }
+                if (check(&parser, TOKEN_SEMICOLON)) advance(&parser);
+                parser.too_deep = 0;
+            }
         } else {
             // For now, if we hit an error, we might loop infinitely if we don't consume tokens.
             // A simple sync is to advance until semicolon.
@@ -828,11 +872,45 @@ AstNode* parse(const char* source, int pda_debug_mode) {
         }
     }
 
-    // Final Error Check 
+    ast_use_arena(previousArena);
+
+    // Final Error Check (the partial tree goes with the arena)
     if (parser.had_error) {
-        free_ast(program);   // Clean up partial tree
         return NULL;
     }
 
     return program;  // Success
+}
+
+/**
+ * @brief The main function to parse source code
+ *
+ * This function initializes a parser and begins the parsing process
+ *
+ * @param source The source code string to parse
+ * @param pda_debug_mode 0 to run silently, 1 to enable PDA trace logging
+ * 
+ * @return AstNode* The root of the generated AST (or NULL on error)
+ */
+AstNode* parse(const char* source, int pda_debug_mode) {
+    // The tree gets an arena of its own, released by free_ast(program)
+    Arena* arena = (Arena*)malloc(sizeof(Arena));
+    if (!arena) {
+        fprintf(stderr, "Fatal: Failed to allocate AST arena.\n");
+        return NULL;
+    }
+    arena_init(arena);
+
+    AstNode* program = parse_program(source, pda_debug_mode, arena);
+    if (program == NULL) {
+        arena_free(arena);
+        free(arena);
+        return NULL;
+    }
+    ((AstNodeProgram*)program)->ownsArena = 1;
+    return program;
+}
+
+AstNode* parse_in_arena(const char* source, int pda_debug_mode, Arena* arena) {
+    return parse_program(source, pda_debug_mode, arena);
 }
\ No newline at end of file
@@ -1,35 +1,33 @@
 /**
  * @file symbol.c
  * @author Andrew Fernandes
- * @brief Implementation of a linear-scan symbol table with scope support.
+ * @brief Implementation of a hashed symbol table with scope support.
  *
  * The symbol table stores symbols in a dynamically resized array, preserving
  * insertion order. Scopes are managed by tracking the current depth and
  * removing symbols belonging to exiting scopes.
  *
+ * A NameTable maps each name to its innermost symbol, so lookups and
+ * redefinition checks are O(1). Each symbol remembers the symbol it
+ * shadows; popping a scope points the name back at it.
+ *
+ * Names are not copied: a symbol points at its identifier in the source
+ * text. The typechecker pops every block scope before the AST and source
+ * are released, and moves the names of the globals it keeps into memory
+ * of its own (symbol_table_adopt_names()), so no name outlives its buffer.
+ *
  * @version 0.1
  * @date 2025-11-18
  */
 
 #include "types.h"
 #include "symbol.h"
+#include "arena.h"
 
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
 
-// Helper to duplicate a string
-static char* copy_string(const char* chars, int length) {
-    char* string = (char*)malloc(length + 1);
-    if (string == NULL) {
-        fprintf(stderr, "Not enough memory for symbol name.\n");
-        exit(EXIT_FAILURE);
-    }
-    memcpy(string, chars, length);
-    string[length] = '\0';
-    return string;
-}
-
 /**
  * @brief Initialize a symbol table.
  *
@@ -41,6 +39,7 @@ void symbol_table_init(SymbolTable* table) {
     table->capacity = 16;
     table->count = 0;
     table->current_depth = 0;
+    name_table_init(&table->index);
 
     table->symbols = (Symbol*)malloc(sizeof(Symbol) * table->capacity);
     if (!table->symbols) {
@@ -52,17 +51,14 @@ void symbol_table_init(SymbolTable* table) {
 /**
  * @brief Free the memory used by the symbol table.
  *
- * memory owned externally (source buffer or AST strings).
- * Frees symbol names (because we allocate them in define()).
+ * Symbol names are memory owned externally (the source buffer), so only
+ * the table's own arrays are released.
  *
  * @param table Pointer to the SymbolTable to free.
  */
 void symbol_table_free(SymbolTable* table) {
-    // Free the allocated name strings
-    for (int i = 0; i < table->count; i++) {
-        free((void*)table->symbols[i].name);
-    }
     free(table->symbols);
+    name_table_free(&table->index);
 
     table->symbols = NULL;
     table->count = 0;
@@ -82,6 +78,20 @@ void symbol_table_enter_scope(SymbolTable* table) {
     table->current_depth++;
 }
 
+/**
+ * @brief Remove the newest symbol, uncovering the symbol it shadowed.
+ */
+static void pop_symbol(SymbolTable* table) {
+    Symbol* s = &table->symbols[--table->count];
+
+    if (s->shadowed >= 0) {
+        Symbol* outer = &table->symbols[s->shadowed];
+        name_table_set(&table->index, outer->name, outer->name_len, s->shadowed);
+    } else {
+        name_table_delete(&table->index, s->name, s->name_len);
+    }
+}
+
 /**
  * @brief Exit the current scope, removing symbols defined inside it.
  *
@@ -91,15 +101,52 @@ void symbol_table_enter_scope(SymbolTable* table) {
  */
 void symbol_table_exit_scope(SymbolTable* table) {
     while (table->count > 0 && table->symbols[table->count - 1].depth == table->current_depth) {
-
-        table->count--;
-        free((void*)table->symbols[table->count].name); // Free the name
+        pop_symbol(table);
     }
 
     if (table->current_depth > 0)
         table->current_depth--;
 }
 
+/**
+ * @brief Remove the symbols defined after the first `count`, newest first.
+ *
+ * @param table Pointer to the symbol table.
+ * @param count Number of symbols to keep.
+ */
+void symbol_table_truncate(SymbolTable* table, int count) {
+    while (table->count > count) {
+        pop_symbol(table);
+    }
+}
+
+/**
+ * @brief Copy the names of the symbols from index `first` on into `arena`.
+ *
+ * The symbols then no longer depend on the source they were declared in.
+ *
+ * @param table Pointer to the symbol table.
+ * @param first Index of the first symbol to move.
+ * @param arena Arena that owns the copies.
+ */
+void symbol_table_adopt_names(SymbolTable* table, int first, Arena* arena) {
+    for (int i = first; i < table->count; i++) {
+        Symbol* s = &table->symbols[i];
+        char* copy = (char*)arena_alloc(arena, s->name_len);
+        if (!copy) {
+            fprintf(stderr, "Fatal: failed to allocate symbol name.\n");
+            exit(EXIT_FAILURE);
+        }
+        memcpy(copy, s->name, s->name_len);
+        s->name = copy;
+
+        // Repoint the key if this symbol is the name's newest binding
+        if (name_table_get(&table->index, copy, s->name_len) == i) {
+            name_table_set(&table->index, copy, s->name_len, i);
+        }
+    }
+}
+
 /**
  * @brief Define a new symbol in the current scope.
  *
@@ -113,24 +160,17 @@ void symbol_table_exit_scope(SymbolTable* table) {
  * @return int 1 if definition succeeded, 0 if already defined in this scope.
  */
 int symbol_table_define(SymbolTable* table, const char* name, int len, DataType type) {
-    // Check for redefinition within this scope only
-    for (int i = table->count - 1; i >= 0; i--) {
-        Symbol* s = &table->symbols[i];
-
-        // Stop once we hit an outer scope
-        if (s->depth < table->current_depth) break;
-
-        if (s->depth == table->current_depth &&
-            s->name_len == len &&
-            strncmp(s->name, name, len) == 0) {
-
-            // Allow redefinition in Global Scope (Depth 0) for REPL convenience
-            if (table->current_depth == 0) {
-                s->type = type;
-                return 1; // Success (overwrite)
-            }
-            return 0; // Redefinition error in same scope
+    // Check for redefinition within this scope only: the newest symbol
+    // with this name is the only one that can be in the current scope
+    int existing = name_table_get(&table->index, name, len);
+    if (existing >= 0 && table->symbols[existing].depth == table->current_depth) {
+
+        // Allow redefinition in Global Scope (Depth 0) for REPL convenience
+        if (table->current_depth == 0) {
+            table->symbols[existing].type = type;
+            return 1; // Success (overwrite)
         }
+        return 0; // Redefinition error in same scope
     }
 
     // Resize if needed
@@ -147,10 +187,12 @@ int symbol_table_define(SymbolTable* table, const char* name, int len, DataType
 
     // Insert new symbol
     Symbol* s = &table->symbols[table->count++];
-    s->name = copy_string(name, len);       // Assumes caller-owned lifetime
+    s->name = name;                         // Borrowed: caller-owned lifetime
     s->name_len = len;
     s->type = type;
     s->depth = table->current_depth;
+    s->shadowed = existing;
+    name_table_set(&table->index, s->name, len, table->count - 1);
 
     return 1;
 }
@@ -158,8 +200,7 @@ int symbol_table_define(SymbolTable* table, const char* name, int len, DataType
 /**
  * @brief Look up a symbol by name in any accessible scope.
  *
- * Searches from innermost scope outward. Returns the most recent
- * matching symbol.
+ * Returns the most recent (innermost) matching symbol.
  *
  * @param table Pointer to the symbol table.
  * @param name Name to search for.
@@ -167,11 +208,7 @@ int symbol_table_define(SymbolTable* table, const char* name, int len, DataType
  * @return DataType The type of the symbol, or TYPE_ERROR if not found.
  */
 DataType symbol_table_lookup(SymbolTable* table, const char* name, int len) {
-    for (int i = table->count - 1; i >= 0; i--) {
-        Symbol* s = &table->symbols[i];
-        if (s->name_len == len && strncmp(s->name, name, len) == 0) {
-            return s->type;
-        }
-    }
+    int index = name_table_get(&table->index, name, len);
+    if (index >= 0) return table->symbols[index].type;
     return TYPE_ERROR;
 }
@@ -0,0 +1,291 @@
+/**
+ * @file thread_pool.c
+ * @brief Work-stealing thread pool over POSIX threads / Win32 threads.
+ *
+ * @version 0.1
+ * @date 2026-10-14
+ *
+ * @copyright Copyright (c) 2025
+ *
+ */
+
+#include "thread_pool.h"
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+#ifdef _WIN32
+#include <windows.h>
+
+typedef CRITICAL_SECTION Mutex;
+typedef CONDITION_VARIABLE Cond;
+typedef HANDLE Thread;
+
+#define mutex_init(m)     InitializeCriticalSection(m)
+#define mutex_destroy(m)  DeleteCriticalSection(m)
+#define mutex_lock(m)     EnterCriticalSection(m)
+#define mutex_unlock(m)   LeaveCriticalSection(m)
+#define cond_init(c)      InitializeConditionVariable(c)
+#define cond_destroy(c)   ((void)(c))
+#define cond_wait(c, m)   SleepConditionVariableCS(c, m, INFINITE)
+#define cond_broadcast(c) WakeAllConditionVariable(c)
+#define cond_signal(c)    WakeConditionVariable(c)
+#else
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+
+typedef pthread_mutex_t Mutex;
+typedef pthread_cond_t Cond;
+typedef pthread_t Thread;
+
+#define mutex_init(m)     pthread_mutex_init(m, NULL)
+#define mutex_destroy(m)  pthread_mutex_destroy(m)
+#define mutex_lock(m)     pthread_mutex_lock(m)
+#define mutex_unlock(m)   pthread_mutex_unlock(m)
+#define cond_init(c)      pthread_cond_init(c, NULL)
+#define cond_destroy(c)   pthread_cond_destroy(c)
+#define cond_wait(c, m)   pthread_cond_wait(c, m)
+#define cond_broadcast(c) pthread_cond_broadcast(c)
+#define cond_signal(c)    pthread_cond_signal(c)
+#endif
+
+/**
+ * @struct Share
+ * @brief The indices a worker has not started yet: [next, end).
+ *
+ * The owner takes from the front, thieves split off the back.
+ */
+typedef struct {
+    Mutex lock;
+    int next;
+    int end;
+} Share;
+
+typedef struct {
+    ThreadPool* pool;
+    int worker;
+} WorkerStart;
+
+struct ThreadPool {
+    int size;                // Workers, the caller (worker 0) included
+    Thread* threads;         // size - 1 threads, for workers 1..size-1
+    WorkerStart* starts;
+    Share* shares;           // One per worker
+
+    Mutex lock;              // Guards everything below
+    Cond wake;               // A run started, or the pool is stopping
+    Cond done;               // The last thread left the run
+    unsigned generation;     // Bumped by every run
+    int busy;                // Threads still working on the current run
+    bool stopping;
+    PoolTask task;
+    void* context;
+};
+
+int thread_pool_cpu_count(void) {
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    int count = (int)info.dwNumberOfProcessors;
+#else
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+    return count > 0 ? (int)count : 1;
+}
+
+/**
+ * @brief Claim the next index of `share`.
+ */
+static bool take_index(Share* share, int* index) {
+    mutex_lock(&share->lock);
+    bool taken = share->next < share->end;
+    if (taken) *index = share->next++;
+    mutex_unlock(&share->lock);
+    return taken;
+}
+
+/**
+ * @brief Move the back half of the largest other share to `worker`'s.
+ *
+ * @return false once every share is empty (no run adds work midway, so
+ *         the worker is done).
+ */
+static bool steal_work(ThreadPool* pool, int worker) {
+    for (;;) {
+        int victim = -1;
+        int largest = 0;
+        for (int i = 0; i < pool->size; i++) {
+            if (i == worker) continue;
+            mutex_lock(&pool->shares[i].lock);
+            int remaining = pool->shares[i].end - pool->shares[i].next;
+            mutex_unlock(&pool->shares[i].lock);
+            if (remaining > largest) {
+                largest = remaining;
+                victim = i;
+            }
+        }
+        if (victim < 0) return false;
+
+        // The victim may have moved on since the scan: split what is left now
+        Share* from = &pool->shares[victim];
+        mutex_lock(&from->lock);
+        int remaining = from->end - from->next;
+        int start = from->end - (remaining + 1) / 2;
+        int end = from->end;
+        if (remaining > 0) from->end = start;
+        mutex_unlock(&from->lock);
+        if (remaining <= 0) continue;
+
+        Share* to = &pool->shares[worker];
+        mutex_lock(&to->lock);
+        to->next = start;
+        to->end = end;
+        mutex_unlock(&to->lock);
+        return true;
+    }
+}
+
+/**
+ * @brief Run `worker`'s share of the current run, then steal until no
+ * work is left.
+ */
+static void work(ThreadPool* pool, int worker) {
+    int index;
+    do {
+        while (take_index(&pool->shares[worker], &index)) {
+            pool->task(pool->context, index, worker);
+        }
+    } while (steal_work(pool, worker));
+}
+
+#ifdef _WIN32
+static DWORD WINAPI worker_main(LPVOID argument) {
+#else
+static void* worker_main(void* argument) {
+#endif
+    WorkerStart* start = (WorkerStart*)argument;
+    ThreadPool* pool = start->pool;
+    unsigned seen = 0;
+
+    mutex_lock(&pool->lock);
+    for (;;) {
+        while (pool->generation == seen && !pool->stopping) cond_wait(&pool->wake, &pool->lock);
+        if (pool->stopping) break;
+        seen = pool->generation;
+        mutex_unlock(&pool->lock);
+
+        work(pool, start->worker);
+
+        mutex_lock(&pool->lock);
+        if (--pool->busy == 0) cond_signal(&pool->done);
+    }
+    mutex_unlock(&pool->lock);
+    return 0;
+}
+
+/**
+ * @brief Start the thread of `worker`.
+ */
+static bool start_thread(ThreadPool* pool, int worker) {
+    WorkerStart* start = &pool->starts[worker];
+    start->pool = pool;
+    start->worker = worker;
+#ifdef _WIN32
+    pool->threads[worker - 1] = CreateThread(NULL, 0, worker_main, start, 0, NULL);
+    return pool->threads[worker - 1] != NULL;
+#else
+    return pthread_create(&pool->threads[worker - 1], NULL, worker_main, start) == 0;
+#endif
+}
+
+ThreadPool* thread_pool_new(int workers) {
+    if (workers <= 0) workers = thread_pool_cpu_count();
+
+    ThreadPool* pool = (ThreadPool*)calloc(1, sizeof(ThreadPool));
+    if (pool == NULL) return NULL;
+    pool->threads = (Thread*)malloc(sizeof(Thread) * (size_t)workers);
+    pool->starts = (WorkerStart*)malloc(sizeof(WorkerStart) * (size_t)workers);
+    pool->shares = (Share*)calloc((size_t)workers, sizeof(Share));
+    if (pool->threads == NULL || pool->starts == NULL || pool->shares == NULL) {
+        free(pool->threads);
+        free(pool->starts);
+        free(pool->shares);
+        free(pool);
+        return NULL;
+    }
+
+    mutex_init(&pool->lock);
+    cond_init(&pool->wake);
+    cond_init(&pool->done);
+    for (int i = 0; i < workers; i++) mutex_init(&pool->shares[i].lock);
+
+    // Worker 0 is the caller; keep however many threads start
+    pool->size = 1;
+    while (pool->size < workers && start_thread(pool, pool->size)) pool->size++;
+    for (int i = pool->size; i < workers; i++) mutex_destroy(&pool->shares[i].lock);
+    return pool;
+}
+
+int thread_pool_size(const ThreadPool* pool) {
+    return pool->size;
+}
+
+void thread_pool_run(ThreadPool* pool, int count, PoolTask task, void* context) {
+    if (count <= 0) return;
+
+    // Every thread is parked, so the shares can be set without their locks
+    for (int i = 0; i < pool->size; i++) {
+        pool->shares[i].next = (int)((long long)count * i / pool->size);
+        pool->shares[i].end = (int)((long long)count * (i + 1) / pool->size);
+    }
+
+    mutex_lock(&pool->lock);
+    pool->task = task;
+    pool->context = context;
+    pool->busy = pool->size - 1;
+    pool->generation++;
+    cond_broadcast(&pool->wake);
+    mutex_unlock(&pool->lock);
+
+    work(pool, 0);
+
+    mutex_lock(&pool->lock);
+    while (pool->busy > 0) cond_wait(&pool->done, &pool->lock);
+    mutex_unlock(&pool->lock);
+}
+
+void thread_pool_free(ThreadPool* pool) {
+    if (pool == NULL) return;
+
+    mutex_lock(&pool->lock);
+    pool->stopping = true;
+    cond_broadcast(&pool->wake);
+    mutex_unlock(&pool->lock);
+
+    for (int i = 0; i < pool->size - 1; i++) {
+#ifdef _WIN32
+        WaitForSingleObject(pool->threads[i], INFINITE);
+        CloseHandle(pool->threads[i]);
+#else
+        pthread_join(pool->threads[i], NULL);
+#endif
+    }
+
+    for (int i = 0; i < pool->size; i++) mutex_destroy(&pool->shares[i].lock);
+    cond_destroy(&pool->done);
+    cond_destroy(&pool->wake);
+    mutex_destroy(&pool->lock);
+    free(pool->threads);
+    free(pool->starts);
+    free(pool->shares);
+    free(pool);
+}
+
+void thread_pool_yield(void) {
+#ifdef _WIN32
+    SwitchToThread();
+#else
+    sched_yield();
+#endif
+}
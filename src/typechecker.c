@@ -17,27 +17,81 @@
 #include "symbol.h"
 #include "ast.h"
 #include "token.h"
+#include "tls.h"
+#include "name_table.h"
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 // --- Persistent State ---
-static SymbolTable globalSymbols;
-static int is_initialized = 0;
+static DETERMA_THREAD_LOCAL SymbolTable globalSymbols;
+static DETERMA_THREAD_LOCAL Arena globalNames;  // Names of globalSymbols (their ASTs are gone)
+static DETERMA_THREAD_LOCAL int is_initialized = 0;
+
+/*
+ * Unproven names
+ * --------------
+ * Function bodies and call results are not typechecked yet, so a variable
+ * written from either can hold any runtime type regardless of what the
+ * symbol table says; so can a global declared by an earlier unit (see
+ * typecheck_end()). Such names are recorded here (persisting across REPL
+ * runs) and their expressions are never annotated with a resolvedType, so
+ * the compiler keeps the checked opcodes for them.
+ */
+typedef struct {
+    char* name;
+    int length;
+} UnprovenName;
+
+static DETERMA_THREAD_LOCAL UnprovenName* unprovenNames = NULL;
+static DETERMA_THREAD_LOCAL int unprovenCount = 0;
+static DETERMA_THREAD_LOCAL int unprovenCapacity = 0;
+static DETERMA_THREAD_LOCAL NameTable unprovenIndex;
+
+// Names a collection pass has already read as proven (keys borrow the AST)
+static DETERMA_THREAD_LOCAL NameTable provenReads;
+
+/*
+ * Function signatures
+ * -------------------
+ * Declared return types of script functions and natives, so a call can be
+ * used as an initializer (`var t = clock();`). Like unproven names they
+ * persist across REPL runs. Calls stay unproven either way: the bodies
+ * are not checked, so the VM keeps its checked opcodes for the result.
+ */
+typedef struct {
+    char* name;
+    int length;
+    DataType returnType;
+} FunctionSignature;
+
+static DETERMA_THREAD_LOCAL FunctionSignature* signatures = NULL;
+static DETERMA_THREAD_LOCAL int signatureCount = 0;
+static DETERMA_THREAD_LOCAL int signatureCapacity = 0;
+static DETERMA_THREAD_LOCAL NameTable signatureIndex;
 
 /**
  * @struct TypeChecker
- * @brief Internal state for the recursive type-checking pass.
+ * @brief State of one checking run (typecheck_ast() or a fused compile).
  *
  * @var TypeChecker::symbols
  * Symbol table used while traversing the AST.
  *
  * @var TypeChecker::had_error
  * Set to 1 if any type error is reported.
+ *
+ * @var TypeChecker::unitStart
+ * Number of symbols (all globals) declared by earlier units.
  */
-typedef struct {
+struct TypeChecker {
     SymbolTable symbols;
     int had_error;
-} TypeChecker;
+    int unitStart;
+};
+
+// The run in progress (a unit is checked by one walk at a time)
+static DETERMA_THREAD_LOCAL TypeChecker activeChecker;
 
 
 void init_typechecker() {
@@ -51,8 +105,270 @@ void init_typechecker() {
 void free_typechecker() {
     if (is_initialized) {
         symbol_table_free(&globalSymbols);
+        arena_free(&globalNames);
         is_initialized = 0;
     }
+
+    for (int i = 0; i < unprovenCount; i++) {
+        free(unprovenNames[i].name);
+    }
+    free(unprovenNames);
+    unprovenNames = NULL;
+    unprovenCount = 0;
+    unprovenCapacity = 0;
+    name_table_free(&unprovenIndex);
+
+    for (int i = 0; i < signatureCount; i++) {
+        free(signatures[i].name);
+    }
+    free(signatures);
+    signatures = NULL;
+    signatureCount = 0;
+    signatureCapacity = 0;
+    name_table_free(&signatureIndex);
+}
+
+
+// ===========================
+// --- Function Signatures ---
+// ===========================
+
+void typechecker_declare_function(const char* name, int length, DataType returnType) {
+    int existing = name_table_get(&signatureIndex, name, length);
+    if (existing >= 0) {
+        signatures[existing].returnType = returnType;
+        return;
+    }
+
+    if (signatureCount >= signatureCapacity) {
+        int newCapacity = signatureCapacity < 8 ? 8 : signatureCapacity * 2;
+        FunctionSignature* grown = (FunctionSignature*)realloc(signatures, sizeof(FunctionSignature) * newCapacity);
+        if (!grown) {
+            fprintf(stderr, "Fatal: failed to grow function signature list.\n");
+            exit(EXIT_FAILURE);
+        }
+        signatures = grown;
+        signatureCapacity = newCapacity;
+    }
+
+    char* copy = (char*)malloc(length + 1);
+    if (!copy) {
+        fprintf(stderr, "Fatal: failed to allocate function signature.\n");
+        exit(EXIT_FAILURE);
+    }
+    memcpy(copy, name, length);
+    copy[length] = '\0';
+
+    signatures[signatureCount].name = copy;
+    signatures[signatureCount].length = length;
+    signatures[signatureCount].returnType = returnType;
+    name_table_set(&signatureIndex, copy, length, signatureCount);
+    signatureCount++;
+}
+
+/**
+ * @brief Declared return type of `name`, or TYPE_ERROR if unknown.
+ *
+ * TYPE_VOID counts as unknown: it is also what an unannotated function
+ * gets, and those may still return a value (the body is not checked).
+ */
+static DataType lookup_function_type(const char* name, int length) {
+    int index = name_table_get(&signatureIndex, name, length);
+    if (index < 0 || signatures[index].returnType == TYPE_VOID) return TYPE_ERROR;
+    return signatures[index].returnType;
+}
+
+
+// =======================
+// --- Unproven Names ---
+// =======================
+
+static int is_unproven_name(const char* name, int length) {
+    return name_table_get(&unprovenIndex, name, length) >= 0;
+}
+
+/**
+ * @brief is_unproven_name() for the collection pass, remembering the names
+ * it answered "proven" for.
+ */
+static int read_unproven_name(const char* name, int length) {
+    if (is_unproven_name(name, length)) return 1;
+    name_table_set(&provenReads, name, length, 0);
+    return 0;
+}
+
+/**
+ * @brief Record a name as unproven.
+ *
+ * @return int 1 if the name is new and this pass already read it as proven
+ * (that read, and what depends on it, must be redone), 0 otherwise.
+ */
+static int mark_unproven_name(const char* name, int length) {
+    if (is_unproven_name(name, length)) return 0;
+
+    if (unprovenCount >= unprovenCapacity) {
+        int newCapacity = unprovenCapacity < 8 ? 8 : unprovenCapacity * 2;
+        UnprovenName* grown = (UnprovenName*)realloc(unprovenNames, sizeof(UnprovenName) * newCapacity);
+        if (!grown) {
+            fprintf(stderr, "Fatal: failed to grow unproven name list.\n");
+            exit(EXIT_FAILURE);
+        }
+        unprovenNames = grown;
+        unprovenCapacity = newCapacity;
+    }
+
+    char* copy = (char*)malloc(length + 1);
+    if (!copy) {
+        fprintf(stderr, "Fatal: failed to allocate unproven name.\n");
+        exit(EXIT_FAILURE);
+    }
+    memcpy(copy, name, length);
+    copy[length] = '\0';
+
+    unprovenNames[unprovenCount].name = copy;
+    unprovenNames[unprovenCount].length = length;
+    name_table_set(&unprovenIndex, copy, length, unprovenCount);
+    unprovenCount++;
+    return name_table_get(&provenReads, name, length) >= 0;
+}
+
+
+// ===========================
+// --- Snapshot Globals ---
+// ===========================
+
+void typechecker_global_types(const char* name, int length, DataType* varType, DataType* returnType) {
+    *varType = is_initialized ? symbol_table_lookup(&globalSymbols, name, length) : TYPE_ERROR;
+    int index = name_table_get(&signatureIndex, name, length);
+    *returnType = index >= 0 ? signatures[index].returnType : TYPE_ERROR;
+}
+
+void typechecker_restore_global(const char* name, int length, DataType varType, DataType returnType) {
+    init_typechecker();
+    if (varType != TYPE_ERROR) {
+        int count = globalSymbols.count;
+        symbol_table_define(&globalSymbols, name, length, varType);
+        symbol_table_adopt_names(&globalSymbols, count, &globalNames);
+    }
+    if (returnType != TYPE_ERROR) typechecker_declare_function(name, length, returnType);
+    mark_unproven_name(name, length);
+}
+
+/**
+ * @brief Conservatively decide whether an expression's runtime type may
+ * differ from its static type (it calls a function or reads an unproven name).
+ */
+static int expression_may_be_unproven(AstNode* expr) {
+    if (expr == NULL) return 0;
+
+    switch (expr->type) {
+        case NODE_CALL:
+            return 1;
+        case NODE_VAR_ACCESS: {
+            AstNodeVarAccess* n = (AstNodeVarAccess*)expr;
+            return read_unproven_name(n->name.lexeme, n->name.length);
+        }
+        case NODE_VAR_ASSIGN:
+            return expression_may_be_unproven(((AstNodeVarAssign*)expr)->expression);
+        case NODE_UNARY_OP:
+            return expression_may_be_unproven(((AstNodeUnaryOp*)expr)->operand);
+        case NODE_BINARY_OP: {
+            AstNodeBinaryOp* n = (AstNodeBinaryOp*)expr;
+            return expression_may_be_unproven(n->left) || expression_may_be_unproven(n->right);
+        }
+        default:
+            return 0;
+    }
+}
+
+/**
+ * @brief One pass over the tree marking every name that may be written with
+ * a value of unknown type.
+ *
+ * Any write inside a function body counts (bodies are not checked), as does
+ * a top-level write of an unproven expression and every function name.
+ *
+ * @return int 1 if a name was marked after being read as proven (caller
+ * repeats until stable; usually one pass is enough).
+ */
+static int collect_unproven_names(AstNode* node, int inFunction) {
+    if (node == NULL) return 0;
+    int changed = 0;
+
+    switch (node->type) {
+        case NODE_PROGRAM: {
+            AstNodeProgram* n = (AstNodeProgram*)node;
+            for (int i = 0; i < n->statement_count; i++)
+                changed |= collect_unproven_names(n->statements[i], inFunction);
+            break;
+        }
+        case NODE_BLOCK: {
+            AstNodeBlock* n = (AstNodeBlock*)node;
+            for (int i = 0; i < n->statement_count; i++)
+                changed |= collect_unproven_names(n->statements[i], inFunction);
+            break;
+        }
+        case NODE_FUNC_DECL: {
+            AstNodeFuncDecl* n = (AstNodeFuncDecl*)node;
+            changed |= mark_unproven_name(n->name.lexeme, n->name.length);
+            changed |= collect_unproven_names(n->body, 1);
+            break;
+        }
+        case NODE_VAR_DECL: {
+            AstNodeVarDecl* n = (AstNodeVarDecl*)node;
+            if (expression_may_be_unproven(n->init))
+                changed |= mark_unproven_name(n->name.lexeme, n->name.length);
+            changed |= collect_unproven_names(n->init, inFunction);
+            break;
+        }
+        case NODE_VAR_ASSIGN: {
+            AstNodeVarAssign* n = (AstNodeVarAssign*)node;
+            if (inFunction || expression_may_be_unproven(n->expression))
+                changed |= mark_unproven_name(n->name.lexeme, n->name.length);
+            changed |= collect_unproven_names(n->expression, inFunction);
+            break;
+        }
+        case NODE_IF: {
+            AstNodeIf* n = (AstNodeIf*)node;
+            changed |= collect_unproven_names(n->condition, inFunction);
+            changed |= collect_unproven_names(n->thenBranch, inFunction);
+            changed |= collect_unproven_names(n->elseBranch, inFunction);
+            break;
+        }
+        case NODE_WHILE: {
+            AstNodeWhile* n = (AstNodeWhile*)node;
+            changed |= collect_unproven_names(n->condition, inFunction);
+            changed |= collect_unproven_names(n->body, inFunction);
+            break;
+        }
+        case NODE_PRINT_STMT:
+            changed |= collect_unproven_names(((AstNodePrintStmt*)node)->expression, inFunction);
+            break;
+        case NODE_EXPR_STMT:
+            changed |= collect_unproven_names(((AstNodeExprStmt*)node)->expression, inFunction);
+            break;
+        case NODE_RETURN:
+            changed |= collect_unproven_names(((AstNodeReturn*)node)->value, inFunction);
+            break;
+        case NODE_UNARY_OP:
+            changed |= collect_unproven_names(((AstNodeUnaryOp*)node)->operand, inFunction);
+            break;
+        case NODE_BINARY_OP: {
+            AstNodeBinaryOp* n = (AstNodeBinaryOp*)node;
+            changed |= collect_unproven_names(n->left, inFunction);
+            changed |= collect_unproven_names(n->right, inFunction);
+            break;
+        }
+        case NODE_CALL: {
+            AstNodeCall* n = (AstNodeCall*)node;
+            for (int i = 0; i < n->arg_count; i++)
+                changed |= collect_unproven_names(n->args[i], inFunction);
+            break;
+        }
+        default:
+            break;
+    }
+    return changed;
 }
 
 
@@ -69,21 +385,120 @@ static void error(TypeChecker* tc, const char* msg) {
 
 // Forward declarations
 static DataType check_expression(TypeChecker* tc, AstNode* expr);
+static DataType infer_expression(TypeChecker* tc, AstNode* expr, const DataType* operands);
 static void check_statement(TypeChecker* tc, AstNode* stmt);
 
 /**
- * @brief Recursively checks the type of an expression AST node.
+ * @brief Report an undefined variable.
+ */
+static void undefined_variable(TypeChecker* tc, Token name) {
+    char buf[256];
+    snprintf(buf, sizeof(buf), "Undefined variable '%.*s'", name.length, name.lexeme);
+    error(tc, buf);
+}
+
+/**
+ * @brief Type an expression whose operands are already checked, and
+ * annotate it with its resolved type.
  *
- * Supported:
- *  - Integer literals
- *  - Variable access
- *  - Binary operations (+ only for now)
+ * The annotation is only set when the type holds at runtime too: every
+ * operand is itself proven and no unproven name is involved. Otherwise
+ * resolvedType stays TYPE_ERROR and the compiler emits checked opcodes.
+ */
+DataType typecheck_resolve(TypeChecker* tc, AstNode* expr, const DataType* operands) {
+    DataType type = infer_expression(tc, expr, operands);
+    if (expr == NULL) return type;
+
+    int proven = (type != TYPE_ERROR);
+
+    switch (expr->type) {
+        case NODE_VAR_ACCESS: {
+            AstNodeVarAccess* n = (AstNodeVarAccess*)expr;
+            proven = proven && !is_unproven_name(n->name.lexeme, n->name.length);
+            break;
+        }
+        case NODE_VAR_ASSIGN:
+            proven = proven && ((AstNodeVarAssign*)expr)->expression->resolvedType != TYPE_ERROR;
+            break;
+        case NODE_UNARY_OP:
+            proven = proven && ((AstNodeUnaryOp*)expr)->operand->resolvedType != TYPE_ERROR;
+            break;
+        case NODE_BINARY_OP: {
+            AstNodeBinaryOp* n = (AstNodeBinaryOp*)expr;
+            proven = proven && n->left->resolvedType != TYPE_ERROR
+                            && n->right->resolvedType != TYPE_ERROR;
+            break;
+        }
+        case NODE_INT_LITERAL:
+        case NODE_STRING_LITERAL:
+        case NODE_BOOL_LITERAL:
+            break;
+        default:
+            proven = 0;
+            break;
+    }
+
+    expr->resolvedType = proven ? type : TYPE_ERROR;
+    return type;
+}
+
+/**
+ * @brief Check an expression and its operands (children first).
  *
  * @param tc   Active type-checker context.
  * @param expr Expression AST node.
  * @return DataType  Resulting type, or TYPE_ERROR if invalid.
  */
 static DataType check_expression(TypeChecker* tc, AstNode* expr) {
+    DataType operands[2] = { TYPE_ERROR, TYPE_ERROR };
+
+    if (expr != NULL) {
+        switch (expr->type) {
+            case NODE_UNARY_OP:
+                operands[0] = check_expression(tc, ((AstNodeUnaryOp*)expr)->operand);
+                break;
+            case NODE_BINARY_OP: {
+                AstNodeBinaryOp* n = (AstNodeBinaryOp*)expr;
+                operands[0] = check_expression(tc, n->left);
+                operands[1] = check_expression(tc, n->right);
+                break;
+            }
+            case NODE_VAR_ASSIGN: {
+                AstNodeVarAssign* n = (AstNodeVarAssign*)expr;
+                if (!typecheck_assign_target(tc, n)) return TYPE_ERROR;
+                operands[0] = check_expression(tc, n->expression);
+                break;
+            }
+            case NODE_CALL: {
+                AstNodeCall* n = (AstNodeCall*)expr;
+                for (int i = 0; i < n->arg_count; i++)
+                    check_expression(tc, n->args[i]);
+                break;
+            }
+            default:
+                break;
+        }
+    }
+
+    return typecheck_resolve(tc, expr, operands);
+}
+
+/**
+ * @brief Infers the type of an expression AST node from the types of its
+ * (already checked) operands.
+ *
+ * Supported:
+ *  - Integer, string and boolean literals
+ *  - Variable access and assignment
+ *  - Unary and binary operations
+ *  - Calls (the callee's declared return type)
+ *
+ * @param tc       Active type-checker context.
+ * @param expr     Expression AST node.
+ * @param operands Unary: {operand}; binary: {left, right}; assignment: {value}.
+ * @return DataType  Resulting type, or TYPE_ERROR if invalid.
+ */
+static DataType infer_expression(TypeChecker* tc, AstNode* expr, const DataType* operands) {
     if (expr == NULL)
         return TYPE_VOID;
 
@@ -100,7 +515,7 @@ static DataType check_expression(TypeChecker* tc, AstNode* expr) {
 
         case NODE_UNARY_OP: {
             AstNodeUnaryOp* n = (AstNodeUnaryOp*)expr;
-            DataType type = check_expression(tc, n->operand);
+            DataType type = operands[0];
 
             // If operator type is '-'
             if (n->op.type == TOKEN_MINUS) {
@@ -128,9 +543,7 @@ static DataType check_expression(TypeChecker* tc, AstNode* expr) {
             DataType type = symbol_table_lookup(&tc->symbols, access->name.lexeme, access->name.length);
             
             if (type == TYPE_ERROR) {
-                char buf[256];
-                snprintf(buf, sizeof(buf), "Undefined variable '%.*s'", access->name.length, access->name.lexeme);
-                error(tc, buf);
+                undefined_variable(tc, access->name);
             }
             return type;
         }
@@ -138,20 +551,11 @@ static DataType check_expression(TypeChecker* tc, AstNode* expr) {
         case NODE_VAR_ASSIGN: {
             AstNodeVarAssign* assign = (AstNodeVarAssign*)expr;
 
-            // 1. Check if variable exists
-            // Note: using lookup, NOT define, because the var must already exist.
+            // The target was found by typecheck_assign_target()
             DataType varType = symbol_table_lookup(&tc->symbols, assign->name.lexeme, assign->name.length);
-            if (varType == TYPE_ERROR) {
-                char buf[256];
-                snprintf(buf, sizeof(buf), "Undefined variable '%.*s'", assign->name.length, assign->name.lexeme);
-                error(tc, buf);
-                return TYPE_ERROR;
-            }
-
-            // 2. Check value type
-            DataType valueType = check_expression(tc, assign->expression);
+            DataType valueType = operands[0];
             
-            // 3. Ensure types match (e.g. can't assign string to int var)
+            // Ensure types match (e.g. can't assign string to int var)
             if (varType != valueType && valueType != TYPE_ERROR) {
                 error(tc, "Type mismatch in assignment.");
                 return TYPE_ERROR;
@@ -162,10 +566,8 @@ static DataType check_expression(TypeChecker* tc, AstNode* expr) {
 
         case NODE_BINARY_OP: {
             AstNodeBinaryOp* op = (AstNodeBinaryOp*)expr;
-
-            // Optimized: Only call once per child expression
-            DataType leftType  = check_expression(tc, op->left);
-            DataType rightType = check_expression(tc, op->right);
+            DataType leftType  = operands[0];
+            DataType rightType = operands[1];
 
             // Propagate type errors
             if (leftType == TYPE_ERROR || rightType == TYPE_ERROR)
@@ -213,12 +615,75 @@ static DataType check_expression(TypeChecker* tc, AstNode* expr) {
             return TYPE_ERROR;
         }
 
+        case NODE_CALL: {
+            // Arguments are checked for their own errors; the call itself
+            // has its callee's declared type (silently unknown otherwise)
+            AstNodeCall* call = (AstNodeCall*)expr;
+            return lookup_function_type(call->callee.lexeme, call->callee.length);
+        }
+
         default:
             // Unknown expression node
             return TYPE_ERROR;
     }
 }
 
+
+// ==========================
+// --- Statement Checking ---
+// ==========================
+
+int typecheck_assign_target(TypeChecker* tc, AstNodeVarAssign* assign) {
+    // Using lookup, NOT define, because the var must already exist
+    if (symbol_table_lookup(&tc->symbols, assign->name.lexeme, assign->name.length) == TYPE_ERROR) {
+        undefined_variable(tc, assign->name);
+        assign->node.resolvedType = TYPE_ERROR;
+        return 0;
+    }
+    return 1;
+}
+
+void typecheck_declare(TypeChecker* tc, AstNodeVarDecl* decl, DataType initType) {
+    // Determine type from initializer
+    if (decl->init == NULL) {
+        error(tc, "Variable declaration requires an initializer for type inference.");
+        return;
+    }
+
+    if (initType == TYPE_ERROR)
+        return;
+
+    int defined = symbol_table_define(&tc->symbols, decl->name.lexeme, decl->name.length, initType);
+
+    // Add to symbol table
+    // If failed (and not global), report error. 
+    // Global redefinition is handled inside symbol_table_define returning 1.
+    if (!defined && tc->symbols.current_depth > 0) {
+         char buf[256];
+         snprintf(buf, sizeof(buf), "Variable '%.*s' already declared in this scope", decl->name.length, decl->name.lexeme);
+         error(tc, buf);
+    }
+}
+
+void typecheck_print(TypeChecker* tc, DataType type) {
+    if (type == TYPE_VOID)
+        error(tc, "Cannot print a void expression.");
+}
+
+void typecheck_condition(TypeChecker* tc, AstNode* stmt, DataType conditionType) {
+    if (conditionType == TYPE_BOOL) return;
+    error(tc, stmt->type == NODE_WHILE ? "While condition must be a boolean."
+                                       : "If condition must be a boolean.");
+}
+
+void typecheck_enter_scope(TypeChecker* tc) {
+    symbol_table_enter_scope(&tc->symbols);
+}
+
+void typecheck_exit_scope(TypeChecker* tc) {
+    symbol_table_exit_scope(&tc->symbols);
+}
+
 /**
  * @brief Recursively type-check a statement node.
  *
@@ -239,45 +704,14 @@ static void check_statement(TypeChecker* tc, AstNode* stmt) {
 
         case NODE_VAR_DECL: {
             AstNodeVarDecl* decl = (AstNodeVarDecl*)stmt;
-            DataType initType = TYPE_VOID;
-
-            // Determine type from initializer
-            if (decl->init != NULL) {
-                initType = check_expression(tc, decl->init);
-                if (initType == TYPE_ERROR) return;
-            } else {
-                error(tc, "Variable declaration requires an initializer for type inference.");
-                return;
-            }
-
-            if (initType == TYPE_ERROR)
-                return;
-
-            // FIX: Use tc->symbols
-            int defined = symbol_table_define(&tc->symbols, decl->name.lexeme, decl->name.length, initType);
-
-            // Add to symbol table
-            // If failed (and not global), report error. 
-            // Global redefinition is handled inside symbol_table_define returning 1.
-            if (!defined && tc->symbols.current_depth > 0) {
-                 char buf[256];
-                 snprintf(buf, sizeof(buf), "Variable '%.*s' already declared in this scope", decl->name.length, decl->name.lexeme);
-                 error(tc, buf);
-            }
-            break;
+            DataType initType = decl->init != NULL ? check_expression(tc, decl->init) : TYPE_VOID;
+            typecheck_declare(tc, decl, initType);
             break;
         }
 
         case NODE_PRINT_STMT: {
             AstNodePrintStmt* print = (AstNodePrintStmt*)stmt;
-            DataType type = check_expression(tc, print->expression);
-
-            if (type == TYPE_ERROR)
-                return;
-
-            if (type == TYPE_VOID)
-                error(tc, "Cannot print a void expression.");
-
+            typecheck_print(tc, check_expression(tc, print->expression));
             break;
         }
 
@@ -299,21 +733,18 @@ static void check_statement(TypeChecker* tc, AstNode* stmt) {
         // --- Block Scoping ---
         case NODE_BLOCK: {
             AstNodeBlock* block = (AstNodeBlock*)stmt;
-            symbol_table_enter_scope(&tc->symbols); // PUSH SCOPE
+            typecheck_enter_scope(tc); // PUSH SCOPE
             for (int i = 0; i < block->statement_count; i++) {
                 check_statement(tc, block->statements[i]);
             }
-            symbol_table_exit_scope(&tc->symbols);  // POP SCOPE
+            typecheck_exit_scope(tc);  // POP SCOPE
             break;
         }
 
         // --- Control Flow ---
         case NODE_IF: {
             AstNodeIf* n = (AstNodeIf*)stmt;
-            DataType condType = check_expression(tc, n->condition);
-            if (condType != TYPE_BOOL) {
-                error(tc, "If condition must be a boolean.");
-            }
+            typecheck_condition(tc, stmt, check_expression(tc, n->condition));
             check_statement(tc, n->thenBranch);
             if (n->elseBranch) check_statement(tc, n->elseBranch);
             break;
@@ -321,60 +752,111 @@ static void check_statement(TypeChecker* tc, AstNode* stmt) {
 
         case NODE_WHILE: {
             AstNodeWhile* n = (AstNodeWhile*)stmt;
-            DataType condType = check_expression(tc, n->condition);
-            if (condType != TYPE_BOOL) {
-                error(tc, "While condition must be a boolean.");
-            }
+            typecheck_condition(tc, stmt, check_expression(tc, n->condition));
             check_statement(tc, n->body);
             break;
         }
 
+        case NODE_FUNC_DECL: {
+            // Body is not checked yet; only the signature is recorded
+            AstNodeFuncDecl* n = (AstNodeFuncDecl*)stmt;
+            typechecker_declare_function(n->name.lexeme, n->name.length, n->returnType);
+            break;
+        }
+
         default:
             // Unknown or unsupported statement type
             break;
     }
 }
 
+
+// ===================
+// --- Entry Points ---
+// ===================
+
+TypeChecker* typecheck_begin(AstNode* root) {
+    if (!is_initialized) init_typechecker(); // Lazy init safety
+
+    TypeChecker* tc = &activeChecker;
+    tc->had_error = 0;
+
+    // Find names whose runtime type can't be trusted (repeat until stable,
+    // since unproven values propagate through assignments)
+    int changed;
+    do {
+        name_table_init(&provenReads);
+        changed = collect_unproven_names(root, 0);
+        name_table_free(&provenReads);
+    } while (changed);
+
+    // Copy global → local
+    tc->symbols = globalSymbols;
+    tc->unitStart = globalSymbols.count;
+    return tc;
+}
+
+/**
+ * @brief Close the block scopes a fused walk left open when a compile error
+ * stopped it.
+ */
+static void close_block_scopes(TypeChecker* tc) {
+    while (tc->symbols.current_depth > 0)
+        symbol_table_exit_scope(&tc->symbols);
+}
+
+void typecheck_statements(TypeChecker* tc, AstNode** statements, int count) {
+    close_block_scopes(tc);
+    for (int i = 0; i < count; i++)
+        check_statement(tc, statements[i]);
+}
+
+int typecheck_end(TypeChecker* tc) {
+    close_block_scopes(tc);
+
+    if (tc->had_error) {
+        // A rejected unit never runs: forget the globals it declared
+        symbol_table_truncate(&tc->symbols, tc->unitStart);
+    } else {
+        // Its globals stay declared for later units (REPL lines), so their
+        // names must outlive this AST. A unit stopped by a runtime error
+        // may leave a global unset or holding its old type, so later units
+        // treat them all as unproven (checked opcodes)
+        for (int i = tc->unitStart; i < tc->symbols.count; i++) {
+            Symbol* global = &tc->symbols.symbols[i];
+            mark_unproven_name(global->name, global->name_len);
+        }
+        symbol_table_adopt_names(&tc->symbols, tc->unitStart, &globalNames);
+    }
+
+    // Commit back to the persistent global table. Always, even after an
+    // error: the arrays (symbols, name index) may have been reallocated
+    globalSymbols = tc->symbols;
+    return !tc->had_error;
+}
+
 /**
  * @brief Entry point for the complete type-checking pass.
  *
  * Initializes a type-checking context, runs the recursive walker over the AST,
- * and validates all statements and expressions.
+ * and validates all statements and expressions. Checked expressions are
+ * annotated with their resolvedType for the compiler's specialized opcodes.
  *
  * @param root The root AST node (typically NODE_PROGRAM).
  * @return int 1 if type checking passed, 0 if any error occurred.
  */
 int typecheck_ast(AstNode* root) {
-    if (!is_initialized) init_typechecker(); // Lazy init safety
-
-    TypeChecker tc;
-    tc.had_error = 0;
-
-    // Copy global → local
-    tc.symbols = globalSymbols;
-
-    // Local scope (for this AST run)
-    // symbol_table_enter_scope(&tc.symbols);
-
-    // symbol_table_init(&globalSymbols);
+    TypeChecker* tc = typecheck_begin(root);
 
     // A program node represents a list of statements
     if (root->type == NODE_PROGRAM) {
         AstNodeProgram* prog = (AstNodeProgram*)root;
         for (int i = 0; i < prog->statement_count; i++)
-            check_statement(&tc, prog->statements[i]);
+            check_statement(tc, prog->statements[i]);
     } else {
         // For tests or single-node checking
-        check_statement(&tc, root);
+        check_statement(tc, root);
     }
 
-    // Pop temporary scope
-    symbol_table_exit_scope(&tc.symbols);
-
-    // If no error, commit back to persistent global table
-    if (!tc.had_error)
-        globalSymbols = tc.symbols;
-
-    // symbol_table_free(&globalSymbols);
-    return !tc.had_error;
+    return typecheck_end(tc);
 }
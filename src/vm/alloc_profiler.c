@@ -0,0 +1,311 @@
+/**
+ * @file alloc_profiler.c
+ * @brief Allocation profiler by type, opcode and source line (see alloc_profiler.h).
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "vm/alloc_profiler.h"
+#include "vm/vm.h"
+#include "vm/opcode.h"
+
+#define ALLOC_TOP_LINES 20
+
+static const char* kindNames[ALLOC_KINDS] = {
+    [OBJ_STRING] = "string",
+    [OBJ_ROPE] = "rope",
+    [OBJ_FUNCTION] = "function",
+    [OBJ_NATIVE] = "native",
+    [ALLOC_KIND_BLOCK] = "other blocks",
+};
+
+static void* grow_array(void* array, size_t elementSize, int* capacity) {
+    int newCapacity = *capacity < 16 ? 16 : *capacity * 2;
+    void* grown = realloc(array, elementSize * newCapacity);
+    if (grown == NULL) {
+        fprintf(stderr, "Fatal: Out of memory in the allocation profiler.\n");
+        exit(1);
+    }
+    *capacity = newCapacity;
+    return grown;
+}
+
+// --- Sites ---
+
+static uint32_t hash_site(const ObjFunction* function, int offset) {
+    uintptr_t key = (uintptr_t)function ^ ((uintptr_t)(offset + 1) * 2654435761u);
+    key ^= key >> 16;
+    return (uint32_t)key;
+}
+
+static void rehash_sites(AllocProfiler* profiler, int capacity) {
+    free(profiler->siteIndex);
+    profiler->siteIndex = (int*)malloc(sizeof(int) * capacity);
+    if (profiler->siteIndex == NULL) {
+        fprintf(stderr, "Fatal: Out of memory in the allocation profiler.\n");
+        exit(1);
+    }
+    memset(profiler->siteIndex, -1, sizeof(int) * capacity);
+    profiler->indexCapacity = capacity;
+
+    // Site 0 has no frame and is never looked up
+    for (int i = 1; i < profiler->siteCount; i++) {
+        const AllocSite* site = &profiler->sites[i];
+        uint32_t slot = hash_site(site->function, site->offset) & (capacity - 1);
+        while (profiler->siteIndex[slot] >= 0) slot = (slot + 1) & (capacity - 1);
+        profiler->siteIndex[slot] = i;
+    }
+}
+
+static AllocSite* add_site(AllocProfiler* profiler, ObjFunction* function, int offset) {
+    if (profiler->siteCount == profiler->siteCapacity) {
+        profiler->sites = (AllocSite*)grow_array(profiler->sites, sizeof(AllocSite), &profiler->siteCapacity);
+    }
+    AllocSite* site = &profiler->sites[profiler->siteCount++];
+    memset(site, 0, sizeof(*site));
+    site->function = function;
+    site->offset = offset;
+    return site;
+}
+
+/**
+ * @brief The site of the instruction the VM's top frame is running.
+ */
+static AllocSite* current_site(AllocProfiler* profiler, VM* vm) {
+    if (vm->frameCount == 0) return &profiler->sites[0];
+
+    CallFrame* frame = &vm->frames[vm->frameCount - 1];
+    ObjFunction* function = frame->function;
+    ptrdiff_t position = frame->ip - function->chunk.code - 1;
+    // Not yet started, or an ip into register code (regcode.h): the entry
+    int offset = position >= 0 && position < function->chunk.count ? (int)position : -1;
+
+    int mask = profiler->indexCapacity - 1;
+    uint32_t slot = hash_site(function, offset) & mask;
+    for (;;) {
+        int index = profiler->siteIndex[slot];
+        if (index < 0) break;
+        AllocSite* site = &profiler->sites[index];
+        if (site->function == function && site->offset == offset) return site;
+        slot = (slot + 1) & mask;
+    }
+
+    // Keep the table at most half full
+    if ((profiler->siteCount + 1) * 2 > profiler->indexCapacity) {
+        AllocSite* site = add_site(profiler, function, offset);
+        rehash_sites(profiler, profiler->indexCapacity * 2);
+        return site;
+    }
+    profiler->siteIndex[slot] = profiler->siteCount;
+    return add_site(profiler, function, offset);
+}
+
+// --- Tracer hooks ---
+
+static void record_allocation(void* user, VM* vm, ObjType type, size_t size) {
+    AllocProfiler* profiler = (AllocProfiler*)user;
+    AllocSite* site = current_site(profiler, vm);
+    site->objects++;
+    site->bytes += size;
+    profiler->kindObjects[type]++;
+    profiler->kindBytes[type] += size;
+}
+
+static void record_growth(void* user, VM* vm, size_t bytes) {
+    AllocProfiler* profiler = (AllocProfiler*)user;
+    current_site(profiler, vm)->bytes += bytes;
+    profiler->kindObjects[ALLOC_KIND_BLOCK]++;
+    profiler->kindBytes[ALLOC_KIND_BLOCK] += bytes;
+}
+
+static void record_pause(void* user, VM* vm) {
+    current_site((AllocProfiler*)user, vm)->pauses++;
+}
+
+AllocProfiler* new_alloc_profiler(void) {
+    AllocProfiler* profiler = (AllocProfiler*)calloc(1, sizeof(AllocProfiler));
+    if (profiler == NULL) {
+        fprintf(stderr, "Fatal: Out of memory in the allocation profiler.\n");
+        exit(1);
+    }
+    profiler->tracer.user = profiler;
+    profiler->tracer.allocate = record_allocation;
+    profiler->tracer.grow = record_growth;
+    profiler->tracer.gcBegin = record_pause;
+
+    add_site(profiler, NULL, -1);
+    rehash_sites(profiler, 64);
+    return profiler;
+}
+
+void free_alloc_profiler(AllocProfiler* profiler) {
+    if (profiler == NULL) return;
+    free(profiler->sites);
+    free(profiler->siteIndex);
+    free(profiler);
+}
+
+// --- Reporting ---
+
+typedef struct {
+    int key;
+    uint64_t weight;
+} Ranked;
+
+static int compare_ranked(const void* a, const void* b) {
+    const Ranked* x = (const Ranked*)a;
+    const Ranked* y = (const Ranked*)b;
+    if (x->weight != y->weight) return x->weight < y->weight ? 1 : -1;
+    return x->key - y->key;
+}
+
+static double percent(uint64_t part, uint64_t total) {
+    return total > 0 ? 100.0 * (double)part / (double)total : 0.0;
+}
+
+/**
+ * @brief The opcode of the instruction holding `site`'s offset (-1 when
+ * there is none: site 0 and frame entries).
+ */
+static int site_opcode(const AllocSite* site) {
+    if (site->function == NULL || site->offset < 0) return -1;
+
+    const Chunk* chunk = &site->function->chunk;
+    int offset = 0;
+    while (offset < chunk->count) {
+        int next = offset + opcode_length(chunk->code[offset]);
+        if (site->offset < next) return chunk->code[offset];
+        offset = next;
+    }
+    return -1;
+}
+
+/**
+ * @brief Totals of one report row.
+ */
+typedef struct {
+    uint64_t objects;
+    uint64_t bytes;
+    uint64_t pauses;
+} AllocTotals;
+
+static void add_totals(AllocTotals* totals, const AllocSite* site) {
+    totals->objects += site->objects;
+    totals->bytes += site->bytes;
+    totals->pauses += site->pauses;
+}
+
+static void report_opcodes(const AllocProfiler* profiler, FILE* out, uint64_t totalBytes) {
+    // Row UINT8_COUNT: no instruction (outside frames, frame entry)
+    AllocTotals* ops = (AllocTotals*)calloc(UINT8_COUNT + 1, sizeof(AllocTotals));
+    if (ops == NULL) return;
+    for (int i = 0; i < profiler->siteCount; i++) {
+        int op = site_opcode(&profiler->sites[i]);
+        add_totals(&ops[op >= 0 ? op : UINT8_COUNT], &profiler->sites[i]);
+    }
+
+    Ranked ranked[UINT8_COUNT + 1];
+    int count = 0;
+    for (int op = 0; op <= UINT8_COUNT; op++) {
+        if (ops[op].bytes > 0 || ops[op].pauses > 0) ranked[count++] = (Ranked){op, ops[op].bytes};
+    }
+    qsort(ranked, count, sizeof(Ranked), compare_ranked);
+
+    fprintf(out, "\n  %-32s %14s %16s %7s %10s\n", "opcode", "objects", "bytes", "share", "gc pauses");
+    for (int i = 0; i < count; i++) {
+        int op = ranked[i].key;
+        fprintf(out, "  %-32s %14llu %16llu %6.2f%% %10llu\n",
+                op < UINT8_COUNT ? opcode_name((uint8_t)op) : "(no instruction)",
+                (unsigned long long)ops[op].objects, (unsigned long long)ops[op].bytes,
+                percent(ops[op].bytes, totalBytes), (unsigned long long)ops[op].pauses);
+    }
+    free(ops);
+}
+
+static int site_line(const AllocSite* site) {
+    if (site->function == NULL) return 0;
+    return get_line(&site->function->chunk, site->offset >= 0 ? site->offset : 0);
+}
+
+static void site_label(const AllocSite* site, char* label, size_t size) {
+    if (site->function == NULL) {
+        snprintf(label, size, "(outside frames)");
+        return;
+    }
+    const char* name = site->function->name != NULL ? site->function->name->chars : "<script>";
+    snprintf(label, size, "%s:%d", name, site_line(site));
+}
+
+static void report_lines(const AllocProfiler* profiler, FILE* out, uint64_t totalBytes) {
+    int count = profiler->siteCount;
+    AllocTotals* lines = (AllocTotals*)calloc(count, sizeof(AllocTotals));
+    int* line = (int*)malloc(sizeof(int) * count);
+    Ranked* ranked = (Ranked*)malloc(sizeof(Ranked) * count);
+    if (lines == NULL || line == NULL || ranked == NULL) {
+        free(lines);
+        free(line);
+        free(ranked);
+        return;
+    }
+
+    // The sites of one line of one function add up in the row of the first
+    int rows = 0;
+    for (int i = 0; i < count; i++) {
+        const AllocSite* site = &profiler->sites[i];
+        line[i] = site_line(site);
+        int first = i;
+        for (int r = 0; r < rows; r++) {
+            int j = ranked[r].key;
+            if (profiler->sites[j].function == site->function && line[j] == line[i]) {
+                first = j;
+                break;
+            }
+        }
+        if (first == i) ranked[rows++] = (Ranked){i, 0};
+        add_totals(&lines[first], site);
+    }
+    for (int r = 0; r < rows; r++) ranked[r].weight = lines[ranked[r].key].bytes;
+    qsort(ranked, rows, sizeof(Ranked), compare_ranked);
+
+    char label[96];
+    fprintf(out, "\n  %-32s %14s %16s %7s %10s\n", "line", "objects", "bytes", "share", "gc pauses");
+    for (int r = 0, shown = 0; r < rows && shown < ALLOC_TOP_LINES; r++) {
+        int site = ranked[r].key;
+        if (lines[site].bytes == 0 && lines[site].pauses == 0) continue;
+        site_label(&profiler->sites[site], label, sizeof(label));
+        fprintf(out, "  %-32s %14llu %16llu %6.2f%% %10llu\n", label,
+                (unsigned long long)lines[site].objects, (unsigned long long)lines[site].bytes,
+                percent(lines[site].bytes, totalBytes), (unsigned long long)lines[site].pauses);
+        shown++;
+    }
+
+    free(ranked);
+    free(line);
+    free(lines);
+}
+
+void alloc_profiler_report(const AllocProfiler* profiler, FILE* out) {
+    uint64_t objects = 0;
+    uint64_t bytes = 0;
+    uint64_t pauses = 0;
+    for (int kind = 0; kind < ALLOC_KINDS; kind++) {
+        if (kind != ALLOC_KIND_BLOCK) objects += profiler->kindObjects[kind];
+        bytes += profiler->kindBytes[kind];
+    }
+    for (int i = 0; i < profiler->siteCount; i++) pauses += profiler->sites[i].pauses;
+
+    fprintf(out, "\nAllocation profile: %llu objects, %llu bytes, %llu gc pauses\n",
+            (unsigned long long)objects, (unsigned long long)bytes, (unsigned long long)pauses);
+
+    fprintf(out, "\n  %-32s %14s %16s %7s\n", "type", "count", "bytes", "share");
+    for (int kind = 0; kind < ALLOC_KINDS; kind++) {
+        if (profiler->kindObjects[kind] == 0) continue;
+        fprintf(out, "  %-32s %14llu %16llu %6.2f%%\n", kindNames[kind],
+                (unsigned long long)profiler->kindObjects[kind], (unsigned long long)profiler->kindBytes[kind],
+                percent(profiler->kindBytes[kind], bytes));
+    }
+
+    report_opcodes(profiler, out, bytes);
+    report_lines(profiler, out, bytes);
+}
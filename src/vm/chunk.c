@@ -7,7 +7,9 @@
 #include <stdio.h>
 
 #include "vm/chunk.h"
+#include "vm/opcode.h"
 #include "vm/memory.h"
+#include "vm/vm.h"
 
 // moved to memory.h/c ->
 // // --- Memory Management Helper ---
@@ -68,13 +70,18 @@ void init_chunk(Chunk* chunk) {
     chunk->capacity = 0;
     chunk->code = NULL;
     chunk->lines = NULL;
+    chunk->lineCount = 0;
+    chunk->lineCapacity = 0;
     init_value_array(&chunk->constants);
+    chunk->constantIndex = NULL;
+    chunk->constantIndexCapacity = 0;
 }
 
 void free_chunk(Chunk* chunk) {
     FREE_ARRAY(uint8_t, chunk->code, chunk->capacity);
-    FREE_ARRAY(int, chunk->lines, chunk->capacity);
+    FREE_ARRAY(LineStart, chunk->lines, chunk->lineCapacity);
     free_value_array(&chunk->constants);
+    FREE_ARRAY(int, chunk->constantIndex, chunk->constantIndexCapacity);
     init_chunk(chunk);
 }
 
@@ -83,16 +90,251 @@ void write_chunk(Chunk* chunk, uint8_t byte, int line) {
         int oldCapacity = chunk->capacity;
         chunk->capacity = GROW_CAPACITY(oldCapacity);
         chunk->code = GROW_ARRAY(uint8_t, chunk->code, oldCapacity, chunk->capacity);
-        chunk->lines = GROW_ARRAY(int, chunk->lines, oldCapacity, chunk->capacity);
     }
 
     chunk->code[chunk->count] = byte;
-    chunk->lines[chunk->count] = line;
+    add_line(chunk, chunk->count, line);
     chunk->count++;
 }
 
-int add_constant(Chunk* chunk, Value value) {
+void add_line(Chunk* chunk, int offset, int line) {
+    if (chunk->lineCount > 0 && chunk->lines[chunk->lineCount - 1].line == line) return;
+
+    if (chunk->lineCapacity < chunk->lineCount + 1) {
+        int oldCapacity = chunk->lineCapacity;
+        chunk->lineCapacity = GROW_CAPACITY(oldCapacity);
+        chunk->lines = GROW_ARRAY(LineStart, chunk->lines, oldCapacity, chunk->lineCapacity);
+    }
+    chunk->lines[chunk->lineCount++] = (LineStart){offset, line};
+}
+
+int get_line(const Chunk* chunk, int offset) {
+    // Last run starting at or before `offset`
+    int low = 0;
+    int high = chunk->lineCount - 1;
+    int line = 0;
+    while (low <= high) {
+        int mid = low + (high - low) / 2;
+        if (chunk->lines[mid].offset <= offset) {
+            line = chunk->lines[mid].line;
+            low = mid + 1;
+        } else {
+            high = mid - 1;
+        }
+    }
+    return line;
+}
+
+int chunk_stack_depth(const Chunk* chunk, int entryDepth) {
+    // Depth on entry to each forward jump target (-1: none seen yet)
+    int* depthAt = (int*)malloc(sizeof(int) * (chunk->count + 1));
+    if (depthAt == NULL) return entryDepth + chunk->count + 1; // Every instruction pushes at most one
+    for (int i = 0; i <= chunk->count; i++) depthAt[i] = -1;
+
+    int depth = entryDepth;
+    int max = entryDepth;
+    bool reachable = true;
+
+    for (int offset = 0; offset < chunk->count; offset += opcode_length(chunk->code[offset])) {
+        const uint8_t* code = chunk->code + offset;
+        int next = offset + opcode_length(code[0]);
+        if (depthAt[offset] >= 0) {
+            depth = depthAt[offset];
+            reachable = true;
+        }
+        if (!reachable) continue;
+
+        int jump = -1; // Forward jump target
+        switch (code[0]) {
+            case OP_CONSTANT:
+            case OP_CONSTANT_LONG:
+            case OP_TRUE:
+            case OP_FALSE:
+            case OP_GET_GLOBAL:
+            case OP_GET_GLOBAL_LONG:
+            case OP_GET_LOCAL:
+            case OP_GET_LOCAL_LONG:
+            case OP_ADD_LOCALS:
+            case OP_ADD_LOCAL_CONST:
+                depth++;
+                break;
+
+            case OP_ADD:
+            case OP_SUBTRACT:
+            case OP_MULTIPLY:
+            case OP_DIVIDE:
+            case OP_MODULO:
+            case OP_EQUAL:
+            case OP_GREATER:
+            case OP_LESS:
+            case OP_ADD_INT:
+            case OP_SUBTRACT_INT:
+            case OP_MULTIPLY_INT:
+            case OP_DIVIDE_INT:
+            case OP_MODULO_INT:
+            case OP_CONCAT:
+            case OP_EQUAL_INT:
+            case OP_GREATER_INT:
+            case OP_LESS_INT:
+            case OP_NOT_EQUAL:
+            case OP_GREATER_EQUAL:
+            case OP_LESS_EQUAL:
+            case OP_NOT_EQUAL_INT:
+            case OP_GREATER_EQUAL_INT:
+            case OP_LESS_EQUAL_INT:
+            case OP_POP:
+            case OP_PRINT:
+                depth--;
+                break;
+
+            case OP_POPN:
+                depth -= code[1];
+                break;
+
+            case OP_JUMP_IF_FALSE:
+                jump = next + ((code[1] << 8) | code[2]);
+                break;
+
+            case OP_JUMP_IF_FALSE_POP:
+                depth--;
+                jump = next + ((code[1] << 8) | code[2]);
+                break;
+
+            case OP_JUMP_IF_NOT_LESS:
+            case OP_JUMP_IF_NOT_LESS_EQUAL:
+            case OP_JUMP_IF_NOT_GREATER:
+            case OP_JUMP_IF_NOT_GREATER_EQUAL:
+                depth -= 2;
+                jump = next + ((code[1] << 8) | code[2]);
+                break;
+
+            case OP_JUMP:
+                jump = next + ((code[1] << 8) | code[2]);
+                reachable = false;
+                break;
+
+            case OP_CALL:
+                depth -= code[1];
+                break;
+
+            case OP_CALL_DIRECT:
+            case OP_CALL_DIRECT_0:
+            case OP_CALL_DIRECT_1:
+            case OP_CALL_DIRECT_2:
+            case OP_CALL_DIRECT_3:
+                // The callee slot is opened above the arguments' base
+                if (depth + 1 > max) max = depth + 1;
+                depth -= direct_call_args(code) - 1;
+                break;
+
+            case OP_TAIL_CALL_DIRECT:
+                if (depth + 1 > max) max = depth + 1;
+                reachable = false;
+                break;
+
+            case OP_LOOP:
+            case OP_TAIL_CALL:
+            case OP_RETURN:
+            case OP_MEMO_RETURN:
+                reachable = false;
+                break;
+
+            default:
+                break; // No net effect
+        }
+
+        if (depth > max) max = depth;
+        if (jump >= 0 && jump <= chunk->count && depthAt[jump] < 0) depthAt[jump] = depth;
+    }
+
+    free(depthAt);
+    return max;
+}
+
+// --- Constant pool ---
+
+// Pools up to this size are scanned; the hash index is built past it
+#define CONSTANT_SCAN_MAX 8
+
+/**
+ * @brief Whether two constants are the same: equal ints or bools, or the
+ * same object (no string comparison, see add_constant()).
+ */
+static bool same_constant(Value a, Value b) {
+    if (VALUE_TYPE(a) != VALUE_TYPE(b)) return false;
+    if (IS_INT(a)) return AS_INT(a) == AS_INT(b);
+    if (IS_BOOL(a)) return AS_BOOL(a) == AS_BOOL(b);
+    return AS_OBJ(a) == AS_OBJ(b);
+}
+
+static uint32_t hash_constant(Value value) {
+    uint64_t key = IS_OBJ(value) ? (uint64_t)(uintptr_t)AS_OBJ(value)
+                 : IS_INT(value) ? ((uint64_t)(uint32_t)AS_INT(value) << 2) | 1
+                 : ((uint64_t)AS_BOOL(value) << 2) | 2;
+    key *= 0x9E3779B97F4A7C15ULL;
+    return (uint32_t)(key >> 32);
+}
+
+/**
+ * @brief The index slot of `value`: where it is, or the empty slot it goes in.
+ */
+static int* constant_slot(const Chunk* chunk, Value value) {
+    int mask = chunk->constantIndexCapacity - 1;
+    uint32_t slot = hash_constant(value) & mask;
+    for (;;) {
+        int* entry = &chunk->constantIndex[slot];
+        if (*entry < 0 || same_constant(chunk->constants.values[*entry], value)) return entry;
+        slot = (slot + 1) & mask;
+    }
+}
+
+/**
+ * @brief Rebuild the index with room for `capacity` slots (a power of two),
+ * keeping the first index of any constant the pool holds twice.
+ */
+static void rebuild_constant_index(Chunk* chunk, int capacity) {
+    FREE_ARRAY(int, chunk->constantIndex, chunk->constantIndexCapacity);
+    chunk->constantIndex = GROW_ARRAY(int, NULL, 0, capacity);
+    chunk->constantIndexCapacity = capacity;
+    for (int i = 0; i < capacity; i++) chunk->constantIndex[i] = -1;
+
+    for (int i = 0; i < chunk->constants.count; i++) {
+        int* entry = constant_slot(chunk, chunk->constants.values[i]);
+        if (*entry < 0) *entry = i;
+    }
+}
+
+/**
+ * @brief Index of `value` in the pool, or -1.
+ */
+static int find_constant(const Chunk* chunk, Value value) {
+    if (chunk->constantIndex == NULL) {
+        for (int i = 0; i < chunk->constants.count; i++) {
+            if (same_constant(chunk->constants.values[i], value)) return i;
+        }
+        return -1;
+    }
+    return *constant_slot(chunk, value);
+}
+
+int append_constant(Chunk* chunk, Value value) {
     write_value_array(&chunk->constants, value);
-    // Return the index of the constant we just added
-    return chunk->constants.count - 1;
-}
\ No newline at end of file
+    // The function owning the chunk may already be marked
+    vm_write_barrier(currentVM, value);
+    int index = chunk->constants.count - 1;
+
+    // Keep the index at most half full
+    if (chunk->constantIndex != NULL && chunk->constants.count * 2 <= chunk->constantIndexCapacity) {
+        int* entry = constant_slot(chunk, value);
+        if (*entry < 0) *entry = index;
+    } else if (chunk->constants.count > CONSTANT_SCAN_MAX) {
+        int capacity = chunk->constantIndexCapacity > 0 ? chunk->constantIndexCapacity * 2 : 4 * CONSTANT_SCAN_MAX;
+        rebuild_constant_index(chunk, capacity);
+    }
+    return index;
+}
+
+int add_constant(Chunk* chunk, Value value) {
+    int index = find_constant(chunk, value);
+    return index >= 0 ? index : append_constant(chunk, value);
+}
@@ -19,9 +19,13 @@
 #include "vm/opcode.h"
 #include "vm/object.h" // Need object API
 #include "vm/memory.h" // Needed for mark_value
+#include "vm/peephole.h"
+#include "vm/vm.h"     // GLOBALS_MAX
 #include "ast.h"
 #include "token.h"
 #include "parser.h"
+#include "name_table.h"
+#include "typechecker.h"
 
 
 // This exists ONLY during compilation to map "x" -> 0.
@@ -29,37 +33,55 @@ typedef struct {
     char* name;
     int length;
     int index;
+    ObjFunction* function; // Latest func compiled into this slot by the current unit (or NULL)
 } CompilerSymbol;
 
-// Simple linear symbol table for globals
-static CompilerSymbol globalSymbols[256];
-static int globalCount;
+// Symbol table for globals, hashed by name (grows up to GLOBALS_MAX)
+static DETERMA_THREAD_LOCAL CompilerSymbol* globalSymbols;
+static DETERMA_THREAD_LOCAL int globalCount;
+static DETERMA_THREAD_LOCAL int globalCapacity;
+static DETERMA_THREAD_LOCAL NameTable globalIndex; // name -> index into globalSymbols
 
 // --- Local Variable Struct ---
 typedef struct {
     Token name;
     int depth; // 0 = global, 1 = block, etc.
+    int shadowed; // Index of the same-named local this one hides (-1 if none)
+    int slot;     // Frame slot, or -1: nothing reads it, so it has none (see unread_locals())
 } Local;
 
 // State for the compiler
-typedef struct {
+typedef struct Compiler {
     // Chunk* chunk; // removed as its a part of function now
+    struct Compiler* enclosing; // Compiler of the surrounding function (NULL for the script)
     ObjFunction* function;
+    Value pending;              // Constant being added to the pool (rooted while it grows)
     int hadError;
 
-    // Local tracking
-    Local locals[256];
+    // Local tracking (grows up to LOCALS_MAX)
+    Local* locals;
     int localCount;
+    int localCapacity;
+    int slotCount;        // Frame slots held by the locals in scope (those that have one)
     int scopeDepth;
+    NameTable localIndex; // name -> index of its innermost local
+    bool unreadLocal;     // The declaration about to be compiled is never read
+
+    TypeChecker* checker; // Checks each node as it is compiled (script level of compile_checked_ast only)
 } Compiler;
 
 
+// Slots are addressed with at most a 2-byte operand
+#define LOCALS_MAX UINT16_COUNT
+
 // --- Active Compiler Tracking for GC ---
 // required so that the gc can find the constants inside the chunk currently being compiled
-static Compiler* current = NULL;
+static DETERMA_THREAD_LOCAL Compiler* current = NULL;
 
 // --- Forward declarations ---
 static void compile_function_decl(Compiler* compiler, AstNodeFuncDecl* fn);
+static void compile_call(Compiler* compiler, AstNodeCall* n, bool tail);
+static DataType compile_expression(Compiler* compiler, AstNode* expr);
 
 
 
@@ -73,17 +95,16 @@ static Chunk* current_chunk() {
 }
 
 /**
- * @brief Function to mark all constants in the chunk currently being compiled
- * Prevents the GC from deleting strings just created but not compiled yet
+ * @brief Function to mark the functions (and so their constants) being compiled
+ * Prevents the GC from deleting strings just created but not compiled yet, and
+ * the functions of every enclosing compiler
  * 
  * @return void
  */
 void mark_compiler_roots() {
-    if (current == NULL) return;
-    
-    Chunk* chunk = current_chunk();
-    for (int i = 0; i < chunk->constants.count; i++) {
-        mark_value(chunk->constants.values[i]);
+    for (Compiler* compiler = current; compiler != NULL; compiler = compiler->enclosing) {
+        mark_object((Obj*)compiler->function);
+        mark_value(compiler->pending);
     }
 }
 
@@ -119,12 +140,39 @@ static void emit_bytes(Compiler* compiler, uint8_t byte1, uint8_t byte2, int lin
     emit_byte(compiler, byte2, line);
 }
 
+/**
+ * @brief Emits an instruction that takes an index operand.
+ *
+ * Indexes that fit in a byte use the 1-byte form (`shortOp`); larger ones use
+ * the wide form (`longOp`) with a 2-byte big-endian operand.
+ */
+static void emit_indexed(Compiler* compiler, uint8_t shortOp, uint8_t longOp, int index, int line) {
+    if (index <= UINT8_MAX) {
+        emit_bytes(compiler, shortOp, (uint8_t)index, line);
+    } else {
+        emit_byte(compiler, longOp, line);
+        emit_bytes(compiler, (index >> 8) & 0xff, index & 0xff, line);
+    }
+}
+
+/**
+ * @brief Adds `value` to the compiler's constant pool (or finds it there).
+ * Growing the pool may collect, and a fresh string or function is not
+ * reachable from anywhere else yet, so it is rooted in `pending` meanwhile.
+ */
+static int make_constant(Compiler* compiler, Value value) {
+    compiler->pending = value;
+    int index = add_constant(&compiler->function->chunk, value);
+    compiler->pending = BOOL_VAL(false);
+    return index;
+}
+
 /**
  * @brief Emits an OpCode followed by a constant index.
  */
 static void emit_constant(Compiler* compiler, Value value, int line) {
     // 1. Add the actual value to the constant pool
-    int constantIndex = add_constant(current_chunk(), value);
+    int constantIndex = make_constant(compiler, value);
 
     if (constantIndex < 0) {
         fprintf(stderr, "Compiler Error: failed to add constant (index < 0)\n");
@@ -132,16 +180,14 @@ static void emit_constant(Compiler* compiler, Value value, int line) {
         return;
     }
 
-    if (constantIndex > 0xFF) {
-        fprintf(stderr, "Compiler Error: too many constants (>=256). Add wide-constant support.\n");
+    if (constantIndex > UINT16_MAX) {
+        fprintf(stderr, "Compiler Error: too many constants in one chunk (max %d).\n", UINT16_COUNT);
         compiler->hadError = 1;
         return;
     }
     
     // 2. Emit the instruction and the operand (index)
-    emit_byte(compiler, OP_CONSTANT, line);
-    // Note: We currently assume the constant index fits in a single byte (max 256 constants)
-    emit_byte(compiler, (uint8_t)constantIndex, line); 
+    emit_indexed(compiler, OP_CONSTANT, OP_CONSTANT_LONG, constantIndex, line);
 }
 
 
@@ -200,33 +246,42 @@ static void emit_loop(Compiler* compiler, int loopStart, int line) {
 
 /**
  * @brief Emits an arithmetic opcode based on the token type.
+ *
+ * When the typechecker proved both operands to be of the same type
+ * (operandType), the unchecked specialized opcode is emitted instead.
+ * TYPE_ERROR means "unproven" and always selects the checked opcode.
  */
-static void emit_binary_op(Compiler* compiler, TokenType opType, int line) {
+static void emit_binary_op(Compiler* compiler, TokenType opType, DataType operandType, int line) {
+    int ints = (operandType == TYPE_INT);
+
     switch (opType) {
         // --- Arithmetic Operations ---
-        case TOKEN_PLUS:  emit_byte(compiler, OP_ADD, line); break;
-        case TOKEN_MINUS: emit_byte(compiler, OP_SUBTRACT, line); break;
-        case TOKEN_STAR:  emit_byte(compiler, OP_MULTIPLY, line); break;
-        case TOKEN_SLASH: emit_byte(compiler, OP_DIVIDE, line); break;
+        case TOKEN_PLUS:
+            if (operandType == TYPE_STRING) emit_byte(compiler, OP_CONCAT, line);
+            else emit_byte(compiler, ints ? OP_ADD_INT : OP_ADD, line);
+            break;
+        case TOKEN_MINUS: emit_byte(compiler, ints ? OP_SUBTRACT_INT : OP_SUBTRACT, line); break;
+        case TOKEN_STAR:  emit_byte(compiler, ints ? OP_MULTIPLY_INT : OP_MULTIPLY, line); break;
+        case TOKEN_SLASH: emit_byte(compiler, ints ? OP_DIVIDE_INT : OP_DIVIDE, line); break;
 
-        case TOKEN_PERCENT: emit_byte(compiler, OP_MODULO, line); break;
+        case TOKEN_PERCENT: emit_byte(compiler, ints ? OP_MODULO_INT : OP_MODULO, line); break;
 
         // --- Comparisons ---
-        case TOKEN_EQUAL_EQUAL:   emit_byte(compiler, OP_EQUAL, line); break;
-        case TOKEN_GREATER:       emit_byte(compiler, OP_GREATER, line); break;
-        case TOKEN_LESS:          emit_byte(compiler, OP_LESS, line); break;
+        case TOKEN_EQUAL_EQUAL:   emit_byte(compiler, ints ? OP_EQUAL_INT : OP_EQUAL, line); break;
+        case TOKEN_GREATER:       emit_byte(compiler, ints ? OP_GREATER_INT : OP_GREATER, line); break;
+        case TOKEN_LESS:          emit_byte(compiler, ints ? OP_LESS_INT : OP_LESS, line); break;
 
         // Composite Ops (Syntactic Sugar in Bytecode)
         case TOKEN_BANG_EQUAL:    
-            emit_byte(compiler, OP_EQUAL, line); 
+            emit_byte(compiler, ints ? OP_EQUAL_INT : OP_EQUAL, line); 
             emit_byte(compiler, OP_NOT, line);   
             break;
         case TOKEN_GREATER_EQUAL: 
-            emit_byte(compiler, OP_LESS, line);    // !(a < b)
+            emit_byte(compiler, ints ? OP_LESS_INT : OP_LESS, line);    // !(a < b)
             emit_byte(compiler, OP_NOT, line);
             break;
         case TOKEN_LESS_EQUAL:    
-            emit_byte(compiler, OP_GREATER, line); // !(a > b)
+            emit_byte(compiler, ints ? OP_GREATER_INT : OP_GREATER, line); // !(a > b)
             emit_byte(compiler, OP_NOT, line);
             break;
 
@@ -261,58 +316,186 @@ static void begin_scope(Compiler* compiler) {
 static void end_scope(Compiler* compiler, int line) {
     compiler->scopeDepth--;
 
-    // Pop locals that were in this scope
+    // Pop locals that were in this scope (the peephole pass turns the run
+    // into one OP_POPN); the slots go to the next sibling scope
     while (compiler->localCount > 0 && 
            compiler->locals[compiler->localCount - 1].depth > compiler->scopeDepth) {
-        emit_byte(compiler, OP_POP, line);
-        compiler->localCount--;
+        Local* local = &compiler->locals[--compiler->localCount];
+        if (local->slot >= 0) {
+            emit_byte(compiler, OP_POP, line);
+            compiler->slotCount--;
+        }
+
+        // Let the name resolve to whatever this local was shadowing
+        if (local->shadowed >= 0) {
+            Token outer = compiler->locals[local->shadowed].name;
+            name_table_set(&compiler->localIndex, outer.lexeme, outer.length, local->shadowed);
+        } else {
+            name_table_delete(&compiler->localIndex, local->name.lexeme, local->name.length);
+        }
     }
 }
 
+/**
+ * @brief Make room for one more local slot, growing the locals array.
+ *
+ * @return false (and flags the error) past LOCALS_MAX or when out of memory.
+ */
+static bool reserve_local(Compiler* compiler) {
+    if (compiler->localCount >= LOCALS_MAX) {
+        fprintf(stderr, "Too many local variables in function.\n");
+        compiler->hadError = 1;
+        return false;
+    }
+
+    if (compiler->localCount == compiler->localCapacity) {
+        int capacity = compiler->localCapacity < 8 ? 8 : compiler->localCapacity * 2;
+        Local* locals = (Local*)realloc(compiler->locals, sizeof(Local) * capacity);
+        if (locals == NULL) {
+            fprintf(stderr, "Out of memory while adding local variable.\n");
+            compiler->hadError = 1;
+            return false;
+        }
+        compiler->locals = locals;
+        compiler->localCapacity = capacity;
+    }
+    return true;
+}
+
 /**
  * @brief Function to add variable to local scope.
- * Capped out at 256 for now
+ * Capped out at LOCALS_MAX (the widest slot operand)
  * 
  * @param compiler 
  * @param name 
+ * @param hasSlot It takes the next frame slot (false: it is never read, so
+ *                its value is not kept)
  * @return int 
  */
-static int add_local(Compiler* compiler, Token name) {
-    if (compiler->localCount >= 256) {
-        fprintf(stderr, "Too many local variables in function.\n");
-        return -1;
-    }
+static int add_local(Compiler* compiler, Token name, bool hasSlot) {
+    if (!reserve_local(compiler)) return -1;
 
     Local* local = &compiler->locals[compiler->localCount];
     local->name = name;
     local->depth = compiler->scopeDepth;
+    local->shadowed = name_table_get(&compiler->localIndex, name.lexeme, name.length);
+    local->slot = hasSlot ? compiler->slotCount++ : -1;
+    name_table_set(&compiler->localIndex, name.lexeme, name.length, compiler->localCount);
     compiler->localCount++;
     return compiler->localCount - 1;
 }
 
 /**
  * @brief Function to resolve local variables. 
- * Walks backward down the locals array under the compiler struct
+ * Looks the name up in the compiler's local index (innermost binding wins)
  * 
  * @param compiler 
  * @param name 
- * @return int 
+ * @return int The local's index in `locals` (-1 if it is not a local)
  */
 static int resolve_local(Compiler* compiler, Token name) {
-    // Walk backwards (shadowing)
-    for (int i = compiler->localCount - 1; i >= 0; i--) {
-        Local* local = &compiler->locals[i];
-        if (name.length == local->name.length &&
-            strncmp(name.lexeme, local->name.lexeme, name.length) == 0) {
-            return i;
+    return name_table_get(&compiler->localIndex, name.lexeme, name.length);
+}
+
+// --- Unread locals ---
+
+/**
+ * @brief Add every name `node` reads (accesses and callees) to `names`,
+ * whichever variable it resolves to: a shadowing local or a nested
+ * function's use of the name keeps an outer local alive too.
+ */
+static void collect_reads(const AstNode* node, NameTable* names) {
+    if (node == NULL) return;
+
+    switch (node->type) {
+        case NODE_VAR_ACCESS: {
+            Token name = ((const AstNodeVarAccess*)node)->name;
+            name_table_set(names, name.lexeme, name.length, 1);
+            break;
+        }
+        case NODE_VAR_ASSIGN:
+            collect_reads(((const AstNodeVarAssign*)node)->expression, names); // The target is written
+            break;
+        case NODE_VAR_DECL:
+            collect_reads(((const AstNodeVarDecl*)node)->init, names);
+            break;
+        case NODE_UNARY_OP:
+            collect_reads(((const AstNodeUnaryOp*)node)->operand, names);
+            break;
+        case NODE_BINARY_OP:
+            collect_reads(((const AstNodeBinaryOp*)node)->left, names);
+            collect_reads(((const AstNodeBinaryOp*)node)->right, names);
+            break;
+        case NODE_CALL: {
+            const AstNodeCall* n = (const AstNodeCall*)node;
+            name_table_set(names, n->callee.lexeme, n->callee.length, 1);
+            for (int i = 0; i < n->arg_count; i++) collect_reads(n->args[i], names);
+            break;
+        }
+        case NODE_PRINT_STMT:
+            collect_reads(((const AstNodePrintStmt*)node)->expression, names);
+            break;
+        case NODE_EXPR_STMT:
+            collect_reads(((const AstNodeExprStmt*)node)->expression, names);
+            break;
+        case NODE_RETURN:
+            collect_reads(((const AstNodeReturn*)node)->value, names);
+            break;
+        case NODE_IF: {
+            const AstNodeIf* n = (const AstNodeIf*)node;
+            collect_reads(n->condition, names);
+            collect_reads(n->thenBranch, names);
+            collect_reads(n->elseBranch, names);
+            break;
         }
+        case NODE_WHILE:
+            collect_reads(((const AstNodeWhile*)node)->condition, names);
+            collect_reads(((const AstNodeWhile*)node)->body, names);
+            break;
+        case NODE_BLOCK: {
+            const AstNodeBlock* n = (const AstNodeBlock*)node;
+            for (int i = 0; i < n->statement_count; i++) collect_reads(n->statements[i], names);
+            break;
+        }
+        case NODE_FUNC_DECL:
+            collect_reads(((const AstNodeFuncDecl*)node)->body, names);
+            break;
+        default:
+            break; // Literals
     }
-    return -1;
+}
+
+/**
+ * @brief For each statement of `block`: whether it declares a local that
+ * no later statement of the block reads. Such a local gets no slot, its
+ * initializer's value is popped at once and stores into it keep only the
+ * value (a declaration's own initializer reads the outer binding, so the
+ * block is scanned from the end).
+ *
+ * @return A flag per statement (free() it), or NULL: keep every local.
+ */
+static bool* unread_locals(const AstNodeBlock* block) {
+    if (block->statement_count == 0) return NULL;
+    bool* unread = (bool*)calloc((size_t)block->statement_count, sizeof(bool));
+    if (unread == NULL) return NULL;
+
+    NameTable reads;
+    name_table_init(&reads);
+    for (int i = block->statement_count - 1; i >= 0; i--) {
+        const AstNode* statement = block->statements[i];
+        if (statement != NULL && statement->type == NODE_VAR_DECL) {
+            Token name = ((const AstNodeVarDecl*)statement)->name;
+            unread[i] = name_table_get(&reads, name.lexeme, name.length) < 0;
+        }
+        collect_reads(statement, &reads);
+    }
+    name_table_free(&reads);
+    return unread;
 }
 
 /**
  * @brief Function to resolve global variables. 
- * Walks down the globalSymbols array 
+ * Looks the name up in the global index
  * 
  * @param compiler 
  * @param name 
@@ -320,15 +503,8 @@ static int resolve_local(Compiler* compiler, Token name) {
  */
 static int resolve_global(Compiler* compiler, Token name) {
     (void)compiler;
-    for (int i = 0; i < globalCount; i++) {
-        CompilerSymbol* existing = &globalSymbols[i];
-        // String comparison
-        if (existing->length == name.length && 
-            strncmp(existing->name, name.lexeme, name.length) == 0) {
-            return globalSymbols[i].index;
-        }
-    }
-    return -1;
+    int i = name_table_get(&globalIndex, name.lexeme, name.length);
+    return i >= 0 ? globalSymbols[i].index : -1;
 }
 
 
@@ -340,14 +516,30 @@ static int resolve_global(Compiler* compiler, Token name) {
  * @return int 
  */
 static int define_global(Compiler* compiler, Token name) {
-    if (globalCount >= 256) {
+    // Check if already defined (optional, but good for safety)
+    int existing = resolve_global(compiler, name);
+    if (existing != -1) {
+        vm_use_global(currentVM, existing); // The VM may be newer than the binding
+        return existing;
+    }
+
+    if (globalCount >= GLOBALS_MAX) {
         fprintf(stderr, "Too many global variables.\n");
         compiler->hadError = 1;
         return 0;
     }
-    // Check if already defined (optional, but good for safety)
-    int existing = resolve_global(compiler, name);
-    if (existing != -1) return existing;
+
+    if (globalCount == globalCapacity) {
+        int capacity = globalCapacity < 64 ? 64 : globalCapacity * 2;
+        CompilerSymbol* symbols = (CompilerSymbol*)realloc(globalSymbols, sizeof(CompilerSymbol) * capacity);
+        if (symbols == NULL) {
+            fprintf(stderr, "Out of memory while defining global variable.\n");
+            compiler->hadError = 1;
+            return -1;
+        }
+        globalSymbols = symbols;
+        globalCapacity = capacity;
+    }
 
     int index = globalCount;
     
@@ -365,62 +557,139 @@ static int define_global(Compiler* compiler, Token name) {
     globalSymbols[index].name = nameCopy;
     globalSymbols[index].length = name.length;
     globalSymbols[index].index = index;
+    globalSymbols[index].function = NULL;
+    name_table_set(&globalIndex, nameCopy, name.length, index);
     
     globalCount++;
+    vm_use_global(currentVM, index);
     return index;
 }
 
 
+/**
+ * @brief Number of global slots the compiler has handed out so far.
+ */
+int compiler_global_count(void) {
+    return globalCount;
+}
+
+/**
+ * @brief Name bound to global slot `index` (owned by the compiler; do not free).
+ */
+const char* compiler_global_name(int index, int* length) {
+    if (index < 0 || index >= globalCount) return NULL;
+    *length = globalSymbols[index].length;
+    return globalSymbols[index].name;
+}
+
+/**
+ * @brief Bind `name` to the next free global slot (or return its existing slot).
+ * Used when bytecode is loaded without compiling it (see serialize.c).
+ */
+int compiler_define_global(const char* name, int length) {
+    Compiler compiler;
+    compiler.hadError = 0;
+
+    Token token = {TOKEN_ID, name, length, 0};
+    int index = define_global(&compiler, token);
+    return compiler.hadError ? -1 : index;
+}
+
+
+// --- Direct Call Binding ---
+
+/**
+ * @brief End of a unit: forget its functions (they may be collected once the
+ * unit's code is gone, so later units never bind to them).
+ */
+static void clear_direct_calls(void) {
+    for (int i = 0; i < globalCount; i++) {
+        globalSymbols[i].function = NULL;
+    }
+}
+
+
 // --- Recursive Compilation Logic (The AST Walker) ---
 
+/**
+ * @brief Type `expr` with the compiler's checker (see compile_checked_ast()),
+ * once its operands are compiled.
+ *
+ * @return The static type, or TYPE_ERROR when not checking.
+ */
+static DataType resolve_type(Compiler* compiler, AstNode* expr, const DataType* operands) {
+    if (compiler->checker == NULL) return TYPE_ERROR;
+    return typecheck_resolve(compiler->checker, expr, operands);
+}
+
+/**
+ * @brief Report a name found by neither the locals nor the globals.
+ *
+ * When checking, an undefined variable has already been reported as a type
+ * error (checkedType is TYPE_ERROR): the unit will be rejected anyway, and
+ * the walk goes on so later type errors are reported too.
+ */
+static void undefined_variable(Compiler* compiler, Token name, DataType checkedType) {
+    if (compiler->checker != NULL && checkedType == TYPE_ERROR) return;
+    fprintf(stderr, "Compiler Error: Undefined variable '%.*s'\n", name.length, name.lexeme);
+    compiler->hadError = 1;
+}
+
 /**
  * @brief Compiles an expression node recursively.
+ *
+ * @return The expression's static type when checking, TYPE_ERROR otherwise.
  */
-static void compile_expression(Compiler* compiler, AstNode* expr) {
-    if (compiler->hadError || expr == NULL) return;
+static DataType compile_expression(Compiler* compiler, AstNode* expr) {
+    if (compiler->hadError) return TYPE_ERROR;
+    if (expr == NULL) return TYPE_VOID;
+
+    DataType operands[2] = { TYPE_ERROR, TYPE_ERROR };
+    DataType type = TYPE_ERROR;
 
     switch (expr->type) {
         case NODE_INT_LITERAL: {
             AstNodeIntLiteral* n = (AstNodeIntLiteral*)expr;
             // Emit instruction to load the constant onto the stack
             emit_constant(compiler, INT_VAL(n->value), (n->node.line));
+            type = resolve_type(compiler, expr, operands);
             break;
         }
 
         // Compile string
         case NODE_STRING_LITERAL: {
             AstNodeStringLiteral* n = (AstNodeStringLiteral*)expr;
-            // Create a String Object on the heap
-            ObjString* stringObj = copy_string(n->value, (int)strlen(n->value));
+            // Intern the source bytes (the first copy the front end makes)
+            ObjString* stringObj = copy_string(n->chars, n->length);
             // Wrap it in a Value and emit as a constant
             emit_constant(compiler, OBJ_VAL(stringObj), n->node.line);
+            type = resolve_type(compiler, expr, operands);
             break;
         }
 
         case NODE_BOOL_LITERAL: {
             AstNodeBoolLiteral* n = (AstNodeBoolLiteral*)expr;
             emit_byte(compiler, n->value ? OP_TRUE : OP_FALSE, n->node.line);
+            type = resolve_type(compiler, expr, operands);
             break;
         }
 
         // Handles variable access (x + 1)
         case NODE_VAR_ACCESS: {
             AstNodeVarAccess* n = (AstNodeVarAccess*)expr;
+            type = resolve_type(compiler, expr, operands);
             
             // Try resolving as local first
             int arg = resolve_local(compiler, n->name);
             if (arg != -1) {
-                emit_byte(compiler, OP_GET_LOCAL, n->node.line);
-                emit_byte(compiler, (uint8_t)arg, n->node.line);
+                emit_indexed(compiler, OP_GET_LOCAL, OP_GET_LOCAL_LONG, compiler->locals[arg].slot, n->node.line);
             } else {
                 // Fallback to global
                 arg = resolve_global(compiler, n->name);
                 if (arg != -1) {
-                    emit_byte(compiler, OP_GET_GLOBAL, n->node.line);
-                    emit_byte(compiler, (uint8_t)arg, n->node.line);
+                    emit_indexed(compiler, OP_GET_GLOBAL, OP_GET_GLOBAL_LONG, arg, n->node.line);
                 } else {
-                    fprintf(stderr, "Compiler Error: Undefined variable '%.*s'\n", n->name.length, n->name.lexeme);
-                    compiler->hadError = 1;
+                    undefined_variable(compiler, n->name, type);
                 }
             }
 
@@ -430,17 +699,23 @@ static void compile_expression(Compiler* compiler, AstNode* expr) {
         case NODE_VAR_ASSIGN: {
             AstNodeVarAssign* n = (AstNodeVarAssign*)expr;
 
-            compile_expression(compiler, n->expression);
+            // The target is checked first: an undefined one skips the value
+            if (compiler->checker != NULL && !typecheck_assign_target(compiler->checker, n)) {
+                break;
+            }
+
+            operands[0] = compile_expression(compiler, n->expression);
+            type = resolve_type(compiler, expr, operands);
             
             int arg = resolve_local(compiler, n->name);
             if (arg != -1) {
-                emit_byte(compiler, OP_SET_LOCAL, n->node.line);
-                emit_byte(compiler, (uint8_t)arg, n->node.line);
+                // A local nothing reads keeps no value: the store is dropped
+                int slot = compiler->locals[arg].slot;
+                if (slot >= 0) emit_indexed(compiler, OP_SET_LOCAL, OP_SET_LOCAL_LONG, slot, n->node.line);
             } else {
                 arg = resolve_global(compiler, n->name);
                 if (arg != -1) {
-                    emit_byte(compiler, OP_SET_GLOBAL, n->node.line);
-                    emit_byte(compiler, (uint8_t)arg, n->node.line);
+                    emit_indexed(compiler, OP_SET_GLOBAL, OP_SET_GLOBAL_LONG, arg, n->node.line);
                 } else {
                     fprintf(stderr, "Compiler Error: Undefined variable '%.*s'\n", n->name.length, n->name.lexeme);
                     compiler->hadError = 1;
@@ -452,7 +727,8 @@ static void compile_expression(Compiler* compiler, AstNode* expr) {
 
         case NODE_UNARY_OP: {
             AstNodeUnaryOp* n = (AstNodeUnaryOp*)expr;
-            compile_expression(compiler, n->operand);
+            operands[0] = compile_expression(compiler, n->operand);
+            type = resolve_type(compiler, expr, operands);
             if (n->op.type == TOKEN_MINUS) {
                 // '-' negate operator
                 emit_byte(compiler, OP_NEGATE, n->op.line);
@@ -468,46 +744,25 @@ static void compile_expression(Compiler* compiler, AstNode* expr) {
             AstNodeBinaryOp* n = (AstNodeBinaryOp*)expr;
             
             // 1. Compile the left operand (Pushes its result to stack)
-            compile_expression(compiler, n->left);
+            operands[0] = compile_expression(compiler, n->left);
             
             // 2. Compile the right operand (Pushes its result to stack)
-            compile_expression(compiler, n->right);
+            operands[1] = compile_expression(compiler, n->right);
+            type = resolve_type(compiler, expr, operands);
             
-            // 3. Emit the arithmetic operation
-            emit_binary_op(compiler, n->op.type, n->op.line);
+            // 3. Emit the arithmetic operation (specialized if both operand
+            //    types were proven by the typechecker)
+            DataType operandType = (n->left->resolvedType == n->right->resolvedType)
+                                 ? n->left->resolvedType : TYPE_ERROR;
+            emit_binary_op(compiler, n->op.type, operandType, n->op.line);
             break;
         }
 
         // handle function calls
-        case NODE_CALL: {
-            // Push objects in the format [...] func arg1 arg2 ... CALL_INSTR
-            // Translates to [...] ObjFunction* arg1 arg2 ... OP_CALL
-            AstNodeCall* n = (AstNodeCall*)expr;
-
-            // 1. Resolve the function name (callee)
-            int globalIndex = resolve_global(compiler, n->callee);
-            if (globalIndex == -1) {
-                fprintf(stderr, "Compiler Error: Undefined function '%.*s'\n",
-                    n->callee.length, n->callee.lexeme);
-                compiler->hadError = 1;
-                return;
-            }
-
-            // 2. Push the function object FIRST
-            emit_byte(compiler, OP_GET_GLOBAL, expr->line);
-            emit_byte(compiler, (uint8_t)globalIndex, expr->line);
-
-            // 3. Push arguments in order
-            for (int i = 0; i < n->arg_count; i++) {
-                compile_expression(compiler, n->args[i]);
-            }
-
-            // 3. Emit call instruction: OP_CALL <arg_count>
-            emit_byte(compiler, OP_CALL, expr->line);
-            emit_byte(compiler, (uint8_t)n->arg_count, expr->line);
-
+        case NODE_CALL:
+            compile_call(compiler, (AstNodeCall*)expr, false);
+            type = resolve_type(compiler, expr, operands);
             break;
-        }
 
         
         default:
@@ -515,6 +770,63 @@ static void compile_expression(Compiler* compiler, AstNode* expr) {
             compiler->hadError = 1;
             break;
     }
+
+    return type;
+}
+
+/**
+ * @brief Compiles a function call.
+ *
+ * @param tail The call is the value of a return statement in a function:
+ *             emit the OP_TAIL_CALL forms, which replace the caller's frame
+ *             (no OP_RETURN follows).
+ */
+static void compile_call(Compiler* compiler, AstNodeCall* n, bool tail) {
+    // Push objects in the format [...] func arg1 arg2 ... CALL_INSTR
+    // Translates to [...] ObjFunction* arg1 arg2 ... OP_CALL
+    int line = n->node.line;
+
+    // 1. Resolve the function name (callee)
+    int globalIndex = resolve_global(compiler, n->callee);
+    if (globalIndex == -1) {
+        fprintf(stderr, "Compiler Error: Undefined function '%.*s'\n",
+            n->callee.length, n->callee.lexeme);
+        compiler->hadError = 1;
+        return;
+    }
+
+    // Callee compiled earlier in this unit: OP_CALL_DIRECT <fnConstant> <arg_count>
+    // replaces the load, type check and arity check with one guard
+    // (see the VM handler)
+    CompilerSymbol* symbol = &globalSymbols[globalIndex];
+    if (symbol->function != NULL && symbol->function->arity == n->arg_count) {
+        int constant = make_constant(compiler, OBJ_VAL(symbol->function)); // Reused if present
+        if (constant <= UINT8_MAX) {
+            for (int i = 0; i < n->arg_count; i++) {
+                compile_expression(compiler, n->args[i]);
+            }
+            if (!tail && n->arg_count <= 3) {
+                // Fixed-arity forms: the handler moves a known number of arguments
+                emit_bytes(compiler, (uint8_t)(OP_CALL_DIRECT_0 + n->arg_count), (uint8_t)constant, line);
+                return;
+            }
+            emit_bytes(compiler, tail ? OP_TAIL_CALL_DIRECT : OP_CALL_DIRECT, (uint8_t)constant, line);
+            emit_byte(compiler, (uint8_t)n->arg_count, line);
+            return;
+        }
+    }
+
+    // 2. Push the function object FIRST
+    emit_indexed(compiler, OP_GET_GLOBAL, OP_GET_GLOBAL_LONG, globalIndex, line);
+
+    // 3. Push arguments in order
+    for (int i = 0; i < n->arg_count; i++) {
+        compile_expression(compiler, n->args[i]);
+    }
+
+    // 3. Emit call instruction: OP_CALL <arg_count>
+    emit_byte(compiler, tail ? OP_TAIL_CALL : OP_CALL, line);
+    emit_byte(compiler, (uint8_t)n->arg_count, line);
 }
 
 /**
@@ -529,9 +841,14 @@ static void compile_statement(Compiler* compiler, AstNode* stmt) {
             AstNodeBlock* block = (AstNodeBlock*)stmt;
 
             begin_scope(compiler); // Each Block is its own scope
+            if (compiler->checker != NULL) typecheck_enter_scope(compiler->checker);
+            bool* unread = unread_locals(block);
             for (int i = 0; i < block->statement_count; i++) {
+                compiler->unreadLocal = unread != NULL && unread[i];
                 compile_statement(compiler, block->statements[i]);
             }
+            free(unread);
+            if (compiler->checker != NULL) typecheck_exit_scope(compiler->checker);
             end_scope(compiler, block->node.line);
             break;
         }
@@ -540,7 +857,8 @@ static void compile_statement(Compiler* compiler, AstNode* stmt) {
         case NODE_IF: {
             AstNodeIf* n = (AstNodeIf*)stmt;
             // 1. Compile Condition
-            compile_expression(compiler, n->condition);
+            DataType condType = compile_expression(compiler, n->condition);
+            if (compiler->checker != NULL) typecheck_condition(compiler->checker, stmt, condType);
             
             // 2. Jump over "then" if false
             int thenJump = emit_jump(compiler, OP_JUMP_IF_FALSE, n->node.line);
@@ -572,7 +890,8 @@ static void compile_statement(Compiler* compiler, AstNode* stmt) {
             int loopStart = current_chunk()->count; // Mark start of loop
             
             // 1. Condition
-            compile_expression(compiler, n->condition);
+            DataType condType = compile_expression(compiler, n->condition);
+            if (compiler->checker != NULL) typecheck_condition(compiler->checker, stmt, condType);
             
             // 2. Jump out if false
             int exitJump = emit_jump(compiler, OP_JUMP_IF_FALSE, n->node.line);
@@ -593,31 +912,43 @@ static void compile_statement(Compiler* compiler, AstNode* stmt) {
         // Variable declaration
         case NODE_VAR_DECL: {
             AstNodeVarDecl* n = (AstNodeVarDecl*)stmt;
-            compile_expression(compiler, n->init); // Push value
-            
-            if (compiler->scopeDepth > 0) {
+            bool unread = compiler->unreadLocal;
+            compiler->unreadLocal = false;
+            DataType initType = compile_expression(compiler, n->init); // Push value
+            if (compiler->checker != NULL) typecheck_declare(compiler->checker, n, initType);
+
+            if (compiler->scopeDepth > 0 && unread) {
+                // LOCAL nothing reads: the initializer runs for its effects only
+                if (n->init != NULL) emit_byte(compiler, OP_POP, n->node.line);
+                add_local(compiler, n->name, false);
+            } else if (compiler->scopeDepth > 0) {
                 // LOCAL:
                 // "Claim" stack slot as variable (value already on the stack)
-                add_local(compiler, n->name);
+                add_local(compiler, n->name, true);
             } else {
                 // Fallback to GLOBAL variable declaration
                 int index = define_global(compiler, n->name);
-                emit_byte(compiler, OP_SET_GLOBAL, n->node.line);
-                emit_byte(compiler, (uint8_t)index, n->node.line);
+                emit_indexed(compiler, OP_SET_GLOBAL, OP_SET_GLOBAL_LONG, index, n->node.line);
                 emit_byte(compiler, OP_POP, n->node.line);
             }
             break;
         }
 
         case NODE_FUNC_DECL: {
-            compile_function_decl(compiler, (AstNodeFuncDecl*)stmt);
+            AstNodeFuncDecl* n = (AstNodeFuncDecl*)stmt;
+            // Only the signature is checked (the body compiles unchecked)
+            if (compiler->checker != NULL) {
+                typechecker_declare_function(n->name.lexeme, n->name.length, n->returnType);
+            }
+            compile_function_decl(compiler, n);
             break;
         }
         
         case NODE_PRINT_STMT: {
             AstNodePrintStmt* n = (AstNodePrintStmt*)stmt;
             // 1. Compile the expression (Pushes value to stack)
-            compile_expression(compiler, n->expression);
+            DataType type = compile_expression(compiler, n->expression);
+            if (compiler->checker != NULL) typecheck_print(compiler->checker, type);
             // 2. Emit the print instruction
             emit_byte(compiler, OP_PRINT, n->node.line);
             break;
@@ -634,6 +965,17 @@ static void compile_statement(Compiler* compiler, AstNode* stmt) {
         case NODE_RETURN: {
             AstNodeReturn* n = (AstNodeReturn*)stmt;
 
+            // Return values are not typechecked (as in typecheck_ast())
+            TypeChecker* checker = compiler->checker;
+            compiler->checker = NULL;
+
+            // return f(...) inside a function: f takes over this frame
+            if (n->value && n->value->type == NODE_CALL && compiler->enclosing != NULL) {
+                compile_call(compiler, (AstNodeCall*)n->value, true);
+                compiler->checker = checker;
+                break;
+            }
+
             if (n->value) {
                 compile_expression(compiler, n->value);
             } else {
@@ -641,6 +983,7 @@ static void compile_statement(Compiler* compiler, AstNode* stmt) {
             }
 
             emit_byte(compiler, OP_RETURN, stmt->line);
+            compiler->checker = checker;
             break;
         }
 
@@ -659,25 +1002,41 @@ static void compile_program(Compiler* compiler, AstNode* root) {
     AstNodeProgram* prog = (AstNodeProgram*)root;
     for (int i = 0; i < prog->statement_count; i++) {
         compile_statement(compiler, prog->statements[i]);
-        if (compiler->hadError) return;
+        if (compiler->hadError) {
+            if (compiler->checker != NULL) {
+                typecheck_statements(compiler->checker, prog->statements + i + 1,
+                                     prog->statement_count - i - 1);
+            }
+            return;
+        }
     }
     // Every chunk must end with a return instruction
     emit_byte(compiler, OP_RETURN, 0); 
+
+    // Fuse common sequences into superinstructions
+    optimize_chunk(current_chunk());
+    compiler->function->maxStackDepth = chunk_stack_depth(current_chunk(), 0);
 }
 
 
 /**
- * @brief Public interface to the compiler.
+ * @brief Compile one unit, typechecking it on the way when `checked` is set.
  */
-ObjFunction* compile_ast(struct AstNode* ast) {
+static ObjFunction* compile_unit(struct AstNode* ast, bool checked) {
     Compiler compiler;
     // compiler.chunk = chunk;
     compiler.hadError = 0;
 
     // Initialize each scope state
+    compiler.locals = NULL;
     compiler.localCount = 0;
+    compiler.localCapacity = 0;
+    compiler.slotCount = 0;
     compiler.scopeDepth = 0;
+    compiler.unreadLocal = false;
 
+    compiler.enclosing = NULL;
+    compiler.pending = BOOL_VAL(false);
     compiler.function = new_function();
 
     // set active compiler for gc
@@ -685,13 +1044,24 @@ ObjFunction* compile_ast(struct AstNode* ast) {
 
     if (ast->type != NODE_PROGRAM) {
         fprintf(stderr, "Compiler Error: AST root must be PROGRAM\n");
+        current = NULL;
         return NULL;
     }
     // Call program compilation
+    compiler.checker = checked ? typecheck_begin(ast) : NULL;
+    name_table_init(&compiler.localIndex);
     compile_program(&compiler, ast);
+    clear_direct_calls();
+    name_table_free(&compiler.localIndex);
+    free(compiler.locals);
 
     // clear active compiler after completed compilation
     current = NULL;
+
+    // A type error rejects the unit like a compile error
+    if (compiler.checker != NULL && !typecheck_end(compiler.checker)) {
+        compiler.hadError = 1;
+    }
     
     if (compiler.hadError) {
         // free_object((Obj*) compiler.function);
@@ -700,6 +1070,17 @@ ObjFunction* compile_ast(struct AstNode* ast) {
     return compiler.function;
 }
 
+/**
+ * @brief Public interface to the compiler.
+ */
+ObjFunction* compile_ast(struct AstNode* ast) {
+    return compile_unit(ast, false);
+}
+
+ObjFunction* compile_checked_ast(struct AstNode* ast) {
+    return compile_unit(ast, true);
+}
+
 /**
  * @brief Function to make the compiler compile function declarations and output to bytecode
  * 
@@ -712,7 +1093,19 @@ static void compile_function_decl(Compiler* compiler, AstNodeFuncDecl* fn) {
 
     // Step 2: Create a sub-compiler for the function
     Compiler sub;
+    sub.enclosing = current;
+    sub.pending = BOOL_VAL(false);
     sub.function = new_function();
+    sub.function->global = globalIndex;
+
+    // Root the new function (via mark_compiler_roots) before anything else allocates
+    Compiler* enclosing = current;
+    current = &sub;
+
+    // Later calls in this unit (including recursive ones) can bind to it directly
+    if (globalIndex >= 0 && globalIndex < globalCount) {
+        globalSymbols[globalIndex].function = sub.function;
+    }
 
     // Function arity = number of parameters (only once!!!!!)
     sub.function->arity = fn->param_count;
@@ -722,30 +1115,35 @@ static void compile_function_decl(Compiler* compiler, AstNodeFuncDecl* fn) {
 
     sub.scopeDepth = 0;
     sub.hadError = 0;
+    sub.checker = NULL; // Bodies are not typechecked
     
     
     
+    sub.locals = NULL;
     sub.localCount = 0;
+    sub.localCapacity = 0;
+    sub.slotCount = 0;
+    sub.unreadLocal = false;
+    name_table_init(&sub.localIndex);
     // ---------------------------------------
     // Reserve local slot 0 for the function itself
     // (matches VM call() stack layout)
     // ---------------------------------------
-    {
+    if (reserve_local(&sub)) {
         Local* local = &sub.locals[sub.localCount++];
         local->name.lexeme = "";   // dummy name
         local->name.length = 0;
         local->depth = 0;
+        local->shadowed = -1; // never entered in localIndex
+        local->slot = sub.slotCount++;
     }
     
-    Compiler* enclosing = current;
-    current = &sub;
-
     // Step 3: Begin scope for parameters
     begin_scope(&sub); // scopeDepth = 1
 
     // Add parameters as locals -> they will be at slots 1..arity
     for (int i = 0; i < fn->param_count; i++) {
-        add_local(&sub, fn->params[i]);
+        add_local(&sub, fn->params[i], true);
     }
 
     // Step 4: Compile the function body
@@ -753,6 +1151,14 @@ static void compile_function_decl(Compiler* compiler, AstNodeFuncDecl* fn) {
 
     emit_byte(&sub, OP_RETURN, fn->node.line); // Ensure function ends with a return
 
+    // Fuse common sequences into superinstructions
+    if (!sub.hadError) {
+        optimize_chunk(current_chunk());
+        sub.function->maxStackDepth = chunk_stack_depth(current_chunk(), sub.function->arity + 1);
+    }
+
+    name_table_free(&sub.localIndex);
+    free(sub.locals);
     current = enclosing; // Restore enclosing compiler
 
     // If we had compile errors inside the function, bail out
@@ -765,8 +1171,7 @@ static void compile_function_decl(Compiler* compiler, AstNodeFuncDecl* fn) {
     emit_constant(compiler, OBJ_VAL(sub.function), fn->node.line);
 
 
-    emit_byte(compiler, OP_SET_GLOBAL, fn->node.line);
-    emit_byte(compiler, (uint8_t)globalIndex, fn->node.line);
+    emit_indexed(compiler, OP_SET_GLOBAL, OP_SET_GLOBAL_LONG, globalIndex, fn->node.line);
 
     // Pop compiled function (optional, cleanup)
     emit_byte(compiler, OP_POP, fn->node.line);
@@ -825,4 +1230,8 @@ void free_global_symbols(void) {
         globalSymbols[i].index = -1;
     }
     globalCount = 0;
+    free(globalSymbols);
+    globalSymbols = NULL;
+    globalCapacity = 0;
+    name_table_free(&globalIndex);
 }
@@ -0,0 +1,307 @@
+/**
+ * @file disassembler.c
+ * @brief Bytecode listings and per-function statistics (see disassembler.h).
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "vm/disassembler.h"
+#include "vm/opcode.h"
+#include "vm/compiler.h"
+
+#define DUMP_STRING_MAX 40      // Longer string constants are cut short
+#define DUMP_HISTOGRAM_ROW 3    // Opcodes per histogram line
+
+// --- Values ---
+
+static void dump_string(FILE* out, const ObjString* string) {
+    if (string->chars == NULL) {
+        fprintf(out, "<rope %d>", string->length); // Not flattened yet
+        return;
+    }
+
+    fputc('"', out);
+    int shown = string->length < DUMP_STRING_MAX ? string->length : DUMP_STRING_MAX;
+    for (int i = 0; i < shown; i++) {
+        char c = string->chars[i];
+        if (c == '\n') fputs("\\n", out);
+        else if (c == '\t') fputs("\\t", out);
+        else if (c == '"' || c == '\\') fprintf(out, "\\%c", c);
+        else if ((unsigned char)c < 0x20) fprintf(out, "\\x%02x", (unsigned char)c);
+        else fputc(c, out);
+    }
+    fputc('"', out);
+    if (shown < string->length) fprintf(out, "... (%d chars)", string->length);
+}
+
+static const char* function_name(const ObjFunction* function) {
+    return function->name != NULL ? function->name->chars : "<script>";
+}
+
+void disassemble_value(FILE* out, Value value) {
+    if (IS_INT(value)) {
+        fprintf(out, "%d", AS_INT(value));
+    } else if (IS_BOOL(value)) {
+        fputs(AS_BOOL(value) ? "true" : "false", out);
+    } else {
+        Obj* object = AS_OBJ(value);
+        switch (object->type) {
+            case OBJ_STRING:
+            case OBJ_ROPE:
+                dump_string(out, (ObjString*)object);
+                break;
+            case OBJ_FUNCTION:
+                fprintf(out, "<fn %s>", function_name((ObjFunction*)object));
+                break;
+            case OBJ_NATIVE:
+                fprintf(out, "<native %s>", ((ObjNative*)object)->name->chars);
+                break;
+        }
+    }
+}
+
+// --- Operands ---
+
+static void constant_operand(FILE* out, const Chunk* chunk, int index) {
+    fprintf(out, "%5d ", index);
+    if (index < chunk->constants.count) {
+        disassemble_value(out, chunk->constants.values[index]);
+    } else {
+        fputs("<out of range>", out);
+    }
+}
+
+static void global_operand(FILE* out, int slot) {
+    fprintf(out, "%5d", slot);
+    int length;
+    const char* name = compiler_global_name(slot, &length); // This thread's bindings
+    if (name != NULL) fprintf(out, " %.*s", length, name);
+}
+
+static void jump_operand(FILE* out, int next, int distance, int sign) {
+    fprintf(out, "%5d -> %04d", distance, next + sign * distance);
+}
+
+int disassemble_instruction(FILE* out, const Chunk* chunk, int offset) {
+    const uint8_t* code = chunk->code + offset;
+    uint8_t op = code[0];
+    int length = opcode_length(op);
+    int next = offset + length;
+
+    int line = get_line(chunk, offset);
+    fprintf(out, "%04d ", offset);
+    if (offset > 0 && line == get_line(chunk, offset - 1)) {
+        fputs("   | ", out);
+    } else {
+        fprintf(out, "%4d ", line);
+    }
+
+    if (next > chunk->count) {
+        fprintf(out, "%-28s <truncated>\n", opcode_name(op));
+        return chunk->count;
+    }
+    if (length == 1) {
+        fprintf(out, "%s\n", opcode_name(op)); // No operands
+        return next;
+    }
+    fprintf(out, "%-28s", opcode_name(op));
+
+    int shortOperand = length == 3 ? (code[1] << 8) | code[2] : 0;
+    switch (op) {
+        case OP_CONSTANT:
+        case OP_ADD_CONST:
+        case OP_SUBTRACT_CONST:
+            constant_operand(out, chunk, code[1]);
+            break;
+        case OP_CONSTANT_LONG:
+            constant_operand(out, chunk, shortOperand);
+            break;
+
+        case OP_GET_GLOBAL:
+        case OP_SET_GLOBAL:
+            global_operand(out, code[1]);
+            break;
+        case OP_GET_GLOBAL_LONG:
+        case OP_SET_GLOBAL_LONG:
+            global_operand(out, shortOperand);
+            break;
+
+        case OP_GET_LOCAL:
+        case OP_SET_LOCAL:
+            fprintf(out, "%5d", code[1]);
+            break;
+        case OP_GET_LOCAL_LONG:
+        case OP_SET_LOCAL_LONG:
+            fprintf(out, "%5d", shortOperand);
+            break;
+
+        case OP_CALL:
+        case OP_TAIL_CALL:
+            fprintf(out, "%5d args", code[1]);
+            break;
+        case OP_POPN:
+            fprintf(out, "%5d", code[1]);
+            break;
+        case OP_CALL_DIRECT:
+        case OP_TAIL_CALL_DIRECT:
+            constant_operand(out, chunk, code[1]);
+            fprintf(out, " %d args", code[2]);
+            break;
+        case OP_CALL_DIRECT_0:
+        case OP_CALL_DIRECT_1:
+        case OP_CALL_DIRECT_2:
+        case OP_CALL_DIRECT_3:
+            constant_operand(out, chunk, code[1]);
+            break;
+
+        case OP_ADD_LOCALS:
+            fprintf(out, "%5d %d", code[1], code[2]);
+            break;
+        case OP_ADD_LOCAL_CONST:
+        case OP_INC_LOCAL:
+            fprintf(out, "%5d", code[1]);
+            constant_operand(out, chunk, code[2]);
+            break;
+        case OP_INC_GLOBAL:
+            global_operand(out, code[1]);
+            constant_operand(out, chunk, code[2]);
+            break;
+
+        case OP_JUMP:
+        case OP_JUMP_IF_FALSE:
+        case OP_JUMP_IF_FALSE_POP:
+        case OP_JUMP_IF_NOT_LESS:
+        case OP_JUMP_IF_NOT_LESS_EQUAL:
+        case OP_JUMP_IF_NOT_GREATER:
+        case OP_JUMP_IF_NOT_GREATER_EQUAL:
+            jump_operand(out, next, shortOperand, 1);
+            break;
+        case OP_LOOP:
+            jump_operand(out, next, shortOperand, -1);
+            break;
+
+        default:
+            break;
+    }
+    fputc('\n', out);
+    return next;
+}
+
+// --- Statistics ---
+
+void bytecode_stats(const Chunk* chunk, BytecodeStats* stats) {
+    int offset = 0;
+    while (offset < chunk->count) {
+        uint8_t op = chunk->code[offset];
+        stats->instructions++;
+        stats->opcodes[op]++;
+        offset += opcode_length(op);
+    }
+    stats->bytes += chunk->count;
+    stats->constants += chunk->constants.count;
+    stats->lineRuns += chunk->lineCount;
+}
+
+typedef struct {
+    int op;
+    int count;
+} OpCount;
+
+static int compare_counts(const void* a, const void* b) {
+    const OpCount* x = (const OpCount*)a;
+    const OpCount* y = (const OpCount*)b;
+    if (x->count != y->count) return x->count < y->count ? 1 : -1;
+    return x->op - y->op;
+}
+
+/**
+ * @brief Print the opcodes of `stats` by descending count.
+ */
+static void dump_histogram(FILE* out, const BytecodeStats* stats) {
+    OpCount ops[UINT8_COUNT];
+    int count = 0;
+    for (int op = 0; op < UINT8_COUNT; op++) {
+        if (stats->opcodes[op] > 0) ops[count++] = (OpCount){op, stats->opcodes[op]};
+    }
+    qsort(ops, (size_t)count, sizeof(OpCount), compare_counts);
+
+    for (int i = 0; i < count; i++) {
+        fprintf(out, "%s%-28s %5d", i % DUMP_HISTOGRAM_ROW == 0 ? "   " : "  ",
+                opcode_name((uint8_t)ops[i].op), ops[i].count);
+        if (i % DUMP_HISTOGRAM_ROW == DUMP_HISTOGRAM_ROW - 1 || i == count - 1) fputc('\n', out);
+    }
+}
+
+static void dump_summary(FILE* out, const BytecodeStats* stats) {
+    fprintf(out, "-- %d instructions, %d bytes, %d constants, %d line runs\n",
+            stats->instructions, stats->bytes, stats->constants, stats->lineRuns);
+    dump_histogram(out, stats);
+}
+
+// --- Listings ---
+
+void disassemble_function(FILE* out, const ObjFunction* function) {
+    const Chunk* chunk = &function->chunk;
+    fprintf(out, "== %s (arity %d, max stack %d) ==\n",
+            function_name(function), function->arity, function->maxStackDepth);
+
+    int offset = 0;
+    while (offset < chunk->count) offset = disassemble_instruction(out, chunk, offset);
+
+    BytecodeStats stats;
+    memset(&stats, 0, sizeof(stats));
+    bytecode_stats(chunk, &stats);
+    dump_summary(out, &stats);
+}
+
+/**
+ * @brief Functions of a unit in listing order, each once.
+ */
+typedef struct {
+    const ObjFunction** items;
+    int count;
+    int capacity;
+} FunctionList;
+
+static void add_function(FunctionList* list, const ObjFunction* function) {
+    for (int i = 0; i < list->count; i++) {
+        if (list->items[i] == function) return; // Direct calls reuse the constant
+    }
+    if (list->count == list->capacity) {
+        int capacity = list->capacity < 8 ? 8 : list->capacity * 2;
+        const ObjFunction** items = (const ObjFunction**)realloc((void*)list->items, sizeof(ObjFunction*) * (size_t)capacity);
+        if (items == NULL) return; // Out of memory: list what was found so far
+        list->items = items;
+        list->capacity = capacity;
+    }
+    list->items[list->count++] = function;
+}
+
+void disassemble_unit(FILE* out, const ObjFunction* script) {
+    FunctionList list = {NULL, 0, 0};
+    add_function(&list, script);
+
+    // Breadth first: a function's nested declarations follow it
+    for (int i = 0; i < list.count; i++) {
+        const ValueArray* constants = &list.items[i]->chunk.constants;
+        for (int k = 0; k < constants->count; k++) {
+            Value value = constants->values[k];
+            if (IS_OBJ(value) && AS_OBJ(value)->type == OBJ_FUNCTION) {
+                add_function(&list, (const ObjFunction*)AS_OBJ(value));
+            }
+        }
+    }
+
+    BytecodeStats total;
+    memset(&total, 0, sizeof(total));
+    for (int i = 0; i < list.count; i++) {
+        if (i > 0) fputc('\n', out);
+        disassemble_function(out, list.items[i]);
+        bytecode_stats(&list.items[i]->chunk, &total);
+    }
+
+    fprintf(out, "\n== unit: %d function%s ==\n", list.count, list.count == 1 ? "" : "s");
+    dump_summary(out, &total);
+    free((void*)list.items);
+}
@@ -0,0 +1,779 @@
+/**
+ * @file jit.c
+ * @brief Baseline template JIT: stack code -> x86-64 machine code (see jit.h).
+ *
+ * One pass over the chunk emits a template per instruction. The templates
+ * keep the interpreter's state in callee-saved registers:
+ *
+ *   rbx  frame slots      r12  operand stack top (sp)      r13  globals
+ *
+ * and use rax, rcx, rdx and r11 as scratch. Values are read and written in
+ * memory in the layout of value.h (the tagged struct or, with
+ * COMPACT_VALUES, the single word), so the stack is always exactly what
+ * the interpreter would have at the same instruction.
+ *
+ * A template checks everything it needs (operand types, a zero divisor)
+ * before it changes anything, and branches to an exit for the
+ * instruction's own offset when a check fails: the interpreter then runs
+ * the instruction. Instructions without a template are exits. Jumps
+ * between instructions are native jumps, so a loop with templates for all
+ * of its instructions never leaves the machine code.
+ *
+ * Layout of the mapping:
+ *
+ *   prologue   save rbx/r12/r13, load them from the arguments, jmp target
+ *   epilogue   rax = exit offset (set by the exit), rdx = sp, restore, ret
+ *   body       the templates, in bytecode order
+ *   exits      mov eax, offset; jmp epilogue (one per exit offset)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "vm/jit.h"
+#include "vm/opcode.h"
+
+#ifdef VM_JIT
+
+#include <stddef.h>
+#include <sys/mman.h>
+
+#ifndef MAP_ANONYMOUS
+    #define MAP_ANONYMOUS MAP_ANON
+#endif
+
+// --- x86-64 registers ---
+enum {
+    RAX = 0, RCX = 1, RDX = 2, RBX = 3,
+    R11 = 11, R12 = 12, R13 = 13,
+};
+
+// Condition codes (the low nibble of Jcc / SETcc)
+enum {
+    CC_E = 0x4, CC_NE = 0x5, CC_L = 0xc, CC_GE = 0xd, CC_LE = 0xe, CC_G = 0xf,
+};
+
+#define SLOTS   RBX
+#define SP      R12
+#define GLOBALS R13
+
+#define VALUE_SIZE ((int32_t)sizeof(Value))
+
+// Operand stack entry `i` from the top (0 = top)
+#define TOP(i) (-((i) + 1) * VALUE_SIZE)
+
+typedef struct {
+    int at;         // Position of the rel32 to patch
+    int target;     // Bytecode offset it jumps to (or exits at)
+} Patch;
+
+typedef struct {
+    uint8_t* code;
+    int count;
+    int capacity;
+    bool failed;
+
+    const Chunk* chunk;
+    int* nativeAt;  // Per bytecode offset: position of its template (-1: none)
+    int* exitAt;    // Per bytecode offset: position of its exit stub (-1: none)
+
+    Patch* jumps;   // rel32s to instruction templates
+    int jumpCount;
+    int jumpCapacity;
+    Patch* exits;   // rel32s to exit stubs
+    int exitCount;
+    int exitCapacity;
+} Assembler;
+
+
+/* ============================
+ *  Encoding
+ * ============================ */
+
+static void emit_byte(Assembler* a, uint8_t byte) {
+    if (a->count == a->capacity) {
+        int capacity = a->capacity < 256 ? 256 : a->capacity * 2;
+        uint8_t* code = (uint8_t*)realloc(a->code, capacity);
+        if (code == NULL) {
+            a->failed = true;
+            return;
+        }
+        a->code = code;
+        a->capacity = capacity;
+    }
+    a->code[a->count++] = byte;
+}
+
+static void emit_u32(Assembler* a, uint32_t value) {
+    for (int i = 0; i < 4; i++) emit_byte(a, (uint8_t)(value >> (8 * i)));
+}
+
+static void emit_u64(Assembler* a, uint64_t value) {
+    for (int i = 0; i < 8; i++) emit_byte(a, (uint8_t)(value >> (8 * i)));
+}
+
+static void emit_rex(Assembler* a, bool wide, int reg, int rm) {
+    uint8_t rex = (uint8_t)(0x40 | (wide ? 8 : 0) | ((reg >> 3) & 1) << 2 | ((rm >> 3) & 1));
+    if (rex != 0x40) emit_byte(a, rex);
+}
+
+// ModRM for [base + disp32] (always the disp32 form: no rbp/r13 special case)
+static void emit_mem(Assembler* a, int reg, int base, int32_t disp) {
+    emit_byte(a, (uint8_t)(0x80 | (reg & 7) << 3 | (base & 7)));
+    if ((base & 7) == 4) emit_byte(a, 0x24); // rsp/r12 base needs a SIB
+    emit_u32(a, (uint32_t)disp);
+}
+
+// <opcode> reg, [base + disp]   (or [base + disp], reg)
+static void op_mem(Assembler* a, bool wide, uint8_t opcode, int reg, int base, int32_t disp) {
+    emit_rex(a, wide, reg, base);
+    emit_byte(a, opcode);
+    emit_mem(a, reg, base, disp);
+}
+
+// <opcode> rm, reg (register to register)
+static void op_reg(Assembler* a, bool wide, uint8_t opcode, int reg, int rm) {
+    emit_rex(a, wide, reg, rm);
+    emit_byte(a, opcode);
+    emit_byte(a, (uint8_t)(0xc0 | (reg & 7) << 3 | (rm & 7)));
+}
+
+static void load32(Assembler* a, int reg, int base, int32_t disp)  { op_mem(a, false, 0x8b, reg, base, disp); }
+static void load64(Assembler* a, int reg, int base, int32_t disp)  { op_mem(a, true, 0x8b, reg, base, disp); }
+static void store32(Assembler* a, int base, int32_t disp, int reg) { op_mem(a, false, 0x89, reg, base, disp); }
+static void store64(Assembler* a, int base, int32_t disp, int reg) { op_mem(a, true, 0x89, reg, base, disp); }
+
+// mov dword [base + disp], imm32
+static void store_imm32(Assembler* a, int base, int32_t disp, uint32_t imm) {
+    op_mem(a, false, 0xc7, 0, base, disp);
+    emit_u32(a, imm);
+}
+
+// cmp dword/qword [base + disp], imm32
+static void cmp_mem_imm(Assembler* a, bool wide, int base, int32_t disp, int32_t imm) {
+    op_mem(a, wide, 0x81, 7, base, disp);
+    emit_u32(a, (uint32_t)imm);
+}
+
+// mov reg, imm64
+static void mov_imm64(Assembler* a, int reg, uint64_t imm) {
+    emit_rex(a, true, 0, reg);
+    emit_byte(a, (uint8_t)(0xb8 | (reg & 7)));
+    emit_u64(a, imm);
+}
+
+// <group 1 op> reg32/64, imm32 (add = 0, or = 1, and = 4, sub = 5, cmp = 7)
+static void alu_imm(Assembler* a, bool wide, int op, int reg, int32_t imm) {
+    emit_rex(a, wide, 0, reg);
+    emit_byte(a, 0x81);
+    emit_byte(a, (uint8_t)(0xc0 | op << 3 | (reg & 7)));
+    emit_u32(a, (uint32_t)imm);
+}
+
+// setcc al; movzx eax, al
+static void setcc_eax(Assembler* a, int cc) {
+    emit_byte(a, 0x0f);
+    emit_byte(a, (uint8_t)(0x90 | cc));
+    emit_byte(a, 0xc0);
+    emit_byte(a, 0x0f);
+    emit_byte(a, 0xb6);
+    emit_byte(a, 0xc0);
+}
+
+static void add_sp(Assembler* a, int32_t bytes) {
+    alu_imm(a, true, bytes < 0 ? 5 : 0, SP, bytes < 0 ? -bytes : bytes);
+}
+
+static bool add_patch(Patch** patches, int* count, int* capacity, int at, int target) {
+    if (*count == *capacity) {
+        int grown = *capacity < 16 ? 16 : *capacity * 2;
+        Patch* resized = (Patch*)realloc(*patches, sizeof(Patch) * grown);
+        if (resized == NULL) return false;
+        *patches = resized;
+        *capacity = grown;
+    }
+    (*patches)[(*count)++] = (Patch){at, target};
+    return true;
+}
+
+// jcc/jmp rel32 to the template of bytecode offset `target` (cc < 0: jmp)
+static void jump_to(Assembler* a, int cc, int target) {
+    if (cc < 0) {
+        emit_byte(a, 0xe9);
+    } else {
+        emit_byte(a, 0x0f);
+        emit_byte(a, (uint8_t)(0x80 | cc));
+    }
+    if (!add_patch(&a->jumps, &a->jumpCount, &a->jumpCapacity, a->count, target)) a->failed = true;
+    emit_u32(a, 0);
+}
+
+// jcc/jmp rel32 to the exit that resumes the interpreter at `offset`
+static void exit_to(Assembler* a, int cc, int offset) {
+    if (cc < 0) {
+        emit_byte(a, 0xe9);
+    } else {
+        emit_byte(a, 0x0f);
+        emit_byte(a, (uint8_t)(0x80 | cc));
+    }
+    if (!add_patch(&a->exits, &a->exitCount, &a->exitCapacity, a->count, offset)) a->failed = true;
+    emit_u32(a, 0);
+}
+
+static void patch_rel32(Assembler* a, int at, int destination) {
+    int32_t rel = destination - (at + 4);
+    for (int i = 0; i < 4; i++) a->code[at + i] = (uint8_t)((uint32_t)rel >> (8 * i));
+}
+
+
+/* ============================
+ *  Value layout
+ * ============================ */
+
+#ifdef COMPACT_VALUES
+
+// shl reg32, imm8
+static void shl32(Assembler* a, int reg, uint8_t count) {
+    emit_rex(a, false, 0, reg);
+    emit_byte(a, 0xc1);
+    emit_byte(a, (uint8_t)(0xe0 | (reg & 7)));
+    emit_byte(a, count);
+}
+
+// The int is the high half of the word
+static void load_int(Assembler* a, int reg, int base, int32_t disp) {
+    load32(a, reg, base, disp + 4);
+}
+
+static void store_int(Assembler* a, int base, int32_t disp, int reg) {
+    store_imm32(a, base, disp, (uint32_t)VALUE_TAG_INT);
+    store32(a, base, disp + 4, reg);
+}
+
+// Exit unless the tag of [base + disp] is `tag`
+static void guard_tag(Assembler* a, int base, int32_t disp, uint64_t tag, int offset) {
+    load32(a, R11, base, disp);
+    alu_imm(a, false, 4, R11, (int32_t)VALUE_TAG_MASK);
+    alu_imm(a, false, 7, R11, (int32_t)tag);
+    exit_to(a, CC_NE, offset);
+}
+
+static void guard_int(Assembler* a, int base, int32_t disp, int offset) {
+    guard_tag(a, base, disp, VALUE_TAG_INT, offset);
+}
+
+static void guard_bool(Assembler* a, int base, int32_t disp, int offset) {
+    guard_tag(a, base, disp, VALUE_TAG_BOOL, offset);
+}
+
+// Exit if [base + disp] is an object
+static void guard_not_obj(Assembler* a, int base, int32_t disp, int offset) {
+    load32(a, R11, base, disp);
+    alu_imm(a, false, 4, R11, (int32_t)VALUE_TAG_MASK);
+    exit_to(a, CC_E, offset);
+}
+
+// Set ZF if [base + disp] is the false value (the interpreter's falsey test)
+static void test_false(Assembler* a, int base, int32_t disp) {
+    cmp_mem_imm(a, true, base, disp, (int32_t)FALSE_VALUE);
+}
+
+// Store the bool in eax (0 or 1)
+static void store_bool_eax(Assembler* a, int base, int32_t disp) {
+    shl32(a, RAX, 3);
+    alu_imm(a, false, 1, RAX, (int32_t)VALUE_TAG_BOOL);
+    store64(a, base, disp, RAX);
+}
+
+// Jump to `target` if [base + disp] is false
+static void jump_if_false(Assembler* a, int base, int32_t disp, int target) {
+    test_false(a, base, disp);
+    jump_to(a, CC_E, target);
+}
+
+#else
+
+#define TYPE_AT    ((int32_t)offsetof(Value, type))
+#define PAYLOAD_AT ((int32_t)offsetof(Value, as))
+
+static void load_int(Assembler* a, int reg, int base, int32_t disp) {
+    load32(a, reg, base, disp + PAYLOAD_AT);
+}
+
+static void store_int(Assembler* a, int base, int32_t disp, int reg) {
+    store_imm32(a, base, disp + TYPE_AT, VAL_INT);
+    store32(a, base, disp + PAYLOAD_AT, reg);
+}
+
+static void guard_type(Assembler* a, int base, int32_t disp, ValueType type, int offset) {
+    cmp_mem_imm(a, false, base, disp + TYPE_AT, (int32_t)type);
+    exit_to(a, CC_NE, offset);
+}
+
+static void guard_int(Assembler* a, int base, int32_t disp, int offset) {
+    guard_type(a, base, disp, VAL_INT, offset);
+}
+
+static void guard_bool(Assembler* a, int base, int32_t disp, int offset) {
+    guard_type(a, base, disp, VAL_BOOL, offset);
+}
+
+static void guard_not_obj(Assembler* a, int base, int32_t disp, int offset) {
+    cmp_mem_imm(a, false, base, disp + TYPE_AT, VAL_OBJ);
+    exit_to(a, CC_E, offset);
+}
+
+// Set ZF if the bool [base + disp] is false (its type is already known)
+static void test_false(Assembler* a, int base, int32_t disp) {
+    // cmp byte [base + disp], 0
+    op_mem(a, false, 0x80, 7, base, disp + PAYLOAD_AT);
+    emit_byte(a, 0);
+}
+
+// The whole payload word is written (eax is zero-extended)
+static void store_bool_eax(Assembler* a, int base, int32_t disp) {
+    store_imm32(a, base, disp + TYPE_AT, VAL_BOOL);
+    store64(a, base, disp + PAYLOAD_AT, RAX);
+}
+
+static void jump_if_false(Assembler* a, int base, int32_t disp, int target) {
+    // Only a bool can be false: skip the test for anything else
+    cmp_mem_imm(a, false, base, disp + TYPE_AT, VAL_BOOL);
+    emit_byte(a, 0x75); // jne rel8 over the test and the jump
+    int skip = a->count;
+    emit_byte(a, 0);
+    test_false(a, base, disp);
+    jump_to(a, CC_E, target);
+    a->code[skip] = (uint8_t)(a->count - (skip + 1));
+}
+
+#endif // COMPACT_VALUES
+
+// Store a Value known at compile time
+static void store_value(Assembler* a, int base, int32_t disp, Value value) {
+    uint64_t words[sizeof(Value) / 8];
+    memcpy(words, &value, sizeof(words));
+    for (int i = 0; i < (int)(sizeof(Value) / 8); i++) {
+        mov_imm64(a, RAX, words[i]);
+        store64(a, base, disp + 8 * i, RAX);
+    }
+}
+
+static void copy_value(Assembler* a, int dstBase, int32_t dst, int srcBase, int32_t src) {
+    for (int i = 0; i < (int)(sizeof(Value) / 8); i++) {
+        load64(a, RAX, srcBase, src + 8 * i);
+        store64(a, dstBase, dst + 8 * i, RAX);
+    }
+}
+
+
+/* ============================
+ *  Templates
+ * ============================ */
+
+// Objects are read from the pool (the collector may replace the pointer),
+// everything else is an immediate
+static void push_constant(Assembler* a, const Value* constant) {
+    if (IS_OBJ(*constant)) {
+        mov_imm64(a, RDX, (uint64_t)(uintptr_t)constant);
+        copy_value(a, SP, 0, RDX, 0);
+    } else {
+        store_value(a, SP, 0, *constant);
+    }
+    add_sp(a, VALUE_SIZE);
+}
+
+// eax = second from the top, ecx = top
+static void load_int_operands(Assembler* a) {
+    load_int(a, RAX, SP, TOP(1));
+    load_int(a, RCX, SP, TOP(0));
+}
+
+static void int_binary(Assembler* a, bool checked, int offset, uint8_t opcode) {
+    if (checked) {
+        guard_int(a, SP, TOP(0), offset);
+        guard_int(a, SP, TOP(1), offset);
+    }
+    load_int_operands(a);
+    if (opcode == 0xaf) {
+        // imul eax, ecx
+        emit_byte(a, 0x0f);
+        emit_byte(a, 0xaf);
+        emit_byte(a, 0xc1);
+    } else {
+        op_reg(a, false, opcode, RCX, RAX); // add/sub eax, ecx
+    }
+    store_int(a, SP, TOP(1), RAX);
+    add_sp(a, -VALUE_SIZE);
+}
+
+static void int_divide(Assembler* a, bool checked, int offset, bool remainder) {
+    if (checked) {
+        guard_int(a, SP, TOP(0), offset);
+        guard_int(a, SP, TOP(1), offset);
+    }
+    load_int_operands(a);
+    // Zero (an error) and -1 (INT_MIN / -1 traps) are left to the interpreter
+    op_reg(a, false, 0x85, RCX, RCX); // test ecx, ecx
+    exit_to(a, CC_E, offset);
+    alu_imm(a, false, 7, RCX, -1);
+    exit_to(a, CC_E, offset);
+    emit_byte(a, 0x99);               // cdq
+    emit_byte(a, 0xf7);               // idiv ecx
+    emit_byte(a, 0xf9);
+    store_int(a, SP, TOP(1), remainder ? RDX : RAX);
+    add_sp(a, -VALUE_SIZE);
+}
+
+static void int_compare(Assembler* a, bool checked, int offset, int cc) {
+    if (checked) {
+        guard_int(a, SP, TOP(0), offset);
+        guard_int(a, SP, TOP(1), offset);
+    }
+    load_int_operands(a);
+    op_reg(a, false, 0x39, RCX, RAX); // cmp eax, ecx
+    setcc_eax(a, cc);
+    store_bool_eax(a, SP, TOP(1));
+    add_sp(a, -VALUE_SIZE);
+}
+
+static int jump_target(const Chunk* chunk, int offset, bool backward) {
+    int distance = (chunk->code[offset + 1] << 8) | chunk->code[offset + 2];
+    return backward ? offset + 3 - distance : offset + 3 + distance;
+}
+
+// Pop two ints, jump when `cc` (the negated comparison) holds
+static void int_compare_branch(Assembler* a, int offset, int cc) {
+    guard_int(a, SP, TOP(0), offset);
+    guard_int(a, SP, TOP(1), offset);
+    load_int_operands(a);
+    add_sp(a, -2 * VALUE_SIZE);
+    op_reg(a, false, 0x39, RCX, RAX); // cmp eax, ecx (after the add: it sets the flags)
+    jump_to(a, cc, jump_target(a->chunk, offset, false));
+}
+
+// Push the int local + an int constant known at compile time
+static void add_int_immediate(Assembler* a, int base, int32_t disp, int32_t imm) {
+    load_int(a, RAX, base, disp);
+    alu_imm(a, false, 0, RAX, imm);
+}
+
+/**
+ * @brief Emit the template of the instruction at `offset`.
+ *
+ * @return false if it has none (the instruction is an exit).
+ */
+static bool emit_instruction(Assembler* a, int offset) {
+    const Chunk* chunk = a->chunk;
+    const uint8_t* code = chunk->code + offset;
+    const Value* constants = chunk->constants.values;
+
+    switch (code[0]) {
+        case OP_CONSTANT:
+            push_constant(a, &constants[code[1]]);
+            return true;
+        case OP_CONSTANT_LONG:
+            push_constant(a, &constants[(code[1] << 8) | code[2]]);
+            return true;
+        case OP_TRUE:
+        case OP_FALSE:
+            store_value(a, SP, 0, BOOL_VAL(code[0] == OP_TRUE));
+            add_sp(a, VALUE_SIZE);
+            return true;
+        case OP_NIL:
+        case OP_CLOSURE:
+            return true;
+
+        case OP_GET_LOCAL:
+        case OP_GET_LOCAL_LONG: {
+            int slot = code[0] == OP_GET_LOCAL ? code[1] : (code[1] << 8) | code[2];
+            copy_value(a, SP, 0, SLOTS, slot * VALUE_SIZE);
+            add_sp(a, VALUE_SIZE);
+            return true;
+        }
+        case OP_SET_LOCAL:
+        case OP_SET_LOCAL_LONG: {
+            int slot = code[0] == OP_SET_LOCAL ? code[1] : (code[1] << 8) | code[2];
+            copy_value(a, SLOTS, slot * VALUE_SIZE, SP, TOP(0));
+            return true;
+        }
+        case OP_GET_GLOBAL:
+        case OP_GET_GLOBAL_LONG: {
+            int index = code[0] == OP_GET_GLOBAL ? code[1] : (code[1] << 8) | code[2];
+            copy_value(a, SP, 0, GLOBALS, index * VALUE_SIZE);
+            add_sp(a, VALUE_SIZE);
+            return true;
+        }
+        case OP_SET_GLOBAL:
+        case OP_SET_GLOBAL_LONG: {
+            // Objects go through the interpreter's write barriers
+            int index = code[0] == OP_SET_GLOBAL ? code[1] : (code[1] << 8) | code[2];
+            guard_not_obj(a, SP, TOP(0), offset);
+            copy_value(a, GLOBALS, index * VALUE_SIZE, SP, TOP(0));
+            return true;
+        }
+        case OP_POP:
+            add_sp(a, -VALUE_SIZE);
+            return true;
+        case OP_POPN:
+            add_sp(a, -VALUE_SIZE * code[1]);
+            return true;
+
+        // Strings and type errors exit at the guards
+        case OP_ADD:          int_binary(a, true, offset, 0x01); return true;
+        case OP_SUBTRACT:     int_binary(a, true, offset, 0x29); return true;
+        case OP_MULTIPLY:     int_binary(a, true, offset, 0xaf); return true;
+        case OP_ADD_INT:      int_binary(a, false, offset, 0x01); return true;
+        case OP_SUBTRACT_INT: int_binary(a, false, offset, 0x29); return true;
+        case OP_MULTIPLY_INT: int_binary(a, false, offset, 0xaf); return true;
+        case OP_DIVIDE:       int_divide(a, true, offset, false); return true;
+        case OP_MODULO:       int_divide(a, true, offset, true); return true;
+        case OP_DIVIDE_INT:   int_divide(a, false, offset, false); return true;
+        case OP_MODULO_INT:   int_divide(a, false, offset, true); return true;
+
+        case OP_NEGATE:
+            guard_int(a, SP, TOP(0), offset);
+            load_int(a, RAX, SP, TOP(0));
+            emit_byte(a, 0xf7); // neg eax
+            emit_byte(a, 0xd8);
+            store_int(a, SP, TOP(0), RAX);
+            return true;
+
+        case OP_NOT:
+            guard_bool(a, SP, TOP(0), offset);
+            test_false(a, SP, TOP(0));
+            setcc_eax(a, CC_E);
+            store_bool_eax(a, SP, TOP(0));
+            return true;
+
+        // Equality on anything but two ints is left to values_equal()
+        case OP_EQUAL:             int_compare(a, true, offset, CC_E); return true;
+        case OP_NOT_EQUAL:         int_compare(a, true, offset, CC_NE); return true;
+        case OP_GREATER:           int_compare(a, true, offset, CC_G); return true;
+        case OP_LESS:              int_compare(a, true, offset, CC_L); return true;
+        case OP_GREATER_EQUAL:     int_compare(a, true, offset, CC_GE); return true;
+        case OP_LESS_EQUAL:        int_compare(a, true, offset, CC_LE); return true;
+        case OP_EQUAL_INT:         int_compare(a, false, offset, CC_E); return true;
+        case OP_NOT_EQUAL_INT:     int_compare(a, false, offset, CC_NE); return true;
+        case OP_GREATER_INT:       int_compare(a, false, offset, CC_G); return true;
+        case OP_LESS_INT:          int_compare(a, false, offset, CC_L); return true;
+        case OP_GREATER_EQUAL_INT: int_compare(a, false, offset, CC_GE); return true;
+        case OP_LESS_EQUAL_INT:    int_compare(a, false, offset, CC_LE); return true;
+
+        case OP_ADD_CONST:
+        case OP_SUBTRACT_CONST: {
+            Value k = constants[code[1]];
+            if (!IS_INT(k)) return false;
+            int32_t imm = code[0] == OP_ADD_CONST ? AS_INT(k) : (int32_t)(0u - (uint32_t)AS_INT(k));
+            guard_int(a, SP, TOP(0), offset);
+            add_int_immediate(a, SP, TOP(0), imm);
+            store_int(a, SP, TOP(0), RAX);
+            return true;
+        }
+        case OP_ADD_LOCALS: {
+            // Strings exit at the guards
+            int32_t left = code[1] * VALUE_SIZE;
+            int32_t right = code[2] * VALUE_SIZE;
+            guard_int(a, SLOTS, left, offset);
+            guard_int(a, SLOTS, right, offset);
+            load_int(a, RAX, SLOTS, left);
+            load_int(a, RCX, SLOTS, right);
+            op_reg(a, false, 0x01, RCX, RAX);
+            store_int(a, SP, 0, RAX);
+            add_sp(a, VALUE_SIZE);
+            return true;
+        }
+        case OP_ADD_LOCAL_CONST: {
+            Value k = constants[code[2]];
+            if (!IS_INT(k)) return false;
+            guard_int(a, SLOTS, code[1] * VALUE_SIZE, offset);
+            add_int_immediate(a, SLOTS, code[1] * VALUE_SIZE, AS_INT(k));
+            store_int(a, SP, 0, RAX);
+            add_sp(a, VALUE_SIZE);
+            return true;
+        }
+
+        case OP_INC_LOCAL:
+        case OP_INC_GLOBAL: {
+            Value k = constants[code[2]];
+            if (!IS_INT(k)) return false;
+            int base = code[0] == OP_INC_LOCAL ? SLOTS : GLOBALS;
+            guard_int(a, base, code[1] * VALUE_SIZE, offset);
+            add_int_immediate(a, base, code[1] * VALUE_SIZE, AS_INT(k));
+            store_int(a, base, code[1] * VALUE_SIZE, RAX);
+            return true;
+        }
+
+        case OP_JUMP_IF_NOT_LESS:          int_compare_branch(a, offset, CC_GE); return true;
+        case OP_JUMP_IF_NOT_LESS_EQUAL:    int_compare_branch(a, offset, CC_G); return true;
+        case OP_JUMP_IF_NOT_GREATER:       int_compare_branch(a, offset, CC_LE); return true;
+        case OP_JUMP_IF_NOT_GREATER_EQUAL: int_compare_branch(a, offset, CC_L); return true;
+
+        case OP_JUMP:
+            jump_to(a, -1, jump_target(chunk, offset, false));
+            return true;
+        case OP_LOOP:
+            jump_to(a, -1, jump_target(chunk, offset, true));
+            return true;
+        case OP_JUMP_IF_FALSE:
+            jump_if_false(a, SP, TOP(0), jump_target(chunk, offset, false));
+            return true;
+        case OP_JUMP_IF_FALSE_POP:
+            // The condition stays readable just above the new top
+            add_sp(a, -VALUE_SIZE);
+            jump_if_false(a, SP, 0, jump_target(chunk, offset, false));
+            return true;
+
+        default:
+            // Calls, returns, printing, concatenation
+            return false;
+    }
+}
+
+static void free_assembler(Assembler* a) {
+    free(a->code);
+    free(a->nativeAt);
+    free(a->exitAt);
+    free(a->jumps);
+    free(a->exits);
+}
+
+bool jit_available(void) {
+    return true;
+}
+
+bool jit_compile(ObjFunction* function) {
+    if (function->jit != NULL) return true;
+
+    const Chunk* chunk = &function->chunk;
+    Assembler a;
+    memset(&a, 0, sizeof(a));
+    a.chunk = chunk;
+    a.nativeAt = (int*)malloc(sizeof(int) * (chunk->count + 1));
+    a.exitAt = (int*)malloc(sizeof(int) * (chunk->count + 1));
+    bool* supported = (bool*)calloc(chunk->count + 1, sizeof(bool));
+    if (a.nativeAt == NULL || a.exitAt == NULL || supported == NULL) {
+        free(supported);
+        free_assembler(&a);
+        return false;
+    }
+    for (int i = 0; i <= chunk->count; i++) {
+        a.nativeAt[i] = -1;
+        a.exitAt[i] = -1;
+    }
+
+    // Prologue (System V: rdi = slots, rsi = sp, rdx = globals, rcx = target)
+    emit_byte(&a, 0x53);                            // push rbx
+    emit_byte(&a, 0x41); emit_byte(&a, 0x54);       // push r12
+    emit_byte(&a, 0x41); emit_byte(&a, 0x55);       // push r13
+    emit_byte(&a, 0x48); emit_byte(&a, 0x89); emit_byte(&a, 0xfb); // mov rbx, rdi
+    emit_byte(&a, 0x49); emit_byte(&a, 0x89); emit_byte(&a, 0xf4); // mov r12, rsi
+    emit_byte(&a, 0x49); emit_byte(&a, 0x89); emit_byte(&a, 0xd5); // mov r13, rdx
+    emit_byte(&a, 0xff); emit_byte(&a, 0xe1);       // jmp rcx
+
+    // Epilogue: return {rax = offset, rdx = sp}
+    int epilogue = a.count;
+    emit_byte(&a, 0x4c); emit_byte(&a, 0x89); emit_byte(&a, 0xe2); // mov rdx, r12
+    emit_byte(&a, 0x41); emit_byte(&a, 0x5d);       // pop r13
+    emit_byte(&a, 0x41); emit_byte(&a, 0x5c);       // pop r12
+    emit_byte(&a, 0x5b);                            // pop rbx
+    emit_byte(&a, 0xc3);                            // ret
+
+    // Body
+    for (int offset = 0; offset < chunk->count && !a.failed; ) {
+        int length = opcode_length(chunk->code[offset]);
+        if (offset + length > chunk->count) break;
+
+        a.nativeAt[offset] = a.count;
+        if (emit_instruction(&a, offset)) {
+            supported[offset] = true;
+        } else {
+            exit_to(&a, -1, offset);
+        }
+        offset += length;
+    }
+
+    // Exits (one per offset)
+    for (int i = 0; i < a.exitCount && !a.failed; i++) {
+        int offset = a.exits[i].target;
+        if (a.exitAt[offset] < 0) {
+            a.exitAt[offset] = a.count;
+            emit_byte(&a, 0xb8); // mov eax, offset
+            emit_u32(&a, (uint32_t)offset);
+            emit_byte(&a, 0xe9); // jmp epilogue
+            emit_u32(&a, 0);
+            patch_rel32(&a, a.count - 4, epilogue);
+        }
+        patch_rel32(&a, a.exits[i].at, a.exitAt[offset]);
+    }
+
+    // Jumps: a target inside an instruction means malformed code
+    for (int i = 0; i < a.jumpCount && !a.failed; i++) {
+        int target = a.jumps[i].target;
+        if (target < 0 || target >= chunk->count || a.nativeAt[target] < 0) {
+            a.failed = true;
+            break;
+        }
+        patch_rel32(&a, a.jumps[i].at, a.nativeAt[target]);
+    }
+
+    JitCode* jit = NULL;
+    if (!a.failed) jit = (JitCode*)malloc(sizeof(JitCode));
+    if (jit != NULL) {
+        jit->entries = (const void**)calloc(chunk->count + 1, sizeof(void*));
+        jit->size = (size_t)a.count;
+        jit->count = chunk->count;
+        void* memory = mmap(NULL, jit->size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (jit->entries == NULL || memory == MAP_FAILED) {
+            if (memory != MAP_FAILED) munmap(memory, jit->size);
+            free(jit->entries);
+            free(jit);
+            jit = NULL;
+        } else {
+            // Write, then make it executable (never both)
+            memcpy(memory, a.code, jit->size);
+            if (mprotect(memory, jit->size, PROT_READ | PROT_EXEC) != 0) {
+                munmap(memory, jit->size);
+                free(jit->entries);
+                free(jit);
+                jit = NULL;
+            } else {
+                jit->memory = (uint8_t*)memory;
+                jit->enter = (JitEntryFn)(void*)jit->memory;
+                for (int offset = 0; offset < chunk->count; offset++) {
+                    if (supported[offset]) jit->entries[offset] = jit->memory + a.nativeAt[offset];
+                }
+            }
+        }
+    }
+
+    free(supported);
+    free_assembler(&a);
+    function->jit = jit;
+    return jit != NULL;
+}
+
+void jit_free(JitCode* code) {
+    if (code == NULL) return;
+    munmap(code->memory, code->size);
+    free(code->entries);
+    free(code);
+}
+
+#else // !VM_JIT
+
+bool jit_available(void) {
+    return false;
+}
+
+bool jit_compile(ObjFunction* function) {
+    (void)function;
+    return false;
+}
+
+void jit_free(JitCode* code) {
+    (void)code;
+}
+
+#endif // VM_JIT
@@ -0,0 +1,294 @@
+/**
+ * @file memo.c
+ * @brief Purity analysis and result tables for --memoize (see memo.h).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "vm/memo.h"
+#include "vm/memory.h"
+#include "vm/opcode.h"
+
+#define MEMO_INITIAL_CAPACITY 64
+
+/**
+ * @brief Functions in discovery order, each once (malloc'd scratch).
+ */
+typedef struct {
+    ObjFunction** items;
+    int count;
+    int capacity;
+} FunctionList;
+
+static bool add_function(FunctionList* list, ObjFunction* function) {
+    for (int i = 0; i < list->count; i++) {
+        if (list->items[i] == function) return true;
+    }
+    if (list->count == list->capacity) {
+        int capacity = list->capacity < 8 ? 8 : list->capacity * 2;
+        ObjFunction** items = (ObjFunction**)realloc(list->items, sizeof(ObjFunction*) * (size_t)capacity);
+        if (items == NULL) return false;
+        list->items = items;
+        list->capacity = capacity;
+    }
+    list->items[list->count++] = function;
+    return true;
+}
+
+// --- Purity ---
+
+static bool classify(VM* vm, ObjFunction* function);
+
+/**
+ * @brief Walk `function`'s code: false on anything a pure function may not
+ * do. The pure functions it calls (and theirs) are added to `callees`.
+ */
+static bool pure_code(VM* vm, ObjFunction* function, FunctionList* callees) {
+    const Chunk* chunk = &function->chunk;
+    int offset = 0;
+    while (offset < chunk->count) {
+        const uint8_t* code = chunk->code + offset;
+        switch (code[0]) {
+            case OP_GET_GLOBAL:
+            case OP_SET_GLOBAL:
+            case OP_GET_GLOBAL_LONG:
+            case OP_SET_GLOBAL_LONG:
+            case OP_INC_GLOBAL:
+            case OP_PRINT:
+            case OP_CALL:       // The callee could be anything
+            case OP_TAIL_CALL:
+            case OP_CLOSURE:
+                return false;
+
+            // Parameters must still hold the arguments on return
+            case OP_SET_LOCAL:
+            case OP_INC_LOCAL:
+                if (code[1] <= function->arity) return false;
+                break;
+            case OP_SET_LOCAL_LONG:
+                if (((code[1] << 8) | code[2]) <= function->arity) return false;
+                break;
+
+            default:
+                if (is_direct_call(code[0])) {
+                    ObjFunction* callee = AS_FUNCTION(chunk->constants.values[code[1]]);
+                    if (callee == function) break; // Recursion
+                    if (!classify(vm, callee)) return false;
+                    if (!add_function(callees, callee)) return false;
+                    for (int i = 0; i < callee->memo->calleeCount; i++) {
+                        ObjFunction* indirect = callee->memo->callees[i];
+                        if (indirect != function && !add_function(callees, indirect)) return false;
+                    }
+                }
+                break;
+        }
+        offset += opcode_length(code[0]);
+    }
+    return true;
+}
+
+/**
+ * @brief Put OP_MEMO in front of the code and turn each OP_RETURN into
+ * OP_MEMO_RETURN. Jumps are relative to their own instruction, so only the
+ * line table moves with the code.
+ */
+static void instrument(ObjFunction* function) {
+    Chunk* chunk = &function->chunk;
+    for (int offset = 0; offset < chunk->count; offset += opcode_length(chunk->code[offset])) {
+        if (chunk->code[offset] == OP_RETURN) chunk->code[offset] = OP_MEMO_RETURN;
+    }
+
+    // Grow by one byte on the last line (no new line run), then shift
+    int lastLine = chunk->lineCount > 0 ? chunk->lines[chunk->lineCount - 1].line : 0;
+    write_chunk(chunk, OP_MEMO, lastLine);
+    memmove(chunk->code + 1, chunk->code, (size_t)(chunk->count - 1));
+    chunk->code[0] = OP_MEMO;
+    for (int i = 1; i < chunk->lineCount; i++) chunk->lines[i].offset++;
+    chunk->lines[0].offset = 0; // OP_MEMO joins the first line
+}
+
+/**
+ * @brief Decide whether `function` is pure, instrumenting it if so.
+ */
+static bool classify(VM* vm, ObjFunction* function) {
+    if (function->memoState == MEMO_PURE) return true;
+    if (function->memoState != MEMO_UNKNOWN) return false; // Impure, or mutual recursion
+
+    // The script, register code and functions already compiled to machine
+    // code are left as they are
+    if (function->global < 0 || function->registers != 0 || function->jit != NULL ||
+        function->arity > MEMO_ARGS_MAX) {
+        function->memoState = MEMO_IMPURE;
+        return false;
+    }
+
+    function->memoState = MEMO_VISITING;
+    FunctionList callees = {NULL, 0, 0};
+    bool pure = pure_code(vm, function, &callees);
+    if (pure) {
+        MemoTable* memo = (MemoTable*)vm_reallocate(vm, NULL, 0, sizeof(MemoTable));
+        memset(memo, 0, sizeof(*memo));
+        if (callees.count > 0) {
+            size_t size = sizeof(ObjFunction*) * (size_t)callees.count;
+            memo->callees = (ObjFunction**)vm_reallocate(vm, NULL, 0, size);
+            memcpy(memo->callees, callees.items, size);
+            memo->calleeCount = callees.count;
+        }
+        function->memo = memo;
+        instrument(function);
+    }
+    function->memoState = pure ? MEMO_PURE : MEMO_IMPURE;
+    free(callees.items);
+    return pure;
+}
+
+void memoize_unit(VM* vm, ObjFunction* script) {
+    FunctionList found = {NULL, 0, 0};
+    if (!add_function(&found, script)) return;
+
+    // Breadth first through the constants, as verify_unit() finds them
+    for (int scanned = 0; scanned < found.count; scanned++) {
+        const ValueArray* constants = &found.items[scanned]->chunk.constants;
+        for (int i = 0; i < constants->count; i++) {
+            if (!IS_FUNCTION(constants->values[i])) continue;
+            ObjFunction* function = AS_FUNCTION(constants->values[i]);
+            if (function->memoState != MEMO_UNKNOWN) continue; // An earlier unit's
+            if (!add_function(&found, function)) {
+                free(found.items);
+                return; // Out of memory: run the rest as compiled
+            }
+        }
+    }
+
+    for (int i = 1; i < found.count; i++) classify(vm, found.items[i]);
+    script->memoState = MEMO_IMPURE;
+    free(found.items);
+}
+
+// --- Tables ---
+
+static bool cacheable(Value value) {
+    return IS_INT(value) || IS_BOOL(value);
+}
+
+static uint32_t hash_args(const Value* args, int arity) {
+    uint32_t hash = 2166136261u;
+    for (int i = 0; i < arity; i++) {
+        uint32_t bits = IS_INT(args[i]) ? (uint32_t)AS_INT(args[i]) : AS_BOOL(args[i]) ? 0x9e3779b9u : 0x7f4a7c15u;
+        hash = (hash ^ bits) * 16777619u;
+    }
+    hash ^= hash >> 15;
+    hash *= 0x2c1b3c6du;
+    return hash ^ (hash >> 12);
+}
+
+static bool same_args(const Value* a, const Value* b, int arity) {
+    for (int i = 0; i < arity; i++) {
+        if (VALUE_TYPE(a[i]) != VALUE_TYPE(b[i])) return false;
+        if (IS_INT(a[i]) ? AS_INT(a[i]) != AS_INT(b[i]) : AS_BOOL(a[i]) != AS_BOOL(b[i])) return false;
+    }
+    return true;
+}
+
+/**
+ * @brief The entry holding `args`, or the empty one where they would go.
+ */
+static MemoEntry* find_entry(MemoEntry* entries, int capacity, const Value* args, int arity) {
+    uint32_t slot = hash_args(args, arity) & (uint32_t)(capacity - 1);
+    for (;;) {
+        MemoEntry* entry = &entries[slot];
+        if (!entry->used || same_args(entry->args, args, arity)) return entry;
+        slot = (slot + 1) & (uint32_t)(capacity - 1);
+    }
+}
+
+/**
+ * @brief Whether `function` and everything it calls are still the
+ * functions their globals hold (a direct call runs whatever is bound).
+ */
+static bool bindings_hold(VM* vm, ObjFunction* function) {
+    if (!IS_OBJ(vm->globals[function->global]) || AS_OBJ(vm->globals[function->global]) != (Obj*)function) return false;
+    const MemoTable* memo = function->memo;
+    for (int i = 0; i < memo->calleeCount; i++) {
+        ObjFunction* callee = memo->callees[i];
+        Value bound = vm->globals[callee->global];
+        if (!IS_OBJ(bound) || AS_OBJ(bound) != (Obj*)callee) return false;
+    }
+    return true;
+}
+
+bool memo_lookup(VM* vm, ObjFunction* function, const Value* args, Value* result) {
+    MemoTable* memo = function->memo;
+    if (!bindings_hold(vm, function)) {
+        // Its results may no longer be what a call would return
+        function->memo = NULL;
+        function->memoState = MEMO_IMPURE;
+        free_memo(memo);
+        return false;
+    }
+
+    int arity = function->arity;
+    for (int i = 0; i < arity; i++) {
+        if (!cacheable(args[i])) return false;
+    }
+    if (memo->entries != NULL) {
+        MemoEntry* entry = find_entry(memo->entries, memo->capacity, args, arity);
+        if (entry->used) {
+            memo->hits++;
+            *result = entry->result;
+            return true;
+        }
+    }
+    memo->misses++;
+    return false;
+}
+
+/**
+ * @brief Move the entries into a table of `capacity` (NULL when empty).
+ */
+static void resize_entries(VM* vm, MemoTable* memo, int capacity, int arity) {
+    size_t size = sizeof(MemoEntry) * (size_t)capacity;
+    MemoEntry* entries = (MemoEntry*)vm_reallocate(vm, NULL, 0, size);
+    memset(entries, 0, size);
+    for (int i = 0; i < memo->capacity; i++) {
+        if (memo->entries[i].used) *find_entry(entries, capacity, memo->entries[i].args, arity) = memo->entries[i];
+    }
+    vm_reallocate(vm, memo->entries, sizeof(MemoEntry) * (size_t)memo->capacity, 0);
+    memo->entries = entries;
+    memo->capacity = capacity;
+}
+
+void memo_store(VM* vm, ObjFunction* function, const Value* args, Value result) {
+    MemoTable* memo = function->memo;
+    int arity = function->arity;
+    if (!cacheable(result)) return;
+    for (int i = 0; i < arity; i++) {
+        if (!cacheable(args[i])) return;
+    }
+
+    if (memo->count >= MEMO_ENTRIES_MAX) {
+        // Full: start over rather than track which results are still used
+        memset(memo->entries, 0, sizeof(MemoEntry) * (size_t)memo->capacity);
+        memo->count = 0;
+    } else if ((memo->count + 1) * 2 > memo->capacity) {
+        // At most half full
+        resize_entries(vm, memo, memo->capacity < MEMO_INITIAL_CAPACITY ? MEMO_INITIAL_CAPACITY : memo->capacity * 2, arity);
+    }
+
+    MemoEntry* entry = find_entry(memo->entries, memo->capacity, args, arity);
+    if (!entry->used) {
+        entry->used = true;
+        memcpy(entry->args, args, sizeof(Value) * (size_t)arity);
+        memo->count++;
+    }
+    entry->result = result;
+}
+
+void free_memo(MemoTable* memo) {
+    if (memo == NULL) return;
+    reallocate(memo->entries, sizeof(MemoEntry) * (size_t)memo->capacity, 0);
+    reallocate(memo->callees, sizeof(ObjFunction*) * (size_t)memo->calleeCount, 0);
+    reallocate(memo, sizeof(MemoTable), 0);
+}
@@ -9,21 +9,85 @@
  * for the Determa VM. Allocation is handled through the @ref reallocate()
  * wrapper, which tracks memory usage and triggers collection when needed.
  *
+ * Runtime strings are first bump-allocated in a nursery (young generation);
+ * minor collections copy the survivors into the mark-and-sweep heap above.
+ *
  */
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
+#ifdef _WIN32
+#include <windows.h>
+#include <malloc.h> // _aligned_malloc
+#else
+#include <time.h>
+#endif
 
 #include "vm/memory.h"
 #include "vm/vm.h"
+#include "vm/table.h"
+#include "vm/trace.h"
 #include "vm/compiler.h" // Needed if we want to mark compiler roots later
-
-#define GC_HEAP_GROW_FACTOR 2
+#include "vm/profiler.h"
+#include "vm/alloc_profiler.h"
+#include "vm/jit.h"
+#include "vm/memo.h"
+#include "thread_pool.h"
 
 // Toggle this to see GC logs in the terminal
 // #define DEBUG_LOG_GC
 // #define DEBUG_STRESS_GC
 
+static void maybe_collect(VM* vm);
+
+// ====================
+// Telemetry
+// ====================
+
+uint64_t vm_monotonic_ns(void) {
+#ifdef _WIN32
+    LARGE_INTEGER frequency, counter;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return (uint64_t)((double)counter.QuadPart * 1e9 / (double)frequency.QuadPart);
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+/**
+ * @brief Enter the collector. Entries nest (a minor collection may finish
+ * with a full one); only the outermost is timed as a pause.
+ */
+static uint64_t pause_begin(VM* vm) {
+    if (vm->gcPauseDepth++ > 0) return 0;
+
+    const VmTracer* tracer = vm->tracer;
+    if (tracer != NULL && tracer->gcBegin != NULL) tracer->gcBegin(tracer->user, vm);
+    return vm_monotonic_ns();
+}
+
+static void pause_end(VM* vm, uint64_t start) {
+    if (--vm->gcPauseDepth > 0) return;
+
+    uint64_t pause = vm_monotonic_ns() - start;
+    vm->gcStats.totalPauseNs += pause;
+    if (pause > vm->gcStats.maxPauseNs) vm->gcStats.maxPauseNs = pause;
+
+    const VmTracer* tracer = vm->tracer;
+    if (tracer != NULL && tracer->gcEnd != NULL) tracer->gcEnd(tracer->user, vm, pause);
+}
+
+/**
+ * @brief The threshold for the next collection, from the live heap size.
+ */
+static size_t next_threshold(VM* vm) {
+    return (size_t)((double)vm->bytesAllocated * vm->gcGrowFactor);
+}
+
 /**
  * @brief Reallocation wrapper that tracks memory usage and triggers GC when needed.
  *
@@ -32,22 +96,19 @@
  * allocation counter increases. If GC stress testing is enabled,
  * a collection is triggered before allocating new memory.
  *
+ * @param vm      The VM whose heap the block belongs to.
  * @param pointer The old memory pointer (may be NULL).
  * @param oldSize Size previously allocated for this pointer.
  * @param newSize Requested new size. If 0, memory is freed.
  * @return void* Pointer to newly allocated region, or NULL if freed.
  */
-void* reallocate(void* pointer, size_t oldSize, size_t newSize) {
-    vm.bytesAllocated += newSize - oldSize;
+void* vm_reallocate(VM* vm, void* pointer, size_t oldSize, size_t newSize) {
+    vm->bytesAllocated += newSize - oldSize;
 
     if (newSize > oldSize) {
-        #ifdef DEBUG_STRESS_GC
-        collect_garbage();
-        #endif
-
-        if (vm.bytesAllocated > vm.nextGC) {
-            collect_garbage();
-        }
+        const VmTracer* tracer = vm->tracer;
+        if (tracer != NULL && tracer->grow != NULL) tracer->grow(tracer->user, vm, newSize - oldSize);
+        maybe_collect(vm);
     }
 
     if (newSize == 0) {
@@ -63,6 +124,276 @@ void* reallocate(void* pointer, size_t oldSize, size_t newSize) {
     return result;
 }
 
+void* vm_allocate_deferred(VM* vm, size_t size) {
+    vm->bytesAllocated += size;
+
+    void* result = malloc(size);
+    if (result == NULL) {
+        fprintf(stderr, "Fatal: Out of memory.\n");
+        exit(1);
+    }
+    return result;
+}
+
+void* reallocate(void* pointer, size_t oldSize, size_t newSize) {
+    return vm_reallocate(currentVM, pointer, oldSize, newSize);
+}
+
+// ====================
+// Object pools
+// ====================
+
+#ifndef DETERMA_NO_POOLS
+/**
+ * @brief A zeroed slab header on a POOL_SLAB_SIZE boundary, so a block finds
+ * its slab (and mark bitmap) by masking its address.
+ */
+static PoolSlab* new_slab(void) {
+#ifdef _WIN32
+    PoolSlab* slab = (PoolSlab*)_aligned_malloc(POOL_SLAB_SIZE, POOL_SLAB_SIZE);
+#else
+    void* memory = NULL;
+    PoolSlab* slab = posix_memalign(&memory, POOL_SLAB_SIZE, POOL_SLAB_SIZE) == 0 ? (PoolSlab*)memory : NULL;
+#endif
+    if (slab == NULL) {
+        fprintf(stderr, "Fatal: Out of memory.\n");
+        exit(1);
+    }
+    memset(slab, 0, sizeof(PoolSlab));
+    return slab;
+}
+#endif
+
+/**
+ * @brief Get a block without accounting or collecting (see ObjectPools).
+ */
+static void* pool_alloc(VM* vm, size_t size) {
+    void* block = NULL;
+
+#ifndef DETERMA_NO_POOLS
+    ObjectPools* pools = &vm->pools;
+    size_t index = (size - 1) / POOL_GRANULE;
+    if (pool_serves(size)) {
+        block = pools->freeLists[index];
+        if (block != NULL) {
+            pools->freeLists[index] = *(void**)block;
+            return block;
+        }
+
+        size_t blockSize = (index + 1) * POOL_GRANULE;
+        if ((size_t)(pools->slabEnd - pools->slabTop) < blockSize) {
+            // The tail of the old slab is dropped; at most one block's worth
+            PoolSlab* slab = new_slab();
+            slab->next = pools->slabs;
+            pools->slabs = slab;
+            pools->slabTop = (uint8_t*)slab + POOL_SLAB_FIRST_BLOCK;
+            pools->slabEnd = (uint8_t*)slab + POOL_SLAB_SIZE;
+        }
+        block = pools->slabTop;
+        pools->slabTop += blockSize;
+        return block;
+    }
+#else
+    (void)vm;
+#endif
+
+    block = malloc(size);
+    if (block == NULL) {
+        fprintf(stderr, "Fatal: Out of memory.\n");
+        exit(1);
+    }
+    return block;
+}
+
+static void pool_free(VM* vm, void* block, size_t size) {
+#ifndef DETERMA_NO_POOLS
+    size_t index = (size - 1) / POOL_GRANULE;
+    if (pool_serves(size)) {
+        *(void**)block = vm->pools.freeLists[index];
+        vm->pools.freeLists[index] = block;
+        return;
+    }
+#else
+    (void)vm;
+    (void)size;
+#endif
+    free(block);
+}
+
+void* vm_allocate_object(VM* vm, size_t size) {
+    vm->bytesAllocated += size;
+    maybe_collect(vm);
+    return pool_alloc(vm, size);
+}
+
+void vm_free_object_memory(VM* vm, void* block, size_t size) {
+    vm->bytesAllocated -= size;
+    pool_free(vm, block, size);
+}
+
+/**
+ * @brief Give every slab back to the system (all objects must be gone).
+ */
+static void free_pools(VM* vm) {
+    PoolSlab* slab = vm->pools.slabs;
+    while (slab != NULL) {
+        PoolSlab* next = slab->next;
+#ifdef _WIN32
+        _aligned_free(slab);
+#else
+        free(slab);
+#endif
+        slab = next;
+    }
+    memset(&vm->pools, 0, sizeof(vm->pools));
+}
+
+/**
+ * @brief Unmark every pooled object at once (once a sweep has read them).
+ */
+static void clear_slab_marks(VM* vm) {
+    for (PoolSlab* slab = vm->pools.slabs; slab != NULL; slab = slab->next) {
+        memset(slab->marks, 0, sizeof(slab->marks));
+    }
+}
+
+// ====================
+// Nursery (young generation)
+// ====================
+
+void* vm_allocate_young(VM* vm, size_t size) {
+    Nursery* nursery = &vm->nursery;
+
+    if (nursery->start == NULL) {
+        nursery->start = (uint8_t*)malloc(NURSERY_SIZE);
+        nursery->remembered = (int*)malloc(sizeof(int) * NURSERY_REMEMBERED_MAX);
+        if (nursery->start == NULL || nursery->remembered == NULL) {
+            free(nursery->start);
+            free(nursery->remembered);
+            nursery->start = NULL;
+            nursery->remembered = NULL;
+            return NULL; // Old heap only
+        }
+        nursery->top = nursery->start;
+        nursery->end = nursery->start + NURSERY_SIZE;
+    }
+
+    #ifdef DEBUG_STRESS_GC
+    nursery->full = true; // Minor collection at every safepoint
+    #endif
+
+    if (size > (size_t)(nursery->end - nursery->top)) {
+        nursery->full = true;
+        return NULL;
+    }
+
+    void* block = nursery->top;
+    nursery->top += size;
+    return block;
+}
+
+void vm_unallocate_young(VM* vm, void* block) {
+    vm->nursery.top = (uint8_t*)block;
+}
+
+void vm_remember_global(VM* vm, int slot) {
+    Nursery* nursery = &vm->nursery;
+    if (nursery->rememberAll) return;
+
+    // String-building loops write the same global over and over
+    if (nursery->rememberedCount > 0 && nursery->remembered[nursery->rememberedCount - 1] == slot) return;
+
+    if (nursery->rememberedCount == NURSERY_REMEMBERED_MAX) {
+        nursery->rememberAll = true;
+        return;
+    }
+    nursery->remembered[nursery->rememberedCount++] = slot;
+}
+
+/**
+ * @brief Copy a young string into the old heap (once; later calls return the
+ * same copy through the forwarding pointer).
+ *
+ * Does not go through vm_allocate_object(): a full collection must not
+ * start while the roots are half rewritten.
+ */
+static ObjString* promote_string(VM* vm, ObjString* young) {
+    if (young->obj.next != NULL) return (ObjString*)young->obj.next;
+
+    size_t size = string_object_size(young->length);
+    ObjString* string = (ObjString*)pool_alloc(vm, size);
+    char* chars = (char*)(string + 1);
+    memcpy(chars, young->chars, (size_t)young->length + 1);
+    vm->bytesAllocated += size; // as free_object() expects
+
+    string->obj.type = OBJ_STRING;
+    string->obj.isMarked = false;
+    string->obj.isYoung = false;
+    string->obj.isPooled = pool_serves(size);
+    object_set_marked(&string->obj, vm->gcPhase == GC_MARK); // Allocated black mid-cycle
+    string->obj.next = vm->objects;
+    vm->objects = (Obj*)string;
+    string->length = young->length;
+    string->hash = young->hash;
+    string->chars = chars;
+
+    young->obj.next = (Obj*)string;
+    return string;
+}
+
+static void promote_value(VM* vm, Value* slot) {
+    if (IS_OBJ(*slot) && AS_OBJ(*slot)->isYoung) {
+        *slot = OBJ_VAL(promote_string(vm, (ObjString*)AS_OBJ(*slot)));
+    }
+}
+
+void vm_collect_nursery(VM* vm) {
+    Nursery* nursery = &vm->nursery;
+    nursery->full = false;
+    if (nursery->start == NULL) return;
+
+    uint64_t start = pause_begin(vm);
+    size_t oldBytes = vm->bytesAllocated;
+    vm->gcStats.minorCollections++;
+
+#ifdef DEBUG_LOG_GC
+    printf("-- minor gc: %zu young bytes --\n", (size_t)(nursery->top - nursery->start));
+#endif
+
+    // 1. Promote whatever the roots still reference
+    for (Value* slot = vm->stack; slot < vm->stackTop; slot++) {
+        promote_value(vm, slot);
+    }
+    if (nursery->rememberAll) {
+        for (int i = 0; i < vm->globalLimit; i++) promote_value(vm, &vm->globals[i]);
+    } else {
+        for (int i = 0; i < nursery->rememberedCount; i++) {
+            promote_value(vm, &vm->globals[nursery->remembered[i]]);
+        }
+    }
+
+    // 2. Point the intern table at the promoted copies and drop the dead
+    for (uint8_t* p = nursery->start; p < nursery->top; ) {
+        ObjString* young = (ObjString*)p;
+        if (young->obj.next != NULL) {
+            table_replace_key(&vm->strings, young, (ObjString*)young->obj.next);
+        } else {
+            table_delete(&vm->strings, young);
+        }
+        p += young_string_size(young->length);
+    }
+
+    // 3. Everything left in the region is garbage
+    nursery->top = nursery->start;
+    nursery->rememberedCount = 0;
+    nursery->rememberAll = false;
+    vm->gcStats.bytesPromoted += vm->bytesAllocated - oldBytes;
+
+    // Promotion bypassed reallocate()'s threshold check
+    maybe_collect(vm);
+    pause_end(vm, start);
+}
+
 /**
  * @brief Mark a heap object and enqueue it into the gray stack.
  *
@@ -72,9 +403,10 @@ void* reallocate(void* pointer, size_t oldSize, size_t newSize) {
  *
  * @param object Pointer to the object to mark.
  */
-void mark_object(Obj* object) {
+static void mark_object_in(VM* vm, Obj* object) {
     if (object == NULL) return;
-    if (object->isMarked) return;
+    if (object->isYoung) return; // Owned by the nursery: never swept
+    if (object_is_marked(object)) return;
 
 #ifdef DEBUG_LOG_GC
     printf("%p mark ", (void*)object);
@@ -82,16 +414,16 @@ void mark_object(Obj* object) {
     printf("\n");
 #endif
 
-    object->isMarked = true;
+    object_set_marked(object, true);
 
     // Add to gray stack
-    if (vm.grayCapacity < vm.grayCount + 1) {
-        vm.grayCapacity = (vm.grayCapacity < 8) ? 8 : vm.grayCapacity * 2;
-        vm.grayStack = (Obj**)realloc(vm.grayStack, sizeof(Obj*) * vm.grayCapacity);
-        if (vm.grayStack == NULL) exit(1);
+    if (vm->grayCapacity < vm->grayCount + 1) {
+        vm->grayCapacity = (vm->grayCapacity < 8) ? 8 : vm->grayCapacity * 2;
+        vm->grayStack = (Obj**)realloc(vm->grayStack, sizeof(Obj*) * vm->grayCapacity);
+        if (vm->grayStack == NULL) exit(1);
     }
 
-    vm.grayStack[vm.grayCount++] = object;
+    vm->grayStack[vm->grayCount++] = object;
 }
 
 /**
@@ -99,8 +431,17 @@ void mark_object(Obj* object) {
  *
  * @param value The value to mark.
  */
+static void mark_value_in(VM* vm, Value value) {
+    if (IS_OBJ(value)) mark_object_in(vm, AS_OBJ(value));
+}
+
+// Marking from outside the collector (compiler roots) targets the current VM
+void mark_object(Obj* object) {
+    mark_object_in(currentVM, object);
+}
+
 void mark_value(Value value) {
-    if (IS_OBJ(value)) mark_object(AS_OBJ(value));
+    mark_value_in(currentVM, value);
 }
 
 /**
@@ -108,70 +449,121 @@ void mark_value(Value value) {
  * 
  * @param array 
  */
-void mark_array(ValueArray* array) {
+static void mark_array_in(VM* vm, ValueArray* array) {
     for (int i = 0; i < array->count; i++) {
-        mark_value(array->values[i]);
+        mark_value_in(vm, array->values[i]);
     }
 }
 
+void mark_array(ValueArray* array) {
+    mark_array_in(currentVM, array);
+}
+
+
+/**
+ * @brief Mark the roots the program can change without a write barrier:
+ * stack values, running functions and (when GC runs during compile) the
+ * compiler's functions. Cheap enough to rescan when marking finishes.
+ */
+static void mark_stack_roots(VM* vm) {
+    // Mark Stack values
+    for (Value* slot = vm->stack; slot < vm->stackTop; slot++) {
+        mark_value_in(vm, *slot);
+    }
+    // Mark Call Frames (The functions currently running)
+    for (int i = 0; i < vm->frameCount; i++) {
+        mark_object_in(vm, (Obj*)vm->frames[i].function);
+    }
+
+    // Profiled functions stay alive, so their records stay unambiguous
+    if (vm->profiler != NULL) {
+        for (int i = 0; i < vm->profiler->functionCount; i++) {
+            mark_object_in(vm, (Obj*)vm->profiler->functions[i].function);
+        }
+    }
+    if (vm->allocProfiler != NULL) {
+        for (int i = 1; i < vm->allocProfiler->siteCount; i++) {
+            mark_object_in(vm, (Obj*)vm->allocProfiler->sites[i].function);
+        }
+    }
+
+    // Mark Compiler roots. The compiler is per thread and allocates into
+    // the current VM only.
+    if (vm == currentVM) mark_compiler_roots();
+}
 
 /**
  * @brief Mark all GC root references.
  *
  * This includes:
- * - Stack values
+ * - Stack values and call frames
  * - Globals
  * - (Optionally) compiler roots
  *
  * These objects will become starting points for reachability.
  */
-static void mark_roots() {
-    // Mark Stack values
-    for (Value* slot = vm.stack; slot < vm.stackTop; slot++) {
-        mark_value(*slot);
-    }
-    // Mark Call Frames (The functions currently running)
-    for (int i = 0; i < vm.frameCount; i++) {
-        mark_object((Obj*)vm.frames[i].function);
+static void mark_roots(VM* vm) {
+    mark_stack_roots(vm);
+
+    // Mark Global variables (the slots ever bound)
+    for (int i = 0; i < vm->globalLimit; i++) {
+        mark_value_in(vm, vm->globals[i]);
     }
+}
+
+/**
+ * @brief Call `visit` on every object `object` refers to (NULL included).
+ * The serial and the parallel tracer share it.
+ */
+static inline void visit_references(Obj* object, void (*visit)(void* context, Obj* child), void* context) {
+    switch (object->type) {
+        case OBJ_STRING:
+            // Strings have no outgoing references.
+            break;
+
+        case OBJ_ROPE: {
+            ObjRope* rope = (ObjRope*)object;
+            visit(context, (Obj*)rope->left);
+            visit(context, (Obj*)rope->right);
+            break;
+        }
+
+            // mark the func's name and all constants in its chunk (block)
+        case OBJ_FUNCTION: {
+            ObjFunction* function = (ObjFunction*)object;
+            visit(context, (Obj*)function->name);
+            ValueArray* constants = &function->chunk.constants;
+            for (int i = 0; i < constants->count; i++) {
+                if (IS_OBJ(constants->values[i])) visit(context, AS_OBJ(constants->values[i]));
+            }
+            break;
+        }
 
-    // Mark Global variables
-    for (int i = 0; i < GLOBALS_MAX; i++) {
-        mark_value(vm.globals[i]);
+        case OBJ_NATIVE:
+            visit(context, (Obj*)((ObjNative*)object)->name);
+            break;
     }
+}
 
-    // Mark Compiler roots (when GC runs during compile)
-    mark_compiler_roots();
+static void mark_child(void* vm, Obj* child) {
+    mark_object_in((VM*)vm, child);
 }
 
 /**
  * @brief Process a single object from the gray stack.
  *
  * This function is responsible for recursively marking referenced objects.
- * For now only strings exist, which have no inner references.
  *
  * @param object The object to process.
  */
-static void blacken_object(Obj* object) {
+static void blacken_object(VM* vm, Obj* object) {
 #ifdef DEBUG_LOG_GC
     printf("%p blacken ", (void*)object);
     print_value(OBJ_VAL(object));
     printf("\n");
 #endif
 
-    switch (object->type) {
-        case OBJ_STRING:
-            // Strings have no outgoing references.
-            break;
-
-            // mark the func's name and all constants in its chunk (block)
-        case OBJ_FUNCTION: {
-            ObjFunction* function = (ObjFunction*)object;
-            mark_object((Obj*)function->name);
-            mark_array(&function->chunk.constants);
-            break;
-        }
-    }
+    visit_references(object, mark_child, vm);
 }
 
 /**
@@ -180,27 +572,250 @@ static void blacken_object(Obj* object) {
  * Repeatedly removes objects from the gray stack and blackens them
  * until no gray objects remain.
  */
-static void trace_references() {
-    while (vm.grayCount > 0) {
-        Obj* object = vm.grayStack[--vm.grayCount];
-        blacken_object(object);
+static void trace_references(VM* vm) {
+    while (vm->grayCount > 0) {
+        Obj* object = vm->grayStack[--vm->grayCount];
+        blacken_object(vm, object);
     }
 }
 
+// ====================
+// Parallel marking
+// ====================
+//
+// With gcThreads > 1, a full collection traces on a thread pool once the
+// roots are gray. Every marker owns a private gray stack and a shared one
+// the others steal from; it moves half of its private stack over whenever
+// its shared one has run dry. Claiming an object is an atomic exchange on
+// its mark bit, so each object is blackened by exactly one marker. The
+// roots, the weak intern table and the sweep stay on the collecting thread.
+
+#ifndef DETERMA_NO_PARALLEL_GC
+
+#define GC_PARALLEL_MIN_GRAY 1024 // Fewer gray objects after the roots: trace serially
+#define GC_SHARE_MIN 64           // A marker shares work once it holds this many
+
+/**
+ * @struct Marker
+ * @brief One marking thread's gray objects.
+ */
+typedef struct {
+    Obj** items;          // Private gray stack: only the owner touches it
+    int count;
+    int capacity;
+    Obj** shared;         // Stealable gray objects, guarded by `lock`
+    int sharedCount;      // Also read without the lock, to skip empty markers
+    int sharedCapacity;
+    bool lock;
+    long delta;           // Grayed minus blackened, not yet added to `pending`
+    char padding[64];     // Keep markers off each other's cache lines
+} Marker;
+
+typedef struct {
+    Marker* markers;
+    int count;
+    long pending;         // Gray objects not blackened yet, summed over the markers' deltas
+} ParallelMark;
+
+static void marker_lock(Marker* marker) {
+    while (__atomic_test_and_set(&marker->lock, __ATOMIC_ACQUIRE)) thread_pool_yield();
+}
+
+static void marker_unlock(Marker* marker) {
+    __atomic_clear(&marker->lock, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Grow `*items` to hold at least `needed` objects.
+ */
+static void reserve_gray(Obj*** items, int* capacity, int needed) {
+    if (*capacity >= needed) return;
+    int grown = *capacity < 8 ? 8 : *capacity * 2;
+    *capacity = grown < needed ? needed : grown;
+    *items = (Obj**)realloc(*items, sizeof(Obj*) * (size_t)*capacity);
+    if (*items == NULL) exit(1);
+}
+
+/**
+ * @brief Set `object`'s mark bit; false if it was set already (by another
+ * marker too: neighbours in a slab share bitmap bytes).
+ */
+static bool claim_mark(Obj* object) {
+    if (!object->isPooled) {
+        if (__atomic_load_n(&object->isMarked, __ATOMIC_RELAXED)) return false;
+        return !__atomic_exchange_n(&object->isMarked, true, __ATOMIC_RELAXED);
+    }
+    uint8_t bit;
+    uint8_t* byte = object_mark_byte(object, &bit);
+    if (__atomic_load_n(byte, __ATOMIC_RELAXED) & bit) return false;
+    return (__atomic_fetch_or(byte, bit, __ATOMIC_RELAXED) & bit) == 0;
+}
+
+static void mark_child_parallel(void* context, Obj* child) {
+    if (child == NULL || child->isYoung) return;
+    if (!claim_mark(child)) return;
+
+    Marker* marker = (Marker*)context;
+    reserve_gray(&marker->items, &marker->capacity, marker->count + 1);
+    marker->items[marker->count++] = child;
+    marker->delta++;
+}
+
+/**
+ * @brief Move the top half of `marker`'s private stack to its shared one.
+ */
+static void share_work(Marker* marker) {
+    int half = marker->count / 2;
+    marker_lock(marker);
+    reserve_gray(&marker->shared, &marker->sharedCapacity, half);
+    memcpy(marker->shared, marker->items + marker->count - half, sizeof(Obj*) * (size_t)half);
+    __atomic_store_n(&marker->sharedCount, half, __ATOMIC_RELAXED);
+    marker_unlock(marker);
+    marker->count -= half;
+}
+
+/**
+ * @brief Move shared work into `thief`'s (empty) private stack: all of its
+ * own shared stack, else half of the first other non-empty one.
+ */
+static bool steal_gray(ParallelMark* mark, int thief) {
+    Marker* self = &mark->markers[thief];
+    for (int i = 0; i < mark->count; i++) {
+        Marker* victim = &mark->markers[(thief + i) % mark->count];
+        if (__atomic_load_n(&victim->sharedCount, __ATOMIC_RELAXED) == 0) continue;
+
+        marker_lock(victim);
+        int available = victim->sharedCount;
+        int taken = victim == self ? available : (available + 1) / 2;
+        if (taken > 0) {
+            reserve_gray(&self->items, &self->capacity, taken);
+            memcpy(self->items, victim->shared + available - taken, sizeof(Obj*) * (size_t)taken);
+            self->count = taken;
+            __atomic_store_n(&victim->sharedCount, available - taken, __ATOMIC_RELAXED);
+        }
+        marker_unlock(victim);
+        if (taken > 0) return true;
+    }
+    return false;
+}
+
+/**
+ * @brief Pool task: trace with marker `index` until no gray object is left
+ * anywhere.
+ *
+ * A marker only stops with nothing of its own: its private stack is empty
+ * and so is its shared one, or it would have taken that back. Everything
+ * still gray is then in a running marker's hands or stealable, so stopping
+ * once `pending` reads 0 never strands work (and markers that stop early,
+ * between another's steal and its flush, only lose parallelism).
+ */
+static void mark_task(void* context, int index, int worker) {
+    (void)worker;
+    ParallelMark* mark = (ParallelMark*)context;
+    Marker* self = &mark->markers[index];
+
+    for (;;) {
+        while (self->count > 0) {
+            Obj* object = self->items[--self->count];
+            visit_references(object, mark_child_parallel, self);
+            self->delta--;
+            if (self->count >= GC_SHARE_MIN && __atomic_load_n(&self->sharedCount, __ATOMIC_RELAXED) == 0) {
+                share_work(self);
+            }
+        }
+
+        if (self->delta != 0) {
+            __atomic_add_fetch(&mark->pending, self->delta, __ATOMIC_ACQ_REL);
+            self->delta = 0;
+        }
+        if (steal_gray(mark, index)) continue;
+        if (__atomic_load_n(&mark->pending, __ATOMIC_ACQUIRE) == 0) return;
+        thread_pool_yield();
+    }
+}
+
+/**
+ * @brief Trace the gray stack on vm->gcPool.
+ *
+ * @return false (nothing traced) when marking should stay serial: one
+ *         thread configured, too little gray work, or no pool.
+ */
+static bool trace_parallel(VM* vm) {
+    if (vm->gcThreads <= 1 || vm->grayCount < GC_PARALLEL_MIN_GRAY) return false;
+    if (vm->gcPool != NULL && thread_pool_size(vm->gcPool) != vm->gcThreads) {
+        thread_pool_free(vm->gcPool); // Re-initialized with another thread count
+        vm->gcPool = NULL;
+    }
+    if (vm->gcPool == NULL) vm->gcPool = thread_pool_new(vm->gcThreads);
+    if (vm->gcPool == NULL || thread_pool_size(vm->gcPool) < 2) return false;
+
+    ParallelMark mark;
+    mark.count = thread_pool_size(vm->gcPool);
+    mark.markers = (Marker*)calloc((size_t)mark.count, sizeof(Marker));
+    if (mark.markers == NULL) return false;
+    mark.pending = vm->grayCount;
+
+    // The roots go to the shared stacks, so markers that start late lose nothing
+    for (int i = 0; i < mark.count; i++) {
+        Marker* marker = &mark.markers[i];
+        int from = (int)((long long)vm->grayCount * i / mark.count);
+        int to = (int)((long long)vm->grayCount * (i + 1) / mark.count);
+        reserve_gray(&marker->shared, &marker->sharedCapacity, to - from);
+        memcpy(marker->shared, vm->grayStack + from, sizeof(Obj*) * (size_t)(to - from));
+        marker->sharedCount = to - from;
+    }
+    vm->grayCount = 0;
+
+    thread_pool_run(vm->gcPool, mark.count, mark_task, &mark);
+
+    for (int i = 0; i < mark.count; i++) {
+        free(mark.markers[i].items);
+        free(mark.markers[i].shared);
+    }
+    free(mark.markers);
+    vm->gcStats.parallelMarks++;
+    return true;
+}
+
+#else
+
+static bool trace_parallel(VM* vm) {
+    (void)vm;
+    return false;
+}
+
+#endif // DETERMA_NO_PARALLEL_GC
+
+/**
+ * @brief Take `object` off the heap list it was unlinked from and free it.
+ */
+static void free_unreached(VM* vm, Obj* unreached) {
+#ifdef DEBUG_LOG_GC
+    printf("%p free ", (void*)unreached);
+    print_value(OBJ_VAL(unreached));
+    printf("\n");
+#endif
+
+    size_t before = vm->bytesAllocated;
+    free_object(unreached);
+    vm->gcStats.bytesFreed += before - vm->bytesAllocated;
+    vm->gcStats.objectsFreed++;
+}
+
 /**
  * @brief Sweep through the heap and free all unmarked objects.
  *
  * Objects that remain unmarked after tracing are unreachable
  * and are therefore freed. Surviving objects are unmarked
- * for the next GC cycle.
+ * for the next GC cycle (pooled ones all at once, afterwards).
  */
-static void sweep() {
+static void sweep(VM* vm) {
     Obj* previous = NULL;
-    Obj* object = vm.objects;
+    Obj* object = vm->objects;
 
     while (object != NULL) {
-        if (object->isMarked) {
-            object->isMarked = false;
+        if (object_is_marked(object)) {
+            if (!object->isPooled) object->isMarked = false;
             previous = object;
             object = object->next;
         } else {
@@ -210,18 +825,222 @@ static void sweep() {
             if (previous != NULL) {
                 previous->next = object;
             } else {
-                vm.objects = object;
+                vm->objects = object;
             }
 
+            free_unreached(vm, unreached);
+        }
+    }
+    clear_slab_marks(vm);
+}
+
+// ====================
+// Incremental collection
+// ====================
+//
+// Tri-color invariant: no marked (black) object points at an unmarked
+// (white) one. Objects allocated during GC_MARK start out marked, and
+// every store that could break the invariant goes through
+// vm_write_barrier(): globals (OP_SET_GLOBAL), constant tables
+// (add_constant) and strings handed back by the weak intern table. Stack
+// slots and locals need no barrier; the stack is simply scanned again,
+// in one go, when marking finishes.
+
+#define GC_GLOBALS_PER_STEP 256 // Global slots scanned per unit of budget
+#define GC_LAZY_SWEEP_BATCH 128 // Objects a lazy sweep visits per allocation
+
+/**
+ * @brief Start a cycle: shade the stack roots; globals follow in slices.
+ */
+static void begin_cycle(VM* vm) {
+#ifdef DEBUG_LOG_GC
+    printf("-- gc cycle begin --\n");
+#endif
+    vm->gcPhase = GC_MARK;
+    vm->gcGlobalCursor = 0;
+    mark_stack_roots(vm);
+}
+
+/**
+ * @brief Detach the heap list for sweeping. Objects allocated from now on
+ * go to a fresh `objects` list, unmarked, and are left alone by this sweep.
+ */
+static void begin_sweep(VM* vm) {
+    vm->gcPhase = GC_SWEEP;
+    vm->sweepCursor = vm->objects;
+    vm->objects = NULL;
+    vm->sweepSurvivors = NULL;
+    vm->sweepSurvivorsTail = NULL;
+}
+
+/**
+ * @brief Marking is done once the gray stack is empty after rescanning the
+ * stack roots (in one go: that is the only atomic part of a cycle).
+ */
+static void finish_mark(VM* vm) {
+    mark_stack_roots(vm);
+    trace_references(vm);
+    table_remove_white(&vm->strings); // Interned strings are weak references
+    begin_sweep(vm);
+}
+
+/**
+ * @brief Sweep one object off the detached list.
+ */
+static void sweep_one(VM* vm) {
+    Obj* object = vm->sweepCursor;
+    vm->sweepCursor = object->next;
+
+    if (!object_is_marked(object)) {
+        free_unreached(vm, object);
+        return;
+    }
+
+    if (!object->isPooled) object->isMarked = false; // Pooled ones: clear_slab_marks()
+    object->next = NULL;
+    if (vm->sweepSurvivorsTail != NULL) {
+        vm->sweepSurvivorsTail->next = object;
+    } else {
+        vm->sweepSurvivors = object;
+    }
+    vm->sweepSurvivorsTail = object;
+}
+
+/**
+ * @brief Put the survivors back in front of whatever was allocated during
+ * the sweep and end the cycle.
+ */
+static void finish_sweep(VM* vm) {
+    while (vm->sweepCursor != NULL) sweep_one(vm);
+    clear_slab_marks(vm);
+
+    if (vm->sweepSurvivorsTail != NULL) {
+        vm->sweepSurvivorsTail->next = vm->objects;
+        vm->objects = vm->sweepSurvivors;
+    }
+    vm->sweepSurvivors = NULL;
+    vm->sweepSurvivorsTail = NULL;
+    vm->gcPhase = GC_IDLE;
+    vm->nextGC = next_threshold(vm);
+    vm->gcStats.collections++;
+
 #ifdef DEBUG_LOG_GC
-            printf("%p free ", (void*)unreached);
-            print_value(OBJ_VAL(unreached));
-            printf("\n");
+    printf("-- gc cycle end -- next at %zu\n", vm->nextGC);
 #endif
+}
+
+/**
+ * @brief Sweep the next GC_LAZY_SWEEP_BATCH objects left by a whole
+ * collection (see collect_whole()), and end the cycle after the last.
+ */
+static void sweep_lazily(VM* vm) {
+    // Freed blocks are accounted through reallocate(), i.e. the current VM
+    VM* previous = use_vm(vm);
+    uint64_t start = pause_begin(vm);
+    vm->gcStats.lazySweeps++;
+
+    for (int i = 0; i < GC_LAZY_SWEEP_BATCH && vm->sweepCursor != NULL; i++) sweep_one(vm);
+    if (vm->sweepCursor == NULL) finish_sweep(vm);
+
+    pause_end(vm, start);
+    use_vm(previous);
+}
+
+static void collect_whole(VM* vm, bool lazySweep);
+
+/**
+ * @brief Collect if the heap is due: a whole collection, or one more slice
+ * of the current incremental cycle or lazy sweep.
+ */
+static void maybe_collect(VM* vm) {
+    if (vm->bytesAllocated > vm->gcStats.peakBytesAllocated) {
+        vm->gcStats.peakBytesAllocated = vm->bytesAllocated;
+    }
+
+    if (vm->gcStepBudget > 0) {
+        #ifndef DEBUG_STRESS_GC
+        if (vm->gcPhase == GC_IDLE && vm->bytesAllocated <= vm->nextGC) return;
+        #endif
+        vm_collect_step(vm);
+        return;
+    }
+
+    #ifdef DEBUG_STRESS_GC
+    vm_collect_garbage(vm);
+    #endif
+
+    // The heap still holds what the sweep has not reached: no threshold yet
+    if (vm->gcPhase == GC_SWEEP) {
+        sweep_lazily(vm);
+        return;
+    }
+
+    if (vm->bytesAllocated > vm->nextGC) {
+        collect_whole(vm, true);
+    }
+}
+
+void vm_collect_step(VM* vm) {
+    // Freed blocks are accounted through reallocate(), i.e. the current VM
+    VM* previous = use_vm(vm);
+    uint64_t start = pause_begin(vm);
+    vm->gcStats.slices++;
+
+    if (vm->gcPhase == GC_IDLE) begin_cycle(vm);
+
+    int budget = vm->gcStepBudget > 0 ? vm->gcStepBudget : 1;
+    while (budget-- > 0) {
+        if (vm->gcPhase == GC_MARK) {
+            if (vm->gcGlobalCursor < vm->globalLimit) {
+                int end = vm->gcGlobalCursor + GC_GLOBALS_PER_STEP;
+                if (end > vm->globalLimit) end = vm->globalLimit;
+                for (int i = vm->gcGlobalCursor; i < end; i++) {
+                    mark_value_in(vm, vm->globals[i]);
+                }
+                vm->gcGlobalCursor = end;
+            } else if (vm->grayCount > 0) {
+                blacken_object(vm, vm->grayStack[--vm->grayCount]);
+            } else {
+                finish_mark(vm);
+            }
+        } else if (vm->sweepCursor != NULL) {
+            sweep_one(vm);
+        } else {
+            finish_sweep(vm);
+            break;
+        }
+    }
+
+    pause_end(vm, start);
+    use_vm(previous);
+}
 
-            free_object(unreached);
+void vm_write_barrier(VM* vm, Value value) {
+    if (vm->gcPhase == GC_MARK) mark_value_in(vm, value);
+}
+
+void vm_free_objects(VM* vm) {
+    Obj* lists[] = { vm->objects, vm->sweepCursor, vm->sweepSurvivors };
+    for (int i = 0; i < 3; i++) {
+        Obj* object = lists[i];
+        while (object != NULL) {
+            Obj* next = object->next;
+            if (object->isPooled && object->type == OBJ_STRING) {
+                // Nothing outside its block, and free_pools() takes the slab
+                vm->bytesAllocated -= string_object_size(((ObjString*)object)->length);
+            } else {
+                free_object(object); // Calls memory.c's free_object
+            }
+            object = next;
         }
     }
+    vm->objects = NULL;
+    vm->sweepCursor = NULL;
+    vm->sweepSurvivors = NULL;
+    vm->sweepSurvivorsTail = NULL;
+    vm->gcPhase = GC_IDLE;
+    vm->grayCount = 0;
+    free_pools(vm);
 }
 
 /**
@@ -229,27 +1048,64 @@ static void sweep() {
  *
  * Steps:
  * 1. Mark roots.
- * 2. Trace reachable references.
- * 3. Sweep unreachable objects.
- * 4. Recalculate next GC threshold.
+ * 2. Trace reachable references (on vm->gcThreads threads, see above).
+ * 3. Sweep unreachable objects: now, or (`lazySweep`, for collections an
+ *    allocation started) a batch per allocation from then on.
+ * 4. Recalculate next GC threshold (once the sweep is done).
+ *
+ * An incremental cycle in progress is not reused: whatever it allocated
+ * black mid-cycle may be garbage by now, and a full collection is exact.
  */
-void collect_garbage() {
+static void collect_whole(VM* vm, bool lazySweep) {
+    // Freed blocks are accounted through reallocate(), i.e. the current VM
+    VM* previous = use_vm(vm);
+    uint64_t start = pause_begin(vm);
+
 #ifdef DEBUG_LOG_GC
     printf("-- gc begin --\n");
-    size_t before = vm.bytesAllocated;
+    size_t before = vm->bytesAllocated;
 #endif
 
-    mark_roots();
-    trace_references();
-    sweep();
+    if (vm->gcPhase == GC_SWEEP) finish_sweep(vm);
+    if (vm->gcPhase == GC_MARK) {
+        for (Obj* object = vm->objects; object != NULL; object = object->next) {
+            if (!object->isPooled) object->isMarked = false;
+        }
+        clear_slab_marks(vm);
+        vm->grayCount = 0;
+    }
 
-    vm.nextGC = vm.bytesAllocated * GC_HEAP_GROW_FACTOR;
+    mark_roots(vm);
+    if (!trace_parallel(vm)) trace_references(vm);
+    table_remove_white(&vm->strings); // Interned strings are weak references
+    if (lazySweep) {
+        begin_sweep(vm); // finish_sweep() counts the collection
+        pause_end(vm, start);
+        use_vm(previous);
+        return;
+    }
+    sweep(vm);
+    vm->gcPhase = GC_IDLE;
+
+    vm->nextGC = next_threshold(vm);
+    vm->gcStats.collections++;
 
 #ifdef DEBUG_LOG_GC
     printf("-- gc end --\n");
     printf("   collected %zu bytes (from %zu to %zu) next at %zu\n",
-           before - vm.bytesAllocated, before, vm.bytesAllocated, vm.nextGC);
+           before - vm->bytesAllocated, before, vm->bytesAllocated, vm->nextGC);
 #endif
+
+    pause_end(vm, start);
+    use_vm(previous);
+}
+
+void vm_collect_garbage(VM* vm) {
+    collect_whole(vm, false);
+}
+
+void collect_garbage(void) {
+    vm_collect_garbage(currentVM);
 }
 
 /**
@@ -268,22 +1124,32 @@ void free_object(Obj* object) {
     switch (object->type) {
         case OBJ_STRING: {
             ObjString* string = (ObjString*)object;
-            
-            // Calculate size to subtract from tracker
-            // size_t size = sizeof(ObjString) + string->length + 1;
-            
-            // NEW: Use reallocate to free so accounting matches allocation
-            reallocate(string->chars, string->length + 1, 0);
-            reallocate(string, sizeof(ObjString), 0);
+            // Characters are inline: one block
+            vm_free_object_memory(currentVM, string, string_object_size(string->length));
+            break;
+        }
+
+        case OBJ_ROPE: {
+            ObjRope* rope = (ObjRope*)object;
+            if (rope->string.chars != NULL) {
+                vm_reallocate(currentVM, rope->string.chars, (size_t)rope->string.length + 1, 0);
+            }
+            vm_free_object_memory(currentVM, rope, sizeof(ObjRope));
             break;
         }
 
         case OBJ_FUNCTION: {
             ObjFunction* fn = (ObjFunction*)object;
             free_chunk(&fn->chunk);
-            free(fn);
+            jit_free(fn->jit);
+            free_memo(fn->memo);
+            vm_free_object_memory(currentVM, fn, sizeof(ObjFunction));
             break;
         }
 
+        case OBJ_NATIVE:
+            vm_free_object_memory(currentVM, object, sizeof(ObjNative));
+            break;
+
     }
 }
\ No newline at end of file
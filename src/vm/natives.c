@@ -0,0 +1,87 @@
+/**
+ * @file natives.c
+ * @brief Native function registration and the built-in natives.
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "vm/natives.h"
+#include "vm/compiler.h"
+#include "vm/memory.h"
+#include "vm/object.h"
+#include "typechecker.h"
+
+bool vm_define_native(VM* vm, const char* name, int arity, DataType returnType, NativeFn fn) {
+    int length = (int)strlen(name);
+    int slot = compiler_define_global(name, length);
+    if (slot < 0) return false;
+
+    // Objects are allocated into the current VM: select `vm` for the
+    // duration, keeping the name and the native rooted on its stack
+    VM* previous = use_vm(vm);
+    vm_push(vm, OBJ_VAL(copy_string(name, length)));
+    ObjNative* native = new_native(fn, arity, AS_STRING(vm_peek(vm, 0)));
+    vm_push(vm, OBJ_VAL(native));
+
+    vm->globals[slot] = OBJ_VAL(native);
+    if (vm->gcPhase == GC_MARK) vm_write_barrier(vm, OBJ_VAL(native));
+
+    vm_pop(vm);
+    vm_pop(vm);
+    use_vm(previous);
+
+    typechecker_declare_function(name, length, returnType);
+    return true;
+}
+
+// --- Built-ins ---
+
+static bool native_clock(VM* vm, int argCount, Value* args, Value* result) {
+    (void)argCount;
+    (void)args;
+    uint64_t micros = (vm_monotonic_ns() - vm->startTime) / 1000;
+    *result = INT_VAL((int)(micros & INT32_MAX));
+    return true;
+}
+
+static int clamp_stat(uint64_t value) {
+    return value > INT32_MAX ? INT32_MAX : (int)value;
+}
+
+static bool native_gc_stat(VM* vm, int argCount, Value* args, Value* result) {
+    (void)argCount;
+    if (!IS_STRING(args[0])) {
+        vm_runtime_error(vm, "gc_stat() expects a string.");
+        return false;
+    }
+
+    const char* key = AS_CSTRING(args[0]);
+    const GcStats* stats = &vm->gcStats;
+    uint64_t value;
+
+    if (strcmp(key, "collections") == 0)         value = stats->collections;
+    else if (strcmp(key, "minor") == 0)          value = stats->minorCollections;
+    else if (strcmp(key, "slices") == 0)         value = stats->slices;
+    else if (strcmp(key, "pause_us") == 0)       value = stats->totalPauseNs / 1000;
+    else if (strcmp(key, "max_pause_us") == 0)   value = stats->maxPauseNs / 1000;
+    else if (strcmp(key, "freed_bytes") == 0)    value = stats->bytesFreed;
+    else if (strcmp(key, "freed_objects") == 0)  value = stats->objectsFreed;
+    else if (strcmp(key, "promoted_bytes") == 0) value = stats->bytesPromoted;
+    else if (strcmp(key, "peak_bytes") == 0)     value = stats->peakBytesAllocated;
+    else if (strcmp(key, "heap_bytes") == 0)     value = vm->bytesAllocated;
+    else if (strcmp(key, "parallel_marks") == 0) value = stats->parallelMarks;
+    else if (strcmp(key, "lazy_sweeps") == 0)    value = stats->lazySweeps;
+    else {
+        vm_runtime_error(vm, "Unknown gc_stat '%s'.", key);
+        return false;
+    }
+
+    *result = INT_VAL(clamp_stat(value));
+    return true;
+}
+
+void vm_define_core_natives(VM* vm) {
+    vm_define_native(vm, "clock", 0, TYPE_INT, native_clock);
+    vm_define_native(vm, "gc_stat", 1, TYPE_INT, native_gc_stat);
+}
@@ -17,6 +17,9 @@
 #include "vm/value.h"
 #include "vm/vm.h"
 #include "vm/memory.h" 
+#include "vm/table.h"
+#include "vm/trace.h"
+#include "vm/memo.h"
 
 
 // Macro to allocate memory using the GC tracker
@@ -32,13 +35,18 @@
 
 static Obj* allocate_object(size_t size, ObjType type) {
     // Use the GC-aware reallocate to get memory
-    Obj* object = (Obj*)reallocate(NULL, 0, size);
+    VM* vm = currentVM;
+    Obj* object = (Obj*)vm_allocate_object(vm, size);
     
     object->type = type;
-    object->isMarked = false; // --- NEW: Initialize mark
+    object->isMarked = false;
+    object->isYoung = false;
+    object->isPooled = pool_serves(size);
+    object_set_marked(object, vm->gcPhase == GC_MARK); // Allocated black mid-cycle
 
-    object->next = vm.objects;
-    vm.objects = object;
+    object->next = vm->objects;
+    vm->objects = object;
+    vm_trace_allocation(vm, type, size);
 
     #ifdef DEBUG_LOG_GC
     printf("%p allocate %zu for %d\n", (void*)object, size, type);
@@ -48,40 +56,160 @@ static Obj* allocate_object(size_t size, ObjType type) {
 }
 
 /**
- * @brief Function to allocate memory from the heap for string characters
+ * @brief Function to allocate a string object, its characters inline in the
+ * same block, and intern it
  * 
- * @param chars 
+ * @param chars Characters to copy in (need not be NUL-terminated)
  * @param length 
  * @return ObjString* 
  */
-static ObjString* allocate_string(char* chars, int length) {
-    ObjString* string = ALLOCATE_OBJ(ObjString, OBJ_STRING);
+static ObjString* allocate_string(const char* chars, int length, uint32_t hash) {
+    ObjString* string = (ObjString*)allocate_object(string_object_size(length), OBJ_STRING);
     string->length = length;
-    string->chars = chars;
+    string->hash = hash;
+    string->chars = (char*)(string + 1);
+    memcpy(string->chars, chars, length);
+    string->chars[length] = '\0';
+
+    // Intern it; keep it on the stack in case growing the table triggers a GC
+    push(OBJ_VAL(string));
+    table_set(&currentVM->strings, string, BOOL_VAL(true));
+    pop();
+
     return string;
 }
 
+/**
+ * @brief 32-bit FNV-1a hash of a string's characters
+ */
+static uint32_t hash_string(const char* key, int length) {
+    uint32_t hash = 2166136261u;
+    for (int i = 0; i < length; i++) {
+        hash ^= (uint8_t)key[i];
+        hash *= 16777619;
+    }
+    return hash;
+}
+
+/**
+ * @brief Look up an interned string. The table is weak, so a string found
+ * while the collector is marking may still be white: shade it.
+ */
+static ObjString* find_interned(VM* vm, const char* chars, int length, uint32_t hash) {
+    ObjString* interned = table_find_string(&vm->strings, chars, length, hash);
+    if (interned != NULL) vm_write_barrier(vm, OBJ_VAL(interned));
+    return interned;
+}
+
 ObjString* copy_string(const char* chars, int length) {
-    char* heapChars = ALLOCATE(char, length + 1);
-    
-    memcpy(heapChars, chars, length);
-    heapChars[length] = '\0';
-    return allocate_string(heapChars, length);
+    uint32_t hash = hash_string(chars, length);
+    ObjString* interned = find_interned(currentVM, chars, length, hash);
+    if (interned != NULL) return interned;
+
+    return allocate_string(chars, length, hash);
 }
 
 ObjString* take_string(char* chars, int length) {
-    return allocate_string(chars, length);
+    uint32_t hash = hash_string(chars, length);
+    ObjString* interned = find_interned(currentVM, chars, length, hash);
+    if (interned == NULL) interned = allocate_string(chars, length, hash);
+
+    // Strings keep their characters inline, so the buffer is only copied
+    reallocate(chars, length + 1, 0);
+    return interned;
 }
 
 /**
  * @brief Helper function to deal with string concatenation
+ *
+ * The result is built in the nursery when it fits (most concatenation
+ * results are temporaries); if an equal string is already interned the
+ * young block is simply given back. Long results are ropes (see ObjRope).
  * 
  * @param a First string to be concatenated
  * @param b Second String to be concatenated
  * @return ObjString* 
  */
+/**
+ * @brief An old-heap copy of a young string for a rope to point at. It is
+ * not interned: ropes never hand their children out.
+ */
+static ObjString* leaf_string(ObjString* young) {
+    ObjString* leaf = (ObjString*)allocate_object(string_object_size(young->length), OBJ_STRING);
+    leaf->length = young->length;
+    leaf->hash = young->hash;
+    leaf->chars = (char*)(leaf + 1);
+    memcpy(leaf->chars, young->chars, (size_t)young->length + 1);
+    return leaf;
+}
+
+/**
+ * @brief `a` followed by `b` as a rope (no characters are copied, unless
+ * an operand is young: the nursery must stay unreferenced from old objects)
+ */
+static ObjString* new_rope(VM* vm, ObjString* a, ObjString* b) {
+    if (a->length == 0) return b;
+    if (b->length == 0) return a;
+
+    // Keep the leaves rooted while the node is allocated
+    if (a->obj.isYoung) a = leaf_string(a);
+    push(OBJ_VAL(a));
+    if (b->obj.isYoung) b = leaf_string(b);
+    push(OBJ_VAL(b));
+
+    ObjRope* rope = ALLOCATE_OBJ(ObjRope, OBJ_ROPE);
+    rope->string.length = a->length + b->length;
+    rope->string.hash = 0; // Never interned
+    rope->string.chars = NULL;
+    rope->left = a;
+    rope->right = b;
+
+    // A node allocated black mid-cycle must not point at white children
+    vm_write_barrier(vm, OBJ_VAL(a));
+    vm_write_barrier(vm, OBJ_VAL(b));
+
+    pop();
+    pop();
+    return &rope->string;
+}
+
 ObjString* concatenate(ObjString* a, ObjString* b) {
     int length = a->length + b->length;
+    VM* vm = currentVM;
+
+    // Below the threshold neither side is a rope, so both have their chars
+    if (length >= ROPE_MIN_LENGTH) return new_rope(vm, a, b);
+
+    ObjString* young = (ObjString*)vm_allocate_young(vm, young_string_size(length));
+    if (young != NULL) {
+        char* chars = (char*)(young + 1);
+        memcpy(chars, a->chars, a->length);
+        memcpy(chars + a->length, b->chars, b->length);
+        chars[length] = '\0';
+
+        uint32_t hash = hash_string(chars, length);
+        ObjString* interned = find_interned(vm, chars, length, hash);
+        if (interned != NULL) {
+            vm_unallocate_young(vm, young);
+            return interned;
+        }
+
+        young->obj.type = OBJ_STRING;
+        young->obj.isMarked = false;
+        young->obj.isYoung = true;
+        young->obj.isPooled = false;
+        young->obj.next = NULL; // Not on vm->objects; becomes the forwarding pointer
+        young->length = length;
+        young->hash = hash;
+        young->chars = chars;
+        vm_trace_allocation(vm, OBJ_STRING, young_string_size(length));
+
+        // Intern it; keep it on the stack in case growing the table triggers a GC
+        push(OBJ_VAL(young));
+        table_set(&vm->strings, young, BOOL_VAL(true));
+        pop();
+        return young;
+    }
 
     char* chars = ALLOCATE(char, length + 1);
     memcpy(chars, a->chars, a->length);
@@ -91,18 +219,86 @@ ObjString* concatenate(ObjString* a, ObjString* b) {
     return take_string(chars, length);
 }
 
+char* flatten_rope(ObjRope* rope) {
+    int length = rope->string.length;
+    char* chars = (char*)vm_allocate_deferred(currentVM, (size_t)length + 1);
+    chars[length] = '\0';
+
+    // Fill from the end. Left children wait on `pending`, so the left-deep
+    // ropes that appending builds need a single entry however long they are
+    ObjString** pending = NULL;
+    int count = 0;
+    int capacity = 0;
+    ObjString* node = &rope->string;
+    int end = length;
+
+    for (;;) {
+        if (node->chars != NULL) {
+            end -= node->length;
+            memcpy(chars + end, node->chars, (size_t)node->length);
+            if (count == 0) break;
+            node = pending[--count];
+            continue;
+        }
+
+        ObjRope* inner = (ObjRope*)node;
+        if (count == capacity) {
+            capacity = capacity < 8 ? 8 : capacity * 2;
+            pending = (ObjString**)realloc(pending, sizeof(ObjString*) * (size_t)capacity);
+            if (pending == NULL) {
+                fprintf(stderr, "Fatal: Out of memory.\n");
+                exit(1);
+            }
+        }
+        pending[count++] = inner->left;
+        node = inner->right;
+    }
+    free(pending);
+
+    rope->string.chars = chars;
+    rope->left = NULL;
+    rope->right = NULL;
+    return chars;
+}
+
+bool strings_equal(ObjString* a, ObjString* b) {
+    if (a == b) return true;
+
+    // Flat strings are interned: equal contents would be the same object
+    if (a->obj.type == OBJ_STRING && b->obj.type == OBJ_STRING) return false;
+    if (a->length != b->length) return false;
+    return memcmp(string_chars(a), string_chars(b), (size_t)a->length) == 0;
+}
 
 ObjFunction* new_function() {
     ObjFunction* function = ALLOCATE_OBJ(ObjFunction, OBJ_FUNCTION);
     function->arity = 0;
+    function->global = -1;
+    function->registers = 0;
+    function->maxStackDepth = 0;
+    function->hotness = 0;
+    function->jit = NULL;
+    function->verified = false;
+    function->trusted = false;
+    function->memoState = MEMO_UNKNOWN;
+    function->memo = NULL;
     function->name = NULL; // NULL name means top-level script
     init_chunk(&function->chunk);
     return function;
 }
 
+ObjNative* new_native(NativeFn function, int arity, ObjString* name) {
+    ObjNative* native = ALLOCATE_OBJ(ObjNative, OBJ_NATIVE);
+    native->arity = arity;
+    native->function = function;
+    native->name = name;
+    return native;
+}
+
 void print_object(Value value) {
     switch (OBJ_TYPE(value)) {
         case OBJ_STRING:
+        case OBJ_ROPE:
             printf("%s", AS_CSTRING(value));
             break;
 
@@ -115,5 +311,9 @@ void print_object(Value value) {
             }
             break;
         }
+
+        case OBJ_NATIVE:
+            printf("<native fn %s>", AS_NATIVE(value)->name->chars);
+            break;
     }
 }
\ No newline at end of file
@@ -0,0 +1,154 @@
+/**
+ * @file output.c
+ * @brief Buffered script output (see output.h).
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "vm/output.h"
+#include "vm/object.h"
+
+void output_init(OutputBuffer* out, size_t capacity) {
+    out->data = NULL;
+    out->count = 0;
+    out->capacity = capacity > 0 ? capacity : 1;
+    out->sink = stdout;
+}
+
+void output_free(OutputBuffer* out) {
+    output_flush(out);
+    free(out->data);
+    out->data = NULL;
+}
+
+void output_flush(OutputBuffer* out) {
+    if (out->sink == NULL) return;
+    if (out->count > 0) {
+        fwrite(out->data, 1, out->count, out->sink);
+        out->count = 0;
+    }
+    fflush(out->sink);
+}
+
+char* output_take(OutputBuffer* out, size_t* length) {
+    char* data = out->data;
+    *length = out->count;
+    out->data = NULL;
+    out->count = 0;
+    if (*length == 0) {
+        free(data);
+        return NULL;
+    }
+    return data;
+}
+
+/**
+ * @brief Grow a capturing buffer to fit `length` more bytes.
+ */
+static void output_grow(OutputBuffer* out, size_t length) {
+    size_t capacity = out->capacity;
+    while (length > capacity - out->count) capacity *= 2;
+    if (out->data != NULL) {
+        char* data = (char*)realloc(out->data, capacity);
+        if (data == NULL) {
+            fprintf(stderr, "Fatal: Out of memory.\n");
+            exit(1);
+        }
+        out->data = data;
+    }
+    out->capacity = capacity;
+}
+
+void output_write(OutputBuffer* out, const char* chars, size_t length) {
+    if (out->sink == NULL && length > out->capacity - out->count) {
+        output_grow(out, length);
+    } else if (length > out->capacity - out->count) {
+        output_flush(out);
+        if (length >= out->capacity) {
+            fwrite(chars, 1, length, out->sink);
+            return;
+        }
+    }
+
+    if (out->data == NULL) {
+        out->data = (char*)malloc(out->capacity);
+        if (out->data == NULL) {
+            fprintf(stderr, "Fatal: Out of memory.\n");
+            exit(1);
+        }
+    }
+    memcpy(out->data + out->count, chars, length);
+    out->count += length;
+}
+
+/**
+ * @brief Decimal digits of `value`, written backwards (no printf()).
+ */
+static void output_int(OutputBuffer* out, int value) {
+    char digits[12];
+    char* end = digits + sizeof(digits);
+    char* start = end;
+
+    // In unsigned arithmetic, so INT_MIN negates too
+    uint32_t magnitude = value < 0 ? 0u - (uint32_t)value : (uint32_t)value;
+    do {
+        *--start = (char)('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude != 0);
+    if (value < 0) *--start = '-';
+
+    output_write(out, start, (size_t)(end - start));
+}
+
+static void output_cstring(OutputBuffer* out, const char* chars) {
+    output_write(out, chars, strlen(chars));
+}
+
+static void output_object(OutputBuffer* out, Value value) {
+    switch (OBJ_TYPE(value)) {
+        case OBJ_STRING:
+        case OBJ_ROPE: {
+            ObjString* string = AS_STRING(value);
+            output_write(out, string_chars(string), (size_t)string->length);
+            break;
+        }
+
+        case OBJ_FUNCTION: {
+            ObjFunction* fn = AS_FUNCTION(value);
+            if (fn->name == NULL) {
+                output_cstring(out, "<script>");
+            } else {
+                output_cstring(out, "<fn ");
+                output_cstring(out, fn->name->chars);
+                output_cstring(out, ">");
+            }
+            break;
+        }
+
+        case OBJ_NATIVE:
+            output_cstring(out, "<native fn ");
+            output_cstring(out, AS_NATIVE(value)->name->chars);
+            output_cstring(out, ">");
+            break;
+    }
+}
+
+void output_value(OutputBuffer* out, Value value) {
+    switch (VALUE_TYPE(value)) {
+        case VAL_BOOL:
+            output_cstring(out, AS_BOOL(value) ? "true" : "false");
+            break;
+        case VAL_INT:
+            output_int(out, AS_INT(value));
+            break;
+        case VAL_OBJ:
+            output_object(out, value);
+            break;
+    }
+}
+
+void output_line(OutputBuffer* out, Value value) {
+    output_value(out, value);
+    output_write(out, "\n", 1);
+}
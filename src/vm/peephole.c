@@ -0,0 +1,322 @@
+/**
+ * @file peephole.c
+ * @brief Superinstruction peephole pass over compiled chunks.
+ *
+ * The pass works in four steps:
+ *  1. Decode the chunk into an instruction list and resolve every jump to
+ *     the index of the instruction it lands on.
+ *  2. Walk the list and fuse patterns, refusing any pattern whose interior
+ *     instructions are jump targets.
+ *  3. Lay the new instructions out and recompute their offsets.
+ *  4. Re-encode into the chunk's own code array and line table, patching jumps.
+ *
+ * Fusions:
+ *   OP_EQUAL/OP_LESS/OP_GREATER(_INT) ; OP_NOT  -> NOT_EQUAL / GREATER_EQUAL / LESS_EQUAL(_INT)
+ *   OP_CONSTANT k ; OP_ADD(_INT)               -> OP_ADD_CONST k          (int k)
+ *   OP_CONSTANT k ; OP_SUBTRACT(_INT)          -> OP_SUBTRACT_CONST k     (int k)
+ *   OP_GET_LOCAL a ; OP_GET_LOCAL b ; OP_ADD(_INT) -> OP_ADD_LOCALS a b
+ *   OP_GET_LOCAL a ; OP_CONSTANT k ; OP_ADD(_INT)  -> OP_ADD_LOCAL_CONST a k (int k)
+ *   OP_JUMP_IF_FALSE L ; OP_POP ... L: OP_POP  -> OP_JUMP_IF_FALSE_POP L+1
+ *     (only when L's POP is reached solely through that jump)
+ *   OP_POP ; OP_POP ...                        -> OP_POPN n  (a scope's locals, up to 255)
+ *
+ * Loop counters (`while i < n { ...; i = i + k; }`):
+ *   OP_GET_LOCAL a ; OP_CONSTANT k ; OP_ADD(_INT) ; OP_SET_LOCAL a ; OP_POP    -> OP_INC_LOCAL a k
+ *   OP_GET_GLOBAL g ; OP_CONSTANT k ; OP_ADD(_INT) ; OP_SET_GLOBAL g ; OP_POP  -> OP_INC_GLOBAL g k
+ *   <, <=, >, >= ; OP_JUMP_IF_FALSE L ; OP_POP  -> OP_JUMP_IF_NOT_<cmp> L+1
+ *     (a while loop's condition: L's POP follows the loop's OP_LOOP)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "vm/peephole.h"
+#include "vm/opcode.h"
+#include "vm/value.h"
+
+/**
+ * @struct Instr
+ * @brief One decoded instruction.
+ */
+typedef struct {
+    uint8_t op;
+    uint8_t operands[2];
+    int line;       // Line of the instruction that can raise an error
+    int target;     // Jumps: index of the target instruction (count = end of chunk)
+    int offset;     // Byte offset (input offset while decoding, output offset after layout)
+} Instr;
+
+static bool is_jump(uint8_t op) {
+    return op == OP_JUMP || op == OP_JUMP_IF_FALSE ||
+           op == OP_LOOP || op == OP_JUMP_IF_FALSE_POP ||
+           op == OP_JUMP_IF_NOT_LESS || op == OP_JUMP_IF_NOT_LESS_EQUAL ||
+           op == OP_JUMP_IF_NOT_GREATER || op == OP_JUMP_IF_NOT_GREATER_EQUAL;
+}
+
+// Control never falls through to the next instruction
+static bool is_unconditional(uint8_t op) {
+    return op == OP_JUMP || op == OP_LOOP || op == OP_RETURN ||
+           op == OP_TAIL_CALL || op == OP_TAIL_CALL_DIRECT;
+}
+
+static bool is_add(uint8_t op) {
+    return op == OP_ADD || op == OP_ADD_INT;
+}
+
+static bool is_int_constant(const Chunk* chunk, const Instr* in) {
+    return in->op == OP_CONSTANT &&
+           in->operands[0] < chunk->constants.count &&
+           IS_INT(chunk->constants.values[in->operands[0]]);
+}
+
+/**
+ * @brief Map a comparison opcode to its fused "comparison + NOT" form.
+ *
+ * @return int The fused opcode, or -1 if `op` has none.
+ */
+static int fused_negated_compare(uint8_t op) {
+    switch (op) {
+        case OP_EQUAL:       return OP_NOT_EQUAL;
+        case OP_LESS:        return OP_GREATER_EQUAL;
+        case OP_GREATER:     return OP_LESS_EQUAL;
+        case OP_EQUAL_INT:   return OP_NOT_EQUAL_INT;
+        case OP_LESS_INT:    return OP_GREATER_EQUAL_INT;
+        case OP_GREATER_INT: return OP_LESS_EQUAL_INT;
+        default:             return -1;
+    }
+}
+
+/**
+ * @brief Map a comparison (after the NOT fusion) to its compare-and-branch form.
+ *
+ * @return int The fused opcode, or -1 if `op` has none.
+ */
+static int fused_compare_branch(uint8_t op) {
+    switch (op) {
+        case OP_LESS:
+        case OP_LESS_INT:          return OP_JUMP_IF_NOT_LESS;
+        case OP_LESS_EQUAL:
+        case OP_LESS_EQUAL_INT:    return OP_JUMP_IF_NOT_LESS_EQUAL;
+        case OP_GREATER:
+        case OP_GREATER_INT:       return OP_JUMP_IF_NOT_GREATER;
+        case OP_GREATER_EQUAL:
+        case OP_GREATER_EQUAL_INT: return OP_JUMP_IF_NOT_GREATER_EQUAL;
+        default:                   return -1;
+    }
+}
+
+/**
+ * @brief Check that `n` instructions starting at `i` exist and may be fused:
+ * none after the first is a jump target or already removed.
+ */
+static bool fusable(const int* incoming, const bool* removed, int count, int i, int n) {
+    if (i + n > count) return false;
+    for (int k = 1; k < n; k++) {
+        if (incoming[i + k] > 0 || removed[i + k]) return false;
+    }
+    return true;
+}
+
+/**
+ * @brief If instructions `j`, `j + 1` are the OP_JUMP_IF_FALSE ; OP_POP
+ * leaving a while loop (the jump lands on the POP right after the loop's
+ * OP_LOOP, which goes back to `first` or before), find that landing POP.
+ *
+ * @return int Index of the landing POP, or -1 if this is not a loop exit
+ *         (or the POP is reached some other way too).
+ */
+static int loop_exit_pop(const Instr* in, const int* incoming, const bool* removed, int count, int first, int j) {
+    if (in[j].op != OP_JUMP_IF_FALSE || in[j + 1].op != OP_POP) return -1;
+    int t = in[j].target;
+    if (t <= j + 1 || t >= count || in[t].op != OP_POP || removed[t] || incoming[t] != 1) return -1;
+    if (in[t - 1].op != OP_LOOP || in[t - 1].target > first) return -1;
+    return t;
+}
+
+void optimize_chunk(Chunk* chunk) {
+    if (chunk->count == 0) return;
+
+    // Upper bounds: one instruction per byte
+    Instr* in = (Instr*)malloc(sizeof(Instr) * chunk->count);
+    Instr* out = (Instr*)malloc(sizeof(Instr) * (chunk->count + 1));
+    int* indexAt = (int*)malloc(sizeof(int) * (chunk->count + 1)); // byte offset -> instruction
+    int* incoming = (int*)calloc(chunk->count + 1, sizeof(int));    // jumps landing on instruction
+    int* newIndex = (int*)malloc(sizeof(int) * (chunk->count + 1)); // old instruction -> new instruction
+    bool* removed = (bool*)calloc(chunk->count + 1, sizeof(bool));
+
+    if (!in || !out || !indexAt || !incoming || !newIndex || !removed) {
+        // Optimization is optional; leave the chunk untouched
+        goto cleanup;
+    }
+
+    // --- 1. Decode ---
+    int count = 0;
+    for (int i = 0; i <= chunk->count; i++) indexAt[i] = -1;
+
+    for (int offset = 0; offset < chunk->count; ) {
+        Instr* instr = &in[count];
+        instr->op = chunk->code[offset];
+        instr->offset = offset;
+        instr->line = get_line(chunk, offset);
+        instr->target = -1;
+
+        int length = opcode_length(instr->op);
+        if (offset + length > chunk->count) goto cleanup; // malformed, bail out
+        for (int k = 1; k < length; k++) instr->operands[k - 1] = chunk->code[offset + k];
+
+        indexAt[offset] = count++;
+        offset += length;
+    }
+    indexAt[chunk->count] = count; // "end of chunk" sentinel
+
+    for (int i = 0; i < count; i++) {
+        Instr* instr = &in[i];
+        if (!is_jump(instr->op)) continue;
+
+        int distance = (instr->operands[0] << 8) | instr->operands[1];
+        int targetOffset = (instr->op == OP_LOOP)
+                         ? instr->offset + 3 - distance
+                         : instr->offset + 3 + distance;
+
+        if (targetOffset < 0 || targetOffset > chunk->count || indexAt[targetOffset] < 0) {
+            goto cleanup; // jump into the middle of an instruction, don't touch it
+        }
+        instr->target = indexAt[targetOffset];
+        incoming[instr->target]++;
+    }
+
+    // --- 2. Fuse ---
+    int outCount = 0;
+
+    #define FUSABLE(i, n) fusable(incoming, removed, count, (i), (n))
+
+    for (int i = 0; i < count; ) {
+        if (removed[i]) {
+            newIndex[i] = outCount;
+            i++;
+            continue;
+        }
+
+        Instr* a = &in[i];
+        Instr* next = &out[outCount];
+        *next = *a;
+        newIndex[i] = outCount;
+        int consumed = 1;
+
+        int negated = fused_negated_compare(a->op);
+        int compared = negated >= 0 && FUSABLE(i, 2) && in[i + 1].op == OP_NOT ? 2 : 1;
+        int branch = fused_compare_branch(compared == 2 ? (uint8_t)negated : a->op);
+        int exitPop = branch >= 0 && FUSABLE(i, compared + 2)
+                    ? loop_exit_pop(in, incoming, removed, count, i, i + compared) : -1;
+
+        if ((a->op == OP_GET_LOCAL || a->op == OP_GET_GLOBAL) && FUSABLE(i, 5) &&
+            is_int_constant(chunk, &in[i + 1]) && is_add(in[i + 2].op) &&
+            in[i + 3].op == (a->op == OP_GET_LOCAL ? OP_SET_LOCAL : OP_SET_GLOBAL) &&
+            in[i + 3].operands[0] == a->operands[0] && in[i + 4].op == OP_POP) {
+            // x = x + k; as a statement: nothing is left on the stack
+            next->op = a->op == OP_GET_LOCAL ? OP_INC_LOCAL : OP_INC_GLOBAL;
+            next->operands[1] = in[i + 1].operands[0];
+            next->line = in[i + 2].line;
+            consumed = 5;
+        }
+        else if (exitPop >= 0) {
+            // A while loop's condition: the comparison branches by itself
+            next->op = (uint8_t)branch;
+            next->line = in[i + compared - 1].line;
+            next->target = exitPop + 1;
+            incoming[exitPop + 1]++;
+            removed[exitPop] = true;
+            consumed = compared + 2;
+        }
+        else if (negated >= 0 && FUSABLE(i, 2) && in[i + 1].op == OP_NOT) {
+            next->op = (uint8_t)negated;
+            next->line = in[i + 1].line;
+            consumed = 2;
+        }
+        else if (a->op == OP_GET_LOCAL && FUSABLE(i, 3) && is_add(in[i + 2].op) &&
+                 is_int_constant(chunk, &in[i + 1])) {
+            next->op = OP_ADD_LOCAL_CONST;
+            next->operands[1] = in[i + 1].operands[0];
+            next->line = in[i + 2].line;
+            consumed = 3;
+        }
+        else if (a->op == OP_GET_LOCAL && FUSABLE(i, 3) && is_add(in[i + 2].op) &&
+                 in[i + 1].op == OP_GET_LOCAL) {
+            next->op = OP_ADD_LOCALS;
+            next->operands[1] = in[i + 1].operands[0];
+            next->line = in[i + 2].line;
+            consumed = 3;
+        }
+        else if (is_int_constant(chunk, a) && FUSABLE(i, 2) &&
+                 (is_add(in[i + 1].op) || in[i + 1].op == OP_SUBTRACT ||
+                  in[i + 1].op == OP_SUBTRACT_INT)) {
+            next->op = is_add(in[i + 1].op) ? OP_ADD_CONST : OP_SUBTRACT_CONST;
+            next->line = in[i + 1].line;
+            consumed = 2;
+        }
+        else if (a->op == OP_JUMP_IF_FALSE && FUSABLE(i, 2) && in[i + 1].op == OP_POP) {
+            // The jump's landing POP must be reachable only through this jump
+            int t = a->target;
+            if (t > i + 1 && t < count && in[t].op == OP_POP && !removed[t] &&
+                incoming[t] == 1 && is_unconditional(in[t - 1].op)) {
+                next->op = OP_JUMP_IF_FALSE_POP;
+                next->target = t + 1;
+                incoming[t + 1]++;
+                removed[t] = true;
+                consumed = 2;
+            }
+        }
+        else if (a->op == OP_POP && FUSABLE(i, 2) && in[i + 1].op == OP_POP) {
+            // Leaving a scope (after a statement's own POP, often)
+            int n = 2;
+            while (n < UINT8_COUNT - 1 && FUSABLE(i, n + 1) && in[i + n].op == OP_POP) n++;
+            next->op = OP_POPN;
+            next->operands[0] = (uint8_t)n;
+            consumed = n;
+        }
+
+        for (int k = 1; k < consumed; k++) newIndex[i + k] = outCount;
+        outCount++;
+        i += consumed;
+    }
+    newIndex[count] = outCount;
+
+    #undef FUSABLE
+
+    // --- 3. Layout ---
+    int offset = 0;
+    for (int i = 0; i < outCount; i++) {
+        out[i].offset = offset;
+        offset += opcode_length(out[i].op);
+    }
+    out[outCount].offset = offset; // end of chunk
+
+    // --- 4. Re-encode (never longer than the input, so reuse the arrays) ---
+    chunk->lineCount = 0;
+    for (int i = 0; i < outCount; i++) {
+        Instr* instr = &out[i];
+        int length = opcode_length(instr->op);
+
+        if (is_jump(instr->op)) {
+            int target = out[newIndex[instr->target]].offset;
+            int distance = (instr->op == OP_LOOP)
+                         ? instr->offset + 3 - target
+                         : target - (instr->offset + 3);
+            instr->operands[0] = (uint8_t)((distance >> 8) & 0xff);
+            instr->operands[1] = (uint8_t)(distance & 0xff);
+        }
+
+        chunk->code[instr->offset] = instr->op;
+        for (int k = 1; k < length; k++) chunk->code[instr->offset + k] = instr->operands[k - 1];
+        add_line(chunk, instr->offset, instr->line);
+    }
+    chunk->count = offset;
+
+cleanup:
+    free(in);
+    free(out);
+    free(indexAt);
+    free(incoming);
+    free(newIndex);
+    free(removed);
+}
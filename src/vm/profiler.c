@@ -0,0 +1,429 @@
+/**
+ * @file profiler.c
+ * @brief Instrumenting opcode / function / line profiler (see profiler.h).
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define PROFILER_TSC
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define PROFILER_TSC
+#endif
+
+#include "vm/profiler.h"
+#include "vm/vm.h"
+#include "vm/memory.h"
+#include "vm/opcode.h"
+
+#define PROFILE_TOP_LINES 20
+
+static uint64_t read_ticks(void) {
+#ifdef PROFILER_TSC
+    return __rdtsc();
+#else
+    return vm_monotonic_ns();
+#endif
+}
+
+const char* profiler_tick_unit(void) {
+#ifdef PROFILER_TSC
+    return "cycles";
+#else
+    return "ns";
+#endif
+}
+
+static void* grow_array(void* array, size_t elementSize, int* capacity) {
+    int newCapacity = *capacity < 16 ? 16 : *capacity * 2;
+    void* grown = realloc(array, elementSize * newCapacity);
+    if (grown == NULL) {
+        fprintf(stderr, "Fatal: Out of memory in the profiler.\n");
+        exit(1);
+    }
+    *capacity = newCapacity;
+    return grown;
+}
+
+static void* zeroed(size_t count, size_t size) {
+    void* block = calloc(count > 0 ? count : 1, size);
+    if (block == NULL) {
+        fprintf(stderr, "Fatal: Out of memory in the profiler.\n");
+        exit(1);
+    }
+    return block;
+}
+
+static int new_node(Profiler* profiler, int function, int parent) {
+    if (profiler->nodeCount == profiler->nodeCapacity) {
+        profiler->nodes = (ProfileNode*)grow_array(profiler->nodes, sizeof(ProfileNode),
+                                                   &profiler->nodeCapacity);
+    }
+    int index = profiler->nodeCount++;
+    ProfileNode* node = &profiler->nodes[index];
+    node->function = function;
+    node->parent = parent;
+    node->firstChild = -1;
+    node->nextSibling = -1;
+    node->calls = 0;
+    node->selfTicks = 0;
+    if (parent >= 0) {
+        node->nextSibling = profiler->nodes[parent].firstChild;
+        profiler->nodes[parent].firstChild = index;
+    }
+    return index;
+}
+
+Profiler* new_profiler(void) {
+    Profiler* profiler = (Profiler*)zeroed(1, sizeof(Profiler));
+    new_node(profiler, -1, -1); // The root
+    profiler->node = 0;
+    return profiler;
+}
+
+void free_profiler(Profiler* profiler) {
+    if (profiler == NULL) return;
+    for (int i = 0; i < profiler->functionCount; i++) {
+        free(profiler->functions[i].hits);
+        free(profiler->functions[i].ticks);
+    }
+    free(profiler->functions);
+    free(profiler->functionIndex);
+    free(profiler->nodes);
+    free(profiler);
+}
+
+// --- Function records ---
+
+static uint32_t hash_pointer(const void* pointer) {
+    uintptr_t bits = (uintptr_t)pointer;
+    bits ^= bits >> 17;
+    bits *= (uintptr_t)0xed5ad4bbu;
+    bits ^= bits >> 11;
+    return (uint32_t)bits;
+}
+
+static void rebuild_index(Profiler* profiler, int capacity) {
+    free(profiler->functionIndex);
+    profiler->functionIndex = (int*)malloc(sizeof(int) * capacity);
+    if (profiler->functionIndex == NULL) {
+        fprintf(stderr, "Fatal: Out of memory in the profiler.\n");
+        exit(1);
+    }
+    for (int i = 0; i < capacity; i++) profiler->functionIndex[i] = -1;
+    profiler->indexCapacity = capacity;
+
+    for (int i = 0; i < profiler->functionCount; i++) {
+        uint32_t slot = hash_pointer(profiler->functions[i].function) & (capacity - 1);
+        while (profiler->functionIndex[slot] != -1) slot = (slot + 1) & (capacity - 1);
+        profiler->functionIndex[slot] = i;
+    }
+}
+
+static int function_record(Profiler* profiler, ObjFunction* function) {
+    if (profiler->indexCapacity > 0) {
+        uint32_t mask = (uint32_t)profiler->indexCapacity - 1;
+        for (uint32_t slot = hash_pointer(function) & mask;; slot = (slot + 1) & mask) {
+            int index = profiler->functionIndex[slot];
+            if (index == -1) break;
+            if (profiler->functions[index].function == function) return index;
+        }
+    }
+
+    if (profiler->functionCount == profiler->functionCapacity) {
+        profiler->functions = (ProfileFunction*)grow_array(profiler->functions, sizeof(ProfileFunction),
+                                                           &profiler->functionCapacity);
+    }
+    int index = profiler->functionCount++;
+    ProfileFunction* record = &profiler->functions[index];
+    record->function = function;
+    record->codeCount = function->chunk.count;
+    record->hits = (uint64_t*)zeroed(record->codeCount, sizeof(uint64_t));
+    record->ticks = (uint64_t*)zeroed(record->codeCount, sizeof(uint64_t));
+
+    // Keep the index at most half full
+    if (profiler->functionCount * 2 > profiler->indexCapacity) {
+        rebuild_index(profiler, profiler->indexCapacity < 16 ? 32 : profiler->indexCapacity * 2);
+    } else {
+        uint32_t mask = (uint32_t)profiler->indexCapacity - 1;
+        uint32_t slot = hash_pointer(function) & mask;
+        while (profiler->functionIndex[slot] != -1) slot = (slot + 1) & mask;
+        profiler->functionIndex[slot] = index;
+    }
+    return index;
+}
+
+// --- Recording ---
+
+/**
+ * @brief Move to the path `function` called from the current one.
+ */
+static void enter_function(Profiler* profiler, ObjFunction* function) {
+    int record = function_record(profiler, function);
+    int child = profiler->nodes[profiler->node].firstChild;
+    while (child != -1 && profiler->nodes[child].function != record) {
+        child = profiler->nodes[child].nextSibling;
+    }
+    if (child == -1) child = new_node(profiler, record, profiler->node);
+
+    profiler->nodes[child].calls++;
+    profiler->node = child;
+}
+
+void profiler_begin_run(Profiler* profiler) {
+    profiler->node = 0;
+    profiler->depth = 0;
+    profiler->pending = false;
+}
+
+/**
+ * @brief Charge the ticks since the previous instruction to it.
+ */
+static void charge_previous(Profiler* profiler, uint64_t now) {
+    if (!profiler->pending) return;
+    uint64_t elapsed = now - profiler->lastTick;
+    ProfileNode* node = &profiler->nodes[profiler->node];
+    profiler->opTicks[profiler->lastOp] += elapsed;
+    node->selfTicks += elapsed;
+    profiler->functions[node->function].ticks[profiler->lastOffset] += elapsed;
+}
+
+void profiler_end_run(Profiler* profiler) {
+    charge_previous(profiler, read_ticks());
+    profiler->pending = false;
+}
+
+void profiler_instruction(Profiler* profiler, VM* vm, const uint8_t* ip) {
+    uint64_t now = read_ticks();
+    charge_previous(profiler, now);
+
+    // Follow the frame stack: returns (and unwinding) pop paths, a new
+    // frame pushes one, and a tail call replaces the top one
+    while (profiler->depth > vm->frameCount) {
+        profiler->node = profiler->nodes[profiler->node].parent;
+        profiler->depth--;
+    }
+    while (profiler->depth < vm->frameCount) {
+        enter_function(profiler, vm->frames[profiler->depth].function);
+        profiler->depth++;
+    }
+
+    ObjFunction* function = vm->frames[vm->frameCount - 1].function;
+    ProfileNode* node = &profiler->nodes[profiler->node];
+    bool tailCalled = (profiler->lastOp == OP_TAIL_CALL || profiler->lastOp == OP_TAIL_CALL_DIRECT) &&
+                      ip == function->chunk.code;
+    if (profiler->functions[node->function].function != function || (profiler->pending && tailCalled)) {
+        profiler->node = node->parent;
+        enter_function(profiler, function);
+    }
+
+    ProfileFunction* record = &profiler->functions[profiler->nodes[profiler->node].function];
+    int offset = (int)(ip - function->chunk.code);
+    record->hits[offset]++;
+    profiler->opCounts[*ip]++;
+
+    profiler->lastOp = *ip;
+    profiler->lastOffset = offset;
+    profiler->pending = true;
+    profiler->lastTick = read_ticks(); // Leave the profiler's own time out
+}
+
+// --- Reporting ---
+
+static const char* function_name(const ObjFunction* function) {
+    return function->name != NULL ? function->name->chars : "<script>";
+}
+
+static double percent(uint64_t part, uint64_t total) {
+    return total > 0 ? 100.0 * (double)part / (double)total : 0.0;
+}
+
+typedef struct {
+    int key;            // Opcode, function index or line entry index
+    uint64_t sortBy;
+} Ranked;
+
+static int compare_ranked(const void* a, const void* b) {
+    uint64_t x = ((const Ranked*)a)->sortBy;
+    uint64_t y = ((const Ranked*)b)->sortBy;
+    return x < y ? 1 : (x > y ? -1 : 0);
+}
+
+/**
+ * @brief Inclusive ticks per function: the time of every subtree rooted at
+ * a path entering that function, counting recursive paths once.
+ */
+static uint64_t* inclusive_ticks(const Profiler* profiler) {
+    int count = profiler->nodeCount;
+    uint64_t* total = (uint64_t*)zeroed(count, sizeof(uint64_t));
+    uint64_t* inclusive = (uint64_t*)zeroed(profiler->functionCount, sizeof(uint64_t));
+    int* active = (int*)zeroed(profiler->functionCount, sizeof(int));
+
+    // Children are always created after their parent
+    for (int i = count - 1; i > 0; i--) {
+        total[i] += profiler->nodes[i].selfTicks;
+        total[profiler->nodes[i].parent] += total[i];
+    }
+
+    int n = profiler->nodes[0].firstChild;
+    while (n > 0) {
+        const ProfileNode* node = &profiler->nodes[n];
+        if (active[node->function]++ == 0) inclusive[node->function] += total[n];
+        if (node->firstChild != -1) {
+            n = node->firstChild;
+            continue;
+        }
+        for (;;) {
+            active[profiler->nodes[n].function]--;
+            if (profiler->nodes[n].nextSibling != -1) {
+                n = profiler->nodes[n].nextSibling;
+                break;
+            }
+            n = profiler->nodes[n].parent;
+            if (n == 0) break;
+        }
+    }
+
+    free(total);
+    free(active);
+    return inclusive;
+}
+
+typedef struct {
+    int function;
+    int line;
+    uint64_t hits;
+    uint64_t ticks;
+} LineEntry;
+
+static void report_lines(const Profiler* profiler, FILE* out, uint64_t totalTicks) {
+    int count = 0, capacity = 0;
+    LineEntry* lines = NULL;
+
+    for (int f = 0; f < profiler->functionCount; f++) {
+        const ProfileFunction* record = &profiler->functions[f];
+        const Chunk* chunk = &record->function->chunk;
+        int first = count;
+        int previousLine = -1;
+        for (int offset = 0; offset < record->codeCount;
+             offset += opcode_length(chunk->code[offset])) {
+            int line = get_line(chunk, offset);
+            bool entersLine = line != previousLine;
+            previousLine = line;
+            if (record->hits[offset] == 0) continue;
+
+            int entry = first;
+            while (entry < count && lines[entry].line != line) entry++;
+            if (entry == count) {
+                if (count == capacity) lines = (LineEntry*)grow_array(lines, sizeof(LineEntry), &capacity);
+                lines[count++] = (LineEntry){f, line, 0, 0};
+            }
+            // A line is hit each time control enters it
+            if (entersLine) lines[entry].hits += record->hits[offset];
+            lines[entry].ticks += record->ticks[offset];
+        }
+    }
+
+    Ranked* ranked = (Ranked*)zeroed(count, sizeof(Ranked));
+    for (int i = 0; i < count; i++) ranked[i] = (Ranked){i, lines[i].ticks};
+    qsort(ranked, count, sizeof(Ranked), compare_ranked);
+
+    fprintf(out, "\n  %-32s %14s %16s %7s\n", "line", "hits", profiler_tick_unit(), "time");
+    for (int i = 0; i < count && i < PROFILE_TOP_LINES; i++) {
+        const LineEntry* entry = &lines[ranked[i].key];
+        char label[64];
+        snprintf(label, sizeof(label), "%s:%d",
+                 function_name(profiler->functions[entry->function].function), entry->line);
+        fprintf(out, "  %-32s %14llu %16llu %6.2f%%\n", label, (unsigned long long)entry->hits,
+                (unsigned long long)entry->ticks, percent(entry->ticks, totalTicks));
+    }
+
+    free(ranked);
+    free(lines);
+}
+
+void profiler_report(const Profiler* profiler, FILE* out) {
+    uint64_t totalTicks = 0;
+    uint64_t totalOps = 0;
+    for (int op = 0; op < UINT8_COUNT; op++) {
+        totalTicks += profiler->opTicks[op];
+        totalOps += profiler->opCounts[op];
+    }
+
+    fprintf(out, "\nProfile: %llu instructions, %llu %s\n",
+            (unsigned long long)totalOps, (unsigned long long)totalTicks, profiler_tick_unit());
+
+    // Opcodes
+    Ranked ops[UINT8_COUNT];
+    int opCount = 0;
+    for (int op = 0; op < UINT8_COUNT; op++) {
+        if (profiler->opCounts[op] > 0) ops[opCount++] = (Ranked){op, profiler->opTicks[op]};
+    }
+    qsort(ops, opCount, sizeof(Ranked), compare_ranked);
+
+    fprintf(out, "\n  %-32s %14s %16s %7s %10s\n", "opcode", "count", profiler_tick_unit(), "time", "per op");
+    for (int i = 0; i < opCount; i++) {
+        int op = ops[i].key;
+        fprintf(out, "  %-32s %14llu %16llu %6.2f%% %10.1f\n", opcode_name((uint8_t)op),
+                (unsigned long long)profiler->opCounts[op], (unsigned long long)profiler->opTicks[op],
+                percent(profiler->opTicks[op], totalTicks),
+                (double)profiler->opTicks[op] / (double)profiler->opCounts[op]);
+    }
+
+    // Functions
+    uint64_t* inclusive = inclusive_ticks(profiler);
+    uint64_t* calls = (uint64_t*)zeroed(profiler->functionCount, sizeof(uint64_t));
+    uint64_t* exclusive = (uint64_t*)zeroed(profiler->functionCount, sizeof(uint64_t));
+    for (int i = 1; i < profiler->nodeCount; i++) {
+        calls[profiler->nodes[i].function] += profiler->nodes[i].calls;
+        exclusive[profiler->nodes[i].function] += profiler->nodes[i].selfTicks;
+    }
+
+    Ranked* functions = (Ranked*)zeroed(profiler->functionCount, sizeof(Ranked));
+    for (int i = 0; i < profiler->functionCount; i++) functions[i] = (Ranked){i, exclusive[i]};
+    qsort(functions, profiler->functionCount, sizeof(Ranked), compare_ranked);
+
+    fprintf(out, "\n  %-32s %14s %16s %7s %16s %7s\n", "function", "calls", "exclusive", "time",
+            "inclusive", "time");
+    for (int i = 0; i < profiler->functionCount; i++) {
+        int f = functions[i].key;
+        fprintf(out, "  %-32s %14llu %16llu %6.2f%% %16llu %6.2f%%\n",
+                function_name(profiler->functions[f].function), (unsigned long long)calls[f],
+                (unsigned long long)exclusive[f], percent(exclusive[f], totalTicks),
+                (unsigned long long)inclusive[f], percent(inclusive[f], totalTicks));
+    }
+
+    free(functions);
+    free(exclusive);
+    free(calls);
+    free(inclusive);
+
+    report_lines(profiler, out, totalTicks);
+}
+
+bool profiler_write_folded(const Profiler* profiler, const char* path) {
+    FILE* file = fopen(path, "w");
+    if (file == NULL) return false;
+
+    int capacity = 0;
+    int* chain = NULL;
+    for (int i = 1; i < profiler->nodeCount; i++) {
+        if (profiler->nodes[i].selfTicks == 0) continue;
+
+        int depth = 0;
+        for (int n = i; n > 0; n = profiler->nodes[n].parent) {
+            if (depth == capacity) chain = (int*)grow_array(chain, sizeof(int), &capacity);
+            chain[depth++] = profiler->nodes[n].function;
+        }
+        for (int d = depth - 1; d >= 0; d--) {
+            fprintf(file, "%s%c", function_name(profiler->functions[chain[d]].function), d > 0 ? ';' : ' ');
+        }
+        fprintf(file, "%llu\n", (unsigned long long)profiler->nodes[i].selfTicks);
+    }
+
+    free(chain);
+    return fclose(file) == 0;
+}
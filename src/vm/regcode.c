@@ -0,0 +1,1033 @@
+/**
+ * @file regcode.c
+ * @brief Stack code -> register code translation (see regcode.h).
+ *
+ * Each function is translated in one forward pass over its stack code that
+ * simulates the operand stack. Stack position n is register n, and the
+ * simulated stack records where the value of each position can be found:
+ *
+ *   SLOT_REG     in its own register (it was written there)
+ *   SLOT_COPY    in register `index` (a local read that was not emitted)
+ *   SLOT_CONST   in constant `index`
+ *   SLOT_TRUE / SLOT_FALSE
+ *
+ * Instructions read their operands from wherever the values are, so local
+ * and constant loads emit nothing. A value is materialized (written to its
+ * own register) only where it has to be there: call arguments, before the
+ * register it copies is overwritten, and at every jump and jump target, so
+ * that all paths into a label agree on every register.
+ *
+ * A copy always refers to a SLOT_REG position (reading a local that is not
+ * materialized copies its slot instead), so materializing never reads a
+ * register that is not written yet.
+ *
+ * Peepholes:
+ *   - `x = <expr>` writes <expr>'s instruction straight into x's register
+ *     (the instruction's destination is rewritten), so `i = i + 1` is one
+ *     REG_ADDK.
+ *   - A comparison followed by OP_JUMP_IF_FALSE_POP becomes one
+ *     compare-and-branch.
+ *
+ * Code after an unconditional transfer that no jump lands on is
+ * unreachable and dropped (its stack depth is not known).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "vm/regcode.h"
+#include "vm/opcode.h"
+#include "vm/memory.h"
+
+typedef enum {
+    SLOT_REG,
+    SLOT_COPY,
+    SLOT_CONST,
+    SLOT_TRUE,
+    SLOT_FALSE,
+} SlotKind;
+
+typedef struct {
+    SlotKind kind;
+    int index;      // SLOT_COPY: source register, SLOT_CONST: constant index
+} StackSlot;
+
+// One decoded stack instruction
+typedef struct {
+    uint8_t op;
+    uint8_t operands[2];
+    int line;
+    int target;     // Jumps: index of the target instruction (count = end of chunk)
+} Instr;
+
+// A forward jump waiting for its target's offset
+typedef struct {
+    int at;         // Offset of the 2-byte distance operand
+    int target;     // Instruction index it lands on
+} Patch;
+
+typedef struct {
+    ObjFunction* function;
+    const Chunk* chunk;
+    Instr* in;
+    int count;
+    int* depthAt;   // Stack depth on entry to each instruction seen from a jump (-1 unknown)
+    int* labelAt;   // Output offset of each instruction (-1 not emitted)
+    bool* isTarget;
+
+    // Output
+    uint8_t* code;
+    int* lines;
+    int codeCount;
+    int codeCapacity;
+    Patch* patches;
+    int patchCount;
+    int patchCapacity;
+
+    // Simulated operand stack
+    StackSlot stack[REGISTERS_MAX];
+    int refs[REGISTERS_MAX];    // SLOT_COPY entries reading each register
+    int depth;
+    int registers;              // Highest register written + 1
+    int line;                   // Line of the instruction being translated
+    int lastDst;                // Offset of the last instruction's destination operand (-1 none)
+    const char* error;
+} Translator;
+
+typedef struct {
+    ObjFunction* function;
+    uint8_t* code;
+    int* lines;
+    int count;
+    int registers;
+} Translation;
+
+static bool is_jump(uint8_t op) {
+    return op == OP_JUMP || op == OP_JUMP_IF_FALSE ||
+           op == OP_LOOP || op == OP_JUMP_IF_FALSE_POP ||
+           op == OP_JUMP_IF_NOT_LESS || op == OP_JUMP_IF_NOT_LESS_EQUAL ||
+           op == OP_JUMP_IF_NOT_GREATER || op == OP_JUMP_IF_NOT_GREATER_EQUAL;
+}
+
+static void fail(Translator* t, const char* error) {
+    if (t->error == NULL) t->error = error;
+}
+
+
+// --- Output ---
+
+static void emit_byte(Translator* t, uint8_t byte) {
+    if (t->codeCount == t->codeCapacity) {
+        int capacity = t->codeCapacity < 64 ? 64 : t->codeCapacity * 2;
+        uint8_t* code = (uint8_t*)realloc(t->code, capacity);
+        int* lines = (int*)realloc(t->lines, sizeof(int) * capacity);
+        if (code != NULL) t->code = code;
+        if (lines != NULL) t->lines = lines;
+        if (code == NULL || lines == NULL) {
+            fail(t, "out of memory");
+            return;
+        }
+        t->codeCapacity = capacity;
+    }
+    t->code[t->codeCount] = byte;
+    t->lines[t->codeCount] = t->line;
+    t->codeCount++;
+}
+
+static void emit_short(Translator* t, int value) {
+    emit_byte(t, (uint8_t)((value >> 8) & 0xff));
+    emit_byte(t, (uint8_t)(value & 0xff));
+}
+
+/**
+ * @brief Start an instruction that no later write may be folded into.
+ */
+static void emit_op(Translator* t, uint8_t op) {
+    t->lastDst = -1;
+    emit_byte(t, op);
+}
+
+static void use_register(Translator* t, int reg) {
+    if (reg + 1 > t->registers) t->registers = reg + 1;
+}
+
+/**
+ * @brief Start an instruction that only computes a value into `dst`;
+ * a following store to a local may retarget it (see store_local()).
+ */
+static void emit_def(Translator* t, uint8_t op, int dst) {
+    emit_op(t, op);
+    t->lastDst = t->codeCount;
+    emit_byte(t, (uint8_t)dst);
+    use_register(t, dst);
+}
+
+/**
+ * @brief Emit a forward jump's distance placeholder, patched at the end.
+ */
+static void emit_forward(Translator* t, int target) {
+    if (t->patchCount == t->patchCapacity) {
+        int capacity = t->patchCapacity < 16 ? 16 : t->patchCapacity * 2;
+        Patch* patches = (Patch*)realloc(t->patches, sizeof(Patch) * capacity);
+        if (patches == NULL) {
+            fail(t, "out of memory");
+            return;
+        }
+        t->patches = patches;
+        t->patchCapacity = capacity;
+    }
+    t->patches[t->patchCount].at = t->codeCount;
+    t->patches[t->patchCount].target = target;
+    t->patchCount++;
+    emit_short(t, 0xffff);
+}
+
+
+// --- Simulated stack ---
+
+static void push_slot(Translator* t, SlotKind kind, int index) {
+    if (t->depth >= REGISTERS_MAX) {
+        fail(t, "needs more registers than the register VM has");
+        return;
+    }
+    t->stack[t->depth].kind = kind;
+    t->stack[t->depth].index = index;
+    if (kind == SLOT_COPY) t->refs[index]++;
+    t->depth++;
+}
+
+static void pop_slot(Translator* t) {
+    if (t->depth == 0) {
+        fail(t, "stack underflow");
+        return;
+    }
+    StackSlot* slot = &t->stack[--t->depth];
+    if (slot->kind == SLOT_COPY) t->refs[slot->index]--;
+}
+
+/**
+ * @brief Write the value of stack position `pos` into register `pos`.
+ */
+static void materialize(Translator* t, int pos) {
+    StackSlot* slot = &t->stack[pos];
+    switch (slot->kind) {
+        case SLOT_REG:
+            return;
+        case SLOT_COPY:
+            emit_def(t, REG_MOVE, pos);
+            emit_byte(t, (uint8_t)slot->index);
+            t->refs[slot->index]--;
+            break;
+        case SLOT_CONST:
+            if (slot->index <= UINT8_MAX) {
+                emit_def(t, REG_LOADK, pos);
+                emit_byte(t, (uint8_t)slot->index);
+            } else {
+                emit_def(t, REG_LOADK_LONG, pos);
+                emit_short(t, slot->index);
+            }
+            break;
+        case SLOT_TRUE:
+            emit_def(t, REG_TRUE, pos);
+            break;
+        case SLOT_FALSE:
+            emit_def(t, REG_FALSE, pos);
+            break;
+    }
+    slot->kind = SLOT_REG;
+    slot->index = pos;
+}
+
+/**
+ * @brief Register holding the value of stack position `pos`
+ * (materializing it if it is a constant).
+ */
+static int operand(Translator* t, int pos) {
+    StackSlot* slot = &t->stack[pos];
+    if (slot->kind == SLOT_COPY) return slot->index;
+    materialize(t, pos);
+    return pos;
+}
+
+/**
+ * @brief Materialize every position on the stack (jumps and labels).
+ */
+static void flush(Translator* t) {
+    for (int pos = 0; pos < t->depth; pos++) materialize(t, pos);
+}
+
+/**
+ * @brief Before register `reg` is overwritten, give the stack entries
+ * that still read it their own copy.
+ */
+static void prepare_write(Translator* t, int reg) {
+    for (int pos = reg + 1; t->refs[reg] > 0 && pos < t->depth; pos++) {
+        if (t->stack[pos].kind == SLOT_COPY && t->stack[pos].index == reg) materialize(t, pos);
+    }
+}
+
+/**
+ * @brief Record the stack depth a jump arrives with at instruction `target`.
+ */
+static void arrive(Translator* t, int target, int depth) {
+    if (t->depthAt[target] < 0) {
+        t->depthAt[target] = depth;
+    } else if (t->depthAt[target] != depth) {
+        fail(t, "inconsistent stack depth at a jump target");
+    }
+}
+
+static bool is_int_constant(Translator* t, const StackSlot* slot) {
+    return slot->kind == SLOT_CONST && slot->index <= UINT8_MAX &&
+           IS_INT(t->chunk->constants.values[slot->index]);
+}
+
+
+// --- Instructions ---
+
+static void get_local(Translator* t, int slot) {
+    if (slot >= t->depth) {
+        fail(t, "reads a local that is not on the stack");
+        return;
+    }
+    StackSlot* local = &t->stack[slot];
+    if (local->kind == SLOT_REG) push_slot(t, SLOT_COPY, slot);
+    else push_slot(t, local->kind, local->index);
+}
+
+/**
+ * @brief OP_SET_LOCAL: store the top of the stack into local `slot`
+ * (the value stays on the stack).
+ */
+static void store_local(Translator* t, int slot) {
+    if (slot >= t->depth - 1) {
+        fail(t, "writes a local that is not on the stack");
+        return;
+    }
+    int top = t->depth - 1;
+    StackSlot* value = &t->stack[top];
+    if (value->kind == SLOT_COPY && value->index == slot) return; // x = x
+
+    prepare_write(t, slot);
+
+    if (value->kind == SLOT_REG && t->lastDst >= 0 && t->code[t->lastDst] == top) {
+        // The value was just computed into its own register: compute it
+        // into the local instead
+        t->code[t->lastDst] = (uint8_t)slot;
+        use_register(t, slot);
+        value->kind = SLOT_COPY;
+        value->index = slot;
+        t->refs[slot]++;
+    } else {
+        switch (value->kind) {
+            case SLOT_REG:
+            case SLOT_COPY:
+                emit_def(t, REG_MOVE, slot);
+                emit_byte(t, (uint8_t)(value->kind == SLOT_REG ? top : value->index));
+                break;
+            case SLOT_CONST:
+                if (value->index <= UINT8_MAX) {
+                    emit_def(t, REG_LOADK, slot);
+                    emit_byte(t, (uint8_t)value->index);
+                } else {
+                    emit_def(t, REG_LOADK_LONG, slot);
+                    emit_short(t, value->index);
+                }
+                break;
+            case SLOT_TRUE:
+                emit_def(t, REG_TRUE, slot);
+                break;
+            case SLOT_FALSE:
+                emit_def(t, REG_FALSE, slot);
+                break;
+        }
+    }
+
+    t->stack[slot].kind = SLOT_REG;
+    t->stack[slot].index = slot;
+}
+
+static void get_global(Translator* t, int global) {
+    if (t->depth >= REGISTERS_MAX) {
+        fail(t, "needs more registers than the register VM has");
+        return;
+    }
+    emit_def(t, REG_GET_GLOBAL, t->depth);
+    emit_short(t, global);
+    push_slot(t, SLOT_REG, t->depth);
+}
+
+/**
+ * @brief OP_SET_GLOBAL: store the top of the stack into `global` (the
+ * value stays on the stack).
+ */
+static void set_global(Translator* t, int global) {
+    if (t->depth < 1) {
+        fail(t, "stack underflow");
+        return;
+    }
+    int value = operand(t, t->depth - 1);
+    emit_op(t, REG_SET_GLOBAL);
+    emit_short(t, global);
+    emit_byte(t, (uint8_t)value);
+}
+
+/**
+ * @brief A binary stack opcode: pop two, push `op`'s result.
+ *
+ * @param constOp The form taking an int constant as the right operand (-1 if none).
+ */
+static void binary(Translator* t, uint8_t op, int constOp) {
+    if (t->depth < 2) {
+        fail(t, "stack underflow");
+        return;
+    }
+    int left = t->depth - 2;
+    StackSlot right = t->stack[t->depth - 1];
+
+    if (constOp >= 0 && is_int_constant(t, &right)) {
+        int a = operand(t, left);
+        pop_slot(t);
+        pop_slot(t);
+        emit_def(t, (uint8_t)constOp, left);
+        emit_byte(t, (uint8_t)a);
+        emit_byte(t, (uint8_t)right.index);
+    } else {
+        int a = operand(t, left);
+        int b = operand(t, left + 1);
+        pop_slot(t);
+        pop_slot(t);
+        emit_def(t, op, left);
+        emit_byte(t, (uint8_t)a);
+        emit_byte(t, (uint8_t)b);
+    }
+    push_slot(t, SLOT_REG, left);
+}
+
+static void unary(Translator* t, uint8_t op) {
+    if (t->depth < 1) {
+        fail(t, "stack underflow");
+        return;
+    }
+    int pos = t->depth - 1;
+    int a = operand(t, pos);
+    pop_slot(t);
+    emit_def(t, op, pos);
+    emit_byte(t, (uint8_t)a);
+    push_slot(t, SLOT_REG, pos);
+}
+
+/**
+ * @brief A comparison whose result is only tested by the OP_JUMP_IF_FALSE_POP
+ * that follows: one compare-and-branch.
+ */
+static void compare_branch(Translator* t, uint8_t branchOp, int constOp, int target) {
+    if (t->depth < 2) {
+        fail(t, "stack underflow");
+        return;
+    }
+    int left = t->depth - 2;
+    StackSlot right = t->stack[t->depth - 1];
+    bool constant = constOp >= 0 && is_int_constant(t, &right);
+
+    int a = operand(t, left);
+    int b = constant ? right.index : operand(t, left + 1);
+    pop_slot(t);
+    pop_slot(t);
+    flush(t);
+
+    emit_op(t, (uint8_t)(constant ? constOp : branchOp));
+    emit_byte(t, (uint8_t)a);
+    emit_byte(t, (uint8_t)b);
+    emit_forward(t, target);
+    arrive(t, target, t->depth);
+}
+
+/**
+ * @brief Materialize the callee and arguments of a call at `base`.
+ */
+static void call_operands(Translator* t, int base) {
+    if (base < 0) {
+        fail(t, "stack underflow");
+        return;
+    }
+    for (int pos = base; pos < t->depth; pos++) materialize(t, pos);
+    while (t->depth > base) pop_slot(t);
+}
+
+/**
+ * @brief Map a stack comparison to its register form, its
+ * compare-and-branch form and their int constant forms.
+ *
+ * @return false if `op` is not a comparison.
+ */
+static bool comparison(uint8_t op, uint8_t* regOp, uint8_t* branchOp, int* branchConstOp) {
+    *branchConstOp = -1;
+    switch (op) {
+        case OP_EQUAL:
+        case OP_EQUAL_INT:
+            *regOp = REG_EQUAL;
+            *branchOp = REG_JUMP_IF_NOT_EQUAL;
+            return true;
+        case OP_NOT_EQUAL:
+        case OP_NOT_EQUAL_INT:
+            *regOp = REG_NOT_EQUAL;
+            *branchOp = REG_JUMP_IF_NOT_NOT_EQUAL;
+            return true;
+        case OP_LESS:
+        case OP_LESS_INT:
+            *regOp = REG_LESS;
+            *branchOp = REG_JUMP_IF_NOT_LESS;
+            *branchConstOp = REG_JUMP_IF_NOT_LESSK;
+            return true;
+        case OP_LESS_EQUAL:
+        case OP_LESS_EQUAL_INT:
+            *regOp = REG_LESS_EQUAL;
+            *branchOp = REG_JUMP_IF_NOT_LESS_EQUAL;
+            *branchConstOp = REG_JUMP_IF_NOT_LESS_EQUALK;
+            return true;
+        case OP_GREATER:
+        case OP_GREATER_INT:
+            *regOp = REG_GREATER;
+            *branchOp = REG_JUMP_IF_NOT_GREATER;
+            *branchConstOp = REG_JUMP_IF_NOT_GREATERK;
+            return true;
+        case OP_GREATER_EQUAL:
+        case OP_GREATER_EQUAL_INT:
+            *regOp = REG_GREATER_EQUAL;
+            *branchOp = REG_JUMP_IF_NOT_GREATER_EQUAL;
+            *branchConstOp = REG_JUMP_IF_NOT_GREATER_EQUALK;
+            return true;
+        default:
+            return false;
+    }
+}
+
+/**
+ * @brief Translate instruction `i`.
+ *
+ * @return Number of stack instructions consumed.
+ */
+static int translate_instruction(Translator* t, int i) {
+    Instr* instr = &t->in[i];
+    int depth = t->depth;
+    uint8_t regOp, branchOp;
+    int branchConstOp;
+
+    if (comparison(instr->op, &regOp, &branchOp, &branchConstOp)) {
+        if (i + 1 < t->count && t->in[i + 1].op == OP_JUMP_IF_FALSE_POP && !t->isTarget[i + 1]) {
+            compare_branch(t, branchOp, branchConstOp, t->in[i + 1].target);
+            return 2;
+        }
+        binary(t, regOp, -1);
+        return 1;
+    }
+
+    switch (instr->op) {
+        case OP_CONSTANT:
+            push_slot(t, SLOT_CONST, instr->operands[0]);
+            break;
+        case OP_CONSTANT_LONG:
+            push_slot(t, SLOT_CONST, (instr->operands[0] << 8) | instr->operands[1]);
+            break;
+        case OP_TRUE:
+            push_slot(t, SLOT_TRUE, 0);
+            break;
+        case OP_FALSE:
+            push_slot(t, SLOT_FALSE, 0);
+            break;
+        case OP_NIL:
+        case OP_CLOSURE:
+            break; // No-ops on the stack VM too
+
+        case OP_GET_GLOBAL:
+        case OP_GET_GLOBAL_LONG:
+            get_global(t, instr->op == OP_GET_GLOBAL ? instr->operands[0]
+                          : (instr->operands[0] << 8) | instr->operands[1]);
+            break;
+        case OP_SET_GLOBAL:
+        case OP_SET_GLOBAL_LONG:
+            set_global(t, instr->op == OP_SET_GLOBAL ? instr->operands[0]
+                          : (instr->operands[0] << 8) | instr->operands[1]);
+            break;
+
+        case OP_GET_LOCAL:
+            get_local(t, instr->operands[0]);
+            break;
+        case OP_SET_LOCAL:
+            store_local(t, instr->operands[0]);
+            break;
+        case OP_GET_LOCAL_LONG:
+        case OP_SET_LOCAL_LONG:
+            fail(t, "needs more registers than the register VM has");
+            break;
+
+        case OP_POP:
+            pop_slot(t);
+            break;
+        case OP_POPN:
+            for (int i = 0; i < instr->operands[0]; i++) pop_slot(t);
+            break;
+
+        case OP_ADD:
+            binary(t, REG_ADD, REG_ADDK);
+            break;
+        case OP_ADD_INT:
+            binary(t, REG_ADD_INT, REG_ADDK);
+            break;
+        case OP_SUBTRACT:
+            binary(t, REG_SUBTRACT, REG_SUBTRACTK);
+            break;
+        case OP_SUBTRACT_INT:
+            binary(t, REG_SUBTRACT_INT, REG_SUBTRACTK);
+            break;
+        case OP_MULTIPLY:
+            binary(t, REG_MULTIPLY, -1);
+            break;
+        case OP_MULTIPLY_INT:
+            binary(t, REG_MULTIPLY_INT, -1);
+            break;
+        case OP_DIVIDE:
+            binary(t, REG_DIVIDE, -1);
+            break;
+        case OP_DIVIDE_INT:
+            binary(t, REG_DIVIDE_INT, -1);
+            break;
+        case OP_MODULO:
+            binary(t, REG_MODULO, -1);
+            break;
+        case OP_MODULO_INT:
+            binary(t, REG_MODULO_INT, -1);
+            break;
+        case OP_CONCAT:
+            binary(t, REG_CONCAT, -1);
+            break;
+        case OP_NEGATE:
+            unary(t, REG_NEGATE);
+            break;
+        case OP_NOT:
+            unary(t, REG_NOT);
+            break;
+
+        // Superinstructions: replay the sequences they stand for
+        case OP_ADD_CONST:
+            push_slot(t, SLOT_CONST, instr->operands[0]);
+            binary(t, REG_ADD, REG_ADDK);
+            break;
+        case OP_SUBTRACT_CONST:
+            push_slot(t, SLOT_CONST, instr->operands[0]);
+            binary(t, REG_SUBTRACT, REG_SUBTRACTK);
+            break;
+        case OP_ADD_LOCALS:
+            get_local(t, instr->operands[0]);
+            get_local(t, instr->operands[1]);
+            binary(t, REG_ADD, REG_ADDK);
+            break;
+        case OP_ADD_LOCAL_CONST:
+            get_local(t, instr->operands[0]);
+            push_slot(t, SLOT_CONST, instr->operands[1]);
+            binary(t, REG_ADD, REG_ADDK);
+            break;
+        case OP_INC_LOCAL:
+            get_local(t, instr->operands[0]);
+            push_slot(t, SLOT_CONST, instr->operands[1]);
+            binary(t, REG_ADD, REG_ADDK);
+            store_local(t, instr->operands[0]);
+            pop_slot(t);
+            break;
+        case OP_INC_GLOBAL:
+            get_global(t, instr->operands[0]);
+            push_slot(t, SLOT_CONST, instr->operands[1]);
+            binary(t, REG_ADD, REG_ADDK);
+            set_global(t, instr->operands[0]);
+            pop_slot(t);
+            break;
+        case OP_JUMP_IF_NOT_LESS:
+            compare_branch(t, REG_JUMP_IF_NOT_LESS, REG_JUMP_IF_NOT_LESSK, instr->target);
+            break;
+        case OP_JUMP_IF_NOT_LESS_EQUAL:
+            compare_branch(t, REG_JUMP_IF_NOT_LESS_EQUAL, REG_JUMP_IF_NOT_LESS_EQUALK, instr->target);
+            break;
+        case OP_JUMP_IF_NOT_GREATER:
+            compare_branch(t, REG_JUMP_IF_NOT_GREATER, REG_JUMP_IF_NOT_GREATERK, instr->target);
+            break;
+        case OP_JUMP_IF_NOT_GREATER_EQUAL:
+            compare_branch(t, REG_JUMP_IF_NOT_GREATER_EQUAL, REG_JUMP_IF_NOT_GREATER_EQUALK, instr->target);
+            break;
+
+        case OP_JUMP:
+            flush(t);
+            emit_op(t, REG_JUMP);
+            emit_forward(t, instr->target);
+            arrive(t, instr->target, t->depth);
+            return -1;
+
+        case OP_LOOP: {
+            flush(t);
+            if (t->labelAt[instr->target] < 0 || t->depthAt[instr->target] != t->depth) {
+                fail(t, "inconsistent stack depth at a loop");
+                break;
+            }
+            emit_op(t, REG_LOOP);
+            int distance = t->codeCount + 2 - t->labelAt[instr->target];
+            if (distance > UINT16_MAX) fail(t, "has a loop too large for register code");
+            emit_short(t, distance);
+            return -1;
+        }
+
+        case OP_JUMP_IF_FALSE:
+            if (depth < 1) {
+                fail(t, "stack underflow");
+                break;
+            }
+            flush(t);
+            emit_op(t, REG_JUMP_IF_FALSE);
+            emit_byte(t, (uint8_t)(depth - 1));
+            emit_forward(t, instr->target);
+            arrive(t, instr->target, t->depth);
+            break;
+
+        case OP_JUMP_IF_FALSE_POP: {
+            if (depth < 1) {
+                fail(t, "stack underflow");
+                break;
+            }
+            StackSlot condition = t->stack[depth - 1];
+            if (condition.kind == SLOT_TRUE || condition.kind == SLOT_CONST) {
+                pop_slot(t); // Never false: never jumps
+                break;
+            }
+            if (condition.kind == SLOT_FALSE) {
+                pop_slot(t);
+                flush(t);
+                emit_op(t, REG_JUMP);
+                emit_forward(t, instr->target);
+                arrive(t, instr->target, t->depth);
+                return -1;
+            }
+            int reg = operand(t, depth - 1);
+            pop_slot(t);
+            flush(t);
+            emit_op(t, REG_JUMP_IF_FALSE);
+            emit_byte(t, (uint8_t)reg);
+            emit_forward(t, instr->target);
+            arrive(t, instr->target, t->depth);
+            break;
+        }
+
+        case OP_CALL:
+        case OP_TAIL_CALL: {
+            int argCount = instr->operands[0];
+            int base = depth - argCount - 1;
+            call_operands(t, base);
+            emit_op(t, instr->op == OP_CALL ? REG_CALL : REG_TAIL_CALL);
+            emit_byte(t, (uint8_t)base);
+            emit_byte(t, (uint8_t)argCount);
+            push_slot(t, SLOT_REG, base);
+            if (instr->op == OP_TAIL_CALL) return -1;
+            break;
+        }
+
+        case OP_CALL_DIRECT:
+        case OP_TAIL_CALL_DIRECT:
+        case OP_CALL_DIRECT_0:
+        case OP_CALL_DIRECT_1:
+        case OP_CALL_DIRECT_2:
+        case OP_CALL_DIRECT_3: {
+            int argCount = instr->op == OP_CALL_DIRECT || instr->op == OP_TAIL_CALL_DIRECT
+                         ? instr->operands[1] : instr->op - OP_CALL_DIRECT_0;
+            int base = depth - argCount;
+            if (depth >= REGISTERS_MAX) {
+                fail(t, "needs more registers than the register VM has");
+                break;
+            }
+            call_operands(t, base);
+            emit_op(t, instr->op == OP_TAIL_CALL_DIRECT ? REG_TAIL_CALL_DIRECT : REG_CALL_DIRECT);
+            emit_byte(t, (uint8_t)base);
+            emit_byte(t, instr->operands[0]);
+            emit_byte(t, (uint8_t)argCount);
+            use_register(t, depth); // The arguments move up one to make room for the callee
+            push_slot(t, SLOT_REG, base);
+            if (instr->op == OP_TAIL_CALL_DIRECT) return -1;
+            break;
+        }
+
+        case OP_PRINT: {
+            if (depth < 1) {
+                fail(t, "stack underflow");
+                break;
+            }
+            int value = operand(t, depth - 1);
+            pop_slot(t);
+            emit_op(t, REG_PRINT);
+            emit_byte(t, (uint8_t)value);
+            break;
+        }
+
+        case OP_RETURN:
+            if (depth == 0) {
+                // An empty script stack returns false (see the stack VM)
+                emit_def(t, REG_FALSE, 0);
+                emit_op(t, REG_RETURN);
+                emit_byte(t, 0);
+            } else {
+                int value = operand(t, depth - 1);
+                pop_slot(t);
+                emit_op(t, REG_RETURN);
+                emit_byte(t, (uint8_t)value);
+            }
+            return -1;
+
+        default:
+            fail(t, "contains an unknown opcode");
+            break;
+    }
+    return 1;
+}
+
+/**
+ * @brief Decode `chunk` and resolve every jump to an instruction index.
+ */
+static bool decode(Translator* t) {
+    const Chunk* chunk = t->chunk;
+    int* indexAt = (int*)malloc(sizeof(int) * (chunk->count + 1));
+    if (indexAt == NULL) return false;
+
+    for (int i = 0; i <= chunk->count; i++) indexAt[i] = -1;
+
+    int* offsets = (int*)malloc(sizeof(int) * (chunk->count + 1));
+    if (offsets == NULL) {
+        free(indexAt);
+        return false;
+    }
+
+    t->count = 0;
+    bool ok = true;
+    for (int offset = 0; offset < chunk->count && ok; ) {
+        Instr* instr = &t->in[t->count];
+        int length = opcode_length(chunk->code[offset]);
+        if (offset + length > chunk->count) {
+            ok = false;
+            break;
+        }
+        instr->op = chunk->code[offset];
+        instr->line = get_line(chunk, offset);
+        instr->target = -1;
+        for (int k = 1; k < length; k++) instr->operands[k - 1] = chunk->code[offset + k];
+        offsets[t->count] = offset;
+        indexAt[offset] = t->count++;
+        offset += length;
+    }
+    indexAt[chunk->count] = t->count;
+
+    for (int i = 0; i < t->count && ok; i++) {
+        Instr* instr = &t->in[i];
+        if (!is_jump(instr->op)) continue;
+
+        int distance = (instr->operands[0] << 8) | instr->operands[1];
+        int targetOffset = instr->op == OP_LOOP ? offsets[i] + 3 - distance
+                                                : offsets[i] + 3 + distance;
+        if (targetOffset < 0 || targetOffset > chunk->count || indexAt[targetOffset] < 0) {
+            ok = false;
+            break;
+        }
+        instr->target = indexAt[targetOffset];
+        if ((instr->op == OP_LOOP) != (instr->target <= i)) ok = false; // Only loops jump back
+        t->isTarget[instr->target] = true;
+    }
+
+    free(offsets);
+    free(indexAt);
+    return ok;
+}
+
+/**
+ * @brief Translate one function's code into `out` (its chunk is not touched).
+ */
+static bool translate_function(ObjFunction* function, Translation* out) {
+    const Chunk* chunk = &function->chunk;
+    Translator* t = (Translator*)calloc(1, sizeof(Translator));
+    if (t == NULL) return false;
+
+    t->function = function;
+    t->chunk = chunk;
+    t->lastDst = -1;
+    t->in = (Instr*)malloc(sizeof(Instr) * (chunk->count + 1));
+    t->depthAt = (int*)malloc(sizeof(int) * (chunk->count + 1));
+    t->labelAt = (int*)malloc(sizeof(int) * (chunk->count + 1));
+    t->isTarget = (bool*)calloc(chunk->count + 1, sizeof(bool));
+
+    if (t->in == NULL || t->depthAt == NULL || t->labelAt == NULL || t->isTarget == NULL) {
+        fail(t, "out of memory");
+    } else if (!decode(t)) {
+        fail(t, "contains malformed bytecode");
+    }
+
+    if (t->error == NULL) {
+        for (int i = 0; i <= t->count; i++) {
+            t->depthAt[i] = -1;
+            t->labelAt[i] = -1;
+        }
+
+        // The callee and the parameters are in their slots already
+        if (function->name != NULL) {
+            for (int slot = 0; slot <= function->arity; slot++) push_slot(t, SLOT_REG, slot);
+            use_register(t, function->arity);
+        }
+
+        bool reachable = true;
+        for (int i = 0; i < t->count && t->error == NULL; ) {
+            t->line = t->in[i].line;
+
+            if (t->isTarget[i]) {
+                if (reachable) {
+                    flush(t);
+                    arrive(t, i, t->depth);
+                } else if (t->depthAt[i] >= 0) {
+                    // Only reached by jumps: everything is in its register
+                    memset(t->refs, 0, sizeof(t->refs));
+                    t->depth = 0;
+                    for (int pos = 0; pos < t->depthAt[i]; pos++) push_slot(t, SLOT_REG, pos);
+                    reachable = true;
+                }
+                t->lastDst = -1;
+            }
+
+            if (!reachable) {
+                i++; // Dead code
+                continue;
+            }
+
+            t->labelAt[i] = t->codeCount;
+            int consumed = translate_instruction(t, i);
+            if (consumed < 0) {
+                reachable = false;
+                consumed = 1;
+            }
+            i += consumed;
+        }
+
+        // Jumps to the end of the chunk land after the last instruction
+        t->labelAt[t->count] = t->codeCount;
+
+        for (int i = 0; i < t->patchCount && t->error == NULL; i++) {
+            Patch* patch = &t->patches[i];
+            int distance = t->labelAt[patch->target] - (patch->at + 2);
+            if (t->labelAt[patch->target] < 0) {
+                fail(t, "jumps into unreachable code");
+            } else if (distance > UINT16_MAX) {
+                fail(t, "has a jump too long for register code");
+            } else {
+                t->code[patch->at] = (uint8_t)((distance >> 8) & 0xff);
+                t->code[patch->at + 1] = (uint8_t)(distance & 0xff);
+            }
+        }
+    }
+
+    bool ok = t->error == NULL;
+    if (ok) {
+        out->function = function;
+        out->code = t->code;
+        out->lines = t->lines;
+        out->count = t->codeCount;
+        out->registers = t->registers > 0 ? t->registers : 1;
+    } else {
+        fprintf(stderr, "Compiler Error: %s%s%s %s.\n",
+                function->name != NULL ? "function '" : "the script",
+                function->name != NULL ? function->name->chars : "",
+                function->name != NULL ? "'" : "",
+                t->error);
+        free(t->code);
+        free(t->lines);
+    }
+
+    free(t->in);
+    free(t->depthAt);
+    free(t->labelAt);
+    free(t->isTarget);
+    free(t->patches);
+    free(t);
+    return ok;
+}
+
+/**
+ * @brief Replace a function's stack code by its translation.
+ */
+static void install(Translation* translation) {
+    Chunk* chunk = &translation->function->chunk;
+
+    if (translation->count > chunk->capacity) {
+        chunk->code = (uint8_t*)reallocate(chunk->code, chunk->capacity, translation->count);
+        chunk->capacity = translation->count;
+    }
+    memcpy(chunk->code, translation->code, translation->count);
+    chunk->count = translation->count;
+
+    chunk->lineCount = 0;
+    for (int i = 0; i < translation->count; i++) add_line(chunk, i, translation->lines[i]);
+    translation->function->registers = translation->registers;
+
+    free(translation->code);
+    free(translation->lines);
+}
+
+bool translate_to_registers(ObjFunction* script) {
+    if (script->registers != 0) return true;
+
+    // Functions found but not translated yet are marked with registers = -1
+    int capacity = 8;
+    int count = 0;      // Functions found
+    int translated = 0; // Of which translated
+    Translation* translations = (Translation*)malloc(sizeof(Translation) * capacity);
+    ObjFunction** found = (ObjFunction**)malloc(sizeof(ObjFunction*) * capacity);
+    bool ok = translations != NULL && found != NULL;
+    if (!ok) fprintf(stderr, "Fatal: Out of memory.\n");
+
+    if (ok) {
+        found[count++] = script;
+        script->registers = -1;
+    }
+
+    while (ok && translated < count) {
+        ObjFunction* function = found[translated];
+        ok = translate_function(function, &translations[translated]);
+        if (!ok) break;
+        translated++;
+
+        ValueArray* constants = &function->chunk.constants;
+        for (int i = 0; ok && i < constants->count; i++) {
+            Value constant = constants->values[i];
+            if (!IS_FUNCTION(constant) || AS_FUNCTION(constant)->registers != 0) continue;
+
+            if (count == capacity) {
+                capacity *= 2;
+                Translation* grownTranslations = (Translation*)realloc(translations, sizeof(Translation) * capacity);
+                if (grownTranslations != NULL) translations = grownTranslations;
+                ObjFunction** grownFound = (ObjFunction**)realloc(found, sizeof(ObjFunction*) * capacity);
+                if (grownFound != NULL) found = grownFound;
+                if (grownTranslations == NULL || grownFound == NULL) {
+                    fprintf(stderr, "Fatal: Out of memory.\n");
+                    ok = false;
+                    break;
+                }
+            }
+            found[count++] = AS_FUNCTION(constant);
+            AS_FUNCTION(constant)->registers = -1;
+        }
+    }
+
+    if (ok) {
+        for (int i = 0; i < count; i++) install(&translations[i]);
+    } else {
+        for (int i = 0; i < translated; i++) {
+            free(translations[i].code);
+            free(translations[i].lines);
+        }
+        for (int i = 0; i < count; i++) found[i]->registers = 0;
+    }
+
+    free(translations);
+    free(found);
+    return ok;
+}
@@ -0,0 +1,778 @@
+/**
+ * @file serialize.c
+ * @brief Reading and writing the .detc bytecode cache and heap snapshots.
+ *
+ * Writing builds the whole file in a malloc'd buffer and renames it into
+ * place. Reading maps the file (see file_map.h) and
+ * decodes it through a bounds-checked cursor; any mismatch or malformed
+ * field makes the loader give up and return NULL.
+ *
+ * Objects created while loading are kept on the VM stack until they are
+ * reachable from their parent function, so a GC triggered mid-load cannot
+ * free them. A snapshot's global values are constants of the unit that
+ * load_heap_snapshot() returns until the whole file has been decoded.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "file_map.h"
+#include "vm/serialize.h"
+#include "vm/compiler.h"
+#include "vm/opcode.h"
+#include "vm/vm.h"
+#include "typechecker.h"
+
+#define DETC_MAGIC "DETC"
+#define DETC_OPCODE_COUNT ((uint32_t)OP_RETURN + 1)
+#define DETC_HEADER_SIZE 32 // magic, version, opcode count, flags, source hash, body hash
+
+#define DETS_MAGIC "DETS"
+#define DETS_HEADER_SIZE 20 // magic, version, opcode count, body hash
+
+// Nested function declarations deeper than this are not cached
+#define DETC_MAX_DEPTH 32
+
+/**
+ * @brief Constant tags in the file (independent of the in-memory Value layout).
+ */
+typedef enum {
+    DETC_CONST_BOOL,
+    DETC_CONST_INT,
+    DETC_CONST_STRING,
+    DETC_CONST_FUNCTION,
+    DETC_CONST_FUNCTION_REF, // u32 id: a function already in the file (OP_CALL_DIRECT targets)
+    DETC_CONST_STRING_REF    // u32 id: a string already in the file (each is stored once)
+} DetcConstant;
+
+/**
+ * @brief Snapshot global values besides the constant kinds (DetcConstant).
+ */
+typedef enum {
+    DETS_GLOBAL_UNSET = 16,  // Named, never assigned
+    DETS_GLOBAL_NATIVE       // The native the loading VM defines in that slot
+} DetsGlobal;
+
+/**
+ * @brief Functions in the order they appear in the file; a function's id is
+ * its index, assigned when its encoding starts (so it may refer to itself).
+ */
+typedef struct {
+    ObjFunction** items;
+    uint32_t count;
+    uint32_t capacity;
+} FunctionList;
+
+static bool function_list_add(FunctionList* list, ObjFunction* function) {
+    if (list->count == list->capacity) {
+        uint32_t capacity = list->capacity < 16 ? 16 : list->capacity * 2;
+        ObjFunction** items = (ObjFunction**)realloc(list->items, sizeof(ObjFunction*) * capacity);
+        if (items == NULL) return false;
+        list->items = items;
+        list->capacity = capacity;
+    }
+    list->items[list->count++] = function;
+    return true;
+}
+
+/**
+ * @brief Strings in the order they first appear in the file; a string's id is its index.
+ */
+typedef struct {
+    ObjString** items;
+    uint32_t count;
+    uint32_t capacity;
+} StringList;
+
+static bool string_list_add(StringList* list, ObjString* string) {
+    if (list->count == list->capacity) {
+        uint32_t capacity = list->capacity < 16 ? 16 : list->capacity * 2;
+        ObjString** items = (ObjString**)realloc(list->items, sizeof(ObjString*) * capacity);
+        if (items == NULL) return false;
+        list->items = items;
+        list->capacity = capacity;
+    }
+    list->items[list->count++] = string;
+    return true;
+}
+
+
+// =================
+// --- Writing ---
+// =================
+
+typedef struct {
+    uint8_t* data;
+    size_t count;
+    size_t capacity;
+    bool failed;
+    FunctionList functions; // Already written (see DETC_CONST_FUNCTION_REF)
+    StringList strings;     // Already written (see DETC_CONST_STRING_REF)
+} Writer;
+
+static void put_bytes(Writer* w, const void* bytes, size_t length) {
+    if (w->failed) return;
+
+    if (w->count + length > w->capacity) {
+        size_t capacity = w->capacity < 256 ? 256 : w->capacity;
+        while (capacity < w->count + length) capacity *= 2;
+
+        uint8_t* data = (uint8_t*)realloc(w->data, capacity);
+        if (data == NULL) {
+            w->failed = true;
+            return;
+        }
+        w->data = data;
+        w->capacity = capacity;
+    }
+
+    memcpy(w->data + w->count, bytes, length);
+    w->count += length;
+}
+
+static void put_u8(Writer* w, uint8_t value) {
+    put_bytes(w, &value, 1);
+}
+
+static void put_u32(Writer* w, uint32_t value) {
+    uint8_t bytes[4] = {
+        (uint8_t)value, (uint8_t)(value >> 8), (uint8_t)(value >> 16), (uint8_t)(value >> 24)
+    };
+    put_bytes(w, bytes, 4);
+}
+
+static void put_u64(Writer* w, uint64_t value) {
+    put_u32(w, (uint32_t)value);
+    put_u32(w, (uint32_t)(value >> 32));
+}
+
+static void put_function(Writer* w, ObjFunction* function, int depth);
+
+static void put_constant(Writer* w, Value value, int depth) {
+    if (IS_BOOL(value)) {
+        put_u8(w, DETC_CONST_BOOL);
+        put_u8(w, AS_BOOL(value) ? 1 : 0);
+    }
+    else if (IS_INT(value)) {
+        put_u8(w, DETC_CONST_INT);
+        put_u32(w, (uint32_t)AS_INT(value));
+    }
+    else if (IS_STRING(value)) {
+        ObjString* string = AS_STRING(value);
+        const char* chars = string_chars(string); // A global may hold a rope
+        // Interned: a string repeated in other functions is the same object
+        for (uint32_t id = 0; id < w->strings.count; id++) {
+            if (w->strings.items[id] == string) {
+                put_u8(w, DETC_CONST_STRING_REF);
+                put_u32(w, id);
+                return;
+            }
+        }
+        if (!string_list_add(&w->strings, string)) {
+            w->failed = true;
+            return;
+        }
+        put_u8(w, DETC_CONST_STRING);
+        put_u32(w, (uint32_t)string->length);
+        put_bytes(w, chars, (size_t)string->length);
+    }
+    else if (IS_FUNCTION(value)) {
+        ObjFunction* function = AS_FUNCTION(value);
+        for (uint32_t id = 0; id < w->functions.count; id++) {
+            if (w->functions.items[id] == function) {
+                put_u8(w, DETC_CONST_FUNCTION_REF);
+                put_u32(w, id);
+                return;
+            }
+        }
+        put_u8(w, DETC_CONST_FUNCTION);
+        put_function(w, function, depth + 1);
+    }
+    else {
+        w->failed = true; // Unknown constant kind, don't cache
+    }
+}
+
+static void put_function(Writer* w, ObjFunction* function, int depth) {
+    // The files hold stack code as the compiler wrote it: register code is
+    // translated from it on load, and verified or memoized code is rewritten
+    // for the VM that ran it
+    if (depth > DETC_MAX_DEPTH || function->registers != 0 || function->verified || function->memo != NULL) {
+        w->failed = true;
+        return;
+    }
+    if (!function_list_add(&w->functions, function)) {
+        w->failed = true;
+        return;
+    }
+
+    put_u32(w, (uint32_t)function->arity);
+    put_u32(w, (uint32_t)function->global);
+
+    if (function->name == NULL) {
+        put_u32(w, (uint32_t)-1);
+    } else {
+        put_u32(w, (uint32_t)function->name->length);
+        put_bytes(w, function->name->chars, (size_t)function->name->length);
+    }
+
+    Chunk* chunk = &function->chunk;
+    put_u32(w, (uint32_t)chunk->count);
+    put_bytes(w, chunk->code, (size_t)chunk->count);
+    put_u32(w, (uint32_t)chunk->lineCount);
+    for (int i = 0; i < chunk->lineCount; i++) {
+        put_u32(w, (uint32_t)chunk->lines[i].offset);
+        put_u32(w, (uint32_t)chunk->lines[i].line);
+    }
+
+    put_u32(w, (uint32_t)chunk->constants.count);
+    for (int i = 0; i < chunk->constants.count; i++) {
+        put_constant(w, chunk->constants.values[i], depth);
+    }
+}
+
+uint64_t hash_source(const char* source, size_t length) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < length; i++) {
+        hash ^= (uint8_t)source[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+/**
+ * @brief Patch the body hash (the header's last field) into `w`, write it
+ * to `path` and free it.
+ */
+static bool finish_file(Writer* w, const char* path, size_t headerSize) {
+    // Checksum everything after the header so a damaged file is rejected
+    size_t total = w->count;
+    w->count = headerSize - 8;
+    put_u64(w, hash_source((const char*)w->data + headerSize, total - headerSize));
+    w->count = total;
+
+    // Write to "<path>.tmp" and rename over the old file
+    size_t pathLength = strlen(path);
+    char* tmpPath = (char*)malloc(pathLength + 5);
+    if (tmpPath == NULL) {
+        free(w->data);
+        return false;
+    }
+    memcpy(tmpPath, path, pathLength);
+    memcpy(tmpPath + pathLength, ".tmp", 5);
+
+    bool ok = false;
+    FILE* file = fopen(tmpPath, "wb");
+    if (file != NULL) {
+        ok = fwrite(w->data, 1, w->count, file) == w->count;
+        ok = (fclose(file) == 0) && ok;
+    }
+
+    if (ok) {
+        #ifdef _WIN32
+        remove(path); // rename() does not replace an existing file on Windows
+        #endif
+        ok = rename(tmpPath, path) == 0;
+    }
+    if (!ok) remove(tmpPath);
+
+    free(tmpPath);
+    free(w->data);
+    return ok;
+}
+
+bool write_bytecode_cache(const char* path, ObjFunction* function, int priorGlobals,
+                          uint64_t sourceHash, uint32_t flags) {
+    Writer w = {NULL, 0, 0, false, {NULL, 0, 0}, {NULL, 0, 0}};
+
+    // Header
+    put_bytes(&w, DETC_MAGIC, 4);
+    put_u32(&w, DETC_FORMAT_VERSION);
+    put_u32(&w, DETC_OPCODE_COUNT);
+    put_u32(&w, flags);
+    put_u64(&w, sourceHash);
+    put_u64(&w, 0); // body hash, patched by finish_file()
+
+    // Global slot names and types, in slot order
+    int globalCount = compiler_global_count();
+    put_u32(&w, (uint32_t)globalCount);
+    put_u32(&w, (uint32_t)priorGlobals);
+    for (int i = 0; i < globalCount; i++) {
+        int length = 0;
+        const char* name = compiler_global_name(i, &length);
+        DataType varType, returnType;
+        typechecker_global_types(name, length, &varType, &returnType);
+        put_u32(&w, (uint32_t)length);
+        put_bytes(&w, name, (size_t)length);
+        put_u8(&w, (uint8_t)varType);
+        put_u8(&w, (uint8_t)returnType);
+    }
+
+    put_function(&w, function, 0);
+    free(w.functions.items);
+    free(w.strings.items);
+
+    if (w.failed) {
+        free(w.data);
+        return false;
+    }
+
+    return finish_file(&w, path, DETC_HEADER_SIZE);
+}
+
+bool write_heap_snapshot(const char* path, VM* vm) {
+    Writer w = {NULL, 0, 0, false, {NULL, 0, 0}, {NULL, 0, 0}};
+    VM* previous = use_vm(vm); // Flattening a rope allocates
+
+    put_bytes(&w, DETS_MAGIC, 4);
+    put_u32(&w, DETS_FORMAT_VERSION);
+    put_u32(&w, DETC_OPCODE_COUNT);
+    put_u64(&w, 0); // body hash, patched by finish_file()
+
+    int globalCount = compiler_global_count();
+    put_u32(&w, (uint32_t)globalCount);
+    for (int i = 0; i < globalCount; i++) {
+        int length = 0;
+        const char* name = compiler_global_name(i, &length);
+        DataType varType, returnType;
+        typechecker_global_types(name, length, &varType, &returnType);
+        put_u32(&w, (uint32_t)length);
+        put_bytes(&w, name, (size_t)length);
+        put_u8(&w, (uint8_t)varType);
+        put_u8(&w, (uint8_t)returnType);
+
+        Value value = vm->globals[i];
+        if (IS_OBJ(value) && AS_OBJ(value) == NULL) {
+            put_u8(&w, DETS_GLOBAL_UNSET);
+        } else if (IS_NATIVE(value)) {
+            put_u8(&w, DETS_GLOBAL_NATIVE); // C code: the loading VM's own
+        } else {
+            put_constant(&w, value, 0);
+        }
+    }
+    use_vm(previous);
+
+    free(w.functions.items);
+    free(w.strings.items);
+    if (w.failed) {
+        free(w.data);
+        return false;
+    }
+    return finish_file(&w, path, DETS_HEADER_SIZE);
+}
+
+
+// =================
+// --- Reading ---
+// =================
+
+typedef struct {
+    const uint8_t* data;
+    size_t count;
+    size_t position;
+    bool failed;
+    FunctionList functions; // Decoded so far, by id (all reachable from the stack)
+    StringList strings;     // Likewise (each is in the pool of a function decoded or being decoded)
+} Reader;
+
+static const uint8_t* take_bytes(Reader* r, size_t length) {
+    if (r->failed || length > r->count - r->position) {
+        r->failed = true;
+        return NULL;
+    }
+    const uint8_t* bytes = r->data + r->position;
+    r->position += length;
+    return bytes;
+}
+
+static uint8_t take_u8(Reader* r) {
+    const uint8_t* b = take_bytes(r, 1);
+    return b ? b[0] : 0;
+}
+
+static uint32_t u32_at(const uint8_t* b) {
+    return (uint32_t)b[0] | ((uint32_t)b[1] << 8) | ((uint32_t)b[2] << 16) | ((uint32_t)b[3] << 24);
+}
+
+static uint32_t take_u32(Reader* r) {
+    const uint8_t* b = take_bytes(r, 4);
+    return b != NULL ? u32_at(b) : 0;
+}
+
+static uint64_t take_u64(Reader* r) {
+    uint64_t low = take_u32(r);
+    uint64_t high = take_u32(r);
+    return low | (high << 32);
+}
+
+/**
+ * @brief Check that a loaded chunk only contains instructions the VM can
+ * execute safely: known opcodes, in-range constants and jump targets that
+ * land on instruction boundaries.
+ */
+static bool validate_chunk(const Chunk* chunk) {
+    int count = chunk->count;
+    if (count == 0) return false;
+
+    bool* boundary = (bool*)calloc((size_t)count + 1, sizeof(bool));
+    if (boundary == NULL) return false;
+
+    bool ok = true;
+    int offset = 0;
+    while (ok && offset < count) {
+        uint8_t op = chunk->code[offset];
+        int length = opcode_length(op);
+        boundary[offset] = true;
+
+        if (op >= DETC_OPCODE_COUNT || offset + length > count) {
+            ok = false;
+            break;
+        }
+
+        switch (op) {
+            case OP_CONSTANT:
+            case OP_ADD_CONST:
+            case OP_SUBTRACT_CONST:
+                ok = chunk->code[offset + 1] < chunk->constants.count;
+                break;
+            case OP_ADD_LOCAL_CONST:
+            case OP_INC_LOCAL:
+            case OP_INC_GLOBAL:
+                ok = chunk->code[offset + 2] < chunk->constants.count;
+                break;
+            case OP_CONSTANT_LONG:
+                ok = ((chunk->code[offset + 1] << 8) | chunk->code[offset + 2]) < chunk->constants.count;
+                break;
+            case OP_CALL_DIRECT:
+            case OP_TAIL_CALL_DIRECT:
+            case OP_CALL_DIRECT_0:
+            case OP_CALL_DIRECT_1:
+            case OP_CALL_DIRECT_2:
+            case OP_CALL_DIRECT_3: {
+                // The VM trusts the callee's arity and indexes globals with its slot
+                uint8_t constant = chunk->code[offset + 1];
+                ok = constant < chunk->constants.count &&
+                     IS_FUNCTION(chunk->constants.values[constant]) &&
+                     AS_FUNCTION(chunk->constants.values[constant])->arity == direct_call_args(chunk->code + offset) &&
+                     AS_FUNCTION(chunk->constants.values[constant])->global >= 0;
+                break;
+            }
+            default:
+                break;
+        }
+        offset += length;
+    }
+    boundary[count] = true;
+
+    // Jumps may only land on the start of an instruction (or the end)
+    for (offset = 0; ok && offset < count; offset += opcode_length(chunk->code[offset])) {
+        uint8_t op = chunk->code[offset];
+        if (op != OP_JUMP && op != OP_JUMP_IF_FALSE && op != OP_LOOP &&
+            op != OP_JUMP_IF_FALSE_POP && op != OP_JUMP_IF_NOT_LESS &&
+            op != OP_JUMP_IF_NOT_LESS_EQUAL && op != OP_JUMP_IF_NOT_GREATER &&
+            op != OP_JUMP_IF_NOT_GREATER_EQUAL) {
+            continue;
+        }
+
+        int distance = (chunk->code[offset + 1] << 8) | chunk->code[offset + 2];
+        int target = (op == OP_LOOP) ? offset + 3 - distance : offset + 3 + distance;
+        ok = target >= 0 && target <= count && boundary[target];
+    }
+
+    free(boundary);
+    return ok;
+}
+
+static ObjFunction* take_function(Reader* r, int depth);
+
+/**
+ * @brief Read one constant whose tag was `tag` and leave it on the VM
+ * stack (rooted).
+ */
+static bool take_tagged_constant(Reader* r, uint8_t tag, int depth) {
+    switch (tag) {
+        case DETC_CONST_BOOL:
+            push(BOOL_VAL(take_u8(r) != 0));
+            break;
+
+        case DETC_CONST_INT:
+            push(INT_VAL((int)(int32_t)take_u32(r)));
+            break;
+
+        case DETC_CONST_STRING: {
+            uint32_t length = take_u32(r);
+            const uint8_t* chars = take_bytes(r, length);
+            if (chars == NULL || length > INT32_MAX) return false;
+            ObjString* string = copy_string((const char*)chars, (int)length);
+            push(OBJ_VAL(string));
+            if (!string_list_add(&r->strings, string)) return false;
+            break;
+        }
+
+        case DETC_CONST_STRING_REF: {
+            uint32_t id = take_u32(r);
+            if (id >= r->strings.count) return false;
+            push(OBJ_VAL(r->strings.items[id]));
+            break;
+        }
+
+        case DETC_CONST_FUNCTION: {
+            ObjFunction* function = take_function(r, depth + 1);
+            if (function == NULL) return false;
+            push(OBJ_VAL(function));
+            break;
+        }
+
+        case DETC_CONST_FUNCTION_REF: {
+            uint32_t id = take_u32(r);
+            if (id >= r->functions.count) return false;
+            push(OBJ_VAL(r->functions.items[id]));
+            break;
+        }
+
+        default:
+            return false;
+    }
+    return !r->failed;
+}
+
+static bool take_constant(Reader* r, int depth) {
+    return take_tagged_constant(r, take_u8(r), depth);
+}
+
+static ObjFunction* take_function(Reader* r, int depth) {
+    // Every level keeps the function plus one pending constant on the stack
+    if (depth > DETC_MAX_DEPTH || currentVM->stackTop + 2 > currentVM->stack + currentVM->stackCapacity) return NULL;
+
+    Value* base = currentVM->stackTop;
+    ObjFunction* function = new_function();
+    push(OBJ_VAL(function));
+
+    bool ok = function_list_add(&r->functions, function);
+    function->arity = (int)take_u32(r);
+    function->global = (int)take_u32(r);
+    ok = ok && function->global >= -1 && function->global < GLOBALS_MAX;
+
+    uint32_t nameLength = take_u32(r);
+    if (nameLength != (uint32_t)-1) {
+        const uint8_t* name = take_bytes(r, nameLength);
+        ok = name != NULL && nameLength <= INT32_MAX;
+        if (ok) function->name = copy_string((const char*)name, (int)nameLength);
+    }
+
+    uint32_t codeCount = ok ? take_u32(r) : 0;
+    const uint8_t* code = take_bytes(r, codeCount);
+    uint32_t lineCount = ok ? take_u32(r) : 0;
+    const uint8_t* lines = take_bytes(r, (size_t)lineCount * 8);
+    ok = ok && code != NULL && lines != NULL && codeCount <= INT32_MAX &&
+         lineCount > 0 && lineCount <= codeCount && u32_at(lines) == 0;
+
+    // Line runs: (u32 offset, i32 line), the first at 0, offsets increasing
+    uint32_t run = 0;
+    for (uint32_t i = 0; ok && i < codeCount; i++) {
+        if (run + 1 < lineCount && u32_at(lines + (size_t)(run + 1) * 8) == i) run++;
+        write_chunk(&function->chunk, code[i], (int)u32_at(lines + (size_t)run * 8 + 4));
+    }
+    ok = ok && run + 1 == lineCount; // Every run was reached
+
+    uint32_t constantCount = ok ? take_u32(r) : 0;
+    ok = ok && !r->failed && constantCount <= UINT16_COUNT;
+
+    for (uint32_t i = 0; ok && i < constantCount; i++) {
+        ok = take_constant(r, depth);
+        if (ok) {
+            append_constant(&function->chunk, peek(0)); // Index for index
+            pop();
+        }
+    }
+
+    ok = ok && validate_chunk(&function->chunk);
+
+    // Not stored in the file: recomputed from the code it belongs to
+    if (ok) function->maxStackDepth = chunk_stack_depth(&function->chunk, function->global >= 0 ? function->arity + 1 : 0);
+
+    // Drop whatever this level left on the stack (objects become garbage on failure)
+    currentVM->stackTop = base;
+
+    return ok ? function : NULL;
+}
+
+/**
+ * @brief Whether global slot `slot` of this session is `name`, with the
+ * types the typechecker knew when the cache was written.
+ */
+static bool same_global(int slot, const char* name, uint32_t length, uint8_t varType, uint8_t returnType) {
+    int existingLength = 0;
+    const char* existing = compiler_global_name(slot, &existingLength);
+    if (existing == NULL || (uint32_t)existingLength != length || memcmp(existing, name, length) != 0) return false;
+
+    DataType knownVar, knownReturn;
+    typechecker_global_types(name, (int)length, &knownVar, &knownReturn);
+    return (uint8_t)knownVar == varType && (uint8_t)knownReturn == returnType;
+}
+
+ObjFunction* load_bytecode_cache(const char* path, uint64_t sourceHash, uint32_t flags) {
+    FileMap file;
+    if (!file_map_open(&file, path)) return NULL;
+
+    Reader r = {(const uint8_t*)file.data, file.length, 0, false, {NULL, 0, 0}, {NULL, 0, 0}};
+    ObjFunction* function = NULL;
+
+    // Header: anything unexpected means "stale", not "error"
+    const uint8_t* magic = take_bytes(&r, 4);
+    if (magic == NULL || memcmp(magic, DETC_MAGIC, 4) != 0) goto done;
+    if (take_u32(&r) != DETC_FORMAT_VERSION) goto done;
+    if (take_u32(&r) != DETC_OPCODE_COUNT) goto done;
+    if (take_u32(&r) != flags) goto done;
+    if (take_u64(&r) != sourceHash) goto done;
+    uint64_t bodyHash = take_u64(&r);
+    if (r.failed || bodyHash != hash_source(file.data + DETC_HEADER_SIZE, file.length - DETC_HEADER_SIZE)) {
+        goto done;
+    }
+
+    // The globals the unit was checked against must be here, as they were;
+    // the unit's own are only defined once the function decoded cleanly
+    uint32_t globalCount = take_u32(&r);
+    uint32_t priorCount = take_u32(&r);
+    if (r.failed || globalCount > GLOBALS_MAX || priorCount > globalCount) goto done;
+    if ((uint32_t)compiler_global_count() < priorCount) goto done;
+    size_t globalsStart = r.position;
+    for (uint32_t i = 0; i < globalCount; i++) {
+        uint32_t length = take_u32(&r);
+        const char* name = (const char*)take_bytes(&r, length);
+        uint8_t varType = take_u8(&r);
+        uint8_t returnType = take_u8(&r);
+        if (r.failed) goto done;
+        if (i < priorCount && !same_global((int)i, name, length, varType, returnType)) goto done;
+    }
+
+    function = take_function(&r, 0);
+    if (function == NULL || r.failed || r.position != r.count) {
+        function = NULL;
+        goto done;
+    }
+
+    // Restore the name -> slot mapping, and the types of the unit's globals
+    // (a later unit, or a heap snapshot, needs them)
+    r.position = globalsStart;
+    for (uint32_t i = 0; i < globalCount; i++) {
+        uint32_t length = take_u32(&r);
+        const char* name = (const char*)take_bytes(&r, length);
+        DataType varType = (DataType)take_u8(&r);
+        DataType returnType = (DataType)take_u8(&r);
+        if (compiler_define_global(name, (int)length) != (int)i) {
+            function = NULL; // The compiler already had globals; don't trust the slots
+            break;
+        }
+        DataType knownVar, knownReturn;
+        typechecker_global_types(name, (int)length, &knownVar, &knownReturn);
+        if (i >= priorCount && knownVar == TYPE_ERROR && knownReturn == TYPE_ERROR) {
+            typechecker_restore_global(name, (int)length, varType, returnType);
+        }
+    }
+
+done:
+    free(r.functions.items);
+    free(r.strings.items);
+    file_map_close(&file);
+    return function;
+}
+
+/**
+ * @brief One global of a snapshot, as read (the value is a constant of the
+ * unit being loaded).
+ */
+typedef struct {
+    const char* name;   // Into the file
+    uint32_t length;
+    uint8_t varType;
+    uint8_t returnType;
+    uint8_t kind;       // DetsGlobal, or 0: a value
+} SnapshotGlobal;
+
+static bool valid_type(uint8_t type) {
+    return type <= TYPE_ERROR;
+}
+
+ObjFunction* load_heap_snapshot(const char* path, VM* vm) {
+    FileMap file;
+    if (!file_map_open(&file, path)) return NULL;
+
+    VM* previous = use_vm(vm);
+    Value* base = vm->stackTop;
+    Reader r = {(const uint8_t*)file.data, file.length, 0, false, {NULL, 0, 0}, {NULL, 0, 0}};
+    SnapshotGlobal* globals = NULL;
+    ObjFunction* unit = NULL;
+    bool ok = false;
+
+    const uint8_t* magic = take_bytes(&r, 4);
+    if (magic == NULL || memcmp(magic, DETS_MAGIC, 4) != 0) goto done;
+    if (take_u32(&r) != DETS_FORMAT_VERSION) goto done;
+    if (take_u32(&r) != DETC_OPCODE_COUNT) goto done;
+    uint64_t bodyHash = take_u64(&r);
+    if (r.failed || bodyHash != hash_source(file.data + DETS_HEADER_SIZE, file.length - DETS_HEADER_SIZE)) {
+        goto done;
+    }
+
+    uint32_t globalCount = take_u32(&r);
+    if (r.failed || globalCount > GLOBALS_MAX) goto done;
+    globals = (SnapshotGlobal*)calloc(globalCount > 0 ? globalCount : 1, sizeof(SnapshotGlobal));
+    if (globals == NULL) goto done;
+
+    // The unit holds slot i's value as constant i; it and the value being
+    // read are rooted on the stack
+    if (base + 2 > currentVM->stack + currentVM->stackCapacity) goto done;
+    unit = new_function();
+    push(OBJ_VAL(unit));
+    write_chunk(&unit->chunk, OP_RETURN, 0); // Runs nothing
+    unit->maxStackDepth = chunk_stack_depth(&unit->chunk, 0);
+
+    ok = true;
+    for (uint32_t i = 0; ok && i < globalCount; i++) {
+        SnapshotGlobal* global = &globals[i];
+        global->length = take_u32(&r);
+        global->name = (const char*)take_bytes(&r, global->length);
+        global->varType = take_u8(&r);
+        global->returnType = take_u8(&r);
+        uint8_t tag = take_u8(&r);
+        ok = !r.failed && global->length <= INT32_MAX &&
+             valid_type(global->varType) && valid_type(global->returnType);
+
+        if (ok && (tag == DETS_GLOBAL_UNSET || tag == DETS_GLOBAL_NATIVE)) {
+            global->kind = tag;
+            push(BOOL_VAL(false)); // Placeholder: keeps constant i for slot i
+        } else if (ok) {
+            ok = take_tagged_constant(&r, tag, 0);
+        }
+        if (ok) {
+            append_constant(&unit->chunk, peek(0));
+            pop();
+        }
+    }
+    ok = ok && !r.failed && r.position == r.count;
+
+    // Bind the names; the slots must come out as they were (natives are
+    // defined first, in the same order, by every VM)
+    for (uint32_t i = 0; ok && i < globalCount; i++) {
+        ok = compiler_define_global(globals[i].name, (int)globals[i].length) == (int)i;
+        if (ok && globals[i].kind == DETS_GLOBAL_NATIVE) ok = IS_NATIVE(vm->globals[i]);
+    }
+
+    for (uint32_t i = 0; ok && i < globalCount; i++) {
+        const SnapshotGlobal* global = &globals[i];
+        vm_use_global(vm, (int)i);
+        if (global->kind == 0) vm->globals[i] = unit->chunk.constants.values[i];
+        typechecker_restore_global(global->name, (int)global->length,
+                                   (DataType)global->varType, (DataType)global->returnType);
+    }
+
+done:
+    vm->stackTop = base;
+    use_vm(previous);
+    free(globals);
+    free(r.functions.items);
+    free(r.strings.items);
+    file_map_close(&file);
+    return ok ? unit : NULL;
+}
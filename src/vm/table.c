@@ -0,0 +1,147 @@
+/**
+ * @file table.c
+ * @brief Implementation of the string-keyed hash table (linear probing).
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "vm/table.h"
+#include "vm/memory.h"
+
+// Grow once the table is 75% full (tombstones included)
+#define TABLE_MAX_LOAD 0.75
+
+void init_table(Table* table) {
+    table->count = 0;
+    table->capacity = 0;
+    table->entries = NULL;
+}
+
+void free_table(Table* table) {
+    reallocate(table->entries, sizeof(Entry) * table->capacity, 0);
+    init_table(table);
+}
+
+/**
+ * @brief Find the slot for `key`: its entry if present, otherwise the first
+ * tombstone passed (so it gets reused) or the empty slot that ended the probe.
+ */
+static Entry* find_entry(Entry* entries, int capacity, ObjString* key) {
+    uint32_t index = key->hash & (uint32_t)(capacity - 1);
+    Entry* tombstone = NULL;
+
+    for (;;) {
+        Entry* entry = &entries[index];
+        if (entry->key == NULL) {
+            if (!AS_BOOL(entry->value)) {
+                // Empty entry
+                return tombstone != NULL ? tombstone : entry;
+            }
+            if (tombstone == NULL) tombstone = entry;
+        } else if (entry->key == key) {
+            return entry;
+        }
+
+        index = (index + 1) & (uint32_t)(capacity - 1);
+    }
+}
+
+static void adjust_capacity(Table* table, int capacity) {
+    Entry* entries = (Entry*)reallocate(NULL, 0, sizeof(Entry) * capacity);
+    for (int i = 0; i < capacity; i++) {
+        entries[i].key = NULL;
+        entries[i].value = BOOL_VAL(false);
+    }
+
+    // Re-insert live entries; tombstones are dropped
+    table->count = 0;
+    for (int i = 0; i < table->capacity; i++) {
+        Entry* entry = &table->entries[i];
+        if (entry->key == NULL) continue;
+
+        Entry* dest = find_entry(entries, capacity, entry->key);
+        dest->key = entry->key;
+        dest->value = entry->value;
+        table->count++;
+    }
+
+    reallocate(table->entries, sizeof(Entry) * table->capacity, 0);
+    table->entries = entries;
+    table->capacity = capacity;
+}
+
+bool table_get(Table* table, ObjString* key, Value* value) {
+    if (table->count == 0) return false;
+
+    Entry* entry = find_entry(table->entries, table->capacity, key);
+    if (entry->key == NULL) return false;
+
+    *value = entry->value;
+    return true;
+}
+
+bool table_set(Table* table, ObjString* key, Value value) {
+    if (table->count + 1 > table->capacity * TABLE_MAX_LOAD) {
+        adjust_capacity(table, table->capacity < 8 ? 8 : table->capacity * 2);
+    }
+
+    Entry* entry = find_entry(table->entries, table->capacity, key);
+    bool isNewKey = entry->key == NULL;
+    if (isNewKey && !AS_BOOL(entry->value)) table->count++; // Reused tombstones are already counted
+
+    entry->key = key;
+    entry->value = value;
+    return isNewKey;
+}
+
+bool table_delete(Table* table, ObjString* key) {
+    if (table->count == 0) return false;
+
+    Entry* entry = find_entry(table->entries, table->capacity, key);
+    if (entry->key == NULL) return false;
+
+    // Leave a tombstone
+    entry->key = NULL;
+    entry->value = BOOL_VAL(true);
+    return true;
+}
+
+bool table_replace_key(Table* table, ObjString* key, ObjString* replacement) {
+    if (table->count == 0) return false;
+
+    Entry* entry = find_entry(table->entries, table->capacity, key);
+    if (entry->key == NULL) return false;
+
+    entry->key = replacement;
+    return true;
+}
+
+ObjString* table_find_string(Table* table, const char* chars, int length, uint32_t hash) {
+    if (table->count == 0) return NULL;
+
+    uint32_t index = hash & (uint32_t)(table->capacity - 1);
+    for (;;) {
+        Entry* entry = &table->entries[index];
+        if (entry->key == NULL) {
+            // Stop at a truly empty slot, skip tombstones
+            if (!AS_BOOL(entry->value)) return NULL;
+        } else if (entry->key->length == length &&
+                   entry->key->hash == hash &&
+                   memcmp(entry->key->chars, chars, length) == 0) {
+            return entry->key;
+        }
+
+        index = (index + 1) & (uint32_t)(table->capacity - 1);
+    }
+}
+
+void table_remove_white(Table* table) {
+    for (int i = 0; i < table->capacity; i++) {
+        Entry* entry = &table->entries[i];
+        // Young keys are the nursery's to drop (see vm_collect_nursery)
+        if (entry->key != NULL && !entry->key->obj.isYoung && !object_is_marked(&entry->key->obj)) {
+            table_delete(table, entry->key);
+        }
+    }
+}
@@ -0,0 +1,116 @@
+/**
+ * @file trace.c
+ * @brief Runtime tracing hooks (see trace.h).
+ */
+
+#include "vm/trace.h"
+#include "vm/disassembler.h"
+#include "vm/opcode.h"
+
+// Attached by the next init_vm() (see set_vm_tracer)
+static const VmTracer* nextTracer = NULL;
+
+void set_vm_tracer(const VmTracer* tracer) {
+    nextTracer = tracer;
+}
+
+void vm_trace_init(VM* vm) {
+    vm_set_tracer(vm, nextTracer);
+}
+
+void vm_set_tracer(VM* vm, const VmTracer* tracer) {
+    vm->tracer = tracer;
+    vm->traceDepth = 0;
+    vm->traceFunction = NULL;
+    vm->traceLastOp = OP_RETURN;
+
+    // Neither machine code nor register code passes through run()'s hook
+    if (tracer_traces_code(tracer)) {
+        vm->jit = false;
+        vm->registerBackend = false;
+    }
+}
+
+/**
+ * @brief Leave the top traced frame.
+ */
+static void trace_return(VM* vm) {
+    const VmTracer* tracer = vm->tracer;
+    vm->traceDepth--;
+    if (tracer->ret != NULL) tracer->ret(tracer->user, vm, vm->traceFunction);
+    // The frames below the top are unchanged since they were entered
+    vm->traceFunction = vm->traceDepth > 0 ? vm->frames[vm->traceDepth - 1].function : NULL;
+}
+
+/**
+ * @brief Enter the frame at traceDepth.
+ */
+static void trace_call(VM* vm) {
+    const VmTracer* tracer = vm->tracer;
+    vm->traceFunction = vm->frames[vm->traceDepth].function;
+    vm->traceDepth++;
+    if (tracer->call != NULL) tracer->call(tracer->user, vm, vm->traceFunction);
+}
+
+void vm_trace_instruction(VM* vm, const uint8_t* ip) {
+    const VmTracer* tracer = vm->tracer;
+
+    // Follow the frame stack: returns (and unwinding) pop frames, a call
+    // pushes one, and a tail call replaces the top one
+    while (vm->traceDepth > vm->frameCount) trace_return(vm);
+    while (vm->traceDepth < vm->frameCount) trace_call(vm);
+
+    ObjFunction* function = vm->frames[vm->frameCount - 1].function;
+    bool tailCalled = (vm->traceLastOp == OP_TAIL_CALL || vm->traceLastOp == OP_TAIL_CALL_DIRECT) &&
+                      ip == function->chunk.code;
+    if (function != vm->traceFunction || tailCalled) {
+        trace_return(vm);
+        trace_call(vm);
+    }
+
+    vm->traceLastOp = *ip;
+    if (tracer->instruction != NULL) {
+        tracer->instruction(tracer->user, vm, function, (int)(ip - function->chunk.code));
+    }
+}
+
+void vm_trace_unwind(VM* vm) {
+    if (!tracer_traces_code(vm->tracer)) return;
+    while (vm->traceDepth > 0) trace_return(vm);
+    vm->traceLastOp = OP_RETURN;
+}
+
+// --- Execution tracer (--trace-execution) ---
+
+static void print_stack(void* user, VM* vm, ObjFunction* function, int offset) {
+    FILE* out = (FILE*)user;
+    fputs("          ", out);
+    for (Value* slot = vm->stack; slot < vm->stackTop; slot++) {
+        fputs("[ ", out);
+        disassemble_value(out, *slot);
+        fputs(" ]", out);
+    }
+    fputc('\n', out);
+    disassemble_instruction(out, &function->chunk, offset);
+}
+
+static const char* traced_name(const ObjFunction* function) {
+    return function->name != NULL ? function->name->chars : "<script>";
+}
+
+static void print_call(void* user, VM* vm, ObjFunction* function) {
+    fprintf((FILE*)user, "-> %s (depth %d)\n", traced_name(function), vm->traceDepth);
+}
+
+static void print_return(void* user, VM* vm, ObjFunction* function) {
+    fprintf((FILE*)user, "<- %s (depth %d)\n", traced_name(function), vm->traceDepth + 1);
+}
+
+static void print_gc_end(void* user, VM* vm, uint64_t pauseNs) {
+    fprintf((FILE*)user, "-- gc: %zu bytes live, %.3f ms --\n", vm->bytesAllocated, pauseNs / 1e6);
+}
+
+VmTracer execution_tracer(FILE* out) {
+    VmTracer tracer = {out, print_stack, print_call, print_return, NULL, print_gc_end, NULL, NULL};
+    return tracer;
+}
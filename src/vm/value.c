@@ -19,7 +19,7 @@
 #include "vm/object.h"
 
 void print_value(Value value) {
-    switch (value.type) {
+    switch (VALUE_TYPE(value)) {
         case VAL_BOOL:{
             printf(AS_BOOL(value) ? "true" : "false");
             break;
@@ -36,29 +36,18 @@ void print_value(Value value) {
 }
 
 bool values_equal(Value a, Value b) {
-    if (a.type != b.type) return false;
-    switch (a.type) {
+    if (VALUE_TYPE(a) != VALUE_TYPE(b)) return false;
+    switch (VALUE_TYPE(a)) {
         case VAL_BOOL: return AS_BOOL(a) == AS_BOOL(b);
         case VAL_INT:  return AS_INT(a) == AS_INT(b);
         case VAL_OBJ: {
             Obj* aObj = AS_OBJ(a);
             Obj* bObj = AS_OBJ(b);
             
-            // 1. Fast path: Same pointer = same object = equal
+            // Strings are interned, so equal contents means the same
+            // pointer (ropes aside); functions compare by identity anyway
             if (aObj == bObj) return true;
-
-            // 2. Deep compare for Strings
-            if (aObj->type == OBJ_STRING && bObj->type == OBJ_STRING) {
-                ObjString* aStr = (ObjString*)aObj;
-                ObjString* bStr = (ObjString*)bObj;
-                
-                // Compare lengths first (fast)
-                if (aStr->length != bStr->length) return false;
-                
-                // Compare contents (slower)
-                return memcmp(aStr->chars, bStr->chars, aStr->length) == 0;
-            }
-            return false; 
+            return IS_STRING(a) && IS_STRING(b) && strings_equal(AS_STRING(a), AS_STRING(b));
         }
         // case VAL_OBJ:
         default:       return false; // Should be unreachable
@@ -0,0 +1,691 @@
+/**
+ * @file verify.c
+ * @brief Load-time bytecode verifier (see verify.h).
+ *
+ * Each function is checked by abstract interpretation of its stack code. A
+ * worklist visits every reachable instruction with the state on entry to
+ * it: the stack depth and the static type of every stack position (the
+ * frame's slots included, so locals are tracked too). Where paths meet the
+ * depths must agree and the types are joined (two different types become
+ * ST_ANY), so the walk reaches a fixpoint after a few visits per
+ * instruction.
+ *
+ * Globals are shared by all the unit's functions, so the unit is walked in
+ * rounds: each round assumes a type per global, walks every function and
+ * joins the types their stores write. When no store adds anything the
+ * assumptions hold on every path (they are an invariant), and a last round
+ * applies the results.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "vm/verify.h"
+#include "vm/opcode.h"
+
+typedef enum {
+    ST_UNSET,   // Globals only: nothing known to be stored yet
+    ST_INT,
+    ST_BOOL,
+    ST_STRING,
+    ST_ANY,     // Unknown, or different types on different paths
+} StaticType;
+
+typedef struct {
+    VM* vm;
+    uint8_t* globals;   // StaticType assumed for each global in this round
+    uint8_t* stored;    // Join of what this round's stores write
+    bool apply;         // Last round: rewrite and mark trusted functions
+} Unit;
+
+typedef struct {
+    Unit* unit;
+    ObjFunction* function;
+    Chunk* chunk;
+    int* depthAt;       // Per offset: depth on entry, -1 not reached, -2 not an instruction
+    uint8_t** typesAt;  // Per reached offset: the type of each stack position on entry
+    int* work;          // Offsets whose entry state changed
+    int workCount;
+    bool* queued;
+
+    uint8_t* types;     // State of the instruction being stepped
+    int depth;
+    int capacity;
+
+    bool final;         // Fixpoint reached: only record stores, proofs and rewrites
+    bool trusted;       // Every guarded instruction stepped so far had proven operands
+} Walk;
+
+static uint8_t join(uint8_t a, uint8_t b) {
+    if (a == ST_UNSET) return b;
+    if (b == ST_UNSET) return a;
+    return a == b ? a : ST_ANY;
+}
+
+static uint8_t type_of(Value value) {
+    if (IS_INT(value)) return ST_INT;
+    if (IS_BOOL(value)) return ST_BOOL;
+    if (IS_STRING(value)) return ST_STRING;
+    return ST_ANY;
+}
+
+// A global nothing has been stored into yet is all zero bits: false in the
+// tagged struct, a NULL object in the compact layout
+static bool holds_value(Value value) {
+    if (IS_OBJ(value)) return AS_OBJ(value) != NULL;
+    return !IS_BOOL(value) || AS_BOOL(value);
+}
+
+static bool fail(Walk* w, int offset, const char* message) {
+    ObjFunction* function = w->function;
+    fprintf(stderr, "Verifier Error: %s%s%s at offset %d: %s.\n",
+            function->name != NULL ? "function '" : "the script",
+            function->name != NULL ? function->name->chars : "",
+            function->name != NULL ? "'" : "",
+            offset, message);
+    return false;
+}
+
+/**
+ * @brief Mark the instruction starts; every opcode must be known and fit.
+ */
+static bool decode(Walk* w) {
+    const Chunk* chunk = w->chunk;
+    for (int offset = 0; offset < chunk->count; offset++) w->depthAt[offset] = -2;
+
+    for (int offset = 0; offset < chunk->count;) {
+        uint8_t op = chunk->code[offset];
+        if (op > OP_RETURN) return fail(w, offset, "unknown opcode");
+        int length = opcode_length(op);
+        if (offset + length > chunk->count) return fail(w, offset, "instruction runs past the end of the code");
+        w->depthAt[offset] = -1;
+        offset += length;
+    }
+    return true;
+}
+
+static bool reserve(Walk* w, int depth) {
+    if (depth <= w->capacity) return true;
+    int capacity = w->capacity < 16 ? 16 : w->capacity * 2;
+    while (capacity < depth) capacity *= 2;
+    uint8_t* types = (uint8_t*)realloc(w->types, capacity);
+    if (types == NULL) return false;
+    w->types = types;
+    w->capacity = capacity;
+    return true;
+}
+
+/**
+ * @brief Merge the current state into the entry state of `target`.
+ */
+static bool flow(Walk* w, int from, int target) {
+    if (w->final) return true;
+    if (target < 0 || target >= w->chunk->count) return fail(w, from, "jumps outside the code");
+    if (w->depthAt[target] == -2) return fail(w, from, "jumps into the middle of an instruction");
+
+    bool changed = false;
+    if (w->depthAt[target] == -1) {
+        uint8_t* types = (uint8_t*)malloc(w->depth > 0 ? w->depth : 1);
+        if (types == NULL) return fail(w, from, "out of memory");
+        memcpy(types, w->types, w->depth);
+        w->typesAt[target] = types;
+        w->depthAt[target] = w->depth;
+        changed = true;
+    } else if (w->depthAt[target] != w->depth) {
+        return fail(w, from, "stack depth differs between the paths into a jump target");
+    } else {
+        uint8_t* types = w->typesAt[target];
+        for (int i = 0; i < w->depth; i++) {
+            uint8_t joined = join(types[i], w->types[i]);
+            if (joined != types[i]) {
+                types[i] = joined;
+                changed = true;
+            }
+        }
+    }
+
+    if (changed && !w->queued[target]) {
+        w->queued[target] = true;
+        w->work[w->workCount++] = target;
+    }
+    return true;
+}
+
+static uint8_t read_global(Walk* w, int index) {
+    uint8_t type = w->unit->globals[index];
+    return type == ST_UNSET ? ST_ANY : type;
+}
+
+static void store_global(Walk* w, int index, uint8_t type) {
+    if (w->final) w->unit->stored[index] = join(w->unit->stored[index], type);
+}
+
+// A type-checked instruction with no unchecked form: trusted functions run
+// it without its check, so all of them must have proven operands
+static void guard(Walk* w, bool proven) {
+    if (!proven) w->trusted = false;
+}
+
+// Rewrite a checked instruction whose operands were proven
+static void quicken(Walk* w, int offset, uint8_t op) {
+    if (w->final && w->unit->apply) w->chunk->code[offset] = op;
+}
+
+// The result type of `+` (it raises unless the operands match)
+static uint8_t add_result(uint8_t a, uint8_t b) {
+    if (a == ST_INT || b == ST_INT) return ST_INT;
+    if (a == ST_STRING || b == ST_STRING) return ST_STRING;
+    return ST_ANY;
+}
+
+/**
+ * @brief Apply the instruction at `offset` to its entry state and pass the
+ * result on to its successors.
+ */
+static bool step(Walk* w, int offset) {
+    const Chunk* chunk = w->chunk;
+    const uint8_t* code = chunk->code + offset;
+    uint8_t op = code[0];
+    int next = offset + opcode_length(op);
+    int count = chunk->constants.count;
+    Value* constants = chunk->constants.values;
+
+    w->depth = w->depthAt[offset];
+    if (!reserve(w, w->depth + 1)) return fail(w, offset, "out of memory");
+    memcpy(w->types, w->typesAt[offset], w->depth);
+
+    #define NEED(n) \
+        do { \
+            if (w->depth < (n)) return fail(w, offset, "stack underflow"); \
+        } while (0)
+    #define TOP(i) (w->types[w->depth - 1 - (i)])
+    #define PUSH_TYPE(type) (w->types[w->depth++] = (type))
+    #define SHORT_OPERAND() ((int)((code[1] << 8) | code[2]))
+    #define CHECK_CONSTANT(index) \
+        do { \
+            if ((index) >= count) return fail(w, offset, "constant index out of range"); \
+        } while (0)
+    #define CHECK_INT_CONSTANT(index) \
+        do { \
+            CHECK_CONSTANT(index); \
+            if (!IS_INT(constants[index])) return fail(w, offset, "fused constant is not an int"); \
+        } while (0)
+    #define CHECK_SLOT(slot) \
+        do { \
+            if ((slot) >= w->depth) return fail(w, offset, "local slot out of range"); \
+        } while (0)
+    #define CHECK_GLOBAL(index) \
+        do { \
+            if ((index) >= GLOBALS_MAX) return fail(w, offset, "global index out of range"); \
+        } while (0)
+    // Operands of the typechecker's unchecked opcodes must not be proven otherwise
+    #define EXPECT(type, expected) \
+        do { \
+            if ((type) != (expected) && (type) != ST_ANY) { \
+                return fail(w, offset, "operand type contradicts a type-specialized opcode"); \
+            } \
+        } while (0)
+    #define BOTH(type) (TOP(0) == (type) && TOP(1) == (type))
+
+    switch (op) {
+        case OP_CONSTANT:
+        case OP_CONSTANT_LONG: {
+            int index = op == OP_CONSTANT ? code[1] : SHORT_OPERAND();
+            CHECK_CONSTANT(index);
+            PUSH_TYPE(type_of(constants[index]));
+            break;
+        }
+
+        case OP_TRUE:
+        case OP_FALSE:
+            PUSH_TYPE(ST_BOOL);
+            break;
+
+        case OP_NIL:
+        case OP_CLOSURE:
+            break; // No-ops at runtime
+
+        case OP_ADD: {
+            NEED(2);
+            uint8_t result = add_result(TOP(1), TOP(0));
+            if (BOTH(ST_INT)) quicken(w, offset, OP_ADD_INT);
+            else if (BOTH(ST_STRING)) quicken(w, offset, OP_CONCAT);
+            w->depth -= 2;
+            PUSH_TYPE(result);
+            break;
+        }
+
+        case OP_SUBTRACT:
+        case OP_MULTIPLY:
+        case OP_DIVIDE:
+        case OP_MODULO:
+            NEED(2);
+            if (BOTH(ST_INT)) {
+                quicken(w, offset, op == OP_SUBTRACT ? OP_SUBTRACT_INT
+                                 : op == OP_MULTIPLY ? OP_MULTIPLY_INT
+                                 : op == OP_DIVIDE ? OP_DIVIDE_INT : OP_MODULO_INT);
+            }
+            w->depth -= 2;
+            PUSH_TYPE(ST_INT);
+            break;
+
+        case OP_NEGATE:
+            NEED(1);
+            guard(w, TOP(0) == ST_INT);
+            TOP(0) = ST_INT;
+            break;
+
+        case OP_NOT:
+            NEED(1);
+            guard(w, TOP(0) == ST_BOOL);
+            TOP(0) = ST_BOOL;
+            break;
+
+        case OP_EQUAL:
+        case OP_NOT_EQUAL:
+            NEED(2);
+            if (BOTH(ST_INT)) quicken(w, offset, op == OP_EQUAL ? OP_EQUAL_INT : OP_NOT_EQUAL_INT);
+            w->depth -= 2;
+            PUSH_TYPE(ST_BOOL);
+            break;
+
+        case OP_GREATER:
+        case OP_LESS:
+        case OP_GREATER_EQUAL:
+        case OP_LESS_EQUAL:
+            NEED(2);
+            if (BOTH(ST_INT)) {
+                quicken(w, offset, op == OP_GREATER ? OP_GREATER_INT
+                                 : op == OP_LESS ? OP_LESS_INT
+                                 : op == OP_GREATER_EQUAL ? OP_GREATER_EQUAL_INT : OP_LESS_EQUAL_INT);
+            }
+            w->depth -= 2;
+            PUSH_TYPE(ST_BOOL);
+            break;
+
+        case OP_ADD_INT:
+        case OP_SUBTRACT_INT:
+        case OP_MULTIPLY_INT:
+        case OP_DIVIDE_INT:
+        case OP_MODULO_INT:
+        case OP_EQUAL_INT:
+        case OP_GREATER_INT:
+        case OP_LESS_INT:
+        case OP_NOT_EQUAL_INT:
+        case OP_GREATER_EQUAL_INT:
+        case OP_LESS_EQUAL_INT: {
+            NEED(2);
+            EXPECT(TOP(0), ST_INT);
+            EXPECT(TOP(1), ST_INT);
+            bool arithmetic = op == OP_ADD_INT || op == OP_SUBTRACT_INT || op == OP_MULTIPLY_INT ||
+                              op == OP_DIVIDE_INT || op == OP_MODULO_INT;
+            w->depth -= 2;
+            PUSH_TYPE(arithmetic ? ST_INT : ST_BOOL);
+            break;
+        }
+
+        case OP_CONCAT:
+            NEED(2);
+            EXPECT(TOP(0), ST_STRING);
+            EXPECT(TOP(1), ST_STRING);
+            w->depth -= 2;
+            PUSH_TYPE(ST_STRING);
+            break;
+
+        case OP_GET_GLOBAL:
+        case OP_GET_GLOBAL_LONG: {
+            int index = op == OP_GET_GLOBAL ? code[1] : SHORT_OPERAND();
+            CHECK_GLOBAL(index);
+            PUSH_TYPE(read_global(w, index));
+            break;
+        }
+
+        case OP_SET_GLOBAL:
+        case OP_SET_GLOBAL_LONG: {
+            int index = op == OP_SET_GLOBAL ? code[1] : SHORT_OPERAND();
+            CHECK_GLOBAL(index);
+            NEED(1);
+            store_global(w, index, TOP(0));
+            break;
+        }
+
+        case OP_GET_LOCAL:
+        case OP_GET_LOCAL_LONG: {
+            int slot = op == OP_GET_LOCAL ? code[1] : SHORT_OPERAND();
+            CHECK_SLOT(slot);
+            PUSH_TYPE(w->types[slot]);
+            break;
+        }
+
+        case OP_SET_LOCAL:
+        case OP_SET_LOCAL_LONG: {
+            int slot = op == OP_SET_LOCAL ? code[1] : SHORT_OPERAND();
+            NEED(1);
+            CHECK_SLOT(slot);
+            w->types[slot] = TOP(0);
+            break;
+        }
+
+        case OP_POP:
+        case OP_PRINT:
+            NEED(1);
+            w->depth--;
+            break;
+
+        case OP_POPN:
+            NEED(code[1]);
+            w->depth -= code[1];
+            break;
+
+        case OP_JUMP:
+            return flow(w, offset, next + SHORT_OPERAND());
+
+        case OP_LOOP:
+            return flow(w, offset, next - SHORT_OPERAND());
+
+        case OP_JUMP_IF_FALSE:
+            NEED(1);
+            if (!flow(w, offset, next + SHORT_OPERAND())) return false;
+            break;
+
+        case OP_JUMP_IF_FALSE_POP:
+            NEED(1);
+            w->depth--;
+            if (!flow(w, offset, next + SHORT_OPERAND())) return false;
+            break;
+
+        case OP_JUMP_IF_NOT_LESS:
+        case OP_JUMP_IF_NOT_LESS_EQUAL:
+        case OP_JUMP_IF_NOT_GREATER:
+        case OP_JUMP_IF_NOT_GREATER_EQUAL:
+            NEED(2);
+            guard(w, BOTH(ST_INT));
+            w->depth -= 2;
+            if (!flow(w, offset, next + SHORT_OPERAND())) return false;
+            break;
+
+        case OP_CALL:
+        case OP_TAIL_CALL:
+            NEED(code[1] + 1);
+            if (op == OP_TAIL_CALL) return true;
+            w->depth -= code[1] + 1;
+            PUSH_TYPE(ST_ANY);
+            break;
+
+        case OP_CALL_DIRECT:
+        case OP_TAIL_CALL_DIRECT:
+        case OP_CALL_DIRECT_0:
+        case OP_CALL_DIRECT_1:
+        case OP_CALL_DIRECT_2:
+        case OP_CALL_DIRECT_3: {
+            // The callee is a constant; the call opens its slot under the arguments
+            CHECK_CONSTANT(code[1]);
+            Value callee = constants[code[1]];
+            if (!IS_FUNCTION(callee)) return fail(w, offset, "direct call of a constant that is not a function");
+            ObjFunction* function = AS_FUNCTION(callee);
+            int argCount = direct_call_args(code);
+            if (function->arity != argCount) return fail(w, offset, "direct call with the wrong number of arguments");
+            if (function->global < 0 || function->global >= GLOBALS_MAX) {
+                return fail(w, offset, "direct call of a function without a global slot");
+            }
+            NEED(argCount);
+            if (op == OP_TAIL_CALL_DIRECT) return true;
+            w->depth -= argCount;
+            PUSH_TYPE(ST_ANY);
+            break;
+        }
+
+        case OP_ADD_CONST:
+        case OP_SUBTRACT_CONST:
+            CHECK_INT_CONSTANT(code[1]);
+            NEED(1);
+            guard(w, TOP(0) == ST_INT);
+            TOP(0) = ST_INT;
+            break;
+
+        case OP_ADD_LOCALS:
+            CHECK_SLOT(code[1]);
+            CHECK_SLOT(code[2]);
+            PUSH_TYPE(add_result(w->types[code[1]], w->types[code[2]]));
+            break;
+
+        case OP_ADD_LOCAL_CONST:
+            CHECK_SLOT(code[1]);
+            CHECK_INT_CONSTANT(code[2]);
+            guard(w, w->types[code[1]] == ST_INT);
+            PUSH_TYPE(ST_INT);
+            break;
+
+        case OP_INC_LOCAL:
+            CHECK_SLOT(code[1]);
+            CHECK_INT_CONSTANT(code[2]);
+            guard(w, w->types[code[1]] == ST_INT);
+            w->types[code[1]] = ST_INT;
+            break;
+
+        case OP_INC_GLOBAL:
+            CHECK_INT_CONSTANT(code[2]);
+            guard(w, read_global(w, code[1]) == ST_INT);
+            store_global(w, code[1], ST_INT);
+            break;
+
+        case OP_RETURN:
+            // The script may return with an empty stack (its result is false)
+            if (w->function->global >= 0) NEED(1);
+            return true;
+
+        default:
+            return fail(w, offset, "unknown opcode");
+    }
+
+    if (next >= chunk->count) return w->final || fail(w, offset, "execution runs off the end of the code");
+    return flow(w, offset, next);
+
+    #undef NEED
+    #undef TOP
+    #undef PUSH_TYPE
+    #undef SHORT_OPERAND
+    #undef CHECK_CONSTANT
+    #undef CHECK_INT_CONSTANT
+    #undef CHECK_SLOT
+    #undef CHECK_GLOBAL
+    #undef EXPECT
+    #undef BOTH
+}
+
+/**
+ * @brief Walk one function to its fixpoint, then once more to record its
+ * global stores (and, in the last round, rewrite it).
+ */
+static bool walk_function(Unit* unit, ObjFunction* function) {
+    int count = function->chunk.count;
+    int size = count > 0 ? count : 1;
+
+    Walk w;
+    memset(&w, 0, sizeof(w));
+    w.unit = unit;
+    w.function = function;
+    w.chunk = &function->chunk;
+    w.depthAt = (int*)malloc(sizeof(int) * size);
+    w.typesAt = (uint8_t**)calloc(size, sizeof(uint8_t*));
+    w.work = (int*)malloc(sizeof(int) * size);
+    w.queued = (bool*)calloc(size, sizeof(bool));
+
+    bool ok = w.depthAt != NULL && w.typesAt != NULL && w.work != NULL && w.queued != NULL;
+    if (!ok) fprintf(stderr, "Fatal: Out of memory.\n");
+    if (ok && count == 0) ok = fail(&w, 0, "empty code");
+    if (ok) ok = decode(&w);
+
+    if (ok) {
+        // Entry: the script's frame starts empty, a function's holds the
+        // callee and its arguments
+        w.depth = function->global >= 0 ? function->arity + 1 : 0;
+        ok = reserve(&w, w.depth + 1);
+        if (!ok) fprintf(stderr, "Fatal: Out of memory.\n");
+        if (ok) {
+            memset(w.types, ST_ANY, w.depth);
+            ok = flow(&w, 0, 0);
+        }
+    }
+
+    while (ok && w.workCount > 0) {
+        int offset = w.work[--w.workCount];
+        w.queued[offset] = false;
+        ok = step(&w, offset);
+    }
+
+    if (ok) {
+        w.final = true;
+        w.trusted = true;
+        for (int offset = 0; ok && offset < count; offset++) {
+            if (w.depthAt[offset] < 0) continue;
+
+            // reserve_stack() sizes the frame by maxStackDepth; a direct call
+            // opens the callee's slot first
+            uint8_t op = function->chunk.code[offset];
+            int peak = w.depthAt[offset] + (is_direct_call(op) ? 1 : 0);
+            if (function->maxStackDepth > 0 && peak > function->maxStackDepth) {
+                ok = fail(&w, offset, "stack deeper than the function's maxStackDepth");
+            } else {
+                ok = step(&w, offset);
+            }
+        }
+        if (ok && unit->apply) function->trusted = w.trusted;
+    }
+
+    if (w.typesAt != NULL) {
+        for (int i = 0; i < count; i++) free(w.typesAt[i]);
+    }
+    free(w.depthAt);
+    free(w.typesAt);
+    free(w.work);
+    free(w.queued);
+    free(w.types);
+    return ok;
+}
+
+/**
+ * @brief Walk every function of the unit once under the current global
+ * assumptions.
+ *
+ * @return false on a verification error.
+ */
+static bool walk_unit(Unit* unit, ObjFunction** functions, int count) {
+    memset(unit->stored, ST_UNSET, GLOBALS_MAX);
+    for (int i = 0; i < count; i++) {
+        if (!walk_function(unit, functions[i])) return false;
+    }
+    return true;
+}
+
+/**
+ * @brief The functions of the unit that still need verifying: `script` and
+ * the functions in constant pools, transitively.
+ *
+ * @return The number found, or -1 when out of memory.
+ */
+static int collect_functions(ObjFunction* script, ObjFunction*** out) {
+    int capacity = 8;
+    int count = 0;
+    ObjFunction** found = (ObjFunction**)malloc(sizeof(ObjFunction*) * capacity);
+    if (found == NULL) return -1;
+    found[count++] = script;
+
+    for (int scanned = 0; scanned < count; scanned++) {
+        ValueArray* constants = &found[scanned]->chunk.constants;
+        for (int i = 0; i < constants->count; i++) {
+            if (!IS_FUNCTION(constants->values[i])) continue;
+            ObjFunction* function = AS_FUNCTION(constants->values[i]);
+            if (function->verified) continue;
+
+            bool seen = false;
+            for (int j = 0; j < count && !seen; j++) seen = found[j] == function;
+            if (seen) continue;
+
+            if (count == capacity) {
+                capacity *= 2;
+                ObjFunction** grown = (ObjFunction**)realloc(found, sizeof(ObjFunction*) * capacity);
+                if (grown == NULL) {
+                    free(found);
+                    return -1;
+                }
+                found = grown;
+            }
+            found[count++] = function;
+        }
+    }
+
+    *out = found;
+    return count;
+}
+
+bool verify_unit(VM* vm, ObjFunction* script, bool trust) {
+    if (script->verified) return true;
+
+    ObjFunction** functions = NULL;
+    int count = collect_functions(script, &functions);
+
+    Unit unit;
+    unit.vm = vm;
+    unit.globals = (uint8_t*)malloc(GLOBALS_MAX);
+    unit.stored = (uint8_t*)malloc(GLOBALS_MAX);
+    unit.apply = false;
+
+    bool ok = count >= 0 && unit.globals != NULL && unit.stored != NULL;
+    if (!ok) fprintf(stderr, "Fatal: Out of memory.\n");
+
+    if (ok) {
+        // What earlier units were verified against, else the current value
+        for (int i = 0; i < GLOBALS_MAX; i++) {
+            uint8_t recorded = vm->globalTypes != NULL ? vm->globalTypes[i] : ST_UNSET;
+            if (recorded != ST_UNSET) unit.globals[i] = recorded;
+            else unit.globals[i] = holds_value(vm->globals[i]) ? type_of(vm->globals[i]) : ST_UNSET;
+        }
+    }
+
+    // Widen the assumptions until every store agrees with them
+    bool changed = true;
+    while (ok && changed) {
+        ok = walk_unit(&unit, functions, count);
+        changed = false;
+        for (int i = 0; ok && i < GLOBALS_MAX; i++) {
+            uint8_t joined = join(unit.globals[i], unit.stored[i]);
+            if (joined != unit.globals[i]) {
+                unit.globals[i] = joined;
+                changed = true;
+            }
+        }
+    }
+
+    if (ok && trust) {
+        // Earlier verified code may rely on a global's type
+        for (int i = 0; ok && vm->globalTypes != NULL && i < GLOBALS_MAX; i++) {
+            if (vm->globalTypes[i] != ST_UNSET && vm->globalTypes[i] != unit.globals[i]) {
+                fprintf(stderr, "Verifier Error: global slot %d is assigned a value of a "
+                                "different type than earlier code was verified with.\n", i);
+                ok = false;
+            }
+        }
+        if (ok && vm->globalTypes == NULL) {
+            vm->globalTypes = (uint8_t*)calloc(GLOBALS_MAX, 1);
+            if (vm->globalTypes == NULL) {
+                fprintf(stderr, "Fatal: Out of memory.\n");
+                ok = false;
+            }
+        }
+        if (ok) {
+            unit.apply = true;
+            ok = walk_unit(&unit, functions, count);
+        }
+        if (ok) {
+            memcpy(vm->globalTypes, unit.globals, GLOBALS_MAX);
+            for (int i = 0; i < count; i++) functions[i]->verified = true;
+        }
+    }
+
+    free(functions);
+    free(unit.globals);
+    free(unit.stored);
+    return ok;
+}
@@ -6,7 +6,8 @@
  * and helper macros used for bytecode execution. 
  * 
  * The VM is a simple stack-based registerless interpreter 
- * similar to Lox/Wren-style VMs.
+ * similar to Lox/Wren-style VMs. With --register-vm the code is translated
+ * to register code (regcode.h) first and run by run_reg() instead.
  * 
  * Design:
  *  - Values are on a single operand stack (vm.stack).
@@ -26,10 +27,40 @@
 #include "vm/object.h" // Need this to access ObjString struct for freeing
 #include "vm/memory.h"
 #include "vm/compiler.h"
-
-// The global VM instance (single VM model)
+#include "vm/profiler.h"
+#include "vm/alloc_profiler.h"
+#include "vm/regcode.h"
+#include "vm/jit.h"
+#include "vm/verify.h"
+#include "vm/memo.h"
+#include "vm/trace.h"
+#include "thread_pool.h"
+
+// The default VM instance (CLI, REPL and tests)
 VM vm;
 
+// The instance this thread allocates into; see use_vm()
+DETERMA_THREAD_LOCAL VM* currentVM = &vm;
+
+// Limits applied by the next init_vm() (see set_vm_limits)
+static int frameLimit = FRAMES_LIMIT_DEFAULT;
+static int stackLimit = STACK_LIMIT_DEFAULT;
+static int gcStepBudget = GC_STEP_BUDGET_DEFAULT;
+static int gcThreads = GC_THREADS_DEFAULT;
+static double gcGrowFactor = GC_HEAP_GROW_FACTOR_DEFAULT;
+static size_t gcInitialThreshold = GC_INITIAL_THRESHOLD_DEFAULT;
+static bool profiling = false;
+static bool allocProfiling = false;
+static bool registerBackend = false;
+static bool jitEnabled = false;
+static bool unsafeFast = false;
+static bool memoize = false;
+static size_t outputBufferSize = OUTPUT_BUFFER_DEFAULT;
+
+// Values a frame may push beyond its own code's worst case: C helpers
+// (string interning, natives) briefly root objects on the stack
+#define STACK_HEADROOM 8
+
 
 /* ============================
  *  Stack & VM Initialization
@@ -38,9 +69,59 @@ VM vm;
 /**
  * @brief Reset the VM operand stack to an empty state.
  */
-static void reset_stack() {
-    vm.stackTop = vm.stack;
-    vm.frameCount = 0;
+static void reset_stack(VM* vm) {
+    vm->stackTop = vm->stack;
+    vm->frameCount = 0;
+}
+
+void set_vm_limits(int maxFrames, int maxStack) {
+    if (maxFrames > 0) frameLimit = maxFrames;
+    if (maxStack > 0) stackLimit = maxStack;
+}
+
+void set_gc_step_budget(int budget) {
+    gcStepBudget = budget > 0 ? budget : 0;
+}
+
+void set_gc_threads(int threads) {
+    gcThreads = threads > 1 ? threads : 1;
+}
+
+void set_gc_tuning(double growFactor, long initialThreshold) {
+    if (growFactor > 0) gcGrowFactor = growFactor;
+    if (initialThreshold > 0) gcInitialThreshold = (size_t)initialThreshold;
+}
+
+void set_vm_profiling(bool enabled) {
+    profiling = enabled;
+}
+
+void set_vm_alloc_profiling(bool enabled) {
+    allocProfiling = enabled;
+}
+
+void set_vm_register_backend(bool enabled) {
+    registerBackend = enabled;
+}
+
+void set_vm_jit(bool enabled) {
+    jitEnabled = enabled;
+}
+
+void set_vm_unsafe_fast(bool enabled) {
+    unsafeFast = enabled;
+}
+
+void set_vm_memoize(bool enabled) {
+    memoize = enabled;
+}
+
+void set_vm_output_buffer(long size) {
+    if (size > 0) outputBufferSize = (size_t)size;
+}
+
+void vm_flush_output(VM* vm) {
+    output_flush(&vm->output);
 }
 
 /**
@@ -48,33 +129,311 @@ static void reset_stack() {
  * 
  * (stack, GC state, object list).
  */
-void init_vm(void) {
-    reset_stack();
-    vm.objects = NULL; // Initialize the tracker list
+void vm_init(VM* vm) {
+    vm->frameLimit = frameLimit;
+    vm->stackLimit = stackLimit;
+
+    // Reuse the stacks if the VM was initialized before without free_vm()
+    if (vm->frames == NULL) {
+        vm->frameCapacity = frameLimit < FRAMES_INITIAL ? frameLimit : FRAMES_INITIAL;
+        vm->frames = (CallFrame*)malloc(sizeof(CallFrame) * vm->frameCapacity);
+    }
+    if (vm->stack == NULL) {
+        vm->stackCapacity = stackLimit < STACK_INITIAL ? stackLimit : STACK_INITIAL;
+        vm->stack = (Value*)malloc(sizeof(Value) * vm->stackCapacity);
+    }
+    if (vm->frames == NULL || vm->stack == NULL) {
+        fprintf(stderr, "Fatal: Out of memory.\n");
+        exit(1);
+    }
+
+    reset_stack(vm);
+    // Code compiled later may store into any slot this thread's compiler has bound
+    if (vm->globalLimit < compiler_global_count()) vm->globalLimit = compiler_global_count();
+    vm->objects = NULL; // Initialize the tracker list
+    init_table(&vm->strings);
 
     // --- GC Init ---
-    vm.grayCount = 0;
-    vm.grayCapacity = 0;
-    vm.grayStack = NULL;
-    vm.bytesAllocated = 0;
-    vm.nextGC = 1024 * 1024; // Start GC at 1MB
+    vm->grayCount = 0;
+    vm->grayCapacity = 0;
+    vm->grayStack = NULL;
+    vm->bytesAllocated = 0;
+    vm->nextGC = gcInitialThreshold; // 1MB unless tuned
+    vm->gcGrowFactor = gcGrowFactor;
+    memset(&vm->gcStats, 0, sizeof(vm->gcStats));
+    vm->gcPauseDepth = 0;
+    memset(&vm->nursery, 0, sizeof(vm->nursery)); // Allocated on first use
+    vm->gcPhase = GC_IDLE;
+    vm->gcStepBudget = gcStepBudget;
+    vm->gcThreads = gcThreads; // gcPool is kept: the collector restarts it if the count changed
+    vm->gcGlobalCursor = 0;
+    vm->sweepCursor = NULL;
+    vm->sweepSurvivors = NULL;
+    vm->sweepSurvivorsTail = NULL;
+    vm->startTime = vm_monotonic_ns();
+    if (profiling && vm->profiler == NULL) vm->profiler = new_profiler();
+    if (allocProfiling && vm->allocProfiler == NULL) vm->allocProfiler = new_alloc_profiler();
+    // Allocation sites are stack code offsets, and memoizing rewrites stack code
+    vm->registerBackend = registerBackend && vm->allocProfiler == NULL && !memoize;
+    vm->jit = jitEnabled && jit_available() && vm->profiler == NULL && !registerBackend;
+    vm->unsafeFast = unsafeFast && vm->profiler == NULL;
+    vm->memoize = memoize;
+    if (vm->output.data != NULL) output_free(&vm->output); // Re-init: what was printed goes out first
+    output_init(&vm->output, outputBufferSize);
+    vm_trace_init(vm);
+    if (vm->allocProfiler != NULL) vm_set_tracer(vm, &vm->allocProfiler->tracer);
 }
 
 /**
  * @brief Free VM resources for heap-managed resources
  */
-void free_vm() {
-    Obj* object = vm.objects;
-    while (object != NULL) {
-        Obj* next = object->next;
-        free_object(object); // Calls memory.c's free_object
-        object = next;
-    }
-    vm.objects = NULL;
+void vm_free(VM* vm) {
+    // Freeing goes through reallocate(), which accounts to the current VM
+    VM* previous = use_vm(vm);
+
+    vm_free_objects(vm); // Including any the collector is halfway through
+    free_table(&vm->strings);
+
+    // Globals would point into the heap just freed (none past the limit was set)
+    memset(vm->globals, 0, sizeof(Value) * (size_t)vm->globalLimit);
+    vm->globalLimit = 0;
 
     // Free the gray stack
-    free(vm.grayStack);
-    vm.grayStack = NULL;
+    free(vm->grayStack);
+    vm->grayStack = NULL;
+    vm->grayCount = 0;
+    vm->grayCapacity = 0;
+
+    // Young objects die with their region
+    free(vm->nursery.start);
+    free(vm->nursery.remembered);
+    memset(&vm->nursery, 0, sizeof(vm->nursery));
+
+    thread_pool_free(vm->gcPool);
+    vm->gcPool = NULL;
+
+    free_profiler(vm->profiler);
+    vm->profiler = NULL;
+    if (vm->allocProfiler != NULL) vm->tracer = NULL; // It was the profiler's
+    free_alloc_profiler(vm->allocProfiler);
+    vm->allocProfiler = NULL;
+    free(vm->globalTypes);
+    vm->globalTypes = NULL;
+    output_free(&vm->output);
+
+    free(vm->frames);
+    vm->frames = NULL;
+    vm->frameCapacity = 0;
+    free(vm->stack);
+    vm->stack = NULL;
+    vm->stackTop = NULL;
+    vm->stackCapacity = 0;
+
+    use_vm(previous);
+}
+
+void init_vm(void) {
+    vm_init(currentVM);
+}
+
+void free_vm(void) {
+    vm_free(currentVM);
+}
+
+/**
+ * @brief Allocate and initialize a standalone VM instance.
+ *
+ * Each instance has its own heap, intern table, stacks and globals. Select it
+ * with use_vm() on the thread that compiles for it, or pass it to
+ * vm_interpret() directly.
+ *
+ * @return VM* The new instance (never NULL; exits when out of memory).
+ */
+VM* new_vm(void) {
+    VM* machine = (VM*)calloc(1, sizeof(VM));
+    if (machine == NULL) {
+        fprintf(stderr, "Fatal: Out of memory.\n");
+        exit(1);
+    }
+    vm_init(machine);
+    return machine;
+}
+
+/**
+ * @brief Free an instance created with new_vm() and everything it owns.
+ */
+void destroy_vm(VM* machine) {
+    if (machine == NULL) return;
+    vm_free(machine);
+    if (currentVM == machine) currentVM = &vm;
+    free(machine);
+}
+
+/**
+ * @brief Make `machine` the calling thread's current VM.
+ *
+ * @return VM* The previously current VM, to restore afterwards.
+ */
+VM* use_vm(VM* machine) {
+    VM* previous = currentVM;
+    currentVM = machine;
+    return previous;
+}
+
+/**
+ * @brief Grow the operand stack to hold at least `needed` Values.
+ *
+ * The stack may move, so stackTop and every frame's slots are rebased.
+ * Only called while setting up a frame (call()/interpret()), never while
+ * run() holds cached stack pointers.
+ *
+ * @return false if that would exceed the stack limit.
+ */
+static bool grow_stack(VM* vm, int needed) {
+    if (needed > vm->stackLimit) return false;
+
+    int capacity = vm->stackCapacity * 2;
+    if (capacity < needed) capacity = needed;
+    if (capacity > vm->stackLimit) capacity = vm->stackLimit;
+
+    // Copy instead of realloc() so the old block is still valid to rebase from
+    Value* stack = (Value*)malloc(sizeof(Value) * capacity);
+    if (stack == NULL) return false;
+
+    ptrdiff_t used = vm->stackTop - vm->stack;
+    memcpy(stack, vm->stack, sizeof(Value) * used);
+    for (int i = 0; i < vm->frameCount; i++) {
+        vm->frames[i].slots = stack + (vm->frames[i].slots - vm->stack);
+    }
+    free(vm->stack);
+
+    vm->stack = stack;
+    vm->stackTop = stack + used;
+    vm->stackCapacity = capacity;
+    return true;
+}
+
+/**
+ * @brief Make room above stackTop for everything `function`'s code can push.
+ *
+ * The function's precomputed maxStackDepth bounds it (it also counts the
+ * callee and arguments already below stackTop, which costs a few slots but
+ * no arithmetic per call). Hand-built code without one falls back to
+ * chunk.count (every instruction pushes at most one value).
+ *
+ * @return false on stack overflow.
+ */
+static bool reserve_stack(VM* vm, ObjFunction* function) {
+    int deepest = function->maxStackDepth > 0 ? function->maxStackDepth : function->chunk.count;
+    int needed = (int)(vm->stackTop - vm->stack) + deepest + STACK_HEADROOM;
+    return needed <= vm->stackCapacity || grow_stack(vm, needed);
+}
+
+/**
+ * @brief Make room for one more CallFrame, up to the frame limit.
+ *
+ * @return false if the call stack is full.
+ */
+static bool reserve_frame(VM* vm) {
+    if (vm->frameCount < vm->frameCapacity) return true;
+    if (vm->frameCapacity >= vm->frameLimit) return false;
+
+    int capacity = vm->frameCapacity * 2;
+    if (capacity > vm->frameLimit) capacity = vm->frameLimit;
+
+    CallFrame* frames = (CallFrame*)realloc(vm->frames, sizeof(CallFrame) * capacity);
+    if (frames == NULL) return false;
+    vm->frames = frames;
+    vm->frameCapacity = capacity;
+    return true;
+}
+
+/**
+ * @brief Count a call or loop back-edge of `function`, and compile it to
+ * machine code once it is hot (jit.h).
+ */
+static inline void count_hotness(VM* vm, ObjFunction* function) {
+    if (vm->jit && ++function->hotness == JIT_HOT_THRESHOLD) jit_compile(function);
+}
+
+/**
+ * @brief Get a new CallFrame for `function`, growing the frame and operand
+ * stacks when needed.
+ *
+ * This is the one stack overflow check per call: the operand stack is
+ * grown up front to fit the deepest stack the function's code can reach
+ * (see reserve_stack()), which is why PUSH/push() need no check of their own.
+ *
+ * @return CallFrame* The new frame, or NULL on stack overflow.
+ */
+static CallFrame* push_frame(VM* vm, ObjFunction* function) {
+    if (!reserve_frame(vm)) return NULL;
+    if (!reserve_stack(vm, function)) return NULL;
+    count_hotness(vm, function);
+
+    return &vm->frames[vm->frameCount++];
+}
+
+/**
+ * @brief Make sure the register window ending at stack index `end` exists.
+ *
+ * On the register VM stackTop is the high-water mark of the frames' windows
+ * (registers above a frame's live values are not tracked), and everything
+ * below it is scanned by the collector. Stack that a window reaches for the
+ * first time is cleared, so no stale value from an earlier run is scanned.
+ *
+ * @return false on stack overflow.
+ */
+static bool reserve_registers(VM* vm, ptrdiff_t end) {
+    if (end <= vm->stackTop - vm->stack) return true;
+
+    if (end + STACK_HEADROOM > vm->stackCapacity && !grow_stack(vm, (int)end + STACK_HEADROOM)) {
+        return false;
+    }
+
+    Value* top = vm->stack + end;
+    for (Value* slot = vm->stackTop; slot < top; slot++) *slot = BOOL_VAL(false);
+    vm->stackTop = top;
+    return true;
+}
+
+/**
+ * @brief Push a register VM frame for `function` whose slots start at
+ * stack index `base` (where the callee is).
+ *
+ * @return CallFrame* The new frame, or NULL on stack overflow.
+ */
+static CallFrame* push_register_frame(VM* vm, ObjFunction* function, ptrdiff_t base) {
+    if (!reserve_frame(vm)) return NULL;
+    if (!reserve_registers(vm, base + function->registers)) return NULL;
+
+    CallFrame* frame = &vm->frames[vm->frameCount++];
+    frame->function = function;
+    frame->ip = function->chunk.code;
+    frame->slots = vm->stack + base;
+    return frame;
+}
+
+/**
+ * @brief Call `function` from tail position by reusing the active frame.
+ *
+ * The callee and its arguments (the top argCount + 1 values) slide down
+ * over the frame's slots, so the frame depth stays constant. The arity
+ * must already have been checked.
+ *
+ * @return false on stack overflow.
+ */
+static bool tail_call(VM* vm, ObjFunction* function, int argCount) {
+    CallFrame* frame = &vm->frames[vm->frameCount - 1];
+    memmove(frame->slots, vm->stackTop - argCount - 1, sizeof(Value) * (argCount + 1));
+    vm->stackTop = frame->slots + argCount + 1;
+
+    if (!reserve_stack(vm, function)) return false;
+    count_hotness(vm, function);
+
+    frame->function = function;
+    frame->ip = function->chunk.code;
+    return true;
 }
 
 // ====================
@@ -86,17 +445,17 @@ void free_vm() {
  *
  * @param value The value to push.
  */
-void push(Value value) {
+void vm_push(VM* vm, Value value) {
     // Optimization: optional debug safety check
     // Ensures we do not overflow stack
     // (no behavior change unless the stack overflows)
 #ifdef VM_STACK_CHECK
-    if (vm.stackTop - vm.stack >= STACK_MAX) {
+    if (vm->stackTop - vm->stack >= vm->stackCapacity) {
         fprintf(stderr, "VM Error: Stack overflow.\n");
         return;
     }
 #endif
-    *vm.stackTop++ = value;
+    *vm->stackTop++ = value;
 }
 
 /**
@@ -104,9 +463,9 @@ void push(Value value) {
  *
  * @return The popped stack value.
  */
-Value pop() {
+Value vm_pop(VM* vm) {
     // Optimization: Pre-decrement is slightly faster and idiomatic
-    return *--vm.stackTop;
+    return *--vm->stackTop;
 }
 
 /**
@@ -115,10 +474,15 @@ Value pop() {
  * @param distance How far from the top: 0 = top, 1 = below top, etc.
  * @return The stack value at that distance.
  */
-Value peek(int distance) {
-    return vm.stackTop[-1 - distance];
+Value vm_peek(VM* vm, int distance) {
+    return vm->stackTop[-1 - distance];
 }
 
+// Shorthands for the current VM
+void push(Value value) { vm_push(currentVM, value); }
+Value pop(void) { return vm_pop(currentVM); }
+Value peek(int distance) { return vm_peek(currentVM, distance); }
+
 
 /* ============================
  *  Runtime Error & Calls
@@ -132,7 +496,10 @@ Value peek(int distance) {
  * 
  * @param format 
  */
-static void runtimeError(const char* format, ...) {
+static void runtimeError(VM* vm, const char* format, ...) {
+    // What the script printed before failing comes first
+    output_flush(&vm->output);
+
     va_list args;
     va_start(args, format);
     vfprintf(stderr, format, args);
@@ -140,13 +507,13 @@ static void runtimeError(const char* format, ...) {
     fputs("\n", stderr);
 
     // Print Stack Trace
-    for (int i = vm.frameCount - 1; i >= 0; i--) {
-        CallFrame* frame = &vm.frames[i];
+    for (int i = vm->frameCount - 1; i >= 0; i--) {
+        CallFrame* frame = &vm->frames[i];
         ObjFunction* function = frame->function;
 
         // IP points *past* current instruction, step back one
         size_t instruction = (size_t)(frame->ip - function->chunk.code - 1);
-        int line = function->chunk.lines[instruction];
+        int line = get_line(&function->chunk, (int)instruction);
 
         fprintf(stderr, "[line %d] in ", line);
         if (function->name == NULL) {
@@ -156,7 +523,16 @@ static void runtimeError(const char* format, ...) {
         }
     }
 
-    reset_stack();
+    reset_stack(vm);
+}
+
+void vm_runtime_error(VM* vm, const char* format, ...) {
+    char message[256];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(message, sizeof(message), format, args);
+    va_end(args);
+    runtimeError(vm, "%s", message);
 }
 
 /**
@@ -170,27 +546,47 @@ static void runtimeError(const char* format, ...) {
  * @return true 
  * @return false 
  */
-static bool call(ObjFunction* function, int argCount) {
+static bool call(VM* vm, ObjFunction* function, int argCount) {
     if (argCount != function->arity) {
-        runtimeError("Expected %d arguments but got %d.", function->arity, argCount);
+        runtimeError(vm, "Expected %d arguments but got %d.", function->arity, argCount);
         return false;
     }
 
-    if (vm.frameCount == FRAMES_MAX) {
-        runtimeError("Stack overflow.");
+    CallFrame* frame = push_frame(vm, function);
+    if (frame == NULL) {
+        runtimeError(vm, "Stack overflow.");
         return false;
     }
 
-    CallFrame* frame = &vm.frames[vm.frameCount++];
     frame->function = function;
     frame->ip = function->chunk.code;
 
     // The slots start at where the arguments are on the stack
-    frame->slots = vm.stackTop - argCount - 1; // -1 for the function itself (which is slot 0)
+    frame->slots = vm->stackTop - argCount - 1; // -1 for the function itself (which is slot 0)
     return true;
 }
 
 
+/**
+ * @brief Run a native in place: no CallFrame, its result replaces the
+ * callee and arguments on the stack.
+ */
+static bool call_native(VM* vm, ObjNative* native, int argCount) {
+    if (argCount != native->arity) {
+        runtimeError(vm, "Expected %d arguments but got %d.", native->arity, argCount);
+        return false;
+    }
+
+    Value result = BOOL_VAL(false);
+    if (!native->function(vm, argCount, vm->stackTop - argCount, &result)) {
+        return false; // The native reported the error (and the stack was reset)
+    }
+
+    vm->stackTop -= argCount + 1;
+    *vm->stackTop++ = result;
+    return true;
+}
+
 /**
  * @brief Function to return a boolean based on the function call value
  * 
@@ -199,18 +595,21 @@ static bool call(ObjFunction* function, int argCount) {
  * @return true 
  * @return false 
  */
-static bool callValue(Value callee, int argCount) {
+static bool callValue(VM* vm, Value callee, int argCount) {
     if (IS_OBJ(callee)) {
         switch (OBJ_TYPE(callee)) {
             case OBJ_FUNCTION: 
-                return call(AS_FUNCTION(callee), argCount);
+                return call(vm, AS_FUNCTION(callee), argCount);
+
+            case OBJ_NATIVE:
+                return call_native(vm, AS_NATIVE(callee), argCount);
 
             // Add more cases in the future for Closures, Classes, Objects etc
             default:
                 break; // Non-callable object
         }
     }
-    runtimeError("Can only call functions and classes.");
+    runtimeError(vm, "Can only call functions and classes.");
     return false;
 }
 
@@ -219,336 +618,1524 @@ static bool callValue(Value callee, int argCount) {
 // Core Execution Loop
 // -----------------------------------------------------------------------------
 
-/**
- * @brief Helper macro: current frame.
- */
-#define FRAME() (vm.frames[vm.frameCount - 1])
-
 /**
  * @brief Execute bytecode instructions until OP_RETURN.
  *
  * @return InterpretResult The final interpreter state.
  *
  * Performance note:
- * The interpreter loop caches frequently-used VM fields (stackTop, ip)
- * into local variables to make the loop tighter. This is a common VM
- * optimization pattern.
+ * The interpreter loop caches the hot VM fields in locals so the compiler
+ * can keep them in registers:
+ *   - frame     : the active CallFrame
+ *   - ip        : instruction pointer of the active frame
+ *   - slots     : base of the active frame's locals
+ *   - constants : the active function's constant pool
+ *   - sp        : operand stack top
+ *   - globals   : the VM's global slots
+ *
+ * They are only written back to `vm` (STORE_FRAME) where someone else can
+ * observe them: before OP_CALL, on OP_RETURN, before reporting a runtime
+ * error (the stack trace reads frame->ip) and before anything that may
+ * allocate (the GC scans vm->stack up to vm->stackTop). After a frame change
+ * they are reloaded with LOAD_FRAME.
+ *
+ * Dispatch is direct-threaded (computed goto) when VM_COMPUTED_GOTO is
+ * set in common.h, and a plain switch otherwise.
  */
-static InterpretResult run() {
+static InterpretResult run(VM* vm) {
+    CallFrame* frame;
+    uint8_t* ip;
+    Value* slots;
+    Value* constants;
+    Value* sp = vm->stackTop;
+    Value* globals = vm->globals;
+
+    // Flush cached registers back to the VM
+    #define STORE_FRAME() \
+        do { \
+            frame->ip = ip; \
+            vm->stackTop = sp; \
+        } while (0)
+
+    // (Re)load cached registers from the current top frame
+    #define LOAD_FRAME() \
+        do { \
+            frame = &vm->frames[vm->frameCount - 1]; \
+            ip = frame->ip; \
+            slots = frame->slots; \
+            constants = frame->function->chunk.constants.values; \
+            SELECT_DISPATCH(); \
+        } while (0)
+
     // Read macros using local cached registers
-    #define READ_BYTE() (*FRAME().ip++)
+    #define READ_BYTE() (*ip++)
 
     // Read a constant from the current function's constant pool
-    #define READ_CONSTANT() (FRAME().function->chunk.constants.values[READ_BYTE()])
+    #define READ_CONSTANT() (constants[READ_BYTE()])
 
     // Macro to Read 16-bit operand (Big Endian)
     #define READ_SHORT() \
-        (FRAME().ip += 2, (uint16_t)((FRAME().ip[-2] << 8) | FRAME().ip[-1]))
+        (ip += 2, (uint16_t)((ip[-2] << 8) | ip[-1]))
+
+    // Stack macros operating on the cached stack top
+    #define PUSH(value) (*sp++ = (value))
+    #define POP()       (*--sp)
+    #define PEEK(i)     (sp[-1 - (i)])
+
+    // Store to a global through the write barriers: the nursery's remembered
+    // set for young values, incremental marking for old ones
+    #define SET_GLOBAL(index, value) \
+        do { \
+            Value stored = (value); \
+            globals[index] = stored; \
+            if (IS_OBJ(stored)) { \
+                if (AS_OBJ(stored)->isYoung) vm_remember_global(vm, index); \
+                else if (vm->gcPhase == GC_MARK) vm_write_barrier(vm, stored); \
+            } \
+        } while (0)
+
+    // GC safepoint for the nursery, right after an instruction that may
+    // allocate young objects: every live value is on the stack or in a global
+    #define NURSERY_SAFEPOINT() \
+        do { \
+            if (vm->nursery.full) { \
+                vm->stackTop = sp; \
+                vm_collect_nursery(vm); \
+            } \
+        } while (0)
+
+#ifdef VM_JIT
+    // Continue in the frame's machine code when it has a template for the
+    // next instruction (jit.h), then resume wherever that code stopped
+    #define ENTER_JIT() \
+        do { \
+            JitCode* jit = frame->function->jit; \
+            if (jit != NULL) { \
+                const void* entry = jit->entries[ip - frame->function->chunk.code]; \
+                if (entry != NULL) { \
+                    JitExit stop = jit->enter(slots, sp, globals, entry); \
+                    ip = frame->function->chunk.code + stop.offset; \
+                    sp = stop.sp; \
+                } \
+            } \
+        } while (0)
+#else
+    #define ENTER_JIT() do { } while (0)
+#endif
 
-    // PEEK macro to use local stackTop
-    #define PEEK(i) peek(i)
+    // A native in tail position pushed no frame: its result (on top) is
+    // this frame's return value, handed back as OP_RETURN would
+    #define RETURN_NATIVE_RESULT() \
+        do { \
+            sp = vm->stackTop; \
+            Value nativeResult = POP(); \
+            vm->frameCount--; \
+            if (vm->frameCount == 0) { \
+                PUSH(nativeResult); \
+                vm->stackTop = sp; \
+                return INTERPRET_OK; \
+            } \
+            sp = frame->slots; \
+            PUSH(nativeResult); \
+            LOAD_FRAME(); \
+            DISPATCH(); \
+        } while (0)
+
+    // Insert `callee` under the top argCount values (the slot OP_CALL's
+    // callee would occupy), for calls whose callee is not on the stack
+    #define OPEN_CALLEE_SLOT(callee, argCount) \
+        do { \
+            for (int i = 0; i < (argCount); i++) { \
+                sp[-i] = sp[-i - 1]; \
+            } \
+            sp[-(argCount)] = (callee); \
+            sp++; \
+        } while (0)
+
+    // OP_CALL_DIRECT and its fixed-arity forms: while the callee's global
+    // still holds `function`, its frame is pushed without the callee and
+    // arity checks and the registers are set from it directly
+    #define CALL_DIRECT(function, argCount) \
+        do { \
+            Value callee = globals[(function)->global]; \
+            OPEN_CALLEE_SLOT(callee, argCount); \
+            STORE_FRAME(); \
+            if (IS_OBJ(callee) && AS_OBJ(callee) == (Obj*)(function)) { \
+                CallFrame* next = push_frame(vm, function); \
+                if (next == NULL) { \
+                    runtimeError(vm, "Stack overflow."); \
+                    return INTERPRET_RUNTIME_ERROR; \
+                } \
+                sp = vm->stackTop; /* The stack may have moved while growing */ \
+                next->function = function; \
+                next->ip = (function)->chunk.code; \
+                next->slots = sp - (argCount) - 1; \
+                frame = next; \
+                ip = next->ip; \
+                slots = next->slots; \
+                constants = (function)->chunk.constants.values; \
+                SELECT_DISPATCH(); \
+            } else { \
+                /* The global was rebound since: take the generic path */ \
+                if (!callValue(vm, callee, argCount)) return INTERPRET_RUNTIME_ERROR; \
+                LOAD_FRAME(); \
+                sp = vm->stackTop; \
+            } \
+            ENTER_JIT(); \
+            DISPATCH(); \
+        } while (0)
+
+    // Report a runtime error with the registers flushed, then bail out
+    #define RUNTIME_ERROR(...) \
+        do { \
+            STORE_FRAME(); \
+            runtimeError(vm, __VA_ARGS__); \
+            return INTERPRET_RUNTIME_ERROR; \
+        } while (0)
 
     // Optimized binary operation macro
     // Note: using const Value ensures no aliasing surprises & better optimization
     #define BINARY_OP(op) \
         do { \
-            if (!IS_INT(peek(0)) || !IS_INT(peek(1))) { \
-                runtimeError("Operands must be numbers."); \
-                return INTERPRET_RUNTIME_ERROR; \
+            if (!IS_INT(PEEK(0)) || !IS_INT(PEEK(1))) { \
+                RUNTIME_ERROR("Operands must be numbers."); \
+            } \
+            int b = AS_INT(POP()); \
+            int a = AS_INT(POP()); \
+            PUSH(INT_VAL(a op b)); \
+        } while (0)
+
+    // Unchecked binary op for operands the typechecker proved to be ints.
+    // Replaces the left operand in place instead of pop/pop/push.
+    #define INT_BINARY_OP(valueType, op) \
+        do { \
+            int b = AS_INT(POP()); \
+            int a = AS_INT(PEEK(0)); \
+            sp[-1] = valueType(a op b); \
+        } while (0)
+
+    // Compare-and-branch: pop two ints, jump unless `a op b`
+    #define COMPARE_BRANCH(op) \
+        do { \
+            uint16_t offset = READ_SHORT(); \
+            if (!IS_INT(PEEK(0)) || !IS_INT(PEEK(1))) { \
+                RUNTIME_ERROR("Operands must be numbers."); \
             } \
-            int b = AS_INT(pop()); \
-            int a = AS_INT(pop()); \
-            push(INT_VAL(a op b)); \
+            int b = AS_INT(POP()); \
+            int a = AS_INT(POP()); \
+            if (!(a op b)) ip += offset; \
         } while (0)
 
-    // Helper macro to assist with debugging stack operations and value pushing
-
-    #define DEBUG_STACK() \
-    do { \
-        printf("STACK: "); \
-        for (Value* s = vm.stack; s < vm.stackTop; s++) { \
-            print_value(*s); \
-            printf(" | "); \
-        } \
-        printf("\n"); \
-    } while(0)
-
-    for (;;) {
-        // uncomment for viewing stack operations
-        // DEBUG_STACK();
-        // printf("OP: %d\n", *FRAME().ip);
-
-        #ifdef DEBUG_TRACE_EXECUTION
-                printf("          ");
-                for (Value* slot = vm.stack; slot < stackTop; slot++) {
-                    printf("[ ");
-                    print_value(*slot);
-                    printf(" ]");
+    // Compare-and-branch on operands the verifier proved to be ints
+    #define INT_COMPARE_BRANCH(op) \
+        do { \
+            uint16_t offset = READ_SHORT(); \
+            int b = AS_INT(POP()); \
+            int a = AS_INT(POP()); \
+            if (!(a op b)) ip += offset; \
+        } while (0)
+
+    /*
+     * Dispatch
+     * --------
+     * With VM_COMPUTED_GOTO (GCC/Clang) every handler ends by jumping straight
+     * to the next handler through a label table indexed by OpCode, so each
+     * opcode gets its own indirect branch (better branch prediction than the
+     * single shared jump of a switch). Otherwise we fall back to the portable
+     * switch below. Handlers are written once with CASE()/DISPATCH() and work
+     * in both modes.
+     */
+#ifdef VM_COMPUTED_GOTO
+    static void* dispatchTable[] = {
+        [OP_CONSTANT]      = &&op_OP_CONSTANT,
+        [OP_CONSTANT_LONG] = &&op_OP_CONSTANT_LONG,
+        [OP_TRUE]          = &&op_OP_TRUE,
+        [OP_FALSE]         = &&op_OP_FALSE,
+        [OP_NIL]           = &&op_OP_NIL,
+        [OP_ADD]           = &&op_OP_ADD,
+        [OP_SUBTRACT]      = &&op_OP_SUBTRACT,
+        [OP_MULTIPLY]      = &&op_OP_MULTIPLY,
+        [OP_DIVIDE]        = &&op_OP_DIVIDE,
+        [OP_MODULO]        = &&op_OP_MODULO,
+        [OP_NEGATE]        = &&op_OP_NEGATE,
+        [OP_NOT]           = &&op_OP_NOT,
+        [OP_EQUAL]         = &&op_OP_EQUAL,
+        [OP_GREATER]       = &&op_OP_GREATER,
+        [OP_LESS]          = &&op_OP_LESS,
+        [OP_ADD_INT]       = &&op_OP_ADD_INT,
+        [OP_SUBTRACT_INT]  = &&op_OP_SUBTRACT_INT,
+        [OP_MULTIPLY_INT]  = &&op_OP_MULTIPLY_INT,
+        [OP_DIVIDE_INT]    = &&op_OP_DIVIDE_INT,
+        [OP_MODULO_INT]    = &&op_OP_MODULO_INT,
+        [OP_CONCAT]        = &&op_OP_CONCAT,
+        [OP_EQUAL_INT]     = &&op_OP_EQUAL_INT,
+        [OP_GREATER_INT]   = &&op_OP_GREATER_INT,
+        [OP_LESS_INT]      = &&op_OP_LESS_INT,
+        [OP_NOT_EQUAL]         = &&op_OP_NOT_EQUAL,
+        [OP_GREATER_EQUAL]     = &&op_OP_GREATER_EQUAL,
+        [OP_LESS_EQUAL]        = &&op_OP_LESS_EQUAL,
+        [OP_NOT_EQUAL_INT]     = &&op_OP_NOT_EQUAL_INT,
+        [OP_GREATER_EQUAL_INT] = &&op_OP_GREATER_EQUAL_INT,
+        [OP_LESS_EQUAL_INT]    = &&op_OP_LESS_EQUAL_INT,
+        [OP_ADD_CONST]         = &&op_OP_ADD_CONST,
+        [OP_SUBTRACT_CONST]    = &&op_OP_SUBTRACT_CONST,
+        [OP_ADD_LOCALS]        = &&op_OP_ADD_LOCALS,
+        [OP_ADD_LOCAL_CONST]   = &&op_OP_ADD_LOCAL_CONST,
+        [OP_JUMP_IF_FALSE_POP] = &&op_OP_JUMP_IF_FALSE_POP,
+        [OP_JUMP_IF_NOT_LESS]          = &&op_OP_JUMP_IF_NOT_LESS,
+        [OP_JUMP_IF_NOT_LESS_EQUAL]    = &&op_OP_JUMP_IF_NOT_LESS_EQUAL,
+        [OP_JUMP_IF_NOT_GREATER]       = &&op_OP_JUMP_IF_NOT_GREATER,
+        [OP_JUMP_IF_NOT_GREATER_EQUAL] = &&op_OP_JUMP_IF_NOT_GREATER_EQUAL,
+        [OP_INC_LOCAL]                 = &&op_OP_INC_LOCAL,
+        [OP_INC_GLOBAL]                = &&op_OP_INC_GLOBAL,
+        [OP_GET_GLOBAL]    = &&op_OP_GET_GLOBAL,
+        [OP_SET_GLOBAL]    = &&op_OP_SET_GLOBAL,
+        [OP_GET_LOCAL]     = &&op_OP_GET_LOCAL,
+        [OP_SET_LOCAL]     = &&op_OP_SET_LOCAL,
+        [OP_GET_GLOBAL_LONG] = &&op_OP_GET_GLOBAL_LONG,
+        [OP_SET_GLOBAL_LONG] = &&op_OP_SET_GLOBAL_LONG,
+        [OP_GET_LOCAL_LONG]  = &&op_OP_GET_LOCAL_LONG,
+        [OP_SET_LOCAL_LONG]  = &&op_OP_SET_LOCAL_LONG,
+        [OP_POP]           = &&op_OP_POP,
+        [OP_POPN]          = &&op_OP_POPN,
+        [OP_JUMP]          = &&op_OP_JUMP,
+        [OP_JUMP_IF_FALSE] = &&op_OP_JUMP_IF_FALSE,
+        [OP_LOOP]          = &&op_OP_LOOP,
+        [OP_CALL]          = &&op_OP_CALL,
+        [OP_CALL_DIRECT]   = &&op_OP_CALL_DIRECT,
+        [OP_CALL_DIRECT_0] = &&op_OP_CALL_DIRECT_0,
+        [OP_CALL_DIRECT_1] = &&op_OP_CALL_DIRECT_1,
+        [OP_CALL_DIRECT_2] = &&op_OP_CALL_DIRECT_2,
+        [OP_CALL_DIRECT_3] = &&op_OP_CALL_DIRECT_3,
+        [OP_TAIL_CALL]     = &&op_OP_TAIL_CALL,
+        [OP_TAIL_CALL_DIRECT] = &&op_OP_TAIL_CALL_DIRECT,
+        [OP_CLOSURE]       = &&op_OP_CLOSURE,
+        [OP_PRINT]         = &&op_OP_PRINT,
+        [OP_RETURN]        = &&op_OP_RETURN,
+        [OP_MEMO]          = &&op_OP_MEMO,
+        [OP_MEMO_RETURN]   = &&op_OP_MEMO_RETURN,
+    };
+
+    // Profiling and tracing (trace.h) swap in a table whose every entry is
+    // their hook, which then continues through dispatchTable: the normal
+    // path is untouched
+    #define OPCODE_COUNT (int)(sizeof(dispatchTable) / sizeof(dispatchTable[0]))
+    static void* profileTable[] = { [0 ... OPCODE_COUNT - 1] = &&op_profile };
+    static void* traceTable[] = { [0 ... OPCODE_COUNT - 1] = &&op_trace };
+    void** dispatch = tracer_traces_code(vm->tracer) ? traceTable
+                    : vm->profiler != NULL ? profileTable
+                    : dispatchTable;
+
+    // Trusted functions (verify.h) run the type-checked instructions that
+    // have no unchecked opcode through guard-free handlers instead: the
+    // verifier proved their operand types. The table is picked per frame.
+    void** checkedTable = dispatch;
+    void* trustedTable[OPCODE_COUNT];
+    bool trust = vm->unsafeFast && dispatch == dispatchTable; // The hooks would be skipped
+    if (trust) {
+        memcpy(trustedTable, dispatchTable, sizeof(trustedTable));
+        trustedTable[OP_NEGATE] = &&trusted_OP_NEGATE;
+        trustedTable[OP_NOT] = &&trusted_OP_NOT;
+        trustedTable[OP_ADD_CONST] = &&trusted_OP_ADD_CONST;
+        trustedTable[OP_SUBTRACT_CONST] = &&trusted_OP_SUBTRACT_CONST;
+        trustedTable[OP_ADD_LOCAL_CONST] = &&trusted_OP_ADD_LOCAL_CONST;
+        trustedTable[OP_JUMP_IF_NOT_LESS] = &&trusted_OP_JUMP_IF_NOT_LESS;
+        trustedTable[OP_JUMP_IF_NOT_LESS_EQUAL] = &&trusted_OP_JUMP_IF_NOT_LESS_EQUAL;
+        trustedTable[OP_JUMP_IF_NOT_GREATER] = &&trusted_OP_JUMP_IF_NOT_GREATER;
+        trustedTable[OP_JUMP_IF_NOT_GREATER_EQUAL] = &&trusted_OP_JUMP_IF_NOT_GREATER_EQUAL;
+        trustedTable[OP_INC_LOCAL] = &&trusted_OP_INC_LOCAL;
+        trustedTable[OP_INC_GLOBAL] = &&trusted_OP_INC_GLOBAL;
+    }
+    #define SELECT_DISPATCH() \
+        (dispatch = trust && frame->function->trusted ? trustedTable : checkedTable)
+
+    #define CASE(op) op_##op
+    #define DISPATCH() goto *dispatch[READ_BYTE()]
+    #define INTERPRET_LOOP DISPATCH();
+#else
+    #define SELECT_DISPATCH() do { } while (0)
+    #define CASE(op) case op
+    #define DISPATCH() goto loop
+    bool tracing = tracer_traces_code(vm->tracer);
+    #define INTERPRET_LOOP \
+        loop: \
+            if (tracing) { \
+                STORE_FRAME(); \
+                vm_trace_instruction(vm, ip); \
+            } \
+            if (vm->profiler != NULL) profiler_instruction(vm->profiler, vm, ip); \
+            switch (READ_BYTE())
+#endif
+
+    LOAD_FRAME();
+
+    INTERPRET_LOOP
+    {
+        /* --- Constants & literals --- */
+
+        CASE(OP_CONSTANT): {
+            PUSH(READ_CONSTANT());
+            DISPATCH();
+        }
+
+        CASE(OP_CONSTANT_LONG): {
+            uint16_t index = READ_SHORT();
+            PUSH(constants[index]);
+            DISPATCH();
+        }
+
+        // Conditional and equivalance logic;
+        CASE(OP_TRUE):  PUSH(BOOL_VAL(true)); DISPATCH();
+
+        CASE(OP_FALSE): PUSH(BOOL_VAL(false)); DISPATCH();
+
+        // No runtime representation for nil/closures yet; both are no-ops
+        CASE(OP_NIL):
+        CASE(OP_CLOSURE):
+            DISPATCH();
+
+
+        /* --- Globals --- */
+
+        // Global variable logic
+        CASE(OP_GET_GLOBAL): {
+            uint8_t index = READ_BYTE();
+            // Direct array access: O(1) speed
+            PUSH(globals[index]);
+            DISPATCH();
+        }
+
+        CASE(OP_SET_GLOBAL): {
+            uint8_t index = READ_BYTE();
+            // Assignment expressions evaluate to the assigned value.
+            // We PEEK the value so it stays on the stack for usage.
+            SET_GLOBAL(index, PEEK(0));
+            DISPATCH();
+        }
+
+
+        /* -- Locals --- */
+        CASE(OP_GET_LOCAL): {
+            uint8_t slot = READ_BYTE(); //Access the stack directly at the given index
+            PUSH(slots[slot]); // relative to frame addressing
+            DISPATCH();
+        }
+
+        CASE(OP_SET_LOCAL): {
+            uint8_t slot = READ_BYTE();
+            // Assignment = Expression hence we peek the stack
+            slots[slot] = PEEK(0);
+            DISPATCH();
+        }
+
+
+        /* --- Wide variable access (index > 255) --- */
+
+        CASE(OP_GET_GLOBAL_LONG): {
+            uint16_t index = READ_SHORT();
+            PUSH(globals[index]);
+            DISPATCH();
+        }
+
+        CASE(OP_SET_GLOBAL_LONG): {
+            uint16_t index = READ_SHORT();
+            SET_GLOBAL(index, PEEK(0));
+            DISPATCH();
+        }
+
+        CASE(OP_GET_LOCAL_LONG): {
+            uint16_t slot = READ_SHORT();
+            PUSH(slots[slot]);
+            DISPATCH();
+        }
+
+        CASE(OP_SET_LOCAL_LONG): {
+            uint16_t slot = READ_SHORT();
+            slots[slot] = PEEK(0);
+            DISPATCH();
+        }
+
+
+        /* --- Stack Cleanup --- */
+
+        CASE(OP_POP): {
+            sp--;
+            DISPATCH();
+        }
+
+        CASE(OP_POPN): {
+            sp -= READ_BYTE();
+            DISPATCH();
+        }
+
+
+        /* --- Control Flow --- */
+
+        CASE(OP_JUMP): {
+            uint16_t offset = READ_SHORT();
+            ip += offset;
+            DISPATCH();
+        }
+
+        CASE(OP_JUMP_IF_FALSE): {
+            uint16_t offset = READ_SHORT();
+            // False is falsey. Everything else is truthy.
+            // If false, jump. If true, fall through (and let next instruction execute).
+            if (IS_BOOL(PEEK(0)) && !AS_BOOL(PEEK(0))) {
+                ip += offset;
+            }
+            DISPATCH();
+        }
+
+        CASE(OP_LOOP): {
+            uint16_t offset = READ_SHORT();
+            ip -= offset;
+            count_hotness(vm, frame->function);
+            // On-stack replacement: a running frame whose function just got
+            // hot (a top-level loop, a single long call) continues its loop
+            // in machine code right away, and is re-entered here whenever
+            // the machine code stopped inside the loop body
+            ENTER_JIT();
+            DISPATCH();
+        }
+
+        /* --- Calls --- */
+
+        CASE(OP_CALL): {
+            uint8_t argCount = READ_BYTE();
+            // The function object is at stackTop - argCount - 1
+            // call() reads vm->stackTop and reports errors against our ip
+            STORE_FRAME();
+            if (!callValue(vm, PEEK(argCount), argCount)) {
+                return INTERPRET_RUNTIME_ERROR;
+            }
+            // callValue() has pushed a new CallFrame with ip set to function->chunk.code
+            // Reload the registers so READ_* macros use the new frame
+            // (the stacks may have moved while growing).
+            LOAD_FRAME();
+            sp = vm->stackTop;
+            ENTER_JIT();
+            DISPATCH();
+        }
+
+        CASE(OP_CALL_DIRECT): {
+            // Monomorphic inline cache: the compiler bound this call to the
+            // function declared in the callee's global slot, with a matching
+            // arity. While the slot still holds it, no callee type or arity
+            // check is needed.
+            ObjFunction* function = AS_FUNCTION(READ_CONSTANT());
+            uint8_t argCount = READ_BYTE();
+            CALL_DIRECT(function, argCount);
+        }
+
+        // The same with the argument count in the opcode: moving the
+        // arguments up over the callee slot unrolls
+        CASE(OP_CALL_DIRECT_0): {
+            ObjFunction* function = AS_FUNCTION(READ_CONSTANT());
+            CALL_DIRECT(function, 0);
+        }
+
+        CASE(OP_CALL_DIRECT_1): {
+            ObjFunction* function = AS_FUNCTION(READ_CONSTANT());
+            CALL_DIRECT(function, 1);
+        }
+
+        CASE(OP_CALL_DIRECT_2): {
+            ObjFunction* function = AS_FUNCTION(READ_CONSTANT());
+            CALL_DIRECT(function, 2);
+        }
+
+        CASE(OP_CALL_DIRECT_3): {
+            ObjFunction* function = AS_FUNCTION(READ_CONSTANT());
+            CALL_DIRECT(function, 3);
+        }
+
+        CASE(OP_TAIL_CALL): {
+            // return f(...): a function replaces the current frame, anything
+            // else (or a wrong arity) goes through callValue() and its errors
+            uint8_t argCount = READ_BYTE();
+            Value callee = PEEK(argCount);
+            STORE_FRAME();
+
+            if (IS_FUNCTION(callee) && AS_FUNCTION(callee)->arity == argCount) {
+                if (!tail_call(vm, AS_FUNCTION(callee), argCount)) {
+                    runtimeError(vm, "Stack overflow.");
+                    return INTERPRET_RUNTIME_ERROR;
+                }
+            } else {
+                int frames = vm->frameCount;
+                if (!callValue(vm, callee, argCount)) {
+                    return INTERPRET_RUNTIME_ERROR;
                 }
-                printf("\n");
+                if (vm->frameCount == frames) RETURN_NATIVE_RESULT();
+            }
 
-                printf("IP %04ld: Opcode %d\n", 
-                        (long)(FRAME().ip - FRAME().function->chunk.code), 
-                        *FRAME().*ip);
-        #endif
+            LOAD_FRAME();
+            sp = vm->stackTop;
+            ENTER_JIT();
+            DISPATCH();
+        }
 
-        uint8_t instruction = READ_BYTE();
+        CASE(OP_TAIL_CALL_DIRECT): {
+            // OP_CALL_DIRECT's guard, then OP_TAIL_CALL's frame reuse
+            ObjFunction* function = AS_FUNCTION(READ_CONSTANT());
+            uint8_t argCount = READ_BYTE();
+            Value callee = globals[function->global];
 
-        switch (instruction) {
-            /* --- Constants & literals --- */
+            OPEN_CALLEE_SLOT(callee, argCount);
+            STORE_FRAME();
 
-            case OP_CONSTANT: {
-                push(READ_CONSTANT());
-                break;
+            if (IS_OBJ(callee) && AS_OBJ(callee) == (Obj*)function) {
+                if (!tail_call(vm, function, argCount)) {
+                    runtimeError(vm, "Stack overflow.");
+                    return INTERPRET_RUNTIME_ERROR;
+                }
+            } else {
+                int frames = vm->frameCount;
+                if (!callValue(vm, callee, argCount)) {
+                    return INTERPRET_RUNTIME_ERROR;
+                }
+                if (vm->frameCount == frames) RETURN_NATIVE_RESULT();
             }
 
-            // Conditional and equivalance logic;
-            case OP_TRUE:  push(BOOL_VAL(true)); break;
+            LOAD_FRAME();
+            sp = vm->stackTop;
+            ENTER_JIT();
+            DISPATCH();
+        }
 
-            case OP_FALSE: push(BOOL_VAL(false)); break;
+        /* --- Comparisons & Logic --- */
+        CASE(OP_EQUAL): {
+            Value b = POP();
+            Value a = POP();
+            PUSH(BOOL_VAL(values_equal(a, b)));
+            DISPATCH();
+        }
+
+        CASE(OP_GREATER): {
+            if (!IS_INT(PEEK(0)) || !IS_INT(PEEK(1))) { 
+                RUNTIME_ERROR("Operands must be numbers."); 
+            }
+            int b = AS_INT(POP());
+            int a = AS_INT(POP());
+            PUSH(BOOL_VAL(a > b));
+            DISPATCH();
+        }
+
+        CASE(OP_LESS): {
+            if (!IS_INT(PEEK(0)) || !IS_INT(PEEK(1))) { 
+                RUNTIME_ERROR("Operands must be numbers."); 
+            }
+            int b = AS_INT(POP());
+            int a = AS_INT(POP());
+            PUSH(BOOL_VAL(a < b));
+            DISPATCH();
+        }
 
+        CASE(OP_NOT): {
+            Value v = POP();
+            if (!IS_BOOL(v)) {
+                RUNTIME_ERROR("Operand must be boolean.");
+            }
+            PUSH(BOOL_VAL(!AS_BOOL(v)));
+            DISPATCH();
+        }
 
-            /* --- Globals --- */
+        /* --- Arithmetic --- */
+
+        CASE(OP_ADD): {
+            // Use PEEK macro instead of peek() function
+            if (IS_STRING(PEEK(0)) && IS_STRING(PEEK(1))) {
+                // String Concatenation
+                // GC safepoint: concatenate() allocates, so the operands must
+                // stay on the stack (and vm->stackTop be current) until it
+                // returns, or a collection could free them mid-copy.
+                ObjString* b = AS_STRING(PEEK(0));
+                ObjString* a = AS_STRING(PEEK(1));
+                STORE_FRAME();
+
+                // Concatenate the strings
+                ObjString* result = concatenate(a, b);
+
+                sp -= 2;
+                PUSH(OBJ_VAL(result));
+                NURSERY_SAFEPOINT();
+                DISPATCH(); // important not to fall through to int step afterwards
+            }
 
-            // Global variable logic
-            case OP_GET_GLOBAL: {
-                uint8_t index = READ_BYTE();
-                // Direct array access: O(1) speed
-                push(vm.globals[index]);
-                break;
+            // Integer Addition
+            else if (IS_INT(PEEK(0)) && IS_INT(PEEK(1))) {
+                BINARY_OP(+);
+                DISPATCH();
             }
 
-            case OP_SET_GLOBAL: {
-                uint8_t index = READ_BYTE();
-                // Assignment expressions evaluate to the assigned value.
-                // We PEEK the value so it stays on the stack for usage.
-                vm.globals[index] = PEEK(0);
-                break;
+            else {
+                RUNTIME_ERROR("Operands must be two numbers or two strings.");
             }
+        }
 
+        CASE(OP_SUBTRACT): BINARY_OP(-); DISPATCH();
+        CASE(OP_MULTIPLY): BINARY_OP(*); DISPATCH();
+        
+        CASE(OP_DIVIDE): {
+            if (!IS_INT(PEEK(0)) || !IS_INT(PEEK(1))) {
+                RUNTIME_ERROR("Operands must be numbers.");
+            }
+            int divisor = AS_INT(PEEK(0)); // Peek
+            if (divisor == 0) {
+                RUNTIME_ERROR("Division by zero.");
+            }
+            // Now safe to pop and divide
+            int b = AS_INT(POP());
+            int a = AS_INT(POP());
+            PUSH(INT_VAL(a / b));
+            DISPATCH();
+        }
 
-            /* -- Locals --- */
-            case OP_GET_LOCAL: {
-                uint8_t slot = READ_BYTE(); //Access the stack directly at the given index
-                push(FRAME().slots[slot]); // relative to frame addressing
-                break;
+        CASE(OP_MODULO): {
+            if (!IS_INT(PEEK(0)) || !IS_INT(PEEK(1))) {
+                RUNTIME_ERROR("Operands must be numbers.");
+            }
+            int divisor = AS_INT(PEEK(0)); 
+            if (divisor == 0) {
+                RUNTIME_ERROR("Modulo by zero.");
             }
+            int b = AS_INT(POP());
+            int a = AS_INT(POP());
+            PUSH(INT_VAL(a % b));
+            DISPATCH();
+        }
 
-            case OP_SET_LOCAL: {
-                uint8_t slot = READ_BYTE();
-                // Assignment = Expression hence we peek the stack
-                FRAME().slots[slot] = PEEK(0);
-                break;
+        CASE(OP_NEGATE): {
+            if (!IS_INT(PEEK(0))) {
+                RUNTIME_ERROR("Operand must be a number.");
             }
+            // Unwrap, Negate, Wrap back
+            int value = AS_INT(POP());
+            PUSH(INT_VAL(-value));
+            DISPATCH();
+        }
 
+        /* --- Type-Specialized (no tag checks) --- */
 
-            /* --- Stack Cleanup --- */
+        CASE(OP_ADD_INT):      INT_BINARY_OP(INT_VAL, +); DISPATCH();
+        CASE(OP_SUBTRACT_INT): INT_BINARY_OP(INT_VAL, -); DISPATCH();
+        CASE(OP_MULTIPLY_INT): INT_BINARY_OP(INT_VAL, *); DISPATCH();
 
-            case OP_POP: {
-                pop();
-                break;
+        CASE(OP_DIVIDE_INT): {
+            if (AS_INT(PEEK(0)) == 0) {
+                RUNTIME_ERROR("Division by zero.");
             }
+            INT_BINARY_OP(INT_VAL, /);
+            DISPATCH();
+        }
+
+        CASE(OP_MODULO_INT): {
+            if (AS_INT(PEEK(0)) == 0) {
+                RUNTIME_ERROR("Modulo by zero.");
+            }
+            INT_BINARY_OP(INT_VAL, %);
+            DISPATCH();
+        }
+
+        CASE(OP_CONCAT): {
+            // Same GC safepoint rules as the OP_ADD string path
+            ObjString* b = AS_STRING(PEEK(0));
+            ObjString* a = AS_STRING(PEEK(1));
+            STORE_FRAME();
 
+            ObjString* result = concatenate(a, b);
 
-            /* --- Control Flow --- */
+            sp -= 2;
+            PUSH(OBJ_VAL(result));
+            NURSERY_SAFEPOINT();
+            DISPATCH();
+        }
+
+        CASE(OP_EQUAL_INT):   INT_BINARY_OP(BOOL_VAL, ==); DISPATCH();
+        CASE(OP_GREATER_INT): INT_BINARY_OP(BOOL_VAL, >); DISPATCH();
+        CASE(OP_LESS_INT):    INT_BINARY_OP(BOOL_VAL, <); DISPATCH();
+
+        /* --- Superinstructions (see peephole.c) --- */
+
+        CASE(OP_NOT_EQUAL): {
+            Value b = POP();
+            Value a = POP();
+            PUSH(BOOL_VAL(!values_equal(a, b)));
+            DISPATCH();
+        }
 
-            case OP_JUMP: {
-                uint16_t offset = READ_SHORT();
-                FRAME().ip += offset;
-                break;
+        CASE(OP_GREATER_EQUAL): {
+            if (!IS_INT(PEEK(0)) || !IS_INT(PEEK(1))) {
+                RUNTIME_ERROR("Operands must be numbers.");
             }
+            INT_BINARY_OP(BOOL_VAL, >=);
+            DISPATCH();
+        }
 
-            case OP_JUMP_IF_FALSE: {
-                uint16_t offset = READ_SHORT();
-                // False is falsey. Everything else is truthy.
-                // If false, jump. If true, fall through (and let next instruction execute).
-                if (IS_BOOL(PEEK(0)) && !AS_BOOL(PEEK(0))) {
-                    FRAME().ip += offset;
-                }
-                break;
+        CASE(OP_LESS_EQUAL): {
+            if (!IS_INT(PEEK(0)) || !IS_INT(PEEK(1))) {
+                RUNTIME_ERROR("Operands must be numbers.");
             }
+            INT_BINARY_OP(BOOL_VAL, <=);
+            DISPATCH();
+        }
 
-            case OP_LOOP: {
-                uint16_t offset = READ_SHORT();
-                FRAME().ip -= offset;
-                break;
+        CASE(OP_NOT_EQUAL_INT):     INT_BINARY_OP(BOOL_VAL, !=); DISPATCH();
+        CASE(OP_GREATER_EQUAL_INT): INT_BINARY_OP(BOOL_VAL, >=); DISPATCH();
+        CASE(OP_LESS_EQUAL_INT):    INT_BINARY_OP(BOOL_VAL, <=); DISPATCH();
+
+        CASE(OP_ADD_CONST): {
+            // The peephole pass only fuses int constants
+            Value k = READ_CONSTANT();
+            if (!IS_INT(PEEK(0))) {
+                RUNTIME_ERROR("Operands must be two numbers or two strings.");
             }
+            sp[-1] = INT_VAL(AS_INT(PEEK(0)) + AS_INT(k));
+            DISPATCH();
+        }
 
-            /* --- Calls --- */
+        CASE(OP_SUBTRACT_CONST): {
+            Value k = READ_CONSTANT();
+            if (!IS_INT(PEEK(0))) {
+                RUNTIME_ERROR("Operands must be numbers.");
+            }
+            sp[-1] = INT_VAL(AS_INT(PEEK(0)) - AS_INT(k));
+            DISPATCH();
+        }
 
-            case OP_CALL: {
-                uint8_t argCount = READ_BYTE();
-                // The function object is at stackTop - argCount - 1
-                if (!callValue(PEEK(argCount), argCount)) {
-                    return INTERPRET_RUNTIME_ERROR;
-                }
-                // callValue() has pushed a new CallFrame with ip set to function->chunk.code
-                // FRAME() now refers to the new frame; READ_* macros will use it automatically.
-                break;
+        CASE(OP_ADD_LOCALS): {
+            Value a = slots[READ_BYTE()];
+            Value b = slots[READ_BYTE()];
+
+            if (IS_INT(a) && IS_INT(b)) {
+                PUSH(INT_VAL(AS_INT(a) + AS_INT(b)));
+            } else if (IS_STRING(a) && IS_STRING(b)) {
+                // Operands stay rooted in their local slots across the allocation
+                STORE_FRAME();
+                PUSH(OBJ_VAL(concatenate(AS_STRING(a), AS_STRING(b))));
+                NURSERY_SAFEPOINT();
+            } else {
+                RUNTIME_ERROR("Operands must be two numbers or two strings.");
+            }
+            DISPATCH();
+        }
+
+        CASE(OP_ADD_LOCAL_CONST): {
+            Value a = slots[READ_BYTE()];
+            Value k = READ_CONSTANT();
+            if (!IS_INT(a)) {
+                RUNTIME_ERROR("Operands must be two numbers or two strings.");
             }
+            PUSH(INT_VAL(AS_INT(a) + AS_INT(k)));
+            DISPATCH();
+        }
 
-            /* --- Comparisons & Logic --- */
-            case OP_EQUAL: {
-                Value b = pop();
-                Value a = pop();
-                push(BOOL_VAL(values_equal(a, b)));
-                break;
+        CASE(OP_JUMP_IF_FALSE_POP): {
+            uint16_t offset = READ_SHORT();
+            // Same truthiness as OP_JUMP_IF_FALSE, but the condition is always popped
+            Value condition = POP();
+            if (IS_BOOL(condition) && !AS_BOOL(condition)) {
+                ip += offset;
             }
+            DISPATCH();
+        }
 
-            case OP_GREATER: {
-                if (!IS_INT(PEEK(0)) || !IS_INT(PEEK(1))) { 
-                    runtimeError("Operands must be numbers."); 
-                    return INTERPRET_RUNTIME_ERROR; 
-                }
-                int b = AS_INT(pop());
-                int a = AS_INT(pop());
-                push(BOOL_VAL(a > b));
-                break;
+        CASE(OP_JUMP_IF_NOT_LESS):          COMPARE_BRANCH(<); DISPATCH();
+        CASE(OP_JUMP_IF_NOT_LESS_EQUAL):    COMPARE_BRANCH(<=); DISPATCH();
+        CASE(OP_JUMP_IF_NOT_GREATER):       COMPARE_BRANCH(>); DISPATCH();
+        CASE(OP_JUMP_IF_NOT_GREATER_EQUAL): COMPARE_BRANCH(>=); DISPATCH();
+
+        CASE(OP_INC_LOCAL): {
+            // x = x + k; in place: nothing goes through the stack
+            Value* local = &slots[READ_BYTE()];
+            Value k = READ_CONSTANT();
+            if (!IS_INT(*local)) {
+                RUNTIME_ERROR("Operands must be two numbers or two strings.");
             }
+            *local = INT_VAL(AS_INT(*local) + AS_INT(k));
+            DISPATCH();
+        }
 
-            case OP_LESS: {
-                if (!IS_INT(PEEK(0)) || !IS_INT(PEEK(1))) { 
-                    runtimeError("Operands must be numbers."); 
-                    return INTERPRET_RUNTIME_ERROR; 
-                }
-                int b = AS_INT(pop());
-                int a = AS_INT(pop());
-                push(BOOL_VAL(a < b));
-                break;
+        CASE(OP_INC_GLOBAL): {
+            // An int replaces an int: no write barrier
+            Value* global = &globals[READ_BYTE()];
+            Value k = READ_CONSTANT();
+            if (!IS_INT(*global)) {
+                RUNTIME_ERROR("Operands must be two numbers or two strings.");
             }
+            *global = INT_VAL(AS_INT(*global) + AS_INT(k));
+            DISPATCH();
+        }
 
-            case OP_NOT: {
-                Value v = pop();
-                if (!IS_BOOL(v)) {
-                    runtimeError("Operand must be boolean.");
-                    return INTERPRET_RUNTIME_ERROR;
-                }
-                push(BOOL_VAL(!AS_BOOL(v)));
-                break;
+        CASE(OP_PRINT): {
+            output_line(&vm->output, POP());
+            DISPATCH();
+        }
+
+        CASE(OP_MEMO): {
+            // Entry of a memoized function (memo.h): a cached result
+            // returns at once, as OP_RETURN would
+            Value result;
+            if (frame->function->memo != NULL && memo_lookup(vm, frame->function, slots + 1, &result)) {
+                vm->frameCount--;
+                sp = frame->slots;
+                PUSH(result);
+                LOAD_FRAME();
+                ENTER_JIT();
+            }
+            DISPATCH();
+        }
+
+        CASE(OP_MEMO_RETURN): {
+            // The parameters still hold the arguments (memo.h)
+            if (frame->function->memo != NULL) {
+                STORE_FRAME(); // Growing the table may collect
+                memo_store(vm, frame->function, slots + 1, PEEK(0));
             }
+            goto op_return;
+        }
 
-            /* --- Arithmetic --- */
+        op_return:
+        CASE(OP_RETURN): {
+            // 1. Pop the function's return value (top of stack inside the function).
+            //    A script that leaves nothing behind returns false (there is
+            //    no nil value), instead of reading below the stack.
+            Value result = sp > vm->stack ? POP() : BOOL_VAL(false);
+
+            // 2. Pop this call frame (frame still points at it)
+            vm->frameCount--;
+
+            // 3. If we just returned from the top-level script, we're done
+            if (vm->frameCount == 0) {
+                // push the result back for inspection
+                PUSH(result);
+                vm->stackTop = sp;
+                return INTERPRET_OK;
+            }
 
-            case OP_ADD: {
-                // Use PEEK macro instead of peek() function
-                if (IS_STRING(PEEK(0)) && IS_STRING(PEEK(1))) {
-                    // String Concatenation
-                    ObjString* b = AS_STRING(pop());
-                    ObjString* a = AS_STRING(pop());
+            // 4. Discard callee + args + locals:
+            //    shrink stack back to the callee slot of this frame
+            sp = frame->slots;
 
-                    // Concatenate the strings
-                    ObjString* result = concatenate(a, b);
-                    
-                    push(OBJ_VAL(result));
-                    break; // important not to fall through to int step afterwards
-                }
+            // 5. Push the return value in their place (overwriting callee slot)
+            PUSH(result);
 
-                // Integer Addition
-                else if (IS_INT(PEEK(0)) && IS_INT(PEEK(1))) {
-                    BINARY_OP(+);
-                    break;
-                }
+            // 6. Continue running caller frame
+            LOAD_FRAME();
+            ENTER_JIT();
+            DISPATCH();
+        }
+    }
 
-                else {
-                    runtimeError("Operands must be two numbers or two strings.");
-                    return INTERPRET_RUNTIME_ERROR;
-                }
-                break;
+    // Unknown opcodes are skipped, same as the original switch
+    DISPATCH();
+
+#ifdef VM_COMPUTED_GOTO
+op_profile:
+    profiler_instruction(vm->profiler, vm, ip - 1);
+    goto *dispatchTable[ip[-1]];
+
+op_trace:
+    // The hooks see the instruction's frame and stack as they are now
+    frame->ip = ip - 1;
+    vm->stackTop = sp;
+    vm_trace_instruction(vm, ip - 1);
+    if (vm->profiler != NULL) profiler_instruction(vm->profiler, vm, ip - 1);
+    goto *dispatchTable[ip[-1]];
+    #undef OPCODE_COUNT
+
+    /* --- Trusted forms: operand types proven by the verifier --- */
+
+trusted_OP_NEGATE:
+    sp[-1] = INT_VAL(-AS_INT(PEEK(0)));
+    DISPATCH();
+
+trusted_OP_NOT:
+    sp[-1] = BOOL_VAL(!AS_BOOL(PEEK(0)));
+    DISPATCH();
+
+trusted_OP_ADD_CONST: {
+    Value k = READ_CONSTANT();
+    sp[-1] = INT_VAL(AS_INT(PEEK(0)) + AS_INT(k));
+    DISPATCH();
+}
+
+trusted_OP_SUBTRACT_CONST: {
+    Value k = READ_CONSTANT();
+    sp[-1] = INT_VAL(AS_INT(PEEK(0)) - AS_INT(k));
+    DISPATCH();
+}
+
+trusted_OP_ADD_LOCAL_CONST: {
+    Value a = slots[READ_BYTE()];
+    Value k = READ_CONSTANT();
+    PUSH(INT_VAL(AS_INT(a) + AS_INT(k)));
+    DISPATCH();
+}
+
+trusted_OP_JUMP_IF_NOT_LESS:          INT_COMPARE_BRANCH(<); DISPATCH();
+trusted_OP_JUMP_IF_NOT_LESS_EQUAL:    INT_COMPARE_BRANCH(<=); DISPATCH();
+trusted_OP_JUMP_IF_NOT_GREATER:       INT_COMPARE_BRANCH(>); DISPATCH();
+trusted_OP_JUMP_IF_NOT_GREATER_EQUAL: INT_COMPARE_BRANCH(>=); DISPATCH();
+
+trusted_OP_INC_LOCAL: {
+    Value* local = &slots[READ_BYTE()];
+    Value k = READ_CONSTANT();
+    *local = INT_VAL(AS_INT(*local) + AS_INT(k));
+    DISPATCH();
+}
+
+trusted_OP_INC_GLOBAL: {
+    Value* global = &globals[READ_BYTE()];
+    Value k = READ_CONSTANT();
+    *global = INT_VAL(AS_INT(*global) + AS_INT(k));
+    DISPATCH();
+}
+#endif
+
+    #undef READ_BYTE
+    #undef READ_SHORT
+    #undef READ_CONSTANT
+    #undef BINARY_OP
+    #undef INT_BINARY_OP
+    #undef COMPARE_BRANCH
+    #undef INT_COMPARE_BRANCH
+    #undef PUSH
+    #undef POP
+    #undef PEEK
+    #undef STORE_FRAME
+    #undef LOAD_FRAME
+    #undef SELECT_DISPATCH
+    #undef RUNTIME_ERROR
+    #undef OPEN_CALLEE_SLOT
+    #undef RETURN_NATIVE_RESULT
+    #undef SET_GLOBAL
+    #undef NURSERY_SAFEPOINT
+    #undef ENTER_JIT
+    #undef CASE
+    #undef DISPATCH
+    #undef INTERPRET_LOOP
+}
+
+/**
+ * @brief Call `callee` from a register frame: the callee is in stack slot
+ * `base` and its arguments above it. A function gets a new frame over
+ * them; a native runs in place and its result replaces the callee.
+ *
+ * The caller's frame->ip must be stored (errors are reported against it).
+ */
+static bool call_register(VM* vm, Value callee, ptrdiff_t base, int argCount) {
+    if (IS_FUNCTION(callee)) {
+        ObjFunction* function = AS_FUNCTION(callee);
+        if (argCount != function->arity) {
+            runtimeError(vm, "Expected %d arguments but got %d.", function->arity, argCount);
+            return false;
+        }
+        if (push_register_frame(vm, function, base) == NULL) {
+            runtimeError(vm, "Stack overflow.");
+            return false;
+        }
+        return true;
+    }
+
+    if (IS_OBJ(callee) && OBJ_TYPE(callee) == OBJ_NATIVE) {
+        ObjNative* native = AS_NATIVE(callee);
+        if (argCount != native->arity) {
+            runtimeError(vm, "Expected %d arguments but got %d.", native->arity, argCount);
+            return false;
+        }
+        Value result = BOOL_VAL(false);
+        if (!native->function(vm, argCount, vm->stack + base + 1, &result)) {
+            return false; // The native reported the error (and the stack was reset)
+        }
+        vm->stack[base] = result;
+        return true;
+    }
+
+    runtimeError(vm, "Can only call functions and classes.");
+    return false;
+}
+
+/**
+ * @brief Execute register code (see regcode.h) until the script returns.
+ *
+ * The counterpart of run() for translated functions, with the same
+ * semantics and runtime errors. The operands name the active frame's slots
+ * directly, so there is no operand stack pointer to cache: only the frame,
+ * ip, the slots (`regs`) and the constant pool.
+ *
+ * vm->stackTop stays at the high-water mark of the frames' register
+ * windows (see reserve_registers()), so every register is a GC root and
+ * nothing has to be flushed before an allocation. A dead register keeps
+ * its last value alive until it is overwritten or the run ends.
+ */
+static InterpretResult run_reg(VM* vm) {
+    CallFrame* frame;
+    uint8_t* ip;
+    Value* regs;
+    Value* constants;
+    Value* globals = vm->globals;
+
+    // Only ip is cached outside the frame (stack traces read frame->ip)
+    #define STORE_FRAME() (frame->ip = ip)
+
+    #define LOAD_FRAME() \
+        do { \
+            frame = &vm->frames[vm->frameCount - 1]; \
+            ip = frame->ip; \
+            regs = frame->slots; \
+            constants = frame->function->chunk.constants.values; \
+        } while (0)
+
+    #define READ_BYTE() (*ip++)
+    #define READ_SHORT() \
+        (ip += 2, (uint16_t)((ip[-2] << 8) | ip[-1]))
+
+    // Same write barriers as run()'s SET_GLOBAL
+    #define SET_GLOBAL(index, value) \
+        do { \
+            Value stored = (value); \
+            globals[index] = stored; \
+            if (IS_OBJ(stored)) { \
+                if (AS_OBJ(stored)->isYoung) vm_remember_global(vm, index); \
+                else if (vm->gcPhase == GC_MARK) vm_write_barrier(vm, stored); \
+            } \
+        } while (0)
+
+    // Every live value is in a register below vm->stackTop or in a global
+    #define NURSERY_SAFEPOINT() \
+        do { \
+            if (vm->nursery.full) vm_collect_nursery(vm); \
+        } while (0)
+
+    #define RUNTIME_ERROR(...) \
+        do { \
+            STORE_FRAME(); \
+            runtimeError(vm, __VA_ARGS__); \
+            return INTERPRET_RUNTIME_ERROR; \
+        } while (0)
+
+    // A = B op C on ints, with the stack VM's operand check
+    #define INT_OP(valueType, op) \
+        do { \
+            uint8_t dst = READ_BYTE(); \
+            Value a = regs[READ_BYTE()]; \
+            Value b = regs[READ_BYTE()]; \
+            if (!IS_INT(a) || !IS_INT(b)) RUNTIME_ERROR("Operands must be numbers."); \
+            regs[dst] = valueType(AS_INT(a) op AS_INT(b)); \
+        } while (0)
+
+    // A = B / C or B % C: the zero check comes after the type check
+    #define DIVIDE_OP(op, message) \
+        do { \
+            uint8_t dst = READ_BYTE(); \
+            Value a = regs[READ_BYTE()]; \
+            Value b = regs[READ_BYTE()]; \
+            if (!IS_INT(a) || !IS_INT(b)) RUNTIME_ERROR("Operands must be numbers."); \
+            if (AS_INT(b) == 0) RUNTIME_ERROR(message); \
+            regs[dst] = INT_VAL(AS_INT(a) op AS_INT(b)); \
+        } while (0)
+
+    // Unchecked A = B op C for operands the typechecker proved to be ints
+    #define UNCHECKED_INT_OP(op) \
+        do { \
+            uint8_t dst = READ_BYTE(); \
+            int a = AS_INT(regs[READ_BYTE()]); \
+            int b = AS_INT(regs[READ_BYTE()]); \
+            regs[dst] = INT_VAL(a op b); \
+        } while (0)
+
+    #define UNCHECKED_DIVIDE_OP(op, message) \
+        do { \
+            uint8_t dst = READ_BYTE(); \
+            int a = AS_INT(regs[READ_BYTE()]); \
+            int b = AS_INT(regs[READ_BYTE()]); \
+            if (b == 0) RUNTIME_ERROR(message); \
+            regs[dst] = INT_VAL(a op b); \
+        } while (0)
+
+    // Jump unless B op C (C a register, or an int constant for the K forms)
+    #define BRANCH_UNLESS(op, right) \
+        do { \
+            Value a = regs[READ_BYTE()]; \
+            Value b = right; \
+            uint16_t offset = READ_SHORT(); \
+            if (!IS_INT(a) || !IS_INT(b)) RUNTIME_ERROR("Operands must be numbers."); \
+            if (!(AS_INT(a) op AS_INT(b))) ip += offset; \
+        } while (0)
+
+    LOAD_FRAME();
+
+#ifdef VM_COMPUTED_GOTO
+    static void* dispatchTable[] = {
+        [REG_MOVE]          = &&op_REG_MOVE,
+        [REG_LOADK]         = &&op_REG_LOADK,
+        [REG_LOADK_LONG]    = &&op_REG_LOADK_LONG,
+        [REG_TRUE]          = &&op_REG_TRUE,
+        [REG_FALSE]         = &&op_REG_FALSE,
+        [REG_GET_GLOBAL]    = &&op_REG_GET_GLOBAL,
+        [REG_SET_GLOBAL]    = &&op_REG_SET_GLOBAL,
+        [REG_ADD]           = &&op_REG_ADD,
+        [REG_SUBTRACT]      = &&op_REG_SUBTRACT,
+        [REG_MULTIPLY]      = &&op_REG_MULTIPLY,
+        [REG_DIVIDE]        = &&op_REG_DIVIDE,
+        [REG_MODULO]        = &&op_REG_MODULO,
+        [REG_CONCAT]        = &&op_REG_CONCAT,
+        [REG_ADD_INT]       = &&op_REG_ADD_INT,
+        [REG_SUBTRACT_INT]  = &&op_REG_SUBTRACT_INT,
+        [REG_MULTIPLY_INT]  = &&op_REG_MULTIPLY_INT,
+        [REG_DIVIDE_INT]    = &&op_REG_DIVIDE_INT,
+        [REG_MODULO_INT]    = &&op_REG_MODULO_INT,
+        [REG_ADDK]          = &&op_REG_ADDK,
+        [REG_SUBTRACTK]     = &&op_REG_SUBTRACTK,
+        [REG_NEGATE]        = &&op_REG_NEGATE,
+        [REG_NOT]           = &&op_REG_NOT,
+        [REG_EQUAL]         = &&op_REG_EQUAL,
+        [REG_NOT_EQUAL]     = &&op_REG_NOT_EQUAL,
+        [REG_LESS]          = &&op_REG_LESS,
+        [REG_LESS_EQUAL]    = &&op_REG_LESS_EQUAL,
+        [REG_GREATER]       = &&op_REG_GREATER,
+        [REG_GREATER_EQUAL] = &&op_REG_GREATER_EQUAL,
+        [REG_JUMP]          = &&op_REG_JUMP,
+        [REG_LOOP]          = &&op_REG_LOOP,
+        [REG_JUMP_IF_FALSE] = &&op_REG_JUMP_IF_FALSE,
+        [REG_JUMP_IF_NOT_EQUAL]          = &&op_REG_JUMP_IF_NOT_EQUAL,
+        [REG_JUMP_IF_NOT_NOT_EQUAL]      = &&op_REG_JUMP_IF_NOT_NOT_EQUAL,
+        [REG_JUMP_IF_NOT_LESS]           = &&op_REG_JUMP_IF_NOT_LESS,
+        [REG_JUMP_IF_NOT_LESS_EQUAL]     = &&op_REG_JUMP_IF_NOT_LESS_EQUAL,
+        [REG_JUMP_IF_NOT_GREATER]        = &&op_REG_JUMP_IF_NOT_GREATER,
+        [REG_JUMP_IF_NOT_GREATER_EQUAL]  = &&op_REG_JUMP_IF_NOT_GREATER_EQUAL,
+        [REG_JUMP_IF_NOT_LESSK]          = &&op_REG_JUMP_IF_NOT_LESSK,
+        [REG_JUMP_IF_NOT_LESS_EQUALK]    = &&op_REG_JUMP_IF_NOT_LESS_EQUALK,
+        [REG_JUMP_IF_NOT_GREATERK]       = &&op_REG_JUMP_IF_NOT_GREATERK,
+        [REG_JUMP_IF_NOT_GREATER_EQUALK] = &&op_REG_JUMP_IF_NOT_GREATER_EQUALK,
+        [REG_CALL]             = &&op_REG_CALL,
+        [REG_CALL_DIRECT]      = &&op_REG_CALL_DIRECT,
+        [REG_TAIL_CALL]        = &&op_REG_TAIL_CALL,
+        [REG_TAIL_CALL_DIRECT] = &&op_REG_TAIL_CALL_DIRECT,
+        [REG_PRINT]            = &&op_REG_PRINT,
+        [REG_RETURN]           = &&op_REG_RETURN,
+    };
+
+    #define CASE(op) op_##op
+    #define DISPATCH() goto *dispatchTable[READ_BYTE()]
+    #define INTERPRET_LOOP DISPATCH();
+#else
+    #define CASE(op) case op
+    #define DISPATCH() goto loop
+    #define INTERPRET_LOOP \
+        loop: \
+            switch (READ_BYTE())
+#endif
+
+    INTERPRET_LOOP
+    {
+        /* --- Moves & loads --- */
+
+        CASE(REG_MOVE): {
+            uint8_t dst = READ_BYTE();
+            regs[dst] = regs[READ_BYTE()];
+            DISPATCH();
+        }
+
+        CASE(REG_LOADK): {
+            uint8_t dst = READ_BYTE();
+            regs[dst] = constants[READ_BYTE()];
+            DISPATCH();
+        }
+
+        CASE(REG_LOADK_LONG): {
+            uint8_t dst = READ_BYTE();
+            regs[dst] = constants[READ_SHORT()];
+            DISPATCH();
+        }
+
+        CASE(REG_TRUE):  regs[READ_BYTE()] = BOOL_VAL(true); DISPATCH();
+        CASE(REG_FALSE): regs[READ_BYTE()] = BOOL_VAL(false); DISPATCH();
+
+        CASE(REG_GET_GLOBAL): {
+            uint8_t dst = READ_BYTE();
+            regs[dst] = globals[READ_SHORT()];
+            DISPATCH();
+        }
+
+        CASE(REG_SET_GLOBAL): {
+            uint16_t index = READ_SHORT();
+            SET_GLOBAL(index, regs[READ_BYTE()]);
+            DISPATCH();
+        }
+
+
+        /* --- Arithmetic --- */
+
+        CASE(REG_ADD): {
+            uint8_t dst = READ_BYTE();
+            Value a = regs[READ_BYTE()];
+            Value b = regs[READ_BYTE()];
+            if (IS_INT(a) && IS_INT(b)) {
+                regs[dst] = INT_VAL(AS_INT(a) + AS_INT(b));
+            } else if (IS_STRING(a) && IS_STRING(b)) {
+                // The operands stay rooted in their registers
+                regs[dst] = OBJ_VAL(concatenate(AS_STRING(a), AS_STRING(b)));
+                NURSERY_SAFEPOINT();
+            } else {
+                RUNTIME_ERROR("Operands must be two numbers or two strings.");
             }
+            DISPATCH();
+        }
 
-            case OP_SUBTRACT: BINARY_OP(-); break;
-            case OP_MULTIPLY: BINARY_OP(*); break;
-            
-            case OP_DIVIDE: {
-                if (!IS_INT(PEEK(0)) || !IS_INT(PEEK(1))) {
-                    runtimeError("Operands must be numbers.");
-                    return INTERPRET_RUNTIME_ERROR;
-                }
-                int divisor = AS_INT(PEEK(0)); // Peek
-                if (divisor == 0) {
-                    runtimeError("Division by zero.");
-                    return INTERPRET_RUNTIME_ERROR;
-                }
-                // Now safe to pop and divide
-                int b = AS_INT(pop());
-                int a = AS_INT(pop());
-                push(INT_VAL(a / b));
-                break;
+        CASE(REG_SUBTRACT): INT_OP(INT_VAL, -); DISPATCH();
+        CASE(REG_MULTIPLY): INT_OP(INT_VAL, *); DISPATCH();
+        CASE(REG_DIVIDE):   DIVIDE_OP(/, "Division by zero."); DISPATCH();
+        CASE(REG_MODULO):   DIVIDE_OP(%, "Modulo by zero."); DISPATCH();
+
+        CASE(REG_CONCAT): {
+            uint8_t dst = READ_BYTE();
+            ObjString* a = AS_STRING(regs[READ_BYTE()]);
+            ObjString* b = AS_STRING(regs[READ_BYTE()]);
+            regs[dst] = OBJ_VAL(concatenate(a, b));
+            NURSERY_SAFEPOINT();
+            DISPATCH();
+        }
+
+        /* --- Type-specialized (no tag checks) --- */
+
+        CASE(REG_ADD_INT):      UNCHECKED_INT_OP(+); DISPATCH();
+        CASE(REG_SUBTRACT_INT): UNCHECKED_INT_OP(-); DISPATCH();
+        CASE(REG_MULTIPLY_INT): UNCHECKED_INT_OP(*); DISPATCH();
+        CASE(REG_DIVIDE_INT):   UNCHECKED_DIVIDE_OP(/, "Division by zero."); DISPATCH();
+        CASE(REG_MODULO_INT):   UNCHECKED_DIVIDE_OP(%, "Modulo by zero."); DISPATCH();
+
+        CASE(REG_ADDK): {
+            uint8_t dst = READ_BYTE();
+            Value a = regs[READ_BYTE()];
+            Value k = constants[READ_BYTE()];
+            if (!IS_INT(a)) RUNTIME_ERROR("Operands must be two numbers or two strings.");
+            regs[dst] = INT_VAL(AS_INT(a) + AS_INT(k));
+            DISPATCH();
+        }
+
+        CASE(REG_SUBTRACTK): {
+            uint8_t dst = READ_BYTE();
+            Value a = regs[READ_BYTE()];
+            Value k = constants[READ_BYTE()];
+            if (!IS_INT(a)) RUNTIME_ERROR("Operands must be numbers.");
+            regs[dst] = INT_VAL(AS_INT(a) - AS_INT(k));
+            DISPATCH();
+        }
+
+        CASE(REG_NEGATE): {
+            uint8_t dst = READ_BYTE();
+            Value a = regs[READ_BYTE()];
+            if (!IS_INT(a)) RUNTIME_ERROR("Operand must be a number.");
+            regs[dst] = INT_VAL(-AS_INT(a));
+            DISPATCH();
+        }
+
+        CASE(REG_NOT): {
+            uint8_t dst = READ_BYTE();
+            Value a = regs[READ_BYTE()];
+            if (!IS_BOOL(a)) RUNTIME_ERROR("Operand must be boolean.");
+            regs[dst] = BOOL_VAL(!AS_BOOL(a));
+            DISPATCH();
+        }
+
+
+        /* --- Comparisons --- */
+
+        CASE(REG_EQUAL): {
+            uint8_t dst = READ_BYTE();
+            Value a = regs[READ_BYTE()];
+            Value b = regs[READ_BYTE()];
+            regs[dst] = BOOL_VAL(values_equal(a, b));
+            DISPATCH();
+        }
+
+        CASE(REG_NOT_EQUAL): {
+            uint8_t dst = READ_BYTE();
+            Value a = regs[READ_BYTE()];
+            Value b = regs[READ_BYTE()];
+            regs[dst] = BOOL_VAL(!values_equal(a, b));
+            DISPATCH();
+        }
+
+        CASE(REG_LESS):          INT_OP(BOOL_VAL, <); DISPATCH();
+        CASE(REG_LESS_EQUAL):    INT_OP(BOOL_VAL, <=); DISPATCH();
+        CASE(REG_GREATER):       INT_OP(BOOL_VAL, >); DISPATCH();
+        CASE(REG_GREATER_EQUAL): INT_OP(BOOL_VAL, >=); DISPATCH();
+
+
+        /* --- Control flow --- */
+
+        CASE(REG_JUMP): {
+            uint16_t offset = READ_SHORT();
+            ip += offset;
+            DISPATCH();
+        }
+
+        CASE(REG_LOOP): {
+            uint16_t offset = READ_SHORT();
+            ip -= offset;
+            DISPATCH();
+        }
+
+        CASE(REG_JUMP_IF_FALSE): {
+            Value condition = regs[READ_BYTE()];
+            uint16_t offset = READ_SHORT();
+            if (IS_BOOL(condition) && !AS_BOOL(condition)) ip += offset;
+            DISPATCH();
+        }
+
+        CASE(REG_JUMP_IF_NOT_EQUAL): {
+            Value a = regs[READ_BYTE()];
+            Value b = regs[READ_BYTE()];
+            uint16_t offset = READ_SHORT();
+            if (!values_equal(a, b)) ip += offset;
+            DISPATCH();
+        }
+
+        CASE(REG_JUMP_IF_NOT_NOT_EQUAL): {
+            Value a = regs[READ_BYTE()];
+            Value b = regs[READ_BYTE()];
+            uint16_t offset = READ_SHORT();
+            if (values_equal(a, b)) ip += offset;
+            DISPATCH();
+        }
+
+        CASE(REG_JUMP_IF_NOT_LESS):           BRANCH_UNLESS(<, regs[READ_BYTE()]); DISPATCH();
+        CASE(REG_JUMP_IF_NOT_LESS_EQUAL):     BRANCH_UNLESS(<=, regs[READ_BYTE()]); DISPATCH();
+        CASE(REG_JUMP_IF_NOT_GREATER):        BRANCH_UNLESS(>, regs[READ_BYTE()]); DISPATCH();
+        CASE(REG_JUMP_IF_NOT_GREATER_EQUAL):  BRANCH_UNLESS(>=, regs[READ_BYTE()]); DISPATCH();
+        CASE(REG_JUMP_IF_NOT_LESSK):          BRANCH_UNLESS(<, constants[READ_BYTE()]); DISPATCH();
+        CASE(REG_JUMP_IF_NOT_LESS_EQUALK):    BRANCH_UNLESS(<=, constants[READ_BYTE()]); DISPATCH();
+        CASE(REG_JUMP_IF_NOT_GREATERK):       BRANCH_UNLESS(>, constants[READ_BYTE()]); DISPATCH();
+        CASE(REG_JUMP_IF_NOT_GREATER_EQUALK): BRANCH_UNLESS(>=, constants[READ_BYTE()]); DISPATCH();
+
+
+        /* --- Calls --- */
+
+        CASE(REG_CALL): {
+            uint8_t base = READ_BYTE();
+            uint8_t argCount = READ_BYTE();
+            STORE_FRAME();
+            if (!call_register(vm, regs[base], regs - vm->stack + base, argCount)) {
+                return INTERPRET_RUNTIME_ERROR;
             }
+            // A new frame, or the native's result in place (the stack may have moved)
+            LOAD_FRAME();
+            DISPATCH();
+        }
 
-            case OP_MODULO: {
-                if (!IS_INT(PEEK(0)) || !IS_INT(PEEK(1))) {
-                    runtimeError("Operands must be numbers.");
-                    return INTERPRET_RUNTIME_ERROR;
-                }
-                int divisor = AS_INT(PEEK(0)); 
-                if (divisor == 0) {
-                    runtimeError("Modulo by zero.");
+        CASE(REG_CALL_DIRECT): {
+            // OP_CALL_DIRECT's inline cache: the arguments move up over the
+            // callee slot, which gets the function's global
+            uint8_t base = READ_BYTE();
+            ObjFunction* function = AS_FUNCTION(constants[READ_BYTE()]);
+            uint8_t argCount = READ_BYTE();
+            Value callee = globals[function->global];
+
+            for (int i = argCount; i > 0; i--) regs[base + i] = regs[base + i - 1];
+            regs[base] = callee;
+            STORE_FRAME();
+
+            if (IS_OBJ(callee) && AS_OBJ(callee) == (Obj*)function) {
+                if (push_register_frame(vm, function, regs - vm->stack + base) == NULL) {
+                    runtimeError(vm, "Stack overflow.");
                     return INTERPRET_RUNTIME_ERROR;
                 }
-                int b = AS_INT(pop());
-                int a = AS_INT(pop());
-                push(INT_VAL(a % b));
-                break;
+            } else if (!call_register(vm, callee, regs - vm->stack + base, argCount)) {
+                return INTERPRET_RUNTIME_ERROR;
             }
 
-            case OP_NEGATE: {
-                if (!IS_INT(PEEK(0))) {
-                    runtimeError("Operand must be a number.");
+            LOAD_FRAME();
+            DISPATCH();
+        }
+
+        CASE(REG_TAIL_CALL):
+        CASE(REG_TAIL_CALL_DIRECT): {
+            // The callee and arguments move down over this frame, which the
+            // function then runs in; anything else is called as REG_CALL
+            // would and its result returned
+            bool direct = ip[-1] == REG_TAIL_CALL_DIRECT;
+            uint8_t base = READ_BYTE();
+            ObjFunction* function = direct ? AS_FUNCTION(constants[READ_BYTE()]) : NULL;
+            uint8_t argCount = READ_BYTE();
+
+            if (direct) {
+                for (int i = argCount; i > 0; i--) regs[base + i] = regs[base + i - 1];
+                regs[base] = globals[function->global];
+            }
+            Value callee = regs[base];
+            STORE_FRAME();
+
+            if (IS_FUNCTION(callee) && AS_FUNCTION(callee)->arity == argCount) {
+                function = AS_FUNCTION(callee);
+                memmove(regs, regs + base, sizeof(Value) * (argCount + 1));
+                if (!reserve_registers(vm, regs - vm->stack + function->registers)) {
+                    runtimeError(vm, "Stack overflow.");
                     return INTERPRET_RUNTIME_ERROR;
                 }
-                // Unwrap, Negate, Wrap back
-                int value = AS_INT(pop());
-                push(INT_VAL(-value));
-                break;
+                frame->function = function;
+                frame->ip = function->chunk.code;
+                LOAD_FRAME();
+                DISPATCH();
             }
 
-            case OP_PRINT: {
-                // Value v = *(--stackTop);   // pop()
-                // printf("Out: ");    // prefix output for debugging
-                print_value(pop());
-                printf("\n");
-                break;
+            if (!call_register(vm, callee, regs - vm->stack + base, argCount)) {
+                return INTERPRET_RUNTIME_ERROR;
             }
+            // A native: return its result
+            regs = frame->slots;
+            regs[0] = regs[base];
+            vm->frameCount--;
+            if (vm->frameCount == 0) {
+                vm->stackTop = regs + 1;
+                return INTERPRET_OK;
+            }
+            LOAD_FRAME();
+            DISPATCH();
+        }
 
-            case OP_RETURN: {
-                // 1. Pop the function's return value (top of stack inside the function)
-                Value result = pop();
-
-                // 2. Grab the current frame BEFORE popping it
-                CallFrame* frame = &FRAME();
-
-                // 3. Pop this call frame
-                vm.frameCount--;
-
-                // 4. If we just returned from the top-level script, we're done
-                if (vm.frameCount == 0) {
-                    // vm.stackTop = vm.stack;
-                    // push the result back for inspection
-                    push(result);
-                    return INTERPRET_OK;
-                }
 
-                // 5. Discard callee + args + locals:
-                //    shrink stack back to the callee slot of this frame
-                vm.stackTop = frame->slots;
+        /* --- Statements --- */
 
-                // 6. Push the return value in their place (overwriting callee slot)
-                push(result);
+        CASE(REG_PRINT): {
+            output_line(&vm->output, regs[READ_BYTE()]);
+            DISPATCH();
+        }
 
-                // 7. Continue running caller frame (FRAME() now refers to the caller)
-                break;
+        CASE(REG_RETURN): {
+            // The result takes the callee's slot, as on the stack VM
+            regs[0] = regs[READ_BYTE()];
+            vm->frameCount--;
+            if (vm->frameCount == 0) {
+                vm->stackTop = regs + 1;
+                return INTERPRET_OK;
             }
+            LOAD_FRAME();
+            DISPATCH();
         }
     }
 
+    // Unknown opcodes are skipped, same as run()
+    DISPATCH();
+
     #undef READ_BYTE
     #undef READ_SHORT
-    #undef READ_CONSTANT
-    #undef BINARY_OP
-    #undef FRAME
-    #undef PEEK
-    #undef DEBUG_STACK
+    #undef STORE_FRAME
+    #undef LOAD_FRAME
+    #undef SET_GLOBAL
+    #undef NURSERY_SAFEPOINT
+    #undef RUNTIME_ERROR
+    #undef INT_OP
+    #undef DIVIDE_OP
+    #undef UNCHECKED_INT_OP
+    #undef UNCHECKED_DIVIDE_OP
+    #undef BRANCH_UNLESS
+    #undef CASE
+    #undef DISPATCH
+    #undef INTERPRET_LOOP
 }
 
 /**
@@ -557,8 +2144,8 @@ static InterpretResult run() {
  * @param source pointer to the entire source to compile it to a Function, and runs it.
  * @return InterpretResult OK or runtime error state.
  */
-InterpretResult interpret(ObjFunction* function) {
-    reset_stack(); 
+InterpretResult vm_interpret(VM* vm, ObjFunction* function) {
+    reset_stack(vm); 
 
     //  Compiler returns an ObjFunction
     // ObjFunction* function = compile(source);
@@ -566,13 +2153,92 @@ InterpretResult interpret(ObjFunction* function) {
 
     // push(OBJ_VAL(function));
 
-    vm.frameCount = 0;
+    vm->frameCount = 0;
+
+    // verify_unit() reported why
+    if (vm->unsafeFast && !verify_unit(vm, function, true)) return INTERPRET_COMPILE_ERROR;
+
+    if (vm->memoize) {
+        // Rooted in slot 0 while the instrumented chunks grow
+        VM* previous = use_vm(vm);
+        vm->stack[0] = OBJ_VAL(function);
+        vm->stackTop = vm->stack + 1;
+        memoize_unit(vm, function);
+        reset_stack(vm);
+        use_vm(previous);
+    }
+
+    if (vm->registerBackend && vm->profiler == NULL) {
+        // Objects created while translating and running belong to `vm`
+        VM* previous = use_vm(vm);
+
+        // Rooted in slot 0 (the callee slot) while translating allocates
+        vm->stack[0] = OBJ_VAL(function);
+        vm->stackTop = vm->stack + 1;
+        bool translated = translate_to_registers(function);
+        reset_stack(vm);
+
+        InterpretResult result = INTERPRET_COMPILE_ERROR;
+        if (!translated) {
+            // translate_to_registers() reported it
+        } else if (push_register_frame(vm, function, 0) == NULL) {
+            fprintf(stderr, "Stack overflow.\n");
+            result = INTERPRET_RUNTIME_ERROR;
+        } else {
+            result = run_reg(vm);
+        }
+        use_vm(previous);
+        return result;
+    }
     
-    CallFrame* frame = &vm.frames[vm.frameCount++];
+    CallFrame* frame = push_frame(vm, function);
+    if (frame == NULL) {
+        fprintf(stderr, "Stack overflow.\n");
+        return INTERPRET_RUNTIME_ERROR;
+    }
 
     frame->function = function;   // compiled function containing chunk
     frame->ip = function->chunk.code;
-    frame->slots = vm.stack;      // slots start at base of stack
+    frame->slots = vm->stack;      // slots start at base of stack
+
+    // Objects created while running (e.g. concatenated strings) belong to `vm`
+    VM* previous = use_vm(vm);
+    if (vm->profiler != NULL) profiler_begin_run(vm->profiler);
+    InterpretResult result = run(vm);
+    vm_trace_unwind(vm);
+    if (vm->profiler != NULL) profiler_end_run(vm->profiler);
+    use_vm(previous);
+    return result;
+}
 
-    return run();
+void vm_release_script(VM* vm, ObjFunction* script) {
+    if (vm->profiler != NULL || vm->allocProfiler != NULL) return;
+
+    // Memory is accounted to the VM it was allocated in
+    VM* previous = use_vm(vm);
+
+    // Between collections the script can be taken off the heap list: newer
+    // objects come first, so the walk only passes the unit's own
+    // allocations. In mid-collection it may be gray or awaiting the sweep,
+    // so only its code goes and the sweep frees the rest
+    if (vm->gcPhase == GC_IDLE) {
+        for (Obj** link = &vm->objects; *link != NULL; link = &(*link)->next) {
+            if (*link == (Obj*)script) {
+                *link = script->obj.next;
+                free_object((Obj*)script);
+                use_vm(previous);
+                return;
+            }
+        }
+    }
+
+    free_chunk(&script->chunk);
+    use_vm(previous);
+}
+
+/**
+ * @brief Run `function` on the calling thread's current VM.
+ */
+InterpretResult interpret(ObjFunction* function) {
+    return vm_interpret(currentVM, function);
 }
@@ -0,0 +1,11 @@
+/**
+ * @file test_disassembler.h
+ * @brief Declares unit tests for the bytecode disassembler (--dump-bytecode).
+ */
+
+#ifndef TEST_DISASSEMBLER_H
+#define TEST_DISASSEMBLER_H
+
+void test_disassembler_suite();
+
+#endif // TEST_DISASSEMBLER_H
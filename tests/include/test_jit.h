@@ -0,0 +1,11 @@
+/**
+ * @file test_jit.h
+ * @brief Declares unit tests for the baseline JIT.
+ */
+
+#ifndef TEST_JIT_H
+#define TEST_JIT_H
+
+void test_jit_suite();
+
+#endif // TEST_JIT_H
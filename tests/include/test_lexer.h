@@ -24,4 +24,10 @@ void test_whitespace_and_comments();
 // test to ensure boolean comparisons
 void test_lexer_booleans_comparisons();
 
+// test runs long enough for the block scans (whitespace, comments, words, strings)
+void test_lexer_long_runs();
+
+// test every keyword, and identifiers that look like one
+void test_lexer_keywords();
+
 #endif // TEST_LEXER_H
\ No newline at end of file
@@ -4,5 +4,6 @@
 void test_compiler_locals();
 void test_compiler_shadowing();
 void test_compiler_pop_scope();
+void test_compiler_wide_operands();
 
 #endif // TEST_LOCALS_H
\ No newline at end of file
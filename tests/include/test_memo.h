@@ -0,0 +1,11 @@
+/**
+ * @file test_memo.h
+ * @brief Declares unit tests for pure-function memoization.
+ */
+
+#ifndef TEST_MEMO_H
+#define TEST_MEMO_H
+
+void test_memo_suite();
+
+#endif // TEST_MEMO_H
@@ -0,0 +1,34 @@
+/**
+ * @file test_optimizer.h
+ * @brief Unit test declarations for the AST optimizer (constant folding, dead branches).
+ *
+ * @version 0.1
+ * @date 2026-10-14
+ */
+
+#ifndef TEST_OPTIMIZER_H
+#define TEST_OPTIMIZER_H
+
+/**
+ * @brief Tests folding of int arithmetic, comparisons and unary ops over literals.
+ */
+void test_opt_fold_arithmetic();
+
+/**
+ * @brief Tests folding of string literal concatenation and equality.
+ */
+void test_opt_fold_strings();
+
+/**
+ * @brief Tests that operations which fail at runtime are never folded.
+ *
+ * Ensures division by zero and int overflow are left for the VM.
+ */
+void test_opt_no_fold_runtime_errors();
+
+/**
+ * @brief Tests pruning of if/elif/else and while with constant conditions.
+ */
+void test_opt_dead_branches();
+
+#endif // TEST_OPTIMIZER_H
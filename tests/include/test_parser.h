@@ -50,4 +50,10 @@ void test_parser_block();
 void test_parser_if();
 void test_parser_while();
 
+// --- AST arena ---
+void test_parser_arena();
+
+// --- Pratt expression parser ---
+void test_parser_deep_nesting();
+
 #endif // TEST_PARSER_H
\ No newline at end of file
@@ -0,0 +1,11 @@
+/**
+ * @file test_peephole.h
+ * @brief Declares unit tests for the superinstruction peephole pass.
+ */
+
+#ifndef TEST_PEEPHOLE_H
+#define TEST_PEEPHOLE_H
+
+void test_peephole_suite();
+
+#endif // TEST_PEEPHOLE_H
@@ -0,0 +1,11 @@
+/**
+ * @file test_perf.h
+ * @brief Declares the performance regression tests (counted, not timed).
+ */
+
+#ifndef TEST_PERF_H
+#define TEST_PERF_H
+
+void test_perf_suite();
+
+#endif // TEST_PERF_H
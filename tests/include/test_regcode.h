@@ -0,0 +1,11 @@
+/**
+ * @file test_regcode.h
+ * @brief Declares unit tests for the register VM backend.
+ */
+
+#ifndef TEST_REGCODE_H
+#define TEST_REGCODE_H
+
+void test_regcode_suite();
+
+#endif // TEST_REGCODE_H
@@ -0,0 +1,11 @@
+/**
+ * @file test_serialize.h
+ * @brief Declares unit tests for the .detc bytecode cache.
+ */
+
+#ifndef TEST_SERIALIZE_H
+#define TEST_SERIALIZE_H
+
+void test_serialize_suite();
+
+#endif // TEST_SERIALIZE_H
@@ -0,0 +1,11 @@
+/**
+ * @file test_threads.h
+ * @brief Declares unit tests for the thread pool and VMs on several threads.
+ */
+
+#ifndef TEST_THREADS_H
+#define TEST_THREADS_H
+
+void test_threads_suite();
+
+#endif // TEST_THREADS_H
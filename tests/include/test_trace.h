@@ -0,0 +1,11 @@
+/**
+ * @file test_trace.h
+ * @brief Declares unit tests for the runtime tracing hooks.
+ */
+
+#ifndef TEST_TRACE_H
+#define TEST_TRACE_H
+
+void test_trace_suite();
+
+#endif // TEST_TRACE_H
@@ -41,6 +41,26 @@ void test_tc_undefined_var();
  */
 void test_tc_redeclaration();
 
+/**
+ * @brief Tests nested scopes in the hashed symbol table.
+ *
+ * Ensures:
+ *  - An inner declaration shadows an outer one of a different type.
+ *  - Leaving the block makes the outer symbol visible again.
+ *  - Redeclaring inside one block fails; block locals do not leak out.
+ */
+void test_tc_scoped_shadowing();
+
+/**
+ * @brief Tests globals shared by successive units (REPL lines).
+ *
+ * Ensures:
+ *  - A global stays declared, with its type, after its unit's AST is freed.
+ *  - Reads of it in later units are not annotated (checked opcodes).
+ *  - The globals of a unit with type errors are discarded.
+ */
+void test_tc_persistent_globals();
+
 /**
  * @brief Tests type mismatch in binary operations.
  *
@@ -0,0 +1,11 @@
+/**
+ * @file test_verify.h
+ * @brief Declares unit tests for the bytecode verifier.
+ */
+
+#ifndef TEST_VERIFY_H
+#define TEST_VERIFY_H
+
+void test_verify_suite();
+
+#endif // TEST_VERIFY_H
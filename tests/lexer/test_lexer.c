@@ -108,4 +108,58 @@ void test_lexer_booleans_comparisons() {
     check_token(get_next_token(&lexer), TOKEN_GREATER_EQUAL, ">=",    1);
     
     check_token(get_next_token(&lexer), TOKEN_EOF, "", 1);
-}
\ No newline at end of file
+}
+
+/**
+ * Test runs long enough for the block (SIMD) scans, including ones that
+ * end inside a block, span several blocks or reach the end of the source.
+ */
+void test_lexer_long_runs() {
+    const char* source =
+        "   \t \r\n\n   \n         \n\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\tvar\n"        // 4 newlines
+        "// a comment that is a good deal longer than one sixteen byte block\n"
+        "a_rather_long_identifier_name_42 = 12345678901234567890;\n"
+        "\"a string body running past several blocks\nand over one newline\"\n"
+        "                                             end";
+    Lexer lexer = init_lexer(source);
+
+    check_token(get_next_token(&lexer), TOKEN_VAR,       "var", 5);
+    check_token(get_next_token(&lexer), TOKEN_ID,        "a_rather_long_identifier_name_42", 7);
+    check_token(get_next_token(&lexer), TOKEN_EQUALS,    "=", 7);
+    check_token(get_next_token(&lexer), TOKEN_INT,       "12345678901234567890", 7);
+    check_token(get_next_token(&lexer), TOKEN_SEMICOLON, ";", 7);
+    check_token(get_next_token(&lexer), TOKEN_STRING,
+                "\"a string body running past several blocks\nand over one newline\"", 9);
+    check_token(get_next_token(&lexer), TOKEN_ID,        "end", 10);
+    check_token(get_next_token(&lexer), TOKEN_EOF,       "", 10);
+
+    // An unterminated string stops at the end, not past it
+    lexer = init_lexer("\"an unterminated string longer than a block");
+    check_token(get_next_token(&lexer), TOKEN_ERROR, "Unterminated string.", 1);
+}
+
+
+/**
+ * Test every keyword of the keyword table, and identifiers that share a
+ * keyword's slot, length or prefix.
+ */
+void test_lexer_keywords() {
+    static const struct { const char* text; TokenType type; } cases[] = {
+        { "var", TOKEN_VAR },         { "print", TOKEN_PRINT },      { "true", TOKEN_TRUE },
+        { "false", TOKEN_FALSE },     { "if", TOKEN_IF },            { "elif", TOKEN_ELIF },
+        { "else", TOKEN_ELSE },       { "while", TOKEN_WHILE },      { "func", TOKEN_FUNC },
+        { "return", TOKEN_RETURN },   { "int", TOKEN_TYPE_INT },     { "bool", TOKEN_TYPE_BOOL },
+        { "str", TOKEN_TYPE_STRING }, { "void", TOKEN_TYPE_VOID },
+
+        // Not keywords
+        { "vat", TOKEN_ID },    { "Var", TOKEN_ID },     { "ift", TOKEN_ID },    { "i", TOKEN_ID },
+        { "els", TOKEN_ID },    { "elifs", TOKEN_ID },   { "returns", TOKEN_ID }, { "iint", TOKEN_ID },
+        { "tnt", TOKEN_ID },    { "while_", TOKEN_ID },  { "print2", TOKEN_ID }, { "_", TOKEN_ID },
+    };
+
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        Lexer lexer = init_lexer(cases[i].text);
+        check_token(get_next_token(&lexer), cases[i].type, cases[i].text, 1);
+        check_token(get_next_token(&lexer), TOKEN_EOF, "", 1);
+    }
+}
@@ -0,0 +1,132 @@
+/**
+ * @file test_optimizer.c
+ * @brief Testcases for the AST optimizer
+ * @version 0.1
+ * @date 2026-10-14
+ */
+
+#include <string.h>
+
+#include "test_optimizer.h"
+#include "test.h"
+#include "parser.h"
+#include "typechecker.h"
+#include "optimizer.h"
+#include "ast.h"
+
+/**
+ * @brief Parse, typecheck and optimize a snippet at -O1.
+ */
+static AstNode* optimize_source(const char* source) {
+    AstNode* root = parse(source, 0);
+    CHECK(root != NULL, "Parse must succeed");
+    if (!root) return NULL;
+
+    CHECK(typecheck_ast(root), "Typecheck must succeed");
+    optimize_ast(root, OPT_LEVEL_FOLD);
+    return root;
+}
+
+/**
+ * @brief Expression of the `index`-th statement (a print statement).
+ */
+static AstNode* printed(AstNode* root, int index) {
+    AstNodeProgram* prog = (AstNodeProgram*)root;
+    if (index >= prog->statement_count) return NULL;
+    AstNode* stmt = prog->statements[index];
+    if (stmt->type != NODE_PRINT_STMT) return NULL;
+    return ((AstNodePrintStmt*)stmt)->expression;
+}
+
+static int is_int(AstNode* node, int value) {
+    return node && node->type == NODE_INT_LITERAL && ((AstNodeIntLiteral*)node)->value == value;
+}
+
+static int is_bool(AstNode* node, int value) {
+    return node && node->type == NODE_BOOL_LITERAL && ((AstNodeBoolLiteral*)node)->value == value;
+}
+
+void test_opt_fold_arithmetic() {
+    AstNode* root = optimize_source(
+        "print 2 + 3 * 4;"
+        "print (10 - 4) / 2 % 2;"
+        "print -(5 - 7);"
+        "print 3 <= 3;"
+        "print !(1 > 2);");
+    if (!root) return;
+
+    CHECK(is_int(printed(root, 0), 14), "2 + 3 * 4 folds to 14");
+    CHECK(is_int(printed(root, 1), 1), "(10 - 4) / 2 % 2 folds to 1");
+    CHECK(is_int(printed(root, 2), 2), "-(5 - 7) folds to 2");
+    CHECK(is_bool(printed(root, 3), 1), "3 <= 3 folds to true");
+    CHECK(is_bool(printed(root, 4), 1), "!(1 > 2) folds to true");
+    CHECK(printed(root, 0)->resolvedType == TYPE_INT, "Folded literal keeps its type annotation");
+
+    // A non-literal operand stops folding at that node
+    free_ast(root);
+    root = optimize_source("var opt_v = 1; print opt_v + (2 * 3);");
+    if (!root) return;
+    AstNode* expr = printed(root, 1);
+    CHECK(expr && expr->type == NODE_BINARY_OP, "x + (...) stays a binary op");
+    CHECK(expr && is_int(((AstNodeBinaryOp*)expr)->right, 6), "Literal subtree still folds");
+    free_ast(root);
+}
+
+void test_opt_fold_strings() {
+    AstNode* root = optimize_source(
+        "print \"ab\" + \"cd\" + \"e\";"
+        "print \"x\" == \"x\";"
+        "print \"x\" != \"x\";");
+    if (!root) return;
+
+    AstNode* s = printed(root, 0);
+    CHECK(s && s->type == NODE_STRING_LITERAL, "String concat folds to a literal");
+    CHECK(s && ((AstNodeStringLiteral*)s)->length == 5 &&
+          memcmp(((AstNodeStringLiteral*)s)->chars, "abcde", 5) == 0, "Folded string is \"abcde\"");
+    CHECK(is_bool(printed(root, 1), 1), "\"x\" == \"x\" folds to true");
+    CHECK(is_bool(printed(root, 2), 0), "\"x\" != \"x\" folds to false");
+    free_ast(root);
+}
+
+void test_opt_no_fold_runtime_errors() {
+    AstNode* root = optimize_source(
+        "print 1 / 0;"
+        "print 1 % 0;"
+        "print 2147483647 + 1;");
+    if (!root) return;
+
+    for (int i = 0; i < 3; i++) {
+        AstNode* expr = printed(root, i);
+        CHECK(expr && expr->type == NODE_BINARY_OP, "Failing operation is left for the VM");
+    }
+    free_ast(root);
+}
+
+void test_opt_dead_branches() {
+    AstNode* root = optimize_source(
+        "if false { print 1; } elif 1 < 2 { print 2; } else { print 3; }"
+        "while false { print 4; }"
+        "if 2 > 3 { print 5; }"
+        "print 6;");
+    if (!root) return;
+
+    AstNodeProgram* prog = (AstNodeProgram*)root;
+    CHECK(prog->statement_count == 2, "Dead if/while statements are removed");
+
+    AstNode* first = prog->statements[0];
+    CHECK(first->type == NODE_BLOCK, "if false / elif true collapses to the elif block");
+    if (first->type == NODE_BLOCK) {
+        AstNodeBlock* block = (AstNodeBlock*)first;
+        CHECK(block->statement_count == 1 &&
+              is_int(((AstNodePrintStmt*)block->statements[0])->expression, 2),
+              "Surviving block prints 2");
+    }
+    CHECK(is_int(printed(root, 1), 6), "Following statements are kept");
+    free_ast(root);
+
+    // Optimization level 0 leaves the tree alone
+    root = parse("if false { print 1; }", 0);
+    optimize_ast(root, OPT_LEVEL_NONE);
+    CHECK(((AstNodeProgram*)root)->statements[0]->type == NODE_IF, "-O0 does not prune");
+    free_ast(root);
+}
@@ -9,6 +9,7 @@
 #include "ast.h"
 #include <stdlib.h>  
 #include <stdio.h>
+#include <string.h>
 
 // Helper to extract the first statement's expression
 static AstNode* get_first_stmt_expr(AstNode* root) {
@@ -282,4 +283,86 @@ void test_parser_while() {
     CHECK(whileNode->body->type == NODE_BLOCK, "Body is BLOCK");
     
     free_ast(root);
-}
\ No newline at end of file
+}
+void test_parser_arena() {
+    const char* source = "var a = 1; if a > 0 { print \"pos\"; } func f(x): int { return x; } print f(a);";
+    AstNode* root = parse(source, 0);
+    CHECK(root != NULL, "Parse succeeded");
+
+    AstNodeProgram* prog = (AstNodeProgram*)root;
+    CHECK(prog->arena != NULL, "Program owns an arena");
+    CHECK(prog->arena->bytesUsed > 0, "Nodes were carved from the arena");
+    CHECK(root->inArena, "Program node lives in the arena");
+    CHECK(prog->statement_count == 4, "All 4 statements parsed");
+
+    int allInArena = 1;
+    for (int i = 0; i < prog->statement_count; i++) {
+        if (!prog->statements[i]->inArena) allInArena = 0;
+    }
+    CHECK(allInArena, "Every statement lives in the arena");
+
+    // Nodes built outside a parse are still individually malloc'd
+    AstNode* loose = new_int_literal_node(7, 1);
+    CHECK(loose != NULL && !loose->inArena, "Standalone node is not arena-owned");
+    free_ast(loose);
+
+    free_ast(root); // Single arena release
+
+    // A caller's scratch arena is reused from one parse to the next
+    Arena scratch;
+    arena_init(&scratch);
+    root = parse_in_arena("var b = 2; print b;", 0, &scratch);
+    CHECK(root != NULL && !((AstNodeProgram*)root)->ownsArena, "Tree is built in the caller's arena");
+    free_ast(root); // Leaves the arena alone
+    ArenaBlock* block = scratch.head;
+    arena_reset(&scratch);
+    CHECK(scratch.head == block && scratch.bytesUsed == 0, "Reset keeps the block for reuse");
+
+    root = parse_in_arena("print 3;", 0, &scratch);
+    CHECK(root != NULL && (void*)root == (void*)block->data, "Next tree starts at the same memory");
+    free_ast(root);
+    CHECK(parse_in_arena("print ;", 0, &scratch) == NULL, "Parse errors still return NULL");
+    arena_free(&scratch);
+}
+
+/**
+ * Builds "print ((...(1)...));" with `depth` parentheses.
+ */
+static char* nested_source(int depth) {
+    char* source = (char*)malloc((size_t)depth * 2 + 16);
+    if (!source) return NULL;
+    int length = sprintf(source, "print ");
+    for (int i = 0; i < depth; i++) source[length++] = '(';
+    source[length++] = '1';
+    for (int i = 0; i < depth; i++) source[length++] = ')';
+    strcpy(source + length, ";");
+    return source;
+}
+
+void test_parser_deep_nesting() {
+    char* source = nested_source(200);
+    AstNode* root = source ? parse(source, 0) : NULL;
+    CHECK(root != NULL, "200 nested parentheses parse");
+    AstNode* stmt = get_first_stmt_expr(root);
+    CHECK(stmt && ((AstNodePrintStmt*)stmt)->expression->type == NODE_INT_LITERAL, "Grouping leaves just the literal");
+    free_ast(root);
+    free(source);
+
+    // Far past the limit: an error, not a C stack overflow
+    printf("--- Expecting Parse Error Below ---\n");
+    source = nested_source(100000);
+    CHECK(source && parse(source, 0) == NULL, "100000 nested parentheses are rejected");
+    free(source);
+
+    // Long left-associative chains don't nest at all
+    size_t terms = 50000;
+    source = (char*)malloc(terms * 4 + 16);
+    if (!source) return;
+    size_t length = (size_t)sprintf(source, "print 1");
+    for (size_t i = 1; i < terms; i++) length += (size_t)sprintf(source + length, " + 1");
+    strcpy(source + length, ";");
+    root = parse(source, 0);
+    CHECK(root != NULL, "A 50000-term sum parses");
+    free_ast(root);
+    free(source);
+}
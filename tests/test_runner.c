@@ -16,6 +16,17 @@
 #include "test_compound.h"
 #include "test_locals.h"
 #include "test_functions.h"
+#include "test_peephole.h"
+#include "test_optimizer.h"
+#include "test_serialize.h"
+#include "test_regcode.h"
+#include "test_jit.h"
+#include "test_verify.h"
+#include "test_threads.h"
+#include "test_disassembler.h"
+#include "test_trace.h"
+#include "test_memo.h"
+#include "test_perf.h"
 #include "typechecker.h" // For init
 #include "vm/compiler.h" // For init
 #include "vm/vm.h"
@@ -39,6 +50,8 @@ int main(int argc, char* argv[]) {
     run_test(test_line_numbers, "Lexer - Line Number Increments");
     run_test(test_whitespace_and_comments, "Lexer - Whitespace and Comment Skipping");
     run_test(test_lexer_booleans_comparisons, "Lexer - Booleans and Conditionals checking");
+    run_test(test_lexer_long_runs, "Lexer - Long Runs (Block Scans)");
+    run_test(test_lexer_keywords, "Lexer - Keyword Table");
 
     // Phase 2 (Parser) Test Suite
     printf("\n"); // separator
@@ -58,6 +71,15 @@ int main(int argc, char* argv[]) {
     run_test(test_tc_var_decl_and_access, "TypeChecker - Valid Var Decl & Access");
     run_test(test_tc_undefined_var, "TypeChecker - Undefined Variable Error");
     run_test(test_tc_redeclaration, "TypeChecker - Redeclaration Error");
+    run_test(test_tc_scoped_shadowing, "TypeChecker - Scoped Shadowing");
+    run_test(test_tc_persistent_globals, "TypeChecker - Globals Across Units");
+
+    // Optimizer (AST folding) Test Suite
+    printf("\n");
+    run_test(test_opt_fold_arithmetic, "Optimizer - Fold Int Arithmetic");
+    run_test(test_opt_fold_strings, "Optimizer - Fold Strings");
+    run_test(test_opt_no_fold_runtime_errors, "Optimizer - Keep Runtime Errors");
+    run_test(test_opt_dead_branches, "Optimizer - Dead Branch Elimination");
 
     // Phase 4 Tests (VM)
     printf("\n");
@@ -77,6 +99,8 @@ int main(int argc, char* argv[]) {
     run_test(test_parser_block, "Parser - Blocks {}");
     run_test(test_parser_if, "Parser - If/Else");
     run_test(test_parser_while, "Parser - While Loop");
+    run_test(test_parser_arena, "Parser - AST Arena");
+    run_test(test_parser_deep_nesting, "Parser - Deep Nesting Limit");
 
     // Phase 7 Feature Tests
     printf("\n");
@@ -88,6 +112,47 @@ int main(int argc, char* argv[]) {
     run_test(test_compiler_locals, "Compiler - Local Variables");
     run_test(test_compiler_shadowing, "Compiler - Shadowing");
     run_test(test_compiler_pop_scope, "Compiler - Scope Cleanup");
+    run_test(test_compiler_wide_operands, "Compiler - Wide Operands");
+
+    // Peephole / superinstructions
+    printf("\n");
+    test_peephole_suite();
+
+    // Bytecode cache (.detc)
+    printf("\n");
+    test_serialize_suite();
+
+    // Register VM backend
+    printf("\n");
+    test_regcode_suite();
+
+    // Baseline JIT
+    printf("\n");
+    test_jit_suite();
+
+    // Bytecode verifier (--unsafe-fast)
+    printf("\n");
+    test_verify_suite();
+
+    // Thread pool (--batch)
+    printf("\n");
+    test_threads_suite();
+
+    // Disassembler (--dump-bytecode)
+    printf("\n");
+    test_disassembler_suite();
+
+    // Tracing hooks (--trace-execution)
+    printf("\n");
+    test_trace_suite();
+
+    // Pure-function result cache (--memoize)
+    printf("\n");
+    test_memo_suite();
+
+    // Performance regressions: instruction, allocation and GC counts
+    printf("\n");
+    test_perf_suite();
 
     // TODO
     // // Phase 9 — Function Tests
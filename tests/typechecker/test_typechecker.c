@@ -68,6 +68,80 @@ void test_tc_redeclaration() {
     }
 }
 
+/**
+ * @brief Nested scopes: shadowing, uncovering on scope exit, block-level redeclaration
+ */
+void test_tc_scoped_shadowing() {
+    // Inner 'tc_s' is a string; after the block the outer int is visible again
+    const char* source =
+        "var tc_s = 1; { var tc_s = \"inner\"; print tc_s + \"!\"; } print tc_s + 1;";
+    AstNode* root = parse(source, 0);
+    CHECK(root != NULL, "Parse failed");
+    if (root) {
+        CHECK(typecheck_ast(root) == 1, "Shadowed symbol is restored after its block");
+        free_ast(root);
+    }
+
+    // Redeclaring inside the same block is an error
+    root = parse("{ var tc_d = 1; var tc_d = 2; }", 0);
+    CHECK(root != NULL, "Parse failed");
+    if (root) {
+        printf("--- Expecting Type Error Below ---\n");
+        int valid = typecheck_ast(root);
+        printf("----------------------------------\n");
+        CHECK(valid == 0, "Block-level redeclaration should fail");
+        free_ast(root);
+    }
+
+    // A block-local name is gone once the block ends
+    root = parse("{ var tc_gone = 1; } print tc_gone;", 0);
+    CHECK(root != NULL, "Parse failed");
+    if (root) {
+        printf("--- Expecting Type Error Below ---\n");
+        int valid = typecheck_ast(root);
+        printf("----------------------------------\n");
+        CHECK(valid == 0, "Block-local name is not visible after the block");
+        free_ast(root);
+    }
+}
+
+/**
+ * @brief Globals outlive the unit (REPL line) that declared them
+ */
+void test_tc_persistent_globals() {
+    AstNode* root = parse("var tc_p = 1; var tc_q = \"s\";", 0);
+    CHECK(root != NULL && typecheck_ast(root), "Declaring unit checks");
+    if (root) free_ast(root); // The names must not depend on this tree
+
+    root = parse("print tc_p + 1; print tc_q + \"t\";", 0);
+    CHECK(root != NULL && typecheck_ast(root), "Later unit sees the globals and their types");
+    if (root) {
+        // The value may not be what the checker expects (the declaring
+        // unit could have stopped early), so the read is left unproven
+        AstNodePrintStmt* print = (AstNodePrintStmt*)((AstNodeProgram*)root)->statements[0];
+        CHECK(print->expression->resolvedType == TYPE_ERROR, "Earlier unit's global is unproven");
+        free_ast(root);
+    }
+
+    // A rejected unit leaves no globals behind
+    root = parse("var tc_r = 1; print tc_r + \"x\";", 0);
+    if (root) {
+        printf("--- Expecting Type Error Below ---\n");
+        int valid = typecheck_ast(root);
+        printf("----------------------------------\n");
+        CHECK(valid == 0, "Bad unit is rejected");
+        free_ast(root);
+    }
+    root = parse("print tc_r;", 0);
+    if (root) {
+        printf("--- Expecting Type Error Below ---\n");
+        int valid = typecheck_ast(root);
+        printf("----------------------------------\n");
+        CHECK(valid == 0, "Rejected unit's global is not declared");
+        free_ast(root);
+    }
+}
+
 /**
  * @brief Placeholder test for future operator type mismatches.
  */
@@ -0,0 +1,135 @@
+/**
+ * @file test_disassembler.c
+ * @brief Unit tests for the bytecode disassembler (--dump-bytecode).
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "test_disassembler.h"
+#include "test.h"
+
+#include "vm/chunk.h"
+#include "vm/vm.h"
+#include "vm/opcode.h"
+#include "vm/object.h"
+#include "vm/compiler.h"
+#include "vm/disassembler.h"
+#include "parser.h"
+#include "typechecker.h"
+#include "ast.h"
+
+/* -------------------------------------------------------------
+ * Helper: read everything written to `file` into `text`
+ * ------------------------------------------------------------- */
+static void read_listing(FILE* file, char* text, size_t size) {
+    rewind(file);
+    size_t length = fread(text, 1, size - 1, file);
+    text[length] = '\0';
+}
+
+
+/* -------------------------------------------------------------
+ * TEST 1: Hand-written chunk, operands and jump targets
+ * ------------------------------------------------------------- */
+static void test_disassembler_instructions() {
+    init_vm();
+    Chunk chunk;
+    init_chunk(&chunk);
+
+    int k = add_constant(&chunk, INT_VAL(42));
+
+    write_chunk(&chunk, OP_CONSTANT, 1);        // 0
+    write_chunk(&chunk, (uint8_t)k, 1);
+    write_chunk(&chunk, OP_JUMP_IF_FALSE, 1);   // 2
+    write_chunk(&chunk, 0, 1);
+    write_chunk(&chunk, 2, 1);
+    write_chunk(&chunk, OP_POP, 2);             // 5
+    write_chunk(&chunk, OP_LOOP, 2);            // 6
+    write_chunk(&chunk, 0, 2);
+    write_chunk(&chunk, 9, 2);
+    write_chunk(&chunk, OP_RETURN, 3);          // 9
+
+    BytecodeStats stats;
+    memset(&stats, 0, sizeof(stats));
+    bytecode_stats(&chunk, &stats);
+    CHECK(stats.instructions == 5 && stats.bytes == 10, "5 instructions in 10 bytes");
+    CHECK(stats.opcodes[OP_POP] == 1 && stats.opcodes[OP_ADD] == 0, "Opcodes are counted");
+    CHECK(stats.constants == 1 && stats.lineRuns == chunk.lineCount, "Constants and line runs");
+
+    FILE* file = tmpfile();
+    CHECK(file != NULL, "Temporary file for the listing");
+    if (file != NULL) {
+        char text[1024];
+        int offset = 0;
+        int listed = 0;
+        while (offset < chunk.count) {
+            offset = disassemble_instruction(file, &chunk, offset);
+            listed++;
+        }
+        read_listing(file, text, sizeof(text));
+        CHECK(listed == 5 && offset == chunk.count, "Each call steps over one instruction");
+        CHECK(strstr(text, "OP_CONSTANT") != NULL && strstr(text, "42") != NULL, "Constants show their value");
+        CHECK(strstr(text, "-> 0007") != NULL, "Forward jumps show their target");
+        CHECK(strstr(text, "-> 0000") != NULL, "Loops show their target");
+        CHECK(strstr(text, "0005    2 OP_POP") != NULL && strstr(text, "0006    | OP_LOOP") != NULL,
+              "A line is printed once per run");
+        fclose(file);
+    }
+
+    free_chunk(&chunk);
+    free_vm();
+}
+
+
+/* -------------------------------------------------------------
+ * TEST 2: Compiled unit, nested functions and totals
+ * ------------------------------------------------------------- */
+static void test_disassembler_unit() {
+    AstNode* ast = parse(
+        "func da_twice(n): int { return n + n; }"
+        "var da_total = 0;"
+        "while da_total < 10 { da_total = da_total + da_twice(1); }"
+        "print \"da done\";",
+        0);
+    CHECK(ast != NULL, "Parse must succeed");
+    CHECK(typecheck_ast(ast), "Typecheck must succeed");
+
+    init_vm();
+    ObjFunction* fn = compile_ast(ast);
+    CHECK(fn != NULL, "Compilation must succeed");
+
+    FILE* file = tmpfile();
+    CHECK(file != NULL, "Temporary file for the listing");
+    if (fn != NULL && file != NULL) {
+        char text[8192];
+        disassemble_unit(file, fn);
+        read_listing(file, text, sizeof(text));
+
+        CHECK(strstr(text, "== <script>") != NULL, "Script is listed");
+        CHECK(strstr(text, "== da_twice (arity 1") != NULL, "Nested function is listed");
+        CHECK(strstr(text, "da_total") != NULL, "Globals show their name");
+        CHECK(strstr(text, "\"da done\"") != NULL, "Strings are quoted");
+        CHECK(strstr(text, "== unit: 2 functions ==") != NULL, "Unit totals close the listing");
+
+        BytecodeStats stats;
+        memset(&stats, 0, sizeof(stats));
+        bytecode_stats(&fn->chunk, &stats);
+        char expected[128];
+        snprintf(expected, sizeof(expected), "-- %d instructions, %d bytes", stats.instructions, fn->chunk.count);
+        CHECK(strstr(text, expected) != NULL, "Script summary matches its chunk");
+    }
+    if (file != NULL) fclose(file);
+
+    free_ast(ast);
+    free_vm();
+}
+
+
+/* -------------------------------------------------------------
+ * SUITE WRAPPER
+ * ------------------------------------------------------------- */
+void test_disassembler_suite() {
+    run_test(test_disassembler_instructions, "Disassembler - Operands and jump targets");
+    run_test(test_disassembler_unit,         "Disassembler - Functions and unit totals");
+}
@@ -9,6 +9,8 @@
 #include "vm/memory.h"
 #include "vm/object.h"
 #include "vm/value.h"
+#include "vm/table.h"
+#include "vm/compiler.h"
 
 #include <string.h>
 #include <stdio.h>
@@ -69,8 +71,383 @@ static void test_gc_preservation() {
     free_vm();
 }
 
+static void test_gc_interning() {
+    init_vm();
+
+    // 1. Equal contents -> same object
+    ObjString* a = copy_string("intern", 6);
+    push(OBJ_VAL(a));
+    ObjString* b = copy_string("intern", 6);
+    CHECK(a == b, "copy_string returns the interned string");
+    CHECK(a->hash != 0, "Hash is cached on the string");
+
+    ObjString* left = copy_string("in", 2);
+    push(OBJ_VAL(left));
+    ObjString* right = copy_string("tern", 4);
+    push(OBJ_VAL(right));
+    ObjString* joined = concatenate(left, right);
+    CHECK(joined == a, "Concatenation result is interned too");
+    CHECK(values_equal(OBJ_VAL(joined), OBJ_VAL(a)), "Equal strings compare equal");
+
+    // 2. The intern table is weak: unreachable strings leave it
+    ObjString* ghost = copy_string("ghost", 5);
+    CHECK(table_find_string(&vm.strings, "ghost", 5, ghost->hash) == ghost, "Fresh string is interned");
+    uint32_t ghostHash = ghost->hash;
+    collect_garbage();
+    CHECK(table_find_string(&vm.strings, "ghost", 5, ghostHash) == NULL, "GC prunes dead strings from the table");
+    CHECK(table_find_string(&vm.strings, "intern", 6, a->hash) == a, "Reachable strings stay interned");
+
+    pop();
+    pop();
+    pop();
+    free_vm();
+}
+
+static bool on_heap_list(Obj* object) {
+    for (Obj* o = vm.objects; o != NULL; o = o->next) {
+        if (o == object) return true;
+    }
+    return false;
+}
+
+static void test_gc_nursery() {
+    init_vm();
+
+    ObjString* left = copy_string("young", 5);
+    push(OBJ_VAL(left));
+    ObjString* right = copy_string("-string", 7);
+    push(OBJ_VAL(right));
+
+    // 1. Concatenation results start in the nursery, off the heap list
+    size_t mem_before = vm.bytesAllocated;
+    ObjString* joined = concatenate(left, right);
+    CHECK(joined->obj.isYoung, "Concatenation allocates in the nursery");
+    CHECK(!on_heap_list((Obj*)joined), "Young strings are not on the heap list");
+    CHECK(vm.bytesAllocated == mem_before, "Young bytes are not counted against the old heap");
+    CHECK(concatenate(left, right) == joined, "Young strings are interned");
+
+    ObjString* garbage = concatenate(right, left);
+    CHECK(garbage->obj.isYoung, "Second young string");
+    uint32_t garbageHash = garbage->hash;
+    push(OBJ_VAL(joined));
+
+    // 2. A minor collection promotes what the stack reaches and drops the rest
+    vm_collect_nursery(&vm);
+    ObjString* promoted = AS_STRING(peek(0));
+    CHECK(promoted != joined && !promoted->obj.isYoung, "Reachable young string is promoted");
+    CHECK(on_heap_list((Obj*)promoted), "Promoted string joins the heap list");
+    CHECK(promoted->length == 12 && memcmp(promoted->chars, "young-string", 12) == 0, "Promotion keeps the contents");
+    CHECK(copy_string("young-string", 12) == promoted, "Intern table points at the promoted copy");
+    CHECK(table_find_string(&vm.strings, "-stringyoung", 12, garbageHash) == NULL,
+          "Dead young strings leave the intern table");
+    CHECK(vm.nursery.top == vm.nursery.start, "Nursery is empty after a minor collection");
+
+    pop();
+    pop();
+    pop();
+    free_vm();
+}
+
+static void test_gc_ropes() {
+    init_vm();
+
+    char text[ROPE_MIN_LENGTH + 2000];
+    memset(text, 'r', ROPE_MIN_LENGTH);
+    ObjString* base = copy_string(text, ROPE_MIN_LENGTH);
+    push(OBJ_VAL(base));
+    ObjString* piece = copy_string("-x", 2);
+    push(OBJ_VAL(piece));
+
+    // 1. Long concatenations are ropes: nothing is copied yet
+    ObjString* s = concatenate(base, piece);
+    CHECK(s->obj.type == OBJ_ROPE && IS_STRING(OBJ_VAL(s)), "Long concatenation builds a rope");
+    CHECK(s->chars == NULL && s->length == ROPE_MIN_LENGTH + 2, "Rope knows its length, not its characters");
+    for (int i = 0; i < 999; i++) {
+        vm.stackTop[-1] = OBJ_VAL(s);
+        s = concatenate(s, piece);
+    }
+    vm.stackTop[-1] = OBJ_VAL(s);
+
+    // 2. The collector keeps the whole chain of nodes alive through the root
+    collect_garbage();
+    for (int i = 0; i < 1000; i++) memcpy(text + ROPE_MIN_LENGTH + 2 * i, "-x", 2);
+    int length = ROPE_MIN_LENGTH + 2000;
+    CHECK(s->length == length, "Appending adds up the length");
+
+    // 3. Flattening happens once, on demand
+    ObjString* flat = copy_string(text, length);
+    CHECK(flat != s, "Ropes are not interned");
+    CHECK(values_equal(OBJ_VAL(s), OBJ_VAL(flat)), "Rope equals the flat string with its contents");
+    CHECK(s->chars != NULL && memcmp(s->chars, text, (size_t)length) == 0 && s->chars[length] == '\0',
+          "Flattened characters are the concatenation");
+    CHECK(((ObjRope*)s)->left == NULL && ((ObjRope*)s)->right == NULL, "Flattened rope lets go of its children");
+    CHECK(!values_equal(OBJ_VAL(s), OBJ_VAL(base)), "Different contents compare unequal");
+
+    // 4. Young operands are copied out of the nursery into the rope
+    ObjString* young = concatenate(piece, piece);
+    CHECK(young->obj.isYoung, "Short concatenation is young");
+    ObjString* tail = concatenate(base, young);
+    CHECK(!((ObjRope*)tail)->right->obj.isYoung, "Rope children live in the old heap");
+    CHECK(strcmp(AS_CSTRING(OBJ_VAL(tail)) + ROPE_MIN_LENGTH, "-x-x") == 0, "Copied child keeps its contents");
+
+    pop();
+    pop();
+    free_vm();
+}
+
+static void test_gc_incremental() {
+#ifdef DEBUG_STRESS_GC
+    // Stress builds run a slice on every allocation; the phases checked
+    // below only hold when the slices are driven by hand
+    return;
+#endif
+    set_gc_step_budget(4);
+    init_vm();
+    vm.nextGC = 1024 * 1024 * 1024; // Only the explicit slices below collect
+
+    ObjString* kept = copy_string("kept", 4);
+    push(OBJ_VAL(kept));
+    ObjString* dead = copy_string("dead", 4);
+    uint32_t deadHash = dead->hash;
+    ObjString* moved = copy_string("moved", 5);
+    vm.globals[GLOBALS_MAX - 1] = OBJ_VAL(moved);
+    vm_use_global(&vm, GLOBALS_MAX - 1);
+
+    // 1. A slice does bounded work: the cycle stays open across several
+    vm_collect_step(&vm);
+    CHECK(vm.gcPhase == GC_MARK, "First slice starts marking");
+    CHECK(vm.gcGlobalCursor < GLOBALS_MAX, "Globals are scanned a slice at a time");
+
+    // 2. Write barrier: a value moved from an unscanned global to a scanned
+    // one during marking must not be lost
+    CHECK(!object_is_marked(&moved->obj), "Global not reached yet");
+    vm.globals[0] = OBJ_VAL(moved);
+    vm_write_barrier(&vm, vm.globals[0]);
+    vm.globals[GLOBALS_MAX - 1] = BOOL_VAL(false);
+
+    ObjString* fresh = copy_string("fresh", 5);
+    CHECK(object_is_marked(&fresh->obj), "Objects allocated while marking start out black");
+
+    int slices = 1;
+    bool swept = false;
+    while (vm.gcPhase != GC_IDLE && slices < 100000) {
+        vm_collect_step(&vm);
+        if (vm.gcPhase == GC_SWEEP) swept = true;
+        slices++;
+    }
+    CHECK(slices > 2 && swept, "Cycle runs over many slices, marking then sweeping");
+    CHECK(vm.gcPhase == GC_IDLE, "Cycle completes");
+
+    // 3. Same result as a stop-the-world collection
+    CHECK(on_heap_list((Obj*)kept) && !object_is_marked(&kept->obj), "Rooted string survives, unmarked for the next cycle");
+    CHECK(on_heap_list((Obj*)moved), "Barrier kept the moved string alive");
+    CHECK(table_find_string(&vm.strings, "dead", 4, deadHash) == NULL, "Unreachable string is collected");
+
+    vm.globals[0] = BOOL_VAL(false);
+    pop();
+    free_vm();
+    set_gc_step_budget(GC_STEP_BUDGET_DEFAULT);
+}
+
+static void test_gc_pools() {
+    init_vm();
+
+    // 1. One block per string
+    ObjString* str = copy_string("pooled", 6);
+    CHECK(str->chars == (char*)(str + 1), "Characters are stored inline");
+    CHECK(strcmp(str->chars, "pooled") == 0, "Inline characters are NUL-terminated");
+    CHECK(vm.bytesAllocated >= string_object_size(6), "String block is accounted");
+
+    // 2. Swept blocks are reused by objects of the same size class
+    collect_garbage();
+    CHECK(vm.objects == NULL, "String collected");
+    ObjString* again = copy_string("pool2d", 6);
+#ifndef DETERMA_NO_POOLS
+    CHECK(again == str, "Freed block is recycled from its size class");
+#endif
+    CHECK(strcmp(again->chars, "pool2d") == 0, "Recycled block holds the new string");
+
+    // 3. Functions are pooled too, and accounted both ways
+    push(OBJ_VAL(again));
+    size_t before = vm.bytesAllocated;
+    new_function();
+    CHECK(vm.bytesAllocated > before, "Function block is accounted");
+    collect_garbage();
+    CHECK(vm.bytesAllocated == before, "Freeing a function gives its bytes back");
+
+    pop();
+    free_vm();
+}
+
+static void test_gc_stats() {
+    set_gc_tuning(3.0, 4096);
+    init_vm();
+    CHECK(vm.nextGC == 4096 && vm.gcStats.collections == 0, "Tuned first threshold, fresh counters");
+
+    ObjString* kept = copy_string("kept", 4);
+    push(OBJ_VAL(kept));
+    copy_string("garbage", 7);
+    size_t peak = vm.bytesAllocated;
+
+    uint64_t collections = vm.gcStats.collections;
+    uint64_t freed = vm.gcStats.objectsFreed;
+    uint64_t bytesFreed = vm.gcStats.bytesFreed;
+    collect_garbage();
+    CHECK(vm.gcStats.collections == collections + 1, "Collections are counted");
+    CHECK(vm.gcStats.objectsFreed == freed + 1, "Swept objects are counted");
+    CHECK(vm.gcStats.bytesFreed - bytesFreed == string_object_size(7), "Freed bytes are counted");
+    CHECK(vm.gcStats.peakBytesAllocated >= peak, "Peak heap is tracked");
+    CHECK(vm.gcStats.maxPauseNs <= vm.gcStats.totalPauseNs, "Max pause is one of the pauses");
+    CHECK(vm.nextGC == (size_t)(vm.bytesAllocated * 3.0), "Tuned grow factor sets the next threshold");
+
+    pop();
+    free_vm();
+    set_gc_tuning(GC_HEAP_GROW_FACTOR_DEFAULT, GC_INITIAL_THRESHOLD_DEFAULT);
+}
+
+static int heap_count(void) {
+    int count = 0;
+    for (Obj* object = vm.objects; object != NULL; object = object->next) count++;
+    return count;
+}
+
+static void test_gc_parallel_mark() {
+#ifdef DEBUG_STRESS_GC
+    // The heap below is built from unrooted objects and only holds still
+    // when collections are left to the explicit calls
+    return;
+#endif
+#ifdef DETERMA_NO_PARALLEL_GC
+    const uint64_t pooled = 0; // Built without parallel marking: every trace is serial
+#else
+    const uint64_t pooled = 1;
+#endif
+    set_gc_threads(4);
+    init_vm();
+    vm.nextGC = 1024 * 1024 * 1024; // Only the collection below runs
+
+    // 1. A heap wide enough to mark in parallel: globals holding functions
+    // whose constants are strings (some of them shared), plus garbage
+    char name[32];
+    ObjString* shared = copy_string("shared", 6);
+    vm.globals[0] = OBJ_VAL(shared);
+    vm_use_global(&vm, 3000);
+    for (int i = 1; i <= 3000; i++) {
+        ObjFunction* function = new_function();
+        vm.globals[i] = OBJ_VAL(function);
+        for (int k = 0; k < 4; k++) {
+            int length = snprintf(name, sizeof(name), "live%d.%d", i, k);
+            add_constant(&function->chunk, OBJ_VAL(copy_string(name, length)));
+        }
+        add_constant(&function->chunk, OBJ_VAL(shared));
+        add_constant(&function->chunk, INT_VAL(i));
+    }
+    for (int i = 0; i < 2000; i++) {
+        int length = snprintf(name, sizeof(name), "dead%d", i);
+        copy_string(name, length);
+    }
+    int live = 1 + 3000 * 5;
+    CHECK(heap_count() == live + 2000, "Heap holds the live and the dead objects");
+
+    // 2. Same result as a serial trace: exactly the garbage goes
+    uint64_t freed = vm.gcStats.objectsFreed;
+    collect_garbage();
+    CHECK(vm.gcStats.parallelMarks == pooled && (vm.gcPool != NULL) == (pooled > 0), "Full collection traced on the pool");
+    CHECK(vm.gcStats.objectsFreed - freed == 2000, "Every unreachable object is swept");
+    CHECK(heap_count() == live, "Every reachable object survives");
+    bool allWhite = true;
+    for (Obj* object = vm.objects; object != NULL; object = object->next) allWhite &= !object_is_marked(object);
+    CHECK(allWhite, "Survivors are unmarked for the next cycle");
+    ObjString* last = AS_STRING(AS_FUNCTION(vm.globals[3000])->chunk.constants.values[3]);
+    CHECK(copy_string("live3000.3", 10) == last, "Strings reached through constants stay interned");
+
+    // 3. Small heaps are traced serially
+    for (int i = 2000; i <= 3000; i++) vm.globals[i] = BOOL_VAL(false);
+    collect_garbage();
+    CHECK(vm.gcStats.parallelMarks == 2 * pooled, "Heap still wide enough for the pool");
+    for (int i = 2; i < 2000; i++) vm.globals[i] = BOOL_VAL(false);
+    collect_garbage();
+    CHECK(vm.gcStats.parallelMarks == 2 * pooled && heap_count() == 1 + 5, "Few gray objects: serial trace");
+
+    free_vm();
+    set_gc_threads(GC_THREADS_DEFAULT);
+}
+
+static void test_gc_lazy_sweep() {
+#ifdef DEBUG_STRESS_GC
+    // Stress builds collect (and sweep) on every allocation
+    return;
+#endif
+    init_vm();
+    ObjString* kept = copy_string("kept", 4);
+    push(OBJ_VAL(kept));
+    vm.nextGC = vm.bytesAllocated + 64 * 1024;
+
+    // 1. A collection started by an allocation marks, then leaves the sweep
+    char name[32];
+    int dead = 0;
+    while (vm.gcPhase == GC_IDLE && dead < 100000) {
+        int length = snprintf(name, sizeof(name), "dead%d", dead);
+        copy_string(name, length);
+        if (vm.gcPhase == GC_IDLE) dead++;
+    }
+    CHECK(vm.gcPhase == GC_SWEEP && vm.gcStats.collections == 0, "Allocation-started collection sweeps lazily");
+    CHECK(vm.gcStats.objectsFreed == 0, "Nothing is freed during the collection itself");
+    CHECK(object_is_marked(&kept->obj), "Rooted string is marked");
+#ifndef DETERMA_NO_POOLS
+    CHECK(kept->obj.isPooled && !kept->obj.isMarked, "Pooled mark bit lives in the slab bitmap, not the header");
+#endif
+
+    // 2. Later allocations sweep a batch each, until the cycle ends
+    int allocations = 0;
+    while (vm.gcPhase == GC_SWEEP && allocations < 100000) {
+        int length = snprintf(name, sizeof(name), "new%d", allocations++);
+        copy_string(name, length);
+    }
+    CHECK(vm.gcPhase == GC_IDLE && vm.gcStats.collections == 1, "Lazy sweep completes the collection");
+    CHECK(vm.gcStats.lazySweeps > 1 && allocations > 1, "Sweep is spread over several allocations");
+    CHECK(vm.gcStats.objectsFreed == (uint64_t)dead, "Exactly the garbage of the cycle is swept");
+    CHECK(on_heap_list((Obj*)kept) && !object_is_marked(&kept->obj), "Survivor is unmarked for the next cycle");
+    CHECK(vm.nextGC > vm.bytesAllocated, "Next threshold is set once the sweep is done");
+
+    pop();
+    free_vm();
+}
+
+static void test_gc_global_limit() {
+    init_vm();
+    CHECK(vm.globalLimit == compiler_global_count(), "A fresh VM covers the slots the compiler already bound");
+
+    // 1. Binding a name raises the limit; the slot is a root
+    int slot = compiler_define_global("gc_hw_slot", 10);
+    CHECK(slot >= 0 && vm.globalLimit == slot + 1, "Newly bound slot raises the limit");
+    ObjString* kept = copy_string("kept", 4);
+    vm.globals[slot] = OBJ_VAL(kept);
+
+    // 2. Slots past the limit are not scanned
+    ObjString* unseen = copy_string("unseen", 6);
+    uint32_t unseenHash = unseen->hash;
+    vm.globals[slot + 100] = OBJ_VAL(unseen);
+    collect_garbage();
+    CHECK(on_heap_list((Obj*)kept), "String in a bound slot survives");
+    CHECK(table_find_string(&vm.strings, "unseen", 6, unseenHash) == NULL, "Roots stop at the limit");
+    memset(&vm.globals[slot + 100], 0, sizeof(Value)); // free_vm() will not look there
+
+    free_vm();
+    CHECK(vm.globalLimit == 0, "free_vm() clears the used slots only and resets the limit");
+}
+
 // Global suite entry point
 void test_gc_suite() {
     run_test(test_gc_basics, "GC - Basic Collection (Sweep Garbage)");
     run_test(test_gc_preservation, "GC - Root Preservation (Mark & Sweep)");
+    run_test(test_gc_interning, "GC - String Interning (Weak Table)");
+    run_test(test_gc_nursery, "GC - Nursery (Young Strings)");
+    run_test(test_gc_ropes, "GC - Ropes (Lazy Concatenation)");
+    run_test(test_gc_incremental, "GC - Incremental Cycle (Write Barrier)");
+    run_test(test_gc_pools, "GC - Object Pools (Inline Strings)");
+    run_test(test_gc_stats, "GC - Telemetry and Tuning");
+    run_test(test_gc_parallel_mark, "GC - Parallel Mark (Work Stealing)");
+    run_test(test_gc_lazy_sweep, "GC - Lazy Sweep (Mark Bitmaps)");
+    run_test(test_gc_global_limit, "GC - Global Roots (High-Water Mark)");
 }
\ No newline at end of file
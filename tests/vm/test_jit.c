@@ -0,0 +1,210 @@
+/**
+ * @file test_jit.c
+ * @brief Unit tests for the baseline JIT: tiering and the interpreter fallback.
+ *
+ * Without a JIT in the build (jit_available() is false) the same programs
+ * run interpreted and must give the same results.
+ */
+
+#include "test_jit.h"
+#include "test.h"
+
+#include "vm/vm.h"
+#include "vm/object.h"
+#include "vm/compiler.h"
+#include "vm/jit.h"
+#include "parser.h"
+#include "typechecker.h"
+#include "ast.h"
+
+#include <string.h>
+
+/* -------------------------------------------------------------
+ * Helper: make `vm` a fresh VM that compiles hot functions
+ * ------------------------------------------------------------- */
+static void init_jit_vm() {
+    set_vm_jit(true);
+    init_vm();
+    set_vm_jit(false);
+}
+
+/* -------------------------------------------------------------
+ * Helper: compile `source` and run it on `vm`
+ * ------------------------------------------------------------- */
+static InterpretResult run_source(const char* source, ObjFunction** outFn) {
+    AstNode* ast = parse(source, 0);
+    CHECK(ast != NULL, "Parse must succeed");
+    CHECK(typecheck_ast(ast), "Typecheck must succeed");
+
+    ObjFunction* fn = compile_ast(ast);
+    CHECK(fn != NULL, "Compilation must succeed");
+    free_ast(ast);
+
+    *outFn = fn;
+    return fn != NULL ? interpret(fn) : INTERPRET_COMPILE_ERROR;
+}
+
+/* -------------------------------------------------------------
+ * Helper: look up a global slot by name
+ * ------------------------------------------------------------- */
+static Value global_named(const char* name) {
+    for (int i = 0; i < compiler_global_count(); i++) {
+        int length = 0;
+        const char* existing = compiler_global_name(i, &length);
+        if (length == (int)strlen(name) && memcmp(existing, name, length) == 0) {
+            return vm.globals[i];
+        }
+    }
+    return BOOL_VAL(false);
+}
+
+/* -------------------------------------------------------------
+ * Helper: the function constant of `script` named `name`
+ * ------------------------------------------------------------- */
+static ObjFunction* function_named(ObjFunction* script, const char* name) {
+    ValueArray* constants = &script->chunk.constants;
+    for (int i = 0; i < constants->count; i++) {
+        if (!IS_FUNCTION(constants->values[i])) continue;
+        ObjFunction* function = AS_FUNCTION(constants->values[i]);
+        if (function->name != NULL && strcmp(function->name->chars, name) == 0) return function;
+    }
+    return NULL;
+}
+
+
+/* -------------------------------------------------------------
+ * TEST 1: A hot function is compiled and still computes the same
+ * ------------------------------------------------------------- */
+static void test_jit_hot_function() {
+    ObjFunction* fn = NULL;
+    init_jit_vm();
+    InterpretResult result = run_source(
+        "func jt_step(n): int {"
+        "    var s = 0; var i = 0;"
+        "    while i < n { if i % 3 == 0 { s = s + i * 2; } else { s = s - 1; } i += 1; }"
+        "    return s / 2 + -n;"
+        "}"
+        "var jt_total = 0; var jt_k = 0;"
+        "while jt_k < 2000 { jt_total = jt_total + jt_step(jt_k % 20); jt_k += 1; }"
+        "func jt_fib(n): int { if n < 2 { return n; } return jt_fib(n - 1) + jt_fib(n - 2); }"
+        "var jt_f = jt_fib(20);",
+        &fn);
+    CHECK(result == INTERPRET_OK, "Program runs with the JIT");
+
+    Value total = global_named("jt_total");
+    Value f = global_named("jt_f");
+    CHECK(IS_INT(total) && AS_INT(total) == 12600, "Hot loop function gives the interpreter's result");
+    CHECK(IS_INT(f) && AS_INT(f) == 6765, "Recursive fib(20) is 6765");
+
+    ObjFunction* step = function_named(fn, "jt_step");
+    ObjFunction* fib = function_named(fn, "jt_fib");
+    CHECK(step != NULL && fib != NULL, "Functions are found");
+    if (step != NULL && fib != NULL) {
+        CHECK(!jit_available() || step->hotness >= JIT_HOT_THRESHOLD, "Calls and back-edges are counted");
+        CHECK((step->jit != NULL) == jit_available(), "Hot function has machine code where available");
+        CHECK((fib->jit != NULL) == jit_available(), "Hot recursive function has machine code where available");
+    }
+
+    free_vm();
+}
+
+
+/* -------------------------------------------------------------
+ * TEST 2: Values the templates don't handle fall back to the
+ * interpreter (strings, objects stored in globals)
+ * ------------------------------------------------------------- */
+static void test_jit_fallback() {
+    ObjFunction* fn = NULL;
+    init_jit_vm();
+    InterpretResult result = run_source(
+        "var jt_s = \"\";"
+        "func jt_mix(a, b): str {"
+        "    var n = 0;"
+        "    while n < 2 { n = n + 1; }"
+        "    jt_s = a + b;"
+        "    return jt_s;"
+        "}"
+        "var jt_i = 0;"
+        "while jt_i < 1500 { jt_mix(\"a\", \"b\"); jt_i += 1; }"
+        "var jt_last = jt_mix(\"x\", \"y\");",
+        &fn);
+    CHECK(result == INTERPRET_OK, "Program runs with the JIT");
+
+    Value s = global_named("jt_s");
+    Value last = global_named("jt_last");
+    CHECK(IS_STRING(s) && strcmp(AS_CSTRING(s), "xy") == 0, "String global is stored by the interpreter");
+    CHECK(IS_STRING(last) && strcmp(AS_CSTRING(last), "xy") == 0, "String result survives the fallback");
+
+    ObjFunction* mix = function_named(fn, "jt_mix");
+    CHECK(mix != NULL && (mix->jit != NULL) == jit_available(), "Function with strings is still compiled");
+
+    free_vm();
+}
+
+
+/* -------------------------------------------------------------
+ * TEST 3: Runtime errors in compiled code are reported by the
+ * interpreter
+ * ------------------------------------------------------------- */
+static void test_jit_runtime_errors() {
+    ObjFunction* fn = NULL;
+    init_jit_vm();
+    CHECK(run_source(
+              "func jt_div(a, b): int { return a / b + a % b; }"
+              "var jt_q = 0; var jt_j = 1;"
+              "while jt_j < 1500 { jt_q = jt_q + jt_div(3000, jt_j); jt_j += 1; }",
+              &fn) == INTERPRET_OK,
+          "Hot division runs");
+    ObjFunction* div = function_named(fn, "jt_div");
+    CHECK(div != NULL && (div->jit != NULL) == jit_available(), "Division function is compiled");
+
+    printf("  (Expect error below)\n");
+    CHECK(run_source("jt_q = jt_div(1, 0);", &fn) == INTERPRET_RUNTIME_ERROR,
+          "Division by zero in compiled code is a runtime error");
+
+    // The VM is usable after an error
+    CHECK(run_source("jt_q = jt_div(7, 2);", &fn) == INTERPRET_OK, "Next unit runs");
+    Value q = global_named("jt_q");
+    CHECK(IS_INT(q) && AS_INT(q) == 4, "Next unit computes 7 / 2 + 7 % 2");
+    free_vm();
+}
+
+
+/* -------------------------------------------------------------
+ * TEST 4: Loops switch to machine code mid-run (OSR): the
+ * top-level script and a function that is called only once
+ * ------------------------------------------------------------- */
+static void test_jit_loop_osr() {
+    ObjFunction* fn = NULL;
+    init_jit_vm();
+    InterpretResult result = run_source(
+        "func jt_once(n): int { var s = 0; var i = 0; while i < n { s = s + i % 5; i += 1; } return s; }"
+        "func jt_sq(x): int { return x * x; }"
+        "var jt_once_r = jt_once(5000);"
+        "var jt_sum = 0; var jt_m = 0;"
+        "while jt_m < 3000 { jt_sum = jt_sum + jt_sq(jt_m % 10); jt_m += 1; }",
+        &fn);
+    CHECK(result == INTERPRET_OK, "Program runs with the JIT");
+
+    Value once = global_named("jt_once_r");
+    Value sum = global_named("jt_sum");
+    CHECK(IS_INT(once) && AS_INT(once) == 10000, "Loop of a single call gives the interpreter's result");
+    CHECK(IS_INT(sum) && AS_INT(sum) == 85500, "Top-level loop with calls gives the interpreter's result");
+
+    ObjFunction* single = function_named(fn, "jt_once");
+    CHECK(single != NULL && (single->jit != NULL) == jit_available(), "Function called once is compiled by its loop");
+    CHECK((fn->jit != NULL) == jit_available(), "Top-level script is compiled by its loop");
+
+    free_vm();
+}
+
+
+/* -------------------------------------------------------------
+ * SUITE WRAPPER
+ * ------------------------------------------------------------- */
+void test_jit_suite() {
+    run_test(test_jit_hot_function,   "JIT - Hot Functions");
+    run_test(test_jit_fallback,       "JIT - Interpreter Fallback");
+    run_test(test_jit_runtime_errors, "JIT - Runtime Errors");
+    run_test(test_jit_loop_osr,       "JIT - Loop OSR");
+}
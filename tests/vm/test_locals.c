@@ -1,7 +1,12 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
 #include "test_locals.h"
 #include "test.h"
 #include "vm/vm.h"
 #include "vm/compiler.h"
+#include "vm/opcode.h"
 #include "parser.h"
 #include "typechecker.h"
 #include "ast.h"
@@ -60,3 +65,67 @@ void test_compiler_pop_scope() {
     run_snippet("{ var a = 1; }");
     CHECK(1, "Scope cleanup ran");
 }
+
+/**
+ * @brief Chunk contains opcode `op` at an instruction boundary
+ */
+static int chunk_has_op(const Chunk* chunk, uint8_t op) {
+    for (int offset = 0; offset < chunk->count; offset += opcode_length(chunk->code[offset])) {
+        if (chunk->code[offset] == op) return 1;
+    }
+    return 0;
+}
+
+void test_compiler_wide_operands() {
+    // 300 globals, 300 block locals and 600+ constants: all past the 1-byte operand range
+    enum { N = 300 };
+    size_t size = (size_t)N * 64 + 256;
+    char* src = (char*)malloc(size);
+    size_t len = 0;
+
+    for (int i = 0; i < N; i++) {
+        len += snprintf(src + len, size - len, "var wg%d = %d;", i, 1000 + i);
+    }
+    // Each local is read by the next one's initializer (unread locals get no slot)
+    len += snprintf(src + len, size - len, "{ var wl0 = 5000;");
+    for (int i = 1; i < N; i++) {
+        len += snprintf(src + len, size - len, "var wl%d = wl%d + 1;", i, i - 1);
+    }
+    len += snprintf(src + len, size - len, "wl299 = wl299 + wl1; wg299 = wl299; }");
+
+    AstNode* ast = parse(src, 0);
+    CHECK(ast != NULL, "Wide program parses");
+    CHECK(ast != NULL && typecheck_ast(ast), "Wide program typechecks");
+
+    init_vm();
+    ObjFunction* fn = ast ? compile_ast(ast) : NULL;
+    CHECK(fn != NULL, "More than 256 constants/globals/locals compile");
+
+    if (fn) {
+        Chunk* chunk = &fn->chunk;
+        CHECK(chunk_has_op(chunk, OP_CONSTANT), "Small constant indexes keep the 1-byte form");
+        CHECK(chunk_has_op(chunk, OP_CONSTANT_LONG), "Large constant indexes use OP_CONSTANT_LONG");
+        CHECK(chunk_has_op(chunk, OP_SET_GLOBAL_LONG), "Global index > 255 uses OP_SET_GLOBAL_LONG");
+        CHECK(chunk_has_op(chunk, OP_GET_LOCAL_LONG), "Local slot > 255 uses OP_GET_LOCAL_LONG");
+        CHECK(chunk_has_op(chunk, OP_SET_LOCAL_LONG), "Local slot > 255 uses OP_SET_LOCAL_LONG");
+
+        CHECK(interpret(fn) == INTERPRET_OK, "Wide program runs");
+
+        int index = -1;
+        for (int i = 0; i < compiler_global_count(); i++) {
+            int length;
+            const char* name = compiler_global_name(i, &length);
+            if (length == 5 && memcmp(name, "wg299", 5) == 0) index = i;
+        }
+        CHECK(index > 255, "wg299 lives past global slot 255");
+        CHECK(index >= 0 && IS_INT(vm.globals[index]) && AS_INT(vm.globals[index]) == 5299 + 5001,
+              "Wide locals and globals hold the right values");
+    }
+
+    free_ast(ast);
+    free_vm();
+    free(src);
+
+    // Later suites expect their globals in the 1-byte index range
+    free_global_symbols();
+}
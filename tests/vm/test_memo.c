@@ -0,0 +1,206 @@
+/**
+ * @file test_memo.c
+ * @brief Unit tests for pure-function memoization (memo.h, --memoize).
+ */
+
+#include <string.h>
+
+#include "test_memo.h"
+#include "test.h"
+
+#include "vm/vm.h"
+#include "vm/opcode.h"
+#include "vm/object.h"
+#include "vm/compiler.h"
+#include "vm/memo.h"
+#include "parser.h"
+#include "ast.h"
+
+/* -------------------------------------------------------------
+ * Helper: make `vm` a fresh VM that memoizes every unit
+ * ------------------------------------------------------------- */
+static void init_memo_vm() {
+    set_vm_memoize(true);
+    init_vm();
+    set_vm_memoize(false);
+}
+
+/* -------------------------------------------------------------
+ * Helper: compile `source` into the running VM, run it and return the
+ * global `mz_r` (each snippet stores its result there)
+ * ------------------------------------------------------------- */
+static Value run_unit(const char* source, ObjFunction** compiled, InterpretResult* result) {
+    AstNode* ast = parse(source, 0);
+    CHECK(ast != NULL, "Parse must succeed");
+
+    ObjFunction* fn = ast ? compile_ast(ast) : NULL;
+    CHECK(fn != NULL, "Compilation must succeed");
+    *compiled = fn;
+    *result = fn ? interpret(fn) : INTERPRET_COMPILE_ERROR;
+    if (ast) free_ast(ast);
+
+    for (int i = 0; i < compiler_global_count(); i++) {
+        int length = 0;
+        const char* name = compiler_global_name(i, &length);
+        if (length == 4 && memcmp(name, "mz_r", 4) == 0) return vm.globals[i];
+    }
+    return BOOL_VAL(false);
+}
+
+/* -------------------------------------------------------------
+ * Helper: the function constant of `script` named `name`
+ * ------------------------------------------------------------- */
+static ObjFunction* function_named(ObjFunction* script, const char* name) {
+    if (script == NULL) return NULL;
+    ValueArray* constants = &script->chunk.constants;
+    for (int i = 0; i < constants->count; i++) {
+        if (!IS_FUNCTION(constants->values[i])) continue;
+        ObjFunction* function = AS_FUNCTION(constants->values[i]);
+        if (function->name != NULL && strcmp(function->name->chars, name) == 0) return function;
+    }
+    return NULL;
+}
+
+/* -------------------------------------------------------------
+ * Helper: is `function` instrumented (OP_MEMO first, no plain return)?
+ * ------------------------------------------------------------- */
+static bool memoized(ObjFunction* function) {
+    Chunk* chunk = &function->chunk;
+    if (chunk->count == 0 || chunk->code[0] != OP_MEMO) return false;
+    for (int offset = 0; offset < chunk->count; offset += opcode_length(chunk->code[offset])) {
+        if (chunk->code[offset] == OP_RETURN) return false;
+    }
+    return true;
+}
+
+
+/* -------------------------------------------------------------
+ * TEST 1: A pure recursive function is memoized and computes the
+ * same result from its cache
+ * ------------------------------------------------------------- */
+static void test_memo_pure() {
+    ObjFunction* script = NULL;
+    InterpretResult result;
+    init_memo_vm();
+
+    Value v = run_unit(
+        "func mz_fib(n): int { if n <= 1 { return n; } return mz_fib(n - 1) + mz_fib(n - 2); }"
+        "func mz_even(n): bool { return n % 2 == 0; }"
+        "var mz_r = mz_fib(40); if mz_even(mz_r) { mz_r = mz_r + 1; }", &script, &result);
+    CHECK(result == INTERPRET_OK && IS_INT(v) && AS_INT(v) == 102334155, "Memoized fib(40) gives the plain result");
+    CHECK(!script || script->chunk.code[0] != OP_MEMO, "The script is not memoized");
+
+    ObjFunction* fib = function_named(script, "mz_fib");
+    ObjFunction* even = function_named(script, "mz_even");
+    CHECK(fib && memoized(fib) && fib->memoState == MEMO_PURE, "Pure recursion is instrumented");
+    CHECK(even && memoized(even), "Pure function of a bool result is instrumented");
+    CHECK(fib && fib->memo && fib->memo->misses == 41, "Each argument is computed once");
+    CHECK(fib && fib->memo && fib->memo->hits == 38, "Every other call is a cache hit");
+    CHECK(fib && get_line(&fib->chunk, 0) == get_line(&fib->chunk, 1), "OP_MEMO takes the first line");
+
+    // Calls from a later unit go through the global and still hit
+    v = run_unit("mz_r = mz_fib(30);", &script, &result);
+    CHECK(result == INTERPRET_OK && IS_INT(v) && AS_INT(v) == 832040, "A later unit reads the cache");
+    CHECK(fib && fib->memo && fib->memo->hits == 39, "The later call is one hit");
+
+    // Strings are not cached: the call runs as compiled
+    v = run_unit("func mz_len(s): int { return 3; } mz_r = mz_len(\"abc\") + mz_len(\"abc\");", &script, &result);
+    ObjFunction* len = function_named(script, "mz_len");
+    CHECK(result == INTERPRET_OK && IS_INT(v) && AS_INT(v) == 6, "String arguments run uncached");
+    CHECK(len && len->memo && len->memo->count == 0 && len->memo->hits == 0, "Nothing stored for a string key");
+    free_vm();
+}
+
+
+/* -------------------------------------------------------------
+ * TEST 2: Functions with effects, or that call such functions,
+ * run as compiled
+ * ------------------------------------------------------------- */
+static void test_memo_impure() {
+    ObjFunction* script = NULL;
+    InterpretResult result;
+    init_memo_vm();
+
+    Value v = run_unit(
+        "var mz_g = 1;"
+        "func mz_reads(n): int { return n + mz_g; }"
+        "func mz_writes(n): int { mz_g = mz_g + n; return n; }"
+        "func mz_prints(n): int { print n; return n; }"
+        "func mz_assigns(n): int { n = n + 1; return n; }"
+        "func mz_caller(n): int { return mz_reads(n) * 2; }"
+        "var mz_r = mz_reads(1) + mz_writes(2) + mz_caller(1) + mz_assigns(5);"
+        "mz_r = mz_r + mz_reads(1);", &script, &result);
+    // 2 + 2 (mz_g = 3) + 8 + 6, then + 4
+    CHECK(result == INTERPRET_OK && IS_INT(v) && AS_INT(v) == 22, "Impure functions see every change");
+
+    const char* names[] = { "mz_reads", "mz_writes", "mz_prints", "mz_assigns", "mz_caller" };
+    for (int i = 0; i < 5; i++) {
+        ObjFunction* function = function_named(script, names[i]);
+        CHECK(function && !memoized(function) && function->memoState == MEMO_IMPURE && function->memo == NULL,
+              "Impure function is left as compiled");
+    }
+    free_vm();
+}
+
+
+/* -------------------------------------------------------------
+ * TEST 3: Rebinding a callee in a later unit drops the table of
+ * every function whose results depended on it
+ * ------------------------------------------------------------- */
+static void test_memo_rebind() {
+    ObjFunction* script = NULL;
+    InterpretResult result;
+    init_memo_vm();
+
+    Value v = run_unit(
+        "func mz_base(n): int { return n + 1; }"
+        "func mz_mid(n): int { return mz_base(n) * 2; }"
+        "func mz_top(n): int { return mz_mid(n) + 1; }"
+        "var mz_r = mz_top(3) + mz_top(3);", &script, &result);
+    CHECK(result == INTERPRET_OK && IS_INT(v) && AS_INT(v) == 18, "Pure chain computes 2 * 9");
+
+    ObjFunction* top = function_named(script, "mz_top");
+    ObjFunction* mid = function_named(script, "mz_mid");
+    CHECK(top && memoized(top) && top->memo && top->memo->calleeCount == 2, "Transitive callees are recorded");
+    CHECK(top && top->memo && top->memo->hits == 1, "Second call is a hit");
+
+    v = run_unit("func mz_base(n): int { return n + 10; } mz_r = mz_top(3);", &script, &result);
+    CHECK(result == INTERPRET_OK && IS_INT(v) && AS_INT(v) == 27, "Rebound callee is not answered from the cache");
+    CHECK(top && top->memo == NULL && top->memoState == MEMO_IMPURE, "Dependent table is dropped");
+    CHECK(mid && mid->memo == NULL && mid->memoState == MEMO_IMPURE, "Every dependent table is dropped");
+
+    v = run_unit("mz_r = mz_top(4);", &script, &result);
+    CHECK(result == INTERPRET_OK && IS_INT(v) && AS_INT(v) == 29, "Dropped functions keep running");
+    free_vm();
+}
+
+
+/* -------------------------------------------------------------
+ * TEST 4: Each table stays within MEMO_ENTRIES_MAX
+ * ------------------------------------------------------------- */
+static void test_memo_bounded() {
+    ObjFunction* script = NULL;
+    InterpretResult result;
+    init_memo_vm();
+
+    Value v = run_unit(
+        "func mz_dbl(n): int { return n * 2; }"
+        "var mz_r = 0; var mz_i = 0;"
+        "while mz_i < 10000 { mz_r = mz_r + mz_dbl(mz_i % 5000); mz_i = mz_i + 1; }", &script, &result);
+    ObjFunction* dbl = function_named(script, "mz_dbl");
+    CHECK(result == INTERPRET_OK && IS_INT(v) && AS_INT(v) == 49990000, "Bounded table gives the plain result");
+    CHECK(dbl && dbl->memo && dbl->memo->count <= MEMO_ENTRIES_MAX, "Table holds at most MEMO_ENTRIES_MAX results");
+    CHECK(dbl && dbl->memo && dbl->memo->capacity <= 2 * MEMO_ENTRIES_MAX, "Table never grows past twice the limit");
+    free_vm();
+}
+
+
+/* -------------------------------------------------------------
+ * SUITE WRAPPER
+ * ------------------------------------------------------------- */
+void test_memo_suite() {
+    run_test(test_memo_pure,    "Memoize - Pure Functions");
+    run_test(test_memo_impure,  "Memoize - Impure Functions");
+    run_test(test_memo_rebind,  "Memoize - Rebound Callees");
+    run_test(test_memo_bounded, "Memoize - Size Limit");
+}
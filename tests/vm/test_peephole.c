@@ -0,0 +1,221 @@
+/**
+ * @file test_peephole.c
+ * @brief Unit tests for the superinstruction peephole pass.
+ */
+
+#include "test_peephole.h"
+#include "test.h"
+
+#include "vm/chunk.h"
+#include "vm/vm.h"
+#include "vm/opcode.h"
+#include "vm/object.h"
+#include "vm/compiler.h"
+#include "vm/peephole.h"
+#include "parser.h"
+#include "typechecker.h"
+#include "ast.h"
+
+/* -------------------------------------------------------------
+ * Helper: does `op` appear as an instruction in the chunk?
+ * ------------------------------------------------------------- */
+static int chunk_has_op(const Chunk* chunk, uint8_t op) {
+    for (int offset = 0; offset < chunk->count; offset += opcode_length(chunk->code[offset])) {
+        if (chunk->code[offset] == op) return 1;
+    }
+    return 0;
+}
+
+/* -------------------------------------------------------------
+ * Helper: compile + run a snippet whose first statement is
+ * `var <name> = ...;` and return that global's final value
+ * ------------------------------------------------------------- */
+static Value run_and_get_first_global(const char* source, ObjFunction** outFn) {
+    AstNode* ast = parse(source, 0);
+    CHECK(ast != NULL, "Parse must succeed");
+    CHECK(typecheck_ast(ast), "Typecheck must succeed");
+
+    init_vm();
+    ObjFunction* fn = compile_ast(ast);
+    CHECK(fn != NULL, "Compilation must succeed");
+
+    // [CONSTANT k] [SET_GLOBAL index] ...
+    int index = fn->chunk.code[3];
+    CHECK(interpret(fn) == INTERPRET_OK, "Program must run");
+
+    *outFn = fn;
+    free_ast(ast);
+    return vm.globals[index];
+}
+
+
+/* -------------------------------------------------------------
+ * TEST 1: Hand-written chunk, straight-line fusions
+ * ------------------------------------------------------------- */
+static void test_peephole_straight_line() {
+    init_vm();
+    Chunk chunk;
+    init_chunk(&chunk);
+
+    int k = add_constant(&chunk, INT_VAL(1));
+
+    write_chunk(&chunk, OP_GET_LOCAL, 1);   // 0
+    write_chunk(&chunk, 0, 1);
+    write_chunk(&chunk, OP_CONSTANT, 1);    // 2
+    write_chunk(&chunk, (uint8_t)k, 1);
+    write_chunk(&chunk, OP_ADD, 2);         // 4
+    write_chunk(&chunk, OP_GET_LOCAL, 3);   // 5
+    write_chunk(&chunk, 0, 3);
+    write_chunk(&chunk, OP_GREATER, 3);     // 7
+    write_chunk(&chunk, OP_NOT, 3);         // 8
+    write_chunk(&chunk, OP_RETURN, 4);      // 9
+
+    optimize_chunk(&chunk);
+
+    CHECK(chunk.count == 7, "10 bytes shrink to 7");
+    CHECK(chunk.code[0] == OP_ADD_LOCAL_CONST, "GET_LOCAL; CONSTANT; ADD -> ADD_LOCAL_CONST");
+    CHECK(chunk.code[1] == 0 && chunk.code[2] == k, "Fused operands are slot and constant");
+    CHECK(get_line(&chunk, 0) == 2, "Fused instruction keeps the line of the fallible op");
+    CHECK(chunk.code[3] == OP_GET_LOCAL, "GET_LOCAL is kept");
+    CHECK(chunk.code[5] == OP_LESS_EQUAL, "GREATER; NOT -> LESS_EQUAL");
+    CHECK(chunk.code[6] == OP_RETURN, "RETURN is kept");
+
+    free_chunk(&chunk);
+    free_vm();
+}
+
+
+/* -------------------------------------------------------------
+ * TEST 2: A jump target inside a pattern blocks the fusion
+ * ------------------------------------------------------------- */
+static void test_peephole_respects_jump_targets() {
+    init_vm();
+    Chunk chunk;
+    init_chunk(&chunk);
+
+    write_chunk(&chunk, OP_TRUE, 1);        // 0
+    write_chunk(&chunk, OP_JUMP, 1);        // 1 -> 5
+    write_chunk(&chunk, 0, 1);
+    write_chunk(&chunk, 1, 1);
+    write_chunk(&chunk, OP_EQUAL, 1);       // 4
+    write_chunk(&chunk, OP_NOT, 1);         // 5 (jump target)
+    write_chunk(&chunk, OP_RETURN, 1);      // 6
+
+    optimize_chunk(&chunk);
+
+    CHECK(chunk.count == 7, "Nothing fused");
+    CHECK(chunk.code[4] == OP_EQUAL && chunk.code[5] == OP_NOT, "EQUAL; NOT left alone");
+
+    free_chunk(&chunk);
+    free_vm();
+}
+
+
+/* -------------------------------------------------------------
+ * TEST 3: while loop, jumps are re-patched after shrinking
+ * ------------------------------------------------------------- */
+static void test_peephole_while_loop() {
+    ObjFunction* fn = NULL;
+    Value v = run_and_get_first_global(
+        "var ph_w = 0; var ph_n = 0;"
+        "while ph_w < 10 { ph_w = ph_w + 1; if ph_w != 5 { ph_n = ph_n + 1; } }",
+        &fn);
+
+    CHECK(IS_INT(v) && AS_INT(v) == 10, "Loop counts to 10");
+    CHECK(chunk_has_op(&fn->chunk, OP_JUMP_IF_FALSE_POP), "JUMP_IF_FALSE; POP fused");
+    CHECK(!chunk_has_op(&fn->chunk, OP_JUMP_IF_FALSE), "No unfused conditional jumps left");
+    CHECK(chunk_has_op(&fn->chunk, OP_NOT_EQUAL_INT), "!= fused to NOT_EQUAL_INT");
+    free_vm();
+}
+
+
+/* -------------------------------------------------------------
+ * TEST 4: if/elif/else chains keep their semantics
+ * ------------------------------------------------------------- */
+static void test_peephole_if_chain() {
+    ObjFunction* fn = NULL;
+    Value v = run_and_get_first_global(
+        "var ph_r = 0; var ph_x = 7;"
+        "if ph_x <= 3 { ph_r = 1; } elif ph_x >= 7 { ph_r = 2; } else { ph_r = 3; }",
+        &fn);
+
+    CHECK(IS_INT(v) && AS_INT(v) == 2, "elif branch taken");
+    CHECK(chunk_has_op(&fn->chunk, OP_LESS_EQUAL_INT), "<= fused");
+    CHECK(chunk_has_op(&fn->chunk, OP_GREATER_EQUAL_INT), ">= fused");
+    free_vm();
+}
+
+
+/* -------------------------------------------------------------
+ * TEST 5: while loop counters: compare-and-branch and in-place
+ * increments, for globals and locals
+ * ------------------------------------------------------------- */
+static void test_peephole_loop_counters() {
+    ObjFunction* fn = NULL;
+    Value v = run_and_get_first_global(
+        "var ph_c = 0; var ph_i = 0;"
+        "while ph_i <= 20 { ph_i = ph_i + 2; ph_c += 1; }"
+        "func ph_down(n): int { var k = n; var m = 0; while k > 0 { k = k + -3; m = m + 1; } return m; }"
+        "ph_c = ph_c * 100 + ph_down(10);",
+        &fn);
+
+    CHECK(IS_INT(v) && AS_INT(v) == 1104, "Loops count as before");
+    CHECK(chunk_has_op(&fn->chunk, OP_JUMP_IF_NOT_LESS_EQUAL), "<= ; JUMP_IF_FALSE ; POP fused to one branch");
+    CHECK(chunk_has_op(&fn->chunk, OP_INC_GLOBAL), "Global counter is incremented in place");
+    CHECK(!chunk_has_op(&fn->chunk, OP_ADD_CONST), "No separate add left in the loop");
+
+    ObjFunction* down = NULL;
+    for (int i = 0; i < fn->chunk.constants.count; i++) {
+        if (IS_FUNCTION(fn->chunk.constants.values[i])) down = AS_FUNCTION(fn->chunk.constants.values[i]);
+    }
+    CHECK(down != NULL, "Function is compiled");
+    if (down != NULL) {
+        CHECK(chunk_has_op(&down->chunk, OP_JUMP_IF_NOT_GREATER), "> ; JUMP_IF_FALSE ; POP fused to one branch");
+        CHECK(chunk_has_op(&down->chunk, OP_INC_LOCAL), "Local counter is incremented in place");
+    }
+    free_vm();
+}
+
+
+/* -------------------------------------------------------------
+ * TEST 6: unread locals take no slot and a scope's pops become
+ * one OP_POPN
+ * ------------------------------------------------------------- */
+static void test_peephole_unread_locals() {
+    ObjFunction* fn = NULL;
+    Value v = run_and_get_first_global(
+        "var ph_r = 0;"
+        "func ph_bump(): int { ph_r = ph_r + 1; return 0; }"
+        "{ var a = 1; var b = 2; var c = 3; var dead = a * 100; dead = 7; ph_r = a + b + c; }"
+        "{ var d = 10; var e = 20; var z = ph_bump(); ph_r = ph_r * 100 + d + e; }",
+        &fn);
+
+    CHECK(IS_INT(v) && AS_INT(v) == 730, "Unread locals still run their initializers");
+    CHECK(chunk_has_op(&fn->chunk, OP_POPN), "A scope's pops are one OP_POPN");
+    CHECK(!chunk_has_op(&fn->chunk, OP_SET_LOCAL), "Stores to an unread local are dropped");
+
+    // a, b, c then d, e in the same slots: `dead` and `z` have none
+    int maxSlot = -1;
+    for (int offset = 0; offset < fn->chunk.count; offset += opcode_length(fn->chunk.code[offset])) {
+        uint8_t op = fn->chunk.code[offset];
+        if (op == OP_GET_LOCAL || op == OP_ADD_LOCALS) {
+            if (fn->chunk.code[offset + 1] > maxSlot) maxSlot = fn->chunk.code[offset + 1];
+        }
+        if (op == OP_ADD_LOCALS && fn->chunk.code[offset + 2] > maxSlot) maxSlot = fn->chunk.code[offset + 2];
+    }
+    CHECK(maxSlot >= 0 && maxSlot <= 3, "Sibling scopes share their slots");
+    free_vm();
+}
+
+
+/* -------------------------------------------------------------
+ * SUITE WRAPPER
+ * ------------------------------------------------------------- */
+void test_peephole_suite() {
+    run_test(test_peephole_straight_line,         "Peephole - Straight-line fusions");
+    run_test(test_peephole_respects_jump_targets, "Peephole - Jump targets block fusion");
+    run_test(test_peephole_while_loop,            "Peephole - While loop jump fixups");
+    run_test(test_peephole_if_chain,              "Peephole - If/elif/else chain");
+    run_test(test_peephole_loop_counters,         "Peephole - While loop counters");
+    run_test(test_peephole_unread_locals,         "Peephole - Unread locals and OP_POPN");
+}
@@ -0,0 +1,222 @@
+/**
+ * @file test_perf.c
+ * @brief Performance regression tests: counted, not timed.
+ *
+ * Each test runs a canonical program and checks a deterministic counter
+ * against a budget: instructions dispatched by the stack VM, heap objects
+ * allocated, collections run, bytecode emitted. Wall-clock time varies from
+ * run to run; these counts only move when the compiler, the optimizer
+ * passes, the VM or the collector change what they do.
+ *
+ * A budget is the count when it was set, rounded up. A change that goes
+ * over it is a regression (or needs the budget raised on purpose); when an
+ * optimization brings a count well under it, lower the budget to match.
+ * Every count is printed, so the new figure is in the test output.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "test_perf.h"
+#include "test.h"
+
+#include "vm/vm.h"
+#include "vm/object.h"
+#include "vm/compiler.h"
+#include "vm/disassembler.h"
+#include "vm/trace.h"
+#include "parser.h"
+#include "typechecker.h"
+#include "ast.h"
+
+// --- Budgets ---
+
+#define PERF_FIB_INSTRUCTIONS 200000      // fib(20): 21891 calls
+#define PERF_FIB_CODE_INSTRUCTIONS 16     // fib's own bytecode
+#define PERF_MEMO_FIB_INSTRUCTIONS 400    // fib(25) with --memoize: 26 bodies run
+#define PERF_LOOP_INSTRUCTIONS 8100       // 1000 iterations of a counting loop
+#define PERF_STRING_ALLOCATIONS 520       // 500 appends to a string
+#define PERF_GC_MINOR_COLLECTIONS 52      // 4000 strings of 100-114 characters, built a bit at a time
+#ifdef DETERMA_COMPACT_VALUES
+#define PERF_GC_COLLECTIONS 110           // 2000 flattened 701-character strings (a smaller live heap, lower thresholds)
+#else
+#define PERF_GC_COLLECTIONS 80            // 2000 flattened 701-character strings
+#endif
+
+/* -------------------------------------------------------------
+ * Helper: a tracer that counts dispatched instructions and heap
+ * allocations
+ * ------------------------------------------------------------- */
+typedef struct {
+    long instructions;
+    long allocations;
+} PerfCounts;
+
+static void count_instruction(void* user, VM* vm, ObjFunction* function, int offset) {
+    (void)vm;
+    (void)function;
+    (void)offset;
+    ((PerfCounts*)user)->instructions++;
+}
+
+static void count_allocation(void* user, VM* vm, ObjType type, size_t size) {
+    (void)vm;
+    (void)type;
+    (void)size;
+    ((PerfCounts*)user)->allocations++;
+}
+
+/* -------------------------------------------------------------
+ * Helper: compile `source` into the running VM and run it with the
+ * counters on; returns the compiled script (NULL if it did not run)
+ * ------------------------------------------------------------- */
+static ObjFunction* run_counted(const char* source, PerfCounts* counts) {
+    memset(counts, 0, sizeof(*counts));
+    VmTracer tracer = {counts, count_instruction, NULL, NULL, NULL, NULL, count_allocation, NULL};
+
+    AstNode* ast = parse(source, 0);
+    CHECK(ast != NULL, "Parse must succeed");
+    if (ast == NULL) return NULL;
+    CHECK(typecheck_ast(ast), "Typecheck must succeed");
+
+    ObjFunction* fn = compile_ast(ast);
+    CHECK(fn != NULL, "Compilation must succeed");
+    vm_set_tracer(&vm, &tracer); // Compiling is not counted
+    InterpretResult result = fn != NULL ? interpret(fn) : INTERPRET_COMPILE_ERROR;
+    vm_set_tracer(&vm, NULL);
+    CHECK(result == INTERPRET_OK, "Program must run");
+    free_ast(ast);
+    return result == INTERPRET_OK ? fn : NULL;
+}
+
+/* -------------------------------------------------------------
+ * Helper: check `count` against `budget`, printing both
+ * ------------------------------------------------------------- */
+static void check_budget(const char* what, long count, long budget) {
+    printf("  %-40s %9ld (budget %ld)\n", what, count, budget);
+    CHECK(count <= budget, what);
+}
+
+/* -------------------------------------------------------------
+ * Helper: the function constant of `script` named `name`
+ * ------------------------------------------------------------- */
+static ObjFunction* function_named(ObjFunction* script, const char* name) {
+    if (script == NULL) return NULL;
+    ValueArray* constants = &script->chunk.constants;
+    for (int i = 0; i < constants->count; i++) {
+        if (!IS_FUNCTION(constants->values[i])) continue;
+        ObjFunction* function = AS_FUNCTION(constants->values[i]);
+        if (function->name != NULL && strcmp(function->name->chars, name) == 0) return function;
+    }
+    return NULL;
+}
+
+
+/* -------------------------------------------------------------
+ * TEST 1: Calls: recursive fib(20), and the code it compiles to
+ * ------------------------------------------------------------- */
+static void test_perf_fib() {
+    init_vm();
+    PerfCounts counts;
+    ObjFunction* script = run_counted(
+        "func pf_fib(n): int { if n < 2 { return n; } return pf_fib(n - 1) + pf_fib(n - 2); }"
+        "var pf_r = pf_fib(20);", &counts);
+    check_budget("fib(20) instructions", counts.instructions, PERF_FIB_INSTRUCTIONS);
+    check_budget("fib(20) allocations", counts.allocations, 0);
+
+    ObjFunction* fib = function_named(script, "pf_fib");
+    CHECK(fib != NULL, "fib is compiled");
+    if (fib != NULL) {
+        BytecodeStats stats;
+        memset(&stats, 0, sizeof(stats));
+        bytecode_stats(&fib->chunk, &stats);
+        check_budget("fib bytecode instructions", stats.instructions, PERF_FIB_CODE_INSTRUCTIONS);
+    }
+    free_vm();
+}
+
+/* -------------------------------------------------------------
+ * TEST 2: Memoized fib(25) runs each body once
+ * ------------------------------------------------------------- */
+static void test_perf_memo_fib() {
+    set_vm_memoize(true);
+    init_vm();
+    set_vm_memoize(false);
+
+    PerfCounts counts;
+    run_counted("func pf_mfib(n): int { if n < 2 { return n; } return pf_mfib(n - 1) + pf_mfib(n - 2); }"
+                "var pf_m = pf_mfib(25);", &counts);
+    check_budget("memoized fib(25) instructions", counts.instructions, PERF_MEMO_FIB_INSTRUCTIONS);
+    free_vm();
+}
+
+/* -------------------------------------------------------------
+ * TEST 3: A counting loop over locals
+ * ------------------------------------------------------------- */
+static void test_perf_loop() {
+    init_vm();
+    PerfCounts counts;
+    run_counted("var pf_sum = 0;"
+                "{ var i = 0; var total = 0; while i < 1000 { total = total + i; i = i + 1; } pf_sum = total; }",
+                &counts);
+    check_budget("1000-iteration loop instructions", counts.instructions, PERF_LOOP_INSTRUCTIONS);
+    check_budget("1000-iteration loop allocations", counts.allocations, 0);
+    free_vm();
+}
+
+/* -------------------------------------------------------------
+ * TEST 4: Appending to a string
+ * ------------------------------------------------------------- */
+static void test_perf_string_loop() {
+    init_vm();
+    PerfCounts counts;
+    run_counted("var pf_s = \"\"; var pf_i = 0;"
+                "while pf_i < 500 { pf_s = pf_s + \"x\"; pf_i = pf_i + 1; }", &counts);
+    check_budget("500 string appends allocations", counts.allocations, PERF_STRING_ALLOCATIONS);
+    free_vm();
+}
+
+/* -------------------------------------------------------------
+ * TEST 5: Collections for a steady stream of garbage
+ * ------------------------------------------------------------- */
+static void test_perf_gc_cycles() {
+    init_vm();
+    PerfCounts counts;
+    // pf_block is 100 characters. The first loop appends the bits of pf_k to
+    // it (distinct strings, so none is interned) in the nursery; the second
+    // flattens a 701-character rope on the old heap (== of equal lengths).
+    run_counted("var pf_block = \"0123456789\"; var pf_n = 0;"
+                "while pf_n < 2 { pf_block = pf_block + pf_block + pf_block + pf_block + pf_block; pf_n = pf_n + 1; }"
+                "pf_block = pf_block + pf_block;"
+                "var pf_k = 0; var pf_v = 0; var pf_t = \"\";"
+                "while pf_k < 4000 {"
+                "  pf_t = pf_block; pf_v = pf_k;"
+                "  while pf_v > 0 { if pf_v % 2 == 0 { pf_t = pf_t + \"0\"; } else { pf_t = pf_t + \"1\"; } pf_v = pf_v / 2; }"
+                "  pf_k = pf_k + 1;"
+                "}"
+                "var pf_u = pf_block + pf_block + pf_block + pf_block + pf_block + pf_block + pf_block + \"?\";"
+                "pf_k = 0;"
+                "while pf_k < 2000 {"
+                "  pf_t = pf_block + pf_block + pf_block + pf_block + pf_block + pf_block + pf_block + \"!\";"
+                "  pf_t == pf_u; pf_k = pf_k + 1;"
+                "}",
+                &counts);
+#ifndef DEBUG_STRESS_GC
+    // Stress builds collect on every allocation
+    check_budget("young strings: minor collections", (long)vm.gcStats.minorCollections, PERF_GC_MINOR_COLLECTIONS);
+    check_budget("old heap: full collections", (long)vm.gcStats.collections, PERF_GC_COLLECTIONS);
+#endif
+    free_vm();
+}
+
+
+/* -------------------------------------------------------------
+ * SUITE WRAPPER
+ * ------------------------------------------------------------- */
+void test_perf_suite() {
+    run_test(test_perf_fib,         "Perf - Recursive calls (fib)");
+    run_test(test_perf_memo_fib,    "Perf - Memoized calls");
+    run_test(test_perf_loop,        "Perf - Counting loop");
+    run_test(test_perf_string_loop, "Perf - String appends");
+    run_test(test_perf_gc_cycles,   "Perf - GC cycles");
+}
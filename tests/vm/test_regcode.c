@@ -0,0 +1,235 @@
+/**
+ * @file test_regcode.c
+ * @brief Unit tests for the register VM: translation and execution.
+ */
+
+#include "test_regcode.h"
+#include "test.h"
+
+#include "vm/vm.h"
+#include "vm/object.h"
+#include "vm/compiler.h"
+#include "vm/regcode.h"
+#include "vm/natives.h"
+#include "parser.h"
+#include "typechecker.h"
+#include "ast.h"
+
+#include <string.h>
+
+/* -------------------------------------------------------------
+ * Helper: make `vm` a fresh register VM
+ * ------------------------------------------------------------- */
+static void init_register_vm() {
+    set_vm_register_backend(true);
+    init_vm();
+    set_vm_register_backend(false);
+}
+
+/* -------------------------------------------------------------
+ * Helper: compile `source` and run it on `vm`
+ * ------------------------------------------------------------- */
+static InterpretResult run_source(const char* source, ObjFunction** outFn) {
+    AstNode* ast = parse(source, 0);
+    CHECK(ast != NULL, "Parse must succeed");
+    CHECK(typecheck_ast(ast), "Typecheck must succeed");
+
+    ObjFunction* fn = compile_ast(ast);
+    CHECK(fn != NULL, "Compilation must succeed");
+    free_ast(ast);
+
+    *outFn = fn;
+    return fn != NULL ? interpret(fn) : INTERPRET_COMPILE_ERROR;
+}
+
+/* -------------------------------------------------------------
+ * Helper: a native taking two ints
+ * ------------------------------------------------------------- */
+static bool rg_native_add(VM* machine, int argCount, Value* args, Value* result) {
+    (void)argCount;
+    if (!IS_INT(args[0]) || !IS_INT(args[1])) {
+        vm_runtime_error(machine, "rg_nadd() expects numbers.");
+        return false;
+    }
+    *result = INT_VAL(AS_INT(args[0]) + AS_INT(args[1]));
+    return true;
+}
+
+/* -------------------------------------------------------------
+ * Helper: look up a global slot by name
+ * ------------------------------------------------------------- */
+static Value global_named(const char* name) {
+    for (int i = 0; i < compiler_global_count(); i++) {
+        int length = 0;
+        const char* existing = compiler_global_name(i, &length);
+        if (length == (int)strlen(name) && memcmp(existing, name, length) == 0) {
+            return vm.globals[i];
+        }
+    }
+    return BOOL_VAL(false);
+}
+
+/* -------------------------------------------------------------
+ * Helper: the function constant of `script` named `name`
+ * ------------------------------------------------------------- */
+static ObjFunction* function_named(ObjFunction* script, const char* name) {
+    ValueArray* constants = &script->chunk.constants;
+    for (int i = 0; i < constants->count; i++) {
+        if (!IS_FUNCTION(constants->values[i])) continue;
+        ObjFunction* function = AS_FUNCTION(constants->values[i]);
+        if (function->name != NULL && strcmp(function->name->chars, name) == 0) return function;
+    }
+    return NULL;
+}
+
+/* -------------------------------------------------------------
+ * Helper: number of register instructions in `function`, and
+ * how many of them are `op`
+ * ------------------------------------------------------------- */
+static int count_reg_ops(const ObjFunction* function, uint8_t op, int* total) {
+    int matches = 0;
+    *total = 0;
+    const Chunk* chunk = &function->chunk;
+    for (int offset = 0; offset < chunk->count; offset += reg_opcode_length(chunk->code[offset])) {
+        if (chunk->code[offset] == op) matches++;
+        (*total)++;
+    }
+    return matches;
+}
+
+
+/* -------------------------------------------------------------
+ * TEST 1: Loops, arithmetic and strings give the stack VM's results
+ * ------------------------------------------------------------- */
+static void test_regcode_loops_and_strings() {
+    ObjFunction* fn = NULL;
+    init_register_vm();
+    InterpretResult result = run_source(
+        "var rg_sum = 0; var rg_i = 0;"
+        "while rg_i < 100 { rg_sum = rg_sum + rg_i; rg_i = rg_i + 1; }"
+        "var rg_s = \"\";"
+        "var rg_j = 0;"
+        "while rg_j < 3 { rg_s = rg_s + \"ab\"; rg_j += 1; }"
+        "var rg_mix = (7 * 6 - 2) / 3 % 7;"
+        "var rg_cmp = !(3 < 3) == !(2 == 3);",
+        &fn);
+    CHECK(result == INTERPRET_OK, "Program runs on the register VM");
+    CHECK(fn->registers > 0, "Script was translated");
+
+    Value sum = global_named("rg_sum");
+    Value s = global_named("rg_s");
+    Value mix = global_named("rg_mix");
+    Value cmp = global_named("rg_cmp");
+    CHECK(IS_INT(sum) && AS_INT(sum) == 4950, "Loop sum is 4950");
+    CHECK(IS_STRING(s) && strcmp(AS_CSTRING(s), "ababab") == 0, "Strings concatenate in a loop");
+    CHECK(IS_INT(mix) && AS_INT(mix) == 6, "Arithmetic matches the stack VM");
+    CHECK(IS_BOOL(cmp) && AS_BOOL(cmp), "Comparisons and logic match the stack VM");
+
+    free_vm();
+}
+
+
+/* -------------------------------------------------------------
+ * TEST 2: Local loads are forwarded, i = i + 1 is one instruction
+ * and compare + branch fuse
+ * ------------------------------------------------------------- */
+static void test_regcode_translation() {
+    ObjFunction* fn = NULL;
+    init_register_vm();
+    InterpretResult result = run_source(
+        "func rg_count(n): int {"
+        "    var i = 0; var s = 0;"
+        "    while i < n { s = s + i * 2; i = i + 1; }"
+        "    return s;"
+        "}"
+        "var rg_c = rg_count(10);",
+        &fn);
+    CHECK(result == INTERPRET_OK, "Program runs on the register VM");
+
+    Value c = global_named("rg_c");
+    CHECK(IS_INT(c) && AS_INT(c) == 90, "Function loop result is 90");
+
+    ObjFunction* count = function_named(fn, "rg_count");
+    CHECK(count != NULL && count->registers > 0, "Declared function was translated");
+    if (count != NULL) {
+        int total = 0;
+        CHECK(count_reg_ops(count, REG_ADDK, &total) == 1, "i = i + 1 is a single ADDK");
+        CHECK(count_reg_ops(count, REG_JUMP_IF_NOT_LESS, &total) == 1, "i < n fuses with its branch");
+        CHECK(count_reg_ops(count, REG_MOVE, &total) == 0, "Assignments write their locals directly");
+        CHECK(total <= 10, "Loop function is at most 10 register instructions");
+    }
+
+    free_vm();
+}
+
+
+/* -------------------------------------------------------------
+ * TEST 3: Calls: recursion, direct calls, tail calls and natives
+ * ------------------------------------------------------------- */
+static void test_regcode_calls() {
+    ObjFunction* fn = NULL;
+    init_register_vm();
+    CHECK(vm_define_native(&vm, "rg_nadd", 2, TYPE_INT, rg_native_add), "Native is registered");
+
+    InterpretResult result = run_source(
+        "func rg_fib(n): int { if n < 2 { return n; } return rg_fib(n - 1) + rg_fib(n - 2); }"
+        "var rg_f = rg_fib(15);"
+        "func rg_down(n, acc): int { if n == 0 { return acc; } return rg_down(n - 1, acc + 2); }"
+        "var rg_t = rg_down(100000, 0);"
+        "func rg_add3(a, b, c): int { return a + b * c; }"
+        "var rg_a = rg_add3(1, rg_add3(1, 2, 3), 4);"
+        "func rg_tail(n): int { return rg_nadd(n, 1); }"
+        "var rg_n = rg_nadd(40, 2) + rg_tail(1);",
+        &fn);
+    CHECK(result == INTERPRET_OK, "Program runs on the register VM");
+
+    Value f = global_named("rg_f");
+    Value t = global_named("rg_t");
+    Value a = global_named("rg_a");
+    Value n = global_named("rg_n");
+    CHECK(IS_INT(f) && AS_INT(f) == 610, "Recursive fib(15) is 610");
+    CHECK(IS_INT(t) && AS_INT(t) == 200000, "Tail calls run in constant frames");
+    CHECK(IS_INT(a) && AS_INT(a) == 29, "Nested calls keep their arguments apart");
+    CHECK(IS_INT(n) && AS_INT(n) == 44, "Natives run in place, also in tail position");
+    CHECK(vm.frameCount == 0, "No frame is left behind");
+
+    printf("  (Expect error below)\n");
+    CHECK(run_source("rg_n = rg_nadd(1, \"x\");", &fn) == INTERPRET_RUNTIME_ERROR,
+          "Native can report a runtime error");
+
+    free_vm();
+}
+
+
+/* -------------------------------------------------------------
+ * TEST 4: Runtime errors are reported as on the stack VM
+ * ------------------------------------------------------------- */
+static void test_regcode_runtime_errors() {
+    ObjFunction* fn = NULL;
+    init_register_vm();
+    printf("  (Expect error below)\n");
+    CHECK(run_source("var rg_z = 0; var rg_q = 10 / rg_z;", &fn) == INTERPRET_RUNTIME_ERROR,
+          "Division by zero is a runtime error");
+
+    printf("  (Expect error below)\n");
+    CHECK(run_source("func rg_deep(n): int { return 1 + rg_deep(n + 1); } var rg_d = rg_deep(0);", &fn)
+              == INTERPRET_RUNTIME_ERROR,
+          "Unbounded recursion is a stack overflow");
+
+    // The VM is usable after an error
+    CHECK(run_source("rg_z = 5; rg_q = 10 / rg_z;", &fn) == INTERPRET_OK, "Next unit runs");
+    Value q = global_named("rg_q");
+    CHECK(IS_INT(q) && AS_INT(q) == 2, "Next unit computes 10 / 5");
+    free_vm();
+}
+
+
+/* -------------------------------------------------------------
+ * SUITE WRAPPER
+ * ------------------------------------------------------------- */
+void test_regcode_suite() {
+    run_test(test_regcode_loops_and_strings, "Register VM - Loops and Strings");
+    run_test(test_regcode_translation,       "Register VM - Translation");
+    run_test(test_regcode_calls,             "Register VM - Calls");
+    run_test(test_regcode_runtime_errors,    "Register VM - Runtime Errors");
+}
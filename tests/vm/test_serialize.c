@@ -0,0 +1,291 @@
+/**
+ * @file test_serialize.c
+ * @brief Unit tests for the .detc bytecode cache (write, load, reject)
+ * and heap snapshots.
+ */
+
+#include "test_serialize.h"
+#include "test.h"
+
+#include "vm/vm.h"
+#include "vm/object.h"
+#include "vm/compiler.h"
+#include "vm/serialize.h"
+#include "parser.h"
+#include "typechecker.h"
+#include "ast.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define CACHE_PATH "bin/test_serialize.detc"
+#define SNAPSHOT_PATH "bin/test_serialize.dets"
+
+static const char* SOURCE =
+    "func sz_sq(n): int { return n * n; }"
+    "var sz_r = sz_sq(7);"
+    "func sz_fact(n): int { if n < 2 { return 1; } return n * sz_fact(n - 1); }"
+    "var sz_f = sz_fact(5);"
+    "var sz_s = \"ab\" + \"cd\";"
+    "var sz_b = 7 > 3;";
+
+/* -------------------------------------------------------------
+ * Helper: compile SOURCE and write it to CACHE_PATH
+ * ------------------------------------------------------------- */
+static ObjFunction* compile_and_cache(uint32_t flags) {
+    int priorGlobals = compiler_global_count();
+    AstNode* ast = parse(SOURCE, 0);
+    CHECK(ast != NULL, "Parse must succeed");
+    CHECK(typecheck_ast(ast), "Typecheck must succeed");
+
+    ObjFunction* fn = compile_ast(ast);
+    CHECK(fn != NULL, "Compilation must succeed");
+    free_ast(ast);
+
+    CHECK(write_bytecode_cache(CACHE_PATH, fn, priorGlobals, hash_source(SOURCE, strlen(SOURCE)), flags),
+          "Cache file is written");
+    return fn;
+}
+
+/* -------------------------------------------------------------
+ * Helper: look up a global slot by name
+ * ------------------------------------------------------------- */
+static Value global_named(const char* name) {
+    for (int i = 0; i < compiler_global_count(); i++) {
+        int length = 0;
+        const char* existing = compiler_global_name(i, &length);
+        if (length == (int)strlen(name) && memcmp(existing, name, length) == 0) {
+            return vm.globals[i];
+        }
+    }
+    return BOOL_VAL(false);
+}
+
+
+/* -------------------------------------------------------------
+ * TEST 1: A loaded cache has the same code and runs the same
+ * ------------------------------------------------------------- */
+static void test_serialize_round_trip() {
+    init_vm();
+    ObjFunction* original = compile_and_cache(0);
+    push(OBJ_VAL(original)); // Keep it alive while the cache is decoded
+
+    ObjFunction* loaded = load_bytecode_cache(CACHE_PATH, hash_source(SOURCE, strlen(SOURCE)), 0);
+    CHECK(loaded != NULL, "Matching cache loads");
+    CHECK(loaded != original, "Loaded function is a fresh object");
+    CHECK(loaded->chunk.count == original->chunk.count &&
+          memcmp(loaded->chunk.code, original->chunk.code, original->chunk.count) == 0,
+          "Bytecode is identical");
+    CHECK(loaded->chunk.lineCount == original->chunk.lineCount &&
+          memcmp(loaded->chunk.lines, original->chunk.lines,
+                 sizeof(LineStart) * original->chunk.lineCount) == 0, "Line table is identical");
+    CHECK(loaded->chunk.constants.count == original->chunk.constants.count,
+          "Constant pool has the same size");
+    pop();
+
+    CHECK(interpret(loaded) == INTERPRET_OK, "Cached script runs");
+
+    Value r = global_named("sz_r");
+    Value s = global_named("sz_s");
+    Value b = global_named("sz_b");
+    Value f = global_named("sz_f");
+    CHECK(IS_INT(r) && AS_INT(r) == 49, "Nested function survived the round trip");
+    CHECK(IS_INT(f) && AS_INT(f) == 120, "Self-referencing direct call survived the round trip");
+    CHECK(IS_STRING(s) && strcmp(AS_CSTRING(s), "abcd") == 0, "String constants survived");
+    CHECK(IS_BOOL(b) && AS_BOOL(b), "Bool result is correct");
+
+    free_vm();
+    remove(CACHE_PATH);
+}
+
+
+/* -------------------------------------------------------------
+ * TEST 2: Stale keys and damaged files are refused
+ * ------------------------------------------------------------- */
+static void test_serialize_rejects_mismatch() {
+    init_vm();
+    compile_and_cache(1);
+    uint64_t hash = hash_source(SOURCE, strlen(SOURCE));
+
+    CHECK(load_bytecode_cache(CACHE_PATH, hash + 1, 1) == NULL, "Different source hash is ignored");
+    CHECK(load_bytecode_cache(CACHE_PATH, hash, 0) == NULL, "Different opt level is ignored");
+    CHECK(load_bytecode_cache("bin/does_not_exist.detc", hash, 1) == NULL, "Missing cache is ignored");
+
+    // Flip one byte in the body
+    FILE* file = fopen(CACHE_PATH, "r+b");
+    CHECK(file != NULL, "Cache can be reopened");
+    if (file != NULL) {
+        fseek(file, -3, SEEK_END);
+        int c = fgetc(file);
+        fseek(file, -3, SEEK_END);
+        fputc(c ^ 0x5a, file);
+        fclose(file);
+    }
+    CHECK(load_bytecode_cache(CACHE_PATH, hash, 1) == NULL, "Corrupted cache is ignored");
+
+    // Truncate it to just the magic
+    file = fopen(CACHE_PATH, "wb");
+    if (file != NULL) {
+        fputs("DETC", file);
+        fclose(file);
+    }
+    CHECK(load_bytecode_cache(CACHE_PATH, hash, 1) == NULL, "Truncated cache is ignored");
+
+    free_vm();
+    remove(CACHE_PATH);
+}
+
+
+/* -------------------------------------------------------------
+ * Helper: check, compile and run one unit on the current VM
+ * ------------------------------------------------------------- */
+static bool run_unit(const char* source) {
+    AstNode* ast = parse(source, 0);
+    CHECK(ast != NULL, "Parse must succeed");
+    bool checked = ast != NULL && typecheck_ast(ast);
+    ObjFunction* fn = checked ? compile_ast(ast) : NULL;
+    if (ast != NULL) free_ast(ast);
+    return fn != NULL && interpret(fn) == INTERPRET_OK;
+}
+
+/* -------------------------------------------------------------
+ * Helper: a VM and front end with no globals, as a new process has
+ * ------------------------------------------------------------- */
+static void fresh_session(void) {
+    free_typechecker();
+    free_global_symbols();
+    init_typechecker();
+    init_vm();
+}
+
+
+/* -------------------------------------------------------------
+ * TEST 3: A snapshot brings back the globals, their objects and
+ * their types, without running the prelude again
+ * ------------------------------------------------------------- */
+static void test_serialize_heap_snapshot() {
+    fresh_session();
+    CHECK(run_unit("var sn_n = 40; var sn_s = \"pre\" + \"lude\"; var sn_b = true;"
+                   "func sn_sq(n): int { return n * n; }"
+                   "func sn_bump(): int { sn_n = sn_n + 1; return sn_n; }"
+                   "sn_n = sn_n + sn_sq(1);"),
+          "Prelude runs");
+    CHECK(write_heap_snapshot(SNAPSHOT_PATH, &vm), "Snapshot is written");
+    int globalCount = compiler_global_count();
+    free_vm();
+
+    fresh_session();
+    ObjFunction* unit = load_heap_snapshot(SNAPSHOT_PATH, &vm);
+    CHECK(unit != NULL, "Snapshot loads");
+    CHECK(unit != NULL && interpret(unit) == INTERPRET_OK, "Its unit runs");
+    CHECK(compiler_global_count() == globalCount, "Every global slot is bound again");
+
+    Value n = global_named("sn_n");
+    Value s = global_named("sn_s");
+    Value b = global_named("sn_b");
+    CHECK(IS_INT(n) && AS_INT(n) == 41, "Ints keep the value the prelude left");
+    CHECK(IS_STRING(s) && strcmp(AS_CSTRING(s), "prelude") == 0, "Strings come back");
+    CHECK(IS_BOOL(b) && AS_BOOL(b), "Bools come back");
+
+    // The next unit calls the functions and is typechecked against the globals
+    CHECK(run_unit("var sn_r = sn_sq(sn_bump()) + sn_n;"), "Code after the snapshot runs");
+    Value r = global_named("sn_r");
+    CHECK(IS_INT(r) && AS_INT(r) == 42 * 42 + 42, "Restored functions see the restored globals");
+    printf("  (Expect error below)\n");
+    CHECK(!run_unit("sn_s = 1;"), "Restored globals keep their declared types");
+    free_vm();
+
+    // Flip one byte in the body
+    FILE* file = fopen(SNAPSHOT_PATH, "r+b");
+    CHECK(file != NULL, "Snapshot can be reopened");
+    if (file != NULL) {
+        fseek(file, -3, SEEK_END);
+        int c = fgetc(file);
+        fseek(file, -3, SEEK_END);
+        fputc(c ^ 0x5a, file);
+        fclose(file);
+    }
+    fresh_session();
+    CHECK(load_heap_snapshot(SNAPSHOT_PATH, &vm) == NULL, "Corrupted snapshot is refused");
+    CHECK(compiler_global_count() == 0, "A refused snapshot binds nothing");
+    CHECK(load_heap_snapshot("bin/does_not_exist.dets", &vm) == NULL, "Missing snapshot is refused");
+    free_vm();
+    remove(SNAPSHOT_PATH);
+
+    fresh_session(); // Later suites start without these globals
+}
+
+
+/* -------------------------------------------------------------
+ * Helper: check, compile, cache (to CACHE_PATH) and run one unit
+ * ------------------------------------------------------------- */
+static bool cache_unit(const char* source) {
+    int priorGlobals = compiler_global_count();
+    AstNode* ast = parse(source, 0);
+    CHECK(ast != NULL, "Parse must succeed");
+    bool checked = ast != NULL && typecheck_ast(ast);
+    ObjFunction* fn = checked ? compile_ast(ast) : NULL;
+    if (ast != NULL) free_ast(ast);
+    if (fn == NULL) return false;
+    CHECK(write_bytecode_cache(CACHE_PATH, fn, priorGlobals, hash_source(source, strlen(source)), 0),
+          "Cache file is written");
+    return interpret(fn) == INTERPRET_OK;
+}
+
+/* -------------------------------------------------------------
+ * TEST 4: A cache hit keeps the types a snapshot needs, and a unit
+ * cached on top of a snapshot is only reused with it
+ * ------------------------------------------------------------- */
+static void test_serialize_cache_and_snapshot() {
+    const char* prelude = "var sc_base = 10; var sc_name = \"x\";";
+    const char* script = "var sc_m = sc_base * 2;";
+
+    // 1. Run the prelude from its cache, then snapshot it
+    fresh_session();
+    CHECK(cache_unit(prelude), "Prelude runs");
+    free_vm();
+    fresh_session();
+    ObjFunction* cached = load_bytecode_cache(CACHE_PATH, hash_source(prelude, strlen(prelude)), 0);
+    CHECK(cached != NULL, "Cached prelude loads");
+    CHECK(cached != NULL && interpret(cached) == INTERPRET_OK, "Cached prelude runs");
+    CHECK(write_heap_snapshot(SNAPSHOT_PATH, &vm), "Snapshot of the cached run is written");
+    free_vm();
+
+    fresh_session();
+    ObjFunction* unit = load_heap_snapshot(SNAPSHOT_PATH, &vm);
+    CHECK(unit != NULL && interpret(unit) == INTERPRET_OK, "Snapshot loads and its unit runs");
+
+    // 2. A unit checked against the snapshot's globals (and only those)
+    CHECK(cache_unit(script), "Script runs on the snapshot");
+    CHECK(run_unit("var sc_r = sc_base + 1; var sc_t = sc_name + \"y\";"),
+          "Globals of a cached run keep their types in the snapshot");
+    free_vm();
+    fresh_session();
+    CHECK(load_bytecode_cache(CACHE_PATH, hash_source(script, strlen(script)), 0) == NULL,
+          "Its cache is ignored without the snapshot");
+    free_vm();
+
+    fresh_session();
+    unit = load_heap_snapshot(SNAPSHOT_PATH, &vm);
+    CHECK(unit != NULL && interpret(unit) == INTERPRET_OK, "Snapshot loads again");
+    cached = load_bytecode_cache(CACHE_PATH, hash_source(script, strlen(script)), 0);
+    CHECK(cached != NULL && interpret(cached) == INTERPRET_OK, "Its cache is used with the snapshot");
+    Value m = global_named("sc_m");
+    CHECK(IS_INT(m) && AS_INT(m) == 20, "Cached script sees the snapshot's globals");
+    free_vm();
+    remove(CACHE_PATH);
+    remove(SNAPSHOT_PATH);
+
+    fresh_session(); // Later suites start without these globals
+}
+
+
+/* -------------------------------------------------------------
+ * SUITE WRAPPER
+ * ------------------------------------------------------------- */
+void test_serialize_suite() {
+    run_test(test_serialize_round_trip,       "Bytecode cache - Round trip");
+    run_test(test_serialize_rejects_mismatch, "Bytecode cache - Stale or damaged files");
+    run_test(test_serialize_heap_snapshot,    "Heap snapshot - Save and restore globals");
+    run_test(test_serialize_cache_and_snapshot, "Heap snapshot - With the bytecode cache");
+}
@@ -0,0 +1,232 @@
+/**
+ * @file test_threads.c
+ * @brief Unit tests for the work-stealing thread pool, for compiling and
+ * running scripts on several threads at once (--batch) and for parsing a
+ * multi-file program's files in parallel.
+ */
+
+#include "test_threads.h"
+#include "test.h"
+
+#include "thread_pool.h"
+#include "parser.h"
+#include "typechecker.h"
+#include "ast.h"
+#include "arena.h"
+#include "vm/vm.h"
+#include "vm/compiler.h"
+#include "vm/natives.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define POOL_TASKS 1000
+#define POOL_WORKERS 4
+#define SCRIPT_COUNT 16
+
+typedef struct {
+    int runs[POOL_TASKS];
+    int workerOf[POOL_TASKS];
+    int stolen;             // Set (atomically) once another worker runs worker 0's share
+} PoolCounts;
+
+/* -------------------------------------------------------------
+ * Helper: count the run. Task 0 (worker 0's first) holds its
+ * worker until someone steals the rest of its share, or 2 s pass
+ * ------------------------------------------------------------- */
+static void count_task(void* context, int index, int worker) {
+    PoolCounts* counts = (PoolCounts*)context;
+    counts->runs[index]++;
+    counts->workerOf[index] = worker;
+
+    if (index > 0 && index < POOL_TASKS / POOL_WORKERS && worker != 0) {
+        __atomic_store_n(&counts->stolen, 1, __ATOMIC_RELEASE);
+    }
+    if (index == 0) {
+        clock_t deadline = clock() + 2 * CLOCKS_PER_SEC;
+        while (!__atomic_load_n(&counts->stolen, __ATOMIC_ACQUIRE) && clock() < deadline) {}
+    }
+}
+
+typedef struct {
+    char source[160];
+    char* output;
+    size_t outputLength;
+    InterpretResult result;
+} ThreadScript;
+
+/* -------------------------------------------------------------
+ * Helper: compile and run one script on a VM of its own,
+ * capturing what it prints (as --batch does)
+ * ------------------------------------------------------------- */
+static void script_task(void* context, int index, int worker) {
+    (void)worker;
+    ThreadScript* script = &((ThreadScript*)context)[index];
+
+    VM* machine = new_vm();
+    VM* previous = use_vm(machine);
+    machine->output.sink = NULL;
+    init_typechecker();
+    init_compiler();
+    vm_define_core_natives(machine);
+
+    script->result = INTERPRET_COMPILE_ERROR;
+    AstNode* ast = parse(script->source, 0);
+    if (ast != NULL && typecheck_ast(ast)) {
+        ObjFunction* fn = compile_ast(ast);
+        if (fn != NULL) script->result = interpret(fn);
+    }
+    if (ast != NULL) free_ast(ast);
+    script->output = output_take(&machine->output, &script->outputLength);
+
+    free_typechecker();
+    free_global_symbols();
+    destroy_vm(machine);
+    use_vm(previous);
+}
+
+
+/* -------------------------------------------------------------
+ * TEST 1: Every index runs exactly once, and idle workers steal
+ * the work queued behind a long task
+ * ------------------------------------------------------------- */
+static void test_pool_runs_all() {
+    ThreadPool* pool = thread_pool_new(POOL_WORKERS);
+    CHECK(pool != NULL && thread_pool_size(pool) == POOL_WORKERS, "Pool starts its workers");
+    if (pool == NULL) return;
+
+    PoolCounts* counts = (PoolCounts*)calloc(1, sizeof(PoolCounts));
+    thread_pool_run(pool, POOL_TASKS, count_task, counts);
+
+    bool once = true;
+    for (int i = 0; i < POOL_TASKS; i++) once = once && counts->runs[i] == 1;
+    CHECK(once, "Every index runs exactly once");
+    CHECK(counts->stolen, "Other workers take over the share of a busy worker");
+
+    // The pool is reusable, and an empty run returns at once
+    memset(counts->runs, 0, sizeof(counts->runs));
+    thread_pool_run(pool, 3, count_task, counts);
+    thread_pool_run(pool, 0, count_task, counts);
+    CHECK(counts->runs[0] == 1 && counts->runs[1] == 1 && counts->runs[2] == 1 && counts->runs[3] == 0,
+          "A second run covers just its own indices");
+
+    free(counts);
+    thread_pool_free(pool);
+
+    // A pool of one runs everything on the caller
+    pool = thread_pool_new(1);
+    counts = (PoolCounts*)calloc(1, sizeof(PoolCounts));
+    thread_pool_run(pool, 10, count_task, counts);
+    bool caller = true;
+    for (int i = 0; i < 10; i++) caller = caller && counts->runs[i] == 1 && counts->workerOf[i] == 0;
+    CHECK(caller, "A one-worker pool runs on the calling thread");
+    free(counts);
+    thread_pool_free(pool);
+}
+
+
+/* -------------------------------------------------------------
+ * TEST 2: Scripts compile and run on several threads at once,
+ * each with its own VM, globals and output
+ * ------------------------------------------------------------- */
+static void test_pool_scripts() {
+    ThreadScript* scripts = (ThreadScript*)calloc(SCRIPT_COUNT, sizeof(ThreadScript));
+    for (int i = 0; i < SCRIPT_COUNT; i++) {
+        // Every script declares the same names, with its own values
+        snprintf(scripts[i].source, sizeof(scripts[i].source),
+                 "func th_f(n): int { if n < 2 { return n; } return th_f(n - 1) + th_f(n - 2); }"
+                 "var th_x = %d; print th_x; print th_f(%d);", i, 10 + i % 5);
+    }
+
+    ThreadPool* pool = thread_pool_new(POOL_WORKERS);
+    CHECK(pool != NULL, "Pool starts");
+    if (pool == NULL) {
+        free(scripts);
+        return;
+    }
+    thread_pool_run(pool, SCRIPT_COUNT, script_task, scripts);
+    thread_pool_free(pool);
+
+    static const int fib[] = { 55, 89, 144, 233, 377 };
+    bool ok = true;
+    for (int i = 0; i < SCRIPT_COUNT; i++) {
+        char expected[32];
+        int length = snprintf(expected, sizeof(expected), "%d\n%d\n", i, fib[i % 5]);
+        ok = ok && scripts[i].result == INTERPRET_OK && scripts[i].output != NULL &&
+             scripts[i].outputLength == (size_t)length && memcmp(scripts[i].output, expected, length) == 0;
+        free(scripts[i].output);
+    }
+    CHECK(ok, "Every script prints its own results");
+    CHECK(currentVM == &vm, "The caller's current VM is untouched");
+    free(scripts);
+}
+
+
+typedef struct {
+    const char* source;
+    Arena arena;
+    AstNode* ast;
+} ParsedUnit;
+
+/* -------------------------------------------------------------
+ * Helper: parse one unit into its own arena (no VM involved)
+ * ------------------------------------------------------------- */
+static void parse_task(void* context, int index, int worker) {
+    (void)worker;
+    ParsedUnit* unit = &((ParsedUnit*)context)[index];
+    unit->ast = parse_in_arena(unit->source, 0, &unit->arena);
+}
+
+
+/* -------------------------------------------------------------
+ * TEST 3: Units parsed on worker threads are checked, compiled
+ * and run in order on the main thread (a multi-file program)
+ * ------------------------------------------------------------- */
+static void test_pool_parallel_parse() {
+    ParsedUnit units[] = {
+        { "var pp_a = 6; func pp_sq(n): int { return n * n; }", {0}, NULL },
+        { "var pp_b = pp_sq(pp_a) + 1;", {0}, NULL },
+        { "var pp_s = \"n\"; pp_s = pp_s + \"=\";", {0}, NULL },
+        { "pp_b = pp_b * 2;", {0}, NULL },
+    };
+    int count = (int)(sizeof(units) / sizeof(units[0]));
+    for (int i = 0; i < count; i++) arena_init(&units[i].arena);
+
+    ThreadPool* pool = thread_pool_new(POOL_WORKERS);
+    CHECK(pool != NULL, "Pool starts");
+    if (pool == NULL) return;
+    thread_pool_run(pool, count, parse_task, units);
+    thread_pool_free(pool);
+
+    init_vm();
+    bool ok = true;
+    for (int i = 0; i < count; i++) {
+        ok = ok && units[i].ast != NULL && typecheck_ast(units[i].ast);
+        ObjFunction* fn = ok ? compile_ast(units[i].ast) : NULL;
+        ok = ok && fn != NULL && interpret(fn) == INTERPRET_OK;
+        if (units[i].ast != NULL) free_ast(units[i].ast);
+        arena_free(&units[i].arena);
+    }
+    CHECK(ok, "Every unit parses on a worker, then checks, compiles and runs");
+
+    Value b = BOOL_VAL(false);
+    for (int i = 0; i < compiler_global_count(); i++) {
+        int length = 0;
+        const char* name = compiler_global_name(i, &length);
+        if (length == 4 && memcmp(name, "pp_b", 4) == 0) b = vm.globals[i];
+    }
+    CHECK(IS_INT(b) && AS_INT(b) == 74, "Later units see the globals of earlier ones");
+    free_vm();
+}
+
+
+/* -------------------------------------------------------------
+ * SUITE WRAPPER
+ * ------------------------------------------------------------- */
+void test_threads_suite() {
+    run_test(test_pool_runs_all,       "Threads - Pool Runs Every Index");
+    run_test(test_pool_scripts,        "Threads - Scripts On Several Threads");
+    run_test(test_pool_parallel_parse, "Threads - Parallel Parse, Ordered Run");
+}
@@ -0,0 +1,251 @@
+/**
+ * @file test_trace.c
+ * @brief Unit tests for the runtime tracing hooks (trace.h).
+ */
+
+#include <string.h>
+
+#include "test_trace.h"
+#include "test.h"
+
+#include "vm/vm.h"
+#include "vm/opcode.h"
+#include "vm/object.h"
+#include "vm/compiler.h"
+#include "vm/trace.h"
+#include "vm/alloc_profiler.h"
+#include "parser.h"
+#include "typechecker.h"
+#include "ast.h"
+
+/* -------------------------------------------------------------
+ * Helper: a tracer that counts every event
+ * ------------------------------------------------------------- */
+typedef struct {
+    int instructions;
+    int calls;
+    int returns;
+    int depth;
+    int maxDepth;
+    int gcBegins;
+    int gcEnds;
+    int allocations;
+    int stringAllocations;
+    int returnOps;
+    int stackOk;            // Hooks saw frame->ip and stackTop current
+} TraceCounts;
+
+static void count_instruction(void* user, VM* vm, ObjFunction* function, int offset) {
+    TraceCounts* counts = (TraceCounts*)user;
+    counts->instructions++;
+    if (function->chunk.code[offset] == OP_RETURN) counts->returnOps++;
+    CallFrame* frame = &vm->frames[vm->frameCount - 1];
+    if (frame->ip == function->chunk.code + offset && vm->stackTop >= frame->slots) counts->stackOk++;
+}
+
+static void count_call(void* user, VM* vm, ObjFunction* function) {
+    (void)vm;
+    (void)function;
+    TraceCounts* counts = (TraceCounts*)user;
+    counts->calls++;
+    if (++counts->depth > counts->maxDepth) counts->maxDepth = counts->depth;
+}
+
+static void count_return(void* user, VM* vm, ObjFunction* function) {
+    (void)vm;
+    (void)function;
+    TraceCounts* counts = (TraceCounts*)user;
+    counts->returns++;
+    counts->depth--;
+}
+
+static void count_gc_begin(void* user, VM* vm) {
+    (void)vm;
+    ((TraceCounts*)user)->gcBegins++;
+}
+
+static void count_gc_end(void* user, VM* vm, uint64_t pauseNs) {
+    (void)vm;
+    (void)pauseNs;
+    ((TraceCounts*)user)->gcEnds++;
+}
+
+static void count_allocation(void* user, VM* vm, ObjType type, size_t size) {
+    (void)vm;
+    TraceCounts* counts = (TraceCounts*)user;
+    counts->allocations++;
+    if (type == OBJ_STRING && size > 0) counts->stringAllocations++;
+}
+
+static VmTracer counting_tracer(TraceCounts* counts) {
+    memset(counts, 0, sizeof(*counts));
+    VmTracer tracer = {counts, count_instruction, count_call, count_return,
+                       count_gc_begin, count_gc_end, count_allocation, NULL};
+    return tracer;
+}
+
+/* -------------------------------------------------------------
+ * Helper: compile and run one unit on the default VM
+ * ------------------------------------------------------------- */
+static InterpretResult run_traced(const char* source) {
+    AstNode* ast = parse(source, 0);
+    CHECK(ast != NULL, "Parse must succeed");
+    if (ast == NULL) return INTERPRET_COMPILE_ERROR;
+    CHECK(typecheck_ast(ast), "Typecheck must succeed");
+
+    ObjFunction* fn = compile_ast(ast);
+    CHECK(fn != NULL, "Compilation must succeed");
+    InterpretResult result = fn != NULL ? interpret(fn) : INTERPRET_COMPILE_ERROR;
+    free_ast(ast);
+    return result;
+}
+
+
+/* -------------------------------------------------------------
+ * TEST 1: Instructions, calls and returns
+ * ------------------------------------------------------------- */
+static void test_trace_calls() {
+    init_vm();
+    TraceCounts counts;
+    VmTracer tracer = counting_tracer(&counts);
+    vm_set_tracer(&vm, &tracer);
+
+    InterpretResult result = run_traced(
+        "func tr_fib(n): int { if n < 2 { return n; } return tr_fib(n - 1) + tr_fib(n - 2); }"
+        "var tr_r = tr_fib(5);");
+    CHECK(result == INTERPRET_OK, "Program must run");
+    CHECK(counts.calls == 1 + 15, "Script and 15 calls of tr_fib(5) are entered");
+    CHECK(counts.returns == counts.calls && counts.depth == 0, "Every frame entered is left");
+    CHECK(counts.maxDepth == 1 + 5, "Deepest path is script + 5 frames");
+    CHECK(counts.returnOps == counts.returns, "Each return is an OP_RETURN");
+    CHECK(counts.instructions > 0 && counts.stackOk == counts.instructions,
+          "Hooks see the frame as the instruction runs");
+
+    // Tail calls replace the frame: one call and return per iteration
+    tracer = counting_tracer(&counts);
+    result = run_traced("func tr_down(n): int { if n == 0 { return 0; } return tr_down(n - 1); }"
+                        "var tr_d = tr_down(3);");
+    CHECK(result == INTERPRET_OK, "Program must run");
+    CHECK(counts.calls == 1 + 4 && counts.maxDepth == 2, "Tail calls are traced at the same depth");
+    CHECK(counts.returns == counts.calls, "Tail-called frames are left once each");
+
+    // Detached: nothing is reported
+    vm_set_tracer(&vm, NULL);
+    counts.instructions = 0;
+    result = run_traced("var tr_e = tr_down(3);");
+    CHECK(result == INTERPRET_OK && counts.instructions == 0, "A detached tracer sees nothing");
+    free_vm();
+}
+
+
+/* -------------------------------------------------------------
+ * TEST 2: A runtime error unwinds the traced frames
+ * ------------------------------------------------------------- */
+static void test_trace_unwind() {
+    init_vm();
+    TraceCounts counts;
+    VmTracer tracer = counting_tracer(&counts);
+    vm_set_tracer(&vm, &tracer);
+
+    printf("  (Expect error below)\n");
+    InterpretResult result = run_traced(
+        "func tr_div(n): int { return 10 / n; }"
+        "var tr_z = 0; var tr_q = tr_div(tr_z);");
+    CHECK(result == INTERPRET_RUNTIME_ERROR, "Division by zero fails");
+    CHECK(counts.calls == 2 && counts.returns == 2 && counts.depth == 0,
+          "Frames left by the error are reported as returns");
+    free_vm();
+}
+
+
+/* -------------------------------------------------------------
+ * TEST 3: Allocation and collector hooks
+ * ------------------------------------------------------------- */
+static void test_trace_gc_and_allocations() {
+    init_vm();
+    TraceCounts counts;
+    VmTracer tracer = counting_tracer(&counts);
+    tracer.instruction = NULL; // Heap hooks only: run() keeps its normal table
+    tracer.call = NULL;
+    tracer.ret = NULL;
+    vm_set_tracer(&vm, &tracer);
+
+    InterpretResult result = run_traced(
+        "var tr_s = \"\"; var tr_i = 0;"
+        "while tr_i < 20 { tr_s = tr_s + \"x\"; tr_i = tr_i + 1; }");
+    CHECK(result == INTERPRET_OK, "Program must run");
+    CHECK(counts.stringAllocations >= 20, "Each concatenation allocates a string");
+    CHECK(counts.instructions == 0 && counts.calls == 0, "No code hooks were attached");
+
+    int begins = counts.gcBegins;
+    vm_collect_garbage(&vm);
+    CHECK(counts.gcBegins == begins + 1, "A collection reports one pause");
+    CHECK(counts.gcEnds == counts.gcBegins, "Every pause begun ends");
+
+    vm_set_tracer(&vm, NULL);
+    free_vm();
+}
+
+
+/* -------------------------------------------------------------
+ * TEST 4: The allocation profiler charges the allocating line
+ * ------------------------------------------------------------- */
+static void test_trace_alloc_profiler() {
+    set_vm_alloc_profiling(true);
+    init_vm();
+    set_vm_alloc_profiling(false);
+    AllocProfiler* profiler = vm.allocProfiler;
+    CHECK(profiler != NULL && vm.tracer == &profiler->tracer, "The profiler is attached as the tracer");
+    if (profiler == NULL) {
+        free_vm();
+        return;
+    }
+
+    InterpretResult result = run_traced(
+        "var ap_s = \"\"; var ap_i = 0;\n"
+        "while ap_i < 50 {\n"
+        "  ap_s = ap_s + \"abcdefgh\";\n"
+        "  ap_i = ap_i + 1;\n"
+        "}\n");
+    CHECK(result == INTERPRET_OK, "Program must run");
+    CHECK(profiler->kindObjects[OBJ_STRING] + profiler->kindObjects[OBJ_ROPE] >= 40,
+          "Each concatenation is counted by type");
+
+    uint64_t onLine = 0, inFrames = 0;
+    for (int i = 1; i < profiler->siteCount; i++) {
+        const AllocSite* site = &profiler->sites[i];
+        CHECK(site->function != NULL, "Only site 0 is outside frames");
+        inFrames += site->objects;
+        if (site->offset >= 0 && get_line(&site->function->chunk, site->offset) == 3) onLine += site->objects;
+    }
+    CHECK(onLine >= 40, "The concatenations are charged to their line");
+    CHECK(onLine * 2 > inFrames, "The loop's line is the heaviest");
+
+    FILE* out = tmpfile();
+    if (out != NULL) {
+        alloc_profiler_report(profiler, out);
+        rewind(out);
+        char line[256];
+        bool header = false, concat = false;
+        while (fgets(line, sizeof(line), out) != NULL) {
+            if (strncmp(line, "Allocation profile:", 19) == 0) header = true;
+            if (strstr(line, "OP_CONCAT") != NULL) concat = true;
+        }
+        fclose(out);
+        CHECK(header && concat, "The report lists the allocating opcode");
+    }
+
+    free_vm();
+    CHECK(vm.allocProfiler == NULL && vm.tracer == NULL, "free_vm releases the profiler");
+}
+
+
+/* -------------------------------------------------------------
+ * SUITE WRAPPER
+ * ------------------------------------------------------------- */
+void test_trace_suite() {
+    run_test(test_trace_calls,              "Trace - Instructions, calls and returns");
+    run_test(test_trace_unwind,             "Trace - Runtime error unwinding");
+    run_test(test_trace_gc_and_allocations, "Trace - Allocation and GC hooks");
+    run_test(test_trace_alloc_profiler,     "Trace - Allocation profiler");
+}
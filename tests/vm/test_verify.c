@@ -0,0 +1,245 @@
+/**
+ * @file test_verify.c
+ * @brief Unit tests for the bytecode verifier and --unsafe-fast.
+ */
+
+#include "test_verify.h"
+#include "test.h"
+
+#include "vm/vm.h"
+#include "vm/object.h"
+#include "vm/opcode.h"
+#include "vm/compiler.h"
+#include "vm/verify.h"
+#include "parser.h"
+#include "typechecker.h"
+#include "ast.h"
+
+#include <string.h>
+
+/* -------------------------------------------------------------
+ * Helper: make `vm` a fresh VM that verifies every unit
+ * ------------------------------------------------------------- */
+static void init_unsafe_vm() {
+    set_vm_unsafe_fast(true);
+    init_vm();
+    set_vm_unsafe_fast(false);
+}
+
+/* -------------------------------------------------------------
+ * Helper: compile `source` (without running it)
+ * ------------------------------------------------------------- */
+static ObjFunction* compile_source(const char* source) {
+    AstNode* ast = parse(source, 0);
+    CHECK(ast != NULL, "Parse must succeed");
+    CHECK(typecheck_ast(ast), "Typecheck must succeed");
+
+    ObjFunction* fn = compile_ast(ast);
+    CHECK(fn != NULL, "Compilation must succeed");
+    free_ast(ast);
+    return fn;
+}
+
+/* -------------------------------------------------------------
+ * Helper: a script whose code is `code`, with constants
+ * ------------------------------------------------------------- */
+static ObjFunction* raw_script(const uint8_t* code, int count, const Value* constants, int constantCount) {
+    ObjFunction* fn = new_function();
+    push(OBJ_VAL(fn));
+    for (int i = 0; i < constantCount; i++) add_constant(&fn->chunk, constants[i]);
+    for (int i = 0; i < count; i++) write_chunk(&fn->chunk, code[i], 1);
+    pop();
+    return fn;
+}
+
+/* -------------------------------------------------------------
+ * Helper: look up a global slot by name
+ * ------------------------------------------------------------- */
+static int global_slot(const char* name) {
+    for (int i = 0; i < compiler_global_count(); i++) {
+        int length = 0;
+        const char* existing = compiler_global_name(i, &length);
+        if (length == (int)strlen(name) && memcmp(existing, name, length) == 0) return i;
+    }
+    return -1;
+}
+
+/* -------------------------------------------------------------
+ * Helper: the function constant of `script` named `name`
+ * ------------------------------------------------------------- */
+static ObjFunction* function_named(ObjFunction* script, const char* name) {
+    ValueArray* constants = &script->chunk.constants;
+    for (int i = 0; i < constants->count; i++) {
+        if (!IS_FUNCTION(constants->values[i])) continue;
+        ObjFunction* function = AS_FUNCTION(constants->values[i]);
+        if (function->name != NULL && strcmp(function->name->chars, name) == 0) return function;
+    }
+    return NULL;
+}
+
+
+/* -------------------------------------------------------------
+ * TEST 1: Compiled programs verify, and plain verification
+ * changes nothing
+ * ------------------------------------------------------------- */
+static void test_verify_compiled() {
+    init_vm();
+    ObjFunction* fn = compile_source(
+        "func vf_fact(n): int { if n < 2 { return 1; } return n * vf_fact(n - 1); }"
+        "func vf_join(a, b): str { var c = a + b; return c + c; }"
+        "var vf_i = 0; var vf_s = 0;"
+        "while vf_i < 10 { if vf_i % 2 == 0 { vf_s = vf_s + vf_fact(vf_i); } else { vf_s -= 1; } vf_i += 1; }"
+        "print vf_join(\"a\", \"b\");");
+    if (fn == NULL) {
+        free_vm();
+        return;
+    }
+
+    push(OBJ_VAL(fn));
+    uint8_t before[256];
+    int count = fn->chunk.count < 256 ? fn->chunk.count : 256;
+    memcpy(before, fn->chunk.code, count);
+
+    CHECK(verify_unit(&vm, fn, false), "Compiled program passes the verifier");
+    CHECK(memcmp(before, fn->chunk.code, count) == 0, "Plain verification leaves the code alone");
+    CHECK(!fn->verified && !fn->trusted, "Plain verification marks nothing");
+    pop();
+    free_vm();
+}
+
+
+/* -------------------------------------------------------------
+ * TEST 2: Malformed bytecode is rejected
+ * ------------------------------------------------------------- */
+static void test_verify_malformed() {
+    init_vm();
+    Value ints[] = { INT_VAL(7) };
+
+    static const uint8_t underflow[] = { OP_POP, OP_RETURN };
+    static const uint8_t intoOperand[] = { OP_TRUE, OP_JUMP_IF_FALSE_POP, 0, 1, OP_CONSTANT, 0, OP_RETURN };
+    static const uint8_t badConstant[] = { OP_CONSTANT, 5, OP_RETURN };
+    static const uint8_t unbalanced[] = { OP_TRUE, OP_JUMP_IF_FALSE_POP, 0, 1, OP_TRUE, OP_RETURN };
+    static const uint8_t offTheEnd[] = { OP_TRUE, OP_POP };
+    static const uint8_t wrongType[] = { OP_TRUE, OP_CONSTANT, 0, OP_ADD_INT, OP_RETURN };
+    static const uint8_t unknown[] = { 250, OP_RETURN };
+    static const uint8_t truncated[] = { OP_TRUE, OP_JUMP, 0 };
+
+    printf("  (Expect errors below)\n");
+    CHECK(!verify_unit(&vm, raw_script(underflow, sizeof(underflow), ints, 1), false),
+          "Stack underflow is rejected");
+    CHECK(!verify_unit(&vm, raw_script(intoOperand, sizeof(intoOperand), ints, 1), false),
+          "Jump into an operand is rejected");
+    CHECK(!verify_unit(&vm, raw_script(badConstant, sizeof(badConstant), ints, 1), false),
+          "Constant index out of range is rejected");
+    CHECK(!verify_unit(&vm, raw_script(unbalanced, sizeof(unbalanced), ints, 1), false),
+          "Different stack depths at a jump target are rejected");
+    CHECK(!verify_unit(&vm, raw_script(offTheEnd, sizeof(offTheEnd), ints, 1), false),
+          "Running off the end of the code is rejected");
+    CHECK(!verify_unit(&vm, raw_script(wrongType, sizeof(wrongType), ints, 1), false),
+          "A bool operand of OP_ADD_INT is rejected");
+    CHECK(!verify_unit(&vm, raw_script(unknown, sizeof(unknown), ints, 1), false),
+          "Unknown opcode is rejected");
+    CHECK(!verify_unit(&vm, raw_script(truncated, sizeof(truncated), ints, 1), false),
+          "Truncated instruction is rejected");
+
+    static const uint8_t fine[] = {
+        OP_TRUE, OP_JUMP_IF_FALSE_POP, 0, 5, OP_CONSTANT, 0, OP_JUMP, 0, 2, OP_CONSTANT, 0, OP_RETURN
+    };
+    CHECK(verify_unit(&vm, raw_script(fine, sizeof(fine), ints, 1), false), "Well-formed code passes");
+    free_vm();
+}
+
+
+/* -------------------------------------------------------------
+ * TEST 3: Proven instructions are rewritten, fully proven
+ * functions are trusted, and programs give the same results
+ * ------------------------------------------------------------- */
+static void test_verify_trust() {
+    init_vm();
+
+    // 2 + 3 with a checked OP_ADD: both operands are int constants
+    Value ints[] = { INT_VAL(2), INT_VAL(3) };
+    static const uint8_t add[] = { OP_CONSTANT, 0, OP_CONSTANT, 1, OP_ADD, OP_NEGATE, OP_RETURN };
+    ObjFunction* fn = raw_script(add, sizeof(add), ints, 2);
+    push(OBJ_VAL(fn));
+    CHECK(verify_unit(&vm, fn, true), "Constant arithmetic verifies");
+    CHECK(fn->chunk.code[4] == OP_ADD_INT, "OP_ADD on proven ints becomes OP_ADD_INT");
+    CHECK(fn->verified && fn->trusted, "Function with every guard proven is trusted");
+    pop();
+    CHECK(interpret(fn) == INTERPRET_OK, "Rewritten code runs");
+    CHECK(IS_INT(vm.stackTop[-1]) && AS_INT(vm.stackTop[-1]) == -5, "Rewritten code computes -(2 + 3)");
+    free_vm();
+
+    // A whole program on a verifying VM
+    init_unsafe_vm();
+    fn = compile_source(
+        "func vf_neg(a): int { return -a; }"
+        "var vf_i = 0; var vf_s = 0;"
+        "while vf_i < 100 { if !(vf_i % 3 == 0) { vf_s = vf_s + -vf_i; } vf_i += 1; }"
+        "var vf_n = vf_neg(4);");
+    if (fn == NULL) {
+        free_vm();
+        return;
+    }
+    CHECK(interpret(fn) == INTERPRET_OK, "Program runs with --unsafe-fast");
+    CHECK(fn->trusted, "Script over int globals is trusted");
+    ObjFunction* neg = function_named(fn, "vf_neg");
+    CHECK(neg != NULL && neg->verified && !neg->trusted, "Negating an untyped parameter keeps its check");
+
+    int s = global_slot("vf_s");
+    int n = global_slot("vf_n");
+    CHECK(s >= 0 && IS_INT(vm.globals[s]) && AS_INT(vm.globals[s]) == -3267, "Trusted loop gives the checked result");
+    CHECK(n >= 0 && IS_INT(vm.globals[n]) && AS_INT(vm.globals[n]) == -4, "Untrusted function gives the checked result");
+
+    // Division by zero is still checked
+    printf("  (Expect error below)\n");
+    fn = compile_source("var vf_z = 0; var vf_q = 5 / vf_z;");
+    CHECK(fn != NULL && interpret(fn) == INTERPRET_RUNTIME_ERROR, "Division by zero is still a runtime error");
+    free_vm();
+}
+
+
+/* -------------------------------------------------------------
+ * TEST 4: A later unit may not change the type of a global
+ * that verified code relies on
+ * ------------------------------------------------------------- */
+static void test_verify_global_types() {
+    init_unsafe_vm();
+    ObjFunction* fn = compile_source("var vg_x = 1; vg_x += 1;");
+    CHECK(fn != NULL && interpret(fn) == INTERPRET_OK, "First unit runs");
+
+    int x = global_slot("vg_x");
+    CHECK(x >= 0 && x < 256, "Global has a 1-byte slot");
+    if (x < 0 || x >= 256) {
+        free_vm();
+        return;
+    }
+
+    ObjString* text = copy_string("text", 4);
+    push(OBJ_VAL(text));
+    Value constants[] = { OBJ_VAL(text), INT_VAL(9) };
+    const uint8_t storeString[] = { OP_CONSTANT, 0, OP_SET_GLOBAL, (uint8_t)x, OP_POP, OP_RETURN };
+    const uint8_t storeInt[] = { OP_CONSTANT, 1, OP_SET_GLOBAL, (uint8_t)x, OP_POP, OP_RETURN };
+
+    printf("  (Expect error below)\n");
+    ObjFunction* bad = raw_script(storeString, sizeof(storeString), constants, 2);
+    CHECK(interpret(bad) == INTERPRET_COMPILE_ERROR, "Storing a string into an int global is rejected");
+    CHECK(IS_INT(vm.globals[x]) && AS_INT(vm.globals[x]) == 2, "Rejected unit did not run");
+
+    ObjFunction* good = raw_script(storeInt, sizeof(storeInt), constants, 2);
+    CHECK(interpret(good) == INTERPRET_OK, "Storing another int runs");
+    CHECK(IS_INT(vm.globals[x]) && AS_INT(vm.globals[x]) == 9, "Int store took effect");
+    pop();
+    free_vm();
+}
+
+
+/* -------------------------------------------------------------
+ * SUITE WRAPPER
+ * ------------------------------------------------------------- */
+void test_verify_suite() {
+    run_test(test_verify_compiled,     "Verifier - Compiled Programs");
+    run_test(test_verify_malformed,    "Verifier - Malformed Bytecode");
+    run_test(test_verify_trust,        "Verifier - Quickening & Trust");
+    run_test(test_verify_global_types, "Verifier - Global Types Across Units");
+}
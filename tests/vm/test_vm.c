@@ -14,6 +14,8 @@
 #include "vm/value.h"
 #include "vm/object.h"
 #include "vm/compiler.h"
+#include "vm/natives.h"
+#include "vm/profiler.h"
 #include "parser.h"
 #include "typechecker.h"
 #include "ast.h"
@@ -62,6 +64,16 @@ static void test_vm_initialization() {
     CHECK(chunk.count == 1, "1 byte written");
     CHECK(chunk.code[0] == OP_RETURN, "Opcode is OP_RETURN");
 
+    // Line numbers are stored once per run of bytes from the same line
+    CHECK(get_line(&chunk, 0) == 1, "Line of the first byte");
+    for (int i = 0; i < 4; i++) write_chunk(&chunk, OP_POP, 1);
+    for (int i = 0; i < 3; i++) write_chunk(&chunk, OP_POP, 7);
+    write_chunk(&chunk, OP_RETURN, 9);
+    CHECK(chunk.lineCount == 3, "One line run per source line");
+    CHECK(get_line(&chunk, 4) == 1 && get_line(&chunk, 5) == 7 && get_line(&chunk, 7) == 7,
+          "Bytes map to the run they fall in");
+    CHECK(get_line(&chunk, 8) == 9, "Last byte has the last line");
+
     free_chunk(&chunk);
 }
 
@@ -106,6 +118,641 @@ static void test_vm_manual_string_alloc() {
 }
 
 
+/* -------------------------------------------------------------
+ * Helper: compile a snippet and return the byte at `offset`
+ * ------------------------------------------------------------- */
+static int compiled_byte_at(const char* source, int offset) {
+    AstNode* ast = parse(source, 0);
+    CHECK(ast != NULL, "Parse must succeed");
+    CHECK(typecheck_ast(ast), "Typecheck must succeed");
+
+    init_vm();
+    ObjFunction* fn = compile_ast(ast);
+    CHECK(fn != NULL, "Compilation must succeed");
+
+    int byte = (fn && offset < fn->chunk.count) ? fn->chunk.code[offset] : -1;
+
+    free_vm();
+    free_ast(ast);
+    return byte;
+}
+
+
+/* -------------------------------------------------------------
+ * TEST 5: Typechecker-driven specialized opcodes
+ * ------------------------------------------------------------- */
+static void test_vm_specialized_ops() {
+    // [CONSTANT 0] [CONSTANT 1] [op] [PRINT] [RETURN]
+    CHECK(compiled_byte_at("print 2 * 3;", 4) == OP_MULTIPLY_INT, "int * int -> OP_MULTIPLY_INT");
+    CHECK(compiled_byte_at("print 7 % 2;", 4) == OP_MODULO_INT, "int % int -> OP_MODULO_INT");
+    CHECK(compiled_byte_at("print \"a\" + \"b\";", 4) == OP_CONCAT, "string + string -> OP_CONCAT");
+    CHECK(compiled_byte_at("print 1 < 2;", 4) == OP_LESS_INT, "int < int -> OP_LESS_INT");
+    CHECK(compiled_byte_at("print 1 == 2;", 4) == OP_EQUAL_INT, "int == int -> OP_EQUAL_INT");
+    CHECK(compiled_byte_at("print true == false;", 2) == OP_EQUAL, "bool == bool stays checked");
+
+    // A global written inside a function body can hold any type at runtime
+    // [GET_GLOBAL i] [GET_GLOBAL i] [op]
+    int op = compiled_byte_at(
+        "var spec_g = 1;"
+        "func spec_f(): int { spec_g = 2; return 0; }"
+        "print spec_g + spec_g;",
+        14);
+    CHECK(op == OP_ADD, "Unproven global keeps checked OP_ADD");
+
+    Value v = run_and_get_return("return 6 * 7;");
+    CHECK(IS_INT(v) && AS_INT(v) == 42, "6 * 7 must equal 42");
+}
+
+
+/* -------------------------------------------------------------
+ * TEST 6: Frame and operand stacks grow up to the configured limit
+ * ------------------------------------------------------------- */
+static InterpretResult run_with_limits(const char* source, int maxFrames) {
+    AstNode* ast = parse(source, 0);
+    CHECK(ast != NULL, "Parse must succeed");
+    CHECK(typecheck_ast(ast), "Typecheck must succeed");
+
+    set_vm_limits(maxFrames, 0);
+    init_vm();
+    ObjFunction* fn = compile_ast(ast);
+    CHECK(fn != NULL, "Compilation must succeed");
+
+    InterpretResult result = interpret(fn);
+    if (result == INTERPRET_OK) {
+        CHECK(vm.frameCapacity > FRAMES_INITIAL, "Frame stack grew past its initial size");
+        CHECK(vm.stackCapacity > STACK_INITIAL, "Operand stack grew past its initial size");
+    }
+
+    free_vm();
+    free_ast(ast);
+    set_vm_limits(FRAMES_LIMIT_DEFAULT, STACK_LIMIT_DEFAULT);
+    return result;
+}
+
+static void test_vm_growable_stacks() {
+    const char* deep =
+        "func gs_down(n) { if n > 0 { gs_down(n - 1); } return 0; }"
+        "gs_down(1000);";
+
+    CHECK(run_with_limits(deep, FRAMES_LIMIT_DEFAULT) == INTERPRET_OK,
+          "Recursion deeper than the initial frame count runs");
+    CHECK(run_with_limits(deep, 8) == INTERPRET_RUNTIME_ERROR,
+          "Exceeding --max-depth reports a stack overflow");
+}
+
+
+/* -------------------------------------------------------------
+ * TEST 7: Independent VM instances keep separate heaps and globals
+ * ------------------------------------------------------------- */
+static void test_vm_instances() {
+    VM* a = new_vm();
+    VM* b = new_vm();
+
+    VM* previous = use_vm(a);
+    ObjString* inA = copy_string("instance", 8);
+    vm_push(a, OBJ_VAL(inA)); // Rooted until the chunk below refers to it
+    CHECK(a->objects == (Obj*)inA && b->objects == NULL, "Allocation goes to the current VM");
+
+    use_vm(b);
+    ObjString* inB = copy_string("instance", 8);
+    CHECK(inA != inB, "Each VM interns into its own table");
+    CHECK(b->objects == (Obj*)inB && a->objects == (Obj*)inA, "Heaps stay separate");
+
+    // Run a chunk on `a` while `b` is current: runtime allocations follow the handle
+    use_vm(a);
+    ObjFunction* fn = new_function();
+    vm_push(a, OBJ_VAL(fn));
+    Chunk* chunk = &fn->chunk;
+    int k = add_constant(chunk, OBJ_VAL(inA));
+    write_chunk(chunk, OP_CONSTANT, 1);
+    write_chunk(chunk, (uint8_t)k, 1);
+    write_chunk(chunk, OP_CONSTANT, 1);
+    write_chunk(chunk, (uint8_t)k, 1);
+    write_chunk(chunk, OP_CONCAT, 1);
+    write_chunk(chunk, OP_SET_GLOBAL, 1);
+    write_chunk(chunk, 0, 1);
+    write_chunk(chunk, OP_RETURN, 1);
+    vm_pop(a);
+    vm_pop(a);
+
+    use_vm(b);
+    CHECK(vm_interpret(a, fn) == INTERPRET_OK, "vm_interpret runs on the given instance");
+    CHECK(currentVM == b, "vm_interpret restores the current VM");
+    CHECK(IS_STRING(a->globals[0]) && AS_STRING(a->globals[0])->length == 16, "Result stored in a's globals");
+    CHECK(!IS_OBJ(b->globals[0]) || AS_OBJ(b->globals[0]) == NULL, "b's globals untouched");
+    CHECK(b->objects == (Obj*)inB && b->objects->next == NULL, "Nothing allocated in b");
+
+    use_vm(previous);
+    destroy_vm(a);
+    destroy_vm(b);
+    CHECK(currentVM == previous, "Current VM unchanged after destroying other instances");
+}
+
+
+/* -------------------------------------------------------------
+ * Helper: does `function`'s code contain `op`?
+ * ------------------------------------------------------------- */
+static bool chunk_has_op(ObjFunction* function, uint8_t op) {
+    Chunk* chunk = &function->chunk;
+    for (int offset = 0; offset < chunk->count; offset += opcode_length(chunk->code[offset])) {
+        if (chunk->code[offset] == op) return true;
+    }
+    return false;
+}
+
+/* -------------------------------------------------------------
+ * Helper: does `function` contain a direct call (any of its forms)?
+ * ------------------------------------------------------------- */
+static bool chunk_has_direct_call(ObjFunction* function) {
+    Chunk* chunk = &function->chunk;
+    for (int offset = 0; offset < chunk->count; offset += opcode_length(chunk->code[offset])) {
+        if (is_direct_call(chunk->code[offset])) return true;
+    }
+    return false;
+}
+
+/* -------------------------------------------------------------
+ * Helper: compile `source` into the running VM, run it and return the
+ * global `dc_r` (each snippet stores its result there)
+ * ------------------------------------------------------------- */
+static Value run_unit(const char* source, ObjFunction** compiled, InterpretResult* result) {
+    AstNode* ast = parse(source, 0);
+    CHECK(ast != NULL, "Parse must succeed");
+
+    ObjFunction* fn = ast ? compile_ast(ast) : NULL;
+    CHECK(fn != NULL, "Compilation must succeed");
+    *compiled = fn;
+    *result = fn ? interpret(fn) : INTERPRET_COMPILE_ERROR;
+    if (ast) free_ast(ast);
+
+    for (int i = 0; i < compiler_global_count(); i++) {
+        int length = 0;
+        const char* name = compiler_global_name(i, &length);
+        if (length == 4 && memcmp(name, "dc_r", 4) == 0) return vm.globals[i];
+    }
+    return BOOL_VAL(false);
+}
+
+
+/* -------------------------------------------------------------
+ * TEST 8: Calls to functions declared in the same unit bind directly
+ * ------------------------------------------------------------- */
+static void test_vm_direct_calls() {
+    ObjFunction* script = NULL;
+    InterpretResult result;
+    init_vm();
+
+    Value v = run_unit(
+        "func dc_fib(n): int { if n <= 1 { return n; } return dc_fib(n - 1) + dc_fib(n - 2); }"
+        "func dc_one(): int { return 1; }"
+        "func dc_get(): int { return dc_one(); }"
+        "var dc_r = dc_fib(10);", &script, &result);
+    CHECK(result == INTERPRET_OK && IS_INT(v) && AS_INT(v) == 55, "dc_fib(10) returns 55");
+    CHECK(script && chunk_has_op(script, OP_CALL_DIRECT_1), "Top-level call is direct, with its arity in the opcode");
+
+    ObjFunction* fib = NULL;
+    for (int i = 0; script && i < script->chunk.constants.count; i++) {
+        Value constant = script->chunk.constants.values[i];
+        if (IS_FUNCTION(constant) && strcmp(AS_FUNCTION(constant)->name->chars, "dc_fib") == 0) {
+            fib = AS_FUNCTION(constant);
+        }
+    }
+    CHECK(fib && chunk_has_op(fib, OP_CALL_DIRECT_1), "Recursive calls are direct");
+    CHECK(fib && !chunk_has_op(fib, OP_GET_GLOBAL), "Recursion does not load the global");
+
+    // A later unit rebinds dc_one: the direct call inside dc_get follows it
+    v = run_unit("func dc_one(): int { return 2; } dc_r = dc_get();", &script, &result);
+    CHECK(script && !chunk_has_direct_call(script), "Earlier units' functions go through the global");
+    CHECK(result == INTERPRET_OK && IS_INT(v) && AS_INT(v) == 2, "Direct call sees the rebound global");
+
+    // The wrong arity keeps the checked call (and its runtime error)
+    run_unit("func dc_two(a, b): int { return a + b; } dc_r = dc_two(1);", &script, &result);
+    CHECK(script && !chunk_has_direct_call(script), "Arity mismatch is not bound directly");
+    CHECK(result == INTERPRET_RUNTIME_ERROR, "Arity mismatch is still a runtime error");
+
+    // Up to 3 arguments the count is in the opcode; more keep the operand
+    v = run_unit(
+        "func dc_zero(): int { return 0; }"
+        "func dc_three(a, b, c): int { return a * 100 + b * 10 + c; }"
+        "func dc_four(a, b, c, d): int { return a * 1000 + b * 100 + c * 10 + d; }"
+        "dc_r = dc_four(1, 2, 3, 4) + dc_three(5, 6, 7) + dc_zero();", &script, &result);
+    CHECK(result == INTERPRET_OK && IS_INT(v) && AS_INT(v) == 1234 + 567, "Fixed-arity calls pass their arguments");
+    CHECK(script && chunk_has_op(script, OP_CALL_DIRECT_0) && chunk_has_op(script, OP_CALL_DIRECT_3),
+          "0 and 3 arguments use the fixed-arity forms");
+    CHECK(script && chunk_has_op(script, OP_CALL_DIRECT), "4 arguments keep OP_CALL_DIRECT");
+
+    free_vm();
+}
+
+
+/* -------------------------------------------------------------
+ * TEST 9: `return f(...)` reuses the caller's frame
+ * ------------------------------------------------------------- */
+static void test_vm_tail_calls() {
+    ObjFunction* script = NULL;
+    InterpretResult result;
+    set_vm_limits(8, 0);
+    init_vm();
+
+    // Far deeper than 8 frames, but a tail call never adds one
+    Value v = run_unit(
+        "func tc_sum(n, acc): int { if n == 0 { return acc; } return tc_sum(n - 1, acc + n); }"
+        "var dc_r = tc_sum(50000, 0);", &script, &result);
+    CHECK(result == INTERPRET_OK && IS_INT(v) && AS_INT(v) == 1250025000, "Tail recursion runs in constant depth");
+
+    ObjFunction* sum = NULL;
+    for (int i = 0; script && i < script->chunk.constants.count; i++) {
+        if (IS_FUNCTION(script->chunk.constants.values[i])) sum = AS_FUNCTION(script->chunk.constants.values[i]);
+    }
+    CHECK(sum && chunk_has_op(sum, OP_TAIL_CALL_DIRECT), "Recursive tail call is direct");
+    CHECK(script && !chunk_has_op(script, OP_TAIL_CALL), "Script-level calls are not tail calls");
+
+    // Calling a function from an earlier unit takes the generic form
+    v = run_unit(
+        "func tc_outer(n): int { return tc_sum(n, 1); }"
+        "dc_r = tc_outer(4);", &script, &result);
+    CHECK(result == INTERPRET_OK && IS_INT(v) && AS_INT(v) == 11, "Generic tail call returns the callee's value");
+
+    // A non-tail call still needs a frame per level
+    run_unit(
+        "func tc_deep(n): int { if n == 0 { return 0; } return 1 + tc_deep(n - 1); }"
+        "dc_r = tc_deep(100);", &script, &result);
+    CHECK(result == INTERPRET_RUNTIME_ERROR, "Non-tail recursion still hits --max-depth");
+
+    // Arity errors are still reported
+    run_unit(
+        "func tc_bad(n): int { return tc_sum(n); }"
+        "dc_r = tc_bad(1);", &script, &result);
+    CHECK(result == INTERPRET_RUNTIME_ERROR, "Tail call with the wrong arity is a runtime error");
+
+    free_vm();
+    set_vm_limits(FRAMES_LIMIT_DEFAULT, STACK_LIMIT_DEFAULT);
+}
+
+
+/* -------------------------------------------------------------
+ * TEST 10: Young strings survive minor collections through globals
+ * ------------------------------------------------------------- */
+static void test_vm_nursery_globals() {
+    ObjFunction* script = NULL;
+    InterpretResult result;
+    init_vm();
+
+    // Thousands of distinct temporaries fill the nursery several times over,
+    // while `dc_r` (a global) keeps pointing at the newest young prefix
+    Value v = run_unit(
+        "var dc_r = \"\";"
+        "var ng_j = 0;"
+        "while ng_j < 300 {"
+        "    dc_r = dc_r + \"y\";"
+        "    var s = dc_r;"
+        "    var k = 0;"
+        "    while k < 30 { s = s + \"x\"; k = k + 1; }"
+        "    ng_j = ng_j + 1;"
+        "}", &script, &result);
+    CHECK(result == INTERPRET_OK, "String-building loop runs");
+    CHECK(IS_STRING(v) && AS_STRING(v)->length == 300, "Global keeps the promoted string");
+    CHECK(IS_STRING(v) && AS_STRING(v)->chars[0] == 'y' && AS_STRING(v)->chars[299] == 'y',
+          "Promoted contents are intact");
+
+    // The store to `dc_r` was remembered, so a minor collection moves it out
+    vm_collect_nursery(&vm);
+    v = run_unit("ng_j = 0;", &script, &result);
+    CHECK(IS_STRING(v) && !AS_OBJ(v)->isYoung && AS_STRING(v)->length == 300,
+          "Write barrier promotes young strings held only by a global");
+
+    free_vm();
+}
+
+
+/* -------------------------------------------------------------
+ * TEST 11: Natives run in place, also from tail position
+ * ------------------------------------------------------------- */
+static bool nt_add(VM* machine, int argCount, Value* args, Value* result) {
+    (void)argCount;
+    if (!IS_INT(args[0]) || !IS_INT(args[1])) {
+        vm_runtime_error(machine, "nt_add() expects numbers.");
+        return false;
+    }
+    *result = INT_VAL(AS_INT(args[0]) + AS_INT(args[1]));
+    return true;
+}
+
+static void test_vm_natives() {
+    ObjFunction* script = NULL;
+    InterpretResult result;
+    init_vm();
+    CHECK(vm_define_native(&vm, "nt_add", 2, TYPE_INT, nt_add), "Native is registered");
+
+    Value v = run_unit("var dc_r = nt_add(40, 2);", &script, &result);
+    CHECK(result == INTERPRET_OK && IS_INT(v) && AS_INT(v) == 42, "Native result replaces the call");
+    CHECK(vm.frameCount == 0 && vm.stackTop == vm.stack + 1, "Native call leaves no frame or arguments behind");
+
+    v = run_unit(
+        "func nt_tail(n): int { return nt_add(n, 1); }"
+        "dc_r = nt_tail(1) + nt_tail(2);", &script, &result);
+    CHECK(result == INTERPRET_OK && IS_INT(v) && AS_INT(v) == 5, "Native in tail position returns from the caller");
+
+    run_unit("dc_r = nt_add(1);", &script, &result);
+    CHECK(result == INTERPRET_RUNTIME_ERROR, "Native arity is checked");
+
+    run_unit("dc_r = nt_add(1, \"x\");", &script, &result);
+    CHECK(result == INTERPRET_RUNTIME_ERROR, "Native can report a runtime error");
+
+    // The typechecker knows the declared return type
+    AstNode* ast = parse("var nt_t = nt_add(1, 2); nt_t = nt_t + 1;", 0);
+    CHECK(ast != NULL && typecheck_ast(ast), "Native call types as its declared return type");
+    if (ast) free_ast(ast);
+
+    free_vm();
+}
+
+
+/* -------------------------------------------------------------
+ * TEST 12: The profiler counts instructions and calls exactly
+ * ------------------------------------------------------------- */
+static void test_vm_profiler() {
+    ObjFunction* script = NULL;
+    InterpretResult result;
+    set_vm_profiling(true);
+    init_vm();
+    set_vm_profiling(false);
+    CHECK(vm.profiler != NULL, "Profiling VM has a profiler");
+
+    Value v = run_unit(
+        "func pf_sum(n, acc): int { if n == 0 { return acc; } return pf_sum(n - 1, acc + n); }"
+        "func pf_twice(n): int { return pf_sum(n, 0) + pf_sum(n, 0); }"
+        "var dc_r = pf_twice(10);", &script, &result);
+    CHECK(result == INTERPRET_OK && IS_INT(v) && AS_INT(v) == 110, "Profiled run computes the same result");
+
+    Profiler* profiler = vm.profiler;
+    uint64_t sumCalls = 0, twiceCalls = 0, scriptCalls = 0;
+    for (int i = 1; profiler && i < profiler->nodeCount; i++) {
+        ObjFunction* function = profiler->functions[profiler->nodes[i].function].function;
+        if (function->name == NULL) scriptCalls += profiler->nodes[i].calls;
+        else if (strcmp(function->name->chars, "pf_sum") == 0) sumCalls += profiler->nodes[i].calls;
+        else if (strcmp(function->name->chars, "pf_twice") == 0) twiceCalls += profiler->nodes[i].calls;
+    }
+    CHECK(scriptCalls == 1 && twiceCalls == 1, "Script and outer function are entered once");
+    CHECK(sumCalls == 22, "Calls and self tail calls are all counted");
+    CHECK(profiler && profiler->opCounts[OP_RETURN] == 4, "Every executed OP_RETURN is counted");
+
+    // A second run restarts at the root and adds to the same records
+    run_unit("dc_r = pf_sum(3, 0);", &script, &result);
+    sumCalls = 0;
+    for (int i = 1; profiler && i < profiler->nodeCount; i++) {
+        ObjFunction* function = profiler->functions[profiler->nodes[i].function].function;
+        if (function->name != NULL && strcmp(function->name->chars, "pf_sum") == 0) {
+            sumCalls += profiler->nodes[i].calls;
+        }
+    }
+    CHECK(sumCalls == 26, "Later runs accumulate");
+
+    free_vm();
+    CHECK(vm.profiler == NULL, "free_vm releases the profiler");
+}
+
+
+/* -------------------------------------------------------------
+ * Helper: do the separate and the fused front ends emit the same code?
+ * ------------------------------------------------------------- */
+static bool fused_matches_separate(const char* source) {
+    AstNode* separate = parse(source, 0);
+    AstNode* fused = parse(source, 0);
+    CHECK(separate != NULL && fused != NULL, "Parse must succeed");
+    if (separate == NULL || fused == NULL) return false;
+
+    CHECK(typecheck_ast(separate), "Typecheck must succeed");
+    ObjFunction* expected = compile_ast(separate);
+    ObjFunction* actual = compile_checked_ast(fused);
+    CHECK(expected != NULL && actual != NULL, "Both front ends compile");
+
+    bool same = expected && actual && expected->chunk.count == actual->chunk.count &&
+                memcmp(expected->chunk.code, actual->chunk.code, expected->chunk.count) == 0;
+    free_ast(separate);
+    free_ast(fused);
+    return same;
+}
+
+/* -------------------------------------------------------------
+ * TEST 13: Typechecking while compiling (one walk)
+ * ------------------------------------------------------------- */
+static void test_vm_fused_check() {
+    init_vm();
+
+    CHECK(fused_matches_separate("print 2 * 3 + 1; print \"a\" + \"b\"; print 1 < 2 == true;"),
+          "Specialized opcodes are the same");
+    CHECK(fused_matches_separate(
+              "var fc_g = 1;"
+              "func fc_f(n): int { fc_g = n; return fc_g + 1; }"
+              "{ var fc_l = fc_g + 2; fc_l = fc_l * 3; { var fc_l = \"s\"; print fc_l; } print fc_l; }"
+              "while fc_g < 3 { fc_g = fc_g + fc_f(fc_g); }"
+              "if fc_g == 3 { print fc_g; } else { print -fc_g; }"),
+          "Scopes, unproven names and calls compile the same");
+
+    // Type errors reject the unit, also after the block they occur in
+    AstNode* ast = parse("var fc_x = 1; { var fc_y = fc_x + \"a\"; } print fc_x;", 0);
+    CHECK(ast != NULL && compile_checked_ast(ast) == NULL, "Type error is rejected");
+    if (ast) free_ast(ast);
+
+    ast = parse("{ var fc_z = 1; print fc_missing; } print fc_z;", 0);
+    CHECK(ast != NULL && compile_checked_ast(ast) == NULL, "Undefined variable is rejected");
+    if (ast) free_ast(ast);
+
+    free_vm();
+}
+
+
+/* -------------------------------------------------------------
+ * TEST 14: A finished script is freed at once
+ * ------------------------------------------------------------- */
+static void test_vm_release_script() {
+    ObjFunction* script = NULL;
+    InterpretResult result;
+    init_vm();
+
+    Value v = run_unit("func rs_f(n): int { return n + 1; } var dc_r = rs_f(41);", &script, &result);
+    CHECK(result == INTERPRET_OK && IS_INT(v) && AS_INT(v) == 42, "Script runs");
+
+    size_t before = vm.bytesAllocated;
+    vm_release_script(&vm, script);
+    CHECK(vm.bytesAllocated < before, "Its memory is returned");
+
+    bool listed = false;
+    for (Obj* object = vm.objects; object != NULL; object = object->next) {
+        if (object == (Obj*)script) listed = true;
+    }
+    CHECK(!listed, "It is off the heap list");
+
+    // What it declared stays reachable through the globals
+    collect_garbage();
+    v = run_unit("dc_r = rs_f(1);", &script, &result);
+    CHECK(result == INTERPRET_OK && IS_INT(v) && AS_INT(v) == 2, "Declared function still runs");
+
+    free_vm();
+}
+
+
+/* -------------------------------------------------------------
+ * TEST 15: `print` goes through the VM's output buffer
+ * ------------------------------------------------------------- */
+static void read_sink(FILE* sink, char* text, size_t size) {
+    long end = ftell(sink);
+    rewind(sink);
+    size_t length = fread(text, 1, size - 1, sink);
+    text[length] = '\0';
+    fseek(sink, end, SEEK_SET);
+}
+
+static void test_vm_output_buffer() {
+    ObjFunction* script = NULL;
+    InterpretResult result;
+    char text[128];
+    set_vm_output_buffer(16);
+    init_vm();
+    FILE* sink = tmpfile();
+    CHECK(sink != NULL, "Temporary file for the output");
+    if (sink == NULL) {
+        free_vm();
+        set_vm_output_buffer(OUTPUT_BUFFER_DEFAULT);
+        return;
+    }
+    vm.output.sink = sink;
+
+    run_unit("print 123; print true;", &script, &result);
+    read_sink(sink, text, sizeof(text));
+    CHECK(result == INTERPRET_OK && text[0] == '\0' && vm.output.count == 9, "Short output stays buffered");
+
+    run_unit("var ob_min = -2147483647 - 1; print ob_min; print \"abc\"; print 0;", &script, &result);
+    read_sink(sink, text, sizeof(text));
+    CHECK(strcmp(text, "123\ntrue\n-2147483648\nabc\n") == 0, "A full buffer is written out");
+
+    vm_flush_output(&vm);
+    read_sink(sink, text, sizeof(text));
+    CHECK(strcmp(text, "123\ntrue\n-2147483648\nabc\n0\n") == 0, "Integers format without printf");
+
+    // A runtime error writes what was printed first
+    printf("  (Expect error below)\n");
+    run_unit("var ob_zero = 0; print 7; print 1 / ob_zero;", &script, &result);
+    read_sink(sink, text, sizeof(text));
+    CHECK(result == INTERPRET_RUNTIME_ERROR && strcmp(text + strlen(text) - 2, "7\n") == 0,
+          "Runtime error flushes the output");
+
+    vm.output.sink = stdout;
+    fclose(sink);
+    free_vm();
+    set_vm_output_buffer(OUTPUT_BUFFER_DEFAULT);
+}
+
+
+/* -------------------------------------------------------------
+ * TEST 16: Frames are sized by the precomputed stack depth
+ * ------------------------------------------------------------- */
+static void test_vm_max_stack_depth() {
+    // Hand-built: two pushes, then one value until the return
+    Chunk chunk;
+    init_chunk(&chunk);
+    write_chunk(&chunk, OP_TRUE, 1);
+    write_chunk(&chunk, OP_FALSE, 1);
+    write_chunk(&chunk, OP_EQUAL, 1);
+    write_chunk(&chunk, OP_RETURN, 1);
+    CHECK(chunk_stack_depth(&chunk, 0) == 2, "Two pushes give depth 2");
+    CHECK(chunk_stack_depth(&chunk, 3) == 5, "Entry values count towards the depth");
+    free_chunk(&chunk);
+
+    init_vm();
+    AstNode* ast = parse(
+        "func sd_calc(a, b, c): int { return (a + b) * c - a; }"
+        "func sd_down(n): int { if n == 0 { return 0; } return 1 + sd_down(n - 1); }"
+        "var dc_r = sd_down(3000);", 0);
+    CHECK(ast != NULL && typecheck_ast(ast), "Parse and typecheck must succeed");
+    ObjFunction* fn = compile_ast(ast);
+    CHECK(fn != NULL, "Compilation must succeed");
+    if (fn == NULL) {
+        free_vm();
+        return;
+    }
+
+    ObjFunction* calc = NULL;
+    for (int i = 0; i < fn->chunk.constants.count; i++) {
+        Value constant = fn->chunk.constants.values[i];
+        if (IS_FUNCTION(constant) && AS_FUNCTION(constant)->arity == 3) calc = AS_FUNCTION(constant);
+    }
+    CHECK(fn->maxStackDepth > 0, "The script has a stack depth");
+    CHECK(calc != NULL && calc->maxStackDepth >= 5 && calc->maxStackDepth <= 6,
+          "sd_calc() holds its callee, 3 arguments and at most 2 temporaries");
+
+    // Non-tail recursion still grows the stack before every frame
+    CHECK(interpret(fn) == INTERPRET_OK, "Execution must succeed");
+    Value v = BOOL_VAL(false);
+    for (int i = 0; i < compiler_global_count(); i++) {
+        int length = 0;
+        const char* name = compiler_global_name(i, &length);
+        if (length == 4 && memcmp(name, "dc_r", 4) == 0) v = vm.globals[i];
+    }
+    CHECK(IS_INT(v) && AS_INT(v) == 3000, "sd_down(3000) returns 3000");
+    free_vm();
+    free_ast(ast);
+}
+
+/* -------------------------------------------------------------
+ * TEST 17: Repeated constants share one pool slot
+ * ------------------------------------------------------------- */
+static void test_vm_constant_dedup() {
+    // 300 additions of 20 distinct ints: past the scanned pool size, and
+    // more uses than a one-byte operand could index
+    char source[8192];
+    int length = snprintf(source, sizeof(source),
+        "func cp_name(): str { return \"cp\"; } var cp_s = \"cp\"; cp_s = cp_name(); var dc_r = 0;");
+    for (int i = 0; i < 300; i++) {
+        length += snprintf(source + length, sizeof(source) - length, "dc_r = dc_r + %d;", 1000 + i % 20);
+    }
+
+    init_vm();
+    AstNode* ast = parse(source, 0);
+    CHECK(ast != NULL && typecheck_ast(ast), "Parse and typecheck must succeed");
+    ObjFunction* fn = ast ? compile_ast(ast) : NULL;
+    CHECK(fn != NULL, "Compilation must succeed");
+    if (fn == NULL) {
+        if (ast) free_ast(ast);
+        free_vm();
+        return;
+    }
+
+    ValueArray* constants = &fn->chunk.constants;
+    bool unique = true;
+    ObjString* scriptString = NULL;
+    ObjFunction* name = NULL;
+    for (int i = 0; i < constants->count; i++) {
+        for (int j = i + 1; j < constants->count; j++) {
+            if (values_equal(constants->values[i], constants->values[j])) unique = false;
+        }
+        if (IS_STRING(constants->values[i])) scriptString = AS_STRING(constants->values[i]);
+        if (IS_FUNCTION(constants->values[i])) name = AS_FUNCTION(constants->values[i]);
+    }
+    CHECK(unique, "No constant is held twice");
+    CHECK(constants->count <= 24, "The pool holds each distinct literal once");
+    CHECK(!chunk_has_op(fn, OP_CONSTANT_LONG), "Every constant keeps the one-byte operand");
+
+    ObjString* functionString = NULL;
+    for (int i = 0; name && i < name->chunk.constants.count; i++) {
+        if (IS_STRING(name->chunk.constants.values[i])) functionString = AS_STRING(name->chunk.constants.values[i]);
+    }
+    CHECK(scriptString != NULL && scriptString == functionString, "Functions share one string object");
+
+    CHECK(interpret(fn) == INTERPRET_OK, "Execution must succeed");
+    free_ast(ast);
+    Value v = BOOL_VAL(false);
+    for (int i = 0; i < compiler_global_count(); i++) {
+        int nameLength = 0;
+        const char* global = compiler_global_name(i, &nameLength);
+        if (nameLength == 4 && memcmp(global, "dc_r", 4) == 0) v = vm.globals[i];
+    }
+    CHECK(IS_INT(v) && AS_INT(v) == 302850, "Shared slots load the right values");
+    free_vm();
+}
+
+
 /* -------------------------------------------------------------
  * SUITE WRAPPER
  * ------------------------------------------------------------- */
@@ -114,4 +761,17 @@ void test_vm_suite() {
     run_test(test_vm_arithmetic,            "VM - Arithmetic via RETURN");
     run_test(test_vm_precedence_manual,     "VM - Operator precedence via RETURN");
     run_test(test_vm_manual_string_alloc,   "VM - Manual string alloc");
+    run_test(test_vm_specialized_ops,       "VM - Typechecker-specialized opcodes");
+    run_test(test_vm_growable_stacks,       "VM - Growable stacks");
+    run_test(test_vm_instances,             "VM - Independent instances");
+    run_test(test_vm_direct_calls,          "VM - Direct calls");
+    run_test(test_vm_tail_calls,            "VM - Tail calls");
+    run_test(test_vm_nursery_globals,       "VM - Young strings in globals");
+    run_test(test_vm_natives,               "VM - Native functions");
+    run_test(test_vm_profiler,              "VM - Profiler");
+    run_test(test_vm_fused_check,           "VM - Fused typecheck and compile");
+    run_test(test_vm_release_script,        "VM - Release finished script");
+    run_test(test_vm_output_buffer,         "VM - Buffered output");
+    run_test(test_vm_max_stack_depth,       "VM - Precomputed stack depth");
+    run_test(test_vm_constant_dedup,        "VM - Constant deduplication");
 }